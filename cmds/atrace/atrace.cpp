@@ -20,6 +20,7 @@
 #include <fcntl.h>
 #include <getopt.h>
 #include <inttypes.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -32,6 +33,7 @@
 
 #include <fstream>
 #include <memory>
+#include <vector>
 
 #include <binder/IBinder.h>
 #include <binder/IServiceManager.h>
@@ -327,6 +329,9 @@ static const char* k_tracePath =
 static const char* k_traceStreamPath =
     "trace_pipe";
 
+static const char* k_traceRawStreamPathFormat =
+    "per_cpu/cpu%ld/trace_pipe_raw";
+
 static const char* k_traceMarkerPath =
     "trace_marker";
 
@@ -916,6 +921,217 @@ static void streamTrace()
     }
 }
 
+// Header written once at the start of a raw binary trace stream. The rest of
+// the stream is a sequence of blocks, each framed by two uint32_t values (the
+// CPU the data was read from, then the payload size in bytes) followed by the
+// raw ring buffer payload. Event decoding happens off-device.
+struct RawStreamHeader {
+    char magic[8];      // "ATRCRAW1"
+    uint32_t pageSize;  // read granularity used for the blocks below
+    uint32_t nCpus;     // number of per-CPU streams multiplexed in the stream
+};
+
+// Run |data| through the deflate stream and write whatever output it produces
+// to outFd. |flush| is passed through to deflate(), so Z_SYNC_FLUSH makes the
+// stream decodable up to this point even if the capture is later aborted.
+static bool deflateToFd(z_stream* zs, int outFd, const void* data, size_t size,
+        int flush)
+{
+    uint8_t out[8192];
+    zs->next_in = static_cast<Bytef*>(const_cast<void*>(data));
+    zs->avail_in = size;
+    do {
+        zs->next_out = reinterpret_cast<Bytef*>(out);
+        zs->avail_out = sizeof(out);
+        int result = deflate(zs, flush);
+        if (result == Z_STREAM_ERROR) {
+            fprintf(stderr, "error deflating trace: %s\n", zs->msg);
+            return false;
+        }
+        size_t produced = sizeof(out) - zs->avail_out;
+        if (produced > 0 && !android::base::WriteFully(outFd, out, produced)) {
+            fprintf(stderr, "error writing deflated trace: %s (%d)\n",
+                    strerror(errno), errno);
+            return false;
+        }
+        if (result == Z_STREAM_END) {
+            break;
+        }
+    } while (zs->avail_out == 0);
+    return true;
+}
+
+// Write one framed block of raw ring buffer data to outFd, deflating it when
+// |zs| is non-null.
+static bool writeRawStreamBlock(int outFd, z_stream* zs, uint32_t cpu,
+        const void* data, size_t size)
+{
+    uint32_t frame[2] = { cpu, static_cast<uint32_t>(size) };
+    if (zs) {
+        return deflateToFd(zs, outFd, frame, sizeof(frame), Z_NO_FLUSH) &&
+                deflateToFd(zs, outFd, data, size, Z_SYNC_FLUSH);
+    }
+    return android::base::WriteFully(outFd, frame, sizeof(frame)) &&
+            android::base::WriteFully(outFd, data, size);
+}
+
+// Drain |size| bytes from the read end of the staging pipe into outFd. The
+// data is spliced when outFd supports it and copied through a small stack
+// buffer otherwise (e.g. when outFd is a tty or a socket that refuses
+// splice).
+static bool drainPipeToFd(int pipeFd, int outFd, size_t size)
+{
+    while (size > 0) {
+        ssize_t bytes = splice(pipeFd, nullptr, outFd, nullptr, size,
+                SPLICE_F_MOVE);
+        if (bytes == -1 && errno == EINVAL) {
+            char buf[4096];
+            size_t chunk = size < sizeof(buf) ? size : sizeof(buf);
+            bytes = TEMP_FAILURE_RETRY(read(pipeFd, buf, chunk));
+            if (bytes <= 0 || !android::base::WriteFully(outFd, buf, bytes)) {
+                fprintf(stderr, "error writing raw trace: %s (%d)\n",
+                        strerror(errno), errno);
+                return false;
+            }
+        } else if (bytes <= 0) {
+            fprintf(stderr, "error splicing raw trace: %s (%d)\n",
+                    strerror(errno), errno);
+            return false;
+        }
+        size -= bytes;
+    }
+    return true;
+}
+
+// Stream the raw per-CPU ring buffer pages to outFd until the trace is
+// aborted. Pages are moved out of the kernel with splice() where supported,
+// so steady-state capture does not copy or format trace data in userspace;
+// kernels (or output fds) without splice support fall back to read()/write().
+// With -z the blocks are deflated on the fly instead, which trades the
+// zero-copy path for a much smaller stream.
+static void streamRawTrace(int outFd)
+{
+    long nCpus = sysconf(_SC_NPROCESSORS_CONF);
+    if (nCpus < 1) {
+        nCpus = 1;
+    }
+    size_t pageSize = getpagesize();
+
+    std::vector<struct pollfd> cpuFds;
+    for (long cpu = 0; cpu < nCpus; cpu++) {
+        std::string path = g_traceFolder +
+                android::base::StringPrintf(k_traceRawStreamPathFormat, cpu);
+        int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd == -1) {
+            fprintf(stderr, "error opening %s: %s (%d)\n", path.c_str(),
+                    strerror(errno), errno);
+            for (const auto& pfd : cpuFds) {
+                close(pfd.fd);
+            }
+            return;
+        }
+        cpuFds.push_back({ fd, POLLIN, 0 });
+    }
+
+    z_stream zs;
+    z_stream* zsPtr = nullptr;
+    if (g_compress) {
+        memset(&zs, 0, sizeof(zs));
+        int result = deflateInit(&zs, Z_DEFAULT_COMPRESSION);
+        if (result != Z_OK) {
+            fprintf(stderr, "error initializing zlib: %d\n", result);
+            for (const auto& pfd : cpuFds) {
+                close(pfd.fd);
+            }
+            return;
+        }
+        zsPtr = &zs;
+    }
+
+    // The staging pipe lets a page be spliced out of the ring buffer before
+    // its size is known, so the frame header can be emitted first.
+    int pipeFds[2] = { -1, -1 };
+    bool useSplice = !g_compress && pipe2(pipeFds, O_CLOEXEC) == 0;
+    std::unique_ptr<uint8_t[]> readBuf(new uint8_t[pageSize]);
+
+    RawStreamHeader header;
+    memcpy(header.magic, "ATRCRAW1", sizeof(header.magic));
+    header.pageSize = pageSize;
+    header.nCpus = nCpus;
+    bool ok;
+    if (zsPtr) {
+        ok = deflateToFd(zsPtr, outFd, &header, sizeof(header), Z_NO_FLUSH);
+    } else {
+        ok = android::base::WriteFully(outFd, &header, sizeof(header));
+    }
+
+    while (ok && !g_traceAborted) {
+        int n = poll(cpuFds.data(), cpuFds.size(), 500);
+        if (n < 0 && errno != EINTR) {
+            fprintf(stderr, "error polling trace buffers: %s (%d)\n",
+                    strerror(errno), errno);
+            break;
+        }
+        if (n <= 0) {
+            continue;
+        }
+        for (size_t i = 0; ok && i < cpuFds.size() && !g_traceAborted; i++) {
+            if (!(cpuFds[i].revents & POLLIN)) {
+                continue;
+            }
+            if (useSplice) {
+                ssize_t bytes = splice(cpuFds[i].fd, nullptr, pipeFds[1],
+                        nullptr, pageSize, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if (bytes > 0) {
+                    uint32_t frame[2] = { static_cast<uint32_t>(i),
+                                          static_cast<uint32_t>(bytes) };
+                    ok = android::base::WriteFully(outFd, frame, sizeof(frame))
+                            && drainPipeToFd(pipeFds[0], outFd, bytes);
+                    continue;
+                }
+                if (bytes == -1 && (errno == EINVAL || errno == ENOSYS)) {
+                    // This kernel can't splice out of the ring buffer; copy
+                    // through userspace from here on.
+                    useSplice = false;
+                } else if (bytes == -1 && errno != EAGAIN) {
+                    fprintf(stderr, "error splicing raw trace: %s (%d)\n",
+                            strerror(errno), errno);
+                    ok = false;
+                    continue;
+                } else {
+                    continue;
+                }
+            }
+            ssize_t bytes = TEMP_FAILURE_RETRY(
+                    read(cpuFds[i].fd, readBuf.get(), pageSize));
+            if (bytes > 0) {
+                ok = writeRawStreamBlock(outFd, zsPtr, i, readBuf.get(), bytes);
+            } else if (bytes == -1 && errno != EAGAIN) {
+                fprintf(stderr, "error reading raw trace: %s (%d)\n",
+                        strerror(errno), errno);
+                ok = false;
+            }
+        }
+    }
+
+    if (zsPtr) {
+        if (ok) {
+            deflateToFd(zsPtr, outFd, nullptr, 0, Z_FINISH);
+        }
+        int result = deflateEnd(zsPtr);
+        if (result != Z_OK) {
+            fprintf(stderr, "error cleaning up zlib: %d\n", result);
+        }
+    }
+    if (pipeFds[0] != -1) {
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+    }
+    for (const auto& pfd : cpuFds) {
+        close(pfd.fd);
+    }
+}
+
 // Read the current kernel trace and write it to stdout.
 static void dumpTrace(int outFd)
 {
@@ -1076,6 +1292,12 @@ static void showHelp(const char *cmd)
                     "                    Note: this can take significant CPU time, and is best\n"
                     "                    used for measuring things that are not affected by\n"
                     "                    CPU performance, like pagecache usage.\n"
+                    "  --stream_raw    stream the raw per-CPU ring buffer pages to stdout (or\n"
+                    "                    the -o file) instead of the formatted text. The pages\n"
+                    "                    are spliced out of the kernel where possible, so the\n"
+                    "                    capture itself costs almost no CPU; decoding the\n"
+                    "                    events happens off-device. Combine with -z to\n"
+                    "                    compress the stream on the fly.\n"
                     "  --list_categories\n"
                     "                  list the available tracing categories\n"
                     " -o filename      write the trace to the specified file instead\n"
@@ -1186,6 +1408,7 @@ int main(int argc, char **argv)
     bool traceStop = true;
     bool traceDump = true;
     bool traceStream = false;
+    bool traceStreamRaw = false;
     bool onlyUserspace = false;
 
     if (argc == 2 && 0 == strcmp(argv[1], "--help")) {
@@ -1210,6 +1433,7 @@ int main(int argc, char **argv)
             {"only_userspace",    no_argument, nullptr,  0 },
             {"list_categories",   no_argument, nullptr,  0 },
             {"stream",            no_argument, nullptr,  0 },
+            {"stream_raw",        no_argument, nullptr,  0 },
             {nullptr,                       0, nullptr,  0 }
         };
 
@@ -1285,6 +1509,10 @@ int main(int argc, char **argv)
                 } else if (!strcmp(long_options[option_index].name, "stream")) {
                     traceStream = true;
                     traceDump = false;
+                } else if (!strcmp(long_options[option_index].name, "stream_raw")) {
+                    traceStream = true;
+                    traceStreamRaw = true;
+                    traceDump = false;
                 } else if (!strcmp(long_options[option_index].name, "list_categories")) {
                     listSupportedCategories();
                     exit(0);
@@ -1354,7 +1582,22 @@ int main(int argc, char **argv)
         }
 
         if (traceStream) {
-            streamTrace();
+            if (traceStreamRaw) {
+                int outFd = STDOUT_FILENO;
+                if (g_outputFile) {
+                    outFd = open(g_outputFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                }
+                if (outFd == -1) {
+                    printf("Failed to open '%s', err=%d", g_outputFile, errno);
+                } else {
+                    streamRawTrace(outFd);
+                    if (g_outputFile) {
+                        close(outFd);
+                    }
+                }
+            } else {
+                streamTrace();
+            }
         }
     }
 
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "dumpstate"
+
+#include "DumpPool.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
+
+#include "DumpstateInternal.h"
+#include "dumpstate.h"
+
+namespace android {
+namespace os {
+namespace dumpstate {
+
+const std::string DumpPool::kTempFilePrefix = "dump-tmp.";
+
+DumpPool::DumpPool(const std::string& tmp_root) : tmp_root_(tmp_root), shutdown_(false) {
+    assert(!tmp_root.empty());
+    deleteTempFiles();
+    start();
+}
+
+DumpPool::~DumpPool() {
+    shutdown();
+}
+
+void DumpPool::start(int thread_count) {
+    assert(thread_count > 0);
+    if (!threads_.empty()) {
+        return;
+    }
+    MYLOGI("Start thread pool:%d\n", thread_count);
+    shutdown_ = false;
+    for (int i = 0; i < thread_count; i++) {
+        threads_.emplace_back(std::thread([=]() { loop(); }));
+    }
+}
+
+void DumpPool::shutdown() {
+    std::unique_lock lock(lock_);
+    if (shutdown_ || threads_.empty()) {
+        return;
+    }
+    while (!tasks_.empty()) tasks_.pop();
+    futures_map_.clear();
+
+    shutdown_ = true;
+    condition_variable_.notify_all();
+    lock.unlock();
+
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+    deleteTempFiles();
+    MYLOGI("Shutdown thread pool\n");
+}
+
+void DumpPool::enqueueTaskWithFd(const std::string& task_name, std::function<void(int)> task) {
+    std::packaged_task<std::string()> packaged_task([=]() {
+        std::string path = android::base::StringPrintf("%s/%sXXXXXX", tmp_root_.c_str(),
+                                                       kTempFilePrefix.c_str());
+        android::base::unique_fd fd(TEMP_FAILURE_RETRY(mkostemp(path.data(), O_CLOEXEC)));
+        if (fd.get() < 0) {
+            MYLOGE("Failed to create temporary file for task '%s': %s\n", task_name.c_str(),
+                   strerror(errno));
+            return std::string("");
+        }
+        fchmod(fd.get(), S_IRUSR | S_IWUSR);
+        std::invoke(task, fd.get());
+        return path;
+    });
+    std::unique_lock lock(lock_);
+    futures_map_[task_name] = packaged_task.get_future().share();
+    tasks_.push(std::move(packaged_task));
+    condition_variable_.notify_one();
+}
+
+void DumpPool::waitForTask(const std::string& task_name, int out_fd) {
+    std::unique_lock lock(lock_);
+    auto iterator = futures_map_.find(task_name);
+    if (iterator == futures_map_.end()) {
+        return;
+    }
+    Future future = iterator->second;
+    futures_map_.erase(iterator);
+    lock.unlock();
+
+    DurationReporter duration_reporter("Wait for task: " + task_name, /*logcat_only=*/true);
+    std::string temp_file_path = future.get();
+    if (temp_file_path.empty()) {
+        return;
+    }
+    android::base::unique_fd fd(TEMP_FAILURE_RETRY(
+            open(temp_file_path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW)));
+    if (fd.get() < 0) {
+        MYLOGE("Failed to open temporary file of task '%s': %s\n", task_name.c_str(),
+               strerror(errno));
+        return;
+    }
+    char buffer[65536];
+    ssize_t bytes_read;
+    while ((bytes_read = TEMP_FAILURE_RETRY(read(fd.get(), buffer, sizeof(buffer)))) > 0) {
+        if (!android::base::WriteFully(out_fd, buffer, bytes_read)) {
+            MYLOGE("Failed to write output of task '%s': %s\n", task_name.c_str(),
+                   strerror(errno));
+            break;
+        }
+    }
+    unlink(temp_file_path.c_str());
+}
+
+void DumpPool::deleteTempFiles() {
+    std::unique_ptr<DIR, decltype(&closedir)> dir_ptr(opendir(tmp_root_.c_str()), closedir);
+    if (!dir_ptr) {
+        MYLOGE("Failed to opendir (%s): %s\n", tmp_root_.c_str(), strerror(errno));
+        return;
+    }
+    struct dirent* de;
+    while ((de = readdir(dir_ptr.get()))) {
+        if (de->d_type != DT_REG ||
+            strncmp(de->d_name, kTempFilePrefix.c_str(), kTempFilePrefix.length()) != 0) {
+            continue;
+        }
+        std::string file_path = tmp_root_ + "/" + de->d_name;
+        if (unlink(file_path.c_str()) != 0) {
+            MYLOGE("Failed to unlink (%s): %s\n", file_path.c_str(), strerror(errno));
+        }
+    }
+}
+
+void DumpPool::loop() {
+    std::unique_lock lock(lock_);
+    while (!shutdown_) {
+        if (tasks_.empty()) {
+            condition_variable_.wait(lock);
+            continue;
+        }
+        std::packaged_task<std::string()> task = std::move(tasks_.front());
+        tasks_.pop();
+        lock.unlock();
+        std::invoke(task);
+        lock.lock();
+    }
+}
+
+}  // namespace dumpstate
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
+#define FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace os {
+namespace dumpstate {
+
+class DumpPoolTest;
+
+/*
+ * A thread pool that runs bugreport sections in parallel with the main
+ * report generation.
+ *
+ * Each task writes its output to a private temporary file under |tmp_root|,
+ * so tasks never interleave their output. The caller later invokes
+ * waitForTask() at the point where the section belongs in the report; it
+ * blocks until the task has finished, then streams the temporary file into
+ * the report and removes it. This keeps the section order of the report
+ * identical to a sequential run while the actual collection overlaps.
+ *
+ * Typical usage:
+ *
+ *   DumpPool pool(tmp_root);
+ *   pool.enqueueTaskWithFd("DUMP FOO", &DumpFoo);
+ *   ...
+ *   pool.waitForTask("DUMP FOO", STDOUT_FILENO);
+ */
+class DumpPool {
+    friend class android::os::dumpstate::DumpPoolTest;
+
+  public:
+    /*
+     * Creates the pool and starts its worker threads. |tmp_root| is an
+     * existing directory where the temporary files of the tasks are created;
+     * stale temporary files from a previous run are removed.
+     */
+    explicit DumpPool(const std::string& tmp_root);
+    ~DumpPool();
+
+    /*
+     * Starts |thread_count| worker threads. Does nothing if the pool is
+     * already running.
+     */
+    void start(int thread_count = kDefaultThreadCount);
+
+    /*
+     * Requests shutdown, drops tasks that have not started yet, joins the
+     * worker threads and removes any remaining temporary files.
+     */
+    void shutdown();
+
+    /*
+     * Enqueues a task to run on the pool. The task is invoked with the file
+     * descriptor of its private temporary file, to which it must write all
+     * of its output.
+     *
+     * |task_name| name later passed to waitForTask(); must be unique among
+     * the enqueued tasks.
+     * |task| the task to run.
+     */
+    void enqueueTaskWithFd(const std::string& task_name, std::function<void(int)> task);
+
+    /*
+     * Waits until the named task has finished, then writes its output to
+     * |out_fd| and removes the temporary file. Does nothing if no task with
+     * that name was enqueued.
+     */
+    void waitForTask(const std::string& task_name, int out_fd);
+
+    /* Removes the temporary files owned by the pool from |tmp_root|. */
+    void deleteTempFiles();
+
+    static const int kDefaultThreadCount = 4;
+
+  private:
+    using Future = std::shared_future<std::string>;
+
+    /* Worker thread body; runs tasks from the queue until shutdown. */
+    void loop();
+
+  private:
+    /* File name prefix of the temporary files, used to find stale ones. */
+    static const std::string kTempFilePrefix;
+
+    std::string tmp_root_;
+    bool shutdown_;
+    std::mutex lock_;  // A lock for the tasks_.
+    std::condition_variable condition_variable_;
+
+    std::vector<std::thread> threads_;
+    std::queue<std::packaged_task<std::string()>> tasks_;
+    std::map<std::string, Future> futures_map_;
+
+    DISALLOW_COPY_AND_ASSIGN(DumpPool);
+};
+
+}  // namespace dumpstate
+}  // namespace os
+}  // namespace android
+
+#endif //FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
@@ -176,10 +176,20 @@ class PropertiesHelper {
      */
     static bool IsUnroot();
 
+    /*
+     * Checks whether slow bugreport sections should be collected on a thread
+     * pool, in parallel with the rest of the report.
+     *
+     * The parallel run is enabled by default; it can be disabled by setting
+     * the system property `dumpstate.parallel_run` to false.
+     */
+    static bool IsParallelRun();
+
   private:
     static std::string build_type_;
     static int dry_run_;
     static int unroot_;
+    static int parallel_run_;
 };
 
 /*
@@ -59,6 +59,7 @@
 #include <android-base/file.h>
 #include <android-base/properties.h>
 #include <android-base/scopeguard.h>
+#include <android-base/parseint.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 #include <android-base/unique_fd.h>
@@ -197,6 +198,13 @@ static const std::string ANR_FILE_PREFIX = "anr_";
 
 static const char* WAKE_LOCK_NAME = "dumpstate_wakelock";
 
+// Names of the sections that can run on the dump pool, in parallel with the
+// rest of the report.
+static const std::string DUMP_CPU_INFO_TASK = "CPU INFO";
+static const std::string DUMP_PROCESSES_AND_THREADS_TASK = "PROCESSES AND THREADS";
+static const std::string DUMP_HALS_TASK = "DUMP HALS";
+static const std::string DUMP_LSOF_TASK = "LIST OF OPEN FILES";
+
 namespace android {
 namespace os {
 namespace {
@@ -865,6 +873,128 @@ bool Dumpstate::AddZipEntry(const std::string& entry_name, const std::string& en
     return (AddZipEntryFromFd(entry_name, fd.get()) == OK);
 }
 
+void Dumpstate::DeferAddZipEntry(const std::string& entry_name, const std::string& entry_path) {
+    std::lock_guard<std::mutex> lock(deferred_zip_entries_lock_);
+    deferred_zip_entries_.emplace_back(entry_name, entry_path);
+}
+
+void Dumpstate::AddDeferredZipEntries() {
+    std::vector<std::pair<std::string, std::string>> entries;
+    {
+        std::lock_guard<std::mutex> lock(deferred_zip_entries_lock_);
+        entries.swap(deferred_zip_entries_);
+    }
+    for (const auto& entry : entries) {
+        AddZipEntry(entry.first, entry.second);
+        unlink(entry.second.c_str());
+    }
+}
+
+void Dumpstate::ShutdownDumpPool() {
+    if (dump_pool_) {
+        dump_pool_->shutdown();
+        dump_pool_ = nullptr;
+    }
+    // Remove the files of any entry that was deferred but never added; its
+    // task was cancelled or the run is bailing out early.
+    std::lock_guard<std::mutex> lock(deferred_zip_entries_lock_);
+    for (const auto& entry : deferred_zip_entries_) {
+        unlink(entry.second.c_str());
+    }
+    deferred_zip_entries_.clear();
+}
+
+// Mixes the stat identity of a fingerprint source file into an FNV-1a hash.
+// Sections eligible for incremental skipping derive their content from files,
+// so mtime/size changes are a faithful (and cheap) proxy for content changes.
+static bool MixFileFingerprint(const std::string& path, uint64_t* fingerprint) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+    const uint64_t values[] = {static_cast<uint64_t>(st.st_mtim.tv_sec),
+                               static_cast<uint64_t>(st.st_mtim.tv_nsec),
+                               static_cast<uint64_t>(st.st_size)};
+    for (char c : path) {
+        *fingerprint = (*fingerprint ^ static_cast<uint8_t>(c)) * 0x100000001b3ULL;
+    }
+    for (uint64_t value : values) {
+        for (size_t i = 0; i < sizeof(value); i++) {
+            *fingerprint = (*fingerprint ^ ((value >> (8 * i)) & 0xffu)) * 0x100000001b3ULL;
+        }
+    }
+    return true;
+}
+
+void Dumpstate::RunIncremental(const std::string& title,
+                               const std::vector<std::string>& fingerprint_paths,
+                               const std::function<void()>& section) {
+    if (!options_->do_incremental) {
+        section();
+        return;
+    }
+
+    uint64_t fingerprint = 0xcbf29ce484222325ULL;  // FNV-1a offset basis.
+    bool valid = !fingerprint_paths.empty();
+    for (const auto& path : fingerprint_paths) {
+        if (!MixFileFingerprint(path, &fingerprint)) {
+            // A missing source means we can't prove the section is unchanged;
+            // collect it as usual.
+            valid = false;
+            break;
+        }
+    }
+
+    const auto it = incremental_fingerprints_.find(title);
+    if (valid && it != incremental_fingerprints_.end() && it->second == fingerprint) {
+        dprintf(STDOUT_FILENO, "------ %s ------\n", title.c_str());
+        dprintf(STDOUT_FILENO,
+                "*** SECTION UNCHANGED (incremental mode, fingerprint %016" PRIx64
+                "); content elided, splice from a previous report ***\n\n",
+                fingerprint);
+        MYLOGD("Skipped unchanged section %s in incremental mode\n", title.c_str());
+        return;
+    }
+
+    section();
+    if (valid) {
+        incremental_fingerprints_[title] = fingerprint;
+    }
+}
+
+void Dumpstate::LoadIncrementalState() {
+    incremental_fingerprints_.clear();
+    std::string state;
+    if (!android::base::ReadFileToString(bugreport_internal_dir_ + "/incremental-state.txt",
+                                         &state)) {
+        MYLOGI("No incremental state found; collecting all sections\n");
+        return;
+    }
+    for (const auto& line : android::base::Split(state, "\n")) {
+        const size_t separator = line.rfind(' ');
+        if (separator == std::string::npos) {
+            continue;
+        }
+        uint64_t fingerprint;
+        if (android::base::ParseUint(line.substr(separator + 1), &fingerprint)) {
+            incremental_fingerprints_[line.substr(0, separator)] = fingerprint;
+        }
+    }
+    MYLOGI("Loaded %zu section fingerprints for incremental mode\n",
+           incremental_fingerprints_.size());
+}
+
+void Dumpstate::SaveIncrementalState() {
+    std::string state;
+    for (const auto& [title, fingerprint] : incremental_fingerprints_) {
+        android::base::StringAppendF(&state, "%s %" PRIu64 "\n", title.c_str(), fingerprint);
+    }
+    if (!android::base::WriteStringToFile(state,
+                                          bugreport_internal_dir_ + "/incremental-state.txt")) {
+        MYLOGE("Failed to save incremental state: %s\n", strerror(errno));
+    }
+}
+
 /* adds a file to the existing zipped bugreport */
 static int _add_file_from_fd(const char* title __attribute__((unused)), const char* path, int fd) {
     return (ds.AddZipEntryFromFd(ZIP_ROOT_DIR + path, fd) == OK) ? 0 : 1;
@@ -1163,7 +1293,12 @@ static Dumpstate::RunStatus RunDumpsysTextByPriority(const std::string& title, i
         std::string path(title);
         path.append(" - ").append(String8(service).c_str());
         size_t bytes_written = 0;
-        status_t status = dumpsys.startDumpThread(Dumpsys::Type::DUMP, service, args);
+        // Output lands in the (file-backed) bugreport, so let the service write into
+        // shared memory and splice the result over instead of relaying it through a
+        // pipe; services with tens of MB of dump output (e.g. surfaceflinger layer
+        // traces) are copied once less.
+        status_t status = dumpsys.startDumpThread(Dumpsys::Type::DUMP, service, args,
+                                                  Dumpsys::Transport::SHM);
         if (status == OK) {
             dumpsys.writeDumpHeader(STDOUT_FILENO, service, priority);
             std::chrono::duration<double> elapsed_seconds;
@@ -1290,15 +1425,39 @@ static Dumpstate::RunStatus RunDumpsysNormal() {
                            /* timeout= */ 90s, /* service_timeout= */ 10s);
 }
 
-static void DumpHals() {
+// The following functions are the sections that can run on the dump pool;
+// they write everything to |out_fd| rather than stdout so their output lands
+// in the private temporary file of their task when they run on a pool thread.
+
+static void DumpCpuInfo(int out_fd = STDOUT_FILENO) {
+    RunCommandToFd(out_fd, "CPU INFO",
+                   {"top", "-b", "-n", "1", "-H", "-s", "6", "-o",
+                    "pid,tid,user,pr,ni,%cpu,s,virt,res,pcy,cmd,name"},
+                   CommandOptions::DEFAULT);
+}
+
+static void DumpProcessesAndThreads(int out_fd = STDOUT_FILENO) {
+    RunCommandToFd(out_fd, "PROCESSES AND THREADS",
+                   {"ps", "-A", "-T", "-Z", "-O", "pri,nice,rtprio,sched,pcy,time"},
+                   CommandOptions::DEFAULT);
+}
+
+static void DumpLsof(int out_fd = STDOUT_FILENO) {
+    RunCommandToFd(out_fd, "LIST OF OPEN FILES", {"lsof"}, CommandOptions::AS_ROOT);
+}
+
+static void DumpHals(int out_fd = STDOUT_FILENO) {
     if (!ds.IsZipping()) {
-        RunCommand("HARDWARE HALS", {"lshal", "-lVSietrpc", "--types=b,c,l,z", "--debug"},
-                   CommandOptions::WithTimeout(10).AsRootIfAvailable().Build());
+        RunCommandToFd(out_fd, "HARDWARE HALS",
+                       {"lshal", "-lVSietrpc", "--types=b,c,l,z", "--debug"},
+                       CommandOptions::WithTimeout(10).AsRootIfAvailable().Build());
         return;
     }
-    DurationReporter duration_reporter("DUMP HALS");
-    RunCommand("HARDWARE HALS", {"lshal", "-lVSietrpc", "--types=b,c,l,z"},
-               CommandOptions::WithTimeout(10).AsRootIfAvailable().Build());
+    // Duration is logged to logcat only, since on a pool thread stdout does
+    // not point at the report.
+    DurationReporter duration_reporter("DUMP HALS", true);
+    RunCommandToFd(out_fd, "HARDWARE HALS", {"lshal", "-lVSietrpc", "--types=b,c,l,z"},
+                   CommandOptions::WithTimeout(10).AsRootIfAvailable().Build());
 
     using android::hidl::manager::V1_0::IServiceManager;
     using android::hardware::defaultServiceManager;
@@ -1336,11 +1495,14 @@ static void DumpHals() {
 
                 bool empty = 0 == lseek(fd, 0, SEEK_END);
                 if (!empty) {
-                    ds.AddZipEntry("lshal-debug/" + cleanName + ".txt", path);
+                    // The zip writer may only be used from the main thread, so
+                    // defer the entry; AddDeferredZipEntries() removes the file
+                    // once the entry has been added.
+                    ds.DeferAddZipEntry("lshal-debug/" + cleanName + ".txt", path);
+                } else {
+                    unlink(path.c_str());
                 }
             }
-
-            unlink(path.c_str());
         }
     });
 
@@ -1435,6 +1597,25 @@ static void DumpstateLimitedOnly() {
 static Dumpstate::RunStatus dumpstate() {
     DurationReporter duration_reporter("DUMPSTATE");
 
+    // Enqueue slow, independent sections on the dump pool so their collection
+    // overlaps with the rest of the report. Each section writes to a private
+    // temporary file and is merged back at its original position, so the
+    // report layout is identical to a sequential run.
+    if (ds.options_->OutputToFile() && PropertiesHelper::IsParallelRun()) {
+        ds.dump_pool_ = std::make_unique<android::os::dumpstate::DumpPool>(
+                ds.bugreport_internal_dir_);
+    }
+    // Shut the pool down on every exit path, including the early returns of
+    // the consent checks below.
+    auto shutdown_dump_pool = android::base::make_scope_guard([]() { ds.ShutdownDumpPool(); });
+    if (ds.dump_pool_) {
+        ds.dump_pool_->enqueueTaskWithFd(DUMP_CPU_INFO_TASK, &DumpCpuInfo);
+        ds.dump_pool_->enqueueTaskWithFd(DUMP_PROCESSES_AND_THREADS_TASK,
+                                         &DumpProcessesAndThreads);
+        ds.dump_pool_->enqueueTaskWithFd(DUMP_HALS_TASK, &DumpHals);
+        ds.dump_pool_->enqueueTaskWithFd(DUMP_LSOF_TASK, &DumpLsof);
+    }
+
     // Dump various things. Note that anything that takes "long" (i.e. several seconds) should
     // check intermittently (if it's intrerruptable like a foreach on pids) and/or should be wrapped
     // in a consent check (via RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK).
@@ -1442,8 +1623,11 @@ static Dumpstate::RunStatus dumpstate() {
     RunCommand("UPTIME", {"uptime"});
     DumpBlockStatFiles();
     DumpFile("MEMORY INFO", "/proc/meminfo");
-    RunCommand("CPU INFO", {"top", "-b", "-n", "1", "-H", "-s", "6", "-o",
-                            "pid,tid,user,pr,ni,%cpu,s,virt,res,pcy,cmd,name"});
+    if (ds.dump_pool_) {
+        ds.dump_pool_->waitForTask(DUMP_CPU_INFO_TASK, STDOUT_FILENO);
+    } else {
+        DumpCpuInfo();
+    }
 
     RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK(RunCommand, "PROCRANK", {"procrank"}, AS_ROOT_20);
 
@@ -1460,13 +1644,23 @@ static Dumpstate::RunStatus dumpstate() {
     DumpFile("KERNEL WAKE SOURCES", "/d/wakeup_sources");
     DumpFile("KERNEL CPUFREQ", "/sys/devices/system/cpu/cpu0/cpufreq/stats/time_in_state");
 
-    RunCommand("PROCESSES AND THREADS",
-               {"ps", "-A", "-T", "-Z", "-O", "pri,nice,rtprio,sched,pcy,time"});
+    if (ds.dump_pool_) {
+        ds.dump_pool_->waitForTask(DUMP_PROCESSES_AND_THREADS_TASK, STDOUT_FILENO);
+    } else {
+        DumpProcessesAndThreads();
+    }
 
     RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK(RunCommand, "LIBRANK", {"librank"},
                                          CommandOptions::AS_ROOT);
 
-    DumpHals();
+    if (ds.dump_pool_) {
+        ds.dump_pool_->waitForTask(DUMP_HALS_TASK, STDOUT_FILENO);
+    } else {
+        DumpHals();
+    }
+    // The lshal-debug entries were deferred by DumpHals; add them now that the
+    // task has finished and the main thread owns the zip writer again.
+    ds.AddDeferredZipEntries();
 
     RunCommand("PRINTENV", {"printenv"});
     RunCommand("NETSTAT", {"netstat", "-nW"});
@@ -1484,7 +1678,11 @@ static Dumpstate::RunStatus dumpstate() {
         do_dmesg();
     }
 
-    RunCommand("LIST OF OPEN FILES", {"lsof"}, CommandOptions::AS_ROOT);
+    if (ds.dump_pool_) {
+        ds.dump_pool_->waitForTask(DUMP_LSOF_TASK, STDOUT_FILENO);
+    } else {
+        DumpLsof();
+    }
 
     RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK(for_each_pid, do_showmap, "SMAPS OF ALL PROCESSES");
 
@@ -1525,7 +1723,12 @@ static Dumpstate::RunStatus dumpstate() {
 
     RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK(RunDumpsysHigh);
 
-    RunCommand("SYSTEM PROPERTIES", {"getprop"});
+    // The property dump is dominated by build/vendor configuration; in
+    // incremental mode it is elided while the build is unchanged, at the cost
+    // of also eliding the volatile properties until the next full collection.
+    ds.RunIncremental("SYSTEM PROPERTIES",
+                      {"/system/build.prop", "/vendor/build.prop", "/product/build.prop"},
+                      [] { RunCommand("SYSTEM PROPERTIES", {"getprop"}); });
 
     RunCommand("STORAGED IO INFO", {"storaged", "-u", "-p"});
 
@@ -1581,7 +1784,8 @@ static Dumpstate::RunStatus dumpstate() {
     RunDumpsys("CHECKIN NETSTATS", {"netstats", "--checkin"});
     RunDumpsys("CHECKIN PROCSTATS", {"procstats", "-c"});
     RunDumpsys("CHECKIN USAGESTATS", {"usagestats", "-c"});
-    RunDumpsys("CHECKIN PACKAGE", {"package", "--checkin"});
+    ds.RunIncremental("CHECKIN PACKAGE", {"/data/system/packages.xml"},
+                      [] { RunDumpsys("CHECKIN PACKAGE", {"package", "--checkin"}); });
 
     printf("========================================================\n");
     printf("== Running Application Activities\n");
@@ -1745,6 +1949,7 @@ static void DumpstateRadioCommon(bool include_sensitive_info = true) {
         DoKmsg();
         // Contains unrelated hardware info (camera, NFC, biometrics, ...).
         DumpHals();
+        ds.AddDeferredZipEntries();
     }
 
     DumpPacketStats();
@@ -2129,6 +2334,8 @@ static void ShowUsage() {
             "  -R: take bugreport in remote mode (requires -z and -d, shouldn't be used with -P)\n"
             "  -w: start binder service and make it wait for a call to startBugreport\n"
             "  -L: output limited information that is safe for submission in feedback reports\n"
+            "  -i: incremental mode; skip sections whose sources are unchanged since the last -i "
+            "run, emitting an 'unchanged' marker instead (for periodic monitoring reports)\n"
             "  -v: prints the dumpstate header and exit\n");
 }
 
@@ -2381,12 +2588,13 @@ static void LogDumpOptions(const Dumpstate::DumpOptions& options) {
         "do_zip_file: %d do_vibrate: %d use_socket: %d use_control_socket: %d do_screenshot: %d "
         "is_remote_mode: %d show_header_only: %d do_start_service: %d telephony_only: %d "
         "wifi_only: %d do_progress_updates: %d fd: %d bugreport_mode: %s dumpstate_hal_mode: %s "
-        "limited_only: %d args: %s\n",
+        "limited_only: %d do_incremental: %d args: %s\n",
         options.do_zip_file, options.do_vibrate, options.use_socket, options.use_control_socket,
         options.do_screenshot, options.is_remote_mode, options.show_header_only,
         options.do_start_service, options.telephony_only, options.wifi_only,
         options.do_progress_updates, options.bugreport_fd.get(), options.bugreport_mode.c_str(),
-        toString(options.dumpstate_hal_mode).c_str(), options.limited_only, options.args.c_str());
+        toString(options.dumpstate_hal_mode).c_str(), options.limited_only,
+        options.do_incremental, options.args.c_str());
 }
 
 void Dumpstate::DumpOptions::Initialize(BugreportMode bugreport_mode,
@@ -2408,7 +2616,7 @@ void Dumpstate::DumpOptions::Initialize(BugreportMode bugreport_mode,
 Dumpstate::RunStatus Dumpstate::DumpOptions::Initialize(int argc, char* argv[]) {
     RunStatus status = RunStatus::OK;
     int c;
-    while ((c = getopt(argc, argv, "dho:svqzpLPBRSV:w")) != -1) {
+    while ((c = getopt(argc, argv, "dho:svqzpiLPBRSV:w")) != -1) {
         switch (c) {
             // clang-format off
             case 'd': do_add_date = true;            break;
@@ -2422,6 +2630,7 @@ Dumpstate::RunStatus Dumpstate::DumpOptions::Initialize(int argc, char* argv[])
             case 'P': do_progress_updates = true;    break;
             case 'R': is_remote_mode = true;         break;
             case 'L': limited_only = true;           break;
+            case 'i': do_incremental = true;         break;
             case 'V':                                break;  // compatibility no-op
             case 'w':
                 // This was already processed
@@ -2572,6 +2781,10 @@ Dumpstate::RunStatus Dumpstate::RunInternal(int32_t calling_uid,
         return RunStatus::INVALID_INPUT;
     }
 
+    if (options_->do_incremental) {
+        LoadIncrementalState();
+    }
+
     if (options_->show_header_only) {
         PrintHeader();
         return RunStatus::OK;
@@ -2752,6 +2965,12 @@ Dumpstate::RunStatus Dumpstate::RunInternal(int32_t calling_uid,
         FinalizeFile();
     }
 
+    // Persist the section fingerprints only after the report was fully
+    // assembled, so a failed run keeps collecting those sections next time.
+    if (options_->do_incremental) {
+        SaveIncrementalState();
+    }
+
     // Share the final file with the caller if the user has consented or Shell is the caller.
     Dumpstate::RunStatus status = Dumpstate::RunStatus::OK;
     if (CalledByApi()) {
@@ -22,6 +22,8 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include <functional>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -34,6 +36,7 @@
 #include <utils/StrongPointer.h>
 #include <ziparchive/zip_writer.h>
 
+#include "DumpPool.h"
 #include "DumpstateUtil.h"
 
 // Workaround for const char *args[MAX_ARGS_ARRAY_SIZE] variables until they're converted to
@@ -284,6 +287,39 @@ class Dumpstate {
      */
     void AddDir(const std::string& dir, bool recursive);
 
+    /*
+     * Records a zip entry to be added by AddDeferredZipEntries(). Sections
+     * running on the dump pool must use this instead of AddZipEntry, since
+     * the zip writer may only be used from the main thread.
+     */
+    void DeferAddZipEntry(const std::string& entry_name, const std::string& entry_path);
+
+    /*
+     * Adds the zip entries recorded by DeferAddZipEntry and removes their
+     * backing files. Must be called on the main thread, after the tasks that
+     * deferred them have finished.
+     */
+    void AddDeferredZipEntries();
+
+    /* Shuts down the dump pool, if one is running. */
+    void ShutdownDumpPool();
+
+    /*
+     * Runs |section| unless incremental mode (-i) is enabled and none of
+     * |fingerprint_paths| changed since the previous incremental report, in
+     * which case only an "unchanged" marker carrying the fingerprint is
+     * emitted so the section can be spliced in from an earlier report
+     * server-side. Fingerprints are stat-based (mtime/size), so the paths
+     * must be the files the section's content is derived from.
+     */
+    void RunIncremental(const std::string& title,
+                        const std::vector<std::string>& fingerprint_paths,
+                        const std::function<void()>& section);
+
+    /* Loads/saves the per-section fingerprints backing incremental mode. */
+    void LoadIncrementalState();
+    void SaveIncrementalState();
+
     /*
      * Takes a screenshot and save it to the given `path`.
      *
@@ -379,6 +415,9 @@ class Dumpstate {
         bool wifi_only = false;
         // Trimmed-down version of dumpstate to only include whitelisted logs.
         bool limited_only = false;
+        // Skips sections whose fingerprints are unchanged since the previous
+        // incremental run; used for periodic fleet monitoring reports.
+        bool do_incremental = false;
         // Whether progress updates should be published.
         bool do_progress_updates = false;
         // The mode we'll use when calling IDumpstateDevice::dumpstateBoard.
@@ -481,6 +520,21 @@ class Dumpstate {
     // Pointer to the zip structure.
     std::unique_ptr<ZipWriter> zip_writer_;
 
+    // Pool used to run slow sections in parallel with the rest of the report;
+    // only set while the default bugreport flow runs with the parallel run
+    // enabled.
+    std::unique_ptr<android::os::dumpstate::DumpPool> dump_pool_;
+
+    // Zip entries whose files are produced on the dump pool; the zip writer
+    // is not thread-safe, so they are recorded here as (entry name, file
+    // path) pairs and added by the main thread.
+    std::mutex deferred_zip_entries_lock_;
+    std::vector<std::pair<std::string, std::string>> deferred_zip_entries_;
+
+    // Section fingerprints from the previous incremental run, keyed by
+    // section title; updated in place and persisted by SaveIncrementalState().
+    std::map<std::string, uint64_t> incremental_fingerprints_;
+
     // Binder object listening to progress.
     android::sp<android::os::IDumpstateListener> listener_;
 
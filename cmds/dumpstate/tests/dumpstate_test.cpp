@@ -25,11 +25,13 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <dirent.h>
 #include <fcntl.h>
 #include <libgen.h>
 #include <signal.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <memory>
 #include <thread>
 
 #include <android-base/file.h>
@@ -377,6 +379,34 @@ TEST_F(DumpOptionsTest, InitializeLimitedOnlyBugreport) {
     EXPECT_EQ(options_.dumpstate_hal_mode, DumpstateMode::DEFAULT);
 }
 
+TEST_F(DumpOptionsTest, InitializeIncrementalBugreport) {
+    // clang-format off
+    char* argv[] = {
+        const_cast<char*>("dumpstate"),
+        const_cast<char*>("-d"),
+        const_cast<char*>("-z"),
+        const_cast<char*>("-i"),
+    };
+    // clang-format on
+
+    Dumpstate::RunStatus status = options_.Initialize(ARRAY_SIZE(argv), argv);
+
+    EXPECT_EQ(status, Dumpstate::RunStatus::OK);
+    EXPECT_TRUE(options_.do_add_date);
+    EXPECT_TRUE(options_.do_zip_file);
+    EXPECT_TRUE(options_.do_incremental);
+
+    // Other options retain default values
+    EXPECT_TRUE(options_.do_vibrate);
+    EXPECT_FALSE(options_.show_header_only);
+    EXPECT_FALSE(options_.do_screenshot);
+    EXPECT_FALSE(options_.do_progress_updates);
+    EXPECT_FALSE(options_.is_remote_mode);
+    EXPECT_FALSE(options_.use_socket);
+    EXPECT_FALSE(options_.limited_only);
+    EXPECT_EQ(options_.dumpstate_hal_mode, DumpstateMode::DEFAULT);
+}
+
 TEST_F(DumpOptionsTest, InitializeDefaultBugReport) {
     // default: commandline options are not overridden
     // clang-format off
@@ -1618,6 +1648,75 @@ TEST_F(DumpstateUtilTest, DumpFileOnDryRun) {
     EXPECT_THAT(out, EndsWith("skipped on dry run\n"));
 }
 
+class DumpPoolTest : public DumpstateBaseTest {
+  public:
+    void SetUp() {
+        DumpstateBaseTest::SetUp();
+        dump_pool_ = std::make_unique<DumpPool>(tmp_root_.path);
+    }
+
+    // Counts the temporary files the pool has left in its tmp root.
+    int GetTempFileCounts() {
+        int count = 0;
+        std::unique_ptr<DIR, decltype(&closedir)> dir_ptr(opendir(tmp_root_.path), closedir);
+        if (!dir_ptr) {
+            return -1;
+        }
+        for (struct dirent* de = readdir(dir_ptr.get()); de; de = readdir(dir_ptr.get())) {
+            if (de->d_type != DT_REG ||
+                !android::base::StartsWith(de->d_name, DumpPool::kTempFilePrefix)) {
+                continue;
+            }
+            count++;
+        }
+        return count;
+    }
+
+    TemporaryDir tmp_root_;
+    std::unique_ptr<DumpPool> dump_pool_;
+};
+
+TEST_F(DumpPoolTest, EnqueueTaskWithFd) {
+    dump_pool_->enqueueTaskWithFd("task1", [](int fd) { dprintf(fd, "1"); });
+    dump_pool_->enqueueTaskWithFd("task2", [](int fd) { dprintf(fd, "2"); });
+    dump_pool_->enqueueTaskWithFd("task3", [](int fd) { dprintf(fd, "3"); });
+
+    TemporaryFile out_file;
+    dump_pool_->waitForTask("task1", out_file.fd);
+    dump_pool_->waitForTask("task2", out_file.fd);
+    dump_pool_->waitForTask("task3", out_file.fd);
+
+    std::string out;
+    ReadFileToString(out_file.path, &out);
+    // The merge happens in waitForTask order, no matter in which order the
+    // tasks finished.
+    EXPECT_THAT(out, StrEq("123"));
+    EXPECT_EQ(0, GetTempFileCounts());
+}
+
+TEST_F(DumpPoolTest, WaitForTaskWithUnknownName) {
+    TemporaryFile out_file;
+    // Waiting for a task that was never enqueued does nothing.
+    dump_pool_->waitForTask("no_such_task", out_file.fd);
+
+    std::string out;
+    ReadFileToString(out_file.path, &out);
+    EXPECT_THAT(out, IsEmpty());
+}
+
+TEST_F(DumpPoolTest, Shutdown_withoutCrash) {
+    bool run_1 = false;
+    dump_pool_->enqueueTaskWithFd("task1", [&](int) { run_1 = true; });
+    dump_pool_->enqueueTaskWithFd("task2", [](int) { sleep(1); });
+
+    dump_pool_->waitForTask("task1", STDOUT_FILENO);
+    dump_pool_->shutdown();
+
+    EXPECT_TRUE(run_1);
+    EXPECT_EQ(0, GetTempFileCounts());
+    EXPECT_TRUE(dump_pool_->threads_.empty());
+}
+
 }  // namespace dumpstate
 }  // namespace os
 }  // namespace android
@@ -16,8 +16,12 @@
 
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <iomanip>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/stringprintf.h>
@@ -35,7 +39,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/poll.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -60,17 +66,25 @@ static void usage() {
             "usage: dumpsys\n"
             "         To dump all services.\n"
             "or:\n"
-            "       dumpsys [-t TIMEOUT] [--priority LEVEL] [--pid] [--help | -l | --skip SERVICES "
-            "| SERVICE [ARGS]]\n"
+            "       dumpsys [-t TIMEOUT] [--priority LEVEL] [--concurrent N] [--pid] [--help | -l "
+            "| --skip SERVICES | SERVICE [ARGS]]\n"
             "         --help: shows this help\n"
             "         -l: only list services, do not dump them\n"
             "         -t TIMEOUT_SEC: TIMEOUT to use in seconds instead of default 10 seconds\n"
             "         -T TIMEOUT_MS: TIMEOUT to use in milliseconds instead of default 10 seconds\n"
+            "         --concurrent N: dumps up to N services in parallel; each service's output\n"
+            "               is emitted once its dump completes, and TIMEOUT becomes a global\n"
+            "               budget shared by all dumps instead of a per-service timeout.\n"
+            "               Ignored when dumping a single service or with --proto\n"
             "         --pid: dump PID instead of usual dump\n"
             "         --proto: filter services that support dumping data in proto format. Dumps\n"
             "               will be in proto format.\n"
             "         --priority LEVEL: filter services based on specified priority\n"
             "               LEVEL must be one of CRITICAL | HIGH | NORMAL\n"
+            "         --shm: services write their dump into a shared-memory file instead of\n"
+            "               streaming it through a pipe; output is emitted in bulk once each\n"
+            "               dump completes. Intended for file-backed output (e.g. bugreports)\n"
+            "               where very large dumps would otherwise be copied twice\n"
             "         --skip SERVICES: dumps all services but SERVICES (comma-separated list)\n"
             "         SERVICE [ARGS]: dumps only service SERVICE, optionally passing ARGS to it\n");
 }
@@ -123,11 +137,15 @@ int Dumpsys::main(int argc, char* const argv[]) {
     bool skipServices = false;
     bool asProto = false;
     Type type = Type::DUMP;
+    Transport transport = Transport::PIPE;
     int timeoutArgMs = 10000;
+    int concurrentDumps = 1;
     int priorityFlags = IServiceManager::DUMP_FLAG_PRIORITY_ALL;
     static struct option longOptions[] = {{"pid", no_argument, 0, 0},
                                           {"priority", required_argument, 0, 0},
+                                          {"concurrent", required_argument, 0, 0},
                                           {"proto", no_argument, 0, 0},
+                                          {"shm", no_argument, 0, 0},
                                           {"skip", no_argument, 0, 0},
                                           {"help", no_argument, 0, 0},
                                           {0, 0, 0, 0}};
@@ -151,6 +169,8 @@ int Dumpsys::main(int argc, char* const argv[]) {
                 skipServices = true;
             } else if (!strcmp(longOptions[optionIndex].name, "proto")) {
                 asProto = true;
+            } else if (!strcmp(longOptions[optionIndex].name, "shm")) {
+                transport = Transport::SHM;
             } else if (!strcmp(longOptions[optionIndex].name, "help")) {
                 usage();
                 return 0;
@@ -161,6 +181,13 @@ int Dumpsys::main(int argc, char* const argv[]) {
                     usage();
                     return -1;
                 }
+            } else if (!strcmp(longOptions[optionIndex].name, "concurrent")) {
+                char* endptr;
+                concurrentDumps = strtol(optarg, &endptr, 10);
+                if (*endptr != '\0' || concurrentDumps <= 0) {
+                    fprintf(stderr, "Error: invalid number of concurrent dumps: '%s'\n", optarg);
+                    return -1;
+                }
             } else if (!strcmp(longOptions[optionIndex].name, "pid")) {
                 type = Type::PID;
             }
@@ -248,11 +275,20 @@ int Dumpsys::main(int argc, char* const argv[]) {
         return 0;
     }
 
+    // The interleaved section framing of the concurrent mode makes no sense for
+    // a single service or for raw proto output, so fall back to the sequential
+    // dump in those cases.
+    if (concurrentDumps > 1 && N > 1 && !asProto) {
+        return dumpConcurrently(type, services, skippedServices, args, priorityFlags,
+                                static_cast<size_t>(concurrentDumps),
+                                std::chrono::milliseconds(timeoutArgMs));
+    }
+
     for (size_t i = 0; i < N; i++) {
         const String16& serviceName = services[i];
         if (IsSkipped(skippedServices, serviceName)) continue;
 
-        if (startDumpThread(type, serviceName, args) == OK) {
+        if (startDumpThread(type, serviceName, args, transport) == OK) {
             bool addSeparator = (N > 1);
             if (addSeparator) {
                 writeDumpHeader(STDOUT_FILENO, serviceName, priorityFlags);
@@ -329,14 +365,46 @@ static status_t dumpPidToFd(const sp<IBinder>& service, const unique_fd& fd) {
      return OK;
 }
 
+// Runs the blocking dump call of |type| on |service|, writing its output into |fd|. This is the
+// body of the thread spawned for every dump, both in the sequential and the concurrent mode.
+static void doDump(const sp<IBinder>& service, Dumpsys::Type type, const String16& serviceName,
+                   const Vector<String16>& args, const unique_fd& fd) {
+    status_t err = 0;
+
+    switch (type) {
+    case Dumpsys::Type::DUMP:
+        err = service->dump(fd.get(), args);
+        break;
+    case Dumpsys::Type::PID:
+        err = dumpPidToFd(service, fd);
+        break;
+    default:
+        std::cerr << "Unknown dump type" << static_cast<int>(type) << std::endl;
+        return;
+    }
+
+    if (err != OK) {
+        std::cerr << "Error dumping service info status_t: " << statusToString(err) << " "
+             << serviceName << std::endl;
+    }
+}
+
 status_t Dumpsys::startDumpThread(Type type, const String16& serviceName,
-                                  const Vector<String16>& args) {
+                                  const Vector<String16>& args, Transport transport) {
     sp<IBinder> service = sm_->checkService(serviceName);
     if (service == nullptr) {
         std::cerr << "Can't find service: " << serviceName << std::endl;
         return NAME_NOT_FOUND;
     }
 
+    shmFd_.reset();
+    if (transport == Transport::SHM) {
+        std::string shmName = StringPrintf("dumpsys:%s", String8(serviceName).c_str());
+        shmFd_.reset(memfd_create(shmName.c_str(), MFD_CLOEXEC));
+        // On failure (e.g. an old kernel without memfd) silently fall back to the
+        // streaming pipe; the transport is an optimization, not a contract.
+    }
+
     int sfd[2];
     if (pipe(sfd) != 0) {
         std::cerr << "Failed to create pipe to dump service info for " << serviceName << ": "
@@ -348,27 +416,18 @@ status_t Dumpsys::startDumpThread(Type type, const String16& serviceName,
     unique_fd remote_end(sfd[1]);
     sfd[0] = sfd[1] = -1;
 
-    // dump blocks until completion, so spawn a thread..
-    activeThread_ = std::thread([=, remote_end{std::move(remote_end)}]() mutable {
-        status_t err = 0;
-
-        switch (type) {
-        case Type::DUMP:
-            err = service->dump(remote_end.get(), args);
-            break;
-        case Type::PID:
-            err = dumpPidToFd(service, remote_end);
-            break;
-        default:
-            std::cerr << "Unknown dump type" << static_cast<int>(type) << std::endl;
-            return;
-        }
+    // In shared-memory mode the service writes into its own dup of the memfd and the
+    // pipe only signals completion, by closing when the thread exits.
+    unique_fd shm_end;
+    if (shmFd_.get() != -1) {
+        shm_end.reset(fcntl(shmFd_.get(), F_DUPFD_CLOEXEC, 0));
+    }
 
-        if (err != OK) {
-            std::cerr << "Error dumping service info status_t: " << statusToString(err) << " "
-                 << serviceName << std::endl;
-        }
-    });
+    // dump blocks until completion, so spawn a thread..
+    activeThread_ = std::thread(
+        [=, remote_end{std::move(remote_end)}, shm_end{std::move(shm_end)}]() mutable {
+            doDump(service, type, serviceName, args, shm_end.get() != -1 ? shm_end : remote_end);
+        });
     return OK;
 }
 
@@ -380,6 +439,162 @@ void Dumpsys::stopDumpThread(bool dumpComplete) {
     }
     /* close read end of the dump output redirection pipe */
     redirectFd_.reset();
+    /* and the shared-memory file, when one was used */
+    shmFd_.reset();
+}
+
+namespace {
+
+// One in-flight service dump of the concurrent mode. The dump thread blocks in the remote dump()
+// call while the collector thread drains the pipe into |buffer|, so a verbose service is never
+// throttled on a full pipe just because its output has not been emitted yet.
+struct ConcurrentDump {
+    String16 serviceName;
+    std::chrono::steady_clock::time_point start;
+    std::thread dumpThread;
+    std::thread collectorThread;
+
+    // All guarded by ConcurrentDumpMonitor::lock.
+    std::string buffer;
+    bool done = false;
+    std::chrono::duration<double> elapsed{0};
+};
+
+// Signalling between the collector threads and dumpConcurrently(). Collector threads reach this
+// and their ConcurrentDump only through shared_ptrs, which keeps a detached straggler safe after
+// dumpConcurrently() has returned.
+struct ConcurrentDumpMonitor {
+    std::mutex lock;
+    std::condition_variable oneDone;
+};
+
+}  // namespace
+
+int Dumpsys::dumpConcurrently(Type type, const Vector<String16>& services,
+                              const Vector<String16>& skippedServices,
+                              const Vector<String16>& args, int priorityFlags,
+                              size_t maxConcurrency,
+                              std::chrono::milliseconds globalTimeout) const {
+    const auto deadline = std::chrono::steady_clock::now() + globalTimeout;
+    auto monitor = std::make_shared<ConcurrentDumpMonitor>();
+    std::vector<std::shared_ptr<ConcurrentDump>> inFlight;
+    size_t nextService = 0;
+
+    // Starts dumps, in request order, until maxConcurrency of them are in flight. Called with
+    // monitor->lock held.
+    auto startNext = [&]() {
+        while (nextService < services.size() && inFlight.size() < maxConcurrency) {
+            const String16 serviceName = services[nextService++];
+            if (IsSkipped(skippedServices, serviceName)) continue;
+
+            sp<IBinder> service = sm_->checkService(serviceName);
+            if (service == nullptr) {
+                std::cerr << "Can't find service: " << serviceName << std::endl;
+                continue;
+            }
+
+            int sfd[2];
+            if (pipe(sfd) != 0) {
+                std::cerr << "Failed to create pipe to dump service info for " << serviceName
+                     << ": " << strerror(errno) << std::endl;
+                continue;
+            }
+            unique_fd local_end(sfd[0]);
+            unique_fd remote_end(sfd[1]);
+
+            auto dump = std::make_shared<ConcurrentDump>();
+            dump->serviceName = serviceName;
+            dump->start = std::chrono::steady_clock::now();
+            dump->dumpThread = std::thread([=, remote_end{std::move(remote_end)}]() mutable {
+                doDump(service, type, serviceName, args, remote_end);
+            });
+            dump->collectorThread =
+                std::thread([monitor, dump, local_end{std::move(local_end)}]() mutable {
+                    char buf[4096];
+                    ssize_t rc;
+                    while ((rc = TEMP_FAILURE_RETRY(read(local_end.get(), buf, sizeof(buf)))) >
+                           0) {
+                        std::lock_guard<std::mutex> guard(monitor->lock);
+                        dump->buffer.append(buf, rc);
+                    }
+                    std::lock_guard<std::mutex> guard(monitor->lock);
+                    dump->done = true;
+                    dump->elapsed = std::chrono::steady_clock::now() - dump->start;
+                    monitor->oneDone.notify_all();
+                });
+            inFlight.push_back(std::move(dump));
+        }
+    };
+
+    std::unique_lock<std::mutex> guard(monitor->lock);
+    startNext();
+
+    // Emit every service as soon as its dump completes, starting a pending one in the freed
+    // slot, until either everything was dumped or the global budget expires.
+    bool budgetExpired = false;
+    while (!inFlight.empty() && !budgetExpired) {
+        auto it = std::find_if(inFlight.begin(), inFlight.end(),
+                               [](const auto& dump) { return dump->done; });
+        if (it == inFlight.end()) {
+            budgetExpired = !monitor->oneDone.wait_until(guard, deadline, [&inFlight]() {
+                return std::any_of(inFlight.begin(), inFlight.end(),
+                                   [](const auto& dump) { return dump->done; });
+            });
+            continue;
+        }
+        std::shared_ptr<ConcurrentDump> dump = std::move(*it);
+        inFlight.erase(it);
+        startNext();
+        guard.unlock();
+
+        dump->dumpThread.join();
+        dump->collectorThread.join();
+        writeDumpHeader(STDOUT_FILENO, dump->serviceName, priorityFlags);
+        if (!WriteFully(STDOUT_FILENO, dump->buffer.data(), dump->buffer.size())) {
+            std::cerr << "Failed to write dump of service " << dump->serviceName << ": "
+                 << strerror(errno) << std::endl;
+        }
+        writeDumpFooter(STDOUT_FILENO, dump->serviceName, dump->elapsed);
+        guard.lock();
+    }
+
+    // Global budget exhausted: emit whatever the still-running services have produced so far
+    // with a timeout banner, and leave their threads detached the same way stopDumpThread()
+    // does for an incomplete dump.
+    for (const auto& dump : inFlight) {
+        const std::string partial = dump->buffer;
+        const bool done = dump->done;
+        const std::chrono::duration<double> elapsed =
+            done ? dump->elapsed
+                 : std::chrono::duration<double>(std::chrono::steady_clock::now() - dump->start);
+        guard.unlock();
+
+        if (done) {
+            dump->dumpThread.join();
+            dump->collectorThread.join();
+        } else {
+            dump->dumpThread.detach();
+            dump->collectorThread.detach();
+        }
+        writeDumpHeader(STDOUT_FILENO, dump->serviceName, priorityFlags);
+        WriteFully(STDOUT_FILENO, partial.data(), partial.size());
+        if (!done) {
+            std::string msg =
+                StringPrintf("\n*** SERVICE '%s' DUMP TIMEOUT (%llums) EXPIRED ***\n\n",
+                             String8(dump->serviceName).string(), globalTimeout.count());
+            WriteStringToFd(msg, STDOUT_FILENO);
+        }
+        writeDumpFooter(STDOUT_FILENO, dump->serviceName, elapsed);
+        guard.lock();
+    }
+
+    for (; nextService < services.size(); nextService++) {
+        const String16& serviceName = services[nextService];
+        if (IsSkipped(skippedServices, serviceName)) continue;
+        std::cerr << "Skipping " << serviceName << ": global dump budget ("
+             << globalTimeout.count() << "ms) expired" << std::endl;
+    }
+    return 0;
 }
 
 void Dumpsys::writeDumpHeader(int fd, const String16& serviceName, int priorityFlags) const {
@@ -453,6 +668,31 @@ status_t Dumpsys::writeDump(int fd, const String16& serviceName, std::chrono::mi
         totalBytes += rc;
     }
 
+    // In shared-memory mode the pipe only carried the completion signal; the dump itself
+    // is in the memfd. Hand it to |fd| in bulk. After a timeout this emits whatever the
+    // service has produced so far instead of dropping it.
+    if (shmFd_.get() != -1 && (status == OK || status == TIMED_OUT)) {
+        const off_t size = lseek(shmFd_.get(), 0, SEEK_END);
+        off_t offset = 0;
+        while (offset < size) {
+            ssize_t sent = TEMP_FAILURE_RETRY(sendfile(fd, shmFd_.get(), &offset, size - offset));
+            if (sent > 0) {
+                continue;
+            }
+            // sendfile() cannot target every fd (e.g. some ttys); fall back to copying.
+            char buf[65536];
+            ssize_t rc = TEMP_FAILURE_RETRY(pread(shmFd_.get(), buf, sizeof(buf), offset));
+            if (rc <= 0 || !WriteFully(fd, buf, rc)) {
+                std::cerr << "Failed to write while dumping service " << serviceName << ": "
+                     << strerror(errno) << std::endl;
+                status = -errno;
+                break;
+            }
+            offset += rc;
+        }
+        totalBytes = offset;
+    }
+
     if ((status == TIMED_OUT) && (!asProto)) {
         std::string msg = StringPrintf("\n*** SERVICE '%s' DUMP TIMEOUT (%llums) EXPIRED ***\n\n",
                                        String8(serviceName).string(), timeout.count());
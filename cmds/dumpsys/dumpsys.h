@@ -56,18 +56,49 @@ class Dumpsys {
         PID,   // dump pid of server only
     };
 
+    enum class Transport {
+        PIPE,  // service output streams through a pipe and is emitted as it arrives
+        SHM,   // service output goes into a shared-memory file and is handed over in
+               // bulk once the dump completes; avoids the pipe copy for very large
+               // dumps. Falls back to PIPE on kernels without memfd support.
+    };
+
     /**
      * Starts a thread to connect to a service and get its dump output. The thread redirects
-     * the output to a pipe. Thread must be stopped by a subsequent callto {@code
-     * stopDumpThread}.
+     * the output to a pipe, or, with {@code Transport::SHM}, to a shared-memory file while
+     * the pipe only signals completion. Thread must be stopped by a subsequent call to
+     * {@code stopDumpThread}.
      * @param serviceName
      * @param args list of arguments to pass to service dump method.
+     * @param transport how the service output travels back to this process
      * @return {@code OK} thread is started successfully.
      *         {@code NAME_NOT_FOUND} service could not be found.
      *         {@code != OK} error
      */
-    status_t startDumpThread(Type type, const String16& serviceName,
-                             const Vector<String16>& args);
+    status_t startDumpThread(Type type, const String16& serviceName, const Vector<String16>& args,
+                             Transport transport = Transport::PIPE);
+
+    /**
+     * Dumps multiple services concurrently, up to {@code maxConcurrency} at a time, sharing a
+     * global deadline budget instead of a per-service timeout. Each service's output is buffered
+     * while its dump is in flight and emitted with the usual section framing as soon as that
+     * service completes, so a hung service never delays the output of the services dumped after
+     * it. When the budget expires, the partial output of the still-running services is emitted
+     * with a timeout banner and their dump threads are left detached, like {@code
+     * stopDumpThread} does for an incomplete dump.
+     * @param type dump type to run on every service
+     * @param services services to dump, in the order they were requested
+     * @param skippedServices services to skip
+     * @param args list of arguments to pass to each service dump method.
+     * @param priorityFlags dump priority, used for the section framing
+     * @param maxConcurrency maximum number of dumps in flight; must be > 0
+     * @param globalTimeout deadline budget shared by all dumps
+     * @return 0 on success
+     */
+    int dumpConcurrently(Type type, const Vector<String16>& services,
+                         const Vector<String16>& skippedServices, const Vector<String16>& args,
+                         int priorityFlags, size_t maxConcurrency,
+                         std::chrono::milliseconds globalTimeout) const;
 
     /**
      * Writes a section header to a file descriptor.
@@ -78,7 +109,9 @@ class Dumpsys {
     void writeDumpHeader(int fd, const String16& serviceName, int priorityFlags) const;
 
     /**
-     * Redirects service dump to a file descriptor. This requires
+     * Redirects service dump to a file descriptor. In {@code Transport::SHM} mode the
+     * output is emitted in bulk once the service completes; on a timeout, whatever the
+     * service has produced so far is emitted instead of being lost. This requires
      * {@code startDumpThread} to be called successfully otherwise the function will
      * return {@code INVALID_OPERATION}.
      * @param fd file descriptor to write data
@@ -114,17 +147,21 @@ class Dumpsys {
     void stopDumpThread(bool dumpComplete);
 
     /**
-     * Returns file descriptor of the pipe used to dump service data. This assumes
-     * {@code startDumpThread} was called successfully.
+     * Returns the file descriptor holding the service dump data: the read end of the
+     * pipe, or the shared-memory file when the dump was started with
+     * {@code Transport::SHM}. This assumes {@code startDumpThread} was called
+     * successfully.
      */
     int getDumpFd() const {
-        return redirectFd_.get();
+        return shmFd_.get() != -1 ? shmFd_.get() : redirectFd_.get();
     }
 
   private:
     android::IServiceManager* sm_;
     std::thread activeThread_;
     mutable android::base::unique_fd redirectFd_;
+    /* shared-memory file receiving the dump in Transport::SHM mode, -1 otherwise */
+    mutable android::base::unique_fd shmFd_;
 };
 }
 
@@ -191,11 +191,12 @@ class DumpsysTest : public Test {
 
     void CallSingleService(const String16& serviceName, Vector<String16>& args, int priorityFlags,
                            bool supportsProto, std::chrono::duration<double>& elapsedDuration,
-                           size_t& bytesWritten) {
+                           size_t& bytesWritten,
+                           Dumpsys::Transport transport = Dumpsys::Transport::PIPE) {
         CaptureStdout();
         CaptureStderr();
         dump_.setServiceArgs(args, supportsProto, priorityFlags);
-        status_t status = dump_.startDumpThread(Dumpsys::Type::DUMP, serviceName, args);
+        status_t status = dump_.startDumpThread(Dumpsys::Type::DUMP, serviceName, args, transport);
         EXPECT_THAT(status, Eq(0));
         status = dump_.writeDump(STDOUT_FILENO, serviceName, std::chrono::milliseconds(500), false,
                                  elapsedDuration, bytesWritten);
@@ -317,6 +318,16 @@ TEST_F(DumpsysTest, DumpRunningService) {
     AssertOutput("Here's your car");
 }
 
+// Tests 'dumpsys --shm service_name', which moves the dump through a shared-memory file
+// instead of streaming it through the pipe
+TEST_F(DumpsysTest, DumpRunningServiceWithSharedMemoryTransport) {
+    ExpectDump("Valet", "Here's your car");
+
+    CallMain({"--shm", "Valet"});
+
+    AssertOutput("Here's your car");
+}
+
 // Tests 'dumpsys -t 1 service_name' on a service that times out after 2s
 TEST_F(DumpsysTest, DumpRunningServiceTimeoutInSec) {
     sp<BinderMock> binder_mock = ExpectDumpAndHang("Valet", 2, "Here's your car");
@@ -426,6 +437,37 @@ TEST_F(DumpsysTest, DumpMultipleServices) {
     AssertDumped("running3", "dump3");
 }
 
+// Tests 'dumpsys --concurrent 2' on multiple services
+TEST_F(DumpsysTest, DumpMultipleServicesConcurrently) {
+    ExpectListServices({"running1", "stopped2", "running3"});
+    ExpectDump("running1", "dump1");
+    ExpectCheckService("stopped2", false);
+    ExpectDump("running3", "dump3");
+
+    CallMain({"--concurrent", "2"});
+
+    AssertRunningServices({"running1", "running3"});
+    AssertDumped("running1", "dump1");
+    AssertStopped("stopped2");
+    AssertDumped("running3", "dump3");
+}
+
+// Tests that in the concurrent mode a hung service does not hold back the services behind it
+TEST_F(DumpsysTest, DumpConcurrentlyWithHungService) {
+    ExpectListServices({"Hanging", "Valet"});
+    sp<BinderMock> binder_mock = ExpectDumpAndHang("Hanging", 2, "Too late");
+    ExpectDump("Valet", "Here's your car");
+
+    CallMain({"-T", "500", "--concurrent", "2"});
+
+    AssertDumped("Valet", "Here's your car");
+    AssertOutputContains("SERVICE 'Hanging' DUMP TIMEOUT (500ms) EXPIRED");
+    AssertNotDumped("Too late");
+
+    // TODO(b/65056227): BinderMock is not destructed because thread is detached on dumpsys.cpp
+    Mock::AllowLeak(binder_mock.get());
+}
+
 // Tests 'dumpsys --skip skipped3 skipped5', which should skip these services
 TEST_F(DumpsysTest, DumpWithSkip) {
     ExpectListServices({"running1", "stopped2", "skipped3", "running4", "skipped5"});
@@ -578,6 +620,24 @@ TEST_F(DumpsysTest, GetBytesWritten) {
     EXPECT_THAT(bytesWritten, Eq(strlen(dumpContents)));
 }
 
+TEST_F(DumpsysTest, GetBytesWrittenWithSharedMemoryTransport) {
+    const char* serviceName = "service2";
+    const char* dumpContents = "dump1";
+    ExpectDump(serviceName, dumpContents);
+
+    String16 service(serviceName);
+    Vector<String16> args;
+    std::chrono::duration<double> elapsedDuration;
+    size_t bytesWritten;
+
+    CallSingleService(service, args, IServiceManager::DUMP_FLAG_PRIORITY_ALL,
+                      /* as_proto = */ false, elapsedDuration, bytesWritten,
+                      Dumpsys::Transport::SHM);
+
+    AssertOutput(dumpContents);
+    EXPECT_THAT(bytesWritten, Eq(strlen(dumpContents)));
+}
+
 TEST_F(DumpsysTest, WriteDumpWithoutThreadStart) {
     std::chrono::duration<double> elapsedDuration;
     size_t bytesWritten;
@@ -3,6 +3,7 @@ LOCAL_PATH:= $(call my-dir)
 include $(CLEAR_VARS)
 
 LOCAL_SRC_FILES:=   \
+    BlastScenes.cpp \
     Composers.cpp   \
     GLHelper.cpp    \
     Renderers.cpp   \
@@ -21,6 +22,7 @@ LOCAL_MODULE_STEM_64 := flatland64
 LOCAL_SHARED_LIBRARIES := \
     libEGL      \
     libGLESv2   \
+    libbinder   \
     libcutils   \
     libgui      \
     libui       \
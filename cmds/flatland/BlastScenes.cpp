@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_ALWAYS
+
+#include <gui/BLASTBufferQueue.h>
+#include <gui/BufferQueueDefs.h>
+#include <gui/IProducerListener.h>
+#include <gui/SurfaceComposerClient.h>
+#include <gui/SurfaceControl.h>
+#include <ui/DisplayConfig.h>
+#include <ui/DisplayState.h>
+#include <ui/GraphicBuffer.h>
+#include <utils/Timers.h>
+#include <utils/Trace.h>
+
+#include <stdio.h>
+
+#include <memory>
+#include <vector>
+
+#include "Flatland.h"
+
+namespace android {
+
+// Scenes that drive the production composition path: buffers are queued
+// through BLASTBufferQueue to real SurfaceControls and composited by
+// SurfaceFlinger, unlike the classic flatland benchmarks which replay a
+// synthetic GL loop. Frame content is a solid CPU fill; what is measured
+// is the submission pipeline, not the rendering.
+namespace {
+
+struct BlastSceneDesc {
+    // The name of the scene.
+    const char* name;
+
+    // Number of stacked full-screen-ish layers.
+    size_t numLayers;
+
+    // Background blur radius applied to the top layer; 0 disables blur.
+    int blurRadius;
+
+    // Shadow radius applied to each layer; 0 disables shadows.
+    float shadowRadius;
+
+    // If true, a layer is created per physical display instead of all
+    // layers targeting the internal display.
+    bool allDisplays;
+};
+
+const BlastSceneDesc sceneDescs[] = {
+        {"BLAST Single Window", 1, 0, 0.0f, false},
+        {"BLAST App Stack", 3, 0, 0.0f, false},
+        {"BLAST Blur Dialog", 3, 90, 0.0f, false},
+        {"BLAST Shadowed Windows", 3, 0, 40.0f, false},
+        {"BLAST Multi-Display", 1, 0, 0.0f, true},
+};
+
+// Per-frame stage timings, in the same stage vocabulary TimeStats uses for
+// app frames: dequeue covers dequeueBuffer (including waiting for a free
+// slot and the release fence), render covers the CPU fill, and queue covers
+// queueBuffer up to handoff to the BLAST adapter.
+struct StageTimes {
+    nsecs_t dequeue = 0;
+    nsecs_t render = 0;
+    nsecs_t queue = 0;
+};
+
+class BlastLayer {
+public:
+    bool setUp(const sp<SurfaceComposerClient>& client, const char* name, uint32_t layerStack,
+               const Rect& frame, int32_t z, int blurRadius, float shadowRadius) {
+        mWidth = frame.getWidth();
+        mHeight = frame.getHeight();
+
+        mSurfaceControl = client->createSurface(String8(name), mWidth, mHeight,
+                                                PIXEL_FORMAT_RGBA_8888,
+                                                ISurfaceComposerClient::eFXSurfaceBufferState);
+        if (mSurfaceControl == nullptr || !mSurfaceControl->isValid()) {
+            fprintf(stderr, "error creating surface \"%s\".\n", name);
+            return false;
+        }
+
+        SurfaceComposerClient::Transaction t;
+        t.setLayerStack(mSurfaceControl, layerStack)
+                .setLayer(mSurfaceControl, z)
+                .setFrame(mSurfaceControl, frame)
+                .show(mSurfaceControl)
+                .setDataspace(mSurfaceControl, ui::Dataspace::V0_SRGB);
+        if (blurRadius > 0) {
+            t.setBackgroundBlurRadius(mSurfaceControl, blurRadius);
+        }
+        if (shadowRadius > 0.0f) {
+            t.setShadowRadius(mSurfaceControl, shadowRadius);
+        }
+        t.apply();
+
+        mBlastBufferQueue = new BLASTBufferQueue(mSurfaceControl, mWidth, mHeight);
+        mProducer = mBlastBufferQueue->getIGraphicBufferProducer();
+
+        IGraphicBufferProducer::QueueBufferOutput qbOutput;
+        status_t err = mProducer->connect(new DummyProducerListener, NATIVE_WINDOW_API_CPU, false,
+                                          &qbOutput);
+        if (err != NO_ERROR) {
+            fprintf(stderr, "error connecting producer: %d\n", err);
+            return false;
+        }
+        mProducer->setMaxDequeuedBufferCount(2);
+
+        return true;
+    }
+
+    void tearDown() {
+        if (mSurfaceControl != nullptr) {
+            SurfaceComposerClient::Transaction t;
+            t.reparent(mSurfaceControl, nullptr);
+            t.apply();
+        }
+        mBlastBufferQueue.clear();
+        mSurfaceControl.clear();
+    }
+
+    bool doFrame(uint8_t colorSeed, StageTimes* times) {
+        ATRACE_CALL();
+
+        int slot;
+        sp<Fence> fence;
+
+        nsecs_t start = systemTime();
+        status_t err = mProducer->dequeueBuffer(&slot, &fence, mWidth, mHeight,
+                                                PIXEL_FORMAT_RGBA_8888,
+                                                GRALLOC_USAGE_SW_WRITE_OFTEN, nullptr, nullptr);
+        if (err != NO_ERROR && err != IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+            fprintf(stderr, "error dequeueing buffer: %d\n", err);
+            return false;
+        }
+
+        sp<GraphicBuffer> buffer;
+        if (err == IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+            mProducer->requestBuffer(slot, &buffer);
+        } else {
+            buffer = mBuffers[slot];
+        }
+        mBuffers[slot] = buffer;
+
+        if (fence != nullptr) {
+            fence->waitForever("BlastLayer::doFrame");
+        }
+        nsecs_t dequeued = systemTime();
+
+        uint32_t* pixels = nullptr;
+        buffer->lock(GraphicBuffer::USAGE_SW_WRITE_OFTEN, reinterpret_cast<void**>(&pixels));
+        const uint32_t color = 0xFF000000 | (uint32_t(colorSeed) << 8) | uint32_t(255 - colorSeed);
+        const uint32_t count = buffer->getStride() * mHeight;
+        for (uint32_t i = 0; i < count; i++) {
+            pixels[i] = color;
+        }
+        buffer->unlock();
+        nsecs_t rendered = systemTime();
+
+        IGraphicBufferProducer::QueueBufferInput input(systemTime(), true, HAL_DATASPACE_UNKNOWN,
+                                                       Rect(mWidth, mHeight),
+                                                       NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                                       Fence::NO_FENCE);
+        IGraphicBufferProducer::QueueBufferOutput output;
+        err = mProducer->queueBuffer(slot, input, &output);
+        if (err != NO_ERROR) {
+            fprintf(stderr, "error queueing buffer: %d\n", err);
+            return false;
+        }
+        nsecs_t queued = systemTime();
+
+        times->dequeue += dequeued - start;
+        times->render += rendered - dequeued;
+        times->queue += queued - rendered;
+
+        return true;
+    }
+
+private:
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    sp<SurfaceControl> mSurfaceControl;
+    sp<BLASTBufferQueue> mBlastBufferQueue;
+    sp<IGraphicBufferProducer> mProducer;
+    sp<GraphicBuffer> mBuffers[BufferQueueDefs::NUM_BUFFER_SLOTS];
+};
+
+class BlastSceneRunner {
+public:
+    explicit BlastSceneRunner(const BlastSceneDesc& desc) : mDesc(desc) {}
+
+    bool setUp() {
+        mClient = new SurfaceComposerClient;
+        if (mClient->initCheck() != NO_ERROR) {
+            fprintf(stderr, "error connecting to SurfaceFlinger.\n");
+            return false;
+        }
+
+        std::vector<sp<IBinder>> displayTokens;
+        if (mDesc.allDisplays) {
+            for (PhysicalDisplayId id : SurfaceComposerClient::getPhysicalDisplayIds()) {
+                displayTokens.push_back(SurfaceComposerClient::getPhysicalDisplayToken(id));
+            }
+        } else {
+            displayTokens.push_back(SurfaceComposerClient::getInternalDisplayToken());
+        }
+
+        for (const sp<IBinder>& token : displayTokens) {
+            if (token == nullptr) {
+                continue;
+            }
+            ui::DisplayState displayState;
+            DisplayConfig config;
+            if (SurfaceComposerClient::getDisplayState(token, &displayState) != NO_ERROR ||
+                SurfaceComposerClient::getActiveDisplayConfig(token, &config) != NO_ERROR) {
+                continue;
+            }
+            const Rect displayRect(config.resolution.getWidth(), config.resolution.getHeight());
+
+            for (size_t i = 0; i < mDesc.numLayers; i++) {
+                // Stagger stacked layers so each one stays partly visible
+                // and none can be culled.
+                Rect frame = displayRect;
+                frame.offsetBy(i * 20, i * 20);
+
+                const bool topLayer = (i == mDesc.numLayers - 1);
+                mLayers.push_back(std::make_unique<BlastLayer>());
+                if (!mLayers.back()->setUp(mClient, mDesc.name, displayState.layerStack, frame,
+                                           INT32_MAX - 10 + int32_t(i),
+                                           topLayer ? mDesc.blurRadius : 0, mDesc.shadowRadius)) {
+                    return false;
+                }
+            }
+        }
+
+        return !mLayers.empty();
+    }
+
+    void tearDown() {
+        for (auto& layer : mLayers) {
+            layer->tearDown();
+        }
+        mLayers.clear();
+    }
+
+    bool run(uint32_t frames, StageTimes* times) {
+        ATRACE_CALL();
+
+        for (uint32_t i = 0; i < frames; i++) {
+            for (auto& layer : mLayers) {
+                if (!layer->doFrame(uint8_t(i * 16), times)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    size_t numLayers() const { return mLayers.size(); }
+
+private:
+    const BlastSceneDesc& mDesc;
+    sp<SurfaceComposerClient> mClient;
+    std::vector<std::unique_ptr<BlastLayer>> mLayers;
+};
+
+} // namespace
+
+bool runBlastScenes(uint32_t frames) {
+    printf(" %-24s | Layers | Dequeue | Render  | Queue   | (ms per frame)\n", "Scenario");
+
+    for (size_t i = 0; i < NELEMS(sceneDescs); i++) {
+        const BlastSceneDesc& desc = sceneDescs[i];
+
+        BlastSceneRunner runner(desc);
+        if (!runner.setUp()) {
+            runner.tearDown();
+            return false;
+        }
+
+        // One warm-up frame per layer to populate buffer slots.
+        StageTimes warmUp;
+        if (!runner.run(1, &warmUp)) {
+            runner.tearDown();
+            return false;
+        }
+
+        StageTimes times;
+        const size_t numLayers = runner.numLayers();
+        bool result = runner.run(frames, &times);
+        runner.tearDown();
+        if (!result) {
+            return false;
+        }
+
+        const double scale = 1.0 / (1e6 * frames);
+        printf(" %-24s | %6zu | %7.3f | %7.3f | %7.3f |\n", desc.name, numLayers,
+               times.dequeue * scale, times.render * scale, times.queue * scale);
+        fflush(stdout);
+    }
+
+    return true;
+}
+
+} // namespace android
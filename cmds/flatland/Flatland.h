@@ -68,4 +68,8 @@ public:
 
 Renderer* staticGradient();
 
+// Defined in BlastScenes.cpp. Runs the scenes that submit buffers through
+// BLASTBufferQueue to SurfaceFlinger instead of flatland's own GL loop.
+bool runBlastScenes(uint32_t frames);
+
 } // namespace android
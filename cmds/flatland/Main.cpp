@@ -723,6 +723,8 @@ static void showHelp(const char *cmd) {
     fprintf(stderr, "options include:\n"
                     "  -s N            sleep for N ms between samples\n"
                     "  -d              display the test frame to a window\n"
+                    "  --blast         run the BLASTBufferQueue scenes, which\n"
+                    "                  composite through SurfaceFlinger\n"
                     "  --help          print this helpful message and exit\n"
             );
 }
@@ -733,11 +735,14 @@ int main(int argc, char** argv) {
         exit(0);
     }
 
+    bool runBlast = false;
+
     for (;;) {
         int ret;
         int option_index = 0;
         static struct option long_options[] = {
             {"help",     no_argument, 0,  0 },
+            {"blast",    no_argument, 0,  0 },
             {     0,               0, 0,  0 }
         };
 
@@ -758,10 +763,13 @@ int main(int argc, char** argv) {
             break;
 
             case 0:
-                if (strcmp(long_options[option_index].name, "help")) {
+                if (strcmp(long_options[option_index].name, "help") == 0) {
                     showHelp(argv[0]);
                     exit(0);
                 }
+                if (strcmp(long_options[option_index].name, "blast") == 0) {
+                    runBlast = true;
+                }
             break;
 
             default:
@@ -778,6 +786,14 @@ int main(int argc, char** argv) {
     }
     printf("\n");
 
+    if (runBlast) {
+        if (!runBlastScenes(600)) {
+            fprintf(stderr, "exiting due to error.\n");
+            return 1;
+        }
+        return 0;
+    }
+
     if (!runTests()) {
         fprintf(stderr, "exiting due to error.\n");
         return 1;
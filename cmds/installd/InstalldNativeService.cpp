@@ -19,13 +19,19 @@
 #define ATRACE_TAG ATRACE_TAG_PACKAGE_MANAGER
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <errno.h>
 #include <fstream>
 #include <fts.h>
 #include <functional>
 #include <inttypes.h>
+#include <mutex>
 #include <regex>
 #include <stdlib.h>
+#include <thread>
+#include <unordered_map>
 #include <string.h>
 #include <sys/capability.h>
 #include <sys/file.h>
@@ -1626,7 +1632,7 @@ static void collectManualStats(const std::string& path, struct stats* stats) {
     DIR *d;
     int dfd;
     struct dirent *de;
-    struct stat s;
+    struct statx sx;
 
     d = opendir(path.c_str());
     if (d == nullptr) {
@@ -1640,8 +1646,10 @@ static void collectManualStats(const std::string& path, struct stats* stats) {
         const char *name = de->d_name;
 
         int64_t size = 0;
-        if (fstatat(dfd, name, &s, AT_SYMLINK_NOFOLLOW) == 0) {
-            size = s.st_blocks * 512;
+        // Only the block count is needed here; the minimal statx mask lets the
+        // kernel skip filling in fields that can be expensive to compute.
+        if (statx(dfd, name, AT_SYMLINK_NOFOLLOW, STATX_BLOCKS, &sx) == 0) {
+            size = sx.stx_blocks * 512;
         }
 
         if (de->d_type == DT_DIR) {
@@ -1677,7 +1685,7 @@ static void collectManualStatsForUser(const std::string& path, struct stats* sta
     DIR *d;
     int dfd;
     struct dirent *de;
-    struct stat s;
+    struct statx sx;
 
     d = opendir(path.c_str());
     if (d == nullptr) {
@@ -1690,10 +1698,10 @@ static void collectManualStatsForUser(const std::string& path, struct stats* sta
     while ((de = readdir(d))) {
         if (de->d_type == DT_DIR) {
             const char *name = de->d_name;
-            if (fstatat(dfd, name, &s, AT_SYMLINK_NOFOLLOW) != 0) {
+            if (statx(dfd, name, AT_SYMLINK_NOFOLLOW, STATX_UID, &sx) != 0) {
                 continue;
             }
-            int32_t user_uid = multiuser_get_app_id(s.st_uid);
+            int32_t user_uid = multiuser_get_app_id(sx.stx_uid);
             if (!strcmp(name, ".") || !strcmp(name, "..")) {
                 continue;
             } else if (exclude_apps && (user_uid >= AID_APP_START && user_uid <= AID_APP_END)) {
@@ -1740,6 +1748,68 @@ static void collectManualExternalStatsForUser(const std::string& path, struct st
     fts_close(fts);
 }
 
+// Cached result of one package's manual measurement, keyed on the CE and DE package
+// dir change times: install, clear-data and cache dir create/delete all touch those
+// directories directly. Writes deeper inside the app's tree do not bump them, which
+// is why entries also expire after a short TTL; the stats consumers (Settings,
+// StorageStatsService) already tolerate measurements that old.
+struct AppSizeCacheEntry {
+    struct statx_timestamp ceMtime;
+    struct statx_timestamp deMtime;
+    std::chrono::steady_clock::time_point expiry;
+    struct stats stats;
+    struct stats extStats;
+};
+
+static std::mutex sAppSizeCacheLock;
+static std::unordered_map<std::string, AppSizeCacheEntry> sAppSizeCache;
+
+static constexpr std::chrono::minutes kAppSizeCacheTtl(5);
+static constexpr size_t kAppSizeCacheMaxEntries = 4096;
+
+static struct statx_timestamp getDirMtime(const std::string& path) {
+    struct statx sx;
+    if (statx(AT_FDCWD, path.c_str(), AT_SYMLINK_NOFOLLOW, STATX_MTIME, &sx) != 0) {
+        // A missing dir is represented as the zero timestamp; its creation
+        // produces a real one, so the entry still invalidates correctly.
+        return {};
+    }
+    return sx.stx_mtime;
+}
+
+static bool sameMtime(const struct statx_timestamp& a, const struct statx_timestamp& b) {
+    return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+static bool getCachedAppSize(const std::string& key, const struct statx_timestamp& ceMtime,
+        const struct statx_timestamp& deMtime, struct stats* stats, struct stats* extStats) {
+    std::lock_guard<std::mutex> guard(sAppSizeCacheLock);
+    auto it = sAppSizeCache.find(key);
+    if (it == sAppSizeCache.end()) {
+        return false;
+    }
+    const AppSizeCacheEntry& entry = it->second;
+    if (std::chrono::steady_clock::now() > entry.expiry || !sameMtime(entry.ceMtime, ceMtime)
+            || !sameMtime(entry.deMtime, deMtime)) {
+        sAppSizeCache.erase(it);
+        return false;
+    }
+    *stats = entry.stats;
+    *extStats = entry.extStats;
+    return true;
+}
+
+static void putCachedAppSize(const std::string& key, const struct statx_timestamp& ceMtime,
+        const struct statx_timestamp& deMtime, const struct stats& stats,
+        const struct stats& extStats) {
+    std::lock_guard<std::mutex> guard(sAppSizeCacheLock);
+    if (sAppSizeCache.size() >= kAppSizeCacheMaxEntries) {
+        sAppSizeCache.clear();
+    }
+    sAppSizeCache[key] = {ceMtime, deMtime, std::chrono::steady_clock::now() + kAppSizeCacheTtl,
+            stats, extStats};
+}
+
 binder::Status InstalldNativeService::getAppSize(const std::unique_ptr<std::string>& uuid,
         const std::vector<std::string>& packageNames, int32_t userId, int32_t flags,
         int32_t appId, const std::vector<int64_t>& ceDataInodes,
@@ -1813,34 +1883,79 @@ binder::Status InstalldNativeService::getAppSize(const std::unique_ptr<std::stri
         }
         ATRACE_END();
 
-        for (size_t i = 0; i < packageNames.size(); i++) {
-            const char* pkgname = packageNames[i].c_str();
+        // The per-package walks are independent read-only traversals, so spread them
+        // over a few workers pulling from a shared queue; the serial walk leaves most
+        // of the available IO parallelism unused on flash storage. Unchanged packages
+        // are answered from the mtime-keyed cache without walking at all.
+        ATRACE_BEGIN("packages");
+        std::mutex statsLock;
+        std::atomic<size_t> nextPackage(0);
+        auto measurePackages = [&]() {
+            size_t i;
+            while ((i = nextPackage.fetch_add(1)) < packageNames.size()) {
+                const char* pkgname = packageNames[i].c_str();
+
+                auto cePath = create_data_user_ce_package_path(uuid_, userId, pkgname,
+                        ceDataInodes[i]);
+                auto dePath = create_data_user_de_package_path(uuid_, userId, pkgname);
+                const struct statx_timestamp ceMtime = getDirMtime(cePath);
+                const struct statx_timestamp deMtime = getDirMtime(dePath);
+
+                struct stats pkgStats;
+                struct stats pkgExtStats;
+                memset(&pkgStats, 0, sizeof(pkgStats));
+                memset(&pkgExtStats, 0, sizeof(pkgExtStats));
+
+                if (!getCachedAppSize(cePath, ceMtime, deMtime, &pkgStats, &pkgExtStats)) {
+                    collectManualStats(cePath, &pkgStats);
+                    collectManualStats(dePath, &pkgStats);
+
+                    if (!uuid) {
+                        calculate_tree_size(
+                                create_primary_current_profile_package_dir_path(userId, pkgname),
+                                &pkgStats.dataSize);
+                        calculate_tree_size(
+                                create_primary_reference_profile_package_dir_path(pkgname),
+                                &pkgStats.codeSize);
+                    }
 
-            ATRACE_BEGIN("data");
-            auto cePath = create_data_user_ce_package_path(uuid_, userId, pkgname, ceDataInodes[i]);
-            collectManualStats(cePath, &stats);
-            auto dePath = create_data_user_de_package_path(uuid_, userId, pkgname);
-            collectManualStats(dePath, &stats);
-            ATRACE_END();
+                    auto extPath = create_data_media_package_path(uuid_, userId, "data", pkgname);
+                    collectManualStats(extPath, &pkgExtStats);
+                    auto mediaPath = create_data_media_package_path(uuid_, userId, "media",
+                            pkgname);
+                    calculate_tree_size(mediaPath, &pkgExtStats.dataSize);
 
-            if (!uuid) {
-                ATRACE_BEGIN("profiles");
-                calculate_tree_size(
-                        create_primary_current_profile_package_dir_path(userId, pkgname),
-                        &stats.dataSize);
-                calculate_tree_size(
-                        create_primary_reference_profile_package_dir_path(pkgname),
-                        &stats.codeSize);
-                ATRACE_END();
-            }
+                    putCachedAppSize(cePath, ceMtime, deMtime, pkgStats, pkgExtStats);
+                }
+#if MEASURE_DEBUG
+                else {
+                    LOG(DEBUG) << "Served " << cePath << " from size cache";
+                }
+#endif
 
-            ATRACE_BEGIN("external");
-            auto extPath = create_data_media_package_path(uuid_, userId, "data", pkgname);
-            collectManualStats(extPath, &extStats);
-            auto mediaPath = create_data_media_package_path(uuid_, userId, "media", pkgname);
-            calculate_tree_size(mediaPath, &extStats.dataSize);
-            ATRACE_END();
+                std::lock_guard<std::mutex> guard(statsLock);
+                stats.codeSize += pkgStats.codeSize;
+                stats.dataSize += pkgStats.dataSize;
+                stats.cacheSize += pkgStats.cacheSize;
+                extStats.codeSize += pkgExtStats.codeSize;
+                extStats.dataSize += pkgExtStats.dataSize;
+                extStats.cacheSize += pkgExtStats.cacheSize;
+            }
+        };
+        size_t numWorkers = std::min(packageNames.size(),
+                size_t(std::max(1u, std::thread::hardware_concurrency() / 2)));
+        if (numWorkers > 1) {
+            std::vector<std::thread> workers;
+            for (size_t i = 0; i < numWorkers; i++) {
+                workers.emplace_back(measurePackages);
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        } else {
+            measurePackages();
         }
+        ATRACE_END();
 
         if (!uuid) {
             ATRACE_BEGIN("dalvik");
@@ -2426,6 +2541,149 @@ binder::Status InstalldNativeService::dexopt(const std::string& apkPath, int32_t
     return res ? error(res, error_msg) : ok();
 }
 
+// Reads the MemAvailable field of /proc/meminfo, in kB, or -1 if it cannot be determined.
+static int64_t getMemAvailableKb() {
+    std::string meminfo;
+    if (!android::base::ReadFileToString("/proc/meminfo", &meminfo)) {
+        return -1;
+    }
+    size_t pos = meminfo.find("MemAvailable:");
+    if (pos == std::string::npos) {
+        return -1;
+    }
+    int64_t kb;
+    if (sscanf(meminfo.c_str() + pos, "MemAvailable: %" PRId64 " kB", &kb) != 1) {
+        return -1;
+    }
+    return kb;
+}
+
+// Decides how many dex2oat invocations of a batch may be in flight at once: half the online
+// cores, further narrowed by the currently available memory at roughly one invocation per
+// 512 MB, and always at least one. The ro.installd.batch_dexopt_concurrency property overrides
+// the computed value.
+static size_t getBatchDexoptConcurrency() {
+    int overridden = android::base::GetIntProperty("ro.installd.batch_dexopt_concurrency", 0);
+    if (overridden > 0) {
+        return overridden;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t limit = std::max(1L, cpus / 2);
+    int64_t available_kb = getMemAvailableKb();
+    if (available_kb >= 0) {
+        size_t by_memory = std::max<int64_t>(1, available_kb / (512 * 1024));
+        limit = std::min(limit, by_memory);
+    }
+    return limit;
+}
+
+binder::Status InstalldNativeService::batchDexopt(
+        const std::vector<os::DexoptParams>& dexoptParams,
+        const sp<os::IDexoptProgressCallback>& callback, std::vector<int32_t>* _aidl_return) {
+    ENFORCE_UID(AID_SYSTEM);
+    for (const auto& params : dexoptParams) {
+        CHECK_ARGUMENT_PATH(params.apkPath);
+        if (!params.packageName.empty() && params.packageName != "*") {
+            CHECK_ARGUMENT_PACKAGE_NAME(params.packageName);
+        }
+        if (!params.uuid.empty() && !is_valid_filename(params.uuid)) {
+            return exception(binder::Status::EX_ILLEGAL_ARGUMENT,
+                    StringPrintf("UUID %s is malformed", params.uuid.c_str()));
+        }
+        if (!params.outputPath.empty()) {
+            CHECK_ARGUMENT_PATH(params.outputPath);
+        }
+        if (!params.dexMetadataPath.empty()) {
+            CHECK_ARGUMENT_PATH(params.dexMetadataPath);
+        }
+    }
+
+    // Batch the requested profile merges first, under the service lock like mergeProfiles(),
+    // so every compilation below already sees its merged reference profile.
+    {
+        std::lock_guard<std::recursive_mutex> lock(mLock);
+        for (const auto& params : dexoptParams) {
+            if (!params.mergeProfile || params.packageName.empty() || params.packageName == "*" ||
+                    params.profileName.empty()) {
+                continue;
+            }
+            if (!analyze_primary_profiles(params.uid, params.packageName, params.profileName)) {
+                LOG(WARNING) << "Profile merge failed for " << params.packageName;
+            }
+        }
+    }
+
+    // The compilations deliberately run without mLock held: a batch can take many minutes and
+    // serializing every other binder call behind it would make installd unresponsive. Each job
+    // goes through the same oat dir setup and android::installd::dexopt() call as a plain
+    // dexopt() invocation.
+    std::vector<int32_t> results(dexoptParams.size(), 0);
+    std::mutex lock;
+    std::condition_variable slot_freed;
+    size_t running = 0;
+    std::vector<std::thread> workers;
+    workers.reserve(dexoptParams.size());
+
+    for (size_t i = 0; i < dexoptParams.size(); i++) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            // The limit is recomputed before every launch so the batch narrows down when the
+            // device comes under memory pressure while it runs.
+            slot_freed.wait(guard, [&]() { return running < getBatchDexoptConcurrency(); });
+            running++;
+        }
+        workers.emplace_back([this, i, &dexoptParams, &results, &lock, &slot_freed, &running,
+                              &callback]() {
+            const os::DexoptParams& params = dexoptParams[i];
+            // The callback is oneway, so these calls do not block on the receiver; a dead
+            // receiver only fails the notification, never the compilation.
+            if (callback != nullptr) {
+                callback->onDexoptStarted(params.apkPath, static_cast<int32_t>(i),
+                        static_cast<int32_t>(dexoptParams.size()));
+            }
+            const char* oat_dir = params.outputPath.empty() ? nullptr : params.outputPath.c_str();
+            if (oat_dir != nullptr && !createOatDir(params.outputPath,
+                    params.instructionSet).isOk()) {
+                // Can't create oat dir - let dexopt use cache dir.
+                oat_dir = nullptr;
+            }
+            std::string error_msg;
+            int res = android::installd::dexopt(params.apkPath.c_str(), params.uid,
+                    params.packageName.empty() ? "*" : params.packageName.c_str(),
+                    params.instructionSet.c_str(), params.dexoptNeeded, oat_dir, params.dexFlags,
+                    params.compilerFilter.c_str(),
+                    params.uuid.empty() ? nullptr : params.uuid.c_str(),
+                    params.classLoaderContext.empty() ? nullptr
+                                                      : params.classLoaderContext.c_str(),
+                    params.seInfo.empty() ? nullptr : params.seInfo.c_str(), params.downgrade,
+                    params.targetSdkVersion,
+                    params.profileName.empty() ? nullptr : params.profileName.c_str(),
+                    params.dexMetadataPath.empty() ? nullptr : params.dexMetadataPath.c_str(),
+                    params.compilationReason.empty() ? nullptr : params.compilationReason.c_str(),
+                    &error_msg);
+            if (res != 0) {
+                LOG(ERROR) << "batchDexopt of " << params.apkPath << " failed: " << error_msg;
+            }
+            results[i] = res;
+            if (callback != nullptr) {
+                callback->onDexoptFinished(params.apkPath, static_cast<int32_t>(i),
+                        static_cast<int32_t>(dexoptParams.size()), res);
+            }
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                running--;
+            }
+            slot_freed.notify_one();
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    *_aidl_return = std::move(results);
+    return ok();
+}
+
 binder::Status InstalldNativeService::compileLayouts(const std::string& apkPath,
                                                      const std::string& packageName,
                                                      const std ::string& outDexFile, int uid,
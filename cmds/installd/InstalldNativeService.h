@@ -116,6 +116,9 @@ public:
             const std::unique_ptr<std::string>& dexMetadataPath,
             const std::unique_ptr<std::string>& compilationReason);
 
+    binder::Status batchDexopt(const std::vector<os::DexoptParams>& dexoptParams,
+            const sp<os::IDexoptProgressCallback>& callback, std::vector<int32_t>* _aidl_return);
+
     binder::Status compileLayouts(const std::string& apkPath, const std::string& packageName,
                                   const std::string& outDexFile, int uid, bool* _aidl_return);
 
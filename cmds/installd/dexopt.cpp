@@ -2105,6 +2105,111 @@ static std::string format_dexopt_error(int status, const char* dex_path) {
   return StringPrintf("Dex2oat invocation for %s failed with 0x%04x", dex_path, status);
 }
 
+// Resumable dexopt.
+//
+// After a successful primary-dex compilation a small completion marker is written next to the
+// oat file, recording a fingerprint of everything that determined the artifacts. A later dexopt
+// of the same input with the same configuration finds the marker, sees that the artifacts are
+// already complete and returns without forking dex2oat. This is what lets an interrupted
+// multi-split optimization pass (e.g. an OTA postinstall window) resume where it stopped
+// instead of redoing the splits that already finished.
+//
+// The feature is gated by the dalvik.vm.resumable-dexopt property (off by default) because the
+// marker cannot distinguish a deliberately forced recompilation of unchanged input from a
+// redundant one; the OTA/batch paths that want resumability turn it on for their window.
+
+static bool resumable_dexopt_enabled() {
+    return GetBoolProperty("dalvik.vm.resumable-dexopt", false);
+}
+
+static std::string dexopt_completion_marker_path(const char* out_oat_path) {
+    return std::string(out_oat_path) + ".dexopt_state";
+}
+
+// Reads the checksum the dex file already carries: the adler32 field of a raw dex header.
+// APKs keep their per-entry checksums in the zip directory instead; for them this returns 0 and
+// the size/mtime part of the fingerprint covers the identity.
+static uint32_t read_dex_header_checksum(const char* path) {
+    unique_fd fd(TEMP_FAILURE_RETRY(open(path, O_RDONLY | O_CLOEXEC)));
+    if (fd.get() < 0) {
+        return 0;
+    }
+    uint8_t header[12];
+    if (!android::base::ReadFully(fd.get(), header, sizeof(header))) {
+        return 0;
+    }
+    if (memcmp(header, "dex\n", 4) != 0) {
+        return 0;
+    }
+    uint32_t checksum;
+    memcpy(&checksum, header + 8, sizeof(checksum));
+    return checksum;
+}
+
+// Fingerprint of everything that determines the compiled artifacts: the input file identity
+// (size, mtime and the checksum it carries), the compiler configuration, and the reference
+// profile when the compilation is profile guided. An empty string means "cannot fingerprint,
+// never skip".
+static std::string compute_dexopt_fingerprint(const char* dex_path, const char* compiler_filter,
+        const char* class_loader_context, bool profile_guided, const char* pkgname,
+        const char* profile_name) {
+    struct stat st;
+    if (stat(dex_path, &st) != 0) {
+        return "";
+    }
+    std::string fingerprint = StringPrintf("resumable-dexopt-v1\n%lld %lld %u\n%s\n%s\n",
+            static_cast<long long>(st.st_size), static_cast<long long>(st.st_mtime),
+            read_dex_header_checksum(dex_path), compiler_filter,
+            class_loader_context != nullptr ? class_loader_context : "-");
+    if (profile_guided && pkgname != nullptr && profile_name != nullptr) {
+        const std::string profile = create_reference_profile_path(pkgname, profile_name,
+                /*is_secondary_dex*/ false);
+        struct stat profile_st;
+        if (stat(profile.c_str(), &profile_st) == 0) {
+            fingerprint += StringPrintf("%lld %lld\n", static_cast<long long>(profile_st.st_size),
+                    static_cast<long long>(profile_st.st_mtime));
+        }
+    }
+    return fingerprint;
+}
+
+// Returns true when the marker written by a previous successful dexopt of the same input still
+// matches and the artifacts it recorded are in place, so the compilation can be skipped.
+static bool dexopt_already_complete(const char* out_oat_path, const std::string& fingerprint) {
+    if (fingerprint.empty()) {
+        return false;
+    }
+    std::string recorded;
+    if (!android::base::ReadFileToString(dexopt_completion_marker_path(out_oat_path), &recorded)) {
+        return false;
+    }
+    if (recorded != fingerprint) {
+        return false;
+    }
+    if (access(out_oat_path, F_OK) != 0 ||
+            access(create_vdex_filename(out_oat_path).c_str(), F_OK) != 0) {
+        return false;
+    }
+    return true;
+}
+
+static void record_dexopt_complete(const char* out_oat_path, const std::string& fingerprint) {
+    if (fingerprint.empty()) {
+        return;
+    }
+    const std::string marker = dexopt_completion_marker_path(out_oat_path);
+    const std::string temp = marker + ".tmp";
+    if (!android::base::WriteStringToFile(fingerprint, temp)) {
+        PLOG(WARNING) << "Could not write dexopt completion marker " << marker;
+        unlink(temp.c_str());
+        return;
+    }
+    if (rename(temp.c_str(), marker.c_str()) != 0) {
+        PLOG(WARNING) << "Could not commit dexopt completion marker " << marker;
+        unlink(temp.c_str());
+    }
+}
+
 int dexopt(const char* dex_path, uid_t uid, const char* pkgname, const char* instruction_set,
         int dexopt_needed, const char* oat_dir, int dexopt_flags, const char* compiler_filter,
         const char* volume_uuid, const char* class_loader_context, const char* se_info,
@@ -2168,6 +2273,25 @@ int dexopt(const char* dex_path, uid_t uid, const char* pkgname, const char* ins
         CHECK((dexopt_flags & DEXOPT_STORAGE_DE) == 0);
     }
 
+    // Resumable dexopt: skip the compilation when a completion marker from a previous
+    // successful run of exactly this input and configuration is still valid.
+    std::string completion_fingerprint;
+    char marker_oat_path[PKG_PATH_MAX];
+    bool have_marker_oat_path = false;
+    if (!is_secondary_dex && resumable_dexopt_enabled() &&
+            create_oat_out_path(dex_path, instruction_set, oat_dir, /*is_secondary_dex*/ false,
+                                marker_oat_path)) {
+        have_marker_oat_path = true;
+        completion_fingerprint = compute_dexopt_fingerprint(dex_path, compiler_filter,
+                class_loader_context, profile_guided, pkgname, profile_name);
+        if (dexopt_already_complete(marker_oat_path, completion_fingerprint)) {
+            LOG(INFO) << "Skipping dexopt of " << dex_path << ": artifacts already complete";
+            return 0;
+        }
+        // The artifacts are about to be rewritten; a stale marker must not outlive them.
+        unlink(dexopt_completion_marker_path(marker_oat_path).c_str());
+    }
+
     // Open the input file.
     unique_fd input_fd(open(dex_path, O_RDONLY, 0));
     if (input_fd.get() < 0) {
@@ -2297,6 +2421,10 @@ int dexopt(const char* dex_path, uid_t uid, const char* pkgname, const char* ins
     image_fd.SetCleanup(false);
     reference_profile_fd.SetCleanup(false);
 
+    if (have_marker_oat_path) {
+        record_dexopt_complete(marker_oat_path, completion_fingerprint);
+    }
+
     return 0;
 }
 
@@ -2698,6 +2826,9 @@ bool delete_odex(const char* apk_path, const char* instruction_set, const char*
     // Derive and delete the vdex file.
     bool return_value_vdex = unlink_and_check(create_vdex_filename(out_path).c_str());
 
+    // The completion marker (if any) refers to the artifacts just deleted.
+    unlink(dexopt_completion_marker_path(out_path).c_str());
+
     // Report success.
     return return_value_oat && return_value_art && return_value_vdex;
 }
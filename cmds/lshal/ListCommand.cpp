@@ -19,13 +19,16 @@
 #include <getopt.h>
 
 #include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <regex>
 #include <sstream>
+#include <thread>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
@@ -293,6 +296,10 @@ bool ListCommand::getPidInfo(
 }
 
 const PidInfo* ListCommand::getPidInfoCached(pid_t serverPid) {
+    // Serializes the debugfs scans, but entries for the same pid (HALs
+    // commonly share a process) are computed exactly once and the hwbinder
+    // round trips dominating fetch time still overlap.
+    std::lock_guard<std::mutex> lock(mCachedPidInfosMutex);
     auto pair = mCachedPidInfos.insert({serverPid, PidInfo{}});
     if (pair.second /* did insertion take place? */) {
         if (!getPidInfo(serverPid, &pair.first->second)) {
@@ -671,6 +678,7 @@ Status ListCommand::fetchBinderized(const sp<IServiceManager> &manager) {
 
     Status status = OK;
     std::map<std::string, TableEntry> allTableEntries;
+    std::vector<TableEntry*> entries;
     for (const auto &fqInstanceName : fqInstanceNames) {
         // create entry and default assign all fields.
         TableEntry& entry = allTableEntries[fqInstanceName];
@@ -678,7 +686,39 @@ Status ListCommand::fetchBinderized(const sp<IServiceManager> &manager) {
         entry.transport = mode;
         entry.serviceStatus = ServiceStatus::NON_RESPONSIVE;
 
-        status |= fetchBinderizedEntry(manager, &entry);
+        entries.push_back(&entry);
+    }
+
+    // Fetching an entry takes several sequential hwbinder round trips (get,
+    // getDebugInfo, interfaceChain, getHashChain), each of which may run into
+    // its IPC timeout on a wedged service. Query services concurrently on a
+    // bounded pool so the total time is governed by the slowest service
+    // rather than the sum of all of them. Map nodes are stable, so the
+    // workers can fill the entries in place; the table order is fixed by the
+    // map and unaffected by completion order.
+    const size_t numThreads = std::min(kFetchThreads, entries.size());
+    if (numThreads <= 1) {
+        for (TableEntry* entry : entries) {
+            status |= fetchBinderizedEntry(manager, entry);
+        }
+    } else {
+        std::atomic<size_t> nextEntry{0};
+        std::vector<Status> statuses(numThreads, OK);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < numThreads; ++i) {
+            threads.emplace_back([&, i] {
+                for (size_t e = nextEntry.fetch_add(1); e < entries.size();
+                     e = nextEntry.fetch_add(1)) {
+                    statuses[i] |= fetchBinderizedEntry(manager, entries[e]);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (Status threadStatus : statuses) {
+            status |= threadStatus;
+        }
     }
 
     for (auto& pair : allTableEntries) {
@@ -691,6 +731,8 @@ Status ListCommand::fetchBinderizedEntry(const sp<IServiceManager> &manager,
                                          TableEntry *entry) {
     Status status = OK;
     const auto handleError = [&](Status additionalError, const std::string& msg) {
+        // Runs on the fetch pool; keep each warning line atomic.
+        std::lock_guard<std::mutex> lock(mErrLock);
         err() << "Warning: Skipping \"" << entry->interfaceName << "\": " << msg << std::endl;
         status |= DUMP_BINDERIZED_ERROR | additionalError;
     };
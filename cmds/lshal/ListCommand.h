@@ -20,6 +20,8 @@
 #include <stdint.h>
 
 #include <fstream>
+#include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -187,9 +189,19 @@ protected:
     // If an entry exist and not empty, it contains the cached content of /proc/{pid}/cmdline.
     std::map<pid_t, std::string> mCmdlines;
 
-    // Cache for getPidInfo.
+    // Number of worker threads used by fetchBinderized to query services
+    // concurrently. The queries are IPC-bound, so a small pool suffices.
+    static constexpr size_t kFetchThreads = 8;
+
+    // Cache for getPidInfo, shared by the fetch pool. Lives for a single
+    // lshal invocation, so entries cannot outlive the services they
+    // describe by more than the run itself.
+    std::mutex mCachedPidInfosMutex;
     std::map<pid_t, PidInfo> mCachedPidInfos;
 
+    // Keeps warning lines from concurrent fetches from interleaving.
+    std::mutex mErrLock;
+
     // Cache for getPartition.
     std::map<pid_t, Partition> mPartitions;
 
@@ -25,6 +25,24 @@ __BEGIN_DECLS
 int64_t stat_size(struct stat *s);
 int64_t calculate_dir_size(int dfd);
 
+/*
+ * Incremental cache for repeated tree sizing. Each entry remembers a
+ * directory's tree size keyed on the directory's own mtime plus a short
+ * TTL: direct entry changes (create, delete, rename) invalidate
+ * immediately, writes deeper in the tree are picked up when the TTL
+ * expires. Not thread-safe; callers serialize access themselves.
+ */
+struct dir_size_cache;
+
+struct dir_size_cache *dir_size_cache_create(void);
+void dir_size_cache_destroy(struct dir_size_cache *cache);
+
+/*
+ * Like calculate_dir_size(), but consults and fills |cache|. Opens
+ * |path| itself; returns 0 when the directory cannot be opened.
+ */
+int64_t calculate_dir_size_cached(const char *path, struct dir_size_cache *cache);
+
 __END_DECLS
 
 #endif /* __LIBDISKUSAGE_DIRSIZE_H */
@@ -59,6 +59,21 @@ class Parcel;
  * compiler. When a new field is added to the struct, the corresponding change
  * in StructLayout_test should be made.
  */
+/*
+ * Per-pointer state computed once on the dispatcher side and shipped with each
+ * motion message, so that clients do not each re-run their own VelocityTracker
+ * over the stream and flings behave consistently across apps. All values are
+ * in the raw (display) coordinate space. The state is optional; consumers must
+ * check valid before using the other fields.
+ */
+struct PointerComputedState {
+    bool valid{false};
+    float velocityX{0.f};        // pixels per second
+    float velocityY{0.f};        // pixels per second
+    float predictedX{0.f};       // position extrapolated one frame ahead
+    float predictedY{0.f};
+};
+
 struct InputMessage {
     enum class Type : uint32_t {
         KEY,
@@ -135,6 +150,14 @@ struct InputMessage {
              */
             struct Pointer {
                 PointerProperties properties;
+                // Computed-state channel (see PointerComputedState); all
+                // zeroes when the publisher did not provide one.
+                uint32_t computedStateValid; // actually a bool
+                float velocityX;
+                float velocityY;
+                float predictedX;
+                float predictedY;
+                uint32_t empty1;
                 PointerCoords coords;
             } pointers[MAX_POINTERS] __attribute__((aligned(8)));
 
@@ -178,6 +201,10 @@ struct InputMessage {
  * An input channel consists of a local unix domain socket used to send and receive
  * input messages across processes.  Each channel has a descriptive name for debugging purposes.
  *
+ * When the shared ring transport is enabled (ro.input.shared_ring), the pair additionally
+ * shares an anonymous shared memory region and messages are exchanged through a lock-free
+ * ring in that region instead, with the socket reduced to a wakeup mechanism.
+ *
  * Each endpoint has its own InputChannel object that specifies its file descriptor.
  *
  * The input channel is closed when all references to it are released.
@@ -250,10 +277,21 @@ public:
 
 private:
     InputChannel(const std::string& name, android::base::unique_fd fd, sp<IBinder> token);
+
+    void setSharedRing(android::base::unique_fd ringFd, int32_t role);
+
     std::string mName;
     android::base::unique_fd mFd;
 
     sp<IBinder> mToken;
+
+    // Optional shared memory ring transport, negotiated when the channel pair is
+    // opened.  When present, messages travel through the mapped ring and the
+    // socket only carries wakeup bytes.  The role selects which of the two
+    // single-producer / single-consumer rings this endpoint publishes into.
+    android::base::unique_fd mSharedRingFd;
+    void* mSharedRingMemory = nullptr;
+    int32_t mSharedRingRole = -1;
 };
 
 /*
@@ -300,7 +338,8 @@ public:
                                 float xCursorPosition, float yCursorPosition, nsecs_t downTime,
                                 nsecs_t eventTime, uint32_t pointerCount,
                                 const PointerProperties* pointerProperties,
-                                const PointerCoords* pointerCoords);
+                                const PointerCoords* pointerCoords,
+                                const PointerComputedState* computedStates = nullptr);
 
     /* Publishes a focus event to the input channel.
      *
@@ -370,6 +409,20 @@ public:
                      uint32_t* outSeq, InputEvent** outEvent,
                      int* motionEventType, int* touchMoveNumber, bool* flag);
 
+    /* Consumes pending messages in one pass for a display frame that started rendering
+     * at frameTime.
+     *
+     * Equivalent to calling consume() with consumeBatches == true, but without requiring
+     * the caller to thread the internal bookkeeping out-parameters through its loop.  The
+     * channel is drained before batches are consumed, so move events still queued when
+     * the render loop wakes up are folded into the same batch rather than delivered as
+     * separate events.  Each call returns at most one event; call it in a loop until it
+     * returns WOULD_BLOCK to obtain one coalesced motion event per device and source
+     * plus any non-batchable events that arrived in between.
+     */
+    status_t consumeBatchedUpTo(InputEventFactoryInterface* factory, nsecs_t frameTime,
+                                uint32_t* outSeq, InputEvent** outEvent);
+
     /* Sends a finished signal to the publisher to inform it that the message
      * with the specified sequence number has finished being process and whether
      * the message was handled by the consumer.
@@ -412,12 +465,37 @@ public:
      */
     int32_t getPendingBatchSource() const;
 
+    /* Returns the dispatcher-computed state for the given pointer index of the most
+     * recently consumed motion event. The returned state is invalid when the publisher
+     * did not provide one (e.g. non-touch streams) or the index is out of range, in
+     * which case callers should fall back to their own tracking.
+     */
+    PointerComputedState getComputedState(size_t pointerIndex) const;
+
+    /**
+     * Sets how far ahead of the frame time resampling may synthesize coordinates
+     * when predictive touch synthesis is enabled (see "ro.input.touch_prediction").
+     * The caller passes the measured render pipeline depth of the window's display,
+     * typically a small multiple of the display's refresh period, so a 120Hz stylus
+     * path can run a deeper prediction than a 60Hz touch path. The lead is clamped
+     * internally to bound mispredictions. Has no effect when prediction is disabled.
+     */
+    void setPredictionLead(nsecs_t predictionLead);
+
 private:
     int mTouchMoveCounter = 0;
 
     // True if touch resampling is enabled.
     const bool mResampleTouch;
 
+    // True if predictive touch synthesis is enabled.
+    const bool mPredictTouch;
+
+    // How far ahead of the frame time to synthesize coordinates when prediction is
+    // enabled.  Initialized from "ro.input.touch_prediction_lead" and adjusted at
+    // runtime through setPredictionLead().
+    nsecs_t mPredictionLead;
+
     // The input channel.
     sp<InputChannel> mChannel;
 
@@ -473,11 +551,15 @@ private:
         }
     };
     struct TouchState {
+        // Two samples are all that plain resampling needs; the third feeds the
+        // curvature term of the prediction model.
+        static constexpr size_t kHistoryDepth = 3;
+
         int32_t deviceId;
         int32_t source;
         size_t historyCurrent;
         size_t historySize;
-        History history[2];
+        History history[kHistoryDepth];
         History lastResample;
 
         void initialize(int32_t deviceId, int32_t source) {
@@ -490,15 +572,15 @@ private:
         }
 
         void addHistory(const InputMessage& msg) {
-            historyCurrent ^= 1;
-            if (historySize < 2) {
+            historyCurrent = (historyCurrent + 1) % kHistoryDepth;
+            if (historySize < kHistoryDepth) {
                 historySize += 1;
             }
             history[historyCurrent].initializeFrom(msg);
         }
 
         const History* getHistory(size_t index) const {
-            return &history[(historyCurrent + index) & 1];
+            return &history[(historyCurrent + kHistoryDepth - index) % kHistoryDepth];
         }
 
         bool recentCoordinatesAreIdentical(uint32_t id) const {
@@ -521,6 +603,12 @@ private:
     };
     Vector<TouchState> mTouchStates;
 
+    // Scratch space for resampleTouchState.  The consumer is only ever used from its
+    // looper thread, so reusing these avoids re-creating multi-kilobyte History objects
+    // on the stack for every resampled batch.
+    History mFutureSampleScratch;
+    History mOldLastResampleScratch;
+
     // Chain of batched sequence numbers.  When multiple input messages are combined into
     // a batch, we append a record here that associates the last sequence number in the
     // batch with the previous one.  When the finished signal is sent, we traverse the
@@ -542,6 +630,12 @@ private:
     void resampleTouchState(nsecs_t frameTime, MotionEvent* event,
             const InputMessage *next);
 
+    // Computed state of the most recently consumed motion message, indexed by
+    // pointer index. Refreshed from the newest sample whenever a motion event
+    // is handed out.
+    PointerComputedState mComputedStates[MAX_POINTERS];
+    void updateComputedStates(const InputMessage& msg);
+
     ssize_t findBatch(int32_t deviceId, int32_t source) const;
     ssize_t findTouchState(int32_t deviceId, int32_t source) const;
 
@@ -555,8 +649,12 @@ private:
     static bool canAddSample(const Batch& batch, const InputMessage* msg);
     static ssize_t findSampleNoLaterThan(const Batch& batch, nsecs_t time);
     static bool shouldResampleTool(int32_t toolType);
+    static bool shouldPredictTool(int32_t toolType);
+    static bool predictPointer(const TouchState& touchState, uint32_t id, nsecs_t sampleTime,
+            PointerCoords& outCoords);
 
     static bool isTouchResamplingEnabled();
+    static bool isTouchPredictionEnabled();
 };
 
 } // namespace android
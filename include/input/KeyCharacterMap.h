@@ -80,6 +80,18 @@ public:
     static status_t loadContents(const std::string& filename,
             const char* contents, Format format, sp<KeyCharacterMap>* outMap);
 
+    /* Loads a precompiled key character map produced by saveCompiled().
+     * The file consists of flat index-based tables and is mapped read-only,
+     * so loading it involves no text parsing and its pages are shared across
+     * processes through the page cache. */
+    static status_t loadCompiled(const std::string& filename, Format format,
+            sp<KeyCharacterMap>* outMap);
+
+    /* Writes this key character map in the precompiled format read by
+     * loadCompiled().  Meant to be run once per layout, at build time or on
+     * first boot, so that subsequent loads skip the text parser. */
+    status_t saveCompiled(const std::string& filename) const;
+
     /* Combines a base key character map and an overlay. */
     static sp<KeyCharacterMap> combine(const sp<KeyCharacterMap>& base,
             const sp<KeyCharacterMap>& overlay);
@@ -24,6 +24,11 @@
 namespace android {
 
 class LatencyStatistics {
+public:
+    /* Number of histogram buckets. Bucket 0 covers [0, 1), bucket i covers
+     * [2^(i-1), 2^i), and the last bucket absorbs everything larger. */
+    static constexpr size_t NUM_BUCKETS = 64;
+
 private:
     /* Minimum sample recorded */
     float mMin;
@@ -35,6 +40,9 @@ private:
     float mSum2;
     /* Count of all samples recorded */
     size_t mCount;
+    /* Power-of-two bucketed histogram of all samples recorded, for estimating
+     * percentiles without retaining the samples themselves */
+    size_t mBuckets[NUM_BUCKETS];
     /* The last time statistics were reported */
     std::chrono::steady_clock::time_point mLastReportTime;
     /* Statistics Report Frequency */
@@ -51,6 +59,7 @@ public:
     float getMin();
     float getMax();
     float getStDev();
+    float getPercentile(float fraction);
     size_t getCount();
 };
 
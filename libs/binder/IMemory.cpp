@@ -17,7 +17,9 @@
 #define LOG_TAG "IMemory"
 
 #include <atomic>
+#include <memory>
 #include <stdatomic.h>
+#include <vector>
 
 #include <fcntl.h>
 #include <stdint.h>
@@ -56,13 +58,16 @@ private:
     // For IMemory.cpp
     struct heap_info_t {
         sp<IMemoryHeap> heap;
-        int32_t         count;
-        // Note that this cannot be meaningfully copied.
+        // Shared between copies of the entry so that concurrent lookups holding only
+        // the read lock all bump the same counter.
+        std::shared_ptr<std::atomic<int32_t>> count;
     };
 
     void free_heap(const wp<IBinder>& binder);
 
-    Mutex mHeapCacheLock;  // Protects entire vector below.
+    // Held for writing only to insert or evict entries; the hit path of find_heap
+    // takes it for reading, so concurrent getMemory calls no longer serialize.
+    mutable RWLock mHeapCacheLock;
     KeyedVector< wp<IBinder>, heap_info_t > mHeapCache;
     // We do not use the copy-on-write capabilities of KeyedVector.
     // TODO: Reimplemement based on standard C++ container?
@@ -124,6 +129,10 @@ enum {
     GET_MEMORY = IBinder::FIRST_CALL_TRANSACTION
 };
 
+// Upper bound a proxy accepts for an inline payload, guarding the local copy against
+// a hostile server regardless of the limit the server claims to apply.
+static constexpr size_t kMaxInlineTransfer = 4096;
+
 class BpMemory : public BpInterface<IMemory>
 {
 public:
@@ -131,11 +140,15 @@ public:
     virtual ~BpMemory();
     // NOLINTNEXTLINE(google-default-arguments)
     virtual sp<IMemoryHeap> getMemory(ssize_t* offset=nullptr, size_t* size=nullptr) const;
+    virtual void* unsecurePointer() const;
 
 private:
     mutable sp<IMemoryHeap> mHeap;
     mutable ssize_t mOffset;
     mutable size_t mSize;
+    // Payload copied out of the reply Parcel when the server transferred it inline
+    // instead of sending the heap binder (see BnMemory::setInlineTransferLimit).
+    mutable std::vector<uint8_t> mInlineData;
 };
 
 /******************************************************************************/
@@ -186,9 +199,12 @@ BpMemory::~BpMemory()
 // NOLINTNEXTLINE(google-default-arguments)
 sp<IMemoryHeap> BpMemory::getMemory(ssize_t* offset, size_t* size) const
 {
-    if (mHeap == nullptr) {
+    if (mHeap == nullptr && mInlineData.empty()) {
         Parcel data, reply;
         data.writeInterfaceToken(IMemory::getInterfaceDescriptor());
+        // Advertise that a small payload may be returned inline instead of as a
+        // heap binder; old servers ignore the trailing bool.
+        data.writeBool(true);
         if (remote()->transact(GET_MEMORY, data, &reply) == NO_ERROR) {
             sp<IBinder> heap = reply.readStrongBinder();
             if (heap != nullptr) {
@@ -213,6 +229,20 @@ sp<IMemoryHeap> BpMemory::getMemory(ssize_t* offset, size_t* size) const
                         mSize = 0;
                     }
                 }
+            } else {
+                // The server transferred the payload inline; keep a local copy and
+                // leave mHeap null.
+                const uint64_t size64 = reply.readUint64();
+                const size_t s = (size_t)size64;
+                if (s == size64 && s > 0 && s <= kMaxInlineTransfer) {
+                    mInlineData.resize(s);
+                    if (reply.read(mInlineData.data(), s) == NO_ERROR) {
+                        mOffset = 0;
+                        mSize = s;
+                    } else {
+                        mInlineData.clear();
+                    }
+                }
             }
         }
     }
@@ -221,6 +251,19 @@ sp<IMemoryHeap> BpMemory::getMemory(ssize_t* offset, size_t* size) const
     return (mSize > 0) ? mHeap : nullptr;
 }
 
+void* BpMemory::unsecurePointer() const
+{
+    ssize_t offset;
+    sp<IMemoryHeap> heap = getMemory(&offset);
+    if (heap != nullptr) {
+        void* const base = heap->base();
+        if (base == MAP_FAILED)
+            return nullptr;
+        return static_cast<char*>(base) + offset;
+    }
+    return mInlineData.empty() ? nullptr : mInlineData.data();
+}
+
 // ---------------------------------------------------------------------------
 
 IMPLEMENT_META_INTERFACE(Memory, "android.utils.IMemory")
@@ -231,6 +274,10 @@ BnMemory::BnMemory() {
 BnMemory::~BnMemory() {
 }
 
+void BnMemory::setInlineTransferLimit(size_t limit) {
+    mInlineTransferLimit = limit;
+}
+
 // NOLINTNEXTLINE(google-default-arguments)
 status_t BnMemory::onTransact(
     uint32_t code, const Parcel& data, Parcel* reply, uint32_t flags)
@@ -240,7 +287,21 @@ status_t BnMemory::onTransact(
             CHECK_INTERFACE(IMemory, data, reply);
             ssize_t offset;
             size_t size;
-            reply->writeStrongBinder( IInterface::asBinder(getMemory(&offset, &size)) );
+            sp<IMemoryHeap> heap = getMemory(&offset, &size);
+            // Old callers do not write the trailing bool, in which case readBool
+            // comes back false and they get the binder reply they expect.
+            const bool acceptsInline = data.readBool();
+            if (acceptsInline && mInlineTransferLimit > 0 && heap != nullptr &&
+                    size > 0 && size <= mInlineTransferLimit) {
+                void* const base = heap->base();
+                if (base != MAP_FAILED) {
+                    reply->writeStrongBinder(nullptr);
+                    reply->writeUint64(size);
+                    reply->write(static_cast<const char*>(base) + offset, size);
+                    return NO_ERROR;
+                }
+            }
+            reply->writeStrongBinder(IInterface::asBinder(heap));
             reply->writeInt64(offset);
             reply->writeUint64(size);
             return NO_ERROR;
@@ -433,28 +494,38 @@ void HeapCache::binderDied(const wp<IBinder>& binder)
 
 sp<IMemoryHeap> HeapCache::find_heap(const sp<IBinder>& binder)
 {
-    Mutex::Autolock _l(mHeapCacheLock);
+    {
+        RWLock::AutoRLock _l(mHeapCacheLock);
+        ssize_t i = mHeapCache.indexOfKey(binder);
+        if (i>=0) {
+            const heap_info_t& info = mHeapCache.valueAt(i);
+            ALOGD_IF(VERBOSE,
+                    "found binder=%p, heap=%p, size=%zu, fd=%d, count=%d",
+                    binder.get(), info.heap.get(),
+                    static_cast<BpMemoryHeap*>(info.heap.get())->mSize,
+                    static_cast<BpMemoryHeap*>(info.heap.get())
+                        ->mHeapId.load(memory_order_relaxed),
+                    info.count->load(std::memory_order_relaxed));
+            info.count->fetch_add(1, std::memory_order_relaxed);
+            return info.heap;
+        }
+    }
+
+    RWLock::AutoWLock _l(mHeapCacheLock);
     ssize_t i = mHeapCache.indexOfKey(binder);
     if (i>=0) {
-        heap_info_t& info = mHeapCache.editValueAt(i);
-        ALOGD_IF(VERBOSE,
-                "found binder=%p, heap=%p, size=%zu, fd=%d, count=%d",
-                binder.get(), info.heap.get(),
-                static_cast<BpMemoryHeap*>(info.heap.get())->mSize,
-                static_cast<BpMemoryHeap*>(info.heap.get())
-                    ->mHeapId.load(memory_order_relaxed),
-                info.count);
-        ++info.count;
-        return info.heap;
-    } else {
-        heap_info_t info;
-        info.heap = interface_cast<IMemoryHeap>(binder);
-        info.count = 1;
-        //ALOGD("adding binder=%p, heap=%p, count=%d",
-        //      binder.get(), info.heap.get(), info.count);
-        mHeapCache.add(binder, info);
+        // Another thread inserted the entry while the read lock was dropped.
+        const heap_info_t& info = mHeapCache.valueAt(i);
+        info.count->fetch_add(1, std::memory_order_relaxed);
         return info.heap;
     }
+    heap_info_t info;
+    info.heap = interface_cast<IMemoryHeap>(binder);
+    info.count = std::make_shared<std::atomic<int32_t>>(1);
+    //ALOGD("adding binder=%p, heap=%p, count=%d",
+    //      binder.get(), info.heap.get(), info.count);
+    mHeapCache.add(binder, info);
+    return info.heap;
 }
 
 void HeapCache::free_heap(const sp<IBinder>& binder)  {
@@ -465,18 +536,18 @@ void HeapCache::free_heap(const wp<IBinder>& binder)
 {
     sp<IMemoryHeap> rel;
     {
-        Mutex::Autolock _l(mHeapCacheLock);
+        RWLock::AutoWLock _l(mHeapCacheLock);
         ssize_t i = mHeapCache.indexOfKey(binder);
         if (i>=0) {
-            heap_info_t& info(mHeapCache.editValueAt(i));
-            if (--info.count == 0) {
+            const heap_info_t& info(mHeapCache.valueAt(i));
+            if (info.count->fetch_sub(1, std::memory_order_relaxed) == 1) {
                 ALOGD_IF(VERBOSE,
                         "removing binder=%p, heap=%p, size=%zu, fd=%d, count=%d",
                         binder.unsafe_get(), info.heap.get(),
                         static_cast<BpMemoryHeap*>(info.heap.get())->mSize,
                         static_cast<BpMemoryHeap*>(info.heap.get())
                             ->mHeapId.load(memory_order_relaxed),
-                        info.count);
+                        info.count->load(std::memory_order_relaxed));
                 rel = mHeapCache.valueAt(i).heap;
                 mHeapCache.removeItemsAt(i);
             }
@@ -489,7 +560,7 @@ void HeapCache::free_heap(const wp<IBinder>& binder)
 sp<IMemoryHeap> HeapCache::get_heap(const sp<IBinder>& binder)
 {
     sp<IMemoryHeap> realHeap;
-    Mutex::Autolock _l(mHeapCacheLock);
+    RWLock::AutoRLock _l(mHeapCacheLock);
     ssize_t i = mHeapCache.indexOfKey(binder);
     if (i>=0)   realHeap = mHeapCache.valueAt(i).heap;
     else        realHeap = interface_cast<IMemoryHeap>(binder);
@@ -498,14 +569,14 @@ sp<IMemoryHeap> HeapCache::get_heap(const sp<IBinder>& binder)
 
 void HeapCache::dump_heaps()
 {
-    Mutex::Autolock _l(mHeapCacheLock);
+    RWLock::AutoRLock _l(mHeapCacheLock);
     int c = mHeapCache.size();
     for (int i=0 ; i<c ; i++) {
         const heap_info_t& info = mHeapCache.valueAt(i);
         BpMemoryHeap const* h(static_cast<BpMemoryHeap const *>(info.heap.get()));
         ALOGD("hey=%p, heap=%p, count=%d, (fd=%d, base=%p, size=%zu)",
                 mHeapCache.keyAt(i).unsafe_get(),
-                info.heap.get(), info.count,
+                info.heap.get(), info.count->load(std::memory_order_relaxed),
                 h->mHeapId.load(memory_order_relaxed), h->mBase, h->mSize);
     }
 }
@@ -31,6 +31,7 @@
 
 #include <private/binder/binder_module.h>
 
+#include <algorithm>
 #include <atomic>
 #include <errno.h>
 #include <inttypes.h>
@@ -829,8 +830,22 @@ status_t IPCThreadState::clearDeathNotification(int32_t handle, BpBinder* proxy)
     return NO_ERROR;
 }
 
+// Initial capacity of the transaction buffers, and the floor they are trimmed
+// back to.
+static constexpr size_t kTransactionBufferSize = 256;
+// Number of driver exchanges between attempts to trim mIn/mOut back to the
+// largest payload seen during the previous window.
+static constexpr size_t kTransactionBufferTrimInterval = 512;
+// Reply parcels are recycled unless the pool is full or their buffer grew
+// beyond this size.
+static constexpr size_t kMaxReplyParcelPoolSize = 4;
+static constexpr size_t kMaxReplyParcelCacheSize = 64 * 1024;
+
 IPCThreadState::IPCThreadState()
     : mProcess(ProcessState::self()),
+      mInHighWaterMark(0),
+      mOutHighWaterMark(0),
+      mTrimCountdown(kTransactionBufferTrimInterval),
       mServingStackPointer(nullptr),
       mWorkSource(kUnsetWorkSource),
       mPropagateWorkSource(false),
@@ -841,12 +856,39 @@ IPCThreadState::IPCThreadState()
 {
     pthread_setspecific(gTLS, this);
     clearCaller();
-    mIn.setDataCapacity(256);
-    mOut.setDataCapacity(256);
+    mIn.setDataCapacity(kTransactionBufferSize);
+    mOut.setDataCapacity(kTransactionBufferSize);
 }
 
 IPCThreadState::~IPCThreadState()
 {
+    for (size_t i = 0; i < mReplyParcelPool.size(); i++) {
+        delete mReplyParcelPool[i];
+    }
+}
+
+Parcel* IPCThreadState::obtainReplyParcel()
+{
+    // IPCThreadState is thread-local, so the pool needs no locking; a nested
+    // transaction arriving while a reply is in use simply pops the next one.
+    if (!mReplyParcelPool.isEmpty()) {
+        Parcel* reply = mReplyParcelPool.top();
+        mReplyParcelPool.pop();
+        return reply;
+    }
+    return new Parcel;
+}
+
+void IPCThreadState::recycleReplyParcel(Parcel* reply)
+{
+    if (mReplyParcelPool.size() >= kMaxReplyParcelPoolSize ||
+            reply->dataCapacity() > kMaxReplyParcelCacheSize) {
+        delete reply;
+        return;
+    }
+    // Releases any objects and resets the parcel while keeping its buffer.
+    reply->restartWrite(reply->dataCapacity());
+    mReplyParcelPool.push(reply);
 }
 
 status_t IPCThreadState::sendReply(const Parcel& reply, uint32_t flags)
@@ -965,10 +1007,29 @@ status_t IPCThreadState::talkWithDriver(bool doReceive)
     // Is the read buffer empty?
     const bool needRead = mIn.dataPosition() >= mIn.dataSize();
 
+    // High-water-mark decay: every kTransactionBufferTrimInterval exchanges,
+    // shrink the transaction buffers back toward the largest payload seen in
+    // the last window, so a single oversized transaction does not pin its
+    // buffer for the lifetime of the thread.
+    if (--mTrimCountdown == 0) {
+        mTrimCountdown = kTransactionBufferTrimInterval;
+        const size_t outTarget = std::max(mOutHighWaterMark, kTransactionBufferSize);
+        if (mOut.dataSize() == 0 && mOut.dataCapacity() > 2*outTarget) {
+            mOut.restartWrite(outTarget);
+        }
+        const size_t inTarget = std::max(mInHighWaterMark, kTransactionBufferSize);
+        if (needRead && mIn.dataCapacity() > 2*inTarget) {
+            mIn.restartWrite(inTarget);
+        }
+        mOutHighWaterMark = 0;
+        mInHighWaterMark = 0;
+    }
+
     // We don't want to write anything if we are still reading
     // from data left in the input buffer and the caller
     // has requested to read the next data.
     const size_t outAvail = (!doReceive || needRead) ? mOut.dataSize() : 0;
+    mOutHighWaterMark = std::max(mOutHighWaterMark, outAvail);
 
     bwr.write_size = outAvail;
     bwr.write_buffer = (uintptr_t)mOut.data();
@@ -1044,6 +1105,7 @@ status_t IPCThreadState::talkWithDriver(bool doReceive)
         if (bwr.read_consumed > 0) {
             mIn.setDataSize(bwr.read_consumed);
             mIn.setDataPosition(0);
+            mInHighWaterMark = std::max(mInHighWaterMark, (size_t)bwr.read_consumed);
         }
         IF_LOG_COMMANDS() {
             TextOutput::Bundle _b(alog);
@@ -1231,7 +1293,7 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
             // ALOGI(">>>> TRANSACT from pid %d sid %s uid %d\n", mCallingPid,
             //    (mCallingSid ? mCallingSid : "<N/A>"), mCallingUid);
 
-            Parcel reply;
+            Parcel* reply = obtainReplyParcel();
             status_t error;
             IF_LOG_TRANSACTIONS() {
                 TextOutput::Bundle _b(alog);
@@ -1250,14 +1312,14 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
                 if (reinterpret_cast<RefBase::weakref_type*>(
                         tr.target.ptr)->attemptIncStrong(this)) {
                     error = reinterpret_cast<BBinder*>(tr.cookie)->transact(tr.code, buffer,
-                            &reply, tr.flags);
+                            reply, tr.flags);
                     reinterpret_cast<BBinder*>(tr.cookie)->decStrong(this);
                 } else {
                     error = UNKNOWN_TRANSACTION;
                 }
 
             } else {
-                error = the_context_object->transact(tr.code, buffer, &reply, tr.flags);
+                error = the_context_object->transact(tr.code, buffer, reply, tr.flags);
             }
 
             //ALOGI("<<<< TRANSACT from pid %d restore pid %d sid %s uid %d\n",
@@ -1265,13 +1327,13 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
 
             if ((tr.flags & TF_ONE_WAY) == 0) {
                 LOG_ONEWAY("Sending reply to %d!", mCallingPid);
-                if (error < NO_ERROR) reply.setError(error);
-                sendReply(reply, 0);
+                if (error < NO_ERROR) reply->setError(error);
+                sendReply(*reply, 0);
             } else {
-                if (error != OK || reply.dataSize() != 0) {
+                if (error != OK || reply->dataSize() != 0) {
                     alog << "oneway function results will be dropped but finished with status "
                          << statusToString(error)
-                         << " and parcel size " << reply.dataSize() << endl;
+                         << " and parcel size " << reply->dataSize() << endl;
                 }
                 LOG_ONEWAY("NOT sending reply to %d!", mCallingPid);
             }
@@ -1288,9 +1350,13 @@ status_t IPCThreadState::executeCommand(int32_t cmd)
             IF_LOG_TRANSACTIONS() {
                 TextOutput::Bundle _b(alog);
                 alog << "BC_REPLY thr " << (void*)pthread_self() << " / obj "
-                    << tr.target.ptr << ": " << indent << reply << dedent << endl;
+                    << tr.target.ptr << ": " << indent << *reply << dedent << endl;
             }
 
+            // The reply has been consumed by the driver at this point, so its
+            // buffer can be recycled for the next incoming transaction.
+            recycleReplyParcel(reply);
+
         }
         break;
 
@@ -38,6 +38,9 @@
 
 #include <unistd.h>
 
+#include <map>
+#include <mutex>
+
 namespace android {
 
 using AidlServiceManager = android::os::IServiceManager;
@@ -59,6 +62,7 @@ const String16& IServiceManager::getInterfaceDescriptor() const {
 }
 IServiceManager::IServiceManager() {}
 IServiceManager::~IServiceManager() {}
+void IServiceManager::cacheServices(const Vector<String16>&) {}
 
 // From the old libbinder IServiceManager interface to IServiceManager.
 class ServiceManagerShim : public IServiceManager
@@ -73,6 +77,7 @@ public:
     Vector<String16> listServices(int dumpsysPriority) override;
     sp<IBinder> waitForService(const String16& name16) override;
     bool isDeclared(const String16& name) override;
+    void cacheServices(const Vector<String16>& names) override;
 
     // for legacy ABI
     const String16& getInterfaceDescriptor() const override {
@@ -82,7 +87,48 @@ public:
         return IInterface::asBinder(mTheRealServiceManager).get();
     }
 private:
+    // Keeps the handle cache current: servicemanager pushes the new binder
+    // when a cached service is (re-)registered, and the kernel notifies us
+    // when a cached handle dies.
+    class CacheUpdater;
+
+    void updateCachedService(const std::string& name,
+                             const sp<IBinder>& binder) const;
+    void dropCachedService(const wp<IBinder>& who);
+
     sp<AidlServiceManager> mTheRealServiceManager;
+
+    // Handles for the services named in a cacheServices call. An entry
+    // exists for every cached name; the value is null until the service has
+    // been seen (or after its handle has died). Guarded by mCacheMutex.
+    mutable std::mutex mCacheMutex;
+    mutable std::map<std::string, sp<IBinder>> mCachedServices;
+    sp<CacheUpdater> mCacheUpdater;
+};
+
+class ServiceManagerShim::CacheUpdater : public android::os::BnServiceCallback,
+                                         public IBinder::DeathRecipient {
+public:
+    explicit CacheUpdater(const wp<ServiceManagerShim>& shim) : mShim(shim) {}
+
+    Status onRegistration(const std::string& name,
+                          const sp<IBinder>& binder) override {
+        if (sp<ServiceManagerShim> shim = mShim.promote()) {
+            shim->updateCachedService(name, binder);
+        }
+        // Flushing here helps ensure the service's ref count remains accurate
+        IPCThreadState::self()->flushCommands();
+        return Status::ok();
+    }
+
+    void binderDied(const wp<IBinder>& who) override {
+        if (sp<ServiceManagerShim> shim = mShim.promote()) {
+            shim->dropCachedService(who);
+        }
+    }
+
+private:
+    wp<ServiceManagerShim> mShim;
 };
 
 [[clang::no_destroy]] static std::once_flag gSmOnce;
@@ -245,10 +291,27 @@ sp<IBinder> ServiceManagerShim::getService(const String16& name) const
 
 sp<IBinder> ServiceManagerShim::checkService(const String16& name) const
 {
+    const std::string nameStr = String8(name).c_str();
+
+    bool cached = false;
+    {
+        std::lock_guard<std::mutex> lock(mCacheMutex);
+        auto it = mCachedServices.find(nameStr);
+        if (it != mCachedServices.end()) {
+            cached = true;
+            if (it->second != nullptr && it->second->isBinderAlive()) {
+                return it->second;
+            }
+        }
+    }
+
     sp<IBinder> ret;
-    if (!mTheRealServiceManager->checkService(String8(name).c_str(), &ret).isOk()) {
+    if (!mTheRealServiceManager->checkService(nameStr, &ret).isOk()) {
         return nullptr;
     }
+    if (cached && ret != nullptr) {
+        updateCachedService(nameStr, ret);
+    }
     return ret;
 }
 
@@ -356,4 +419,86 @@ bool ServiceManagerShim::isDeclared(const String16& name) {
     return declared;
 }
 
+void ServiceManagerShim::cacheServices(const Vector<String16>& names)
+{
+    {
+        std::lock_guard<std::mutex> lock(mCacheMutex);
+        if (mCacheUpdater == nullptr) {
+            mCacheUpdater = new CacheUpdater(this);
+        }
+    }
+
+    for (const String16& name16 : names) {
+        const std::string name = String8(name16).c_str();
+        {
+            std::lock_guard<std::mutex> lock(mCacheMutex);
+            if (mCachedServices.count(name) != 0) continue;
+            mCachedServices.emplace(name, nullptr);
+        }
+
+        // Re-registrations are pushed through the callback, so a service
+        // that restarts is picked up without polling servicemanager.
+        if (!mTheRealServiceManager->registerForNotifications(
+                name, mCacheUpdater).isOk()) {
+            ALOGW("Failed to register for notifications on %s; not caching it",
+                  name.c_str());
+            std::lock_guard<std::mutex> lock(mCacheMutex);
+            mCachedServices.erase(name);
+            continue;
+        }
+
+        // Warm the entry if the service is already up.
+        sp<IBinder> binder;
+        if (mTheRealServiceManager->checkService(name, &binder).isOk() &&
+            binder != nullptr) {
+            updateCachedService(name, binder);
+        }
+    }
+}
+
+void ServiceManagerShim::updateCachedService(const std::string& name,
+                                             const sp<IBinder>& binder) const
+{
+    if (binder != nullptr) {
+        // Death of a cached handle invalidates it. Local binders can't die,
+        // so INVALID_OPERATION is fine here.
+        status_t err = binder->linkToDeath(mCacheUpdater);
+        if (err != OK && err != INVALID_OPERATION) {
+            // Already dead; nothing worth caching.
+            return;
+        }
+    }
+
+    bool known;
+    sp<IBinder> old;
+    {
+        std::lock_guard<std::mutex> lock(mCacheMutex);
+        auto it = mCachedServices.find(name);
+        known = it != mCachedServices.end();
+        if (known) {
+            old = it->second;
+            it->second = binder;
+        }
+    }
+    if (!known) {
+        // Not a cached name (e.g. caching it was abandoned after the
+        // notification registration already went through).
+        if (binder != nullptr) binder->unlinkToDeath(mCacheUpdater);
+        return;
+    }
+    if (old != nullptr && old != binder) {
+        old->unlinkToDeath(mCacheUpdater);
+    }
+}
+
+void ServiceManagerShim::dropCachedService(const wp<IBinder>& who)
+{
+    std::lock_guard<std::mutex> lock(mCacheMutex);
+    for (auto& entry : mCachedServices) {
+        if (entry.second != nullptr && who == entry.second) {
+            entry.second = nullptr;
+        }
+    }
+}
+
 } // namespace android
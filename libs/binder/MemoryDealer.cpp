@@ -25,6 +25,12 @@
 #include <utils/String8.h>
 #include <utils/threads.h>
 
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <set>
+#include <utility>
+
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -41,74 +47,6 @@
 namespace android {
 // ----------------------------------------------------------------------------
 
-/*
- * A simple templatized doubly linked-list implementation
- */
-
-template <typename NODE>
-class LinkedList
-{
-    NODE*  mFirst;
-    NODE*  mLast;
-
-public:
-                LinkedList() : mFirst(nullptr), mLast(nullptr) { }
-    bool        isEmpty() const { return mFirst == nullptr; }
-    NODE const* head() const { return mFirst; }
-    NODE*       head() { return mFirst; }
-    NODE const* tail() const { return mLast; }
-    NODE*       tail() { return mLast; }
-
-    void insertAfter(NODE* node, NODE* newNode) {
-        newNode->prev = node;
-        newNode->next = node->next;
-        if (node->next == nullptr) mLast = newNode;
-        else                 node->next->prev = newNode;
-        node->next = newNode;
-    }
-
-    void insertBefore(NODE* node, NODE* newNode) {
-         newNode->prev = node->prev;
-         newNode->next = node;
-         if (node->prev == nullptr)   mFirst = newNode;
-         else                   node->prev->next = newNode;
-         node->prev = newNode;
-    }
-
-    void insertHead(NODE* newNode) {
-        if (mFirst == nullptr) {
-            mFirst = mLast = newNode;
-            newNode->prev = newNode->next = nullptr;
-        } else {
-            newNode->prev = nullptr;
-            newNode->next = mFirst;
-            mFirst->prev = newNode;
-            mFirst = newNode;
-        }
-    }
-
-    void insertTail(NODE* newNode) {
-        if (mLast == 0) {
-            insertHead(newNode);
-        } else {
-            newNode->prev = mLast;
-            newNode->next = 0;
-            mLast->next = newNode;
-            mLast = newNode;
-        }
-    }
-
-    NODE* remove(NODE* node) {
-        if (node->prev == nullptr)    mFirst = node->next;
-        else                    node->prev->next = node->next;
-        if (node->next == nullptr)    mLast = node->prev;
-        else                    node->next->prev = node->prev;
-        return node;
-    }
-};
-
-// ----------------------------------------------------------------------------
-
 class Allocation : public MemoryBase {
 public:
     Allocation(const sp<MemoryDealer>& dealer,
@@ -120,6 +58,13 @@ private:
 
 // ----------------------------------------------------------------------------
 
+/*
+ * Best-fit allocator over a contiguous heap. The chunks tiling the heap are
+ * kept in an address-ordered map, so the neighbors needed for coalescing on
+ * free are found in O(log n), and the free chunks are additionally indexed by
+ * (size, start) in an ordered set, so the best (smallest adequate) fit is a
+ * single lower_bound() instead of a walk over every chunk.
+ */
 class SimpleBestFitAllocator
 {
     enum {
@@ -140,24 +85,29 @@ public:
 private:
 
     struct chunk_t {
-        chunk_t(size_t start, size_t size)
-        : start(start), size(size), free(1), prev(nullptr), next(nullptr) {
-        }
-        size_t              start;
-        size_t              size : 28;
-        int                 free : 4;
-        mutable chunk_t*    prev;
-        mutable chunk_t*    next;
+        chunk_t(size_t size, bool free) : size(size), free(free) { }
+        size_t  size;
+        bool    free;
     };
 
+    // All chunks, keyed by start offset (in kMemoryAlign units). Adjacent
+    // entries are always contiguous, and two adjacent chunks are never both
+    // free.
+    using ChunkMap = std::map<size_t, chunk_t>;
+    // Free chunks ordered by (size, start); lower_bound() on a requested size
+    // yields the best fit.
+    using FreeSet = std::set<std::pair<size_t, size_t>>;
+
     ssize_t  alloc(size_t size, uint32_t flags);
-    chunk_t* dealloc(size_t start);
+    bool     dealloc(size_t start);
+    void     insertFree(size_t start, size_t size);
     void     dump_l(const char* what) const;
     void     dump_l(String8& res, const char* what) const;
 
     static const int    kMemoryAlign;
     mutable Mutex       mLock;
-    LinkedList<chunk_t> mList;
+    ChunkMap            mChunks;
+    FreeSet             mFreeChunks;
     size_t              mHeapSize;
 };
 
@@ -281,24 +231,11 @@ SimpleBestFitAllocator::SimpleBestFitAllocator(size_t size)
 {
     size_t pagesize = getpagesize();
     mHeapSize = ((size + pagesize-1) & ~(pagesize-1));
-
-    chunk_t* node = new chunk_t(0, mHeapSize / kMemoryAlign);
-    mList.insertHead(node);
+    insertFree(0, mHeapSize / kMemoryAlign);
 }
 
 SimpleBestFitAllocator::~SimpleBestFitAllocator()
 {
-    while(!mList.isEmpty()) {
-        chunk_t* removed = mList.remove(mList.head());
-#ifdef __clang_analyzer__
-        // Clang static analyzer gets confused in this loop
-        // and generates a false positive warning about accessing
-        // memory that is already freed.
-        // Add an "assert" to avoid the confusion.
-        LOG_ALWAYS_FATAL_IF(mList.head() == removed);
-#endif
-        delete removed;
-    }
 }
 
 size_t SimpleBestFitAllocator::size() const
@@ -316,109 +253,99 @@ size_t SimpleBestFitAllocator::allocate(size_t size, uint32_t flags)
 status_t SimpleBestFitAllocator::deallocate(size_t offset)
 {
     Mutex::Autolock _l(mLock);
-    chunk_t const * const freed = dealloc(offset);
-    if (freed) {
+    if (dealloc(offset)) {
         return NO_ERROR;
     }
     return NAME_NOT_FOUND;
 }
 
+void SimpleBestFitAllocator::insertFree(size_t start, size_t size)
+{
+    mChunks.emplace(start, chunk_t(size, true));
+    mFreeChunks.emplace(size, start);
+}
+
 ssize_t SimpleBestFitAllocator::alloc(size_t size, uint32_t flags)
 {
     if (size == 0) {
         return 0;
     }
     size = (size + kMemoryAlign-1) / kMemoryAlign;
-    chunk_t* free_chunk = nullptr;
-    chunk_t* cur = mList.head();
 
-    size_t pagesize = getpagesize();
-    while (cur) {
-        int extra = 0;
+    // Best fit: the smallest free chunk large enough for the request. For
+    // page-aligned requests the alignment padding depends on the chunk's
+    // start, so keep scanning (still in size order) until one fits.
+    const size_t pagesize = getpagesize();
+    FreeSet::iterator found = mFreeChunks.end();
+    size_t extra = 0;
+    for (FreeSet::iterator it = mFreeChunks.lower_bound({size, 0});
+            it != mFreeChunks.end(); ++it) {
         if (flags & PAGE_ALIGNED)
-            extra = ( -cur->start & ((pagesize/kMemoryAlign)-1) ) ;
-
-        // best fit
-        if (cur->free && (cur->size >= (size+extra))) {
-            if ((!free_chunk) || (cur->size < free_chunk->size)) {
-                free_chunk = cur;
-            }
-            if (cur->size == size) {
-                break;
-            }
+            extra = ( -it->second & ((pagesize/kMemoryAlign)-1) ) ;
+        if (it->first >= size + extra) {
+            found = it;
+            break;
         }
-        cur = cur->next;
+    }
+    if (found == mFreeChunks.end()) {
+        return NO_MEMORY;
     }
 
-    if (free_chunk) {
-        const size_t free_size = free_chunk->size;
-        free_chunk->free = 0;
-        free_chunk->size = size;
-        if (free_size > size) {
-            int extra = 0;
-            if (flags & PAGE_ALIGNED)
-                extra = ( -free_chunk->start & ((pagesize/kMemoryAlign)-1) ) ;
-            if (extra) {
-                chunk_t* split = new chunk_t(free_chunk->start, extra);
-                free_chunk->start += extra;
-                mList.insertBefore(free_chunk, split);
-            }
+    const size_t free_start = found->second;
+    const size_t free_size = found->first;
+    mFreeChunks.erase(found);
+    mChunks.erase(free_start);
 
-            ALOGE_IF((flags&PAGE_ALIGNED) && 
-                    ((free_chunk->start*kMemoryAlign)&(pagesize-1)),
-                    "PAGE_ALIGNED requested, but page is not aligned!!!");
+    if (extra) {
+        insertFree(free_start, extra);
+    }
+    const size_t start = free_start + extra;
+    mChunks.emplace(start, chunk_t(size, false));
 
-            const ssize_t tail_free = free_size - (size+extra);
-            if (tail_free > 0) {
-                chunk_t* split = new chunk_t(
-                        free_chunk->start + free_chunk->size, tail_free);
-                mList.insertAfter(free_chunk, split);
-            }
-        }
-        return (free_chunk->start)*kMemoryAlign;
+    ALOGE_IF((flags&PAGE_ALIGNED) &&
+            ((start*kMemoryAlign)&(pagesize-1)),
+            "PAGE_ALIGNED requested, but page is not aligned!!!");
+
+    const ssize_t tail_free = free_size - (size+extra);
+    if (tail_free > 0) {
+        insertFree(start + size, tail_free);
     }
-    return NO_MEMORY;
+    return start*kMemoryAlign;
 }
 
-SimpleBestFitAllocator::chunk_t* SimpleBestFitAllocator::dealloc(size_t start)
+bool SimpleBestFitAllocator::dealloc(size_t start)
 {
     start = start / kMemoryAlign;
-    chunk_t* cur = mList.head();
-    while (cur) {
-        if (cur->start == start) {
-            LOG_FATAL_IF(cur->free,
-                "block at offset 0x%08lX of size 0x%08lX already freed",
-                cur->start*kMemoryAlign, cur->size*kMemoryAlign);
-
-            // merge freed blocks together
-            chunk_t* freed = cur;
-            cur->free = 1;
-            do {
-                chunk_t* const p = cur->prev;
-                chunk_t* const n = cur->next;
-                if (p && (p->free || !cur->size)) {
-                    freed = p;
-                    p->size += cur->size;
-                    mList.remove(cur);
-                    delete cur;
-                }
-                cur = n;
-            } while (cur && cur->free);
-
-            #ifndef NDEBUG
-                if (!freed->free) {
-                    dump_l("dealloc (!freed->free)");
-                }
-            #endif
-            LOG_FATAL_IF(!freed->free,
-                "freed block at offset 0x%08lX of size 0x%08lX is not free!",
-                freed->start * kMemoryAlign, freed->size * kMemoryAlign);
-
-            return freed;
+    ChunkMap::iterator cur = mChunks.find(start);
+    if (cur == mChunks.end()) {
+        return false;
+    }
+    LOG_FATAL_IF(cur->second.free,
+        "block at offset 0x%08lX of size 0x%08lX already freed",
+        cur->first*kMemoryAlign, cur->second.size*kMemoryAlign);
+
+    // Merge with the free neighbors, if any. Since adjacent free chunks are
+    // always coalesced, at most one merge can happen on either side.
+    size_t freed_start = cur->first;
+    size_t freed_size = cur->second.size;
+    if (cur != mChunks.begin()) {
+        ChunkMap::iterator prev = std::prev(cur);
+        if (prev->second.free) {
+            freed_start = prev->first;
+            freed_size += prev->second.size;
+            mFreeChunks.erase({prev->second.size, prev->first});
+            mChunks.erase(prev);
         }
-        cur = cur->next;
     }
-    return nullptr;
+    ChunkMap::iterator next = std::next(cur);
+    if (next != mChunks.end() && next->second.free) {
+        freed_size += next->second.size;
+        mFreeChunks.erase({next->second.size, next->first});
+        mChunks.erase(next);
+    }
+    mChunks.erase(cur);
+    insertFree(freed_start, freed_size);
+    return true;
 }
 
 void SimpleBestFitAllocator::dump(const char* what) const
@@ -445,39 +372,50 @@ void SimpleBestFitAllocator::dump_l(String8& result,
         const char* what) const
 {
     size_t size = 0;
+    size_t free_size = 0;
+    size_t free_count = 0;
+    size_t largest_free = 0;
     int32_t i = 0;
-    chunk_t const* cur = mList.head();
-    
+
     const size_t SIZE = 256;
     char buffer[SIZE];
     snprintf(buffer, SIZE, "  %s (%p, size=%u)\n",
             what, this, (unsigned int)mHeapSize);
-    
+
     result.append(buffer);
-            
-    while (cur) {
-        const char* errs[] = {"", "| link bogus NP",
-                            "| link bogus PN", "| link bogus NP+PN" };
-        int np = ((cur->next) && cur->next->prev != cur) ? 1 : 0;
-        int pn = ((cur->prev) && cur->prev->next != cur) ? 2 : 0;
-
-        snprintf(buffer, SIZE, "  %3u: %p | 0x%08X | 0x%08X | %s %s\n",
-            i, cur, int(cur->start*kMemoryAlign),
-            int(cur->size*kMemoryAlign),
-                    int(cur->free) ? "F" : "A",
-                    errs[np|pn]);
-        
+
+    for (const auto& chunk_pair : mChunks) {
+        const size_t start = chunk_pair.first;
+        const chunk_t& chunk = chunk_pair.second;
+
+        snprintf(buffer, SIZE, "  %3u: 0x%08X | 0x%08X | %s\n",
+            i, int(start*kMemoryAlign),
+            int(chunk.size*kMemoryAlign),
+                    chunk.free ? "F" : "A");
+
         result.append(buffer);
 
-        if (!cur->free)
-            size += cur->size*kMemoryAlign;
+        if (chunk.free) {
+            free_size += chunk.size*kMemoryAlign;
+            largest_free = std::max(largest_free, chunk.size*kMemoryAlign);
+            free_count++;
+        } else {
+            size += chunk.size*kMemoryAlign;
+        }
 
         i++;
-        cur = cur->next;
     }
     snprintf(buffer, SIZE,
             "  size allocated: %u (%u KB)\n", int(size), int(size/1024));
     result.append(buffer);
+    // External fragmentation: how much of the free space is unusable for a
+    // request the size of the largest free chunk.
+    snprintf(buffer, SIZE,
+            "  free: %u (%u KB) in %u chunks, largest %u, fragmentation %u%%\n",
+            int(free_size), int(free_size/1024), int(free_count),
+            int(largest_free),
+            free_size ? int(100 - (largest_free*100)/free_size) : 0);
+    result.append(buffer);
 }
 
 
@@ -86,6 +86,61 @@ static size_t gMaxFds = 0;
 // Maximum size of a blob to transfer in-place.
 static const size_t BLOB_INPLACE_LIMIT = 16 * 1024;
 
+// Per-thread recycling pool for Parcel data buffers.  Binder-heavy
+// clients create and destroy short-lived Parcels at a high rate; handing
+// a retiring Parcel's backing store to the next Parcel written on the
+// same thread sidesteps most of the realloc+memcpy churn that growData()
+// otherwise produces while a large transaction is being assembled.
+class ParcelDataPool {
+public:
+    static constexpr size_t kMaxSlabs = 4;
+    static constexpr size_t kMinSlabSize = 256;
+    static constexpr size_t kMaxSlabSize = 64 * 1024;
+
+    ~ParcelDataPool() {
+        while (mCount) free(mSlabs[--mCount].data);
+    }
+
+    // Returns a recycled buffer of at least `desired` bytes and stores its
+    // usable capacity in *actualSize, or returns nullptr when the pool
+    // cannot satisfy the request.
+    uint8_t* acquire(size_t desired, size_t* actualSize) {
+        if (desired > kMaxSlabSize) return nullptr;
+        for (size_t i = 0; i < mCount; i++) {
+            if (mSlabs[i].capacity >= desired) {
+                uint8_t* const data = mSlabs[i].data;
+                *actualSize = mSlabs[i].capacity;
+                mSlabs[i] = mSlabs[--mCount];
+                return data;
+            }
+        }
+        return nullptr;
+    }
+
+    // Takes ownership of `data` when the pool has room for it; the caller
+    // keeps ownership when false is returned.
+    bool recycle(uint8_t* data, size_t capacity) {
+        if (capacity < kMinSlabSize || capacity > kMaxSlabSize
+                || mCount == kMaxSlabs) {
+            return false;
+        }
+        mSlabs[mCount++] = {data, capacity};
+        return true;
+    }
+
+private:
+    struct Slab {
+        uint8_t* data;
+        size_t capacity;
+    };
+    Slab mSlabs[kMaxSlabs];
+    size_t mCount = 0;
+};
+
+// The pool is torn down with the thread, so slabs recycled by binder
+// threads live exactly as long as the IPCThreadState that fed them.
+static thread_local ParcelDataPool gParcelDataPool;
+
 enum {
     BLOB_INPLACE = 0,
     BLOB_ASHMEM_IMMUTABLE = 1,
@@ -355,6 +410,23 @@ status_t Parcel::setDataCapacity(size_t size)
     return NO_ERROR;
 }
 
+status_t Parcel::prepareToWrite(size_t expectedSize)
+{
+    if (expectedSize > INT32_MAX) {
+        // don't accept size_t values which may have come from an
+        // inadvertent conversion from a negative int.
+        return BAD_VALUE;
+    }
+
+    // A Parcel holding kernel-owned data takes ownership lazily on the
+    // first write; sizing it here would force an early copy for nothing.
+    if (mOwner) return NO_ERROR;
+
+    const size_t padded = pad_size(expectedSize);
+    if (padded > mDataCapacity) return continueWrite(padded);
+    return NO_ERROR;
+}
+
 status_t Parcel::setData(const uint8_t* buffer, size_t len)
 {
     if (len > INT32_MAX) {
@@ -1940,6 +2012,38 @@ const char16_t* Parcel::readString16Inplace(size_t* outLen) const
     return nullptr;
 }
 
+status_t Parcel::readString16View(std::u16string_view* out) const
+{
+    size_t len;
+    const char16_t* str = readString16Inplace(&len);
+    if (str == nullptr) {
+        *out = std::u16string_view();
+        return UNEXPECTED_NULL;
+    }
+    *out = std::u16string_view(str, len);
+    return OK;
+}
+
+status_t Parcel::readByteArrayView(const uint8_t** outData, size_t* outLen) const
+{
+    *outData = nullptr;
+    *outLen = 0;
+
+    int32_t size;
+    status_t status = readInt32(&size);
+    if (status != OK) return status;
+    if (size < 0) return UNEXPECTED_NULL;
+
+    // readInplace() advances past the pad bytes the writer inserted, so
+    // the next field lines up regardless of the payload size.
+    const uint8_t* data = (const uint8_t*)readInplace(size);
+    if (data == nullptr && size != 0) return NOT_ENOUGH_DATA;
+
+    *outData = data;
+    *outLen = size;
+    return OK;
+}
+
 status_t Parcel::readStrongBinder(sp<IBinder>* val) const
 {
     status_t status = readNullableStrongBinder(val);
@@ -2407,7 +2511,9 @@ void Parcel::freeDataNoInit()
             LOG_ALLOC("Parcel %p: freeing with %zu capacity", this, mDataCapacity);
             gParcelGlobalAllocSize -= mDataCapacity;
             gParcelGlobalAllocCount--;
-            free(mData);
+            if (!gParcelDataPool.recycle(mData, mDataCapacity)) {
+                free(mData);
+            }
         }
         if (mObjects) free(mObjects);
     }
@@ -2617,8 +2723,14 @@ status_t Parcel::continueWrite(size_t desired)
         }
 
     } else {
-        // This is the first data.  Easy!
-        uint8_t* data = (uint8_t*)malloc(desired);
+        // This is the first data.  Easy!  Prefer a slab recycled from a
+        // previous Parcel on this thread over hitting the allocator.
+        size_t capacity = desired;
+        uint8_t* data = gParcelDataPool.acquire(desired, &capacity);
+        if (!data) {
+            data = (uint8_t*)malloc(desired);
+            capacity = desired;
+        }
         if (!data) {
             mError = NO_MEMORY;
             return NO_MEMORY;
@@ -2629,15 +2741,15 @@ status_t Parcel::continueWrite(size_t desired)
             ALOGE("continueWrite: %zu/%p/%zu/%zu", mDataCapacity, mObjects, mObjectsCapacity, desired);
         }
 
-        LOG_ALLOC("Parcel %p: allocating with %zu capacity", this, desired);
-        gParcelGlobalAllocSize += desired;
+        LOG_ALLOC("Parcel %p: allocating with %zu capacity", this, capacity);
+        gParcelGlobalAllocSize += capacity;
         gParcelGlobalAllocCount++;
 
         mData = data;
         mDataSize = mDataPos = 0;
         ALOGV("continueWrite Setting data size of %p to %zu", this, mDataSize);
         ALOGV("continueWrite Setting data pos of %p to %zu", this, mDataPos);
-        mDataCapacity = desired;
+        mDataCapacity = capacity;
     }
 
     return NO_ERROR;
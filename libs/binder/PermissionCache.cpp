@@ -17,6 +17,10 @@
 #define LOG_TAG "PermissionCache"
 
 #include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
 #include <utils/Log.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
@@ -31,18 +35,23 @@ ANDROID_SINGLETON_STATIC_INSTANCE(PermissionCache)
 
 // ----------------------------------------------------------------------------
 
-PermissionCache::PermissionCache() {
+PermissionCache::PermissionCache()
+    : mCache(std::make_shared<const SortedVector<Entry>>()) {
 }
 
 status_t PermissionCache::check(bool* granted,
         const String16& permission, uid_t uid) const {
-    Mutex::Autolock _l(mLock);
+    // Lock-free: the published table is immutable, so once loaded it can be
+    // searched without holding mLock, even while a writer publishes a
+    // replacement.
+    std::shared_ptr<const SortedVector<Entry>> cache =
+            std::atomic_load_explicit(&mCache, std::memory_order_acquire);
     Entry e;
     e.name = permission;
     e.uid  = uid;
-    ssize_t index = mCache.indexOf(e);
+    ssize_t index = cache->indexOf(e);
     if (index >= 0) {
-        *granted = mCache.itemAt(index).granted;
+        *granted = cache->itemAt(index).granted;
         return NO_ERROR;
     }
     return NAME_NOT_FOUND;
@@ -63,15 +72,34 @@ void PermissionCache::cache(const String16& permission,
     // permission checks
     e.uid  = uid;
     e.granted = granted;
-    index = mCache.indexOf(e);
-    if (index < 0) {
-        mCache.add(e);
+    if (mCache->indexOf(e) < 0) {
+        auto updated = std::make_shared<SortedVector<Entry>>(*mCache);
+        updated->add(e);
+        std::atomic_store_explicit(&mCache,
+                std::shared_ptr<const SortedVector<Entry>>(std::move(updated)),
+                std::memory_order_release);
     }
 }
 
 void PermissionCache::purge() {
     Mutex::Autolock _l(mLock);
-    mCache.clear();
+    std::atomic_store_explicit(&mCache,
+            std::make_shared<const SortedVector<Entry>>(),
+            std::memory_order_release);
+}
+
+void PermissionCache::purge(uid_t uid) {
+    Mutex::Autolock _l(mLock);
+    auto updated = std::make_shared<SortedVector<Entry>>();
+    for (size_t i = 0; i < mCache->size(); i++) {
+        const Entry& e = mCache->itemAt(i);
+        if (e.uid != uid) {
+            updated->add(e);
+        }
+    }
+    std::atomic_store_explicit(&mCache,
+            std::shared_ptr<const SortedVector<Entry>>(std::move(updated)),
+            std::memory_order_release);
 }
 
 bool PermissionCache::checkCallingPermission(const String16& permission) {
@@ -109,5 +137,10 @@ bool PermissionCache::checkPermission(
     return granted;
 }
 
+void PermissionCache::purgeForUid(uid_t uid) {
+    PermissionCache& pc(PermissionCache::getInstance());
+    pc.purge(uid);
+}
+
 // ---------------------------------------------------------------------------
 } // namespace android
@@ -42,6 +42,9 @@ enum {
     // Keep them in sync with BUNDLE_MAGIC* in frameworks/base/core/java/android/os/BaseBundle.java.
     BUNDLE_MAGIC = 0x4C444E42,
     BUNDLE_MAGIC_NATIVE = 0x4C444E44,
+    // Native-only v2 format with an interned string table and length-prefixed
+    // values; not understood by the Java implementation.
+    BUNDLE_MAGIC_NATIVE_V2 = 0x4C444E56,
 };
 
 namespace {
@@ -86,6 +89,32 @@ namespace os {
          }                                                               \
     }
 
+namespace {
+/*
+ * Writes a value produced by |writeValue| preceded by its length in bytes, by
+ * backpatching a length header once the value has been written. Readers use
+ * the length to skip values they cannot interpret.
+ */
+template <typename F>
+status_t writeLengthPrefixed(Parcel* parcel, F&& writeValue) {
+    size_t length_pos = parcel->dataPosition();
+    RETURN_IF_FAILED(parcel->writeInt32(0));  // dummy, will hold length
+    size_t start_pos = parcel->dataPosition();
+    RETURN_IF_FAILED(writeValue());
+    size_t end_pos = parcel->dataPosition();
+
+    size_t length = end_pos - start_pos;
+    if (length > std::numeric_limits<int32_t>::max()) {
+        ALOGE("Value length (%zu) too large to store in 32-bit signed int", length);
+        return BAD_VALUE;
+    }
+    parcel->setDataPosition(length_pos);
+    RETURN_IF_FAILED(parcel->writeInt32(static_cast<int32_t>(length)));
+    parcel->setDataPosition(end_pos);
+    return NO_ERROR;
+}
+}  // namespace
+
 status_t PersistableBundle::writeToParcel(Parcel* parcel) const {
     /*
      * Keep implementation in sync with writeToParcelInner() in
@@ -118,6 +147,36 @@ status_t PersistableBundle::writeToParcel(Parcel* parcel) const {
     return NO_ERROR;
 }
 
+status_t PersistableBundle::writeToParcelV2(Parcel* parcel) const {
+    /*
+     * Same framing as writeToParcel(); only the magic number and the inner
+     * layout differ. Empty bundles are written identically in both formats.
+     */
+    if (empty()) {
+        RETURN_IF_FAILED(parcel->writeInt32(0));
+        return NO_ERROR;
+    }
+
+    size_t length_pos = parcel->dataPosition();
+    RETURN_IF_FAILED(parcel->writeInt32(1));  // dummy, will hold length
+    RETURN_IF_FAILED(parcel->writeInt32(BUNDLE_MAGIC_NATIVE_V2));
+
+    size_t start_pos = parcel->dataPosition();
+    RETURN_IF_FAILED(writeToParcelInnerV2(parcel));
+    size_t end_pos = parcel->dataPosition();
+
+    // Backpatch length. This length value includes the length header.
+    parcel->setDataPosition(length_pos);
+    size_t length = end_pos - start_pos;
+    if (length > std::numeric_limits<int32_t>::max()) {
+        ALOGE("Parcel length (%zu) too large to store in 32-bit signed int", length);
+        return BAD_VALUE;
+    }
+    RETURN_IF_FAILED(parcel->writeInt32(static_cast<int32_t>(length)));
+    parcel->setDataPosition(end_pos);
+    return NO_ERROR;
+}
+
 status_t PersistableBundle::readFromParcel(const Parcel* parcel) {
     /*
      * Keep implementation in sync with readFromParcelInner() in
@@ -393,6 +452,9 @@ status_t PersistableBundle::readFromParcelInner(const Parcel* parcel, size_t len
 
     int32_t magic;
     RETURN_IF_FAILED(parcel->readInt32(&magic));
+    if (magic == BUNDLE_MAGIC_NATIVE_V2) {
+        return readFromParcelInnerV2(parcel);
+    }
     if (magic != BUNDLE_MAGIC && magic != BUNDLE_MAGIC_NATIVE) {
         ALOGE("Bad magic number for PersistableBundle: 0x%08x", magic);
         return BAD_VALUE;
@@ -473,6 +535,246 @@ status_t PersistableBundle::readFromParcelInner(const Parcel* parcel, size_t len
     return NO_ERROR;
 }
 
+status_t PersistableBundle::writeToParcelInnerV2(Parcel* parcel) const {
+    /*
+     * v2 layout:
+     *   - string table: number of strings, then each distinct string (keys
+     *     and string values), written exactly once, in sorted order;
+     *   - number of key-value pairs;
+     *   - per pair: key index into the string table, value type, value length
+     *     in bytes, value payload.
+     * The length lets readers skip values with unrecognized types instead of
+     * failing the whole bundle.
+     */
+    size_t num_entries = size();
+    if (num_entries > std::numeric_limits<int32_t>::max()) {
+        ALOGE("The size of this PersistableBundle (%zu) too large to store in 32-bit signed int",
+              num_entries);
+        return BAD_VALUE;
+    }
+
+    map<String16, int32_t> string_indices;
+    for (const auto& key_val_pair : mBoolMap) string_indices.emplace(key_val_pair.first, 0);
+    for (const auto& key_val_pair : mIntMap) string_indices.emplace(key_val_pair.first, 0);
+    for (const auto& key_val_pair : mLongMap) string_indices.emplace(key_val_pair.first, 0);
+    for (const auto& key_val_pair : mDoubleMap) string_indices.emplace(key_val_pair.first, 0);
+    for (const auto& key_val_pair : mStringMap) {
+        string_indices.emplace(key_val_pair.first, 0);
+        string_indices.emplace(key_val_pair.second, 0);
+    }
+    for (const auto& key_val_pair : mBoolVectorMap) string_indices.emplace(key_val_pair.first, 0);
+    for (const auto& key_val_pair : mIntVectorMap) string_indices.emplace(key_val_pair.first, 0);
+    for (const auto& key_val_pair : mLongVectorMap) string_indices.emplace(key_val_pair.first, 0);
+    for (const auto& key_val_pair : mDoubleVectorMap) string_indices.emplace(key_val_pair.first, 0);
+    for (const auto& key_val_pair : mStringVectorMap) string_indices.emplace(key_val_pair.first, 0);
+    for (const auto& key_val_pair : mPersistableBundleMap) {
+        string_indices.emplace(key_val_pair.first, 0);
+    }
+
+    if (string_indices.size() > std::numeric_limits<int32_t>::max()) {
+        ALOGE("The string table of this PersistableBundle (%zu) too large to store in 32-bit "
+              "signed int",
+              string_indices.size());
+        return BAD_VALUE;
+    }
+    RETURN_IF_FAILED(parcel->writeInt32(static_cast<int32_t>(string_indices.size())));
+    int32_t next_index = 0;
+    for (auto& string_index_pair : string_indices) {
+        string_index_pair.second = next_index++;
+        RETURN_IF_FAILED(parcel->writeString16(string_index_pair.first));
+    }
+
+    auto indexOf = [&string_indices](const String16& string) {
+        // Every key and string value was interned above.
+        return string_indices.find(string)->second;
+    };
+
+    RETURN_IF_FAILED(parcel->writeInt32(static_cast<int32_t>(num_entries)));
+
+    for (const auto& key_val_pair : mBoolMap) {
+        RETURN_IF_FAILED(parcel->writeInt32(indexOf(key_val_pair.first)));
+        RETURN_IF_FAILED(parcel->writeInt32(VAL_BOOLEAN));
+        RETURN_IF_FAILED(writeLengthPrefixed(parcel, [&]() {
+            return parcel->writeBool(key_val_pair.second);
+        }));
+    }
+    for (const auto& key_val_pair : mIntMap) {
+        RETURN_IF_FAILED(parcel->writeInt32(indexOf(key_val_pair.first)));
+        RETURN_IF_FAILED(parcel->writeInt32(VAL_INTEGER));
+        RETURN_IF_FAILED(writeLengthPrefixed(parcel, [&]() {
+            return parcel->writeInt32(key_val_pair.second);
+        }));
+    }
+    for (const auto& key_val_pair : mLongMap) {
+        RETURN_IF_FAILED(parcel->writeInt32(indexOf(key_val_pair.first)));
+        RETURN_IF_FAILED(parcel->writeInt32(VAL_LONG));
+        RETURN_IF_FAILED(writeLengthPrefixed(parcel, [&]() {
+            return parcel->writeInt64(key_val_pair.second);
+        }));
+    }
+    for (const auto& key_val_pair : mDoubleMap) {
+        RETURN_IF_FAILED(parcel->writeInt32(indexOf(key_val_pair.first)));
+        RETURN_IF_FAILED(parcel->writeInt32(VAL_DOUBLE));
+        RETURN_IF_FAILED(writeLengthPrefixed(parcel, [&]() {
+            return parcel->writeDouble(key_val_pair.second);
+        }));
+    }
+    for (const auto& key_val_pair : mStringMap) {
+        RETURN_IF_FAILED(parcel->writeInt32(indexOf(key_val_pair.first)));
+        RETURN_IF_FAILED(parcel->writeInt32(VAL_STRING));
+        RETURN_IF_FAILED(writeLengthPrefixed(parcel, [&]() {
+            return parcel->writeInt32(indexOf(key_val_pair.second));
+        }));
+    }
+    for (const auto& key_val_pair : mBoolVectorMap) {
+        RETURN_IF_FAILED(parcel->writeInt32(indexOf(key_val_pair.first)));
+        RETURN_IF_FAILED(parcel->writeInt32(VAL_BOOLEANARRAY));
+        RETURN_IF_FAILED(writeLengthPrefixed(parcel, [&]() {
+            return parcel->writeBoolVector(key_val_pair.second);
+        }));
+    }
+    for (const auto& key_val_pair : mIntVectorMap) {
+        RETURN_IF_FAILED(parcel->writeInt32(indexOf(key_val_pair.first)));
+        RETURN_IF_FAILED(parcel->writeInt32(VAL_INTARRAY));
+        RETURN_IF_FAILED(writeLengthPrefixed(parcel, [&]() {
+            return parcel->writeInt32Vector(key_val_pair.second);
+        }));
+    }
+    for (const auto& key_val_pair : mLongVectorMap) {
+        RETURN_IF_FAILED(parcel->writeInt32(indexOf(key_val_pair.first)));
+        RETURN_IF_FAILED(parcel->writeInt32(VAL_LONGARRAY));
+        RETURN_IF_FAILED(writeLengthPrefixed(parcel, [&]() {
+            return parcel->writeInt64Vector(key_val_pair.second);
+        }));
+    }
+    for (const auto& key_val_pair : mDoubleVectorMap) {
+        RETURN_IF_FAILED(parcel->writeInt32(indexOf(key_val_pair.first)));
+        RETURN_IF_FAILED(parcel->writeInt32(VAL_DOUBLEARRAY));
+        RETURN_IF_FAILED(writeLengthPrefixed(parcel, [&]() {
+            return parcel->writeDoubleVector(key_val_pair.second);
+        }));
+    }
+    for (const auto& key_val_pair : mStringVectorMap) {
+        RETURN_IF_FAILED(parcel->writeInt32(indexOf(key_val_pair.first)));
+        RETURN_IF_FAILED(parcel->writeInt32(VAL_STRINGARRAY));
+        RETURN_IF_FAILED(writeLengthPrefixed(parcel, [&]() {
+            return parcel->writeString16Vector(key_val_pair.second);
+        }));
+    }
+    for (const auto& key_val_pair : mPersistableBundleMap) {
+        RETURN_IF_FAILED(parcel->writeInt32(indexOf(key_val_pair.first)));
+        RETURN_IF_FAILED(parcel->writeInt32(VAL_PERSISTABLEBUNDLE));
+        RETURN_IF_FAILED(writeLengthPrefixed(parcel, [&]() {
+            return key_val_pair.second.writeToParcelV2(parcel);
+        }));
+    }
+    return NO_ERROR;
+}
+
+status_t PersistableBundle::readFromParcelInnerV2(const Parcel* parcel) {
+    int32_t num_strings;
+    RETURN_IF_FAILED(parcel->readInt32(&num_strings));
+    if (num_strings < 0 ||
+        static_cast<size_t>(num_strings) > parcel->dataAvail() / sizeof(int32_t)) {
+        ALOGE("Bad string table size in parcel: %d", num_strings);
+        return BAD_VALUE;
+    }
+    vector<String16> strings(static_cast<size_t>(num_strings));
+    for (auto& string : strings) {
+        RETURN_IF_FAILED(parcel->readString16(&string));
+    }
+
+    auto stringAt = [&strings](int32_t index, String16* out) -> status_t {
+        if (index < 0 || static_cast<size_t>(index) >= strings.size()) {
+            ALOGE("Bad string table index in parcel: %d", index);
+            return BAD_VALUE;
+        }
+        *out = strings[static_cast<size_t>(index)];
+        return NO_ERROR;
+    };
+
+    int32_t num_entries;
+    RETURN_IF_FAILED(parcel->readInt32(&num_entries));
+
+    for (; num_entries > 0; --num_entries) {
+        int32_t key_index;
+        int32_t value_type;
+        int32_t value_length;
+        RETURN_IF_FAILED(parcel->readInt32(&key_index));
+        RETURN_IF_FAILED(parcel->readInt32(&value_type));
+        RETURN_IF_FAILED(parcel->readInt32(&value_length));
+        if (value_length < 0 || static_cast<size_t>(value_length) > parcel->dataAvail()) {
+            ALOGE("Bad value length in parcel: %d", value_length);
+            return BAD_VALUE;
+        }
+        String16 key;
+        RETURN_IF_FAILED(stringAt(key_index, &key));
+
+        size_t value_start = parcel->dataPosition();
+        switch (value_type) {
+            case VAL_STRING: {
+                int32_t value_index;
+                RETURN_IF_FAILED(parcel->readInt32(&value_index));
+                RETURN_IF_FAILED(stringAt(value_index, &mStringMap[key]));
+                break;
+            }
+            case VAL_INTEGER: {
+                RETURN_IF_FAILED(parcel->readInt32(&mIntMap[key]));
+                break;
+            }
+            case VAL_LONG: {
+                RETURN_IF_FAILED(parcel->readInt64(&mLongMap[key]));
+                break;
+            }
+            case VAL_DOUBLE: {
+                RETURN_IF_FAILED(parcel->readDouble(&mDoubleMap[key]));
+                break;
+            }
+            case VAL_BOOLEAN: {
+                RETURN_IF_FAILED(parcel->readBool(&mBoolMap[key]));
+                break;
+            }
+            case VAL_STRINGARRAY: {
+                RETURN_IF_FAILED(parcel->readString16Vector(&mStringVectorMap[key]));
+                break;
+            }
+            case VAL_INTARRAY: {
+                RETURN_IF_FAILED(parcel->readInt32Vector(&mIntVectorMap[key]));
+                break;
+            }
+            case VAL_LONGARRAY: {
+                RETURN_IF_FAILED(parcel->readInt64Vector(&mLongVectorMap[key]));
+                break;
+            }
+            case VAL_BOOLEANARRAY: {
+                RETURN_IF_FAILED(parcel->readBoolVector(&mBoolVectorMap[key]));
+                break;
+            }
+            case VAL_PERSISTABLEBUNDLE: {
+                RETURN_IF_FAILED(mPersistableBundleMap[key].readFromParcel(parcel));
+                break;
+            }
+            case VAL_DOUBLEARRAY: {
+                RETURN_IF_FAILED(parcel->readDoubleVector(&mDoubleVectorMap[key]));
+                break;
+            }
+            default: {
+                // Unlike v1, the value length lets us skip over entries
+                // written by a newer version instead of failing the bundle.
+                ALOGW("Skipping unrecognized type: %d", value_type);
+                parcel->setDataPosition(value_start + static_cast<size_t>(value_length));
+                continue;
+            }
+        }
+        if (parcel->dataPosition() != value_start + static_cast<size_t>(value_length)) {
+            ALOGE("Value length mismatch in parcel for type %d", value_type);
+            return BAD_VALUE;
+        }
+    }
+
+    return NO_ERROR;
+}
+
 }  // namespace os
 
 }  // namespace android
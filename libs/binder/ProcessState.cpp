@@ -223,26 +223,41 @@ void ProcessState::setCallRestriction(CallRestriction restriction) {
     mCallRestriction = restriction;
 }
 
-ProcessState::handle_entry* ProcessState::lookupHandleLocked(int32_t handle)
+ProcessState::handle_entry* ProcessState::lookupHandle(int32_t handle)
 {
-    const size_t N=mHandleToObject.size();
-    if (N <= (size_t)handle) {
-        handle_entry e;
-        e.binder = nullptr;
-        e.refs = nullptr;
-        status_t err = mHandleToObject.insertAt(e, N, handle+1-N);
-        if (err < NO_ERROR) return nullptr;
+    const size_t chunkIndex = (size_t)handle / kHandleChunkSize;
+    if (chunkIndex >= kHandleMaxChunks) return nullptr;
+
+    handle_entry* chunk = mHandleChunks[chunkIndex].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+        AutoMutex _l(mHandleChunkLock);
+        chunk = mHandleChunks[chunkIndex].load(std::memory_order_relaxed);
+        if (chunk == nullptr) {
+            chunk = new (std::nothrow) handle_entry[kHandleChunkSize]();
+            if (chunk == nullptr) return nullptr;
+            // Publish the zero-initialized chunk; entries are immovable
+            // from here on, so readers never need mHandleChunkLock.
+            mHandleChunks[chunkIndex].store(chunk, std::memory_order_release);
+        }
     }
-    return &mHandleToObject.editItemAt(handle);
+    return &chunk[(size_t)handle % kHandleChunkSize];
+}
+
+Mutex& ProcessState::handleLock(int32_t handle) const
+{
+    return mHandleLocks[(size_t)handle % kHandleLockCount];
 }
 
 sp<IBinder> ProcessState::getStrongProxyForHandle(int32_t handle)
 {
     sp<IBinder> result;
 
-    AutoMutex _l(mLock);
+    // Handles shard across kHandleLockCount locks, so concurrent binder
+    // threads resolving different proxies no longer serialize on a
+    // process-global mutex.
+    AutoMutex _l(handleLock(handle));
 
-    handle_entry* e = lookupHandleLocked(handle);
+    handle_entry* e = lookupHandle(handle);
 
     if (e != nullptr) {
         // We need to create a new BpBinder if there isn't currently one, OR we
@@ -299,9 +314,9 @@ sp<IBinder> ProcessState::getStrongProxyForHandle(int32_t handle)
 
 void ProcessState::expungeHandle(int32_t handle, IBinder* binder)
 {
-    AutoMutex _l(mLock);
+    AutoMutex _l(handleLock(handle));
 
-    handle_entry* e = lookupHandleLocked(handle);
+    handle_entry* e = lookupHandle(handle);
 
     // This handle may have already been replaced with a new BpBinder
     // (if someone failed the AttemptIncWeak() above); we don't want
@@ -390,6 +405,9 @@ ProcessState::ProcessState(const char *driver)
     , mThreadPoolSeq(1)
     , mCallRestriction(CallRestriction::NONE)
 {
+    for (size_t i = 0; i < kHandleMaxChunks; i++) {
+        mHandleChunks[i].store(nullptr, std::memory_order_relaxed);
+    }
 
 // TODO(b/139016109): enforce in build system
 #if defined(__ANDROID_APEX__)
@@ -422,6 +440,9 @@ ProcessState::~ProcessState()
         close(mDriverFD);
     }
     mDriverFD = -1;
+    for (size_t i = 0; i < kHandleMaxChunks; i++) {
+        delete[] mHandleChunks[i].load(std::memory_order_relaxed);
+    }
 }
 
 } // namespace android
@@ -90,7 +90,11 @@ public:
     //
     // In cases where performance is an issue, this matter must be addressed on
     // an ad-hoc basis.
-    void* unsecurePointer() const;
+    //
+    // Virtual so that proxies can serve the payload from an inline copy carried in
+    // the reply Parcel instead of a mapped heap (see
+    // BnMemory::setInlineTransferLimit).
+    virtual void* unsecurePointer() const;
 
     size_t size() const;
     ssize_t offset() const;
@@ -116,8 +120,21 @@ public:
             uint32_t flags = 0);
 
     BnMemory();
+
+    // Lets getMemory replies carry payloads of at most `limit` bytes inline in the
+    // reply Parcel instead of the heap binder, sparing clients the heap transaction
+    // and mmap for small transient blobs (e.g. effect parameter buffers).  Clients
+    // receiving an inline payload get a private copy: getMemory() returns nullptr to
+    // them and later writes by either side are not shared, so only enable this for
+    // memory used as a one-way payload.  A limit of 0 (the default) disables inline
+    // transfer.
+    void setInlineTransferLimit(size_t limit);
+
 protected:
     virtual ~BnMemory();
+
+private:
+    size_t mInlineTransferLimit = 0;
 };
 
 // ----------------------------------------------------------------------------
@@ -169,6 +169,9 @@ private:
             void                processPendingDerefs();
             void                processPostWriteDerefs();
 
+            Parcel*             obtainReplyParcel();
+            void                recycleReplyParcel(Parcel* reply);
+
             void                clearCaller();
 
     static  void                threadDestructor(void *st);
@@ -183,6 +186,14 @@ private:
             Vector<RefBase::weakref_type*> mPostWriteWeakDerefs;
             Parcel              mIn;
             Parcel              mOut;
+            // Recycled reply parcels for executeCommand(), so bursts of
+            // incoming transactions do not allocate a fresh buffer each time.
+            Vector<Parcel*>     mReplyParcelPool;
+            // Largest payloads seen since the transaction buffers were last
+            // trimmed, and the number of driver exchanges until the next trim.
+            size_t              mInHighWaterMark;
+            size_t              mOutHighWaterMark;
+            size_t              mTrimCountdown;
             status_t            mLastError;
             const void*         mServingStackPointer;
             pid_t               mCallingPid;
@@ -94,6 +94,20 @@ public:
      * service.
      */
     virtual bool isDeclared(const String16& name) = 0;
+
+    /**
+     * Cache the handles of the given services in this process.
+     *
+     * Each named service is looked up once and its handle retained, and
+     * subsequent checkService/getService calls for it are answered from the
+     * cache without a call into servicemanager. The cache is kept current
+     * with registration notifications, so a service that restarts is picked
+     * up again without polling. Intended to be called once during early init
+     * with the stable services a process is known to look up repeatedly.
+     *
+     * The default implementation does nothing.
+     */
+    virtual void cacheServices(const Vector<String16>& names);
 };
 
 sp<IServiceManager> defaultServiceManager();
@@ -18,6 +18,7 @@
 
 #include <map> // for legacy reasons
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 
@@ -70,6 +71,13 @@ public:
     void                setDataPosition(size_t pos) const;
     status_t            setDataCapacity(size_t size);
 
+    // Hint the total amount of data that will be written to this Parcel,
+    // so the backing store is sized once up front instead of being grown
+    // through repeated realloc+memcpy cycles on the write path.  Unlike
+    // setDataCapacity this rounds the request up to the allocator's
+    // granularity and is a no-op for Parcels reading kernel-owned data.
+    status_t            prepareToWrite(size_t expectedSize);
+
     status_t            setData(const uint8_t* buffer, size_t len);
 
     status_t            appendFrom(const Parcel *parcel,
@@ -289,6 +297,16 @@ public:
     status_t            readString16(String16* pArg) const;
     status_t            readString16(std::unique_ptr<String16>* pArg) const;
     const char16_t*     readString16Inplace(size_t* outLen) const;
+
+    // Zero-copy reads.  The returned views borrow the Parcel's data
+    // buffer: they stay valid only while the Parcel is alive and not
+    // rewritten, so callers that outlive the Parcel must copy.  Wire
+    // format matches readString16/readByteVector, which these replace
+    // on paths that would otherwise copy multi-megabyte payloads.
+    status_t            readString16View(std::u16string_view* out) const;
+    status_t            readByteArrayView(const uint8_t** outData,
+                                          size_t* outLen) const;
+
     sp<IBinder>         readStrongBinder() const;
     status_t            readStrongBinder(sp<IBinder>* val) const;
     status_t            readNullableStrongBinder(sp<IBinder>* val) const;
@@ -21,6 +21,8 @@
 #include <stdint.h>
 #include <unistd.h>
 
+#include <memory>
+
 #include <utils/String16.h>
 #include <utils/Singleton.h>
 #include <utils/SortedVector.h>
@@ -48,16 +50,22 @@ class PermissionCache : Singleton<PermissionCache> {
             return (uid == e.uid) ? (name < e.name) : (uid < e.uid);
         }
     };
+    // serializes updates only; lookups read the published table lock-free
     mutable Mutex mLock;
     // we pool all the permission names we see, as many permissions checks
     // will have identical names
     SortedVector< String16 > mPermissionNamesPool;
-    // this is our cache per say. it stores pooled names.
-    SortedVector< Entry > mCache;
+    // this is our cache per say. it stores pooled names. the table is
+    // immutable once published: writers copy it, update the copy and publish
+    // it atomically, so readers never take mLock.
+    std::shared_ptr<const SortedVector<Entry>> mCache;
 
     // free the whole cache, but keep the permission name pool
     void purge();
 
+    // free only the entries cached for a given uid
+    void purge(uid_t uid);
+
     status_t check(bool* granted,
             const String16& permission, uid_t uid) const;
 
@@ -73,6 +81,14 @@ public:
 
     static bool checkPermission(const String16& permission,
             pid_t pid, uid_t uid);
+
+    /*
+     * Invalidates the entries cached for a single uid, for instance when the
+     * corresponding package is uninstalled, without forcing every other uid
+     * through a round of checkPermission() binder calls like a full purge
+     * would.
+     */
+    static void purgeForUid(uid_t uid);
 };
 
 // ---------------------------------------------------------------------------
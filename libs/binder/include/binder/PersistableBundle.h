@@ -41,6 +41,17 @@ public:
     status_t writeToParcel(Parcel* parcel) const override;
     status_t readFromParcel(const Parcel* parcel) override;
 
+    /*
+     * Writes this bundle in the v2 wire format: every distinct string (keys
+     * and string values) is parceled once into an interned string table, and
+     * every value is length-prefixed so readers can skip entries they do not
+     * understand. Bundles that repeat the same keys shrink considerably on
+     * the wire. readFromParcel() accepts both formats; writing v2 is opt-in
+     * because readers that only know the v1 format (notably the Java
+     * implementation) reject the v2 magic number.
+     */
+    status_t writeToParcelV2(Parcel* parcel) const;
+
     bool empty() const;
     size_t size() const;
     size_t erase(const String16& key);
@@ -110,6 +121,8 @@ public:
 private:
     status_t writeToParcelInner(Parcel* parcel) const;
     status_t readFromParcelInner(const Parcel* parcel, size_t length);
+    status_t writeToParcelInnerV2(Parcel* parcel) const;
+    status_t readFromParcelInnerV2(const Parcel* parcel);
 
     std::map<String16, bool> mBoolMap;
     std::map<String16, int32_t> mIntMap;
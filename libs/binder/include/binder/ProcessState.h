@@ -23,6 +23,7 @@
 
 #include <utils/threads.h>
 
+#include <atomic>
 #include <pthread.h>
 
 // ---------------------------------------------------------------------------
@@ -103,7 +104,8 @@ private:
                 RefBase::weakref_type* refs;
             };
 
-            handle_entry*       lookupHandleLocked(int32_t handle);
+            handle_entry*       lookupHandle(int32_t handle);
+            Mutex&              handleLock(int32_t handle) const;
 
             String8             mDriverName;
             int                 mDriverFD;
@@ -122,9 +124,22 @@ private:
             // Time when thread pool was emptied
             int64_t             mStarvationStartTimeMs;
 
-    mutable Mutex               mLock;  // protects everything below.
+            // The handle table is chunked and grow-only: entries never
+            // move once a chunk is published, so concurrent binder
+            // threads index into it without a table-wide lock.  Handles
+            // are dense small integers handed out by the driver, which
+            // keeps the chunk array compact in practice.
+            static constexpr size_t kHandleChunkSize = 256;
+            static constexpr size_t kHandleMaxChunks = 1024;
+            std::atomic<handle_entry*> mHandleChunks[kHandleMaxChunks];
+            // Guards chunk allocation only, never lookups.
+            mutable Mutex       mHandleChunkLock;
+            // Per-handle sharded locks ordering proxy creation against
+            // BpBinder death (see getStrongProxyForHandle).
+            static constexpr size_t kHandleLockCount = 16;
+            mutable Mutex       mHandleLocks[kHandleLockCount];
 
-            Vector<handle_entry>mHandleToObject;
+    mutable Mutex               mLock;  // protects everything below.
 
             context_check_func  mBinderContextCheckFunc;
             void*               mBinderContextUserData;
@@ -8,9 +8,11 @@
 #include <cstdio>
 
 #include <iostream>
+#include <mutex>
 #include <vector>
 #include <tuple>
 
+#include <sched.h>
 #include <unistd.h>
 #include <sys/wait.h>
 
@@ -29,26 +31,6 @@ do { \
     } \
 } while (0)
 
-class BinderWorkerService : public BBinder
-{
-public:
-    BinderWorkerService() {}
-    ~BinderWorkerService() {}
-    virtual status_t onTransact(uint32_t code,
-                                const Parcel& data, Parcel* reply,
-                                uint32_t flags = 0) {
-        (void)flags;
-        (void)data;
-        (void)reply;
-        switch (code) {
-        case BINDER_NOP:
-            return NO_ERROR;
-        default:
-            return UNKNOWN_TRANSACTION;
-        };
-    }
-};
-
 class Pipe {
     int m_readFd;
     int m_writeFd;
@@ -168,6 +150,66 @@ struct ProcResults {
     }
 };
 
+struct TestOptions {
+    int iterations = 10000;
+    int payload_size = 0;
+    // Split workers into client/server pairs instead of spreading requests
+    // to all workers.
+    bool cs_pair = false;
+    // Send transactions as oneway instead of waiting for a reply.
+    bool oneway = false;
+    // Run workers (and the thread pools they spawn) under SCHED_FIFO.
+    bool fifo = false;
+    // Prepend a timestamp to the payload so servers can report
+    // wakeup-to-onTransact latency.
+    bool track_dispatch = false;
+    // Size of each worker's binder thread pool; 0 keeps the default.
+    int server_threads = 0;
+};
+
+static uint64_t nanotime() {
+    return uint64_t(chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+class BinderWorkerService : public BBinder
+{
+public:
+    BinderWorkerService() {}
+    ~BinderWorkerService() {}
+    virtual status_t onTransact(uint32_t code,
+                                const Parcel& data, Parcel* reply,
+                                uint32_t flags = 0) {
+        (void)flags;
+        (void)reply;
+        switch (code) {
+        case BINDER_NOP: {
+            // With dispatch tracking (-d), the client prepends its steady
+            // clock timestamp; the delta to now is the wakeup-to-onTransact
+            // latency. A zero payload word means tracking is off.
+            if (data.dataSize() >= sizeof(int64_t)) {
+                int64_t sent = data.readInt64();
+                if (sent > 0) {
+                    lock_guard<mutex> lock(m_dispatch_lock);
+                    m_dispatch_results.add_time(nanotime() - uint64_t(sent));
+                }
+            }
+            return NO_ERROR;
+        }
+        default:
+            return UNKNOWN_TRANSACTION;
+        };
+    }
+    ProcResults dispatchResults() {
+        lock_guard<mutex> lock(m_dispatch_lock);
+        return m_dispatch_results;
+    }
+private:
+    // onTransact may run on several thread-pool threads concurrently.
+    mutex m_dispatch_lock;
+    ProcResults m_dispatch_results;
+};
+
 String16 generateServiceName(int num)
 {
     char num_str[32];
@@ -178,11 +220,22 @@ String16 generateServiceName(int num)
 
 void worker_fx(int num,
                int worker_count,
-               int iterations,
-               int payload_size,
-               bool cs_pair,
+               TestOptions opts,
                Pipe p)
 {
+    if (opts.fifo) {
+        // Set the policy before spawning the thread pool so the binder
+        // threads inherit it.
+        struct sched_param param = {};
+        param.sched_priority = 1;
+        if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) {
+            cerr << "worker " << num << ": failed to set SCHED_FIFO" << endl;
+        }
+    }
+    if (opts.server_threads > 0) {
+        ProcessState::self()->setThreadPoolMaxThreadCount(opts.server_threads);
+    }
+
     // Create BinderWorkerService and for go.
     ProcessState::self()->startThreadPool();
     sp<IServiceManager> serviceMgr = defaultServiceManager();
@@ -195,7 +248,7 @@ void worker_fx(int num,
 
     // If client/server pairs, then half the workers are
     // servers and half are clients
-    int server_count = cs_pair ? worker_count / 2 : worker_count;
+    int server_count = opts.cs_pair ? worker_count / 2 : worker_count;
 
     // Get references to other binder services.
     cout << "Created BinderWorker" << num << endl;
@@ -210,17 +263,22 @@ void worker_fx(int num,
     // Run the benchmark if client
     ProcResults results;
     chrono::time_point<chrono::high_resolution_clock> start, end;
-    for (int i = 0; (!cs_pair || num >= server_count) && i < iterations; i++) {
+    for (int i = 0; (!opts.cs_pair || num >= server_count) && i < opts.iterations; i++) {
         Parcel data, reply;
-        int target = cs_pair ? num % server_count : rand() % workers.size();
-        int sz = payload_size;
+        int target = opts.cs_pair ? num % server_count : rand() % workers.size();
+        int sz = opts.payload_size;
 
+        if (opts.track_dispatch) {
+            data.writeInt64(int64_t(nanotime()));
+            sz -= sizeof(int64_t);
+        }
         while (sz >= sizeof(uint32_t)) {
             data.writeInt32(0);
             sz -= sizeof(uint32_t);
         }
         start = chrono::high_resolution_clock::now();
-        status_t ret = workers[target]->transact(BINDER_NOP, data, &reply);
+        status_t ret = workers[target]->transact(BINDER_NOP, data, &reply,
+                                                 opts.oneway ? IBinder::FLAG_ONEWAY : 0);
         end = chrono::high_resolution_clock::now();
 
         uint64_t cur_time = uint64_t(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
@@ -236,14 +294,17 @@ void worker_fx(int num,
     p.signal();
     p.wait();
 
-    // Send results to master and wait for go to exit.
+    // Send results to master and wait for go to exit. The round-trip and
+    // dispatch histograms are kept separate; the latter is only populated
+    // on workers that served tracked transactions.
     p.send(results);
+    p.send(service->dispatchResults());
     p.wait();
 
     exit(EXIT_SUCCESS);
 }
 
-Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bool cs_pair)
+Pipe make_worker(int num, int worker_count, const TestOptions& opts)
 {
     auto pipe_pair = Pipe::createPipePair();
     pid_t pid = fork();
@@ -252,7 +313,7 @@ Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bo
         return move(get<0>(pipe_pair));
     } else {
         /* child */
-        worker_fx(num, worker_count, iterations, payload_size, cs_pair, move(get<1>(pipe_pair)));
+        worker_fx(num, worker_count, opts, move(get<1>(pipe_pair)));
         /* never get here */
         return move(get<0>(pipe_pair));
     }
@@ -273,16 +334,14 @@ void signal_all(vector<Pipe>& v)
     }
 }
 
-void run_main(int iterations,
+void run_main(const TestOptions& opts,
               int workers,
-              int payload_size,
-              int cs_pair,
               bool training_round=false)
 {
     vector<Pipe> pipes;
     // Create all the workers and wait for them to spawn.
     for (int i = 0; i < workers; i++) {
-        pipes.push_back(make_worker(i, iterations, workers, payload_size, cs_pair));
+        pipes.push_back(make_worker(i, workers, opts));
     }
     wait_all(pipes);
 
@@ -295,17 +354,20 @@ void run_main(int iterations,
     end = chrono::high_resolution_clock::now();
 
     // Calculate overall throughput.
-    double iterations_per_sec = double(iterations * workers) / (chrono::duration_cast<chrono::nanoseconds>(end - start).count() / 1.0E9);
+    double iterations_per_sec = double(opts.iterations * workers) / (chrono::duration_cast<chrono::nanoseconds>(end - start).count() / 1.0E9);
     cout << "iterations per sec: " << iterations_per_sec << endl;
 
     // Collect all results from the workers.
     cout << "collecting results" << endl;
     signal_all(pipes);
     ProcResults tot_results;
+    ProcResults dispatch_results;
     for (int i = 0; i < workers; i++) {
         ProcResults tmp_results;
         pipes[i].recv(tmp_results);
         tot_results = ProcResults::combine(tot_results, tmp_results);
+        pipes[i].recv(tmp_results);
+        dispatch_results = ProcResults::combine(dispatch_results, tmp_results);
     }
 
     // Kill all the workers.
@@ -325,16 +387,19 @@ void run_main(int iterations,
         time_per_bucket = max_time_bucket / num_buckets;
         cout << "Max latency during training: " << tot_results.m_worst / 1.0E6 << "ms" << endl;
     } else {
+            cout << "round-trip latency:" << endl;
             tot_results.dump();
+            if (opts.track_dispatch) {
+                cout << "wakeup-to-onTransact latency:" << endl;
+                dispatch_results.dump();
+            }
     }
 }
 
 int main(int argc, char *argv[])
 {
     int workers = 2;
-    int iterations = 10000;
-    int payload_size = 0;
-    bool cs_pair = false;
+    TestOptions opts;
     bool training_round = false;
     (void)argc;
     (void)argv;
@@ -343,8 +408,12 @@ int main(int argc, char *argv[])
     for (int i = 1; i < argc; i++) {
         if (string(argv[i]) == "--help") {
             cout << "Usage: binderThroughputTest [OPTIONS]" << endl;
+            cout << "\t-d      : Track wakeup-to-onTransact dispatch latency." << endl;
+            cout << "\t-f      : Run workers under SCHED_FIFO." << endl;
             cout << "\t-i N    : Specify number of iterations." << endl;
             cout << "\t-m N    : Specify expected max latency in microseconds." << endl;
+            cout << "\t-n N    : Specify binder thread pool size per worker." << endl;
+            cout << "\t-o      : Send transactions oneway." << endl;
             cout << "\t-p      : Split workers into client/server pairs." << endl;
             cout << "\t-s N    : Specify payload size." << endl;
             cout << "\t-t N    : Run training round." << endl;
@@ -357,19 +426,33 @@ int main(int argc, char *argv[])
             continue;
         }
         if (string(argv[i]) == "-i") {
-            iterations = atoi(argv[i+1]);
+            opts.iterations = atoi(argv[i+1]);
             i++;
             continue;
         }
         if (string(argv[i]) == "-s") {
-            payload_size = atoi(argv[i+1]);
+            opts.payload_size = atoi(argv[i+1]);
+            i++;
+        }
+        if (string(argv[i]) == "-n") {
+            opts.server_threads = atoi(argv[i+1]);
             i++;
+            continue;
+        }
+        if (string(argv[i]) == "-d") {
+            opts.track_dispatch = true;
+        }
+        if (string(argv[i]) == "-f") {
+            opts.fifo = true;
+        }
+        if (string(argv[i]) == "-o") {
+            opts.oneway = true;
         }
         if (string(argv[i]) == "-p") {
             // client/server pairs instead of spreading
             // requests to all workers. If true, half
             // the workers become clients and half servers
-            cs_pair = true;
+            opts.cs_pair = true;
         }
         if (string(argv[i]) == "-t") {
             // Run one training round before actually collecting data
@@ -392,10 +475,10 @@ int main(int argc, char *argv[])
 
     if (training_round) {
         cout << "Start training round" << endl;
-        run_main(iterations, workers, payload_size, cs_pair, training_round=true);
+        run_main(opts, workers, training_round=true);
         cout << "Completed training round" << endl << endl;
     }
 
-    run_main(iterations, workers, payload_size, cs_pair);
+    run_main(opts, workers);
     return 0;
 }
@@ -22,7 +22,9 @@
 #include <dirent.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <sys/syscall.h>
 #include <sys/sysinfo.h>
+#include <unistd.h>
 
 #include <mutex>
 #include <numeric>
@@ -324,6 +326,79 @@ std::optional<std::vector<std::vector<uint64_t>>> getUidCpuFreqTimes(uint32_t ui
     return out;
 }
 
+// BPF_MAP_LOOKUP_BATCH landed in kernel 5.6, after this tree's sanitized uapi headers,
+// so the command number and attribute layout are declared locally. Every member of
+// union bpf_attr starts at offset zero, so passing just the batch struct to the
+// syscall matches the kernel ABI.
+static constexpr int BPF_CMD_MAP_LOOKUP_BATCH = 24;
+
+struct bpf_map_batch_attr {
+    uint64_t in_batch;
+    uint64_t out_batch;
+    uint64_t keys;
+    uint64_t values;
+    uint32_t count;
+    uint32_t map_fd;
+    uint64_t elem_flags;
+    uint64_t flags;
+};
+
+static int bpfMapLookupBatch(const unique_fd &mapFd, uint32_t *inBatch, uint32_t *outBatch,
+                             void *keys, void *values, uint32_t *count) {
+    bpf_map_batch_attr attr = {
+            .in_batch = reinterpret_cast<uintptr_t>(inBatch),
+            .out_batch = reinterpret_cast<uintptr_t>(outBatch),
+            .keys = reinterpret_cast<uintptr_t>(keys),
+            .values = reinterpret_cast<uintptr_t>(values),
+            .count = *count,
+            .map_fd = static_cast<uint32_t>(mapFd.get()),
+    };
+    int ret = syscall(__NR_bpf, BPF_CMD_MAP_LOOKUP_BATCH, &attr, sizeof(attr));
+    *count = attr.count;
+    return ret;
+}
+
+// Iterates every entry of the per-cpu hash map |mapFd| with batched lookups, calling
+// |fn(key, perCpuVals)| for each. Returns false without calling |fn| when the kernel
+// lacks BPF_MAP_LOOKUP_BATCH (callers then walk key by key), nullopt on error, true
+// on success. The key/value scratch buffers are reused across sweeps: batterystats
+// polls every minute and reallocating the roughly 1 MB arena each time is
+// measurable churn.
+template <typename Key, typename Val, typename Fn>
+static std::optional<bool> forEachMapEntryBatched(const unique_fd &mapFd, uint32_t nvals, Fn fn) {
+    static thread_local uint32_t batchSize = 128;
+    static thread_local std::vector<Key> keys;
+    static thread_local std::vector<Val> vals;
+    keys.resize(batchSize);
+    vals.resize(batchSize * nvals);
+
+    uint32_t inBatch = 0, outBatch = 0;
+    bool first = true;
+    while (true) {
+        uint32_t count = batchSize;
+        int ret = bpfMapLookupBatch(mapFd, first ? nullptr : &inBatch, &outBatch, keys.data(),
+                                    vals.data(), &count);
+        if (ret < 0 && errno == ENOSPC) {
+            // A hash bucket held more entries than the batch could take; grow and retry.
+            batchSize *= 2;
+            keys.resize(batchSize);
+            vals.resize(batchSize * nvals);
+            continue;
+        }
+        if (ret < 0 && errno != ENOENT) {
+            if (first && (errno == EINVAL || errno == EPERM)) return false;
+            return {};
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            if (!fn(keys[i], &vals[i * nvals])) return {};
+        }
+        if (ret < 0) break; // ENOENT: no entries past this batch
+        inBatch = outBatch;
+        first = false;
+    }
+    return true;
+}
+
 static std::optional<bool> uidUpdatedSince(uint32_t uid, uint64_t lastUpdate,
                                            uint64_t *newLastUpdate) {
     uint64_t uidLastUpdate;
@@ -353,25 +428,24 @@ getUidsCpuFreqTimes() {
 std::optional<std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>>>
 getUidsUpdatedCpuFreqTimes(uint64_t *lastUpdate) {
     if (!gInitialized && !initGlobals()) return {};
-    time_key_t key, prevKey;
     std::unordered_map<uint32_t, std::vector<std::vector<uint64_t>>> map;
-    if (getFirstMapKey(gTisMapFd, &key)) {
-        if (errno == ENOENT) return map;
-        return std::nullopt;
-    }
 
     std::vector<std::vector<uint64_t>> mapFormat;
     for (const auto &freqList : gPolicyFreqs) mapFormat.emplace_back(freqList.size(), 0);
 
     uint64_t newLastUpdate = lastUpdate ? *lastUpdate : 0;
-    std::vector<tis_val_t> vals(gNCpus);
-    do {
-        if (lastUpdate) {
-            auto uidUpdated = uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate);
-            if (!uidUpdated.has_value()) return {};
-            if (!*uidUpdated) continue;
-        }
-        if (findMapEntry(gTisMapFd, &key, vals.data())) return {};
+    // Each uid appears once per bucket; memoize the filter so the last-update map is
+    // consulted once per uid rather than once per entry.
+    std::unordered_map<uint32_t, bool> uidUpdated;
+    auto uidFilter = [&](uint32_t uid) -> std::optional<bool> {
+        if (!lastUpdate) return true;
+        auto it = uidUpdated.find(uid);
+        if (it != uidUpdated.end()) return it->second;
+        auto updated = uidUpdatedSince(uid, *lastUpdate, &newLastUpdate);
+        if (updated.has_value()) uidUpdated.emplace(uid, *updated);
+        return updated;
+    };
+    auto aggregate = [&](const time_key_t &key, const tis_val_t *vals) {
         if (map.find(key.uid) == map.end()) map.emplace(key.uid, mapFormat);
 
         auto offset = key.bucket * FREQS_PER_ENTRY;
@@ -385,9 +459,33 @@ getUidsUpdatedCpuFreqTimes(uint64_t *lastUpdate) {
                 std::transform(begin, end, std::begin(vals[cpu].ar), begin, std::plus<uint64_t>());
             }
         }
-        prevKey = key;
-    } while (prevKey = key, !getNextMapKey(gTisMapFd, &prevKey, &key));
-    if (errno != ENOENT) return {};
+    };
+
+    auto batched = forEachMapEntryBatched<time_key_t, tis_val_t>(
+            gTisMapFd, gNCpus, [&](const time_key_t &key, const tis_val_t *vals) {
+                auto pass = uidFilter(key.uid);
+                if (!pass.has_value()) return false;
+                if (*pass) aggregate(key, vals);
+                return true;
+            });
+    if (!batched.has_value()) return {};
+    if (!*batched) {
+        // Kernel without BPF_MAP_LOOKUP_BATCH: walk the map key by key.
+        time_key_t key, prevKey;
+        if (getFirstMapKey(gTisMapFd, &key)) {
+            if (errno == ENOENT) return map;
+            return std::nullopt;
+        }
+        std::vector<tis_val_t> vals(gNCpus);
+        do {
+            auto pass = uidFilter(key.uid);
+            if (!pass.has_value()) return {};
+            if (!*pass) continue;
+            if (findMapEntry(gTisMapFd, &key, vals.data())) return {};
+            aggregate(key, vals.data());
+        } while (prevKey = key, !getNextMapKey(gTisMapFd, &prevKey, &key));
+        if (errno != ENOENT) return {};
+    }
     if (lastUpdate && newLastUpdate > *lastUpdate) *lastUpdate = newLastUpdate;
     return map;
 }
@@ -463,35 +561,30 @@ std::optional<std::unordered_map<uint32_t, concurrent_time_t>> getUidsConcurrent
 std::optional<std::unordered_map<uint32_t, concurrent_time_t>> getUidsUpdatedConcurrentTimes(
         uint64_t *lastUpdate) {
     if (!gInitialized && !initGlobals()) return {};
-    time_key_t key, prevKey;
     std::unordered_map<uint32_t, concurrent_time_t> ret;
-    if (getFirstMapKey(gConcurrentMapFd, &key)) {
-        if (errno == ENOENT) return ret;
-        return {};
-    }
 
     concurrent_time_t retFormat = {.active = std::vector<uint64_t>(gNCpus, 0)};
     for (const auto &cpuList : gPolicyCpus) retFormat.policy.emplace_back(cpuList.size(), 0);
 
-    std::vector<concurrent_val_t> vals(gNCpus);
-    std::vector<uint64_t>::iterator activeBegin, activeEnd, policyBegin, policyEnd;
-
     uint64_t newLastUpdate = lastUpdate ? *lastUpdate : 0;
-    do {
-        if (key.bucket > (gNCpus - 1) / CPUS_PER_ENTRY) return {};
-        if (lastUpdate) {
-            auto uidUpdated = uidUpdatedSince(key.uid, *lastUpdate, &newLastUpdate);
-            if (!uidUpdated.has_value()) return {};
-            if (!*uidUpdated) continue;
-        }
-        if (findMapEntry(gConcurrentMapFd, &key, vals.data())) return {};
+    std::unordered_map<uint32_t, bool> uidUpdated;
+    auto uidFilter = [&](uint32_t uid) -> std::optional<bool> {
+        if (!lastUpdate) return true;
+        auto it = uidUpdated.find(uid);
+        if (it != uidUpdated.end()) return it->second;
+        auto updated = uidUpdatedSince(uid, *lastUpdate, &newLastUpdate);
+        if (updated.has_value()) uidUpdated.emplace(uid, *updated);
+        return updated;
+    };
+    auto aggregate = [&](const time_key_t &key, const concurrent_val_t *vals) {
         if (ret.find(key.uid) == ret.end()) ret.emplace(key.uid, retFormat);
 
         auto offset = key.bucket * CPUS_PER_ENTRY;
         auto nextOffset = (key.bucket + 1) * CPUS_PER_ENTRY;
 
-        activeBegin = ret[key.uid].active.begin();
-        activeEnd = nextOffset < gNCpus ? activeBegin + CPUS_PER_ENTRY : ret[key.uid].active.end();
+        auto activeBegin = ret[key.uid].active.begin();
+        auto activeEnd = nextOffset < gNCpus ? activeBegin + CPUS_PER_ENTRY
+                                             : ret[key.uid].active.end();
 
         for (uint32_t cpu = 0; cpu < gNCpus; ++cpu) {
             std::transform(activeBegin, activeEnd, std::begin(vals[cpu].active), activeBegin,
@@ -500,17 +593,45 @@ std::optional<std::unordered_map<uint32_t, concurrent_time_t>> getUidsUpdatedCon
 
         for (uint32_t policy = 0; policy < gNPolicies; ++policy) {
             if (offset >= gPolicyCpus[policy].size()) continue;
-            policyBegin = ret[key.uid].policy[policy].begin() + offset;
-            policyEnd = nextOffset < gPolicyCpus[policy].size() ? policyBegin + CPUS_PER_ENTRY
-                                                                : ret[key.uid].policy[policy].end();
+            auto policyBegin = ret[key.uid].policy[policy].begin() + offset;
+            auto policyEnd = nextOffset < gPolicyCpus[policy].size()
+                    ? policyBegin + CPUS_PER_ENTRY
+                    : ret[key.uid].policy[policy].end();
 
             for (const auto &cpu : gPolicyCpus[policy]) {
                 std::transform(policyBegin, policyEnd, std::begin(vals[cpu].policy), policyBegin,
                                std::plus<uint64_t>());
             }
         }
-    } while (prevKey = key, !getNextMapKey(gConcurrentMapFd, &prevKey, &key));
-    if (errno != ENOENT) return {};
+    };
+
+    auto batched = forEachMapEntryBatched<time_key_t, concurrent_val_t>(
+            gConcurrentMapFd, gNCpus, [&](const time_key_t &key, const concurrent_val_t *vals) {
+                if (key.bucket > (gNCpus - 1) / CPUS_PER_ENTRY) return false;
+                auto pass = uidFilter(key.uid);
+                if (!pass.has_value()) return false;
+                if (*pass) aggregate(key, vals);
+                return true;
+            });
+    if (!batched.has_value()) return {};
+    if (!*batched) {
+        // Kernel without BPF_MAP_LOOKUP_BATCH: walk the map key by key.
+        time_key_t key, prevKey;
+        if (getFirstMapKey(gConcurrentMapFd, &key)) {
+            if (errno == ENOENT) return ret;
+            return {};
+        }
+        std::vector<concurrent_val_t> vals(gNCpus);
+        do {
+            if (key.bucket > (gNCpus - 1) / CPUS_PER_ENTRY) return {};
+            auto pass = uidFilter(key.uid);
+            if (!pass.has_value()) return {};
+            if (!*pass) continue;
+            if (findMapEntry(gConcurrentMapFd, &key, vals.data())) return {};
+            aggregate(key, vals.data());
+        } while (prevKey = key, !getNextMapKey(gConcurrentMapFd, &prevKey, &key));
+        if (errno != ENOENT) return {};
+    }
     for (const auto &[key, value] : ret) {
         if (!verifyConcurrentTimes(value)) {
             auto val = getUidConcurrentTimes(key, false);
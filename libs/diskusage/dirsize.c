@@ -17,7 +17,10 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <diskusage/dirsize.h>
@@ -30,7 +33,7 @@ int64_t stat_size(struct stat *s)
 int64_t calculate_dir_size(int dfd)
 {
     int64_t size = 0;
-    struct stat s;
+    struct statx sx;
     DIR *d;
     struct dirent *de;
 
@@ -53,19 +56,143 @@ int64_t calculate_dir_size(int dfd)
                     continue;
             }
 
-            if (fstatat(dfd, name, &s, AT_SYMLINK_NOFOLLOW) == 0) {
-                size += stat_size(&s);
+            /* only the block count is needed; the minimal statx mask lets
+             * the kernel skip fields that are expensive to fill in */
+            if (statx(dfd, name, AT_SYMLINK_NOFOLLOW, STATX_BLOCKS, &sx) == 0) {
+                size += sx.stx_blocks * 512;
             }
             subfd = openat(dfd, name, O_RDONLY | O_DIRECTORY);
             if (subfd >= 0) {
                 size += calculate_dir_size(subfd);
             }
         } else {
-            if (fstatat(dfd, name, &s, AT_SYMLINK_NOFOLLOW) == 0) {
-                size += stat_size(&s);
+            if (statx(dfd, name, AT_SYMLINK_NOFOLLOW, STATX_BLOCKS, &sx) == 0) {
+                size += sx.stx_blocks * 512;
             }
         }
     }
     closedir(d);
     return size;
 }
+
+/* open-addressed hash table of cached tree sizes, linear probing */
+#define CACHE_BUCKETS 1024
+#define CACHE_PROBES 8
+#define CACHE_TTL_SEC (5 * 60)
+
+struct cache_entry {
+    char *path;
+    struct statx_timestamp mtime;
+    int64_t size;
+    time_t expiry;
+};
+
+struct dir_size_cache {
+    struct cache_entry entries[CACHE_BUCKETS];
+};
+
+struct dir_size_cache *dir_size_cache_create(void)
+{
+    return calloc(1, sizeof(struct dir_size_cache));
+}
+
+void dir_size_cache_destroy(struct dir_size_cache *cache)
+{
+    unsigned i;
+
+    if (cache == NULL)
+        return;
+    for (i = 0; i < CACHE_BUCKETS; i++) {
+        free(cache->entries[i].path);
+    }
+    free(cache);
+}
+
+static unsigned cache_hash(const char *path)
+{
+    /* djb2 */
+    unsigned h = 5381;
+    while (*path) {
+        h = h * 33 + (unsigned char) *path++;
+    }
+    return h;
+}
+
+static time_t monotime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+static struct cache_entry *cache_find(struct dir_size_cache *cache, const char *path)
+{
+    unsigned h = cache_hash(path);
+    unsigned i;
+
+    for (i = 0; i < CACHE_PROBES; i++) {
+        struct cache_entry *entry = &cache->entries[(h + i) % CACHE_BUCKETS];
+        if (entry->path != NULL && !strcmp(entry->path, path)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void cache_put(struct dir_size_cache *cache, const char *path,
+                      const struct statx_timestamp *mtime, int64_t size)
+{
+    unsigned h = cache_hash(path);
+    struct cache_entry *victim = &cache->entries[h % CACHE_BUCKETS];
+    unsigned i;
+
+    for (i = 0; i < CACHE_PROBES; i++) {
+        struct cache_entry *entry = &cache->entries[(h + i) % CACHE_BUCKETS];
+        if (entry->path == NULL || !strcmp(entry->path, path)) {
+            victim = entry;
+            break;
+        }
+        /* keep the slot closest to expiry as the eviction victim */
+        if (entry->expiry < victim->expiry) {
+            victim = entry;
+        }
+    }
+
+    if (victim->path == NULL || strcmp(victim->path, path) != 0) {
+        char *dup = strdup(path);
+        if (dup == NULL)
+            return;
+        free(victim->path);
+        victim->path = dup;
+    }
+    victim->mtime = *mtime;
+    victim->size = size;
+    victim->expiry = monotime() + CACHE_TTL_SEC;
+}
+
+int64_t calculate_dir_size_cached(const char *path, struct dir_size_cache *cache)
+{
+    struct statx sx;
+    struct cache_entry *entry;
+    int64_t size;
+    int dfd;
+
+    if (cache == NULL || statx(AT_FDCWD, path, AT_SYMLINK_NOFOLLOW, STATX_MTIME, &sx) != 0) {
+        dfd = open(path, O_RDONLY | O_DIRECTORY);
+        return dfd >= 0 ? calculate_dir_size(dfd) : 0;
+    }
+
+    entry = cache_find(cache, path);
+    if (entry != NULL && entry->mtime.tv_sec == sx.stx_mtime.tv_sec
+            && entry->mtime.tv_nsec == sx.stx_mtime.tv_nsec && monotime() < entry->expiry) {
+        return entry->size;
+    }
+
+    dfd = open(path, O_RDONLY | O_DIRECTORY);
+    if (dfd < 0) {
+        return 0;
+    }
+    size = calculate_dir_size(dfd);
+    cache_put(cache, path, &sx.stx_mtime, size);
+    return size;
+}
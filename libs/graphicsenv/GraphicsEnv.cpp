@@ -37,6 +37,7 @@
 #include <utils/Trace.h>
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 
@@ -108,17 +109,28 @@ static bool readConfig(const std::string& configFile, std::vector<std::string>*
     return true;
 }
 
-static const std::string getSystemNativeLibraries(NativeLibrary type) {
-    std::string nativeLibrariesSystemConfig = kNativeLibrariesSystemConfigPath[type];
-    insertVndkVersionStr(&nativeLibrariesSystemConfig);
+static const std::string& getSystemNativeLibraries(NativeLibrary type) {
+    // The library lists are immutable for the lifetime of the device, so parse
+    // each config file at most once per process. When the parse happens in the
+    // zygote (see GraphicsEnv::prewarmNamespaceConfig) every forked app process
+    // inherits the cached result and skips the filesystem probing entirely.
+    static std::string cachedLibraries[2];
+    static std::once_flag parseFlags[2];
 
-    std::vector<std::string> soNames;
-    if (!readConfig(nativeLibrariesSystemConfig, &soNames)) {
-        ALOGE("Failed to retrieve library names from %s", nativeLibrariesSystemConfig.c_str());
-        return "";
-    }
+    std::call_once(parseFlags[type], [type] {
+        std::string nativeLibrariesSystemConfig = kNativeLibrariesSystemConfigPath[type];
+        insertVndkVersionStr(&nativeLibrariesSystemConfig);
+
+        std::vector<std::string> soNames;
+        if (!readConfig(nativeLibrariesSystemConfig, &soNames)) {
+            ALOGE("Failed to retrieve library names from %s", nativeLibrariesSystemConfig.c_str());
+            return;
+        }
 
-    return base::Join(soNames, ':');
+        cachedLibraries[type] = base::Join(soNames, ':');
+    });
+
+    return cachedLibraries[type];
 }
 
 /*static*/ GraphicsEnv& GraphicsEnv::getInstance() {
@@ -130,6 +142,15 @@ bool GraphicsEnv::isDebuggable() {
     return prctl(PR_GET_DUMPABLE, 0, 0, 0, 0) > 0;
 }
 
+void GraphicsEnv::prewarmNamespaceConfig() {
+    ATRACE_CALL();
+    // Parse both linker namespace library lists now so that processes forked
+    // from this one inherit the cached results via copy-on-write and their
+    // driver namespace setup reduces to namespace creation and linking.
+    (void)getSystemNativeLibraries(NativeLibrary::LLNDK);
+    (void)getSystemNativeLibraries(NativeLibrary::VNDKSP);
+}
+
 void GraphicsEnv::setDriverPathAndSphalLibraries(const std::string path,
                                                  const std::string sphalLibraries) {
     if (!mDriverPath.empty() || !mSphalLibraries.empty()) {
@@ -514,6 +535,18 @@ void GraphicsEnv::setLayerPaths(NativeLoaderNamespace* appNamespace, const std::
     }
 }
 
+void GraphicsEnv::setLayerCacheDir(const std::string cacheDir) {
+    if (mLayerCacheDir.empty()) {
+        mLayerCacheDir = cacheDir;
+    } else {
+        ALOGV("Vulkan layer cache dir already set, not clobbering with '%s'", cacheDir.c_str());
+    }
+}
+
+const std::string& GraphicsEnv::getLayerCacheDir() {
+    return mLayerCacheDir;
+}
+
 NativeLoaderNamespace* GraphicsEnv::getAppNamespace() {
     return mAppNamespace;
 }
@@ -56,6 +56,11 @@ public:
     // graphics drivers. The string is a list of libraries separated by ':',
     // which is required by android_link_namespaces.
     void setDriverPathAndSphalLibraries(const std::string path, const std::string sphalLibraries);
+    // Pre-parse the linker namespace configuration needed to set up the driver
+    // namespace. Meant to be called in the zygote before forking so that app
+    // processes inherit the parsed config and the first GL call no longer pays
+    // for the filesystem probing.
+    void prewarmNamespaceConfig();
     // Get the updatable driver namespace.
     android_namespace_t* getDriverNamespace();
     std::string getDriverPath() const;
@@ -108,6 +113,11 @@ public:
      */
     // Set additional layer search paths.
     void setLayerPaths(NativeLoaderNamespace* appNamespace, const std::string layerPaths);
+    // Set the directory used to persist the Vulkan layer manifest cache,
+    // typically the app's code cache dir. An empty string disables the cache.
+    void setLayerCacheDir(const std::string cacheDir);
+    // Get the layer manifest cache directory.
+    const std::string& getLayerCacheDir();
     // Get the app namespace for loading layers.
     NativeLoaderNamespace* getAppNamespace();
     // Get additional layer search paths.
@@ -164,6 +174,8 @@ private:
     std::string mDebugLayersGLES;
     // Additional debug layers search path.
     std::string mLayerPaths;
+    // Directory for the persisted Vulkan layer manifest cache.
+    std::string mLayerCacheDir;
     // This mutex protects the namespace creation.
     std::mutex mNamespaceMutex;
     // Updatable driver namespace.
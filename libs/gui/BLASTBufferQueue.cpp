@@ -23,14 +23,27 @@
 #include <gui/BufferItemConsumer.h>
 #include <gui/GLConsumer.h>
 
+#include <cutils/properties.h>
 #include <utils/Trace.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
 
 using namespace std::chrono_literals;
 
 namespace android {
 
+namespace {
+
+int32_t getMaxAcquiredBuffers() {
+    char value[PROPERTY_VALUE_MAX];
+    property_get("debug.blast.max_acquired_buffers", value, "1");
+    return std::min(std::max(atoi(value), 1), 3);
+}
+
+} // namespace
+
 void BLASTBufferItemConsumer::onDisconnect() {
     Mutex::Autolock lock(mFrameEventHistoryMutex);
     mPreviouslyConnected = mCurrentlyConnected;
@@ -96,6 +109,7 @@ void BLASTBufferItemConsumer::getConnectionEvents(uint64_t frameNumber, bool* ne
 BLASTBufferQueue::BLASTBufferQueue(const sp<SurfaceControl>& surface, int width, int height,
                                    bool enableTripleBuffering)
       : mSurfaceControl(surface),
+        mMaxAcquiredBuffers(getMaxAcquiredBuffers()),
         mWidth(width),
         mHeight(height),
         mNextTransaction(nullptr) {
@@ -107,8 +121,8 @@ BLASTBufferQueue::BLASTBufferQueue(const sp<SurfaceControl>& surface, int width,
     if (enableTripleBuffering) {
         mProducer->setMaxDequeuedBufferCount(2);
     }
-    mBufferItemConsumer =
-        new BLASTBufferItemConsumer(mConsumer, GraphicBuffer::USAGE_HW_COMPOSER, 1, true);
+    mBufferItemConsumer = new BLASTBufferItemConsumer(mConsumer, GraphicBuffer::USAGE_HW_COMPOSER,
+                                                      mMaxAcquiredBuffers, true);
     static int32_t id = 0;
     auto name = std::string("BLAST Consumer") + std::to_string(id);
     id++;
@@ -195,7 +209,7 @@ void BLASTBufferQueue::transactionCallback(nsecs_t /*latchTime*/, const sp<Fence
 
 void BLASTBufferQueue::processNextBufferLocked(bool useNextTransaction) {
     ATRACE_CALL();
-    if (mNumFrameAvailable == 0 || mNumAcquired == MAX_ACQUIRED_BUFFERS + 1) {
+    if (mNumFrameAvailable == 0 || mNumAcquired == mMaxAcquiredBuffers + 1) {
         return;
     }
 
@@ -269,7 +283,11 @@ void BLASTBufferQueue::onFrameAvailable(const BufferItem& /*item*/) {
     std::unique_lock _lock{mMutex};
 
     if (mNextTransaction != nullptr) {
-        while (mNumFrameAvailable > 0 || mNumAcquired == MAX_ACQUIRED_BUFFERS + 1) {
+        // The next transaction must carry exactly this frame, so any older
+        // frames still in the shadow queue have to drain first. With a
+        // pipeline depth above 1 they are normally acquired as soon as they
+        // arrive, so this only stalls once the pipeline itself is full.
+        while (mNumFrameAvailable > 0 || mNumAcquired == mMaxAcquiredBuffers + 1) {
             mCallbackCV.wait(_lock);
         }
     }
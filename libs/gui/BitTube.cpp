@@ -17,12 +17,16 @@
 #include <private/gui/BitTube.h>
 
 #include <stdint.h>
+#include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include <utils/Errors.h>
 
 #include <binder/Parcel.h>
@@ -34,6 +38,11 @@ namespace gui {
 // need. So we make it smaller.
 static const size_t DEFAULT_SOCKET_BUFFER_SIZE = 4 * 1024;
 
+// Number of queued messages a single recvmmsg call may drain. Event bursts
+// (vsync + hotplug + config-change) are sent as separate messages; draining
+// them together saves one syscall per message.
+static const size_t RECV_BATCH_SIZE = 8;
+
 BitTube::BitTube(size_t bufsize) {
     init(bufsize, bufsize);
 }
@@ -161,16 +170,75 @@ ssize_t BitTube::sendObjects(BitTube* tube, void const* events, size_t count, si
 
 ssize_t BitTube::recvObjects(BitTube* tube, void* events, size_t count, size_t objSize) {
     char* vaddr = reinterpret_cast<char*>(events);
-    ssize_t size = tube->read(vaddr, count * objSize);
+    const size_t capacity = count * objSize;
+    size_t consumed = 0;
+
+    // First serve objects a previous batched receive pulled off the socket
+    // but had no room for.
+    if (tube->mSpilloverStart < tube->mSpillover.size()) {
+        const size_t pending = tube->mSpillover.size() - tube->mSpilloverStart;
+        const size_t n = std::min(pending, capacity);
+        memcpy(vaddr, tube->mSpillover.data() + tube->mSpilloverStart, n);
+        tube->mSpilloverStart += n;
+        if (tube->mSpilloverStart == tube->mSpillover.size()) {
+            tube->mSpillover.clear();
+            tube->mSpilloverStart = 0;
+        }
+        consumed = n;
+    }
 
-    // should never happen because of SOCK_SEQPACKET
-    LOG_ALWAYS_FATAL_IF((size >= 0) && (size % static_cast<ssize_t>(objSize)),
-                        "BitTube::recvObjects(count=%zu, size=%zu), res=%zd (partial events were "
-                        "received!)",
-                        count, objSize, size);
+    if (consumed < capacity) {
+        // Drain up to RECV_BATCH_SIZE queued messages with a single syscall.
+        // Each message gets a buffer as large as the caller's, so the
+        // excess-discard behavior for a single oversized message is the same
+        // as it was with one recv per message.
+        if (tube->mRecvBuffer.size() < RECV_BATCH_SIZE * capacity) {
+            tube->mRecvBuffer.resize(RECV_BATCH_SIZE * capacity);
+        }
+        mmsghdr msgs[RECV_BATCH_SIZE];
+        iovec iovs[RECV_BATCH_SIZE];
+        memset(msgs, 0, sizeof(msgs));
+        for (size_t i = 0; i < RECV_BATCH_SIZE; i++) {
+            iovs[i].iov_base = tube->mRecvBuffer.data() + i * capacity;
+            iovs[i].iov_len = capacity;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int received;
+        int err;
+        do {
+            received = recvmmsg(tube->mReceiveFd, msgs, RECV_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+            err = received < 0 ? errno : 0;
+        } while (err == EINTR);
+
+        if (received < 0 && err != EAGAIN && err != EWOULDBLOCK && consumed == 0) {
+            return -err;
+        }
+
+        for (int i = 0; i < received; i++) {
+            const size_t len = msgs[i].msg_len;
+
+            // should never happen because of SOCK_SEQPACKET
+            LOG_ALWAYS_FATAL_IF(len % objSize,
+                                "BitTube::recvObjects(count=%zu, size=%zu), len=%zu (partial "
+                                "events were received!)",
+                                count, objSize, len);
+
+            const char* packet = tube->mRecvBuffer.data() + i * capacity;
+            const size_t fits = std::min(len, capacity - consumed);
+            memcpy(vaddr + consumed, packet, fits);
+            consumed += fits;
+            if (fits < len) {
+                // mSpillover is always empty here: if a previous call left
+                // objects behind, they filled this call's buffer above and we
+                // never reached the socket.
+                tube->mSpillover.insert(tube->mSpillover.end(), packet + fits, packet + len);
+            }
+        }
+    }
 
-    // ALOGE_IF(size<0, "error %d receiving %d events", size, count);
-    return size < 0 ? size : size / static_cast<ssize_t>(objSize);
+    return static_cast<ssize_t>(consumed / objSize);
 }
 
 } // namespace gui
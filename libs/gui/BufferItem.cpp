@@ -67,25 +67,17 @@ static void addAligned(size_t& size, T /* value */) {
     size += sizeof(T);
 }
 
+template <typename... T>
+static void addAlignedAll(size_t& size, const T&... values) {
+    (addAligned(size, values), ...);
+}
+
 size_t BufferItem::getPodSize() const {
     size_t size = 0;
-    addAligned(size, mCrop);
-    addAligned(size, mTransform);
-    addAligned(size, mScalingMode);
-    addAligned(size, low32(mTimestamp));
-    addAligned(size, high32(mTimestamp));
-    addAligned(size, mIsAutoTimestamp);
-    addAligned(size, mDataSpace);
-    addAligned(size, low32(mFrameNumber));
-    addAligned(size, high32(mFrameNumber));
-    addAligned(size, mSlot);
-    addAligned(size, mIsDroppable);
-    addAligned(size, mAcquireCalled);
-    addAligned(size, mTransformToDisplayInverse);
-    addAligned(size, mAutoRefresh);
-    addAligned(size, mQueuedBuffer);
-    addAligned(size, mIsStale);
-    addAligned(size, mApi);
+    addAlignedAll(size, mCrop, mTransform, mScalingMode, low32(mTimestamp), high32(mTimestamp),
+                  mIsAutoTimestamp, mDataSpace, low32(mFrameNumber), high32(mFrameNumber), mSlot,
+                  mIsDroppable, mAcquireCalled, mTransformToDisplayInverse, mAutoRefresh,
+                  mQueuedBuffer, mIsStale, mApi);
     return size;
 }
 
@@ -122,6 +114,13 @@ static void writeAligned(void*& buffer, size_t& size, T value) {
     FlattenableUtils::write(buffer, size, value);
 }
 
+// Writes the whole POD section in one fold, giving the compiler a single
+// run of fixed-size copies to merge. The argument list is the wire layout.
+template <typename... T>
+static void writeAlignedAll(void*& buffer, size_t& size, const T&... values) {
+    (writeAligned(buffer, size, values), ...);
+}
+
 status_t BufferItem::flatten(
         void*& buffer, size_t& size, int*& fds, size_t& count) const {
 
@@ -163,23 +162,10 @@ status_t BufferItem::flatten(
         return NO_MEMORY;
     }
 
-    writeAligned(buffer, size, mCrop);
-    writeAligned(buffer, size, mTransform);
-    writeAligned(buffer, size, mScalingMode);
-    writeAligned(buffer, size, low32(mTimestamp));
-    writeAligned(buffer, size, high32(mTimestamp));
-    writeAligned(buffer, size, mIsAutoTimestamp);
-    writeAligned(buffer, size, mDataSpace);
-    writeAligned(buffer, size, low32(mFrameNumber));
-    writeAligned(buffer, size, high32(mFrameNumber));
-    writeAligned(buffer, size, mSlot);
-    writeAligned(buffer, size, mIsDroppable);
-    writeAligned(buffer, size, mAcquireCalled);
-    writeAligned(buffer, size, mTransformToDisplayInverse);
-    writeAligned(buffer, size, mAutoRefresh);
-    writeAligned(buffer, size, mQueuedBuffer);
-    writeAligned(buffer, size, mIsStale);
-    writeAligned(buffer, size, mApi);
+    writeAlignedAll(buffer, size, mCrop, mTransform, mScalingMode, low32(mTimestamp),
+                    high32(mTimestamp), mIsAutoTimestamp, mDataSpace, low32(mFrameNumber),
+                    high32(mFrameNumber), mSlot, mIsDroppable, mAcquireCalled,
+                    mTransformToDisplayInverse, mAutoRefresh, mQueuedBuffer, mIsStale, mApi);
 
     return NO_ERROR;
 }
@@ -190,6 +176,11 @@ static void readAligned(const void*& buffer, size_t& size, T& value) {
     FlattenableUtils::read(buffer, size, value);
 }
 
+template <typename... T>
+static void readAlignedAll(const void*& buffer, size_t& size, T&... values) {
+    (readAligned(buffer, size, values), ...);
+}
+
 status_t BufferItem::unflatten(
         void const*& buffer, size_t& size, int const*& fds, size_t& count) {
 
@@ -232,25 +223,12 @@ status_t BufferItem::unflatten(
     uint32_t timestampLo = 0, timestampHi = 0;
     uint32_t frameNumberLo = 0, frameNumberHi = 0;
 
-    readAligned(buffer, size, mCrop);
-    readAligned(buffer, size, mTransform);
-    readAligned(buffer, size, mScalingMode);
-    readAligned(buffer, size, timestampLo);
-    readAligned(buffer, size, timestampHi);
+    readAlignedAll(buffer, size, mCrop, mTransform, mScalingMode, timestampLo, timestampHi,
+                   mIsAutoTimestamp, mDataSpace, frameNumberLo, frameNumberHi, mSlot,
+                   mIsDroppable, mAcquireCalled, mTransformToDisplayInverse, mAutoRefresh,
+                   mQueuedBuffer, mIsStale, mApi);
     mTimestamp = to64<int64_t>(timestampLo, timestampHi);
-    readAligned(buffer, size, mIsAutoTimestamp);
-    readAligned(buffer, size, mDataSpace);
-    readAligned(buffer, size, frameNumberLo);
-    readAligned(buffer, size, frameNumberHi);
     mFrameNumber = to64<uint64_t>(frameNumberLo, frameNumberHi);
-    readAligned(buffer, size, mSlot);
-    readAligned(buffer, size, mIsDroppable);
-    readAligned(buffer, size, mAcquireCalled);
-    readAligned(buffer, size, mTransformToDisplayInverse);
-    readAligned(buffer, size, mAutoRefresh);
-    readAligned(buffer, size, mQueuedBuffer);
-    readAligned(buffer, size, mIsStale);
-    readAligned(buffer, size, mApi);
 
     return NO_ERROR;
 }
@@ -120,6 +120,13 @@ status_t BufferQueueConsumer::acquireBuffer(BufferItem* outBuffer,
         // to drop a buffer.
         // Skip this if we're in shared buffer mode and the queue is empty,
         // since in that case we'll just return the shared buffer.
+        // Remember the present time the consumer is targeting. With stuffing
+        // recovery enabled, queueBuffer uses it to recognize queued frames
+        // that can only be presented late.
+        if (expectedPresent != 0) {
+            mCore->mLastExpectedPresent = expectedPresent;
+        }
+
         if (expectedPresent != 0 && !mCore->mQueue.empty()) {
             // The 'expectedPresent' argument indicates when the buffer is expected
             // to be presented on-screen. If the buffer's desired present time is
@@ -303,6 +310,10 @@ status_t BufferQueueConsumer::acquireBuffer(BufferItem* outBuffer,
 
         mCore->mQueue.erase(front);
 
+        // The queue may have drained below the stuffed level, so re-arm the
+        // edge-triggered stuffing signal sent from queueBuffer.
+        mCore->mQueueStuffed = mCore->isQueueStuffedLocked();
+
         // We might have freed a slot while dropping old buffers, or the producer
         // may be blocked waiting for the number of buffers in the queue to
         // decrease.
@@ -518,6 +529,92 @@ status_t BufferQueueConsumer::releaseBuffer(int slot, uint64_t frameNumber,
     return NO_ERROR;
 }
 
+status_t BufferQueueConsumer::releaseBuffers(const std::vector<ReleaseItem>& items) {
+    ATRACE_CALL();
+
+    status_t result = NO_ERROR;
+    size_t releasedCount = 0;
+    sp<IProducerListener> listener;
+    { // Autolock scope
+        std::lock_guard<std::mutex> lock(mCore->mMutex);
+
+        for (const ReleaseItem& item : items) {
+            const int slot = item.slot;
+            if (slot < 0 || slot >= BufferQueueDefs::NUM_BUFFER_SLOTS ||
+                    item.releaseFence == nullptr) {
+                BQ_LOGE("releaseBuffers: slot %d out of range or fence %p NULL",
+                        slot, item.releaseFence.get());
+                if (result == NO_ERROR) {
+                    result = BAD_VALUE;
+                }
+                continue;
+            }
+
+            // If the frame number has changed because the buffer has been
+            // reallocated, we can ignore this release for the old buffer.
+            // Ignore this for the shared buffer where the frame number can
+            // easily get out of sync due to the buffer being queued and
+            // acquired at the same time.
+            if (item.frameNumber != mSlots[slot].mFrameNumber &&
+                    !mSlots[slot].mBufferState.isShared()) {
+                if (result == NO_ERROR) {
+                    result = STALE_BUFFER_SLOT;
+                }
+                continue;
+            }
+
+            if (!mSlots[slot].mBufferState.isAcquired()) {
+                BQ_LOGE("releaseBuffers: attempted to release buffer slot %d "
+                        "but its state was %s", slot,
+                        mSlots[slot].mBufferState.string());
+                if (result == NO_ERROR) {
+                    result = BAD_VALUE;
+                }
+                continue;
+            }
+
+            mSlots[slot].mEglDisplay = EGL_NO_DISPLAY;
+            mSlots[slot].mEglFence = EGL_NO_SYNC_KHR;
+            mSlots[slot].mFence = item.releaseFence;
+            mSlots[slot].mBufferState.release();
+
+            // After leaving shared buffer mode, the shared buffer will
+            // still be around. Mark it as no longer shared if this
+            // operation causes it to be free.
+            if (!mCore->mSharedBufferMode && mSlots[slot].mBufferState.isFree()) {
+                mSlots[slot].mBufferState.mShared = false;
+            }
+            // Don't put the shared buffer on the free list.
+            if (!mSlots[slot].mBufferState.isShared()) {
+                mCore->mActiveBuffers.erase(slot);
+                mCore->mFreeBuffers.push_back(slot);
+            }
+
+            releasedCount++;
+            BQ_LOGV("releaseBuffers: releasing slot %d", slot);
+        }
+
+        if (releasedCount > 0) {
+            if (mCore->mBufferReleasedCbEnabled) {
+                listener = mCore->mConnectedProducerListener;
+            }
+            // A single broadcast covers every slot released above.
+            mCore->mDequeueCondition.notify_all();
+            VALIDATE_CONSISTENCY();
+        }
+    } // Autolock scope
+
+    // Call back without lock held. One callback per released buffer so
+    // producers that count releases stay balanced with releaseBuffer.
+    if (listener != nullptr) {
+        for (size_t i = 0; i < releasedCount; i++) {
+            listener->onBufferReleased();
+        }
+    }
+
+    return result;
+}
+
 status_t BufferQueueConsumer::connect(
         const sp<IConsumerListener>& consumerListener, bool controlledByApp) {
     ATRACE_CALL();
@@ -107,6 +107,10 @@ BufferQueueCore::BufferQueueCore()
         mDequeueBufferCannotBlock(false),
         mQueueBufferCanDrop(false),
         mLegacyBufferDrop(true),
+        mStuffingRecoveryEnabled(false),
+        mQueueStuffed(false),
+        mLastExpectedPresent(0),
+        mStuffingRecoveryDropCount(0),
         mDefaultBufferFormat(PIXEL_FORMAT_RGBA_8888),
         mDefaultWidth(1),
         mDefaultHeight(1),
@@ -154,6 +158,10 @@ void BufferQueueCore::dumpState(const String8& prefix, String8* outResult) const
                             mDequeueBufferCannotBlock, mAsyncMode);
     outResult->appendFormat("%s  mQueueBufferCanDrop=%d mLegacyBufferDrop=%d\n", prefix.string(),
                             mQueueBufferCanDrop, mLegacyBufferDrop);
+    outResult->appendFormat("%s  mStuffingRecoveryEnabled=%d mQueueStuffed=%d"
+                            " stuffing-drops=%" PRIu64 "\n",
+                            prefix.string(), mStuffingRecoveryEnabled, mQueueStuffed,
+                            mStuffingRecoveryDropCount);
     outResult->appendFormat("%s  default-size=[%dx%d] default-format=%d ", prefix.string(),
                             mDefaultWidth, mDefaultHeight, mDefaultBufferFormat);
     outResult->appendFormat("%s  transform-hint=%02x frame-counter=%" PRIu64 "\n", prefix.string(),
@@ -222,6 +230,10 @@ void BufferQueueCore::dumpState(const String8& prefix, String8* outResult) const
     }
 }
 
+bool BufferQueueCore::isQueueStuffedLocked() const {
+    return mQueue.size() > static_cast<size_t>(mMaxAcquiredBufferCount);
+}
+
 int BufferQueueCore::getMinUndequeuedBufferCountLocked() const {
     // If dequeueBuffer is allowed to error out, we don't have to add an
     // extra buffer.
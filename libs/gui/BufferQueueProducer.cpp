@@ -16,6 +16,8 @@
 
 #include <inttypes.h>
 
+#include <vector>
+
 #define LOG_TAG "BufferQueueProducer"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 //#define LOG_NDEBUG 0
@@ -37,6 +39,8 @@
 #include <gui/IProducerListener.h>
 #include <private/gui/BufferQueueThreadState.h>
 
+#include <ui/GraphicBufferAllocator.h>
+
 #include <utils/Log.h>
 #include <utils/Trace.h>
 
@@ -841,6 +845,9 @@ status_t BufferQueueProducer::queueBuffer(int slot,
 
     sp<IConsumerListener> frameAvailableListener;
     sp<IConsumerListener> frameReplacedListener;
+    sp<IConsumerListener> consumerListener;
+    sp<IProducerListener> stuffedListener;
+    uint64_t stuffedCount = 0;
     int callbackTicket = 0;
     uint64_t currentFrameNumber = 0;
     BufferItem item;
@@ -957,7 +964,28 @@ status_t BufferQueueProducer::queueBuffer(int slot,
             // in the queue to see if we need to replace it
             const BufferItem& last = mCore->mQueue.itemAt(
                     mCore->mQueue.size() - 1);
-            if (last.mIsDroppable) {
+
+            // With stuffing recovery enabled, a frame whose desired present
+            // time is already at or behind the present time the consumer last
+            // targeted may also be replaced once the queue is stuffed:
+            // presenting it would only add latency. Frames with
+            // auto-generated timestamps are left alone, since their
+            // timestamps say nothing about when the producer wants them
+            // shown.
+            const bool dropForStuffing = mCore->mStuffingRecoveryEnabled &&
+                    !mCore->mSharedBufferMode && !last.mIsAutoTimestamp &&
+                    mCore->mLastExpectedPresent != 0 &&
+                    last.mTimestamp <= mCore->mLastExpectedPresent &&
+                    mCore->isQueueStuffedLocked();
+
+            if (last.mIsDroppable || dropForStuffing) {
+                if (dropForStuffing && !last.mIsDroppable) {
+                    ++mCore->mStuffingRecoveryDropCount;
+                    BQ_LOGV("queueBuffer: stuffing recovery dropped frame %" PRIu64
+                            " desire=%" PRId64 " lastExpected=%" PRId64 " size=%zu",
+                            last.mFrameNumber, last.mTimestamp, mCore->mLastExpectedPresent,
+                            mCore->mQueue.size());
+                }
 
                 if (!last.mIsStale) {
                     mSlots[last.mSlot].mBufferState.freeQueued();
@@ -996,9 +1024,12 @@ status_t BufferQueueProducer::queueBuffer(int slot,
         }
 
         mCore->mBufferHasBeenQueued = true;
-        mCore->mDequeueCondition.notify_all();
         mCore->mLastQueuedSlot = slot;
 
+        // Capture the listener for the frame event update below so we don't
+        // have to reacquire the contended core lock after this scope.
+        consumerListener = mCore->mConsumerListener;
+
         output->width = mCore->mDefaultWidth;
         output->height = mCore->mDefaultHeight;
         output->transformHint = mCore->mTransformHintInUse = mCore->mTransformHint;
@@ -1010,12 +1041,35 @@ status_t BufferQueueProducer::queueBuffer(int slot,
 #ifndef NO_BINDER
         mCore->mOccupancyTracker.registerOccupancyChange(mCore->mQueue.size());
 #endif
+        // Producer-visible stuffing signal, edge-triggered on the queue
+        // reaching the latency-optimal depth, so producers that can pace
+        // themselves back off before their frames go stale.
+        if (mCore->isQueueStuffedLocked()) {
+            if (!mCore->mQueueStuffed) {
+                mCore->mQueueStuffed = true;
+                stuffedListener = mCore->mConnectedProducerListener;
+                stuffedCount = mCore->mQueue.size();
+            }
+        } else {
+            mCore->mQueueStuffed = false;
+        }
+
         // Take a ticket for the callback functions
         callbackTicket = mNextCallbackTicket++;
 
         VALIDATE_CONSISTENCY();
     } // Autolock scope
 
+    // Wake any threads blocked in dequeueBuffer after dropping the lock so
+    // they don't immediately contend on it when they run.
+    mCore->mDequeueCondition.notify_all();
+
+    // Notify the producer that the queue is stuffed, without the core lock
+    // held, as required by ProducerListener.
+    if (stuffedListener != nullptr) {
+        stuffedListener->onQueueStuffed(stuffedCount);
+    }
+
     // It is okay not to clear the GraphicBuffer when the consumer is SurfaceFlinger because
     // it is guaranteed that the BufferQueue is inside SurfaceFlinger's process and
     // there will be no Binder call
@@ -1023,7 +1077,9 @@ status_t BufferQueueProducer::queueBuffer(int slot,
         item.mGraphicBuffer.clear();
     }
 
-    // Update and get FrameEventHistory.
+    // Update and get FrameEventHistory. The consumer listener was captured
+    // under the core lock above, so unlike addAndGetFrameTimestamps() this
+    // doesn't need to reacquire it.
     nsecs_t postedTime = systemTime(SYSTEM_TIME_MONOTONIC);
     NewFrameEventsEntry newFrameEventsEntry = {
         currentFrameNumber,
@@ -1031,8 +1087,10 @@ status_t BufferQueueProducer::queueBuffer(int slot,
         requestedPresentTimestamp,
         std::move(acquireFenceTime)
     };
-    addAndGetFrameTimestamps(&newFrameEventsEntry,
-            getFrameTimestamps ? &output->frameTimestamps : nullptr);
+    if (consumerListener != nullptr) {
+        consumerListener->addAndGetFrameTimestamps(&newFrameEventsEntry,
+                getFrameTimestamps ? &output->frameTimestamps : nullptr);
+    }
 
     // Call back without the main BufferQueue lock held, but with the callback
     // lock held so we can ensure that callbacks occur in order
@@ -1417,9 +1475,10 @@ void BufferQueueProducer::allocateBuffers(uint32_t width, uint32_t height,
                 return;
             }
 
-            // Only allocate one buffer at a time to reduce risks of overlapping an allocation from
-            // both allocateBuffers and dequeueBuffer.
-            newBufferCount = mCore->mFreeSlots.empty() ? 0 : 1;
+            // Allocate every free slot with a single batched allocator call. If an
+            // allocation from dequeueBuffer overlaps and occupies slots in the
+            // meantime, the surplus buffers are dropped below.
+            newBufferCount = mCore->mFreeSlots.size();
             if (newBufferCount == 0) {
                 return;
             }
@@ -1438,23 +1497,26 @@ void BufferQueueProducer::allocateBuffers(uint32_t width, uint32_t height,
             mCore->mIsAllocating = true;
         } // Autolock scope
 
+        std::vector<buffer_handle_t> handles(newBufferCount, nullptr);
+        uint32_t allocStride = 0;
+        status_t result = GraphicBufferAllocator::get()
+                .allocateBatch(allocWidth, allocHeight, allocFormat, BQ_LAYER_COUNT, allocUsage,
+                               static_cast<uint32_t>(newBufferCount), handles.data(), &allocStride,
+                               allocName);
+        if (result != NO_ERROR) {
+            BQ_LOGE("allocateBuffers: failed to allocate %zu buffers (%u x %u, format"
+                    " %u, usage %#" PRIx64 ")", newBufferCount, width, height, format, usage);
+            std::lock_guard<std::mutex> lock(mCore->mMutex);
+            mCore->mIsAllocating = false;
+            mCore->mIsAllocatingCondition.notify_all();
+            return;
+        }
+
         Vector<sp<GraphicBuffer>> buffers;
         for (size_t i = 0; i < newBufferCount; ++i) {
-            sp<GraphicBuffer> graphicBuffer = new GraphicBuffer(
-                    allocWidth, allocHeight, allocFormat, BQ_LAYER_COUNT,
-                    allocUsage, allocName);
-
-            status_t result = graphicBuffer->initCheck();
-
-            if (result != NO_ERROR) {
-                BQ_LOGE("allocateBuffers: failed to allocate buffer (%u x %u, format"
-                        " %u, usage %#" PRIx64 ")", width, height, format, usage);
-                std::lock_guard<std::mutex> lock(mCore->mMutex);
-                mCore->mIsAllocating = false;
-                mCore->mIsAllocatingCondition.notify_all();
-                return;
-            }
-            buffers.push_back(graphicBuffer);
+            buffers.push_back(new GraphicBuffer(allocWidth, allocHeight, allocFormat,
+                                                BQ_LAYER_COUNT, allocUsage, allocStride,
+                                                handles[i]));
         }
 
         { // Autolock scope
@@ -1678,4 +1740,14 @@ status_t BufferQueueProducer::setAutoPrerotation(bool autoPrerotation) {
     return NO_ERROR;
 }
 
+status_t BufferQueueProducer::setStuffingRecovery(bool enable) {
+    ATRACE_CALL();
+    BQ_LOGV("setStuffingRecovery: %d", enable);
+
+    std::lock_guard<std::mutex> lock(mCore->mMutex);
+
+    mCore->mStuffingRecoveryEnabled = enable;
+    return NO_ERROR;
+}
+
 } // namespace android
@@ -35,7 +35,11 @@ CpuConsumer::CpuConsumer(const sp<IGraphicBufferConsumer>& bq,
         size_t maxLockedBuffers, bool controlledByApp) :
     ConsumerBase(bq, controlledByApp),
     mMaxLockedBuffers(maxLockedBuffers),
-    mCurrentLockedBuffers(0)
+    mCurrentLockedBuffers(0),
+    mPrefetchEnabled(false),
+    mPrefetchRunning(false),
+    mPrefetchInFlight(false),
+    mPrefetchedValid(false)
 {
     // Create tracking entries for locked buffers
     mAcquiredBuffers.insertAt(0, maxLockedBuffers);
@@ -44,6 +48,112 @@ CpuConsumer::CpuConsumer(const sp<IGraphicBufferConsumer>& bq,
     mConsumer->setMaxAcquiredBufferCount(static_cast<int32_t>(maxLockedBuffers));
 }
 
+CpuConsumer::~CpuConsumer() {
+    {
+        Mutex::Autolock _l(mMutex);
+        mPrefetchRunning = false;
+        mPrefetchCondition.broadcast();
+    }
+    if (mPrefetchThread.joinable()) {
+        mPrefetchThread.join();
+    }
+    // The consumer is not yet abandoned here, so a leftover prefetched buffer
+    // can still be unmapped and returned to the queue properly
+    Mutex::Autolock _l(mMutex);
+    if (mPrefetchedValid) {
+        releasePrefetchedBufferLocked();
+    }
+}
+
+void CpuConsumer::setPrefetchEnabled(bool enabled) {
+    Mutex::Autolock _l(mMutex);
+    if (enabled == mPrefetchEnabled) {
+        return;
+    }
+    mPrefetchEnabled = enabled;
+    if (enabled && !mPrefetchThread.joinable()) {
+        mPrefetchRunning = true;
+        mPrefetchThread = std::thread(&CpuConsumer::prefetchThreadLoop, this);
+    }
+    if (!enabled && mPrefetchedValid) {
+        // nobody will pick this buffer up through lockNextBuffer anymore
+        releasePrefetchedBufferLocked();
+    }
+    mPrefetchCondition.broadcast();
+}
+
+void CpuConsumer::onFrameAvailable(const BufferItem& item) {
+    {
+        Mutex::Autolock _l(mMutex);
+        if (mPrefetchEnabled) {
+            mPrefetchCondition.broadcast();
+        }
+    }
+    ConsumerBase::onFrameAvailable(item);
+}
+
+void CpuConsumer::prefetchThreadLoop() {
+    mMutex.lock();
+    while (mPrefetchRunning) {
+        // Prefetch at most one buffer ahead, and don't consume acquire slots
+        // that lockNextBuffer would refuse anyway
+        if (!mPrefetchEnabled || mPrefetchedValid ||
+                mCurrentLockedBuffers == mMaxLockedBuffers) {
+            mPrefetchCondition.wait(mMutex);
+            continue;
+        }
+
+        BufferItem b;
+        status_t err = acquireBufferLocked(&b, 0);
+        if (err != OK) {
+            // No frame is pending; wait for the next onFrameAvailable. Other
+            // errors (e.g. an abandoned queue) also just put us to sleep.
+            mPrefetchCondition.wait(mMutex);
+            continue;
+        }
+
+        if (b.mGraphicBuffer == nullptr) {
+            b.mGraphicBuffer = mSlots[b.mSlot].mGraphicBuffer;
+        }
+
+        // Do the fence wait and mapping with mMutex dropped so consumers
+        // aren't blocked behind gralloc
+        mPrefetchInFlight = true;
+        LockedBuffer lockedBuffer;
+        mMutex.unlock();
+        err = lockBufferItem(b, &lockedBuffer);
+        mMutex.lock();
+        mPrefetchInFlight = false;
+
+        if (err != OK) {
+            CC_LOGE("prefetch: Unable to lock buffer: %s (%d)",
+                    strerror(-err), err);
+            releaseBufferLocked(b.mSlot, b.mGraphicBuffer);
+        } else {
+            mPrefetchedItem = b;
+            mPrefetchedBuffer = lockedBuffer;
+            mPrefetchedValid = true;
+        }
+        mPrefetchCondition.broadcast();
+    }
+    mMutex.unlock();
+}
+
+void CpuConsumer::releasePrefetchedBufferLocked() {
+    int fenceFd = -1;
+    status_t err = mPrefetchedItem.mGraphicBuffer->unlockAsync(&fenceFd);
+    if (err == OK) {
+        sp<Fence> fence(fenceFd >= 0 ? new Fence(fenceFd) : Fence::NO_FENCE);
+        addReleaseFenceLocked(mPrefetchedItem.mSlot,
+                mPrefetchedItem.mGraphicBuffer, fence);
+    } else {
+        CC_LOGE("%s: Unable to unlock prefetched graphic buffer", __FUNCTION__);
+    }
+    releaseBufferLocked(mPrefetchedItem.mSlot, mPrefetchedItem.mGraphicBuffer);
+    mPrefetchedItem = BufferItem();
+    mPrefetchedValid = false;
+}
+
 size_t CpuConsumer::findAcquiredBufferLocked(uintptr_t id) const {
     for (size_t i = 0; i < mMaxLockedBuffers; i++) {
         const auto& ab = mAcquiredBuffers[i];
@@ -161,6 +271,36 @@ status_t CpuConsumer::lockNextBuffer(LockedBuffer *nativeBuffer) {
         return NOT_ENOUGH_DATA;
     }
 
+    if (mPrefetchEnabled) {
+        // If the prefetch thread is mid-lock on the next frame, wait for it
+        // instead of racing it for the same frame; this blocks for at most
+        // the gralloc lock that would otherwise run on this thread.
+        while (!mPrefetchedValid && mPrefetchInFlight) {
+            mPrefetchCondition.wait(mMutex);
+        }
+        if (mPrefetchedValid) {
+            *nativeBuffer = mPrefetchedBuffer;
+
+            size_t lockedIdx = findAcquiredBufferLocked(AcquiredBuffer::kUnusedId);
+            ALOG_ASSERT(lockedIdx < mMaxLockedBuffers);
+            AcquiredBuffer& ab = mAcquiredBuffers.editItemAt(lockedIdx);
+
+            ab.mSlot = mPrefetchedItem.mSlot;
+            ab.mGraphicBuffer = mPrefetchedItem.mGraphicBuffer;
+            ab.mLockedBufferId = getLockedBufferId(*nativeBuffer);
+
+            mPrefetchedItem = BufferItem();
+            mPrefetchedValid = false;
+            mCurrentLockedBuffers++;
+
+            // let the prefetch thread start on the next frame
+            mPrefetchCondition.broadcast();
+            return OK;
+        }
+        // Nothing prefetched (e.g. the thread hasn't run yet); fall through
+        // to the synchronous path.
+    }
+
     BufferItem b;
     err = acquireBufferLocked(&b, 0);
     if (err != OK) {
@@ -223,6 +363,11 @@ status_t CpuConsumer::unlockBuffer(const LockedBuffer &nativeBuffer) {
     ab.reset();
 
     mCurrentLockedBuffers--;
+    if (mPrefetchEnabled) {
+        // a locked-buffer slot just freed up; the prefetch thread may have
+        // been waiting for one
+        mPrefetchCondition.broadcast();
+    }
 
     return OK;
 }
@@ -97,6 +97,10 @@ int DisplayEventDispatcher::getFd() const {
     return mReceiver.getFd();
 }
 
+nsecs_t DisplayEventDispatcher::getVsyncBudgetRemaining() const {
+    return mLastVsyncDeadline - systemTime(SYSTEM_TIME_MONOTONIC);
+}
+
 int DisplayEventDispatcher::handleEvent(int, int events, void*) {
     if (events & (Looper::EVENT_ERROR | Looper::EVENT_HANGUP)) {
         ALOGE("Display event receiver pipe was closed or an error occurred.  "
@@ -145,6 +149,8 @@ bool DisplayEventDispatcher::processPendingEvents(nsecs_t* outTimestamp,
                     *outTimestamp = ev.header.timestamp;
                     *outDisplayId = ev.header.displayId;
                     *outCount = ev.vsync.count;
+                    mLastVsyncExpectedPresentTime = ev.vsync.expectedVSyncTimestamp;
+                    mLastVsyncDeadline = ev.vsync.deadlineTimestamp;
                     break;
                 case DisplayEventReceiver::DISPLAY_EVENT_HOTPLUG:
                     dispatchHotplug(ev.header.timestamp, ev.header.displayId, ev.hotplug.connected);
@@ -494,6 +494,98 @@ void ConsumerFrameEventHistory::getAndResetDelta(
 }
 
 
+// ============================================================================
+// Varint encoding
+// ============================================================================
+
+namespace {
+
+// Maximum encoded size of a 64-bit LEB128 varint.
+constexpr size_t kMaxVarintSize = 10;
+
+size_t getVarintSize(uint64_t value) {
+    size_t bytes = 1;
+    while (value >>= 7) {
+        bytes++;
+    }
+    return bytes;
+}
+
+status_t writeVarint(void*& buffer, size_t& size, uint64_t value) {
+    uint8_t* byteBuffer = static_cast<uint8_t*>(buffer);
+    do {
+        if (size == 0) {
+            return NO_MEMORY;
+        }
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        *byteBuffer++ = byte | (value != 0 ? 0x80 : 0);
+        size--;
+    } while (value != 0);
+    buffer = byteBuffer;
+    return NO_ERROR;
+}
+
+status_t readVarint(void const*& buffer, size_t& size, uint64_t* outValue) {
+    uint8_t const* byteBuffer = static_cast<uint8_t const*>(buffer);
+    uint64_t value = 0;
+    for (unsigned int shift = 0; shift < 7 * kMaxVarintSize; shift += 7) {
+        if (size == 0) {
+            return NO_MEMORY;
+        }
+        uint8_t byte = *byteBuffer++;
+        size--;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            buffer = byteBuffer;
+            *outValue = value;
+            return NO_ERROR;
+        }
+    }
+    // More continuation bits than a 64-bit value can produce.
+    return BAD_VALUE;
+}
+
+uint64_t zigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^
+            static_cast<uint64_t>(value >> 63);
+}
+
+int64_t zigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Timestamps are encoded as varints of their zigzagged delta from a base
+// timestamp taken from the same frame, so nearby events cost one or two
+// bytes instead of eight. TIMESTAMP_PENDING would produce a huge delta from
+// any base, so it gets the dedicated encoded value 0 and valid timestamps
+// are offset by one. The +1 cannot wrap in practice since that would require
+// a delta of about +/-292 years.
+uint64_t encodeTimestamp(nsecs_t time, nsecs_t base) {
+    return FrameEvents::isValidTimestamp(time) ?
+            zigzagEncode(time - base) + 1 : 0;
+}
+
+status_t writeTimestamp(void*& buffer, size_t& size, nsecs_t time,
+        nsecs_t base) {
+    return writeVarint(buffer, size, encodeTimestamp(time, base));
+}
+
+status_t readTimestamp(void const*& buffer, size_t& size, nsecs_t* outTime,
+        nsecs_t base) {
+    uint64_t encoded = 0;
+    status_t status = readVarint(buffer, size, &encoded);
+    if (status != NO_ERROR) {
+        return status;
+    }
+    *outTime = encoded == 0 ?
+            FrameEvents::TIMESTAMP_PENDING : base + zigzagDecode(encoded - 1);
+    return NO_ERROR;
+}
+
+} // namespace
+
+
 // ============================================================================
 // FrameEventsDelta
 // ============================================================================
@@ -526,22 +618,27 @@ FrameEventsDelta::FrameEventsDelta(
 }
 
 constexpr size_t FrameEventsDelta::minFlattenedSize() {
-    return sizeof(FrameEventsDelta::mFrameNumber) +
+    return 1 + // mFrameNumber as its smallest varint
             sizeof(uint16_t) + // mIndex
             sizeof(uint8_t) + // mAddPostCompositeCalled
             sizeof(uint8_t) + // mAddReleaseCalled
             sizeof(FrameEventsDelta::mPostedTime) +
-            sizeof(FrameEventsDelta::mRequestedPresentTime) +
-            sizeof(FrameEventsDelta::mLatchTime) +
-            sizeof(FrameEventsDelta::mFirstRefreshStartTime) +
-            sizeof(FrameEventsDelta::mLastRefreshStartTime) +
-            sizeof(FrameEventsDelta::mDequeueReadyTime);
+            5; // the remaining timestamps as their smallest varints
 }
 
 // Flattenable implementation
 size_t FrameEventsDelta::getFlattenedSize() const {
     auto fences = allFences(this);
-    return minFlattenedSize() +
+    return getVarintSize(mFrameNumber) +
+            sizeof(uint16_t) + // mIndex
+            sizeof(uint8_t) + // mAddPostCompositeCalled
+            sizeof(uint8_t) + // mAddReleaseCalled
+            sizeof(mPostedTime) +
+            getVarintSize(encodeTimestamp(mRequestedPresentTime, mPostedTime)) +
+            getVarintSize(encodeTimestamp(mLatchTime, mPostedTime)) +
+            getVarintSize(encodeTimestamp(mFirstRefreshStartTime, mPostedTime)) +
+            getVarintSize(encodeTimestamp(mLastRefreshStartTime, mPostedTime)) +
+            getVarintSize(encodeTimestamp(mDequeueReadyTime, mPostedTime)) +
             std::accumulate(fences.begin(), fences.end(), size_t(0),
                     [](size_t a, const FenceTime::Snapshot* fence) {
                             return a + fence->getFlattenedSize();
@@ -567,7 +664,10 @@ status_t FrameEventsDelta::flatten(void*& buffer, size_t& size, int*& fds,
         return BAD_VALUE;
     }
 
-    FlattenableUtils::write(buffer, size, mFrameNumber);
+    status_t status = writeVarint(buffer, size, mFrameNumber);
+    if (status != NO_ERROR) {
+        return status;
+    }
 
     // These are static_cast to uint16_t/uint8_t for alignment.
     FlattenableUtils::write(buffer, size, static_cast<uint16_t>(mIndex));
@@ -576,12 +676,17 @@ status_t FrameEventsDelta::flatten(void*& buffer, size_t& size, int*& fds,
     FlattenableUtils::write(
             buffer, size, static_cast<uint8_t>(mAddReleaseCalled));
 
+    // The posted time is written in full and used as the base the other
+    // timestamps are delta-encoded against.
     FlattenableUtils::write(buffer, size, mPostedTime);
-    FlattenableUtils::write(buffer, size, mRequestedPresentTime);
-    FlattenableUtils::write(buffer, size, mLatchTime);
-    FlattenableUtils::write(buffer, size, mFirstRefreshStartTime);
-    FlattenableUtils::write(buffer, size, mLastRefreshStartTime);
-    FlattenableUtils::write(buffer, size, mDequeueReadyTime);
+    for (auto time : {mRequestedPresentTime, mLatchTime,
+            mFirstRefreshStartTime, mLastRefreshStartTime,
+            mDequeueReadyTime}) {
+        status = writeTimestamp(buffer, size, time, mPostedTime);
+        if (status != NO_ERROR) {
+            return status;
+        }
+    }
 
     // Fences
     for (auto fence : allFences(this)) {
@@ -599,7 +704,16 @@ status_t FrameEventsDelta::unflatten(void const*& buffer, size_t& size,
         return NO_MEMORY;
     }
 
-    FlattenableUtils::read(buffer, size, mFrameNumber);
+    status_t status = readVarint(buffer, size, &mFrameNumber);
+    if (status != NO_ERROR) {
+        return status;
+    }
+
+    // The frame number varint has a variable size, so check the fixed-size
+    // fields that follow it explicitly.
+    if (size < sizeof(uint16_t) + 2 * sizeof(uint8_t) + sizeof(mPostedTime)) {
+        return NO_MEMORY;
+    }
 
     // These were written as uint16_t/uint8_t for alignment.
     uint16_t temp16 = 0;
@@ -615,11 +729,14 @@ status_t FrameEventsDelta::unflatten(void const*& buffer, size_t& size,
     mAddReleaseCalled = static_cast<bool>(temp8);
 
     FlattenableUtils::read(buffer, size, mPostedTime);
-    FlattenableUtils::read(buffer, size, mRequestedPresentTime);
-    FlattenableUtils::read(buffer, size, mLatchTime);
-    FlattenableUtils::read(buffer, size, mFirstRefreshStartTime);
-    FlattenableUtils::read(buffer, size, mLastRefreshStartTime);
-    FlattenableUtils::read(buffer, size, mDequeueReadyTime);
+    for (auto time : {&mRequestedPresentTime, &mLatchTime,
+            &mFirstRefreshStartTime, &mLastRefreshStartTime,
+            &mDequeueReadyTime}) {
+        status = readTimestamp(buffer, size, time, mPostedTime);
+        if (status != NO_ERROR) {
+            return status;
+        }
+    }
 
     // Fences
     for (auto fence : allFences(this)) {
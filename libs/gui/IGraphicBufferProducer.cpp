@@ -24,6 +24,8 @@
 #include <utils/Timers.h>
 #include <utils/Vector.h>
 
+#include <atomic>
+
 #include <binder/Parcel.h>
 #include <binder/IInterface.h>
 
@@ -74,6 +76,9 @@ enum {
     GET_CONSUMER_USAGE,
     SET_LEGACY_BUFFER_DROP,
     SET_AUTO_PREROTATION,
+    DEQUEUE_WITH_BUFFER,
+    SET_STUFFING_RECOVERY,
+    APPLY_PENDING_ATTRIBUTES,
 };
 
 class BpGraphicBufferProducer : public BpInterface<IGraphicBufferProducer>
@@ -183,6 +188,85 @@ public:
         return result;
     }
 
+    virtual status_t dequeueWithBuffer(int* buf, sp<Fence>* fence, uint32_t width, uint32_t height,
+                                       PixelFormat format, uint64_t usage,
+                                       sp<GraphicBuffer>* outBuffer, uint64_t* outBufferAge,
+                                       FrameEventHistoryDelta* outTimestamps) override {
+        if (outBuffer == nullptr) {
+            return BAD_VALUE;
+        }
+        if (mDequeueWithBufferUnsupported.load(std::memory_order_relaxed)) {
+            return IGraphicBufferProducer::dequeueWithBuffer(buf, fence, width, height, format,
+                                                             usage, outBuffer, outBufferAge,
+                                                             outTimestamps);
+        }
+
+        Parcel data, reply;
+        bool getFrameTimestamps = (outTimestamps != nullptr);
+
+        data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
+        data.writeUint32(width);
+        data.writeUint32(height);
+        data.writeInt32(static_cast<int32_t>(format));
+        data.writeUint64(usage);
+        data.writeBool(getFrameTimestamps);
+
+        status_t result = remote()->transact(DEQUEUE_WITH_BUFFER, data, &reply);
+        if (result == UNKNOWN_TRANSACTION) {
+            // The remote predates the combined call; remember that and fall
+            // back to the separate transactions from now on.
+            mDequeueWithBufferUnsupported.store(true, std::memory_order_relaxed);
+            return IGraphicBufferProducer::dequeueWithBuffer(buf, fence, width, height, format,
+                                                             usage, outBuffer, outBufferAge,
+                                                             outTimestamps);
+        }
+        if (result != NO_ERROR) {
+            return result;
+        }
+
+        *buf = reply.readInt32();
+        *fence = new Fence();
+        result = reply.read(**fence);
+        if (result != NO_ERROR) {
+            fence->clear();
+            return result;
+        }
+        if (outBufferAge) {
+            result = reply.readUint64(outBufferAge);
+        } else {
+            // Read the value even if outBufferAge is nullptr:
+            uint64_t bufferAge;
+            result = reply.readUint64(&bufferAge);
+        }
+        if (result != NO_ERROR) {
+            ALOGE("IGBP::dequeueWithBuffer failed to read buffer age: %d", result);
+            return result;
+        }
+        if (getFrameTimestamps) {
+            result = reply.read(*outTimestamps);
+            if (result != NO_ERROR) {
+                ALOGE("IGBP::dequeueWithBuffer failed to read timestamps: %d", result);
+                return result;
+            }
+        }
+        outBuffer->clear();
+        bool hasBuffer = false;
+        result = reply.readBool(&hasBuffer);
+        if (result != NO_ERROR) {
+            return result;
+        }
+        if (hasBuffer) {
+            *outBuffer = new GraphicBuffer();
+            result = reply.read(**outBuffer);
+            if (result != NO_ERROR) {
+                outBuffer->clear();
+                return result;
+            }
+        }
+        result = reply.readInt32();
+        return result;
+    }
+
     virtual status_t detachBuffer(int slot) {
         Parcel data, reply;
         data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
@@ -559,6 +643,58 @@ public:
         }
         return result;
     }
+
+    virtual status_t setStuffingRecovery(bool enable) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
+        data.writeBool(enable);
+        status_t result = remote()->transact(SET_STUFFING_RECOVERY, data, &reply);
+        if (result == NO_ERROR) {
+            result = reply.readInt32();
+        }
+        return result;
+    }
+
+    virtual status_t applyPendingAttributes(const PendingAttributes& attributes) override {
+        if (mApplyPendingAttributesUnsupported.load(std::memory_order_relaxed)) {
+            return IGraphicBufferProducer::applyPendingAttributes(attributes);
+        }
+
+        Parcel data, reply;
+        data.writeInterfaceToken(IGraphicBufferProducer::getInterfaceDescriptor());
+        data.writeBool(attributes.hasMaxDequeuedBufferCount);
+        data.writeInt32(attributes.maxDequeuedBufferCount);
+        data.writeBool(attributes.hasAsyncMode);
+        data.writeBool(attributes.asyncMode);
+        data.writeBool(attributes.hasSharedBufferMode);
+        data.writeBool(attributes.sharedBufferMode);
+        data.writeBool(attributes.hasAutoRefresh);
+        data.writeBool(attributes.autoRefresh);
+        data.writeBool(attributes.hasAutoPrerotation);
+        data.writeBool(attributes.autoPrerotation);
+        data.writeBool(attributes.hasDequeueTimeout);
+        data.writeInt64(attributes.dequeueTimeout);
+
+        status_t result = remote()->transact(APPLY_PENDING_ATTRIBUTES, data, &reply);
+        if (result == UNKNOWN_TRANSACTION) {
+            // The remote predates the batched call; remember that and fall
+            // back to the individual transactions from now on.
+            mApplyPendingAttributesUnsupported.store(true, std::memory_order_relaxed);
+            return IGraphicBufferProducer::applyPendingAttributes(attributes);
+        }
+        if (result == NO_ERROR) {
+            result = reply.readInt32();
+        }
+        return result;
+    }
+
+private:
+    // Set once the remote has rejected DEQUEUE_WITH_BUFFER, so later frames
+    // skip straight to the separate-transaction fallback.
+    std::atomic<bool> mDequeueWithBufferUnsupported{false};
+
+    // Same, for APPLY_PENDING_ATTRIBUTES.
+    std::atomic<bool> mApplyPendingAttributesUnsupported{false};
 };
 
 // Out-of-line virtual method definition to trigger vtable emission in this
@@ -698,6 +834,30 @@ IMPLEMENT_HYBRID_META_INTERFACE(GraphicBufferProducer,
 
 // ----------------------------------------------------------------------
 
+status_t IGraphicBufferProducer::dequeueWithBuffer(int* slot, sp<Fence>* fence, uint32_t w,
+                                                   uint32_t h, PixelFormat format, uint64_t usage,
+                                                   sp<GraphicBuffer>* outBuffer,
+                                                   uint64_t* outBufferAge,
+                                                   FrameEventHistoryDelta* outTimestamps) {
+    if (outBuffer == nullptr) {
+        return BAD_VALUE;
+    }
+    outBuffer->clear();
+    status_t result = dequeueBuffer(slot, fence, w, h, format, usage, outBufferAge, outTimestamps);
+    if (result < 0) {
+        return result;
+    }
+    if (result & BUFFER_NEEDS_REALLOCATION) {
+        status_t requestResult = requestBuffer(*slot, outBuffer);
+        if (requestResult != NO_ERROR) {
+            ALOGE("dequeueWithBuffer: requestBuffer failed: %d", requestResult);
+            cancelBuffer(*slot, *fence);
+            return requestResult;
+        }
+    }
+    return result;
+}
+
 status_t IGraphicBufferProducer::setLegacyBufferDrop(bool drop) {
     // No-op for IGBP other than BufferQueue.
     (void) drop;
@@ -710,6 +870,50 @@ status_t IGraphicBufferProducer::setAutoPrerotation(bool autoPrerotation) {
     return INVALID_OPERATION;
 }
 
+status_t IGraphicBufferProducer::setStuffingRecovery(bool enable) {
+    // No-op for IGBP other than BufferQueue.
+    (void)enable;
+    return INVALID_OPERATION;
+}
+
+status_t IGraphicBufferProducer::applyPendingAttributes(const PendingAttributes& attributes) {
+    status_t result = NO_ERROR;
+    if (attributes.hasMaxDequeuedBufferCount) {
+        result = setMaxDequeuedBufferCount(attributes.maxDequeuedBufferCount);
+        if (result != NO_ERROR) {
+            return result;
+        }
+    }
+    if (attributes.hasAsyncMode) {
+        result = setAsyncMode(attributes.asyncMode);
+        if (result != NO_ERROR) {
+            return result;
+        }
+    }
+    if (attributes.hasSharedBufferMode) {
+        result = setSharedBufferMode(attributes.sharedBufferMode);
+        if (result != NO_ERROR) {
+            return result;
+        }
+    }
+    if (attributes.hasAutoRefresh) {
+        result = setAutoRefresh(attributes.autoRefresh);
+        if (result != NO_ERROR) {
+            return result;
+        }
+    }
+    if (attributes.hasAutoPrerotation) {
+        result = setAutoPrerotation(attributes.autoPrerotation);
+        if (result != NO_ERROR) {
+            return result;
+        }
+    }
+    if (attributes.hasDequeueTimeout) {
+        result = setDequeueTimeout(attributes.dequeueTimeout);
+    }
+    return result;
+}
+
 status_t IGraphicBufferProducer::exportToParcel(Parcel* parcel) {
     status_t res = OK;
     res = parcel->writeUint32(USE_BUFFER_QUEUE);
@@ -841,6 +1045,39 @@ status_t BnGraphicBufferProducer::onTransact(
             reply->writeInt32(result);
             return NO_ERROR;
         }
+        case DEQUEUE_WITH_BUFFER: {
+            CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
+            uint32_t width = data.readUint32();
+            uint32_t height = data.readUint32();
+            PixelFormat format = static_cast<PixelFormat>(data.readInt32());
+            uint64_t usage = data.readUint64();
+            bool getTimestamps = data.readBool();
+
+            int buf = 0;
+            sp<Fence> fence = Fence::NO_FENCE;
+            uint64_t bufferAge = 0;
+            sp<GraphicBuffer> buffer;
+            FrameEventHistoryDelta frameTimestamps;
+            int result = dequeueWithBuffer(&buf, &fence, width, height, format, usage, &buffer,
+                                           &bufferAge, getTimestamps ? &frameTimestamps : nullptr);
+
+            if (fence == nullptr) {
+                ALOGE("dequeueWithBuffer returned a NULL fence, setting to Fence::NO_FENCE");
+                fence = Fence::NO_FENCE;
+            }
+            reply->writeInt32(buf);
+            reply->write(*fence);
+            reply->writeUint64(bufferAge);
+            if (getTimestamps) {
+                reply->write(frameTimestamps);
+            }
+            reply->writeBool(buffer != nullptr);
+            if (buffer != nullptr) {
+                reply->write(*buffer);
+            }
+            reply->writeInt32(result);
+            return NO_ERROR;
+        }
         case DETACH_BUFFER: {
             CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
             int slot = data.readInt32();
@@ -1079,6 +1316,34 @@ status_t BnGraphicBufferProducer::onTransact(
             reply->writeInt32(result);
             return NO_ERROR;
         }
+        case SET_STUFFING_RECOVERY: {
+            CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
+            bool enable = data.readBool();
+            status_t result = setStuffingRecovery(enable);
+            reply->writeInt32(result);
+            return NO_ERROR;
+        }
+        case APPLY_PENDING_ATTRIBUTES: {
+            CHECK_INTERFACE(IGraphicBufferProducer, data, reply);
+            PendingAttributes attributes;
+            attributes.hasMaxDequeuedBufferCount = data.readBool();
+            attributes.maxDequeuedBufferCount = data.readInt32();
+            attributes.hasAsyncMode = data.readBool();
+            attributes.asyncMode = data.readBool();
+            attributes.hasSharedBufferMode = data.readBool();
+            attributes.sharedBufferMode = data.readBool();
+            attributes.hasAutoRefresh = data.readBool();
+            attributes.autoRefresh = data.readBool();
+            attributes.hasAutoPrerotation = data.readBool();
+            attributes.autoPrerotation = data.readBool();
+            attributes.hasDequeueTimeout = data.readBool();
+            attributes.dequeueTimeout = data.readInt64();
+            // The base implementation fans out to the individual setters,
+            // which run in-process here.
+            status_t result = applyPendingAttributes(attributes);
+            reply->writeInt32(result);
+            return NO_ERROR;
+        }
     }
     return BBinder::onTransact(code, data, reply, flags);
 }
@@ -25,6 +25,7 @@ enum {
     ON_BUFFER_RELEASED = IBinder::FIRST_CALL_TRANSACTION,
     NEEDS_RELEASE_NOTIFY,
     ON_BUFFERS_DISCARDED,
+    ON_QUEUE_STUFFED,
 };
 
 class BpProducerListener : public BpInterface<IProducerListener>
@@ -64,6 +65,13 @@ public:
         data.writeInt32Vector(discardedSlots);
         remote()->transact(ON_BUFFERS_DISCARDED, data, &reply, IBinder::FLAG_ONEWAY);
     }
+
+    virtual void onQueueStuffed(uint64_t queuedCount) {
+        Parcel data, reply;
+        data.writeInterfaceToken(IProducerListener::getInterfaceDescriptor());
+        data.writeUint64(queuedCount);
+        remote()->transact(ON_QUEUE_STUFFED, data, &reply, IBinder::FLAG_ONEWAY);
+    }
 };
 
 // Out-of-line virtual method definition to trigger vtable emission in this
@@ -115,6 +123,17 @@ status_t BnProducerListener::onTransact(uint32_t code, const Parcel& data,
             onBuffersDiscarded(discardedSlots);
             return NO_ERROR;
         }
+        case ON_QUEUE_STUFFED: {
+            CHECK_INTERFACE(IProducerListener, data, reply);
+            uint64_t queuedCount;
+            status_t result = data.readUint64(&queuedCount);
+            if (result != NO_ERROR) {
+                ALOGE("ON_QUEUE_STUFFED failed to read queuedCount: %d", result);
+                return result;
+            }
+            onQueueStuffed(queuedCount);
+            return NO_ERROR;
+        }
     }
     return BBinder::onTransact(code, data, reply, flags);
 }
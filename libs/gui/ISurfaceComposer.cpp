@@ -20,6 +20,7 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <binder/IMemory.h>
 #include <binder/Parcel.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
@@ -34,10 +35,12 @@
 
 #include <system/graphics.h>
 
+#include <ui/CompositionStats.h>
 #include <ui/DisplayConfig.h>
 #include <ui/DisplayInfo.h>
 #include <ui/DisplayStatInfo.h>
 #include <ui/DisplayState.h>
+#include <ui/Fence.h>
 #include <ui/HdrCapabilities.h>
 
 #include <utils/Log.h>
@@ -76,6 +79,15 @@ public:
         Parcel data, reply;
         data.writeInterfaceToken(ISurfaceComposer::getInterfaceDescriptor());
 
+        // Reserve the whole transaction's worth of capacity up front so the
+        // Parcel grows (and copies its contents) at most once instead of once
+        // per doubling while the per-layer states are appended.
+        size_t capacity = 256 + displays.size() * sizeof(DisplayState);
+        for (const auto& s : state) {
+            capacity += s.state.getApproximateSize();
+        }
+        data.setDataCapacity(capacity);
+
         data.writeUint32(static_cast<uint32_t>(state.size()));
         for (const auto& s : state) {
             s.write(data);
@@ -145,6 +157,44 @@ public:
         return result;
     }
 
+    virtual status_t captureScreenAsync(const sp<IBinder>& display, sp<GraphicBuffer>* outBuffer,
+                                        sp<Fence>* outFence, bool& outCapturedSecureLayers,
+                                        ui::Dataspace reqDataspace, ui::PixelFormat reqPixelFormat,
+                                        const Rect& sourceCrop, uint32_t reqWidth,
+                                        uint32_t reqHeight, bool useIdentityTransform,
+                                        ui::Rotation rotation, bool captureSecureLayers) {
+        Parcel data, reply;
+        data.writeInterfaceToken(ISurfaceComposer::getInterfaceDescriptor());
+        data.writeStrongBinder(display);
+        data.writeInt32(static_cast<int32_t>(reqDataspace));
+        data.writeInt32(static_cast<int32_t>(reqPixelFormat));
+        data.write(sourceCrop);
+        data.writeUint32(reqWidth);
+        data.writeUint32(reqHeight);
+        data.writeInt32(static_cast<int32_t>(useIdentityTransform));
+        data.writeInt32(static_cast<int32_t>(rotation));
+        data.writeInt32(static_cast<int32_t>(captureSecureLayers));
+        status_t result =
+                remote()->transact(BnSurfaceComposer::CAPTURE_SCREEN_ASYNC, data, &reply);
+        if (result != NO_ERROR) {
+            ALOGE("captureScreenAsync failed to transact: %d", result);
+            return result;
+        }
+        result = reply.readInt32();
+        if (result != NO_ERROR) {
+            ALOGE("captureScreenAsync failed to readInt32: %d", result);
+            return result;
+        }
+
+        *outBuffer = new GraphicBuffer();
+        reply.read(**outBuffer);
+        *outFence = new Fence();
+        reply.read(**outFence);
+        outCapturedSecureLayers = reply.readBool();
+
+        return result;
+    }
+
     virtual status_t captureScreen(uint64_t displayOrLayerStack, ui::Dataspace* outDataspace,
                                    sp<GraphicBuffer>* outBuffer) {
         Parcel data, reply;
@@ -395,6 +445,17 @@ public:
         return result;
     }
 
+    virtual status_t getDisplayConfigTable(sp<IMemoryHeap>* outHeap) {
+        Parcel data, reply;
+        data.writeInterfaceToken(ISurfaceComposer::getInterfaceDescriptor());
+        remote()->transact(BnSurfaceComposer::GET_DISPLAY_CONFIG_TABLE, data, &reply);
+        const status_t result = reply.readInt32();
+        if (result == NO_ERROR) {
+            *outHeap = interface_cast<IMemoryHeap>(reply.readStrongBinder());
+        }
+        return result;
+    }
+
     virtual status_t getDisplayStats(const sp<IBinder>& display,
             DisplayStatInfo* stats)
     {
@@ -411,6 +472,20 @@ public:
         return result;
     }
 
+    virtual status_t getCompositionStats(CompositionStats* outStats)
+    {
+        Parcel data, reply;
+        data.writeInterfaceToken(ISurfaceComposer::getInterfaceDescriptor());
+        remote()->transact(BnSurfaceComposer::GET_COMPOSITION_STATS, data, &reply);
+        status_t result = reply.readInt32();
+        if (result == NO_ERROR) {
+            memcpy(outStats,
+                    reply.readInplace(sizeof(CompositionStats)),
+                    sizeof(CompositionStats));
+        }
+        return result;
+    }
+
     virtual int getActiveConfig(const sp<IBinder>& display)
     {
         Parcel data, reply;
@@ -1213,6 +1288,65 @@ public:
 
         return NO_ERROR;
     }
+
+    virtual status_t setThermalRefreshRateHeadroom(float headroom) {
+        Parcel data, reply;
+        status_t error = data.writeInterfaceToken(ISurfaceComposer::getInterfaceDescriptor());
+        if (error != NO_ERROR) {
+            ALOGE("setThermalRefreshRateHeadroom: failed to write interface token: %d", error);
+            return error;
+        }
+        error = data.writeFloat(headroom);
+        if (error != NO_ERROR) {
+            ALOGE("setThermalRefreshRateHeadroom: failed to write headroom: %d", error);
+            return error;
+        }
+        error = remote()->transact(BnSurfaceComposer::SET_THERMAL_REFRESH_RATE_HEADROOM, data,
+                                   &reply, IBinder::FLAG_ONEWAY);
+        if (error != NO_ERROR) {
+            ALOGE("setThermalRefreshRateHeadroom: failed to transact: %d", error);
+            return error;
+        }
+        return NO_ERROR;
+    }
+
+    virtual status_t getDisplayedContentSampleStream(const sp<IBinder>& display,
+                                                     base::unique_fd* outFd) {
+        if (!outFd) return BAD_VALUE;
+
+        Parcel data, reply;
+        status_t error = data.writeInterfaceToken(ISurfaceComposer::getInterfaceDescriptor());
+        if (error != NO_ERROR) {
+            ALOGE("getDisplayedContentSampleStream: failed to write interface token: %d", error);
+            return error;
+        }
+        error = data.writeStrongBinder(display);
+        if (error != NO_ERROR) {
+            ALOGE("getDisplayedContentSampleStream: failed to write display: %d", error);
+            return error;
+        }
+        error = remote()->transact(BnSurfaceComposer::GET_DISPLAYED_CONTENT_SAMPLE_STREAM, data,
+                                   &reply);
+        if (error != NO_ERROR) {
+            ALOGE("getDisplayedContentSampleStream: failed to transact: %d", error);
+            return error;
+        }
+        int32_t result = 0;
+        error = reply.readInt32(&result);
+        if (error != NO_ERROR) {
+            ALOGE("getDisplayedContentSampleStream: failed to read result: %d", error);
+            return error;
+        }
+        if (result != NO_ERROR) {
+            return result;
+        }
+        error = reply.readUniqueFileDescriptor(outFd);
+        if (error != NO_ERROR) {
+            ALOGE("getDisplayedContentSampleStream: failed to read fd: %d", error);
+            return error;
+        }
+        return NO_ERROR;
+    }
 };
 
 // Out-of-line virtual method definition to trigger vtable emission in this
@@ -1322,6 +1456,35 @@ status_t BnSurfaceComposer::onTransact(
             }
             return NO_ERROR;
         }
+        case CAPTURE_SCREEN_ASYNC: {
+            CHECK_INTERFACE(ISurfaceComposer, data, reply);
+            sp<IBinder> display = data.readStrongBinder();
+            ui::Dataspace reqDataspace = static_cast<ui::Dataspace>(data.readInt32());
+            ui::PixelFormat reqPixelFormat = static_cast<ui::PixelFormat>(data.readInt32());
+            sp<GraphicBuffer> outBuffer;
+            sp<Fence> outFence;
+            Rect sourceCrop(Rect::EMPTY_RECT);
+            data.read(sourceCrop);
+            uint32_t reqWidth = data.readUint32();
+            uint32_t reqHeight = data.readUint32();
+            bool useIdentityTransform = static_cast<bool>(data.readInt32());
+            int32_t rotation = data.readInt32();
+            bool captureSecureLayers = static_cast<bool>(data.readInt32());
+
+            bool capturedSecureLayers = false;
+            status_t res = captureScreenAsync(display, &outBuffer, &outFence, capturedSecureLayers,
+                                              reqDataspace, reqPixelFormat, sourceCrop, reqWidth,
+                                              reqHeight, useIdentityTransform,
+                                              ui::toRotation(rotation), captureSecureLayers);
+
+            reply->writeInt32(res);
+            if (res == NO_ERROR) {
+                reply->write(*outBuffer);
+                reply->write(outFence ? *outFence : *Fence::NO_FENCE);
+                reply->writeBool(capturedSecureLayers);
+            }
+            return NO_ERROR;
+        }
         case CAPTURE_SCREEN_BY_ID: {
             CHECK_INTERFACE(ISurfaceComposer, data, reply);
             uint64_t displayOrLayerStack = data.readUint64();
@@ -1474,6 +1637,17 @@ status_t BnSurfaceComposer::onTransact(
             }
             return NO_ERROR;
         }
+        case GET_COMPOSITION_STATS: {
+            CHECK_INTERFACE(ISurfaceComposer, data, reply);
+            CompositionStats stats;
+            status_t result = getCompositionStats(&stats);
+            reply->writeInt32(result);
+            if (result == NO_ERROR) {
+                memcpy(reply->writeInplace(sizeof(CompositionStats)),
+                        &stats, sizeof(CompositionStats));
+            }
+            return NO_ERROR;
+        }
         case GET_ACTIVE_CONFIG: {
             CHECK_INTERFACE(ISurfaceComposer, data, reply);
             sp<IBinder> display = data.readStrongBinder();
@@ -1481,6 +1655,16 @@ status_t BnSurfaceComposer::onTransact(
             reply->writeInt32(id);
             return NO_ERROR;
         }
+        case GET_DISPLAY_CONFIG_TABLE: {
+            CHECK_INTERFACE(ISurfaceComposer, data, reply);
+            sp<IMemoryHeap> heap;
+            const status_t result = getDisplayConfigTable(&heap);
+            reply->writeInt32(result);
+            if (result == NO_ERROR) {
+                reply->writeStrongBinder(IInterface::asBinder(heap));
+            }
+            return NO_ERROR;
+        }
         case GET_DISPLAY_COLOR_MODES: {
             CHECK_INTERFACE(ISurfaceComposer, data, reply);
             Vector<ColorMode> colorModes;
@@ -2058,6 +2242,27 @@ status_t BnSurfaceComposer::onTransact(
             }
             return NO_ERROR;
         }
+        case SET_THERMAL_REFRESH_RATE_HEADROOM: {
+            CHECK_INTERFACE(ISurfaceComposer, data, reply);
+            float headroom;
+            status_t error = data.readFloat(&headroom);
+            if (error != NO_ERROR) {
+                ALOGE("setThermalRefreshRateHeadroom: failed to read headroom: %d", error);
+                return error;
+            }
+            return setThermalRefreshRateHeadroom(headroom);
+        }
+        case GET_DISPLAYED_CONTENT_SAMPLE_STREAM: {
+            CHECK_INTERFACE(ISurfaceComposer, data, reply);
+            sp<IBinder> display = data.readStrongBinder();
+            base::unique_fd fd;
+            status_t result = getDisplayedContentSampleStream(display, &fd);
+            reply->writeInt32(result);
+            if (result == NO_ERROR) {
+                reply->writeUniqueFileDescriptor(fd);
+            }
+            return NO_ERROR;
+        }
         default: {
             return BBinder::onTransact(code, data, reply, flags);
         }
@@ -35,11 +35,52 @@ enum class Tag : uint32_t {
     CLEAR_LAYER_FRAME_STATS,
     GET_LAYER_FRAME_STATS,
     MIRROR_SURFACE,
-    LAST = MIRROR_SURFACE,
+    CREATE_SURFACES,
+    LAST = CREATE_SURFACES,
 };
 
 } // Anonymous namespace
 
+status_t ISurfaceComposerClient::SurfaceCreationArgs::writeToParcel(Parcel* parcel) const {
+    status_t status = parcel->writeString8(name);
+    if (status == NO_ERROR) status = parcel->writeUint32(w);
+    if (status == NO_ERROR) status = parcel->writeUint32(h);
+    if (status == NO_ERROR) status = parcel->writeInt32(static_cast<int32_t>(format));
+    if (status == NO_ERROR) status = parcel->writeUint32(flags);
+    if (status == NO_ERROR) status = parcel->writeStrongBinder(parent);
+    if (status == NO_ERROR) status = parcel->writeParcelable(metadata);
+    return status;
+}
+
+status_t ISurfaceComposerClient::SurfaceCreationArgs::readFromParcel(const Parcel* parcel) {
+    status_t status = parcel->readString8(&name);
+    if (status == NO_ERROR) status = parcel->readUint32(&w);
+    if (status == NO_ERROR) status = parcel->readUint32(&h);
+    if (status == NO_ERROR) status = parcel->readInt32(&format);
+    if (status == NO_ERROR) status = parcel->readUint32(&flags);
+    if (status == NO_ERROR) status = parcel->readNullableStrongBinder(&parent);
+    if (status == NO_ERROR) status = parcel->readParcelable(&metadata);
+    return status;
+}
+
+status_t ISurfaceComposerClient::SurfaceCreationResult::writeToParcel(Parcel* parcel) const {
+    status_t status = parcel->writeInt32(result);
+    if (status == NO_ERROR) status = parcel->writeStrongBinder(handle);
+    if (status == NO_ERROR) status = parcel->writeStrongBinder(IInterface::asBinder(gbp));
+    if (status == NO_ERROR) status = parcel->writeUint32(transformHint);
+    return status;
+}
+
+status_t ISurfaceComposerClient::SurfaceCreationResult::readFromParcel(const Parcel* parcel) {
+    status_t status = parcel->readInt32(&result);
+    if (status == NO_ERROR) status = parcel->readNullableStrongBinder(&handle);
+    sp<IBinder> gbpBinder;
+    if (status == NO_ERROR) status = parcel->readNullableStrongBinder(&gbpBinder);
+    if (status == NO_ERROR) gbp = interface_cast<IGraphicBufferProducer>(gbpBinder);
+    if (status == NO_ERROR) status = parcel->readUint32(&transformHint);
+    return status;
+}
+
 class BpSurfaceComposerClient : public SafeBpInterface<ISurfaceComposerClient> {
 public:
     explicit BpSurfaceComposerClient(const sp<IBinder>& impl)
@@ -90,6 +131,12 @@ public:
                                                                             mirrorFromHandle,
                                                                             outHandle);
     }
+
+    status_t createSurfaces(const std::vector<SurfaceCreationArgs>& args,
+                            std::vector<SurfaceCreationResult>* outResults) override {
+        return callRemote<decltype(&ISurfaceComposerClient::createSurfaces)>(Tag::CREATE_SURFACES,
+                                                                             args, outResults);
+    }
 };
 
 // Out-of-line virtual method definition to trigger vtable emission in this
@@ -117,6 +164,8 @@ status_t BnSurfaceComposerClient::onTransact(uint32_t code, const Parcel& data,
             return callLocal(data, reply, &ISurfaceComposerClient::getLayerFrameStats);
         case Tag::MIRROR_SURFACE:
             return callLocal(data, reply, &ISurfaceComposerClient::mirrorSurface);
+        case Tag::CREATE_SURFACES:
+            return callLocal(data, reply, &ISurfaceComposerClient::createSurfaces);
     }
 }
 
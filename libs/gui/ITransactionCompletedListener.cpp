@@ -196,6 +196,16 @@ status_t TransactionStats::readFromParcel(const Parcel* input) {
 }
 
 status_t ListenerStats::writeToParcel(Parcel* output) const {
+    // Pre-size the parcel so flattening a large batch of transaction stats
+    // grows the buffer at most once instead of once per write.
+    constexpr size_t kObjectSize = 64;
+    size_t approxSize = sizeof(int32_t);
+    for (const auto& stats : transactionStats) {
+        approxSize += 16 + stats.callbackIds.size() * sizeof(CallbackId) + kObjectSize;
+        approxSize += stats.surfaceStats.size() * 4 * kObjectSize;
+    }
+    output->setDataCapacity(output->dataPosition() + approxSize);
+
     status_t err = output->writeInt32(static_cast<int32_t>(transactionStats.size()));
     if (err != NO_ERROR) {
         return err;
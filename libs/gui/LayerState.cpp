@@ -28,21 +28,73 @@
 
 namespace android {
 
+namespace {
+
+// Fixed-size scalar runs of layer_state_t, flattened as single inplace blocks
+// so a transaction's worth of states costs a handful of Parcel writes instead
+// of dozens of 4-byte ones per layer. All members are 4-byte scalars, so the
+// blocks have the same layout and padding the individual writes had.
+
+struct GeometryBlock {
+    float x;
+    float y;
+    int32_t z;
+    uint32_t w;
+    uint32_t h;
+    uint32_t layerStack;
+    float alpha;
+    uint32_t flags;
+    uint32_t mask;
+    layer_state_t::matrix22_t matrix;
+};
+
+struct ColorBlock {
+    float r;
+    float g;
+    float b;
+};
+
+struct ColorTransformBlock {
+    float colorTransform[16];
+    float cornerRadius;
+    uint32_t backgroundBlurRadius;
+};
+
+struct BackgroundColorBlock {
+    float bgColorAlpha;
+    uint32_t bgColorDataspace;
+    uint32_t colorSpaceAgnostic;
+};
+
+struct TrailingBlock {
+    float shadowRadius;
+    int32_t frameRateSelectionPriority;
+    float frameRate;
+    int32_t frameRateCompatibility;
+    uint32_t fixedTransformHint;
+};
+
+} // namespace
+
 status_t layer_state_t::write(Parcel& output) const
 {
     output.writeStrongBinder(surface);
     output.writeUint64(what);
-    output.writeFloat(x);
-    output.writeFloat(y);
-    output.writeInt32(z);
-    output.writeUint32(w);
-    output.writeUint32(h);
-    output.writeUint32(layerStack);
-    output.writeFloat(alpha);
-    output.writeUint32(flags);
-    output.writeUint32(mask);
-    *reinterpret_cast<layer_state_t::matrix22_t *>(
-            output.writeInplace(sizeof(layer_state_t::matrix22_t))) = matrix;
+    GeometryBlock* geometry =
+            static_cast<GeometryBlock*>(output.writeInplace(sizeof(GeometryBlock)));
+    if (!geometry) {
+        return NO_MEMORY;
+    }
+    geometry->x = x;
+    geometry->y = y;
+    geometry->z = z;
+    geometry->w = w;
+    geometry->h = h;
+    geometry->layerStack = layerStack;
+    geometry->alpha = alpha;
+    geometry->flags = flags;
+    geometry->mask = mask;
+    geometry->matrix = matrix;
     output.write(crop_legacy);
     output.writeStrongBinder(barrierHandle_legacy);
     output.writeStrongBinder(reparentHandle);
@@ -51,9 +103,14 @@ status_t layer_state_t::write(Parcel& output) const
     output.writeStrongBinder(IInterface::asBinder(barrierGbp_legacy));
     output.writeStrongBinder(relativeLayerHandle);
     output.writeStrongBinder(parentHandleForChild);
-    output.writeFloat(color.r);
-    output.writeFloat(color.g);
-    output.writeFloat(color.b);
+    ColorBlock* colorBlock =
+            static_cast<ColorBlock*>(output.writeInplace(sizeof(ColorBlock)));
+    if (!colorBlock) {
+        return NO_MEMORY;
+    }
+    colorBlock->r = color.r;
+    colorBlock->g = color.g;
+    colorBlock->b = color.b;
 #ifndef NO_INPUT
     inputInfo.write(output);
 #endif
@@ -85,17 +142,26 @@ status_t layer_state_t::write(Parcel& output) const
         output.writeBool(false);
     }
 
-    memcpy(output.writeInplace(16 * sizeof(float)),
-           colorTransform.asArray(), 16 * sizeof(float));
-    output.writeFloat(cornerRadius);
-    output.writeUint32(backgroundBlurRadius);
+    ColorTransformBlock* colorTransformBlock = static_cast<ColorTransformBlock*>(
+            output.writeInplace(sizeof(ColorTransformBlock)));
+    if (!colorTransformBlock) {
+        return NO_MEMORY;
+    }
+    memcpy(colorTransformBlock->colorTransform, colorTransform.asArray(), 16 * sizeof(float));
+    colorTransformBlock->cornerRadius = cornerRadius;
+    colorTransformBlock->backgroundBlurRadius = backgroundBlurRadius;
     output.writeStrongBinder(cachedBuffer.token.promote());
     output.writeUint64(cachedBuffer.id);
     output.writeParcelable(metadata);
 
-    output.writeFloat(bgColorAlpha);
-    output.writeUint32(static_cast<uint32_t>(bgColorDataspace));
-    output.writeBool(colorSpaceAgnostic);
+    BackgroundColorBlock* bgColorBlock = static_cast<BackgroundColorBlock*>(
+            output.writeInplace(sizeof(BackgroundColorBlock)));
+    if (!bgColorBlock) {
+        return NO_MEMORY;
+    }
+    bgColorBlock->bgColorAlpha = bgColorAlpha;
+    bgColorBlock->bgColorDataspace = static_cast<uint32_t>(bgColorDataspace);
+    bgColorBlock->colorSpaceAgnostic = colorSpaceAgnostic;
 
     auto err = output.writeVectorSize(listeners);
     if (err) {
@@ -112,11 +178,16 @@ status_t layer_state_t::write(Parcel& output) const
             return err;
         }
     }
-    output.writeFloat(shadowRadius);
-    output.writeInt32(frameRateSelectionPriority);
-    output.writeFloat(frameRate);
-    output.writeByte(frameRateCompatibility);
-    output.writeUint32(fixedTransformHint);
+    TrailingBlock* trailing =
+            static_cast<TrailingBlock*>(output.writeInplace(sizeof(TrailingBlock)));
+    if (!trailing) {
+        return NO_MEMORY;
+    }
+    trailing->shadowRadius = shadowRadius;
+    trailing->frameRateSelectionPriority = frameRateSelectionPriority;
+    trailing->frameRate = frameRate;
+    trailing->frameRateCompatibility = frameRateCompatibility;
+    trailing->fixedTransformHint = fixedTransformHint;
     return NO_ERROR;
 }
 
@@ -124,21 +195,21 @@ status_t layer_state_t::read(const Parcel& input)
 {
     surface = input.readStrongBinder();
     what = input.readUint64();
-    x = input.readFloat();
-    y = input.readFloat();
-    z = input.readInt32();
-    w = input.readUint32();
-    h = input.readUint32();
-    layerStack = input.readUint32();
-    alpha = input.readFloat();
-    flags = static_cast<uint8_t>(input.readUint32());
-    mask = static_cast<uint8_t>(input.readUint32());
-    const void* matrix_data = input.readInplace(sizeof(layer_state_t::matrix22_t));
-    if (matrix_data) {
-        matrix = *reinterpret_cast<layer_state_t::matrix22_t const *>(matrix_data);
-    } else {
+    const GeometryBlock* geometry =
+            static_cast<const GeometryBlock*>(input.readInplace(sizeof(GeometryBlock)));
+    if (!geometry) {
         return BAD_VALUE;
     }
+    x = geometry->x;
+    y = geometry->y;
+    z = geometry->z;
+    w = geometry->w;
+    h = geometry->h;
+    layerStack = geometry->layerStack;
+    alpha = geometry->alpha;
+    flags = static_cast<uint8_t>(geometry->flags);
+    mask = static_cast<uint8_t>(geometry->mask);
+    matrix = geometry->matrix;
     input.read(crop_legacy);
     barrierHandle_legacy = input.readStrongBinder();
     reparentHandle = input.readStrongBinder();
@@ -147,9 +218,14 @@ status_t layer_state_t::read(const Parcel& input)
     barrierGbp_legacy = interface_cast<IGraphicBufferProducer>(input.readStrongBinder());
     relativeLayerHandle = input.readStrongBinder();
     parentHandleForChild = input.readStrongBinder();
-    color.r = input.readFloat();
-    color.g = input.readFloat();
-    color.b = input.readFloat();
+    const ColorBlock* colorBlock =
+            static_cast<const ColorBlock*>(input.readInplace(sizeof(ColorBlock)));
+    if (!colorBlock) {
+        return BAD_VALUE;
+    }
+    color.r = colorBlock->r;
+    color.g = colorBlock->g;
+    color.b = colorBlock->b;
 
 #ifndef NO_INPUT
     inputInfo = InputWindowInfo::read(input);
@@ -160,13 +236,20 @@ status_t layer_state_t::read(const Parcel& input)
     transformToDisplayInverse = input.readBool();
     input.read(crop);
     input.read(frame);
-    buffer = new GraphicBuffer();
     if (input.readBool()) {
+        buffer = new GraphicBuffer();
         input.read(*buffer);
+    } else {
+        // Preserve the non-null guarantee for consumers that look at the
+        // buffer whenever eBufferChanged is set, without paying for an
+        // allocation in the common buffer-less transaction.
+        buffer = (what & eBufferChanged) ? new GraphicBuffer() : nullptr;
     }
-    acquireFence = new Fence();
     if (input.readBool()) {
+        acquireFence = new Fence();
         input.read(*acquireFence);
+    } else {
+        acquireFence = (what & eAcquireFenceChanged) ? new Fence() : nullptr;
     }
     dataspace = static_cast<ui::Dataspace>(input.readUint32());
     input.read(hdrMetadata);
@@ -176,16 +259,26 @@ status_t layer_state_t::read(const Parcel& input)
         sidebandStream = NativeHandle::create(input.readNativeHandle(), true);
     }
 
-    colorTransform = mat4(static_cast<const float*>(input.readInplace(16 * sizeof(float))));
-    cornerRadius = input.readFloat();
-    backgroundBlurRadius = input.readUint32();
+    const ColorTransformBlock* colorTransformBlock = static_cast<const ColorTransformBlock*>(
+            input.readInplace(sizeof(ColorTransformBlock)));
+    if (!colorTransformBlock) {
+        return BAD_VALUE;
+    }
+    colorTransform = mat4(colorTransformBlock->colorTransform);
+    cornerRadius = colorTransformBlock->cornerRadius;
+    backgroundBlurRadius = colorTransformBlock->backgroundBlurRadius;
     cachedBuffer.token = input.readStrongBinder();
     cachedBuffer.id = input.readUint64();
     input.readParcelable(&metadata);
 
-    bgColorAlpha = input.readFloat();
-    bgColorDataspace = static_cast<ui::Dataspace>(input.readUint32());
-    colorSpaceAgnostic = input.readBool();
+    const BackgroundColorBlock* bgColorBlock = static_cast<const BackgroundColorBlock*>(
+            input.readInplace(sizeof(BackgroundColorBlock)));
+    if (!bgColorBlock) {
+        return BAD_VALUE;
+    }
+    bgColorAlpha = bgColorBlock->bgColorAlpha;
+    bgColorDataspace = static_cast<ui::Dataspace>(bgColorBlock->bgColorDataspace);
+    colorSpaceAgnostic = bgColorBlock->colorSpaceAgnostic != 0;
 
     int32_t numListeners = input.readInt32();
     listeners.clear();
@@ -195,14 +288,51 @@ status_t layer_state_t::read(const Parcel& input)
         input.readInt64Vector(&callbackIds);
         listeners.emplace_back(listener, callbackIds);
     }
-    shadowRadius = input.readFloat();
-    frameRateSelectionPriority = input.readInt32();
-    frameRate = input.readFloat();
-    frameRateCompatibility = input.readByte();
-    fixedTransformHint = static_cast<ui::Transform::RotationFlags>(input.readUint32());
+    const TrailingBlock* trailing =
+            static_cast<const TrailingBlock*>(input.readInplace(sizeof(TrailingBlock)));
+    if (!trailing) {
+        return BAD_VALUE;
+    }
+    shadowRadius = trailing->shadowRadius;
+    frameRateSelectionPriority = trailing->frameRateSelectionPriority;
+    frameRate = trailing->frameRate;
+    frameRateCompatibility = static_cast<int8_t>(trailing->frameRateCompatibility);
+    fixedTransformHint = static_cast<ui::Transform::RotationFlags>(trailing->fixedTransformHint);
     return NO_ERROR;
 }
 
+size_t layer_state_t::getApproximateSize() const {
+    // Strong binders and file descriptors land in the Parcel's object table as
+    // well as the data buffer; budgeting 64 bytes apiece overestimates both.
+    constexpr size_t kObjectSize = 64;
+
+    // The fixed scalar payload (the inplace blocks, rects, bools and ids
+    // above), rounded up, plus the seven strong binders always flattened.
+    size_t size = 512 + 7 * kObjectSize;
+
+    size += transparentRegion.getFlattenedSize();
+    size += surfaceDamageRegion.getFlattenedSize();
+    size += hdrMetadata.getFlattenedSize();
+    if (buffer) {
+        size += buffer->getFlattenedSize() + buffer->getFdCount() * kObjectSize;
+    }
+    if (sidebandStream) {
+        size += kObjectSize;
+    }
+    for (const auto& [key, value] : metadata.mMap) {
+        size += 3 * sizeof(uint32_t) + value.size();
+    }
+    for (const auto& listener : listeners) {
+        size += kObjectSize + sizeof(uint32_t) + listener.callbackIds.size() * sizeof(int64_t);
+    }
+#ifndef NO_INPUT
+    // The window name and touchable region dominate; anything unusually large
+    // costs at most one extra Parcel grow.
+    size += 256 + inputInfo.touchableRegion.getFlattenedSize();
+#endif
+    return size;
+}
+
 status_t ComposerState::write(Parcel& output) const {
     return state.write(output);
 }
@@ -20,6 +20,7 @@
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 //#define LOG_NDEBUG 0
 
+#include <gui/FlattenableHelpers.h>
 #include <gui/IGraphicBufferProducer.h>
 
 namespace android {
@@ -57,14 +58,8 @@ status_t IGraphicBufferProducer::QueueBufferInput::flatten(
         return NO_MEMORY;
     }
 
-    FlattenableUtils::write(buffer, size, timestamp);
-    FlattenableUtils::write(buffer, size, isAutoTimestamp);
-    FlattenableUtils::write(buffer, size, dataSpace);
-    FlattenableUtils::write(buffer, size, crop);
-    FlattenableUtils::write(buffer, size, scalingMode);
-    FlattenableUtils::write(buffer, size, transform);
-    FlattenableUtils::write(buffer, size, stickyTransform);
-    FlattenableUtils::write(buffer, size, getFrameTimestamps);
+    FlattenableHelpers::write(buffer, size, timestamp, isAutoTimestamp, dataSpace, crop,
+                              scalingMode, transform, stickyTransform, getFrameTimestamps);
 
     status_t result = fence->flatten(buffer, size, fds, count);
     if (result != NO_ERROR) {
@@ -85,14 +80,8 @@ status_t IGraphicBufferProducer::QueueBufferInput::unflatten(
         return NO_MEMORY;
     }
 
-    FlattenableUtils::read(buffer, size, timestamp);
-    FlattenableUtils::read(buffer, size, isAutoTimestamp);
-    FlattenableUtils::read(buffer, size, dataSpace);
-    FlattenableUtils::read(buffer, size, crop);
-    FlattenableUtils::read(buffer, size, scalingMode);
-    FlattenableUtils::read(buffer, size, transform);
-    FlattenableUtils::read(buffer, size, stickyTransform);
-    FlattenableUtils::read(buffer, size, getFrameTimestamps);
+    FlattenableHelpers::read(buffer, size, timestamp, isAutoTimestamp, dataSpace, crop,
+                             scalingMode, transform, stickyTransform, getFrameTimestamps);
 
     fence = new Fence();
     status_t result = fence->unflatten(buffer, size, fds, count);
@@ -127,13 +116,8 @@ status_t IGraphicBufferProducer::QueueBufferOutput::flatten(
         return NO_MEMORY;
     }
 
-    FlattenableUtils::write(buffer, size, width);
-    FlattenableUtils::write(buffer, size, height);
-    FlattenableUtils::write(buffer, size, transformHint);
-    FlattenableUtils::write(buffer, size, numPendingBuffers);
-    FlattenableUtils::write(buffer, size, nextFrameNumber);
-    FlattenableUtils::write(buffer, size, bufferReplaced);
-    FlattenableUtils::write(buffer, size, maxBufferCount);
+    FlattenableHelpers::write(buffer, size, width, height, transformHint, numPendingBuffers,
+                              nextFrameNumber, bufferReplaced, maxBufferCount);
 
     return frameTimestamps.flatten(buffer, size, fds, count);
 }
@@ -145,13 +129,8 @@ status_t IGraphicBufferProducer::QueueBufferOutput::unflatten(
         return NO_MEMORY;
     }
 
-    FlattenableUtils::read(buffer, size, width);
-    FlattenableUtils::read(buffer, size, height);
-    FlattenableUtils::read(buffer, size, transformHint);
-    FlattenableUtils::read(buffer, size, numPendingBuffers);
-    FlattenableUtils::read(buffer, size, nextFrameNumber);
-    FlattenableUtils::read(buffer, size, bufferReplaced);
-    FlattenableUtils::read(buffer, size, maxBufferCount);
+    FlattenableHelpers::read(buffer, size, width, height, transformHint, numPendingBuffers,
+                             nextFrameNumber, bufferReplaced, maxBufferCount);
 
     return frameTimestamps.unflatten(buffer, size, fds, count);
 }
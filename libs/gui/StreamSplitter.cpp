@@ -138,9 +138,11 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
     LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
             "detaching buffer from input failed (%d)", status);
 
-    // Initialize our reference count for this buffer
-    mBuffers.add(bufferItem.mGraphicBuffer->getId(),
-            new BufferTracker(bufferItem.mGraphicBuffer));
+    // Initialize our reference count for this buffer. The same GraphicBuffer
+    // instance (and thus the same imported handle) is handed to every output
+    // below; only the reference count and merged fence are per-frame state.
+    sp<BufferTracker> tracker(new BufferTracker(bufferItem.mGraphicBuffer));
+    mBuffers.add(bufferItem.mGraphicBuffer->getId(), tracker);
 
     IGraphicBufferProducer::QueueBufferInput queueInput(
             bufferItem.mTimestamp, bufferItem.mIsAutoTimestamp,
@@ -158,8 +160,7 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
             // that, increment the release count so that we still release this
             // buffer eventually, and move on to the next output
             onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
+            tracker->incrementReleaseCountLocked();
             continue;
         } else {
             LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
@@ -173,8 +174,7 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
             // that, increment the release count so that we still release this
             // buffer eventually, and move on to the next output
             onAbandonedLocked();
-            mBuffers.editValueFor(bufferItem.mGraphicBuffer->getId())->
-                    incrementReleaseCountLocked();
+            tracker->incrementReleaseCountLocked();
             continue;
         } else {
             LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
@@ -189,14 +189,16 @@ void StreamSplitter::onFrameAvailable(const BufferItem& /* item */) {
 void StreamSplitter::onBufferReleasedByOutput(
         const sp<IGraphicBufferProducer>& from) {
     ATRACE_CALL();
-    Mutex::Autolock lock(mMutex);
 
+    // Detach without holding mMutex, so that concurrent releases from other
+    // outputs don't serialize behind this binder call
     sp<GraphicBuffer> buffer;
     sp<Fence> fence;
     status_t status = from->detachNextBuffer(&buffer, &fence);
     if (status == NO_INIT) {
         // If we just discovered that this output has been abandoned, note that,
         // but we can't do anything else, since buffer is invalid
+        Mutex::Autolock lock(mMutex);
         onAbandonedLocked();
         return;
     } else {
@@ -207,45 +209,65 @@ void StreamSplitter::onBufferReleasedByOutput(
     ALOGV("detached buffer %#" PRIx64 " from output %p",
           buffer->getId(), from.get());
 
-    const sp<BufferTracker>& tracker = mBuffers.editValueFor(buffer->getId());
-
-    // Merge the release fence of the incoming buffer so that the fence we send
-    // back to the input includes all of the outputs' fences
-    tracker->mergeFence(fence);
-
-    // Check to see if this is the last outstanding reference to this buffer
-    size_t releaseCount = tracker->incrementReleaseCountLocked();
-    ALOGV("buffer %#" PRIx64 " reference count %zu (of %zu)", buffer->getId(),
-            releaseCount, mOutputs.size());
-    if (releaseCount < mOutputs.size()) {
-        return;
-    }
+    sp<BufferTracker> tracker;
+    {
+        Mutex::Autolock lock(mMutex);
+        tracker = mBuffers.valueFor(buffer->getId());
+
+        // Merge the release fence of the incoming buffer so that the fence we
+        // send back to the input includes all of the outputs' fences
+        tracker->mergeFence(fence);
+
+        // Check to see if this is the last outstanding reference to this
+        // buffer
+        size_t releaseCount = tracker->incrementReleaseCountLocked();
+        ALOGV("buffer %#" PRIx64 " reference count %zu (of %zu)",
+                buffer->getId(), releaseCount, mOutputs.size());
+        if (releaseCount < mOutputs.size()) {
+            return;
+        }
 
-    // If we've been abandoned, we can't return the buffer to the input, so just
-    // stop tracking it and move on
-    if (mIsAbandoned) {
+        // We no longer need to track the buffer now that all of the outputs
+        // have released it. The tracker keeps it (and the merged fence) alive
+        // for the return to the input below.
         mBuffers.removeItem(buffer->getId());
-        return;
+
+        // If we've been abandoned, we can't return the buffer to the input,
+        // so just stop tracking it and move on
+        if (mIsAbandoned) {
+            return;
+        }
     }
 
-    // Attach and release the buffer back to the input
+    // Attach and release the buffer back to the input. This is also done
+    // without holding mMutex, so releases of other buffers and the fan-out in
+    // onFrameAvailable can proceed in the meantime. The splitter may be
+    // abandoned while we're unlocked, in which case the input has been
+    // disconnected and these calls fail with NO_INIT.
     int consumerSlot;
     status = mInput->attachBuffer(&consumerSlot, tracker->getBuffer());
+    if (status == NO_INIT) {
+        Mutex::Autolock lock(mMutex);
+        onAbandonedLocked();
+        return;
+    }
     LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
             "attaching buffer to input failed (%d)", status);
 
     status = mInput->releaseBuffer(consumerSlot, /* frameNumber */ 0,
             EGL_NO_DISPLAY, EGL_NO_SYNC_KHR, tracker->getMergedFence());
+    if (status == NO_INIT) {
+        Mutex::Autolock lock(mMutex);
+        onAbandonedLocked();
+        return;
+    }
     LOG_ALWAYS_FATAL_IF(status != NO_ERROR,
             "releasing buffer to input failed (%d)", status);
 
     ALOGV("released buffer %#" PRIx64 " to input", buffer->getId());
 
-    // We no longer need to track the buffer once it has been returned to the
-    // input
-    mBuffers.removeItem(buffer->getId());
-
     // Notify any waiting onFrameAvailable calls
+    Mutex::Autolock lock(mMutex);
     --mOutstandingBuffers;
     mReleaseCondition.signal();
 }
@@ -111,6 +111,7 @@ Surface::Surface(const sp<IGraphicBufferProducer>& bufferProducer, bool controll
     mProducerControlledByApp = controlledByApp;
     mSwapIntervalZero = false;
     mMaxBufferCount = NUM_BUFFER_SLOTS;
+    mAttributeStaging = false;
 }
 
 Surface::~Surface() {
@@ -170,6 +171,12 @@ String8 Surface::getConsumerName() const {
 }
 
 status_t Surface::setDequeueTimeout(nsecs_t timeout) {
+    Mutex::Autolock lock(mMutex);
+    if (mAttributeStaging) {
+        mPendingAttributes.hasDequeueTimeout = true;
+        mPendingAttributes.dequeueTimeout = timeout;
+        return NO_ERROR;
+    }
     return mGraphicBufferProducer->setDequeueTimeout(timeout);
 }
 
@@ -638,6 +645,14 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
 
     {
         Mutex::Autolock lock(mMutex);
+        // Commit any staged attribute changes before their cached values are
+        // consulted below and before the producer hands out a buffer that
+        // should already reflect them.
+        status_t err = flushPendingAttributesLocked();
+        if (err != NO_ERROR) {
+            return err;
+        }
+
         if (mReportRemovedBuffers) {
             mRemovedBuffers.clear();
         }
@@ -663,13 +678,21 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
 
     int buf = -1;
     sp<Fence> fence;
+    sp<GraphicBuffer> dequeuedBuffer;
     nsecs_t startTime = systemTime();
 
     FrameEventHistoryDelta frameTimestamps;
-    status_t result = mGraphicBufferProducer->dequeueBuffer(&buf, &fence, reqWidth, reqHeight,
-                                                            reqFormat, reqUsage, &mBufferAge,
-                                                            enableFrameTimestamps ? &frameTimestamps
-                                                                                  : nullptr);
+    // Remember the age observed by the previous dequeue before the producer call
+    // overwrites it; getPredictedBufferAge compares the two for steady state.
+    const uint64_t lastBufferAge = mBufferAge;
+    // The combined call carries the reallocated buffer in the dequeue reply,
+    // saving the separate requestBuffer round trip on slot misses.
+    status_t result = mGraphicBufferProducer->dequeueWithBuffer(&buf, &fence, reqWidth, reqHeight,
+                                                                reqFormat, reqUsage,
+                                                                &dequeuedBuffer, &mBufferAge,
+                                                                enableFrameTimestamps
+                                                                        ? &frameTimestamps
+                                                                        : nullptr);
     mLastDequeueDuration = systemTime() - startTime;
 
     if (result < 0) {
@@ -689,6 +712,7 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
 
     // Write this while holding the mutex
     mLastDequeueStartTime = startTime;
+    mPreviousBufferAge = lastBufferAge;
 
     sp<GraphicBuffer>& gbuf(mSlots[buf].buffer);
 
@@ -712,11 +736,17 @@ int Surface::dequeueBuffer(android_native_buffer_t** buffer, int* fenceFd) {
         if (mReportRemovedBuffers && (gbuf != nullptr)) {
             mRemovedBuffers.push_back(gbuf);
         }
-        result = mGraphicBufferProducer->requestBuffer(buf, &gbuf);
-        if (result != NO_ERROR) {
-            ALOGE("dequeueBuffer: IGraphicBufferProducer::requestBuffer failed: %d", result);
-            mGraphicBufferProducer->cancelBuffer(buf, fence);
-            return result;
+        if (dequeuedBuffer != nullptr) {
+            gbuf = dequeuedBuffer;
+        } else {
+            // The server didn't flag a reallocation but our mirror of the
+            // slot is gone (e.g. after freeAllBuffers), so fetch it.
+            result = mGraphicBufferProducer->requestBuffer(buf, &gbuf);
+            if (result != NO_ERROR) {
+                ALOGE("dequeueBuffer: IGraphicBufferProducer::requestBuffer failed: %d", result);
+                mGraphicBufferProducer->cancelBuffer(buf, fence);
+                return result;
+            }
         }
     }
 
@@ -940,6 +970,14 @@ int Surface::queueBuffer(android_native_buffer_t* buffer, int fenceFd) {
     mIsBufferAccumulated = mConsumerRunningBehind;
 
     if (!mConnectedToCpu) {
+        // Record this frame's damage before clearing it, so getAccumulatedDamage
+        // can union the recent frames for partial-render planning.
+        mDamageHistory[mDamageHistoryHead] = mDirtyRegion;
+        mDamageHistoryHead = (mDamageHistoryHead + 1) % kDamageHistoryDepth;
+        if (mDamageHistoryCount < kDamageHistoryDepth) {
+            mDamageHistoryCount++;
+        }
+
         // Clear surface damage back to full-buffer
         mDirtyRegion = Region::INVALID_REGION;
     }
@@ -1745,6 +1783,12 @@ int Surface::setMaxDequeuedBufferCount(int maxDequeuedBuffers) {
     ALOGV("Surface::setMaxDequeuedBufferCount");
     Mutex::Autolock lock(mMutex);
 
+    if (mAttributeStaging) {
+        mPendingAttributes.hasMaxDequeuedBufferCount = true;
+        mPendingAttributes.maxDequeuedBufferCount = maxDequeuedBuffers;
+        return NO_ERROR;
+    }
+
     status_t err = mGraphicBufferProducer->setMaxDequeuedBufferCount(
             maxDequeuedBuffers);
     ALOGE_IF(err, "IGraphicBufferProducer::setMaxDequeuedBufferCount(%d) "
@@ -1758,6 +1802,12 @@ int Surface::setAsyncMode(bool async) {
     ALOGV("Surface::setAsyncMode");
     Mutex::Autolock lock(mMutex);
 
+    if (mAttributeStaging) {
+        mPendingAttributes.hasAsyncMode = true;
+        mPendingAttributes.asyncMode = async;
+        return NO_ERROR;
+    }
+
     status_t err = mGraphicBufferProducer->setAsyncMode(async);
     ALOGE_IF(err, "IGraphicBufferProducer::setAsyncMode(%d) returned %s",
             async, strerror(-err));
@@ -1770,6 +1820,12 @@ int Surface::setSharedBufferMode(bool sharedBufferMode) {
     ALOGV("Surface::setSharedBufferMode (%d)", sharedBufferMode);
     Mutex::Autolock lock(mMutex);
 
+    if (mAttributeStaging) {
+        mPendingAttributes.hasSharedBufferMode = true;
+        mPendingAttributes.sharedBufferMode = sharedBufferMode;
+        return NO_ERROR;
+    }
+
     status_t err = mGraphicBufferProducer->setSharedBufferMode(
             sharedBufferMode);
     if (err == NO_ERROR) {
@@ -1786,6 +1842,12 @@ int Surface::setAutoRefresh(bool autoRefresh) {
     ALOGV("Surface::setAutoRefresh (%d)", autoRefresh);
     Mutex::Autolock lock(mMutex);
 
+    if (mAttributeStaging) {
+        mPendingAttributes.hasAutoRefresh = true;
+        mPendingAttributes.autoRefresh = autoRefresh;
+        return NO_ERROR;
+    }
+
     status_t err = mGraphicBufferProducer->setAutoRefresh(autoRefresh);
     if (err == NO_ERROR) {
         mAutoRefresh = autoRefresh;
@@ -2003,6 +2065,33 @@ void Surface::setSurfaceDamage(android_native_rect_t* rects, size_t numRects) {
     }
 }
 
+uint64_t Surface::getPredictedBufferAge() {
+    Mutex::Autolock lock(mMutex);
+    if (mBufferAge == 0 || mBufferAge != mPreviousBufferAge) {
+        return 0;
+    }
+    return mBufferAge;
+}
+
+Region Surface::getAccumulatedDamage(uint64_t bufferAge) {
+    Mutex::Autolock lock(mMutex);
+    if (bufferAge == 0 || bufferAge - 1 > mDamageHistoryCount) {
+        return Region::INVALID_REGION;
+    }
+    Region accumulated;
+    for (uint64_t i = 1; i < bufferAge; i++) {
+        const size_t index =
+                (mDamageHistoryHead + kDamageHistoryDepth - i) % kDamageHistoryDepth;
+        const Region& damage = mDamageHistory[index];
+        if (damage.bounds() == Rect::INVALID_RECT) {
+            // A frame in the window had full damage, so the whole buffer is stale.
+            return Region::INVALID_REGION;
+        }
+        accumulated.orSelf(damage);
+    }
+    return accumulated;
+}
+
 // ----------------------------------------------------------------------
 // the lock/unlock APIs must be used from the same thread
 
@@ -2253,6 +2342,12 @@ int Surface::setAutoPrerotation(bool autoPrerotation) {
         return OK;
     }
 
+    if (mAttributeStaging) {
+        mPendingAttributes.hasAutoPrerotation = true;
+        mPendingAttributes.autoPrerotation = autoPrerotation;
+        return NO_ERROR;
+    }
+
     status_t err = mGraphicBufferProducer->setAutoPrerotation(autoPrerotation);
     if (err == NO_ERROR) {
         mAutoPrerotation = autoPrerotation;
@@ -2262,6 +2357,59 @@ int Surface::setAutoPrerotation(bool autoPrerotation) {
     return err;
 }
 
+int Surface::setStuffingRecovery(bool enable) {
+    ATRACE_CALL();
+    ALOGV("Surface::setStuffingRecovery (%d)", enable);
+
+    status_t err = mGraphicBufferProducer->setStuffingRecovery(enable);
+    ALOGE_IF(err, "IGraphicBufferProducer::setStuffingRecovery(%d) returned %s", enable,
+             strerror(-err));
+    return err;
+}
+
+int Surface::setAttributeStaging(bool enable) {
+    ATRACE_CALL();
+    ALOGV("Surface::setAttributeStaging (%d)", enable);
+    Mutex::Autolock lock(mMutex);
+
+    mAttributeStaging = enable;
+    if (!enable) {
+        // Don't leave staged changes stranded.
+        return flushPendingAttributesLocked();
+    }
+    return NO_ERROR;
+}
+
+status_t Surface::flushPendingAttributes() {
+    Mutex::Autolock lock(mMutex);
+    return flushPendingAttributesLocked();
+}
+
+status_t Surface::flushPendingAttributesLocked() {
+    if (!mPendingAttributes.any()) {
+        return NO_ERROR;
+    }
+    ATRACE_CALL();
+
+    IGraphicBufferProducer::PendingAttributes attributes = mPendingAttributes;
+    mPendingAttributes = IGraphicBufferProducer::PendingAttributes();
+
+    status_t err = mGraphicBufferProducer->applyPendingAttributes(attributes);
+    if (err == NO_ERROR) {
+        if (attributes.hasSharedBufferMode) {
+            mSharedBufferMode = attributes.sharedBufferMode;
+        }
+        if (attributes.hasAutoRefresh) {
+            mAutoRefresh = attributes.autoRefresh;
+        }
+        if (attributes.hasAutoPrerotation) {
+            mAutoPrerotation = attributes.autoPrerotation;
+        }
+    }
+    ALOGE_IF(err, "IGraphicBufferProducer::applyPendingAttributes returned %s", strerror(-err));
+    return err;
+}
+
 void Surface::ProducerListenerProxy::onBuffersDiscarded(const std::vector<int32_t>& slots) {
     ATRACE_CALL();
     sp<Surface> parent = mParent.promote();
@@ -16,15 +16,21 @@
 
 #define LOG_TAG "SurfaceComposerClient"
 
+#include <fcntl.h>
 #include <stdint.h>
+#include <sys/eventfd.h>
 #include <sys/types.h>
 
+#include <algorithm>
+#include <map>
+
 #include <utils/Errors.h>
 #include <utils/Log.h>
 #include <utils/SortedVector.h>
 #include <utils/String8.h>
 #include <utils/threads.h>
 
+#include <binder/IMemory.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
 #include <binder/ProcessState.h>
@@ -33,6 +39,7 @@
 
 #include <gui/BufferItemConsumer.h>
 #include <gui/CpuConsumer.h>
+#include <gui/DisplayConfigTable.h>
 #include <gui/IGraphicBufferProducer.h>
 #include <gui/ISurfaceComposer.h>
 #include <gui/ISurfaceComposerClient.h>
@@ -631,11 +638,114 @@ void SurfaceComposerClient::Transaction::cacheBuffers() {
     }
 }
 
+namespace {
+
+// Process-wide merge queue backing Transaction batching mode.  Applies
+// within the batching window accumulate here and go out as a single
+// setTransactionState call.
+struct TransactionBatch {
+    std::mutex mutex;
+    bool enabled = false;
+    nsecs_t windowNs = 0;
+    // Set when `pending` holds unsent state; the first deferred apply
+    // stamps the flush deadline.
+    bool pendingValid = false;
+    nsecs_t deadline = 0;
+    SurfaceComposerClient::Transaction pending;
+};
+
+TransactionBatch& transactionBatch() {
+    static TransactionBatch batch;
+    return batch;
+}
+
+// Breaks the recursion when the flush path re-enters apply().
+thread_local bool tFlushingBatch = false;
+
+} // anonymous namespace
+
+bool SurfaceComposerClient::Transaction::maybeBatch(bool synchronous) {
+    if (tFlushingBatch) return false;
+
+    TransactionBatch& batch = transactionBatch();
+    {
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        if (!batch.enabled) return false;
+
+        const nsecs_t now = systemTime();
+        if (!batch.pendingValid) {
+            batch.deadline = now + batch.windowNs;
+        }
+
+        // merge() does not carry the apply-time fields, so capture them
+        // before it clears *this.
+        const bool forceSynchronous = synchronous || (mForceSynchronous != 0);
+        const bool animation = mAnimation;
+        const int64_t desiredPresentTime = mDesiredPresentTime;
+
+        batch.pending.merge(std::move(*this));
+        batch.pending.mForceSynchronous |= forceSynchronous ? 1 : 0;
+        batch.pending.mAnimation |= animation;
+        if (desiredPresentTime != -1) {
+            batch.pending.mDesiredPresentTime = desiredPresentTime;
+        }
+        batch.pendingValid = true;
+
+        if (!forceSynchronous && now < batch.deadline) {
+            return true;
+        }
+    }
+
+    // Window elapsed or a synchronous apply: everything accumulated so
+    // far, including *this, goes out in one call.
+    flushBatch();
+    return true;
+}
+
+void SurfaceComposerClient::Transaction::enableBatching(nsecs_t windowNs) {
+    TransactionBatch& batch = transactionBatch();
+    std::lock_guard<std::mutex> lock(batch.mutex);
+    batch.enabled = true;
+    batch.windowNs = windowNs;
+}
+
+void SurfaceComposerClient::Transaction::disableBatching() {
+    {
+        TransactionBatch& batch = transactionBatch();
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        batch.enabled = false;
+    }
+    flushBatch();
+}
+
+status_t SurfaceComposerClient::Transaction::flushBatch() {
+    TransactionBatch& batch = transactionBatch();
+    Transaction toFlush;
+    {
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        if (!batch.pendingValid) {
+            return NO_ERROR;
+        }
+        toFlush = batch.pending;
+        batch.pending.clear();
+        batch.pendingValid = false;
+    }
+
+    tFlushingBatch = true;
+    status_t err = toFlush.apply();
+    tFlushingBatch = false;
+    return err;
+}
+
 status_t SurfaceComposerClient::Transaction::apply(bool synchronous) {
     if (mStatus != NO_ERROR) {
         return mStatus;
     }
 
+    if (maybeBatch(synchronous)) {
+        return NO_ERROR;
+    }
+
     sp<ISurfaceComposer> sf(ComposerService::getComposerService());
 
     bool hasListenerCallbacks = !mListenerCallbacks.empty();
@@ -675,6 +785,9 @@ status_t SurfaceComposerClient::Transaction::apply(bool synchronous) {
 
     mForceSynchronous |= synchronous;
 
+    // Size the vector exactly before filling it so a large animation
+    // transaction does a single allocation instead of growing geometrically.
+    composerStates.setCapacity(mComposerStates.size());
     for (auto const& kv : mComposerStates){
         composerStates.add(kv.second);
     }
@@ -1296,6 +1409,45 @@ SurfaceComposerClient::Transaction::addTransactionCompletedCallback(
     return *this;
 }
 
+status_t SurfaceComposerClient::Transaction::applyWithCommitFence(base::unique_fd* outCommitFence) {
+    if (outCommitFence == nullptr) {
+        return BAD_VALUE;
+    }
+
+    base::unique_fd commitFence(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    if (commitFence.get() < 0) {
+        ALOGE("applyWithCommitFence: failed to create eventfd: %s", strerror(errno));
+        return -errno;
+    }
+    // The callback holds its own duplicate so the caller can close its end
+    // independently of callback delivery.
+    auto signalFd = std::make_shared<base::unique_fd>(fcntl(commitFence.get(), F_DUPFD_CLOEXEC, 0));
+    if (signalFd->get() < 0) {
+        ALOGE("applyWithCommitFence: failed to dup eventfd: %s", strerror(errno));
+        return -errno;
+    }
+
+    auto listener = TransactionCompletedListener::getInstance();
+    CallbackId callbackId = listener->addCallbackFunction(
+            [signalFd](nsecs_t /*latchTime*/, const sp<Fence>& /*presentFence*/,
+                       const std::vector<SurfaceControlStats>& /*stats*/) {
+                constexpr uint64_t kOne = 1;
+                if (TEMP_FAILURE_RETRY(write(signalFd->get(), &kOne, sizeof(kOne))) < 0) {
+                    ALOGE("applyWithCommitFence: failed to signal fence: %s", strerror(errno));
+                }
+            },
+            mListenerCallbacks[TransactionCompletedListener::getIInstance()].surfaceControls);
+    mListenerCallbacks[TransactionCompletedListener::getIInstance()].callbackIds.emplace(
+            callbackId);
+
+    status_t err = apply(false);
+    if (err != NO_ERROR) {
+        return err;
+    }
+    *outCommitFence = std::move(commitFence);
+    return NO_ERROR;
+}
+
 SurfaceComposerClient::Transaction& SurfaceComposerClient::Transaction::notifyProducerDisconnect(
         const sp<SurfaceControl>& sc) {
     layer_state_t* s = getLayerState(sc);
@@ -1666,6 +1818,37 @@ status_t SurfaceComposerClient::createSurfaceChecked(const String8& name, uint32
     return err;
 }
 
+status_t SurfaceComposerClient::createSurfaces(
+        const std::vector<ISurfaceComposerClient::SurfaceCreationArgs>& args,
+        std::vector<sp<SurfaceControl>>* outSurfaces) {
+    if (mStatus != NO_ERROR) {
+        return mStatus;
+    }
+
+    std::vector<ISurfaceComposerClient::SurfaceCreationResult> results;
+    status_t err = mClient->createSurfaces(args, &results);
+    if (err != NO_ERROR) {
+        ALOGE("SurfaceComposerClient::createSurfaces error %s", strerror(-err));
+        return err;
+    }
+    if (results.size() != args.size()) {
+        return UNKNOWN_ERROR;
+    }
+
+    outSurfaces->clear();
+    outSurfaces->reserve(results.size());
+    for (const auto& result : results) {
+        sp<SurfaceControl> surface;
+        ALOGE_IF(result.result, "SurfaceComposerClient::createSurfaces entry error %s",
+                 strerror(-result.result));
+        if (result.result == NO_ERROR) {
+            surface = new SurfaceControl(this, result.handle, result.gbp, result.transformHint);
+        }
+        outSurfaces->push_back(surface);
+    }
+    return NO_ERROR;
+}
+
 sp<SurfaceControl> SurfaceComposerClient::mirrorSurface(SurfaceControl* mirrorFromSurface) {
     if (mirrorFromSurface == nullptr) {
         return nullptr;
@@ -1716,8 +1899,117 @@ status_t SurfaceComposerClient::getDisplayInfo(const sp<IBinder>& display, Displ
     return ComposerService::getComposerService()->getDisplayInfo(display, info);
 }
 
+namespace {
+
+// Lazily mapped copy of the DisplayConfigTable that SurfaceFlinger publishes
+// over shared memory, and the display token to physical display id mapping
+// needed to index it. Both are cached for the lifetime of the process; the
+// table itself is uncached shared memory, so every read observes the latest
+// configs without further binder traffic.
+Mutex gDisplayConfigTableLock;
+sp<IMemoryHeap> gDisplayConfigTableHeap;
+bool gDisplayConfigTableChecked = false;
+std::map<wp<IBinder>, PhysicalDisplayId> gDisplayIdCache;
+
+const DisplayConfigTable* getDisplayConfigTableLocked() {
+    if (!gDisplayConfigTableChecked) {
+        gDisplayConfigTableChecked = true;
+        sp<IMemoryHeap> heap;
+        if (ComposerService::getComposerService()->getDisplayConfigTable(&heap) != NO_ERROR ||
+            heap == nullptr || heap->getBase() == MAP_FAILED ||
+            heap->getSize() < sizeof(DisplayConfigTable)) {
+            return nullptr;
+        }
+        const auto table = static_cast<const DisplayConfigTable*>(heap->getBase());
+        if (table->version != DisplayConfigTable::kVersion) {
+            ALOGW("Ignoring display config table with unknown version %u", table->version);
+            return nullptr;
+        }
+        gDisplayConfigTableHeap = heap;
+    }
+    return gDisplayConfigTableHeap != nullptr
+            ? static_cast<const DisplayConfigTable*>(gDisplayConfigTableHeap->getBase())
+            : nullptr;
+}
+
+bool getPhysicalDisplayIdLocked(const sp<IBinder>& display, PhysicalDisplayId* outId) {
+    const auto it = gDisplayIdCache.find(display);
+    if (it != gDisplayIdCache.end()) {
+        *outId = it->second;
+        return true;
+    }
+    const auto sf = ComposerService::getComposerService();
+    for (PhysicalDisplayId id : sf->getPhysicalDisplayIds()) {
+        if (sf->getPhysicalDisplayToken(id) == display) {
+            gDisplayIdCache[display] = id;
+            *outId = id;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Copies the table entry for the given display token, retrying while a write
+// is in flight. Returns false if the table is unavailable, the display is not
+// published in it, or the table stays unstable, in which case the caller
+// falls back to the binder path.
+bool readDisplayConfigTableEntry(const sp<IBinder>& display, DisplayConfigTable::Display* out) {
+    Mutex::Autolock lock(gDisplayConfigTableLock);
+    const DisplayConfigTable* table = getDisplayConfigTableLocked();
+    if (table == nullptr) {
+        return false;
+    }
+    PhysicalDisplayId displayId;
+    if (!getPhysicalDisplayIdLocked(display, &displayId)) {
+        return false;
+    }
+
+    constexpr int kMaxAttempts = 5;
+    for (int attempt = 0; attempt < kMaxAttempts; attempt++) {
+        const uint32_t seq = table->seq.load(std::memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+
+        bool found = false;
+        DisplayConfigTable::Display entry;
+        const uint32_t numDisplays =
+                std::min<uint32_t>(table->numDisplays, DisplayConfigTable::kMaxDisplays);
+        for (uint32_t i = 0; i < numDisplays; i++) {
+            if (table->displays[i].displayId == displayId) {
+                entry = table->displays[i];
+                found = true;
+                break;
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (table->seq.load(std::memory_order_relaxed) != seq) {
+            continue;
+        }
+        if (!found) {
+            return false;
+        }
+        *out = entry;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
 status_t SurfaceComposerClient::getDisplayConfigs(const sp<IBinder>& display,
                                                   Vector<DisplayConfig>* configs) {
+    DisplayConfigTable::Display entry;
+    if (readDisplayConfigTableEntry(display, &entry)) {
+        configs->clear();
+        for (uint32_t i = 0; i < std::min<uint32_t>(entry.numConfigs,
+                                                    DisplayConfigTable::kMaxConfigs);
+             i++) {
+            configs->push_back(entry.configs[i]);
+        }
+        return NO_ERROR;
+    }
     return ComposerService::getComposerService()->getDisplayConfigs(display, configs);
 }
 
@@ -1740,6 +2032,10 @@ status_t SurfaceComposerClient::getActiveDisplayConfig(const sp<IBinder>& displa
 }
 
 int SurfaceComposerClient::getActiveConfig(const sp<IBinder>& display) {
+    DisplayConfigTable::Display entry;
+    if (readDisplayConfigTableEntry(display, &entry)) {
+        return entry.activeConfig;
+    }
     return ComposerService::getComposerService()->getActiveConfig(display);
 }
 
@@ -1863,6 +2159,11 @@ status_t SurfaceComposerClient::getDisplayedContentSample(const sp<IBinder>& dis
                                                                             timestamp, outStats);
 }
 
+status_t SurfaceComposerClient::getDisplayedContentSampleStream(const sp<IBinder>& display,
+                                                                base::unique_fd* outFd) {
+    return ComposerService::getComposerService()->getDisplayedContentSampleStream(display, outFd);
+}
+
 status_t SurfaceComposerClient::isWideColorDisplay(const sp<IBinder>& display,
                                                    bool* outIsWideColorDisplay) {
     return ComposerService::getComposerService()->isWideColorDisplay(display,
@@ -1905,6 +2206,10 @@ status_t SurfaceComposerClient::setGlobalShadowSettings(const half4& ambientColo
                                                                           lightRadius);
 }
 
+status_t SurfaceComposerClient::setThermalRefreshRateHeadroom(float headroom) {
+    return ComposerService::getComposerService()->setThermalRefreshRateHeadroom(headroom);
+}
+
 // ----------------------------------------------------------------------------
 
 status_t ScreenshotClient::capture(const sp<IBinder>& display, ui::Dataspace reqDataSpace,
@@ -1932,6 +2237,19 @@ status_t ScreenshotClient::capture(const sp<IBinder>& display, ui::Dataspace req
                    useIdentityTransform, rotation, false, outBuffer, ignored);
 }
 
+status_t ScreenshotClient::captureAsync(const sp<IBinder>& display, ui::Dataspace reqDataSpace,
+                                        ui::PixelFormat reqPixelFormat, const Rect& sourceCrop,
+                                        uint32_t reqWidth, uint32_t reqHeight,
+                                        bool useIdentityTransform, ui::Rotation rotation,
+                                        bool captureSecureLayers, sp<GraphicBuffer>* outBuffer,
+                                        sp<Fence>* outFence, bool& outCapturedSecureLayers) {
+    sp<ISurfaceComposer> s(ComposerService::getComposerService());
+    if (s == nullptr) return NO_INIT;
+    return s->captureScreenAsync(display, outBuffer, outFence, outCapturedSecureLayers,
+                                 reqDataSpace, reqPixelFormat, sourceCrop, reqWidth, reqHeight,
+                                 useIdentityTransform, rotation, captureSecureLayers);
+}
+
 status_t ScreenshotClient::capture(uint64_t displayOrLayerStack, ui::Dataspace* outDataspace,
                                    sp<GraphicBuffer>* outBuffer) {
     sp<ISurfaceComposer> s(ComposerService::getComposerService());
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include <gui/BufferItem.h>
+#include <gui/BufferQueue.h>
+#include <gui/IConsumerListener.h>
+#include <gui/IProducerListener.h>
+#include <ui/GraphicBuffer.h>
+
+namespace android {
+namespace {
+
+constexpr uint32_t kWidth = 64;
+constexpr uint32_t kHeight = 64;
+constexpr PixelFormat kFormat = HAL_PIXEL_FORMAT_RGBA_8888;
+constexpr uint64_t kUsage = GRALLOC_USAGE_SW_WRITE_OFTEN;
+
+struct NoopConsumer : public BnConsumerListener {
+    void onFrameAvailable(const BufferItem& /* item */) override {}
+    void onBuffersReleased() override {}
+    void onSidebandStreamChanged() override {}
+};
+
+// In-process producer and consumer ends of a freshly created BufferQueue,
+// with all buffer slots pre-allocated so the measured loop exercises slot
+// bookkeeping rather than gralloc.
+class BufferQueueFixture {
+public:
+    explicit BufferQueueFixture(int maxDequeuedBuffers) {
+        BufferQueue::createBufferQueue(&mProducer, &mConsumer);
+        mConsumer->consumerConnect(new NoopConsumer, false);
+
+        IGraphicBufferProducer::QueueBufferOutput output;
+        mProducer->connect(new DummyProducerListener, NATIVE_WINDOW_API_CPU, false, &output);
+        mProducer->setMaxDequeuedBufferCount(maxDequeuedBuffers);
+
+        std::vector<int> slots;
+        for (int i = 0; i < maxDequeuedBuffers; i++) {
+            int slot = BufferQueue::INVALID_BUFFER_SLOT;
+            sp<Fence> fence;
+            mProducer->dequeueBuffer(&slot, &fence, kWidth, kHeight, kFormat, kUsage, nullptr,
+                                     nullptr);
+            sp<GraphicBuffer> buffer;
+            mProducer->requestBuffer(slot, &buffer);
+            slots.push_back(slot);
+        }
+        for (int slot : slots) {
+            mProducer->cancelBuffer(slot, Fence::NO_FENCE);
+        }
+    }
+
+    sp<IGraphicBufferProducer> mProducer;
+    sp<IGraphicBufferConsumer> mConsumer;
+};
+
+// One full frame through the queue: dequeue, queue, acquire, release.
+void producerConsumerRoundTrip(benchmark::State& state) {
+    BufferQueueFixture fixture(state.range(0));
+
+    const IGraphicBufferProducer::QueueBufferInput input(0, false, HAL_DATASPACE_UNKNOWN,
+                                                         Rect(kWidth, kHeight),
+                                                         NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                                         Fence::NO_FENCE);
+    IGraphicBufferProducer::QueueBufferOutput output;
+    for (auto _ : state) {
+        int slot = BufferQueue::INVALID_BUFFER_SLOT;
+        sp<Fence> fence;
+        fixture.mProducer->dequeueBuffer(&slot, &fence, kWidth, kHeight, kFormat, kUsage, nullptr,
+                                         nullptr);
+        fixture.mProducer->queueBuffer(slot, input, &output);
+
+        BufferItem item;
+        fixture.mConsumer->acquireBuffer(&item, 0);
+        fixture.mConsumer->releaseBuffer(item.mSlot, item.mFrameNumber, Fence::NO_FENCE);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(producerConsumerRoundTrip)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(16);
+
+// The producer half alone, as hit by an app rendering ahead of the consumer.
+void dequeueCancel(benchmark::State& state) {
+    BufferQueueFixture fixture(state.range(0));
+
+    for (auto _ : state) {
+        int slot = BufferQueue::INVALID_BUFFER_SLOT;
+        sp<Fence> fence;
+        fixture.mProducer->dequeueBuffer(&slot, &fence, kWidth, kHeight, kFormat, kUsage, nullptr,
+                                         nullptr);
+        fixture.mProducer->cancelBuffer(slot, Fence::NO_FENCE);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(dequeueCancel)->Arg(2)->Arg(16);
+
+} // namespace
+} // namespace android
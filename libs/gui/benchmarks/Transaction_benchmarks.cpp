@@ -0,0 +1,163 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include <binder/Binder.h>
+#include <binder/Parcel.h>
+#include <gui/LayerState.h>
+#include <gui/SurfaceComposerClient.h>
+#include <gui/SurfaceControl.h>
+
+namespace android {
+namespace {
+
+using Transaction = SurfaceComposerClient::Transaction;
+
+// A SurfaceControl whose handle is a plain local binder. Transaction
+// mutators only key state off the handle, so this is enough to measure the
+// client-side cost without talking to SurfaceFlinger.
+sp<SurfaceControl> makeFakeSurfaceControl() {
+    return new SurfaceControl(nullptr, new BBinder(), nullptr);
+}
+
+std::vector<sp<SurfaceControl>> makeFakeSurfaceControls(size_t count) {
+    std::vector<sp<SurfaceControl>> controls;
+    controls.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        controls.push_back(makeFakeSurfaceControl());
+    }
+    return controls;
+}
+
+// Cost of building up a transaction touching N layers, as done by the window
+// manager on every animation frame.
+void transactionSetState(benchmark::State& state) {
+    const auto controls = makeFakeSurfaceControls(state.range(0));
+
+    for (auto _ : state) {
+        Transaction t;
+        float i = 0;
+        for (const auto& sc : controls) {
+            t.setPosition(sc, i, i);
+            t.setAlpha(sc, 0.5f);
+            t.setCrop_legacy(sc, Rect(0, 0, 100, 100));
+            i += 1;
+        }
+        benchmark::DoNotOptimize(t);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(transactionSetState)->Arg(1)->Arg(8)->Arg(64);
+
+// Cost of merging two N-layer transactions over disjoint layers.
+void transactionMerge(benchmark::State& state) {
+    const auto controlsA = makeFakeSurfaceControls(state.range(0));
+    const auto controlsB = makeFakeSurfaceControls(state.range(0));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        Transaction a;
+        Transaction b;
+        for (const auto& sc : controlsA) {
+            a.setPosition(sc, 1, 1);
+        }
+        for (const auto& sc : controlsB) {
+            b.setPosition(sc, 2, 2);
+        }
+        state.ResumeTiming();
+
+        a.merge(std::move(b));
+        benchmark::DoNotOptimize(a);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(transactionMerge)->Arg(1)->Arg(8)->Arg(64);
+
+// Serialization cost of a fully populated layer_state_t, which dominates the
+// parceling of large transactions.
+void layerStateWriteToParcel(benchmark::State& state) {
+    layer_state_t layerState;
+    layerState.surface = new BBinder();
+    layerState.what = layer_state_t::ePositionChanged | layer_state_t::eAlphaChanged |
+            layer_state_t::eCropChanged_legacy | layer_state_t::eMatrixChanged;
+    layerState.x = 1;
+    layerState.y = 2;
+    layerState.alpha = 0.5f;
+    layerState.crop_legacy = Rect(0, 0, 100, 100);
+
+    for (auto _ : state) {
+        Parcel parcel;
+        layerState.write(parcel);
+        benchmark::DoNotOptimize(parcel.dataSize());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(layerStateWriteToParcel);
+
+void layerStateReadFromParcel(benchmark::State& state) {
+    layer_state_t layerState;
+    layerState.surface = new BBinder();
+    layerState.what = layer_state_t::ePositionChanged | layer_state_t::eAlphaChanged;
+    layerState.x = 1;
+    layerState.y = 2;
+    layerState.alpha = 0.5f;
+
+    Parcel parcel;
+    layerState.write(parcel);
+
+    for (auto _ : state) {
+        parcel.setDataPosition(0);
+        layer_state_t out;
+        out.read(parcel);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(layerStateReadFromParcel);
+
+// End-to-end apply against the real SurfaceFlinger, measuring parceling plus
+// the binder hop. Requires a running SurfaceFlinger, so it is skipped when
+// the composer service is unreachable.
+void transactionApply(benchmark::State& state) {
+    sp<SurfaceComposerClient> client = new SurfaceComposerClient;
+    if (client->initCheck() != NO_ERROR) {
+        state.SkipWithError("SurfaceFlinger is not available");
+        return;
+    }
+
+    sp<SurfaceControl> control =
+            client->createSurface(String8("TransactionBenchmark"), 32, 32, PIXEL_FORMAT_RGBA_8888);
+    if (control == nullptr || !control->isValid()) {
+        state.SkipWithError("failed to create surface");
+        return;
+    }
+
+    float x = 0;
+    for (auto _ : state) {
+        Transaction t;
+        t.setPosition(control, x, x);
+        t.apply();
+        x = (x == 0) ? 1 : 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(transactionApply);
+
+} // namespace
+} // namespace android
@@ -100,9 +100,13 @@ private:
     std::mutex mMutex;
     std::condition_variable mCallbackCV;
 
-    // BufferQueue internally allows 1 more than
-    // the max to be acquired
-    static const int MAX_ACQUIRED_BUFFERS = 1;
+    // Number of frames the adapter may hold acquired while their
+    // transactions are in flight, configured from
+    // debug.blast.max_acquired_buffers. Values above 1 let clients queue
+    // frames ahead instead of stalling in onFrameAvailable on each
+    // transaction callback. BufferQueue internally allows 1 more than
+    // this to be acquired.
+    const int32_t mMaxAcquiredBuffers;
 
     int32_t mNumFrameAvailable GUARDED_BY(mMutex);
     int32_t mNumAcquired GUARDED_BY(mMutex);
@@ -72,6 +72,11 @@ public:
             const sp<Fence>& releaseFence, EGLDisplay display,
             EGLSyncKHR fence);
 
+    // See IGraphicBufferConsumer::releaseBuffers. Releases every slot under
+    // a single acquisition of the queue lock and wakes any waiting producer
+    // threads once, rather than once per buffer.
+    virtual status_t releaseBuffers(const std::vector<ReleaseItem>& items) override;
+
     // connect connects a consumer to the BufferQueue.  Only one
     // consumer may be connected, and when that consumer disconnects the
     // BufferQueue is placed into the "abandoned" state, causing most
@@ -20,6 +20,7 @@
 #include <gui/BufferItem.h>
 #include <gui/BufferQueueDefs.h>
 #include <gui/BufferSlot.h>
+#include <gui/BufferSlotSet.h>
 #include <gui/OccupancyTracker.h>
 
 #include <utils/NativeHandle.h>
@@ -130,6 +131,13 @@ private:
     // waitWhileAllocatingLocked blocks until mIsAllocating is false.
     void waitWhileAllocatingLocked(std::unique_lock<std::mutex>& lock) const;
 
+    // isQueueStuffedLocked returns true once the queue has reached the
+    // latency-optimal depth: the consumer can hold mMaxAcquiredBufferCount
+    // buffers and one more queued buffer keeps the pipeline primed, but any
+    // buffer queued beyond that only adds latency between queueing and
+    // presentation.
+    bool isQueueStuffedLocked() const;
+
 #if DEBUG_ONLY_CODE
     // validateConsistencyLocked ensures that the free lists are in sync with
     // the information stored in mSlots
@@ -201,8 +209,9 @@ private:
     Fifo mQueue;
 
     // mFreeSlots contains all of the slots which are FREE and do not currently
-    // have a buffer attached.
-    std::set<int> mFreeSlots;
+    // have a buffer attached. It is a bitset, so finding the lowest free slot
+    // on dequeue is a single find-first-set.
+    BufferSlotSet mFreeSlots;
 
     // mFreeBuffers contains all of the slots which are FREE and currently have
     // a buffer attached.
@@ -235,6 +244,28 @@ private:
     // mQueueBufferCanDrop is set.
     bool mLegacyBufferDrop;
 
+    // mStuffingRecoveryEnabled indicates whether the producer opted in to
+    // automatic buffer stuffing recovery via setStuffingRecovery. When set,
+    // queueBuffer may replace the last queued buffer once the queue is
+    // stuffed and that buffer's desired present time is already at or behind
+    // the present time the consumer last targeted.
+    bool mStuffingRecoveryEnabled;
+
+    // mQueueStuffed tracks whether the queue was stuffed the last time its
+    // occupancy changed. It is used to make the onQueueStuffed producer
+    // callback edge-triggered.
+    bool mQueueStuffed;
+
+    // mLastExpectedPresent is the expectedPresent timestamp most recently
+    // passed to acquireBuffer by the consumer, or 0 if the consumer never
+    // provided one. Queued buffers whose desired present time is at or behind
+    // this value can only be presented late.
+    nsecs_t mLastExpectedPresent;
+
+    // mStuffingRecoveryDropCount counts the buffers that queueBuffer replaced
+    // because of stuffing recovery, for debugging.
+    uint64_t mStuffingRecoveryDropCount;
+
     // mDefaultBufferFormat can be set so it will override the buffer format
     // when it isn't specified in dequeueBuffer.
     PixelFormat mDefaultBufferFormat;
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_GUI_BUFFERSLOTSET_H
+#define ANDROID_GUI_BUFFERSLOTSET_H
+
+#include <stdint.h>
+
+#include <cstddef>
+
+#include <gui/BufferQueueDefs.h>
+
+namespace android {
+
+// BufferSlotSet is a drop-in replacement for the std::set<int> that
+// BufferQueueCore used to track FREE buffer slots. Membership is a single
+// 64-bit mask, so insert/erase/count are O(1) bit operations and picking the
+// lowest free slot is a find-first-set instead of a tree walk on every
+// dequeue. Iteration visits slots in ascending order, matching std::set.
+class BufferSlotSet {
+    static_assert(BufferQueueDefs::NUM_BUFFER_SLOTS <= 64,
+                  "BufferSlotSet can only track up to 64 slots");
+
+public:
+    // Iterates over the set bits, lowest slot first. The iterator holds the
+    // not-yet-visited bits, so end() is simply the empty mask.
+    class const_iterator {
+    public:
+        explicit const_iterator(uint64_t bits) : mBits(bits) {}
+        int operator*() const { return __builtin_ctzll(mBits); }
+        const_iterator& operator++() {
+            mBits &= mBits - 1; // clear the lowest set bit
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const { return mBits == other.mBits; }
+        bool operator!=(const const_iterator& other) const { return mBits != other.mBits; }
+
+    private:
+        uint64_t mBits;
+    };
+
+    void insert(int slot) { mBits |= 1ULL << slot; }
+    void erase(int slot) { mBits &= ~(1ULL << slot); }
+    void erase(const_iterator it) { erase(*it); }
+    void clear() { mBits = 0; }
+
+    size_t count(int slot) const { return (mBits >> slot) & 1; }
+    bool empty() const { return mBits == 0; }
+    size_t size() const { return static_cast<size_t>(__builtin_popcountll(mBits)); }
+
+    const_iterator begin() const { return const_iterator(mBits); }
+    const_iterator end() const { return const_iterator(0); }
+
+private:
+    uint64_t mBits = 0;
+};
+
+} // namespace android
+
+#endif
@@ -19,11 +19,15 @@
 
 #include <system/window.h>
 
+#include <gui/BufferItem.h>
 #include <gui/ConsumerBase.h>
 #include <gui/BufferQueue.h>
 
+#include <utils/Condition.h>
 #include <utils/Vector.h>
 
+#include <thread>
+
 
 namespace android {
 
@@ -94,6 +98,16 @@ class CpuConsumer : public ConsumerBase
     CpuConsumer(const sp<IGraphicBufferConsumer>& bq,
             size_t maxLockedBuffers, bool controlledByApp = false);
 
+    ~CpuConsumer() override;
+
+    // Controls the async prefetch mode. When enabled, a worker thread
+    // acquires the next pending buffer and performs the gralloc lock,
+    // including the fence wait, ahead of time, so that in steady state
+    // lockNextBuffer is a handoff of an already-mapped buffer instead of
+    // blocking the caller on fence wait and mapping. The worker thread is
+    // started on the first enable and lives until the consumer is destroyed.
+    void setPrefetchEnabled(bool enabled);
+
     // Gets the next graphics buffer from the producer and locks it for CPU use,
     // filling out the passed-in locked buffer structure with the native pointer
     // and metadata. Returns BAD_VALUE if no new buffer is available, and
@@ -142,10 +156,32 @@ class CpuConsumer : public ConsumerBase
 
     status_t lockBufferItem(const BufferItem& item, LockedBuffer* outBuffer) const;
 
+    // From ConsumerBase; wakes the prefetch thread when a new frame arrives
+    virtual void onFrameAvailable(const BufferItem& item) override;
+
+    // Main loop of the prefetch thread; performs the gralloc lock of the
+    // next pending buffer with mMutex dropped
+    void prefetchThreadLoop();
+
+    // Unmaps and releases a prefetched buffer that will not be handed out
+    void releasePrefetchedBufferLocked();
+
     Vector<AcquiredBuffer> mAcquiredBuffers;
 
     // Count of currently locked buffers
     size_t mCurrentLockedBuffers;
+
+    // Async prefetch state, guarded by mMutex. At most one buffer is
+    // prefetched ahead of the consumer; mPrefetchInFlight is true while the
+    // thread is fence-waiting/mapping with mMutex dropped.
+    bool mPrefetchEnabled;
+    bool mPrefetchRunning;
+    bool mPrefetchInFlight;
+    bool mPrefetchedValid;
+    BufferItem mPrefetchedItem;
+    LockedBuffer mPrefetchedBuffer;
+    Condition mPrefetchCondition;
+    std::thread mPrefetchThread;
 };
 
 } // namespace android
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <ui/DisplayConfig.h>
+#include <ui/PhysicalDisplayId.h>
+
+namespace android {
+
+// Layout of the shared-memory table in which SurfaceFlinger publishes the
+// configs and active config of every physical display, so that clients can
+// answer getDisplayConfigs/getActiveConfig with a local memory read instead
+// of a binder call. The table is mapped read-only into clients via
+// ISurfaceComposer::getDisplayConfigTable.
+//
+// Writers (SurfaceFlinger's main thread) are serialized externally and use
+// seq as a seqlock: it is incremented to an odd value before the payload is
+// rewritten and to an even value afterwards. Readers copy the payload out and
+// retry if seq was odd or changed across the copy, falling back to the binder
+// call if the table stays unstable. Config changes are announced through the
+// existing hotplug and config-changed events on the display event channel, so
+// no extra notification mechanism is needed.
+struct DisplayConfigTable {
+    // Bump whenever the layout below changes. Clients ignore tables whose
+    // version they do not recognize and use the binder path instead.
+    static constexpr uint32_t kVersion = 1;
+
+    static constexpr size_t kMaxDisplays = 8;
+    static constexpr size_t kMaxConfigs = 32;
+
+    struct Display {
+        PhysicalDisplayId displayId;
+        int32_t activeConfig;
+        uint32_t numConfigs;
+        DisplayConfig configs[kMaxConfigs];
+    };
+
+    uint32_t version;
+    std::atomic<uint32_t> seq;
+    uint32_t numDisplays;
+    Display displays[kMaxDisplays];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+} // namespace android
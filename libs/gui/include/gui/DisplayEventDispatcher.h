@@ -35,6 +35,16 @@ public:
     int getFd() const;
     virtual int handleEvent(int receiveFd, int events, void* data);
 
+    // Expected present time of the most recently dispatched vsync, or 0 if no
+    // vsync has been dispatched yet. Only meaningful on the dispatch thread.
+    nsecs_t getLastVsyncExpectedPresentTime() const { return mLastVsyncExpectedPresentTime; }
+    // Deadline of the most recently dispatched vsync: the time by which the
+    // frame must be submitted to be presented on time.
+    nsecs_t getLastVsyncDeadline() const { return mLastVsyncDeadline; }
+    // Time remaining until the last vsync's deadline; negative once the frame
+    // is already late. Lets callers skip non-critical work when over budget.
+    nsecs_t getVsyncBudgetRemaining() const;
+
 protected:
     virtual ~DisplayEventDispatcher() = default;
 
@@ -42,6 +52,8 @@ private:
     sp<Looper> mLooper;
     DisplayEventReceiver mReceiver;
     bool mWaitingForVsync;
+    nsecs_t mLastVsyncExpectedPresentTime = 0;
+    nsecs_t mLastVsyncDeadline = 0;
 
     virtual void dispatchVsync(nsecs_t timestamp, PhysicalDisplayId displayId, uint32_t count) = 0;
     virtual void dispatchHotplug(nsecs_t timestamp, PhysicalDisplayId displayId,
@@ -67,6 +67,9 @@ public:
         struct VSync {
             uint32_t count;
             nsecs_t expectedVSyncTimestamp;
+            // Time by which the frame must be submitted for it to be
+            // presented at expectedVSyncTimestamp.
+            nsecs_t deadlineTimestamp;
         };
 
         struct Hotplug {
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <utils/Flattenable.h>
+
+namespace android {
+
+// Variadic companions to FlattenableUtils for the POD section of a wire
+// type. Writing a packed run of fields through a single fold hands the
+// compiler one contiguous series of fixed-size copies, which it merges into
+// a block copy instead of emitting a bounds-checked write per field. The
+// wire format is unchanged: fields are packed in argument order, exactly as
+// the equivalent sequence of FlattenableUtils::write calls.
+//
+// The in-memory structs cannot simply be memcpy'd as a whole: their layout
+// has padding and the wire format has none. The field list spelled out at
+// each call site is the layout descriptor.
+class FlattenableHelpers {
+public:
+    template <typename... T>
+    static void write(void*& buffer, size_t& size, const T&... values) {
+        (FlattenableUtils::write(buffer, size, values), ...);
+    }
+
+    template <typename... T>
+    static void read(void const*& buffer, size_t& size, T&... values) {
+        (FlattenableUtils::read(buffer, size, values), ...);
+    }
+};
+
+} // namespace android
@@ -28,6 +28,8 @@
 
 #include <utils/Errors.h>
 
+#include <vector>
+
 namespace android {
 
 class BufferItem;
@@ -148,6 +150,32 @@ public:
     // as we can finally finish converting away from EGL sync to native Android sync
     using ReleaseBuffer = decltype(&IGraphicBufferConsumer::releaseHelper);
 
+    // A single entry of a batched release, see releaseBuffers below.
+    struct ReleaseItem {
+        int slot;
+        uint64_t frameNumber;
+        sp<Fence> releaseFence;
+    };
+
+    // releaseBuffers is the batched equivalent of releaseBuffer, for consumers
+    // that hand several buffers back at once (e.g. after a composited frame
+    // has been presented). Every entry is processed even if an earlier one
+    // fails; the first non-NO_ERROR status encountered is returned.
+    //
+    // The default implementation just loops over releaseBuffer.
+    // BufferQueueConsumer overrides it to update all slots under a single
+    // acquisition of the queue lock with a single producer wakeup.
+    virtual status_t releaseBuffers(const std::vector<ReleaseItem>& items) {
+        status_t result = NO_ERROR;
+        for (const ReleaseItem& item : items) {
+            const status_t err = releaseHelper(item.slot, item.frameNumber, item.releaseFence);
+            if (err != NO_ERROR && result == NO_ERROR) {
+                result = err;
+            }
+        }
+        return result;
+    }
+
     // consumerConnect connects a consumer to the BufferQueue. Only one consumer may be connected,
     // and when that consumer disconnects the BufferQueue is placed into the "abandoned" state,
     // causing most interactions with the BufferQueue by the producer to fail. controlledByApp
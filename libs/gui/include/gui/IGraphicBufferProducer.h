@@ -218,6 +218,22 @@ public:
                                    PixelFormat format, uint64_t usage, uint64_t* outBufferAge,
                                    FrameEventHistoryDelta* outTimestamps) = 0;
 
+    // dequeueWithBuffer is equivalent to calling dequeueBuffer and, when the
+    // returned flags include BUFFER_NEEDS_REALLOCATION, requestBuffer on the
+    // dequeued slot, but does both in a single binder transaction. outBuffer
+    // is set only when the slot's contents changed and must be (re)mirrored;
+    // otherwise it is cleared and the client's existing mirror of the slot
+    // remains valid. If fetching the buffer fails the dequeued slot is
+    // cancelled before the error is returned, so on any error the caller
+    // owns no slot.
+    //
+    // The default implementation issues the two calls separately, so remotes
+    // that predate this method keep working at the old cost.
+    virtual status_t dequeueWithBuffer(int* slot, sp<Fence>* fence, uint32_t w, uint32_t h,
+                                       PixelFormat format, uint64_t usage,
+                                       sp<GraphicBuffer>* outBuffer, uint64_t* outBufferAge,
+                                       FrameEventHistoryDelta* outTimestamps);
+
     // detachBuffer attempts to remove all ownership of the buffer in the given
     // slot from the buffer queue. If this call succeeds, the slot will be
     // freed, and there will be no way to obtain the buffer from this interface.
@@ -639,6 +655,51 @@ public:
     // the width and height used for dequeueBuffer will be additionally swapped.
     virtual status_t setAutoPrerotation(bool autoPrerotation);
 
+    // Enable/disable automatic buffer stuffing recovery for this queue.
+    //
+    // When enabled, queueBuffer may replace the last queued buffer with the
+    // incoming one -- even if the queue is not in a mode that normally drops
+    // buffers -- once the queue has reached the latency-optimal depth and that
+    // buffer's desired present time is already at or behind the present time
+    // the consumer most recently targeted in acquireBuffer. This keeps a
+    // producer that runs ahead of the consumer (e.g. a video decoder) from
+    // accumulating stale frames that would only be presented late. Buffers
+    // with auto-generated timestamps are never dropped this way.
+    virtual status_t setStuffingRecovery(bool enable);
+
+    // A set of producer attribute changes staged by the client and applied
+    // together by applyPendingAttributes. Each attribute is only applied when
+    // its corresponding "has" flag is set.
+    struct PendingAttributes {
+        bool hasMaxDequeuedBufferCount = false;
+        int maxDequeuedBufferCount = 0;
+        bool hasAsyncMode = false;
+        bool asyncMode = false;
+        bool hasSharedBufferMode = false;
+        bool sharedBufferMode = false;
+        bool hasAutoRefresh = false;
+        bool autoRefresh = false;
+        bool hasAutoPrerotation = false;
+        bool autoPrerotation = false;
+        bool hasDequeueTimeout = false;
+        nsecs_t dequeueTimeout = -1;
+
+        bool any() const {
+            return hasMaxDequeuedBufferCount || hasAsyncMode || hasSharedBufferMode ||
+                    hasAutoRefresh || hasAutoPrerotation || hasDequeueTimeout;
+        }
+    };
+
+    // Applies a batch of staged attribute changes in one call, in the order
+    // the fields are declared above, stopping at the first failure.
+    //
+    // The base implementation simply fans out to the individual setters, so
+    // every producer supports this; the binder proxy overrides it to carry
+    // the whole batch in a single transaction. This lets a client that
+    // reconfigures several attributes back to back (see Surface attribute
+    // staging) pay for one round trip instead of one per attribute.
+    virtual status_t applyPendingAttributes(const PendingAttributes& attributes);
+
 #ifndef NO_BINDER
     // Static method exports any IGraphicBufferProducer object to a parcel. It
     // handles null producer as well.
@@ -49,6 +49,12 @@ public:
     // onBuffersFreed is called from IGraphicBufferConsumer::discardFreeBuffers
     // to notify the producer that certain free buffers are discarded by the consumer.
     virtual void onBuffersDiscarded(const std::vector<int32_t>& slots) = 0; // Asynchronous
+    // onQueueStuffed is called from IGraphicBufferProducer::queueBuffer when
+    // the queue reaches the latency-optimal depth, to tell a producer that is
+    // running ahead of the consumer to pace itself: any further buffers it
+    // queues will only add latency before they are presented. The default
+    // implementation ignores the signal.
+    virtual void onQueueStuffed(uint64_t /*queuedCount*/) {} // Asynchronous
 };
 
 #ifndef NO_BINDER
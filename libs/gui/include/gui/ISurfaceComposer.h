@@ -19,6 +19,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <android-base/unique_fd.h>
+
 #include <binder/IBinder.h>
 #include <binder/IInterface.h>
 
@@ -48,15 +50,18 @@ namespace android {
 
 struct client_cache_t;
 struct ComposerState;
+struct CompositionStats;
 struct DisplayConfig;
 struct DisplayInfo;
 struct DisplayStatInfo;
 struct DisplayState;
 struct InputWindowCommands;
+class Fence;
 class LayerDebugInfo;
 class HdrCapabilities;
 class IDisplayEventConnection;
 class IGraphicBufferProducer;
+class IMemoryHeap;
 class ISurfaceComposerClient;
 class IRegionSamplingListener;
 class Rect;
@@ -183,6 +188,11 @@ public:
     virtual status_t getDisplayStats(const sp<IBinder>& display,
             DisplayStatInfo* stats) = 0;
 
+    /* returns the per-stage composition timing histograms accumulated by
+     * SurfaceFlinger since boot. The stats are recorded unconditionally, so
+     * this is safe to poll in production without enabling tracing. */
+    virtual status_t getCompositionStats(CompositionStats* outStats) = 0;
+
     /**
      * Get transactional state of given display.
      */
@@ -198,6 +208,14 @@ public:
      */
     virtual status_t getDisplayConfigs(const sp<IBinder>& display, Vector<DisplayConfig>*) = 0;
 
+    /**
+     * Get the shared-memory heap holding the DisplayConfigTable, which
+     * publishes the configs and active config of every physical display so
+     * that clients can read them without further binder calls. The heap is
+     * mapped read-only into the caller.
+     */
+    virtual status_t getDisplayConfigTable(sp<IMemoryHeap>* outHeap) = 0;
+
     /**
      * Get the index into configurations returned by getDisplayConfigs,
      * corresponding to the active configuration.
@@ -272,6 +290,23 @@ public:
                                    uint32_t reqWidth, uint32_t reqHeight, bool useIdentityTransform,
                                    ui::Rotation rotation = ui::ROTATION_0,
                                    bool captureSecureLayers = false) = 0;
+    /**
+     * Like captureScreen, but returns as soon as the render has been queued
+     * to the GPU, without blocking on its completion. outFence signals when
+     * the contents of outBuffer are ready to be read.
+     *
+     * The returned buffer is recycled through a small server-side pool, so it
+     * is only guaranteed to hold this capture until a few subsequent captures
+     * have been requested. Callers should consume or copy out of the buffer
+     * promptly after the fence signals.
+     */
+    virtual status_t captureScreenAsync(const sp<IBinder>& display, sp<GraphicBuffer>* outBuffer,
+                                        sp<Fence>* outFence, bool& outCapturedSecureLayers,
+                                        ui::Dataspace reqDataspace, ui::PixelFormat reqPixelFormat,
+                                        const Rect& sourceCrop, uint32_t reqWidth,
+                                        uint32_t reqHeight, bool useIdentityTransform,
+                                        ui::Rotation rotation = ui::ROTATION_0,
+                                        bool captureSecureLayers = false) = 0;
     /**
      * Capture the specified screen. This requires READ_FRAME_BUFFER
      * permission.  This function will fail if there is a secure window on
@@ -540,6 +575,29 @@ public:
      * for tests. Release the token by releasing the returned IBinder reference.
      */
     virtual status_t acquireFrameRateFlexibilityToken(sp<IBinder>* outToken) = 0;
+
+    /*
+     * Sets the thermal headroom hint used to bias refresh rate selection. A headroom of
+     * 1.0 means no thermal pressure; as it approaches 0.0, SurfaceFlinger progressively
+     * prefers lower refresh rates within the current policy, rather than clamping to a
+     * hard cap. The value is clamped to [0.0, 1.0].
+     *
+     * Requires the ACCESS_SURFACE_FLINGER permission.
+     */
+    virtual status_t setThermalRefreshRateHeadroom(float headroom) = 0;
+
+    /*
+     * Returns a read-only shared memory region, laid out as a DisplayedContentSampleStream,
+     * into which SurfaceFlinger republishes the display's color histogram after every
+     * composited frame. This lets clients poll histograms without a binder round trip per
+     * sample; use getDisplayedContentSample for one-shot or time-windowed queries.
+     * Sampling must be enabled with setDisplayContentSamplingEnabled for the region to
+     * update. Repeated calls for the same display return the same region.
+     *
+     * Requires the ACCESS_SURFACE_FLINGER permission.
+     */
+    virtual status_t getDisplayedContentSampleStream(const sp<IBinder>& display,
+                                                     base::unique_fd* outFd) = 0;
 };
 
 // ----------------------------------------------------------------------------
@@ -599,6 +657,11 @@ public:
         SET_GAME_CONTENT_TYPE,
         SET_FRAME_RATE,
         ACQUIRE_FRAME_RATE_FLEXIBILITY_TOKEN,
+        CAPTURE_SCREEN_ASYNC,
+        GET_COMPOSITION_STATS,
+        GET_DISPLAY_CONFIG_TABLE,
+        SET_THERMAL_REFRESH_RATE_HEADROOM,
+        GET_DISPLAYED_CONTENT_SAMPLE_STREAM,
         // Always append new enum to the end.
     };
 
@@ -17,11 +17,13 @@
 #pragma once
 
 #include <binder/IInterface.h>
+#include <binder/Parcelable.h>
 #include <binder/SafeInterface.h>
 #include <gui/LayerMetadata.h>
 #include <ui/PixelFormat.h>
 
 #include <unordered_map>
+#include <vector>
 
 namespace android {
 
@@ -51,6 +53,33 @@ public:
         eFXSurfaceMask = 0x000F0000,
     };
 
+    // One surface's creation arguments for createSurfaces()
+    struct SurfaceCreationArgs : public Parcelable {
+        String8 name;
+        uint32_t w = 0;
+        uint32_t h = 0;
+        PixelFormat format = PIXEL_FORMAT_NONE;
+        uint32_t flags = 0;
+        sp<IBinder> parent;
+        LayerMetadata metadata;
+
+        status_t writeToParcel(Parcel* parcel) const override;
+        status_t readFromParcel(const Parcel* parcel) override;
+    };
+
+    // One surface's creation outcome from createSurfaces(). Entries are
+    // parallel to the creation arguments; a failed entry carries its error
+    // code and null handles.
+    struct SurfaceCreationResult : public Parcelable {
+        int32_t result = 0;
+        sp<IBinder> handle;
+        sp<IGraphicBufferProducer> gbp;
+        uint32_t transformHint = 0;
+
+        status_t writeToParcel(Parcel* parcel) const override;
+        status_t readFromParcel(const Parcel* parcel) override;
+    };
+
     /*
      * Requires ACCESS_SURFACE_FLINGER permission
      */
@@ -59,6 +88,16 @@ public:
                                    LayerMetadata metadata, sp<IBinder>* handle,
                                    sp<IGraphicBufferProducer>* gbp, uint32_t* outTransformHint) = 0;
 
+    /*
+     * Creates a batch of surfaces in a single binder transaction. The overall
+     * status only reports transport problems; per-surface outcomes are
+     * returned in outResults, parallel to args.
+     *
+     * Requires ACCESS_SURFACE_FLINGER permission
+     */
+    virtual status_t createSurfaces(const std::vector<SurfaceCreationArgs>& args,
+                                    std::vector<SurfaceCreationResult>* outResults) = 0;
+
     /*
      * Requires ACCESS_SURFACE_FLINGER permission
      */
@@ -148,6 +148,10 @@ struct layer_state_t {
     void merge(const layer_state_t& other);
     status_t write(Parcel& output) const;
     status_t read(const Parcel& input);
+    // Returns a slightly conservative estimate of the flattened size of this
+    // state, used to reserve Parcel capacity up front so that flattening a
+    // whole transaction grows the Parcel at most once.
+    size_t getApproximateSize() const;
 
     struct matrix22_t {
         float dsdx{0};
@@ -184,6 +184,22 @@ public:
 
     status_t setFrameRate(float frameRate, int8_t compatibility);
 
+    // Returns a prediction of the age the next dequeued buffer will report, so a
+    // client can plan its partial-render strategy while the previous frame is still
+    // in flight instead of waiting for dequeueBuffer to learn the real age.  The
+    // prediction is the last observed age once two consecutive dequeues agree (the
+    // steady state of a buffer rotation); 0 means no confident prediction and the
+    // client should plan for a full redraw.  The age reported by the next dequeue
+    // remains authoritative.
+    uint64_t getPredictedBufferAge();
+
+    // Returns the union of the damage passed to setSurfaceDamage for the last
+    // (bufferAge - 1) queued frames, i.e. the region a partial renderer must redraw
+    // on top of the current frame's damage when rendering into a buffer of that age.
+    // Returns INVALID_REGION (meaning "redraw everything") when bufferAge is 0 or
+    // exceeds the recorded history, or when any frame in range had full damage.
+    Region getAccumulatedDamage(uint64_t bufferAge);
+
 protected:
     virtual ~Surface();
 
@@ -304,6 +320,18 @@ public:
     virtual int setSharedBufferMode(bool sharedBufferMode);
     virtual int setAutoRefresh(bool autoRefresh);
     virtual int setAutoPrerotation(bool autoPrerotation);
+    virtual int setStuffingRecovery(bool enable);
+
+    // When attribute staging is enabled, the producer-side attribute setters
+    // (setMaxDequeuedBufferCount, setAsyncMode, setSharedBufferMode,
+    // setAutoRefresh, setAutoPrerotation, setDequeueTimeout) validate and
+    // record the requested value locally instead of issuing a binder call
+    // each, and all pending changes are committed in a single producer call
+    // at the next dequeueBuffer. Disabling staging commits any still-pending
+    // changes immediately. This collapses the burst of transactions a client
+    // otherwise generates when it reconfigures a surface.
+    virtual int setAttributeStaging(bool enable);
+
     virtual int setBuffersDimensions(uint32_t width, uint32_t height);
     virtual int lock(ANativeWindow_Buffer* outBuffer, ARect* inOutDirtyBounds);
     virtual int unlockAndPost();
@@ -504,6 +532,19 @@ protected:
     // buffer as the number of frames that have elapsed since it was last queued
     uint64_t mBufferAge;
 
+    // The age reported by the dequeue before the most recent one; when it matches
+    // mBufferAge the rotation is in steady state and getPredictedBufferAge reports
+    // that value for the next frame.
+    uint64_t mPreviousBufferAge = 0;
+
+    // Ring of the damage regions of the most recently queued frames, newest at
+    // (mDamageHistoryHead - 1); consumed by getAccumulatedDamage.  A frame queued
+    // with full damage is recorded as INVALID_REGION.
+    static constexpr size_t kDamageHistoryDepth = 8;
+    Region mDamageHistory[kDamageHistoryDepth];
+    size_t mDamageHistoryHead = 0;
+    size_t mDamageHistoryCount = 0;
+
     // Stores the current generation number. See setGenerationNumber and
     // IGraphicBufferProducer::setGenerationNumber for more information.
     uint32_t mGenerationNumber;
@@ -513,6 +554,18 @@ protected:
     bool mAutoRefresh;
     bool mAutoPrerotation;
 
+    // When true, the producer-side attribute setters stage their values into
+    // mPendingAttributes instead of each issuing a producer call; the batch
+    // is committed by flushPendingAttributes at the next dequeueBuffer. See
+    // setAttributeStaging.
+    bool mAttributeStaging;
+    IGraphicBufferProducer::PendingAttributes mPendingAttributes;
+
+    // Commits mPendingAttributes, if any, in a single producer call and
+    // updates the cached values above on success.
+    status_t flushPendingAttributes();
+    status_t flushPendingAttributesLocked();
+
     // If in shared buffer mode and auto refresh is enabled, store the shared
     // buffer slot and return it for all calls to queue/dequeue without going
     // over Binder.
@@ -22,6 +22,7 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include <android-base/unique_fd.h>
 #include <binder/IBinder.h>
 
 #include <utils/RefBase.h>
@@ -247,6 +248,18 @@ public:
     static status_t setGlobalShadowSettings(const half4& ambientColor, const half4& spotColor,
                                             float lightPosY, float lightPosZ, float lightRadius);
 
+    /*
+     * Sets the thermal headroom hint used to bias refresh rate selection. A headroom of
+     * 1.0 means no thermal pressure; as it approaches 0.0, SurfaceFlinger progressively
+     * prefers lower refresh rates within the current policy.
+     *
+     * headroom
+     *      Thermal headroom in [0.0, 1.0].
+     *
+     * Returns NO_ERROR upon success.
+     */
+    static status_t setThermalRefreshRateHeadroom(float headroom);
+
     // ------------------------------------------------------------------------
     // surface creation / destruction
 
@@ -272,6 +285,12 @@ public:
                                   LayerMetadata metadata = LayerMetadata(), // metadata
                                   uint32_t* outTransformHint = nullptr);
 
+    //! Create a batch of surfaces with a single binder transaction. The
+    //! returned vector is parallel to the arguments; entries whose creation
+    //! failed are null.
+    status_t createSurfaces(const std::vector<ISurfaceComposerClient::SurfaceCreationArgs>& args,
+                            std::vector<sp<SurfaceControl>>* outSurfaces);
+
     //! Create a surface
     sp<SurfaceControl> createWithSurfaceParent(const String8& name,       // name of the surface
                                                uint32_t w,                // width in pixel
@@ -378,6 +397,7 @@ public:
 
         void cacheBuffers();
         void registerSurfaceControlForCallback(const sp<SurfaceControl>& sc);
+        bool maybeBatch(bool synchronous);
 
     public:
         Transaction() = default;
@@ -394,6 +414,27 @@ public:
         void clear();
 
         status_t apply(bool synchronous = false);
+
+        // Like apply(), but additionally returns a fence fd that becomes
+        // readable (POLLIN) once SurfaceFlinger has latched the transaction.
+        // This provides the ordering of a synchronous apply without blocking
+        // a binder thread: callers wait on the fd with poll/epoll instead.
+        // On error no fence is returned.
+        status_t applyWithCommitFence(base::unique_fd* outCommitFence);
+
+        // Batching mode.  While enabled, apply() merges this Transaction
+        // into a process-wide pending Transaction instead of issuing one
+        // setTransactionState binder call per apply.  The pending state is
+        // flushed in a single call when a synchronous Transaction is
+        // applied, when an apply lands after the batching window has
+        // elapsed, or when flushBatch() is called explicitly (typically
+        // once per frame by the animation driver).  Ordering of applies
+        // from this process is preserved.
+        static void enableBatching(nsecs_t windowNs);
+        // Flushes any pending state before turning batching off.
+        static void disableBatching();
+        // Sends the pending batched state now, if any.
+        static status_t flushBatch();
         // Merge another transaction in to this one, clearing other
         // as if it had been applied.
         Transaction& merge(Transaction&& other);
@@ -575,6 +616,8 @@ public:
 
     static status_t getDisplayedContentSample(const sp<IBinder>& display, uint64_t maxFrames,
                                               uint64_t timestamp, DisplayedFrameStats* outStats);
+    static status_t getDisplayedContentSampleStream(const sp<IBinder>& display,
+                                                    base::unique_fd* outFd);
     static status_t addRegionSamplingListener(const Rect& samplingArea,
                                               const sp<IBinder>& stopLayerHandle,
                                               const sp<IRegionSamplingListener>& listener);
@@ -603,6 +646,15 @@ public:
                             ui::PixelFormat reqPixelFormat, const Rect& sourceCrop,
                             uint32_t reqWidth, uint32_t reqHeight, bool useIdentityTransform,
                             ui::Rotation rotation, sp<GraphicBuffer>* outBuffer);
+    // Returns without waiting for the render to complete. outFence signals when
+    // outBuffer is ready to be read; the buffer is recycled by the server after
+    // a few subsequent captures, so consume it promptly.
+    static status_t captureAsync(const sp<IBinder>& display, ui::Dataspace reqDataSpace,
+                                 ui::PixelFormat reqPixelFormat, const Rect& sourceCrop,
+                                 uint32_t reqWidth, uint32_t reqHeight, bool useIdentityTransform,
+                                 ui::Rotation rotation, bool captureSecureLayers,
+                                 sp<GraphicBuffer>* outBuffer, sp<Fence>* outFence,
+                                 bool& outCapturedSecureLayers);
     static status_t capture(uint64_t displayOrLayerStack, ui::Dataspace* outDataspace,
                             sp<GraphicBuffer>* outBuffer);
     static status_t captureLayers(const sp<IBinder>& layerHandle, ui::Dataspace reqDataSpace,
@@ -20,6 +20,8 @@
 #include <binder/Parcelable.h>
 #include <utils/Errors.h>
 
+#include <vector>
+
 namespace android {
 
 class Parcel;
@@ -67,8 +69,10 @@ public:
         return sendObjects(tube, events, count, sizeof(T));
     }
 
-    // receive objects (sized blobs). If the receiving buffer isn't large enough, excess messages
-    // are silently discarded.
+    // receive objects (sized blobs). Several queued messages may be drained with a single
+    // syscall; messages that don't fit are kept for the next call, so no objects are lost.
+    // If a single message is larger than the receiving buffer, its excess data is silently
+    // discarded.
     template <typename T>
     static ssize_t recvObjects(BitTube* tube, T* events, size_t count) {
         return recvObjects(tube, events, count, sizeof(T));
@@ -91,6 +95,15 @@ private:
     mutable base::unique_fd mSendFd;
     mutable base::unique_fd mReceiveFd;
 
+    // Scratch space for batched receives. Messages land here before being compacted into the
+    // caller's buffer. Only touched from the receiving thread, like mReceiveFd itself.
+    std::vector<char> mRecvBuffer;
+
+    // Messages a batched receive pulled off the socket but could not fit into that call's
+    // buffer. Served before any new socket data on the next receive.
+    std::vector<char> mSpillover;
+    size_t mSpilloverStart = 0;
+
     static ssize_t sendObjects(BitTube* tube, void const* events, size_t count, size_t objSize);
 
     static ssize_t recvObjects(BitTube* tube, void* events, size_t count, size_t objSize);
@@ -217,6 +217,177 @@ TEST_F(BufferQueueTest, AcquireBuffer_ExceedsMaxAcquireCount_Fails) {
     ASSERT_EQ(INVALID_OPERATION, mConsumer->acquireBuffer(&item, 0));
 }
 
+TEST_F(BufferQueueTest, ReleaseBuffers_ReleasesAllBuffersInOneCall) {
+    createBufferQueue();
+    sp<DummyConsumer> dc(new DummyConsumer);
+    mConsumer->consumerConnect(dc, false);
+    IGraphicBufferProducer::QueueBufferOutput qbo;
+    mProducer->connect(new DummyProducerListener, NATIVE_WINDOW_API_CPU, false,
+            &qbo);
+    mProducer->setMaxDequeuedBufferCount(3);
+
+    int slot;
+    sp<Fence> fence;
+    sp<GraphicBuffer> buf;
+    IGraphicBufferProducer::QueueBufferInput qbi(0, false,
+            HAL_DATASPACE_UNKNOWN, Rect(0, 0, 1, 1),
+            NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+    BufferItem item;
+
+    std::vector<IGraphicBufferConsumer::ReleaseItem> items;
+    for (int i = 0; i < 2; i++) {
+        ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+                  mProducer->dequeueBuffer(&slot, &fence, 1, 1, 0, GRALLOC_USAGE_SW_READ_OFTEN,
+                                           nullptr, nullptr));
+        ASSERT_EQ(OK, mProducer->requestBuffer(slot, &buf));
+        ASSERT_EQ(OK, mProducer->queueBuffer(slot, qbi, &qbo));
+        ASSERT_EQ(OK, mConsumer->acquireBuffer(&item, 0));
+        items.push_back({item.mSlot, item.mFrameNumber, Fence::NO_FENCE});
+    }
+
+    ASSERT_EQ(OK, mConsumer->releaseBuffers(items));
+
+    // Both buffers went back to the free list, so the producer can dequeue
+    // them again.
+    for (int i = 0; i < 2; i++) {
+        ASSERT_EQ(OK, mProducer->dequeueBuffer(&slot, &fence, 1, 1, 0,
+                                               GRALLOC_USAGE_SW_READ_OFTEN, nullptr, nullptr));
+    }
+
+    // Releasing the same entries again must fail: the slots are no longer
+    // acquired.
+    ASSERT_EQ(BAD_VALUE, mConsumer->releaseBuffers(items));
+}
+
+TEST_F(BufferQueueTest, StuffingRecovery_ReplacesStaleFrames) {
+    createBufferQueue();
+    sp<DummyConsumer> dc(new DummyConsumer);
+    mConsumer->consumerConnect(dc, false);
+    IGraphicBufferProducer::QueueBufferOutput qbo;
+    mProducer->connect(new DummyProducerListener, NATIVE_WINDOW_API_CPU, false,
+            &qbo);
+    mProducer->setMaxDequeuedBufferCount(3);
+    ASSERT_EQ(OK, mProducer->setStuffingRecovery(true));
+
+    int slot;
+    sp<Fence> fence;
+    sp<GraphicBuffer> buf;
+    BufferItem item;
+
+    const auto queueFrame = [&](nsecs_t timestamp,
+                                IGraphicBufferProducer::QueueBufferOutput* output) {
+        IGraphicBufferProducer::QueueBufferInput qbi(timestamp, false /* isAutoTimestamp */,
+                HAL_DATASPACE_UNKNOWN, Rect(0, 0, 1, 1),
+                NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+        ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+                  mProducer->dequeueBuffer(&slot, &fence, 1, 1, 0, GRALLOC_USAGE_SW_READ_OFTEN,
+                                           nullptr, nullptr));
+        ASSERT_EQ(OK, mProducer->requestBuffer(slot, &buf));
+        ASSERT_EQ(OK, mProducer->queueBuffer(slot, qbi, output));
+    };
+
+    // Queue frame 1 and acquire it with an explicit expectedPresent, so the
+    // queue learns the present time the consumer is targeting.
+    constexpr nsecs_t MS = 1000000;
+    ASSERT_NO_FATAL_FAILURE(queueFrame(1 * MS, &qbo));
+    ASSERT_EQ(OK, mConsumer->acquireBuffer(&item, 50 * MS));
+    ASSERT_EQ(1u, item.mFrameNumber);
+
+    // Queue frames 2 and 3. The queue is not past the latency-optimal depth
+    // until frame 3 lands, so nothing is replaced yet.
+    ASSERT_NO_FATAL_FAILURE(queueFrame(10 * MS, &qbo));
+    EXPECT_FALSE(qbo.bufferReplaced);
+    ASSERT_NO_FATAL_FAILURE(queueFrame(20 * MS, &qbo));
+    EXPECT_FALSE(qbo.bufferReplaced);
+
+    // Frame 3's desired present time is behind the expected present the
+    // consumer targeted, and the queue is now stuffed, so queueing frame 4
+    // replaces it even though the queue is not in a dropping mode.
+    ASSERT_NO_FATAL_FAILURE(queueFrame(30 * MS, &qbo));
+    EXPECT_TRUE(qbo.bufferReplaced);
+
+    // The consumer sees frame 2 and then frame 4; frame 3 was dropped.
+    ASSERT_EQ(OK, mConsumer->acquireBuffer(&item, 0));
+    ASSERT_EQ(2u, item.mFrameNumber);
+    ASSERT_EQ(OK, mConsumer->releaseBuffer(item.mSlot, item.mFrameNumber,
+            EGL_NO_DISPLAY, EGL_NO_SYNC_KHR, Fence::NO_FENCE));
+    ASSERT_EQ(OK, mConsumer->acquireBuffer(&item, 0));
+    ASSERT_EQ(4u, item.mFrameNumber);
+}
+
+TEST_F(BufferQueueTest, StuffingRecovery_DisabledByDefault) {
+    createBufferQueue();
+    sp<DummyConsumer> dc(new DummyConsumer);
+    mConsumer->consumerConnect(dc, false);
+    IGraphicBufferProducer::QueueBufferOutput qbo;
+    mProducer->connect(new DummyProducerListener, NATIVE_WINDOW_API_CPU, false,
+            &qbo);
+    mProducer->setMaxDequeuedBufferCount(3);
+
+    int slot;
+    sp<Fence> fence;
+    sp<GraphicBuffer> buf;
+    BufferItem item;
+
+    constexpr nsecs_t MS = 1000000;
+    for (int i = 0; i < 4; i++) {
+        IGraphicBufferProducer::QueueBufferInput qbi((i + 1) * MS, false /* isAutoTimestamp */,
+                HAL_DATASPACE_UNKNOWN, Rect(0, 0, 1, 1),
+                NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+        ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+                  mProducer->dequeueBuffer(&slot, &fence, 1, 1, 0, GRALLOC_USAGE_SW_READ_OFTEN,
+                                           nullptr, nullptr));
+        ASSERT_EQ(OK, mProducer->requestBuffer(slot, &buf));
+        ASSERT_EQ(OK, mProducer->queueBuffer(slot, qbi, &qbo));
+        EXPECT_FALSE(qbo.bufferReplaced);
+        if (i == 0) {
+            // Acquire the first frame with an expectedPresent that all later
+            // desired present times are behind.
+            ASSERT_EQ(OK, mConsumer->acquireBuffer(&item, 50 * MS));
+        }
+    }
+}
+
+TEST_F(BufferQueueTest, ApplyPendingAttributes_AppliesBatchedChanges) {
+    createBufferQueue();
+    sp<DummyConsumer> dc(new DummyConsumer);
+    mConsumer->consumerConnect(dc, false);
+    IGraphicBufferProducer::QueueBufferOutput qbo;
+    mProducer->connect(new DummyProducerListener, NATIVE_WINDOW_API_CPU, false,
+            &qbo);
+
+    IGraphicBufferProducer::PendingAttributes attributes;
+    ASSERT_FALSE(attributes.any());
+    attributes.hasMaxDequeuedBufferCount = true;
+    attributes.maxDequeuedBufferCount = 3;
+    attributes.hasAsyncMode = true;
+    attributes.asyncMode = true;
+    ASSERT_TRUE(attributes.any());
+    ASSERT_EQ(OK, mProducer->applyPendingAttributes(attributes));
+
+    // Async mode reserves an extra undequeued buffer on top of the default
+    // max acquired count of 1, so its application is observable here.
+    int value;
+    ASSERT_EQ(OK, mProducer->query(NATIVE_WINDOW_MIN_UNDEQUEUED_BUFFERS, &value));
+    EXPECT_EQ(2, value);
+
+    // The raised max dequeued count must let three buffers out at once.
+    int slot;
+    sp<Fence> fence;
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+                  mProducer->dequeueBuffer(&slot, &fence, 1, 1, 0, GRALLOC_USAGE_SW_READ_OFTEN,
+                                           nullptr, nullptr));
+    }
+
+    // A batch with an invalid value fails without the earlier valid fields
+    // being silently lost on the retry path.
+    attributes = IGraphicBufferProducer::PendingAttributes();
+    attributes.hasMaxDequeuedBufferCount = true;
+    attributes.maxDequeuedBufferCount = 0;
+    ASSERT_EQ(BAD_VALUE, mProducer->applyPendingAttributes(attributes));
+}
+
 TEST_F(BufferQueueTest, SetMaxAcquiredBufferCountWithIllegalValues_ReturnsError) {
     createBufferQueue();
     sp<DummyConsumer> dc(new DummyConsumer);
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gui/BufferSlotSet.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace android {
+
+TEST(BufferSlotSetTest, StartsEmpty) {
+    BufferSlotSet set;
+    EXPECT_TRUE(set.empty());
+    EXPECT_EQ(0u, set.size());
+    EXPECT_EQ(set.begin(), set.end());
+}
+
+TEST(BufferSlotSetTest, InsertEraseCount) {
+    BufferSlotSet set;
+    set.insert(0);
+    set.insert(5);
+    set.insert(63);
+
+    EXPECT_FALSE(set.empty());
+    EXPECT_EQ(3u, set.size());
+    EXPECT_EQ(1u, set.count(0));
+    EXPECT_EQ(1u, set.count(5));
+    EXPECT_EQ(1u, set.count(63));
+    EXPECT_EQ(0u, set.count(1));
+
+    set.erase(5);
+    EXPECT_EQ(2u, set.size());
+    EXPECT_EQ(0u, set.count(5));
+
+    // Inserting an already-present slot is a no-op.
+    set.insert(0);
+    EXPECT_EQ(2u, set.size());
+}
+
+TEST(BufferSlotSetTest, IteratesLowestSlotFirst) {
+    BufferSlotSet set;
+    set.insert(17);
+    set.insert(2);
+    set.insert(63);
+    set.insert(0);
+
+    std::vector<int> slots;
+    for (int s : set) {
+        slots.push_back(s);
+    }
+    EXPECT_EQ((std::vector<int>{0, 2, 17, 63}), slots);
+
+    // begin() dereferences to the lowest slot, as the free-slot pick in
+    // dequeueBuffer expects.
+    EXPECT_EQ(0, *set.begin());
+}
+
+TEST(BufferSlotSetTest, EraseByIterator) {
+    BufferSlotSet set;
+    set.insert(3);
+    set.insert(9);
+
+    auto it = set.begin();
+    EXPECT_EQ(3, *it);
+    set.erase(it);
+
+    EXPECT_EQ(1u, set.size());
+    EXPECT_EQ(9, *set.begin());
+}
+
+TEST(BufferSlotSetTest, Clear) {
+    BufferSlotSet set;
+    set.insert(1);
+    set.insert(2);
+    set.clear();
+    EXPECT_TRUE(set.empty());
+}
+
+} // namespace android
@@ -373,6 +373,33 @@ TEST_P(IGraphicBufferProducerTest, Query_ReturnsError) {
     // but not by BufferQueue::query
 }
 
+TEST_P(IGraphicBufferProducerTest, DequeueWithBuffer_ReturnsBufferWhenReallocated) {
+    ASSERT_NO_FATAL_FAILURE(ConnectProducer());
+
+    int dequeuedSlot = -1;
+    sp<Fence> dequeuedFence;
+    sp<GraphicBuffer> dequeuedBuffer;
+
+    status_t result =
+            mProducer->dequeueWithBuffer(&dequeuedSlot, &dequeuedFence, DEFAULT_WIDTH,
+                                         DEFAULT_HEIGHT, DEFAULT_FORMAT, TEST_PRODUCER_USAGE_BITS,
+                                         &dequeuedBuffer, nullptr, nullptr);
+    ASSERT_EQ(OK, ~IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION & result);
+
+    EXPECT_LE(0, dequeuedSlot);
+    EXPECT_GT(BufferQueue::NUM_BUFFER_SLOTS, dequeuedSlot);
+
+    // A freshly allocated slot must carry its buffer in the same call, so no
+    // separate requestBuffer is needed before queueing.
+    if (result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+        ASSERT_TRUE(dequeuedBuffer != nullptr);
+    }
+
+    IGraphicBufferProducer::QueueBufferInput input = CreateBufferInput();
+    IGraphicBufferProducer::QueueBufferOutput output;
+    ASSERT_OK(mProducer->queueBuffer(dequeuedSlot, input, &output));
+}
+
 // TODO: queue under more complicated situations not involving just a single buffer
 TEST_P(IGraphicBufferProducerTest, Queue_Succeeds) {
     ASSERT_NO_FATAL_FAILURE(ConnectProducer());
@@ -723,11 +723,15 @@ public:
     status_t getDisplayConfigs(const sp<IBinder>& /*display*/, Vector<DisplayConfig>*) override {
         return NO_ERROR;
     }
+    status_t getDisplayConfigTable(sp<IMemoryHeap>* /*outHeap*/) override {
+        return INVALID_OPERATION;
+    }
     status_t getDisplayState(const sp<IBinder>& /*display*/, ui::DisplayState*) override {
         return NO_ERROR;
     }
     status_t getDisplayStats(const sp<IBinder>& /*display*/,
             DisplayStatInfo* /*stats*/) override { return NO_ERROR; }
+    status_t getCompositionStats(CompositionStats* /*outStats*/) override { return NO_ERROR; }
     int getActiveConfig(const sp<IBinder>& /*display*/) override { return 0; }
     status_t getDisplayColorModes(const sp<IBinder>& /*display*/,
             Vector<ColorMode>* /*outColorModes*/) override {
@@ -751,6 +755,14 @@ public:
                            bool /*captureSecureLayers*/) override {
         return NO_ERROR;
     }
+    status_t captureScreenAsync(const sp<IBinder>& /*display*/, sp<GraphicBuffer>* /*outBuffer*/,
+                                sp<Fence>* /*outFence*/, bool& /*outCapturedSecureLayers*/,
+                                ui::Dataspace /*reqDataspace*/, ui::PixelFormat /*reqPixelFormat*/,
+                                const Rect& /*sourceCrop*/, uint32_t /*reqWidth*/,
+                                uint32_t /*reqHeight*/, bool /*useIdentityTransform*/, ui::Rotation,
+                                bool /*captureSecureLayers*/) override {
+        return NO_ERROR;
+    }
     status_t getAutoLowLatencyModeSupport(const sp<IBinder>& /*display*/,
                                           bool* /*outSupport*/) const override {
         return NO_ERROR;
@@ -865,6 +877,13 @@ public:
 
     status_t acquireFrameRateFlexibilityToken(sp<IBinder>* /*outToken*/) { return NO_ERROR; }
 
+    status_t setThermalRefreshRateHeadroom(float /*headroom*/) override { return NO_ERROR; }
+
+    status_t getDisplayedContentSampleStream(const sp<IBinder>& /*display*/,
+                                             base::unique_fd* /*outFd*/) override {
+        return NO_ERROR;
+    }
+
 protected:
     IBinder* onAsBinder() override { return nullptr; }
 
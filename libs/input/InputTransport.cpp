@@ -23,12 +23,16 @@ static constexpr bool DEBUG_TRANSPORT_ACTIONS = false;
 #include <fcntl.h>
 #include <inttypes.h>
 #include <math.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <atomic>
+
 #include <android-base/stringprintf.h>
 #include <binder/Parcel.h>
+#include <cutils/ashmem.h>
 #include <cutils/properties.h>
 #include <log/log.h>
 #include <utils/Trace.h>
@@ -63,6 +67,15 @@ static const nsecs_t RESAMPLE_MAX_DELTA = 20 * NANOS_PER_MS;
 // far into the future.  This time is further bounded by 50% of the last time delta.
 static const nsecs_t RESAMPLE_MAX_PREDICTION = 8 * NANOS_PER_MS;
 
+// Upper bound on the prediction lead configured through setPredictionLead(), so that a
+// misreported pipeline depth cannot make the prediction run unrecoverably far ahead.
+static const nsecs_t PREDICTION_MAX_LEAD = 24 * NANOS_PER_MS;
+
+// The curvature term of the prediction model may not grow the predicted displacement
+// beyond this multiple of the purely linear (velocity-only) prediction.  This bounds
+// the overshoot when the finger or stylus decelerates or reverses direction.
+static const float PREDICTION_MAX_OVERSHOOT = 1.5f;
+
 /**
  * System property for enabling / disabling touch resampling.
  * Resampling extrapolates / interpolates the reported touch event coordinates to better
@@ -75,6 +88,59 @@ static const nsecs_t RESAMPLE_MAX_PREDICTION = 8 * NANOS_PER_MS;
  */
 static const char* PROPERTY_RESAMPLING_ENABLED = "ro.input.resampling";
 
+/**
+ * System property for enabling predictive touch synthesis.
+ * Whereas resampling aligns samples to a frame time RESAMPLE_LATENCY in the past,
+ * prediction synthesizes coordinates ahead of the last received sample to compensate
+ * for the depth of the render pipeline, which matters most for stylus handwriting on
+ * high refresh rate displays.  The prediction lead defaults to the value of
+ * "ro.input.touch_prediction_lead" in milliseconds and can be adjusted at runtime
+ * through InputConsumer::setPredictionLead with the measured pipeline depth.
+ * Set to "1" to enable prediction.
+ * Prediction is disabled by default.
+ */
+static const char* PROPERTY_PREDICTION_ENABLED = "ro.input.touch_prediction";
+static const char* PROPERTY_PREDICTION_LEAD = "ro.input.touch_prediction_lead";
+
+/**
+ * System property for enabling the shared memory ring transport.
+ * When enabled, each input channel pair additionally shares an ashmem region and
+ * messages are exchanged through a pair of single-producer / single-consumer rings
+ * in that region, avoiding the per-event send()/recv() syscalls.  The socket is
+ * kept only to wake up the peer's poll() loop.
+ * Disabled by default.
+ */
+static const char* PROPERTY_SHARED_RING_ENABLED = "ro.input.shared_ring";
+
+// Number of message slots per direction in the shared ring.  Must be a power of two.
+// Sized to hold more backlog than the socket buffer would (SOCKET_BUFFER_SIZE holds
+// a few dozen large motion events) so that enabling the ring never reduces capacity.
+static constexpr uint32_t SHARED_RING_SLOTS = 64;
+
+struct RingSlot {
+    uint32_t length;
+    uint8_t data[sizeof(InputMessage)] __attribute__((aligned(8)));
+};
+
+// A single-producer / single-consumer ring.  The head and tail indices increase
+// monotonically and are reduced modulo SHARED_RING_SLOTS when indexing; keeping
+// them on separate cache lines avoids producer/consumer false sharing.
+struct SharedRing {
+    std::atomic<uint32_t> head; // next slot the producer will fill
+    uint8_t headPadding[60];
+    std::atomic<uint32_t> tail; // next slot the consumer will drain
+    uint8_t tailPadding[60];
+    RingSlot slots[SHARED_RING_SLOTS];
+};
+
+// One ring per direction, indexed by the role of the producing endpoint.
+// The ashmem region is zero-filled, which is a valid initial state for the rings.
+struct SharedRingMemory {
+    static constexpr int32_t SERVER_ROLE = 0;
+    static constexpr int32_t CLIENT_ROLE = 1;
+    SharedRing rings[2];
+};
+
 template<typename T>
 inline static T min(const T& a, const T& b) {
     return a < b ? a : b;
@@ -222,6 +288,13 @@ void InputMessage::getSanitizedCopy(InputMessage* msg) const {
                 msg->body.motion.pointers[i].properties.id = body.motion.pointers[i].properties.id;
                 msg->body.motion.pointers[i].properties.toolType =
                         body.motion.pointers[i].properties.toolType,
+                // computed-state channel
+                msg->body.motion.pointers[i].computedStateValid =
+                        body.motion.pointers[i].computedStateValid;
+                msg->body.motion.pointers[i].velocityX = body.motion.pointers[i].velocityX;
+                msg->body.motion.pointers[i].velocityY = body.motion.pointers[i].velocityY;
+                msg->body.motion.pointers[i].predictedX = body.motion.pointers[i].predictedX;
+                msg->body.motion.pointers[i].predictedY = body.motion.pointers[i].predictedY;
                 // PointerCoords coords
                 msg->body.motion.pointers[i].coords.bits = body.motion.pointers[i].coords.bits;
                 const uint32_t count = BitSet64::count(body.motion.pointers[i].coords.bits);
@@ -270,6 +343,23 @@ InputChannel::~InputChannel() {
     if (DEBUG_CHANNEL_LIFECYCLE) {
         ALOGD("Input channel destroyed: name='%s', fd=%d", mName.c_str(), mFd.get());
     }
+    if (mSharedRingMemory) {
+        munmap(mSharedRingMemory, sizeof(SharedRingMemory));
+    }
+}
+
+void InputChannel::setSharedRing(android::base::unique_fd ringFd, int32_t role) {
+    void* memory =
+            mmap(nullptr, sizeof(SharedRingMemory), PROT_READ | PROT_WRITE, MAP_SHARED,
+                 ringFd.get(), 0);
+    if (memory == MAP_FAILED) {
+        ALOGE("channel '%s' ~ Could not map shared ring, falling back to the socket: %s",
+              mName.c_str(), strerror(errno));
+        return;
+    }
+    mSharedRingFd = std::move(ringFd);
+    mSharedRingMemory = memory;
+    mSharedRingRole = role;
 }
 
 status_t InputChannel::openInputChannelPair(const std::string& name,
@@ -299,11 +389,71 @@ status_t InputChannel::openInputChannelPair(const std::string& name,
     std::string clientChannelName = name + " (client)";
     android::base::unique_fd clientFd(sockets[1]);
     outClientChannel = InputChannel::create(clientChannelName, std::move(clientFd), token);
+
+    if (property_get_bool(PROPERTY_SHARED_RING_ENABLED, false)) {
+        android::base::unique_fd ringFd(
+                ashmem_create_region(name.c_str(), sizeof(SharedRingMemory)));
+        if (!ringFd.ok()) {
+            ALOGE("channel '%s' ~ Could not create shared ring, using the socket.  errno=%d",
+                  name.c_str(), errno);
+        } else {
+            android::base::unique_fd serverRingFd(::dup(ringFd.get()));
+            if (serverRingFd.ok()) {
+                outServerChannel->setSharedRing(std::move(serverRingFd),
+                                                SharedRingMemory::SERVER_ROLE);
+                // Both endpoints must agree on the transport; only give the client
+                // the ring if the server side managed to map it.
+                if (outServerChannel->mSharedRingMemory) {
+                    outClientChannel->setSharedRing(std::move(ringFd),
+                                                    SharedRingMemory::CLIENT_ROLE);
+                    if (!outClientChannel->mSharedRingMemory) {
+                        munmap(outServerChannel->mSharedRingMemory, sizeof(SharedRingMemory));
+                        outServerChannel->mSharedRingMemory = nullptr;
+                        outServerChannel->mSharedRingFd.reset();
+                        outServerChannel->mSharedRingRole = -1;
+                    }
+                }
+            }
+        }
+    }
     return OK;
 }
 
 status_t InputChannel::sendMessage(const InputMessage* msg) {
     const size_t msgLength = msg->size();
+    if (mSharedRingMemory) {
+        SharedRing& ring =
+                static_cast<SharedRingMemory*>(mSharedRingMemory)->rings[mSharedRingRole];
+        const uint32_t head = ring.head.load(std::memory_order_relaxed);
+        const uint32_t tail = ring.tail.load(std::memory_order_acquire);
+        if (head - tail >= SHARED_RING_SLOTS) {
+            return WOULD_BLOCK;
+        }
+        RingSlot& slot = ring.slots[head % SHARED_RING_SLOTS];
+        msg->getSanitizedCopy(reinterpret_cast<InputMessage*>(slot.data));
+        slot.length = msgLength;
+        ring.head.store(head + 1, std::memory_order_release);
+
+        // Nudge the peer through the socket.  The byte's only purpose is to make
+        // the peer's poll() return; if the socket buffer is full there are already
+        // plenty of wakeups pending, so EAGAIN is harmless.
+        const uint8_t wake = 0;
+        ssize_t nWake;
+        do {
+            nWake = ::send(mFd.get(), &wake, sizeof(wake), MSG_DONTWAIT | MSG_NOSIGNAL);
+        } while (nWake == -1 && errno == EINTR);
+        if (nWake == -1 &&
+            (errno == EPIPE || errno == ENOTCONN || errno == ECONNREFUSED ||
+             errno == ECONNRESET)) {
+            return DEAD_OBJECT;
+        }
+#if DEBUG_CHANNEL_MESSAGES
+        ALOGD("channel '%s' ~ sent message of type %d through the shared ring", mName.c_str(),
+              msg->header.type);
+#endif
+        return OK;
+    }
+
     InputMessage cleanMsg;
     msg->getSanitizedCopy(&cleanMsg);
     ssize_t nWrite;
@@ -341,6 +491,62 @@ status_t InputChannel::sendMessage(const InputMessage* msg) {
 }
 
 status_t InputChannel::receiveMessage(InputMessage* msg) {
+    if (mSharedRingMemory) {
+        SharedRing& ring =
+                static_cast<SharedRingMemory*>(mSharedRingMemory)->rings[1 - mSharedRingRole];
+        for (int attempt = 0; attempt < 2; attempt++) {
+            const uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+            const uint32_t head = ring.head.load(std::memory_order_acquire);
+            if (head != tail) {
+                const RingSlot& slot = ring.slots[tail % SHARED_RING_SLOTS];
+                const size_t length = slot.length;
+                if (length > sizeof(InputMessage)) {
+                    ring.tail.store(tail + 1, std::memory_order_release);
+                    return BAD_VALUE;
+                }
+                memcpy(msg, slot.data, length);
+                ring.tail.store(tail + 1, std::memory_order_release);
+                if (!msg->isValid(length)) {
+#if DEBUG_CHANNEL_MESSAGES
+                    ALOGD("channel '%s' ~ received invalid message", mName.c_str());
+#endif
+                    return BAD_VALUE;
+                }
+#if DEBUG_CHANNEL_MESSAGES
+                ALOGD("channel '%s' ~ received message of type %d through the shared ring",
+                      mName.c_str(), msg->header.type);
+#endif
+                return OK;
+            }
+            if (attempt > 0) {
+                break;
+            }
+            // The ring is empty: drain the pending wakeup bytes so that poll()
+            // stops reporting the fd as readable, then look at the ring once more
+            // in case the peer published a message while we were draining.
+            uint8_t wakeBuffer[32];
+            ssize_t nDrained;
+            do {
+                nDrained = ::recv(mFd.get(), wakeBuffer, sizeof(wakeBuffer), MSG_DONTWAIT);
+            } while (nDrained > 0 || (nDrained == -1 && errno == EINTR));
+            if (nDrained == 0) { // check for EOF
+#if DEBUG_CHANNEL_MESSAGES
+                ALOGD("channel '%s' ~ receive message failed because peer was closed",
+                      mName.c_str());
+#endif
+                return DEAD_OBJECT;
+            }
+            const int error = errno;
+            if (error != EAGAIN && error != EWOULDBLOCK) {
+                if (error == EPIPE || error == ENOTCONN || error == ECONNREFUSED) {
+                    return DEAD_OBJECT;
+                }
+                return -error;
+            }
+        }
+        return WOULD_BLOCK;
+    }
+
     ssize_t nRead;
     do {
         nRead = ::recv(mFd.get(), msg, sizeof(InputMessage), MSG_DONTWAIT);
@@ -394,7 +600,14 @@ sp<InputChannel> InputChannel::dup() const {
                             getName().c_str());
         return nullptr;
     }
-    return InputChannel::create(mName, std::move(newFd), mToken);
+    sp<InputChannel> channel = InputChannel::create(mName, std::move(newFd), mToken);
+    if (channel != nullptr && mSharedRingFd.ok()) {
+        android::base::unique_fd ringFd(::dup(mSharedRingFd.get()));
+        if (ringFd.ok()) {
+            channel->setSharedRing(std::move(ringFd), mSharedRingRole);
+        }
+    }
+    return channel;
 }
 
 status_t InputChannel::write(Parcel& out) const {
@@ -409,6 +622,18 @@ status_t InputChannel::write(Parcel& out) const {
     }
 
     s = out.writeUniqueFileDescriptor(mFd);
+    if (s != OK) {
+        return s;
+    }
+
+    s = out.writeInt32(mSharedRingFd.ok() ? mSharedRingRole : -1);
+    if (s != OK) {
+        return s;
+    }
+
+    if (mSharedRingFd.ok()) {
+        s = out.writeUniqueFileDescriptor(mSharedRingFd);
+    }
     return s;
 }
 
@@ -421,7 +646,28 @@ sp<InputChannel> InputChannel::read(const Parcel& from) {
         return nullptr;
     }
 
-    return InputChannel::create(name, std::move(rawFd), token);
+    sp<InputChannel> channel = InputChannel::create(name, std::move(rawFd), token);
+    if (channel == nullptr) {
+        return nullptr;
+    }
+
+    const int32_t ringRole = from.readInt32();
+    if (ringRole >= 0) {
+        android::base::unique_fd ringFd;
+        if (from.readUniqueFileDescriptor(&ringFd) == OK) {
+            // The role comes from an untrusted parcel and indexes the ring
+            // pair; anything other than the two negotiated roles gets the
+            // socket path instead.
+            if (ringRole == SharedRingMemory::SERVER_ROLE ||
+                ringRole == SharedRingMemory::CLIENT_ROLE) {
+                channel->setSharedRing(std::move(ringFd), ringRole);
+            } else {
+                ALOGE("channel '%s' ~ Invalid shared ring role %d in parcel, using the socket",
+                      name.c_str(), ringRole);
+            }
+        }
+    }
+    return channel;
 }
 
 sp<IBinder> InputChannel::getConnectionToken() const {
@@ -487,7 +733,8 @@ status_t InputPublisher::publishMotionEvent(
         MotionClassification classification, float xScale, float yScale, float xOffset,
         float yOffset, float xPrecision, float yPrecision, float xCursorPosition,
         float yCursorPosition, nsecs_t downTime, nsecs_t eventTime, uint32_t pointerCount,
-        const PointerProperties* pointerProperties, const PointerCoords* pointerCoords) {
+        const PointerProperties* pointerProperties, const PointerCoords* pointerCoords,
+        const PointerComputedState* computedStates) {
     if (ATRACE_ENABLED()) {
         std::string message = StringPrintf(
                 "publishMotionEvent(inputChannel=%s, action=%" PRId32 ")",
@@ -548,6 +795,19 @@ status_t InputPublisher::publishMotionEvent(
     for (uint32_t i = 0; i < pointerCount; i++) {
         msg.body.motion.pointers[i].properties.copyFrom(pointerProperties[i]);
         msg.body.motion.pointers[i].coords.copyFrom(pointerCoords[i]);
+        if (computedStates != nullptr && computedStates[i].valid) {
+            msg.body.motion.pointers[i].computedStateValid = 1;
+            msg.body.motion.pointers[i].velocityX = computedStates[i].velocityX;
+            msg.body.motion.pointers[i].velocityY = computedStates[i].velocityY;
+            msg.body.motion.pointers[i].predictedX = computedStates[i].predictedX;
+            msg.body.motion.pointers[i].predictedY = computedStates[i].predictedY;
+        } else {
+            msg.body.motion.pointers[i].computedStateValid = 0;
+            msg.body.motion.pointers[i].velocityX = 0.f;
+            msg.body.motion.pointers[i].velocityY = 0.f;
+            msg.body.motion.pointers[i].predictedX = 0.f;
+            msg.body.motion.pointers[i].predictedY = 0.f;
+        }
     }
 
     return mChannel->sendMessage(&msg);
@@ -598,6 +858,8 @@ status_t InputPublisher::receiveFinishedSignal(uint32_t* outSeq, bool* outHandle
 
 InputConsumer::InputConsumer(const sp<InputChannel>& channel) :
         mResampleTouch(isTouchResamplingEnabled()),
+        mPredictTouch(isTouchPredictionEnabled()),
+        mPredictionLead(property_get_int32(PROPERTY_PREDICTION_LEAD, 0) * NANOS_PER_MS),
         mChannel(channel), mMsgDeferred(false) {
 }
 
@@ -608,6 +870,19 @@ bool InputConsumer::isTouchResamplingEnabled() {
     return property_get_bool(PROPERTY_RESAMPLING_ENABLED, true);
 }
 
+bool InputConsumer::isTouchPredictionEnabled() {
+    return property_get_bool(PROPERTY_PREDICTION_ENABLED, false);
+}
+
+void InputConsumer::setPredictionLead(nsecs_t predictionLead) {
+    if (predictionLead < 0) {
+        predictionLead = 0;
+    } else if (predictionLead > PREDICTION_MAX_LEAD) {
+        predictionLead = PREDICTION_MAX_LEAD;
+    }
+    mPredictionLead = predictionLead;
+}
+
 status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consumeBatches,
                                 nsecs_t frameTime, uint32_t* outSeq, InputEvent** outEvent,
                                 int* motionEventType, int* touchMoveNumber, bool* flag) {
@@ -728,6 +1003,7 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
 
                 updateTouchState(mMsg);
                 initializeMotionEvent(motionEvent, &mMsg);
+                updateComputedStates(mMsg);
                 *outSeq = mMsg.body.motion.seq;
                 *outEvent = motionEvent;
 
@@ -758,6 +1034,15 @@ status_t InputConsumer::consume(InputEventFactoryInterface* factory, bool consum
     return OK;
 }
 
+status_t InputConsumer::consumeBatchedUpTo(InputEventFactoryInterface* factory, nsecs_t frameTime,
+        uint32_t* outSeq, InputEvent** outEvent) {
+    int motionEventType = -1;
+    int touchMoveNumber = 0;
+    bool receivedFromChannel = false;
+    return consume(factory, true /*consumeBatches*/, frameTime, outSeq, outEvent,
+                   &motionEventType, &touchMoveNumber, &receivedFromChannel);
+}
+
 status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory,
         nsecs_t frameTime, uint32_t* outSeq, InputEvent** outEvent, int* touchMoveNumber) {
     status_t result;
@@ -774,6 +1059,11 @@ status_t InputConsumer::consumeBatch(InputEventFactoryInterface* factory,
         if (mResampleTouch && (*touchMoveNumber != 1)) {
             sampleTime -= RESAMPLE_LATENCY;
         }
+        if (mPredictTouch && mPredictionLead > 0) {
+            // Synthesize ahead of the frame by the measured pipeline depth instead of
+            // behind it; resampleTouchState bounds how far the prediction may travel.
+            sampleTime = frameTime + mPredictionLead;
+        }
         ssize_t split = findSampleNoLaterThan(batch, sampleTime);
         if (split < 0) {
             continue;
@@ -816,6 +1106,7 @@ status_t InputConsumer::consumeSamples(InputEventFactoryInterface* factory,
         }
         chain = msg.body.motion.seq;
     }
+    updateComputedStates(batch.samples.itemAt(count - 1));
     batch.samples.removeItemsAt(0, count);
 
     *outSeq = chain;
@@ -972,8 +1263,9 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
 
     // Find the data to use for resampling.
     const History* other;
-    History future;
+    History& future = mFutureSampleScratch;
     float alpha;
+    bool extrapolate = false;
     if (next) {
         // Interpolate between current sample and future sample.
         // So current->eventTime <= sampleTime <= future.eventTime.
@@ -1003,7 +1295,13 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
 #endif
             return;
         }
-        nsecs_t maxPredict = current->eventTime + min(delta / 2, RESAMPLE_MAX_PREDICTION);
+        extrapolate = true;
+        // With prediction enabled we deliberately run ahead of the last sample by the
+        // configured pipeline depth; the curvature model and the overshoot clamp in
+        // predictPointer keep deeper leads usable than plain linear extrapolation.
+        nsecs_t maxPredict = mPredictTouch
+                ? current->eventTime + min(delta * 2, mPredictionLead + RESAMPLE_MAX_PREDICTION)
+                : current->eventTime + min(delta / 2, RESAMPLE_MAX_PREDICTION);
         if (sampleTime > maxPredict) {
 #if DEBUG_RESAMPLING
             ALOGD("Sample time is too far in the future, adjusting prediction "
@@ -1021,7 +1319,7 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
     }
 
     // Resample touch coordinates.
-    History oldLastResample;
+    History& oldLastResample = mOldLastResampleScratch;
     oldLastResample.initializeFrom(touchState.lastResample);
     touchState.lastResample.eventTime = sampleTime;
     touchState.lastResample.idBits.clear();
@@ -1044,8 +1342,13 @@ void InputConsumer::resampleTouchState(nsecs_t sampleTime, MotionEvent* event,
         PointerCoords& resampledCoords = touchState.lastResample.pointers[i];
         const PointerCoords& currentCoords = current->getPointerById(id);
         resampledCoords.copyFrom(currentCoords);
-        if (other->idBits.hasBit(id)
-                && shouldResampleTool(event->getToolType(i))) {
+        const int32_t toolType = event->getToolType(i);
+        bool predicted = false;
+        if (mPredictTouch && extrapolate && shouldPredictTool(toolType)) {
+            predicted = predictPointer(touchState, id, sampleTime, resampledCoords);
+        }
+        if (!predicted && other->idBits.hasBit(id)
+                && shouldResampleTool(toolType)) {
             const PointerCoords& otherCoords = other->getPointerById(id);
             resampledCoords.setAxisValue(AMOTION_EVENT_AXIS_X,
                     lerp(currentCoords.getX(), otherCoords.getX(), alpha));
@@ -1076,6 +1379,72 @@ bool InputConsumer::shouldResampleTool(int32_t toolType) {
             || toolType == AMOTION_EVENT_TOOL_TYPE_UNKNOWN;
 }
 
+bool InputConsumer::shouldPredictTool(int32_t toolType) {
+    // Prediction exists chiefly for the stylus handwriting path, which plain
+    // resampling deliberately leaves alone, but fingers use the same model so that
+    // fast scrolls benefit from the configured lead too.
+    return toolType == AMOTION_EVENT_TOOL_TYPE_STYLUS || shouldResampleTool(toolType);
+}
+
+/**
+ * Predict the position of the given pointer at sampleTime using a second order
+ * (velocity plus curvature) model fitted to the last three received samples, writing
+ * the result into outCoords.  The curvature term is clamped so that the predicted
+ * displacement never exceeds PREDICTION_MAX_OVERSHOOT times the purely linear
+ * prediction.  Returns false when there is not enough well-spaced history to fit the
+ * model, in which case the caller falls back to linear extrapolation.
+ */
+bool InputConsumer::predictPointer(const TouchState& touchState, uint32_t id,
+        nsecs_t sampleTime, PointerCoords& outCoords) {
+    if (touchState.historySize < 3) {
+        return false;
+    }
+    const History* h0 = touchState.getHistory(0);
+    const History* h1 = touchState.getHistory(1);
+    const History* h2 = touchState.getHistory(2);
+    if (!h1->hasPointerId(id) || !h2->hasPointerId(id)) {
+        return false;
+    }
+    const nsecs_t delta01 = h0->eventTime - h1->eventTime;
+    const nsecs_t delta12 = h1->eventTime - h2->eventTime;
+    if (delta01 < RESAMPLE_MIN_DELTA || delta01 > RESAMPLE_MAX_DELTA
+            || delta12 < RESAMPLE_MIN_DELTA || delta12 > RESAMPLE_MAX_DELTA) {
+        return false;
+    }
+    const float lead = (sampleTime - h0->eventTime) * 0.000000001f;
+    if (lead <= 0) {
+        return false;
+    }
+
+    const float dt01 = delta01 * 0.000000001f;
+    const float dt12 = delta12 * 0.000000001f;
+    const PointerCoords& p0 = h0->getPointerById(id);
+    const PointerCoords& p1 = h1->getPointerById(id);
+    const PointerCoords& p2 = h2->getPointerById(id);
+    const float vx = (p0.getX() - p1.getX()) / dt01;
+    const float vy = (p0.getY() - p1.getY()) / dt01;
+    const float ax = (vx - (p1.getX() - p2.getX()) / dt12) / (0.5f * (dt01 + dt12));
+    const float ay = (vy - (p1.getY() - p2.getY()) / dt12) / (0.5f * (dt01 + dt12));
+
+    float dx = (vx + 0.5f * ax * lead) * lead;
+    float dy = (vy + 0.5f * ay * lead) * lead;
+    const float linearMagnitude = hypotf(vx * lead, vy * lead);
+    const float magnitude = hypotf(dx, dy);
+    const float maxMagnitude = linearMagnitude * PREDICTION_MAX_OVERSHOOT;
+    if (magnitude > maxMagnitude) {
+        const float scale = maxMagnitude / magnitude;
+        dx *= scale;
+        dy *= scale;
+    }
+    outCoords.setAxisValue(AMOTION_EVENT_AXIS_X, p0.getX() + dx);
+    outCoords.setAxisValue(AMOTION_EVENT_AXIS_Y, p0.getY() + dy);
+#if DEBUG_RESAMPLING
+    ALOGD("[%d] - predict (%0.3f, %0.3f), cur (%0.3f, %0.3f), lead %0.1f ms",
+            id, outCoords.getX(), outCoords.getY(), p0.getX(), p0.getY(), lead * 1000);
+#endif
+    return true;
+}
+
 status_t InputConsumer::sendFinishedSignal(uint32_t seq, bool handled) {
     if (DEBUG_TRANSPORT_ACTIONS) {
         ALOGD("channel '%s' consumer ~ sendFinishedSignal: seq=%u, handled=%s",
@@ -1217,6 +1586,28 @@ void InputConsumer::addSample(MotionEvent* event, const InputMessage* msg) {
     event->addSample(msg->body.motion.eventTime, pointerCoords);
 }
 
+void InputConsumer::updateComputedStates(const InputMessage& msg) {
+    const uint32_t pointerCount = msg.body.motion.pointerCount;
+    for (uint32_t i = 0; i < MAX_POINTERS; i++) {
+        if (i < pointerCount && msg.body.motion.pointers[i].computedStateValid) {
+            mComputedStates[i].valid = true;
+            mComputedStates[i].velocityX = msg.body.motion.pointers[i].velocityX;
+            mComputedStates[i].velocityY = msg.body.motion.pointers[i].velocityY;
+            mComputedStates[i].predictedX = msg.body.motion.pointers[i].predictedX;
+            mComputedStates[i].predictedY = msg.body.motion.pointers[i].predictedY;
+        } else {
+            mComputedStates[i] = PointerComputedState();
+        }
+    }
+}
+
+PointerComputedState InputConsumer::getComputedState(size_t pointerIndex) const {
+    if (pointerIndex >= MAX_POINTERS) {
+        return PointerComputedState();
+    }
+    return mComputedStates[pointerIndex];
+}
+
 bool InputConsumer::canAddSample(const Batch& batch, const InputMessage *msg) {
     const InputMessage& head = batch.samples.itemAt(0);
     uint32_t pointerCount = msg->body.motion.pointerCount;
@@ -16,8 +16,13 @@
 
 #define LOG_TAG "KeyCharacterMap"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #ifdef __ANDROID__
 #include <binder/Parcel.h>
@@ -72,6 +77,62 @@ static const Modifier modifiers[] = {
         { "scrolllock", AMETA_SCROLL_LOCK_ON },
 };
 
+// --- Precompiled key character map format ---
+//
+// A compiled map is a single file of flat, index-based tables:
+//
+//   BinaryHeader
+//   BinaryKey[numKeys]             in ascending key code order
+//   BinaryBehavior[numBehaviors]   grouped by key, in behavior list order
+//   BinaryCode[numScanCodes]       in ascending scan code order
+//   BinaryCode[numUsageCodes]      in ascending usage code order
+//
+// All cross references are array indices rather than pointers, so the file
+// can be validated with simple bounds checks and read directly out of a
+// shared read-only mapping.
+
+static const char* BINARY_SUFFIX = ".bin";
+static const uint32_t BINARY_MAGIC = 0x424d434b; // 'KCMB', little-endian
+static const uint32_t BINARY_VERSION = 1;
+
+struct BinaryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t type;
+    uint32_t numKeys;
+    uint32_t numBehaviors;
+    uint32_t numScanCodes;
+    uint32_t numUsageCodes;
+};
+
+struct BinaryKey {
+    int32_t keyCode;
+    uint16_t label;
+    uint16_t number;
+    uint32_t firstBehavior;
+    uint32_t behaviorCount;
+};
+
+struct BinaryBehavior {
+    int32_t metaState;
+    uint16_t character;
+    uint16_t reserved;
+    int32_t fallbackKeyCode;
+    int32_t replacementKeyCode;
+};
+
+struct BinaryCode {
+    int32_t fromCode;
+    int32_t keyCode;
+};
+
+static size_t binarySize(const BinaryHeader& header) {
+    return sizeof(BinaryHeader)
+            + header.numKeys * sizeof(BinaryKey)
+            + header.numBehaviors * sizeof(BinaryBehavior)
+            + (header.numScanCodes + header.numUsageCodes) * sizeof(BinaryCode);
+}
+
 #if DEBUG_MAPPING
 static String8 toString(const char16_t* chars, size_t numChars) {
     String8 result;
@@ -110,6 +171,19 @@ status_t KeyCharacterMap::load(const std::string& filename,
         Format format, sp<KeyCharacterMap>* outMap) {
     outMap->clear();
 
+    // Prefer a precompiled map when one is present beside the text file and
+    // is at least as recent as it.
+    std::string compiledFilename = filename + BINARY_SUFFIX;
+    struct stat compiledStat, textStat;
+    if (!stat(compiledFilename.c_str(), &compiledStat) && !stat(filename.c_str(), &textStat)
+            && compiledStat.st_mtime >= textStat.st_mtime) {
+        if (!loadCompiled(compiledFilename, format, outMap)) {
+            return OK;
+        }
+        ALOGW("Ignoring malformed precompiled key character map file %s.",
+                compiledFilename.c_str());
+    }
+
     Tokenizer* tokenizer;
     status_t status = Tokenizer::open(String8(filename.c_str()), &tokenizer);
     if (status) {
@@ -136,6 +210,200 @@ status_t KeyCharacterMap::loadContents(const std::string& filename, const char*
     return status;
 }
 
+status_t KeyCharacterMap::loadCompiled(const std::string& filename, Format format,
+        sp<KeyCharacterMap>* outMap) {
+    outMap->clear();
+
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st)) {
+        status_t status = -errno;
+        ::close(fd);
+        return status;
+    }
+    size_t size = size_t(st.st_size);
+    if (size < sizeof(BinaryHeader)) {
+        ::close(fd);
+        return BAD_VALUE;
+    }
+
+    // Map the tables read-only and shared so that every process loading the
+    // same compiled map references the same page cache pages.
+    void* base = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        return NO_MEMORY;
+    }
+
+    status_t status = BAD_VALUE;
+    const BinaryHeader* header = static_cast<const BinaryHeader*>(base);
+    if (header->magic != BINARY_MAGIC || header->version != BINARY_VERSION
+            || header->numKeys > MAX_KEYS || binarySize(*header) != size) {
+        ALOGE("Malformed precompiled key character map file %s.", filename.c_str());
+        goto Done;
+    }
+    if ((format == FORMAT_BASE && header->type == KEYBOARD_TYPE_OVERLAY)
+            || (format == FORMAT_OVERLAY && header->type != KEYBOARD_TYPE_OVERLAY)) {
+        ALOGE("Precompiled key character map file %s has unexpected keyboard type %d.",
+                filename.c_str(), header->type);
+        goto Done;
+    }
+
+    {
+        const BinaryKey* keys = reinterpret_cast<const BinaryKey*>(header + 1);
+        const BinaryBehavior* behaviors =
+                reinterpret_cast<const BinaryBehavior*>(keys + header->numKeys);
+        const BinaryCode* scanCodes =
+                reinterpret_cast<const BinaryCode*>(behaviors + header->numBehaviors);
+        const BinaryCode* usageCodes = scanCodes + header->numScanCodes;
+
+        sp<KeyCharacterMap> map = new KeyCharacterMap();
+        map->mType = header->type;
+
+        for (uint32_t i = 0; i < header->numKeys; i++) {
+            const BinaryKey& binaryKey = keys[i];
+            if (binaryKey.firstBehavior > header->numBehaviors
+                    || binaryKey.behaviorCount
+                            > header->numBehaviors - binaryKey.firstBehavior) {
+                ALOGE("Malformed precompiled key character map file %s.", filename.c_str());
+                goto Done;
+            }
+
+            Key* key = new Key();
+            key->label = binaryKey.label;
+            key->number = binaryKey.number;
+            map->mKeys.add(binaryKey.keyCode, key);
+
+            Behavior* lastBehavior = nullptr;
+            for (uint32_t j = 0; j < binaryKey.behaviorCount; j++) {
+                const BinaryBehavior& binaryBehavior = behaviors[binaryKey.firstBehavior + j];
+                Behavior* behavior = new Behavior();
+                behavior->metaState = binaryBehavior.metaState;
+                behavior->character = binaryBehavior.character;
+                behavior->fallbackKeyCode = binaryBehavior.fallbackKeyCode;
+                behavior->replacementKeyCode = binaryBehavior.replacementKeyCode;
+                if (lastBehavior) {
+                    lastBehavior->next = behavior;
+                } else {
+                    key->firstBehavior = behavior;
+                }
+                lastBehavior = behavior;
+            }
+        }
+
+        for (uint32_t i = 0; i < header->numScanCodes; i++) {
+            map->mKeysByScanCode.add(scanCodes[i].fromCode, scanCodes[i].keyCode);
+        }
+        for (uint32_t i = 0; i < header->numUsageCodes; i++) {
+            map->mKeysByUsageCode.add(usageCodes[i].fromCode, usageCodes[i].keyCode);
+        }
+
+        *outMap = map;
+        status = OK;
+    }
+
+Done:
+    ::munmap(base, size);
+    return status;
+}
+
+status_t KeyCharacterMap::saveCompiled(const std::string& filename) const {
+    BinaryHeader header;
+    header.magic = BINARY_MAGIC;
+    header.version = BINARY_VERSION;
+    header.type = mType;
+    header.numKeys = mKeys.size();
+    header.numBehaviors = 0;
+    header.numScanCodes = mKeysByScanCode.size();
+    header.numUsageCodes = mKeysByUsageCode.size();
+
+    Vector<BinaryKey> keys;
+    Vector<BinaryBehavior> behaviors;
+    for (size_t i = 0; i < mKeys.size(); i++) {
+        const Key* key = mKeys.valueAt(i);
+
+        BinaryKey binaryKey;
+        binaryKey.keyCode = mKeys.keyAt(i);
+        binaryKey.label = key->label;
+        binaryKey.number = key->number;
+        binaryKey.firstBehavior = behaviors.size();
+        binaryKey.behaviorCount = 0;
+
+        for (const Behavior* behavior = key->firstBehavior; behavior != nullptr;
+                behavior = behavior->next) {
+            BinaryBehavior binaryBehavior;
+            binaryBehavior.metaState = behavior->metaState;
+            binaryBehavior.character = behavior->character;
+            binaryBehavior.reserved = 0;
+            binaryBehavior.fallbackKeyCode = behavior->fallbackKeyCode;
+            binaryBehavior.replacementKeyCode = behavior->replacementKeyCode;
+            behaviors.push(binaryBehavior);
+            binaryKey.behaviorCount += 1;
+        }
+        keys.push(binaryKey);
+    }
+    header.numBehaviors = behaviors.size();
+
+    Vector<BinaryCode> scanCodes;
+    for (size_t i = 0; i < mKeysByScanCode.size(); i++) {
+        BinaryCode code;
+        code.fromCode = mKeysByScanCode.keyAt(i);
+        code.keyCode = mKeysByScanCode.valueAt(i);
+        scanCodes.push(code);
+    }
+    Vector<BinaryCode> usageCodes;
+    for (size_t i = 0; i < mKeysByUsageCode.size(); i++) {
+        BinaryCode code;
+        code.fromCode = mKeysByUsageCode.keyAt(i);
+        code.keyCode = mKeysByUsageCode.valueAt(i);
+        usageCodes.push(code);
+    }
+
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        status_t status = -errno;
+        ALOGE("Error %d creating precompiled key character map file %s.", errno,
+                filename.c_str());
+        return status;
+    }
+
+    status_t status = OK;
+    const struct {
+        const void* data;
+        size_t size;
+    } sections[] = {
+            { &header, sizeof(header) },
+            { keys.array(), keys.size() * sizeof(BinaryKey) },
+            { behaviors.array(), behaviors.size() * sizeof(BinaryBehavior) },
+            { scanCodes.array(), scanCodes.size() * sizeof(BinaryCode) },
+            { usageCodes.array(), usageCodes.size() * sizeof(BinaryCode) },
+    };
+    for (const auto& section : sections) {
+        const uint8_t* data = static_cast<const uint8_t*>(section.data);
+        size_t remaining = section.size;
+        while (remaining) {
+            ssize_t written = ::write(fd, data, remaining);
+            if (written < 0) {
+                status = -errno;
+                ALOGE("Error %d writing precompiled key character map file %s.", errno,
+                        filename.c_str());
+                break;
+            }
+            data += written;
+            remaining -= written;
+        }
+        if (status) {
+            break;
+        }
+    }
+    ::close(fd);
+    return status;
+}
+
 status_t KeyCharacterMap::load(Tokenizer* tokenizer,
         Format format, sp<KeyCharacterMap>* outMap) {
     status_t status = OK;
@@ -18,11 +18,25 @@
 
 #include <android-base/chrono_utils.h>
 
+#include <algorithm>
 #include <cmath>
+#include <iterator>
 #include <limits>
 
 namespace android {
 
+/**
+ * Map a sample to its histogram bucket. Bucket 0 holds values below 1,
+ * bucket i holds values in [2^(i-1), 2^i).
+ */
+static size_t bucketIndex(float value) {
+    if (value < 1) {
+        return 0;
+    }
+    const size_t index = static_cast<size_t>(std::ilogb(value)) + 1;
+    return std::min(index, LatencyStatistics::NUM_BUCKETS - 1);
+}
+
 LatencyStatistics::LatencyStatistics(std::chrono::seconds period) : mReportPeriod(period) {
     reset();
 }
@@ -39,6 +53,7 @@ void LatencyStatistics::addValue(float value) {
     }
     mSum += value;
     mSum2 += value * value;
+    mBuckets[bucketIndex(value)]++;
     mCount++;
 }
 
@@ -65,6 +80,32 @@ float LatencyStatistics::getMax() {
     return mMax;
 }
 
+/**
+ * Estimate the value below which the given fraction of samples falls, using the
+ * histogram. Within the bucket holding the requested rank the estimate is
+ * linearly interpolated, and the result is clamped to the recorded [min, max]
+ * range. Should not be called if no samples have been added.
+ */
+float LatencyStatistics::getPercentile(float fraction) {
+    if (mCount == 0) {
+        return std::nanf("");
+    }
+    const float rank = fraction * mCount;
+    size_t cumulative = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        if (cumulative + mBuckets[i] < rank) {
+            cumulative += mBuckets[i];
+            continue;
+        }
+        const float lower = (i == 0) ? 0 : exp2f(i - 1);
+        const float upper = exp2f(i);
+        const float position = (rank - cumulative) / mBuckets[i];
+        const float estimate = lower + position * (upper - lower);
+        return std::max(mMin, std::min(mMax, estimate));
+    }
+    return mMax;
+}
+
 size_t LatencyStatistics::getCount() {
     return mCount;
 }
@@ -79,6 +120,7 @@ void LatencyStatistics::reset() {
     mSum = 0;
     mSum2 = 0;
     mCount = 0;
+    std::fill(std::begin(mBuckets), std::end(mBuckets), 0);
     mLastReportTime = std::chrono::steady_clock::now();
 }
 
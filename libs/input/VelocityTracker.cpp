@@ -410,8 +410,14 @@ void LeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime, BitSet3
  *
  * Returns true if a solution is found, false otherwise.
  *
- * The input consists of two vectors of data points X and Y with indices 0..m-1
- * along with a weight vector W of the same size.
+ * The input consists of a vector of data points X with indices 0..m-1, two vectors
+ * of observations Y1 and Y2 sharing those abscissae (in practice the x and y screen
+ * coordinates of a pointer sampled at the same times), and a weight vector W of the
+ * same size.  Both observation vectors are fitted in a single call because the
+ * expensive QR factorization depends only on X and W and can be shared between them.
+ *
+ * In the description below, Y and B stand for either observation vector and its
+ * corresponding output.
  *
  * The output is a vector B with indices 0..n that describes a polynomial
  * that fits the data, such the sum of W[i] * W[i] * abs(Y[i] - (B[0] + B[1] X[i]
@@ -453,12 +459,13 @@ void LeastSquaresVelocityTrackerStrategy::addMovement(nsecs_t eventTime, BitSet3
  * http://en.wikipedia.org/wiki/Numerical_methods_for_linear_least_squares
  * http://en.wikipedia.org/wiki/Gram-Schmidt
  */
-static bool solveLeastSquares(const float* x, const float* y,
-        const float* w, uint32_t m, uint32_t n, float* outB, float* outDet) {
+static bool solveLeastSquares(const float* x, const float* y1, const float* y2,
+        const float* w, uint32_t m, uint32_t n, float* outB1, float* outDet1,
+        float* outB2, float* outDet2) {
 #if DEBUG_STRATEGY
-    ALOGD("solveLeastSquares: m=%d, n=%d, x=%s, y=%s, w=%s", int(m), int(n),
-            vectorToString(x, m).c_str(), vectorToString(y, m).c_str(),
-            vectorToString(w, m).c_str());
+    ALOGD("solveLeastSquares: m=%d, n=%d, x=%s, y1=%s, y2=%s, w=%s", int(m), int(n),
+            vectorToString(x, m).c_str(), vectorToString(y1, m).c_str(),
+            vectorToString(y2, m).c_str(), vectorToString(w, m).c_str());
 #endif
 
     // Expand the X vector to a matrix A, pre-multiplied by the weights.
@@ -521,53 +528,60 @@ static bool solveLeastSquares(const float* x, const float* y,
     ALOGD("  - qr=%s", matrixToString(&qr[0][0], m, n, false /*rowMajor*/).c_str());
 #endif
 
-    // Solve R B = Qt W Y to find B.  This is easy because R is upper triangular.
-    // We just work from bottom-right to top-left calculating B's coefficients.
-    float wy[m];
-    for (uint32_t h = 0; h < m; h++) {
-        wy[h] = y[h] * w[h];
-    }
-    for (uint32_t i = n; i != 0; ) {
-        i--;
-        outB[i] = vectorDot(&q[i][0], wy, m);
-        for (uint32_t j = n - 1; j > i; j--) {
-            outB[i] -= r[i][j] * outB[j];
+    // The factorization above only depends on the sample times and weights, so it is
+    // shared between the right hand sides; each axis only pays for a back substitution.
+    auto solveForRhs = [&](const float* y, float* outB, float* outDet) {
+        // Solve R B = Qt W Y to find B.  This is easy because R is upper triangular.
+        // We just work from bottom-right to top-left calculating B's coefficients.
+        float wy[m];
+        for (uint32_t h = 0; h < m; h++) {
+            wy[h] = y[h] * w[h];
+        }
+        for (uint32_t i = n; i != 0; ) {
+            i--;
+            outB[i] = vectorDot(&q[i][0], wy, m);
+            for (uint32_t j = n - 1; j > i; j--) {
+                outB[i] -= r[i][j] * outB[j];
+            }
+            outB[i] /= r[i][i];
         }
-        outB[i] /= r[i][i];
-    }
 #if DEBUG_STRATEGY
-    ALOGD("  - b=%s", vectorToString(outB, n).c_str());
+        ALOGD("  - b=%s", vectorToString(outB, n).c_str());
 #endif
 
-    // Calculate the coefficient of determination as 1 - (SSerr / SStot) where
-    // SSerr is the residual sum of squares (variance of the error),
-    // and SStot is the total sum of squares (variance of the data) where each
-    // has been weighted.
-    float ymean = 0;
-    for (uint32_t h = 0; h < m; h++) {
-        ymean += y[h];
-    }
-    ymean /= m;
+        // Calculate the coefficient of determination as 1 - (SSerr / SStot) where
+        // SSerr is the residual sum of squares (variance of the error),
+        // and SStot is the total sum of squares (variance of the data) where each
+        // has been weighted.
+        float ymean = 0;
+        for (uint32_t h = 0; h < m; h++) {
+            ymean += y[h];
+        }
+        ymean /= m;
 
-    float sserr = 0;
-    float sstot = 0;
-    for (uint32_t h = 0; h < m; h++) {
-        float err = y[h] - outB[0];
-        float term = 1;
-        for (uint32_t i = 1; i < n; i++) {
-            term *= x[h];
-            err -= term * outB[i];
+        float sserr = 0;
+        float sstot = 0;
+        for (uint32_t h = 0; h < m; h++) {
+            float err = y[h] - outB[0];
+            float term = 1;
+            for (uint32_t i = 1; i < n; i++) {
+                term *= x[h];
+                err -= term * outB[i];
+            }
+            sserr += w[h] * w[h] * err * err;
+            float var = y[h] - ymean;
+            sstot += w[h] * w[h] * var * var;
         }
-        sserr += w[h] * w[h] * err * err;
-        float var = y[h] - ymean;
-        sstot += w[h] * w[h] * var * var;
-    }
-    *outDet = sstot > 0.000001f ? 1.0f - (sserr / sstot) : 1;
+        *outDet = sstot > 0.000001f ? 1.0f - (sserr / sstot) : 1;
 #if DEBUG_STRATEGY
-    ALOGD("  - sserr=%f", sserr);
-    ALOGD("  - sstot=%f", sstot);
-    ALOGD("  - det=%f", *outDet);
+        ALOGD("  - sserr=%f", sserr);
+        ALOGD("  - sstot=%f", sstot);
+        ALOGD("  - det=%f", *outDet);
 #endif
+    };
+
+    solveForRhs(y1, outB1, outDet1);
+    solveForRhs(y2, outB2, outDet2);
     return true;
 }
 
@@ -682,8 +696,8 @@ bool LeastSquaresVelocityTrackerStrategy::getEstimator(uint32_t id,
         // General case for an Nth degree polynomial fit
         float xdet, ydet;
         uint32_t n = degree + 1;
-        if (solveLeastSquares(time, x, w, m, n, outEstimator->xCoeff, &xdet)
-                && solveLeastSquares(time, y, w, m, n, outEstimator->yCoeff, &ydet)) {
+        if (solveLeastSquares(time, x, y, w, m, n, outEstimator->xCoeff, &xdet,
+                              outEstimator->yCoeff, &ydet)) {
             outEstimator->time = newestMovement.eventTime;
             outEstimator->degree = degree;
             outEstimator->confidence = xdet * ydet;
@@ -188,13 +188,21 @@ void InputPublisherAndConsumerTest::PublishAndConsumeMotionEvent() {
         pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_TOOL_MAJOR, 2.7 * i);
         pointerCoords[i].setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, 3.5 * i);
     }
+    PointerComputedState computedStates[pointerCount];
+    for (size_t i = 0; i < pointerCount; i++) {
+        computedStates[i].valid = true;
+        computedStates[i].velocityX = 10.f * i;
+        computedStates[i].velocityY = 20.f * i;
+        computedStates[i].predictedX = 100.f * i + 1;
+        computedStates[i].predictedY = 200.f * i + 2;
+    }
 
     status = mPublisher->publishMotionEvent(seq, eventId, deviceId, source, displayId, hmac, action,
                                             actionButton, flags, edgeFlags, metaState, buttonState,
                                             classification, xScale, yScale, xOffset, yOffset,
                                             xPrecision, yPrecision, xCursorPosition,
                                             yCursorPosition, downTime, eventTime, pointerCount,
-                                            pointerProperties, pointerCoords);
+                                            pointerProperties, pointerCoords, computedStates);
     ASSERT_EQ(OK, status)
             << "publisher publishMotionEvent should return OK";
 
@@ -268,7 +276,15 @@ void InputPublisherAndConsumerTest::PublishAndConsumeMotionEvent() {
                 motionEvent->getToolMinor(i));
         EXPECT_EQ(pointerCoords[i].getAxisValue(AMOTION_EVENT_AXIS_ORIENTATION),
                 motionEvent->getOrientation(i));
+
+        const PointerComputedState computedState = mConsumer->getComputedState(i);
+        EXPECT_TRUE(computedState.valid);
+        EXPECT_EQ(computedStates[i].velocityX, computedState.velocityX);
+        EXPECT_EQ(computedStates[i].velocityY, computedState.velocityY);
+        EXPECT_EQ(computedStates[i].predictedX, computedState.predictedX);
+        EXPECT_EQ(computedStates[i].predictedY, computedState.predictedY);
     }
+    EXPECT_FALSE(mConsumer->getComputedState(pointerCount).valid);
 
     status = mConsumer->sendFinishedSignal(seq, false);
     ASSERT_EQ(OK, status)
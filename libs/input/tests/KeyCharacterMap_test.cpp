@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <android/keycodes.h>
+#include <gtest/gtest.h>
+#include <input/KeyCharacterMap.h>
+
+namespace android {
+
+static const char* CONTENTS = "type FULL\n"
+        "\n"
+        "map key 17 W\n"
+        "map key usage 0x070037 PERIOD\n"
+        "\n"
+        "key A {\n"
+        "    label:                              'A'\n"
+        "    base:                               'a'\n"
+        "    shift, capslock:                    'A'\n"
+        "    ctrl:                               fallback TAB\n"
+        "}\n"
+        "\n"
+        "key 8 {\n"
+        "    label, number:                      '8'\n"
+        "    base:                               '8'\n"
+        "    shift:                              '*'\n"
+        "}\n";
+
+class KeyCharacterMapTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+        ASSERT_EQ(OK, KeyCharacterMap::loadContents("test.kcm", CONTENTS,
+                KeyCharacterMap::FORMAT_BASE, &mMap));
+    }
+
+    sp<KeyCharacterMap> mMap;
+};
+
+TEST_F(KeyCharacterMapTest, compiledRoundTrip) {
+    char filename[] = "/data/local/tmp/kcm_test.XXXXXX";
+    int fd = mkstemp(filename);
+    ASSERT_GE(fd, 0);
+    ::close(fd);
+
+    ASSERT_EQ(OK, mMap->saveCompiled(filename));
+
+    sp<KeyCharacterMap> map;
+    ASSERT_EQ(OK, KeyCharacterMap::loadCompiled(filename, KeyCharacterMap::FORMAT_BASE, &map));
+    ::unlink(filename);
+
+    ASSERT_EQ(mMap->getKeyboardType(), map->getKeyboardType());
+
+    ASSERT_EQ(u'A', map->getDisplayLabel(AKEYCODE_A));
+    ASSERT_EQ(u'a', map->getCharacter(AKEYCODE_A, 0));
+    ASSERT_EQ(u'A', map->getCharacter(AKEYCODE_A, AMETA_SHIFT_ON));
+    ASSERT_EQ(u'A', map->getCharacter(AKEYCODE_A, AMETA_CAPS_LOCK_ON));
+
+    KeyCharacterMap::FallbackAction action;
+    ASSERT_TRUE(map->getFallbackAction(AKEYCODE_A, AMETA_CTRL_ON, &action));
+    ASSERT_EQ(AKEYCODE_TAB, action.keyCode);
+
+    ASSERT_EQ(u'8', map->getNumber(AKEYCODE_8));
+    ASSERT_EQ(u'*', map->getCharacter(AKEYCODE_8, AMETA_SHIFT_ON));
+
+    int32_t keyCode;
+    ASSERT_EQ(OK, map->mapKey(17, 0, &keyCode));
+    ASSERT_EQ(AKEYCODE_W, keyCode);
+    ASSERT_EQ(OK, map->mapKey(0, 0x070037, &keyCode));
+    ASSERT_EQ(AKEYCODE_PERIOD, keyCode);
+}
+
+TEST_F(KeyCharacterMapTest, compiledRejectsWrongFormat) {
+    char filename[] = "/data/local/tmp/kcm_test.XXXXXX";
+    int fd = mkstemp(filename);
+    ASSERT_GE(fd, 0);
+    ::close(fd);
+
+    ASSERT_EQ(OK, mMap->saveCompiled(filename));
+
+    // The map declares "type FULL", so it must not load as an overlay.
+    sp<KeyCharacterMap> map;
+    ASSERT_NE(OK, KeyCharacterMap::loadCompiled(filename, KeyCharacterMap::FORMAT_OVERLAY, &map));
+    ::unlink(filename);
+}
+
+} // namespace android
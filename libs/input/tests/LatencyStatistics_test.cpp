@@ -62,6 +62,27 @@ TEST(LatencyStatisticsTest, AddMultipleStatsValue) {
     ASSERT_EQ(stdev * stdev, 5.0);
 }
 
+TEST(LatencyStatisticsTest, GetPercentile) {
+    LatencyStatistics stats{5min};
+    for (int i = 0; i < 98; i++) {
+        stats.addValue(10.0);
+    }
+    stats.addValue(1000.0);
+    stats.addValue(1000.0);
+
+    // The estimate is interpolated within power-of-two buckets, so only check
+    // that the tail samples move P99 but not P95.
+    float p95 = stats.getPercentile(0.95f);
+    float p99 = stats.getPercentile(0.99f);
+    ASSERT_GE(p95, 10.0);
+    ASSERT_LT(p95, 16.0);
+    ASSERT_GT(p99, 100.0);
+    ASSERT_LE(p99, 1000.0);
+
+    stats.reset();
+    ASSERT_EQ(std::isnan(stats.getPercentile(0.95f)), true);
+}
+
 TEST(LatencyStatisticsTest, ShouldReportStats) {
     LatencyStatistics stats{0min};
     stats.addValue(5.0);
@@ -75,6 +75,14 @@ void TestInputMessageAlignment() {
   CHECK_OFFSET(InputMessage::Body::Motion, pointerCount, 128);
   CHECK_OFFSET(InputMessage::Body::Motion, pointers, 136);
 
+  CHECK_OFFSET(InputMessage::Body::Motion::Pointer, properties, 0);
+  CHECK_OFFSET(InputMessage::Body::Motion::Pointer, computedStateValid, 8);
+  CHECK_OFFSET(InputMessage::Body::Motion::Pointer, velocityX, 12);
+  CHECK_OFFSET(InputMessage::Body::Motion::Pointer, velocityY, 16);
+  CHECK_OFFSET(InputMessage::Body::Motion::Pointer, predictedX, 20);
+  CHECK_OFFSET(InputMessage::Body::Motion::Pointer, predictedY, 24);
+  CHECK_OFFSET(InputMessage::Body::Motion::Pointer, coords, 32);
+
   CHECK_OFFSET(InputMessage::Body::Focus, seq, 0);
   CHECK_OFFSET(InputMessage::Body::Focus, eventId, 4);
   CHECK_OFFSET(InputMessage::Body::Focus, hasFocus, 12);
@@ -16,10 +16,16 @@
 
 #include <renderengine/RenderEngine.h>
 
+#include <inttypes.h>
+
+#include <algorithm>
+
 #include <cutils/properties.h>
 #include <log/log.h>
 #include <private/gui/SyncFeatures.h>
 #include "gl/GLESRenderEngine.h"
+#include "threaded/RenderEnginePool.h"
+#include "threaded/RenderEngineThreaded.h"
 
 namespace android {
 namespace renderengine {
@@ -31,12 +37,45 @@ std::unique_ptr<impl::RenderEngine> RenderEngine::create(const RenderEngineCreat
         ALOGD("RenderEngine GLES Backend");
         return renderengine::gl::GLESRenderEngine::create(args);
     }
+    if (strcmp(prop, "threaded") == 0) {
+        ALOGD("RenderEngine Threaded GLES Backend");
+        return renderengine::threaded::RenderEngineThreaded::create(
+                [args]() { return renderengine::gl::GLESRenderEngine::create(args); }, args);
+    }
+    if (strcmp(prop, "pooled") == 0) {
+        // One GL context per pooled worker; multi-display client composition
+        // draws concurrently instead of serializing on a single context.
+        int64_t poolSize = property_get_int64(PROPERTY_DEBUG_RENDERENGINE_POOL_SIZE, 2);
+        poolSize = std::min<int64_t>(std::max<int64_t>(poolSize, 2), 4);
+        ALOGD("RenderEngine Pooled GLES Backend (%" PRId64 " contexts)", poolSize);
+        return renderengine::threaded::RenderEnginePool::create(
+                [args]() { return renderengine::gl::GLESRenderEngine::create(args); }, args,
+                static_cast<size_t>(poolSize));
+    }
     ALOGE("UNKNOWN BackendType: %s, create GLES RenderEngine.", prop);
     return renderengine::gl::GLESRenderEngine::create(args);
 }
 
 RenderEngine::~RenderEngine() = default;
 
+std::future<DrawLayersResult> RenderEngine::drawLayersAsync(const DisplaySettings& display,
+                                                            std::vector<LayerSettings> layers,
+                                                            ANativeWindowBuffer* buffer,
+                                                            const bool useFramebufferCache,
+                                                            base::unique_fd&& bufferFence) {
+    // Backends without a dedicated render thread execute the draw in place
+    // and hand back an already-satisfied future.
+    std::vector<const LayerSettings*> layerPointers(layers.size());
+    std::transform(layers.begin(), layers.end(), layerPointers.begin(),
+                   std::pointer_traits<LayerSettings*>::pointer_to);
+    DrawLayersResult result;
+    result.status = drawLayers(display, layerPointers, buffer, useFramebufferCache,
+                               std::move(bufferFence), &result.drawFence);
+    std::promise<DrawLayersResult> resultPromise;
+    resultPromise.set_value(std::move(result));
+    return resultPromise.get_future();
+}
+
 namespace impl {
 
 RenderEngine::RenderEngine(const RenderEngineCreationArgs& args) : mArgs(args) {}
@@ -20,7 +20,9 @@
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
 #include <sched.h>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <unordered_set>
@@ -401,6 +403,9 @@ GLESRenderEngine::GLESRenderEngine(const RenderEngineCreationArgs& args, EGLDisp
         mFlushTracer = std::make_unique<FlushTracer>(this);
     }
 
+    property_get("debug.renderengine.tonemap_lut", value, "1");
+    mUseToneMapLut = atoi(value) != 0;
+
     if (args.supportsBackgroundBlur) {
         mBlurFilter = new BlurFilter(*this);
         checkErrors("BlurFilter creation");
@@ -442,6 +447,10 @@ GLESRenderEngine::~GLESRenderEngine() {
     }
     eglDestroyImageKHR(mEGLDisplay, mPlaceholderImage);
     mImageCache.clear();
+    for (const auto& [key, texture] : mToneMapLutCache) {
+        glDeleteTextures(1, &texture);
+    }
+    mToneMapLutCache.clear();
     eglMakeCurrent(mEGLDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     eglTerminate(mEGLDisplay);
 }
@@ -459,6 +468,13 @@ Framebuffer* GLESRenderEngine::getFramebufferForDrawing() {
 }
 
 void GLESRenderEngine::primeCache() const {
+    // Persist driver program binaries across boots so priming (and any
+    // shader first appearing later) links a cached binary instead of
+    // compiling GLSL.
+    char cacheFilename[PROPERTY_VALUE_MAX];
+    property_get("debug.renderengine.program_binary_cache_path", cacheFilename,
+                 "/data/system/sf_program_cache");
+    ProgramCache::getInstance().setCacheFilename(cacheFilename);
     ProgramCache::getInstance().primeCache(mInProtectedContext ? mProtectedEGLContext : mEGLContext,
                                            mArgs.useColorManagement,
                                            mArgs.precacheToneMapperShaderOnly);
@@ -705,6 +721,13 @@ std::shared_ptr<ImageManager::Barrier> GLESRenderEngine::cacheExternalTextureBuf
     return barrier;
 }
 
+std::shared_ptr<ImageManager::Barrier> GLESRenderEngine::cacheExternalTextureBufferBatchForTesting(
+        const std::vector<sp<GraphicBuffer>>& buffers) {
+    auto barrier = std::make_shared<ImageManager::Barrier>();
+    mImageManager->cacheBatchAsync(buffers, barrier);
+    return barrier;
+}
+
 status_t GLESRenderEngine::cacheExternalTextureBufferInternal(const sp<GraphicBuffer>& buffer) {
     if (buffer == nullptr) {
         return BAD_VALUE;
@@ -952,6 +975,27 @@ bool GLESRenderEngine::cleanupPostRender(CleanupMode mode) {
     return true;
 }
 
+void GLESRenderEngine::setCleanupCallback(const std::function<void()>& callback) {
+    {
+        std::lock_guard<std::mutex> lock(mCleanupCallbackMutex);
+        mCleanupCallback = callback;
+    }
+    if (callback != nullptr && mCleanupMonitor == nullptr) {
+        mCleanupMonitor = std::make_unique<CleanupMonitor>(this);
+    }
+}
+
+void GLESRenderEngine::invokeCleanupCallback() {
+    std::function<void()> callback;
+    {
+        std::lock_guard<std::mutex> lock(mCleanupCallbackMutex);
+        callback = mCleanupCallback;
+    }
+    if (callback) {
+        callback();
+    }
+}
+
 void GLESRenderEngine::checkErrors() const {
     checkErrors(nullptr);
 }
@@ -1026,6 +1070,62 @@ EGLImageKHR GLESRenderEngine::createFramebufferImageIfNeeded(ANativeWindowBuffer
     return image;
 }
 
+static void hashBytes(uint64_t& hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+}
+
+template <typename T>
+static void hashValue(uint64_t& hash, const T& value) {
+    hashBytes(hash, &value, sizeof(T));
+}
+
+// Fingerprints the inputs that determine what gets composited beneath the
+// given blur layer, so BlurFilter can skip its downsample and blur passes
+// when the backdrop is static. Buffer contents are identified by buffer id,
+// which is sufficient because clients never render into a buffer that is
+// still on screen. Returns a non-zero 64-bit FNV-1a hash; 0 is reserved to
+// mean "unknown".
+static uint64_t blurSourceFingerprint(const DisplaySettings& display,
+                                      const std::vector<const LayerSettings*>& layers,
+                                      const LayerSettings* blurLayer) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hashValue(hash, display.physicalDisplay);
+    hashValue(hash, display.clip);
+    hashValue(hash, display.maxLuminance);
+    hashValue(hash, display.outputDataspace);
+    hashValue(hash, display.colorTransform);
+    hashValue(hash, display.orientation);
+    for (auto layer : layers) {
+        if (layer == blurLayer) {
+            break;
+        }
+        const uint64_t bufferId =
+                layer->source.buffer.buffer != nullptr ? layer->source.buffer.buffer->getId() : 0;
+        hashValue(hash, bufferId);
+        hashValue(hash, layer->source.buffer.useTextureFiltering);
+        hashValue(hash, layer->source.buffer.textureTransform);
+        hashValue(hash, layer->source.buffer.usePremultipliedAlpha);
+        hashValue(hash, layer->source.buffer.isOpaque);
+        hashValue(hash, layer->source.buffer.isY410BT2020);
+        hashValue(hash, layer->source.buffer.maxMasteringLuminance);
+        hashValue(hash, layer->source.buffer.maxContentLuminance);
+        hashValue(hash, layer->source.solidColor);
+        hashValue(hash, layer->geometry.boundaries);
+        hashValue(hash, layer->geometry.positionTransform);
+        hashValue(hash, layer->geometry.roundedCornersRadius);
+        hashValue(hash, layer->geometry.roundedCornersCrop);
+        hashValue(hash, layer->alpha);
+        hashValue(hash, layer->sourceDataspace);
+        hashValue(hash, layer->colorTransform);
+        hashValue(hash, layer->disableBlending);
+        hashValue(hash, layer->shadow.length);
+    }
+    return hash == 0 ? 1 : hash;
+}
+
 status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
                                       const std::vector<const LayerSettings*>& layers,
                                       ANativeWindowBuffer* const buffer,
@@ -1063,6 +1163,15 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
         }
     }
     const auto blurLayersSize = blurLayers.size();
+    if (CC_LIKELY(mBlurFilter != nullptr)) {
+        // With a single blur layer the ping-pong buffers hold exactly that
+        // layer's result across frames, so a matching fingerprint lets the
+        // filter reuse it. With multiple blur layers the buffers are shared
+        // and we always re-render.
+        mBlurFilter->setSourceFingerprint(
+                blurLayersSize == 1 ? blurSourceFingerprint(display, layers, blurLayers.front())
+                                    : 0);
+    }
 
     if (blurLayersSize == 0) {
         fbo = std::make_unique<BindNativeBufferAsFramebuffer>(*this, buffer, useFramebufferCache);
@@ -1243,6 +1352,9 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
         // The caller takes ownership of drawFence, so we need to duplicate the
         // fd here.
         mLastDrawFence = new Fence(dup(drawFence->get()));
+        if (mCleanupMonitor != nullptr) {
+            mCleanupMonitor->queueFence(mLastDrawFence);
+        }
     }
     mPriorResourcesCleaned = false;
 
@@ -1341,31 +1453,171 @@ void GLESRenderEngine::setupCornerRadiusCropSize(float width, float height) {
     mState.cropSize = half2(width, height);
 }
 
+GLVertexBuffer* GLESRenderEngine::vertexBufferForMesh(const Mesh& mesh) {
+    const size_t floatCount = (mesh.getByteStride() / sizeof(float)) * mesh.getVertexCount();
+    if (floatCount == 0) {
+        return nullptr;
+    }
+    const float* data = mesh.getPositions();
+
+    // 64-bit FNV-1a over the raw vertex contents.
+    uint64_t hash = 0xcbf29ce484222325ull;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < floatCount * sizeof(float); i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+
+    for (auto it = mMeshBufferCache.begin(); it != mMeshBufferCache.end(); it++) {
+        if (it->hash == hash && it->contents.size() == floatCount &&
+            memcmp(it->contents.data(), data, floatCount * sizeof(float)) == 0) {
+            // Move the entry to the front so eviction stays approximately
+            // least-recently-used.
+            if (it != mMeshBufferCache.begin()) {
+                std::rotate(mMeshBufferCache.begin(), it, it + 1);
+            }
+            return mMeshBufferCache.front().buffer.get();
+        }
+    }
+
+    MeshBuffer entry;
+    entry.hash = hash;
+    entry.contents.assign(data, data + floatCount);
+    entry.buffer = std::make_unique<GLVertexBuffer>();
+    entry.buffer->allocateBuffers(data, static_cast<GLuint>(floatCount));
+    mMeshBufferCache.emplace_front(std::move(entry));
+    if (mMeshBufferCache.size() > kMaxMeshBufferCacheSize) {
+        mMeshBufferCache.pop_back();
+    }
+    return mMeshBufferCache.front().buffer.get();
+}
+
+// CPU mirror of the HDR -> SDR ToneMap curve in
+// ProgramCache::generateToneMappingProcess, evaluated once per LUT entry so
+// the fragment shader can replace the whole spline with one texture sample.
+static float toneMapNits(float nits, float maxInLumi, float maxOutLumi) {
+    nits = std::clamp(nits, 0.0f, maxInLumi);
+    if (maxInLumi <= maxOutLumi) {
+        return nits * (maxOutLumi / maxInLumi);
+    }
+
+    // three control points
+    const float x0 = 10.0f;
+    const float y0 = 17.0f;
+    const float x1 = maxOutLumi * 0.75f;
+    const float y1 = x1;
+    const float x2 = x1 + (maxInLumi - x1) / 2.0f;
+    const float y2 = y1 + (maxOutLumi - y1) * 0.75f;
+
+    // horizontal distances between the last three control points
+    const float h12 = x2 - x1;
+    const float h23 = maxInLumi - x2;
+    // tangents at the last three control points
+    const float m1 = (y2 - y1) / h12;
+    const float m3 = (maxOutLumi - y2) / h23;
+    const float m2 = (m1 + m3) / 2.0f;
+
+    if (nits < x0) {
+        return nits * (y0 / x0);
+    }
+    if (nits < x1) {
+        return y0 + (nits - x0) * ((y1 - y0) / (x1 - x0));
+    }
+    if (nits < x2) {
+        const float t = (nits - x1) / h12;
+        return (y1 * (1.0f + 2.0f * t) + h12 * m1 * t) * (1.0f - t) * (1.0f - t) +
+                (y2 * (3.0f - 2.0f * t) + h12 * m2 * (t - 1.0f)) * t * t;
+    }
+    const float t = (nits - x2) / h23;
+    return (y2 * (1.0f + 2.0f * t) + h23 * m2 * t) * (1.0f - t) * (1.0f - t) +
+            (maxOutLumi * (3.0f - 2.0f * t) + h23 * m3 * (t - 1.0f)) * t * t;
+}
+
+GLuint GLESRenderEngine::getToneMapLutTexture(float maxInLuminance, float maxOutLuminance) {
+    uint32_t inBits;
+    uint32_t outBits;
+    memcpy(&inBits, &maxInLuminance, sizeof(inBits));
+    memcpy(&outBits, &maxOutLuminance, sizeof(outBits));
+    const uint64_t key = (static_cast<uint64_t>(inBits) << 32) | outBits;
+
+    auto it = mToneMapLutCache.find(key);
+    if (it != mToneMapLutCache.end()) {
+        return it->second;
+    }
+
+    // Must match the texel coordinate math in the toneMapLut shader emitted by
+    // ProgramCache. Each texel stores the output luminance normalized to
+    // maxOutLuminance as 16 bits split across the R (high) and G (low) bytes.
+    static constexpr size_t kLutSize = 256;
+    std::vector<uint8_t> texels(kLutSize * 4, 0);
+    for (size_t i = 0; i < kLutSize; i++) {
+        const float nits = maxInLuminance * static_cast<float>(i) / (kLutSize - 1);
+        const float normalized =
+                std::clamp(toneMapNits(nits, maxInLuminance, maxOutLuminance) / maxOutLuminance,
+                           0.0f, 1.0f);
+        const uint32_t quantized = static_cast<uint32_t>(std::lround(normalized * 65535.0f));
+        texels[i * 4] = static_cast<uint8_t>(quantized >> 8);
+        texels[i * 4 + 1] = static_cast<uint8_t>(quantized & 0xff);
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kLutSize, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 texels.data());
+    glActiveTexture(GL_TEXTURE0);
+
+    mToneMapLutCache.emplace(key, texture);
+    return texture;
+}
+
 void GLESRenderEngine::drawMesh(const Mesh& mesh) {
     ATRACE_CALL();
+
+    // Shadow meshes come out of the tessellation cache with their own
+    // persistent vertex buffer; everything else is drawn out of a cached
+    // vertex buffer keyed on contents so unchanged geometry skips the
+    // per-draw upload.
+    GLVertexBuffer* vertexBuffer =
+            mState.drawShadows ? mShadowVertexBuffer : vertexBufferForMesh(mesh);
+    const float* const base = mesh.getPositions();
+    const auto attribPointer = [&](float const* array) -> const GLvoid* {
+        if (vertexBuffer == nullptr) {
+            return array;
+        }
+        return reinterpret_cast<const GLvoid*>((array - base) * sizeof(float));
+    };
+    if (vertexBuffer != nullptr) {
+        vertexBuffer->bind();
+    }
+
     if (mesh.getTexCoordsSize()) {
         glEnableVertexAttribArray(Program::texCoords);
         glVertexAttribPointer(Program::texCoords, mesh.getTexCoordsSize(), GL_FLOAT, GL_FALSE,
-                              mesh.getByteStride(), mesh.getTexCoords());
+                              mesh.getByteStride(), attribPointer(mesh.getTexCoords()));
     }
 
     glVertexAttribPointer(Program::position, mesh.getVertexSize(), GL_FLOAT, GL_FALSE,
-                          mesh.getByteStride(), mesh.getPositions());
+                          mesh.getByteStride(), attribPointer(mesh.getPositions()));
 
     if (mState.cornerRadius > 0.0f) {
         glEnableVertexAttribArray(Program::cropCoords);
         glVertexAttribPointer(Program::cropCoords, mesh.getVertexSize(), GL_FLOAT, GL_FALSE,
-                              mesh.getByteStride(), mesh.getCropCoords());
+                              mesh.getByteStride(), attribPointer(mesh.getCropCoords()));
     }
 
     if (mState.drawShadows) {
         glEnableVertexAttribArray(Program::shadowColor);
         glVertexAttribPointer(Program::shadowColor, mesh.getShadowColorSize(), GL_FLOAT, GL_FALSE,
-                              mesh.getByteStride(), mesh.getShadowColor());
+                              mesh.getByteStride(), attribPointer(mesh.getShadowColor()));
 
         glEnableVertexAttribArray(Program::shadowParams);
         glVertexAttribPointer(Program::shadowParams, mesh.getShadowParamsSize(), GL_FLOAT, GL_FALSE,
-                              mesh.getByteStride(), mesh.getShadowParams());
+                              mesh.getByteStride(), attribPointer(mesh.getShadowParams()));
     }
 
     Description managedState = mState;
@@ -1467,6 +1719,25 @@ void GLESRenderEngine::drawMesh(const Mesh& mesh) {
         }
     }
 
+    // Sample the HDR -> SDR tone-mapping curve from a precomputed LUT instead
+    // of evaluating it per fragment. Every other conversion, and degenerate
+    // luminance metadata, keeps the analytic shader.
+    if (mUseToneMapLut &&
+        (managedState.inputTransferFunction == Description::TransferFunction::ST2084 ||
+         managedState.inputTransferFunction == Description::TransferFunction::HLG) &&
+        managedState.outputTransferFunction != Description::TransferFunction::ST2084 &&
+        managedState.outputTransferFunction != Description::TransferFunction::HLG) {
+        const float maxInLuminance =
+                std::min(managedState.maxMasteringLuminance, managedState.maxContentLuminance);
+        const float maxOutLuminance = managedState.displayMaxLuminance;
+        if (maxInLuminance > 0.0f && maxOutLuminance > 0.0f) {
+            managedState.useToneMapLut = true;
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, getToneMapLutTexture(maxInLuminance, maxOutLuminance));
+            glActiveTexture(GL_TEXTURE0);
+        }
+    }
+
     ProgramCache::getInstance().useProgram(mInProtectedContext ? mProtectedEGLContext : mEGLContext,
                                            managedState);
 
@@ -1496,6 +1767,10 @@ void GLESRenderEngine::drawMesh(const Mesh& mesh) {
         glDisableVertexAttribArray(Program::shadowColor);
         glDisableVertexAttribArray(Program::shadowParams);
     }
+
+    if (vertexBuffer != nullptr) {
+        vertexBuffer->unbind();
+    }
 }
 
 size_t GLESRenderEngine::getMaxTextureSize() const {
@@ -1525,6 +1800,7 @@ void GLESRenderEngine::dump(std::string& result) {
     StringAppendF(&result, "RenderEngine last dataspace conversion: (%s) to (%s)\n",
                   dataspaceDetails(static_cast<android_dataspace>(mDataSpace)).c_str(),
                   dataspaceDetails(static_cast<android_dataspace>(mOutputDataSpace)).c_str());
+    mImageManager->dump(result);
     {
         std::lock_guard<std::mutex> lock(mRenderingMutex);
         StringAppendF(&result, "RenderEngine image cache size: %zu\n", mImageCache.size());
@@ -1686,6 +1962,52 @@ bool GLESRenderEngine::isFramebufferImageCachedForTesting(uint64_t bufferId) {
 }
 
 // FlushTracer implementation
+GLESRenderEngine::CleanupMonitor::CleanupMonitor(GLESRenderEngine* engine) : mEngine(engine) {
+    mThread = std::thread(&GLESRenderEngine::CleanupMonitor::loop, this);
+}
+
+GLESRenderEngine::CleanupMonitor::~CleanupMonitor() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning = false;
+    }
+    mCondition.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+void GLESRenderEngine::CleanupMonitor::queueFence(const sp<Fence>& fence) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQueue.push(fence);
+    mCondition.notify_one();
+}
+
+void GLESRenderEngine::CleanupMonitor::loop() {
+    while (mRunning) {
+        sp<Fence> fence;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            mCondition.wait(mMutex,
+                            [&]() REQUIRES(mMutex) { return !mQueue.empty() || !mRunning; });
+
+            if (!mRunning) {
+                // if mRunning is false, then CleanupMonitor is being destroyed, so
+                // bail out now.
+                break;
+            }
+            fence = mQueue.front();
+            mQueue.pop();
+        }
+        {
+            ATRACE_NAME("waiting for draw fence");
+            fence->waitForever("CleanupMonitor");
+        }
+        mEngine->invokeCleanupCallback();
+    }
+}
+
 GLESRenderEngine::FlushTracer::FlushTracer(GLESRenderEngine* engine) : mEngine(engine) {
     mThread = std::thread(&GLESRenderEngine::FlushTracer::loop, this);
 }
@@ -1743,31 +2065,71 @@ void GLESRenderEngine::FlushTracer::loop() {
 void GLESRenderEngine::handleShadow(const FloatRect& casterRect, float casterCornerRadius,
                                     const ShadowSettings& settings) {
     ATRACE_CALL();
-    const float casterZ = settings.length / 2.0f;
-    const GLShadowVertexGenerator shadows(casterRect, casterCornerRadius, casterZ,
-                                          settings.casterIsTranslucent, settings.ambientColor,
-                                          settings.spotColor, settings.lightPos,
-                                          settings.lightRadius);
-
-    // setup mesh for both shadows
-    Mesh mesh = Mesh::Builder()
-                        .setPrimitive(Mesh::TRIANGLES)
-                        .setVertices(shadows.getVertexCount(), 2 /* size */)
-                        .setShadowAttrs()
-                        .setIndices(shadows.getIndexCount())
-                        .build();
-
-    Mesh::VertexArray<vec2> position = mesh.getPositionArray<vec2>();
-    Mesh::VertexArray<vec4> shadowColor = mesh.getShadowColorArray<vec4>();
-    Mesh::VertexArray<vec3> shadowParams = mesh.getShadowParamsArray<vec3>();
-    shadows.fillVertices(position, shadowColor, shadowParams);
-    shadows.fillIndices(mesh.getIndicesArray());
+    // Quantize the caster elevation to 1/8px so animating elevations reuse
+    // tessellations; the difference is well below what the penumbra falloff
+    // makes visible.
+    const float casterZ = roundf(settings.length * 4.0f) / 8.0f;
+    const ShadowMeshKey key = {casterRect,
+                               casterCornerRadius,
+                               casterZ,
+                               settings.casterIsTranslucent,
+                               settings.ambientColor,
+                               settings.spotColor,
+                               settings.lightPos,
+                               settings.lightRadius};
+
+    const Mesh* mesh = nullptr;
+    for (auto it = mShadowMeshCache.begin(); it != mShadowMeshCache.end(); it++) {
+        if (it->key == key) {
+            if (it != mShadowMeshCache.begin()) {
+                std::rotate(mShadowMeshCache.begin(), it, it + 1);
+            }
+            mesh = &mShadowMeshCache.front().mesh;
+            mShadowVertexBuffer = mShadowMeshCache.front().buffer.get();
+            break;
+        }
+    }
+    if (mesh == nullptr) {
+        const GLShadowVertexGenerator shadows(casterRect, casterCornerRadius, casterZ,
+                                              settings.casterIsTranslucent, settings.ambientColor,
+                                              settings.spotColor, settings.lightPos,
+                                              settings.lightRadius);
+
+        // setup mesh for both shadows
+        ShadowMesh entry = {key,
+                            Mesh::Builder()
+                                    .setPrimitive(Mesh::TRIANGLES)
+                                    .setVertices(shadows.getVertexCount(), 2 /* size */)
+                                    .setShadowAttrs()
+                                    .setIndices(shadows.getIndexCount())
+                                    .build(),
+                            std::make_unique<GLVertexBuffer>()};
+
+        Mesh::VertexArray<vec2> position = entry.mesh.getPositionArray<vec2>();
+        Mesh::VertexArray<vec4> shadowColor = entry.mesh.getShadowColorArray<vec4>();
+        Mesh::VertexArray<vec3> shadowParams = entry.mesh.getShadowParamsArray<vec3>();
+        shadows.fillVertices(position, shadowColor, shadowParams);
+        shadows.fillIndices(entry.mesh.getIndicesArray());
+
+        const size_t floatCount =
+                (entry.mesh.getByteStride() / sizeof(float)) * entry.mesh.getVertexCount();
+        entry.buffer->allocateBuffers(entry.mesh.getPositions(),
+                                      static_cast<GLuint>(floatCount));
+
+        mShadowMeshCache.emplace_front(std::move(entry));
+        if (mShadowMeshCache.size() > kMaxShadowMeshCacheSize) {
+            mShadowMeshCache.pop_back();
+        }
+        mesh = &mShadowMeshCache.front().mesh;
+        mShadowVertexBuffer = mShadowMeshCache.front().buffer.get();
+    }
 
     mState.cornerRadius = 0.0f;
     mState.drawShadows = true;
     setupLayerTexturing(mShadowTexture.getTexture());
-    drawMesh(mesh);
+    drawMesh(*mesh);
     mState.drawShadows = false;
+    mShadowVertexBuffer = nullptr;
 }
 
 } // namespace gl
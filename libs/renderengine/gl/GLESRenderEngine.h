@@ -23,15 +23,18 @@
 #include <queue>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <GLES2/gl2.h>
 #include <android-base/thread_annotations.h>
+#include <renderengine/Mesh.h>
 #include <renderengine/RenderEngine.h>
 #include <renderengine/private/Description.h>
 #include <sys/types.h>
 #include "GLShadowTexture.h"
+#include "GLVertexBuffer.h"
 #include "ImageManager.h"
 
 #define EGL_NO_CONFIG ((EGLConfig)0)
@@ -76,6 +79,7 @@ public:
                         ANativeWindowBuffer* buffer, const bool useFramebufferCache,
                         base::unique_fd&& bufferFence, base::unique_fd* drawFence) override;
     bool cleanupPostRender(CleanupMode mode) override;
+    void setCleanupCallback(const std::function<void()>& callback) override;
 
     EGLDisplay getEGLDisplay() const { return mEGLDisplay; }
     // Creates an output image for rendering to
@@ -99,6 +103,8 @@ public:
     // objects so that tests can block.
     std::shared_ptr<ImageManager::Barrier> cacheExternalTextureBufferForTesting(
             const sp<GraphicBuffer>& buffer);
+    std::shared_ptr<ImageManager::Barrier> cacheExternalTextureBufferBatchForTesting(
+            const std::vector<sp<GraphicBuffer>>& buffers);
     std::shared_ptr<ImageManager::Barrier> unbindExternalTextureBufferForTesting(uint64_t bufferId);
 
 protected:
@@ -156,6 +162,7 @@ private:
     base::unique_fd flush();
     bool finish();
     bool waitFence(base::unique_fd fenceFd);
+    void invokeCleanupCallback();
     void clearWithColor(float red, float green, float blue, float alpha);
     void fillRegionWithColor(const Region& region, float red, float green, float blue, float alpha);
     void handleShadow(const FloatRect& casterRect, float casterCornerRadius,
@@ -178,6 +185,14 @@ private:
 
     // drawing
     void drawMesh(const Mesh& mesh);
+    // Returns a vertex buffer holding the mesh's vertex data, uploading a
+    // new one on a cache miss. Returns nullptr when the mesh should be drawn
+    // from client arrays instead (empty meshes).
+    GLVertexBuffer* vertexBufferForMesh(const Mesh& mesh);
+
+    // Returns the texture holding the HDR -> SDR tone-mapping LUT tabulated
+    // for the given luminance pair, generating and caching it on first use.
+    GLuint getToneMapLutTexture(float maxInLuminance, float maxOutLuminance);
 
     EGLDisplay mEGLDisplay;
     EGLConfig mEGLConfig;
@@ -208,6 +223,14 @@ private:
     bool mInProtectedContext = false;
     // If set to true, then enables tracing flush() and finish() to systrace.
     bool mTraceGpuCompletion = false;
+    // Whether HDR -> SDR tone mapping samples a precomputed LUT instead of
+    // evaluating the curve per fragment (debug.renderengine.tonemap_lut).
+    bool mUseToneMapLut = false;
+    // Tone-mapping LUT textures, keyed by the (maxInLuminance,
+    // maxOutLuminance) pair each curve was tabulated for. Textures are shared
+    // between the protected and unprotected contexts and only touched on the
+    // GL thread, so no lock is needed.
+    std::unordered_map<uint64_t, GLuint> mToneMapLutCache;
     // Maximum size of mFramebufferImageCache. If more images would be cached, then (approximately)
     // the last recently used buffer should be kicked out.
     uint32_t mFramebufferImageCacheSize = 0;
@@ -219,6 +242,61 @@ private:
     // dumping info.
     std::mutex mFramebufferImageCacheMutex;
 
+    // Maximum size of mMeshBufferCache before (approximately) the least
+    // recently used entry is kicked out.
+    static constexpr size_t kMaxMeshBufferCacheSize = 64;
+
+    // Cache of uploaded vertex buffers, keyed by a hash of the mesh's vertex
+    // contents; each entry also keeps the raw floats to reject hash
+    // collisions. Layers whose geometry did not change since they were last
+    // drawn bind an already-uploaded VBO instead of respecifying client
+    // arrays on every draw. Only touched on the GL thread, so no lock is
+    // needed. Buffer objects are shared between the protected and
+    // unprotected contexts, so entries stay valid across context switches.
+    struct MeshBuffer {
+        uint64_t hash;
+        std::vector<float> contents;
+        std::unique_ptr<GLVertexBuffer> buffer;
+    };
+    std::deque<MeshBuffer> mMeshBufferCache;
+
+    // Maximum number of tessellated shadows kept in mShadowMeshCache.
+    static constexpr size_t kMaxShadowMeshCacheSize = 32;
+
+    // Cache of tessellated shadow geometry, keyed by every input that feeds
+    // the tessellation. Static casters (cards that are not moving) hit the
+    // cache every frame, skipping both the CPU tessellation and the vertex
+    // upload: each entry keeps its own vertex buffer, filled once when the
+    // mesh is generated. Only touched on the GL thread.
+    struct ShadowMeshKey {
+        FloatRect casterRect;
+        float casterCornerRadius;
+        float casterZ;
+        bool casterIsTranslucent;
+        vec4 ambientColor;
+        vec4 spotColor;
+        vec3 lightPos;
+        float lightRadius;
+
+        bool operator==(const ShadowMeshKey& other) const {
+            return casterRect == other.casterRect &&
+                    casterCornerRadius == other.casterCornerRadius && casterZ == other.casterZ &&
+                    casterIsTranslucent == other.casterIsTranslucent &&
+                    ambientColor == other.ambientColor && spotColor == other.spotColor &&
+                    lightPos == other.lightPos && lightRadius == other.lightRadius;
+        }
+    };
+    struct ShadowMesh {
+        ShadowMeshKey key;
+        Mesh mesh;
+        std::unique_ptr<GLVertexBuffer> buffer;
+    };
+    std::deque<ShadowMesh> mShadowMeshCache;
+
+    // Vertex buffer backing the shadow mesh currently being drawn, set by
+    // handleShadow() around its drawMesh() call.
+    GLVertexBuffer* mShadowVertexBuffer = nullptr;
+
     // Current dataspace of layer being rendered
     ui::Dataspace mDataSpace = ui::Dataspace::UNKNOWN;
 
@@ -260,6 +338,27 @@ private:
     // Blur effect processor, only instantiated when a layer requests it.
     BlurFilter* mBlurFilter = nullptr;
 
+    // Waits on the previous frame's draw fence from its own thread and fires the
+    // registered cleanup callback when the GPU is done, so the caller can run
+    // cleanupPostRender right at GPU completion instead of at the start of the
+    // next composition.
+    class CleanupMonitor {
+    public:
+        CleanupMonitor(GLESRenderEngine* engine);
+        ~CleanupMonitor();
+        void queueFence(const sp<Fence>& fence) EXCLUDES(mMutex);
+
+    private:
+        void loop();
+        GLESRenderEngine* const mEngine;
+        std::thread mThread;
+        std::condition_variable_any mCondition;
+        std::mutex mMutex;
+        std::queue<sp<Fence>> mQueue GUARDED_BY(mMutex);
+        bool mRunning = true;
+    };
+    friend class CleanupMonitor;
+
     class FlushTracer {
     public:
         FlushTracer(GLESRenderEngine* engine);
@@ -287,6 +386,12 @@ private:
     friend class BlurFilter;
     friend class GenericProgram;
     std::unique_ptr<FlushTracer> mFlushTracer;
+    // Invoked by mCleanupMonitor when the previous frame's GPU work completes.
+    std::mutex mCleanupCallbackMutex;
+    std::function<void()> mCleanupCallback GUARDED_BY(mCleanupCallbackMutex);
+    // Created by the first setCleanupCallback call, which is expected to happen during
+    // initialization, before the first drawLayers call queues a fence on it.
+    std::unique_ptr<CleanupMonitor> mCleanupMonitor;
     std::unique_ptr<ImageManager> mImageManager = std::make_unique<ImageManager>(this);
 };
 
@@ -21,6 +21,9 @@
 
 #include <pthread.h>
 
+#include <algorithm>
+
+#include <android-base/stringprintf.h>
 #include <processgroup/sched_policy.h>
 #include <utils/Trace.h>
 #include "GLESRenderEngine.h"
@@ -55,7 +58,7 @@ ImageManager::~ImageManager() {
 }
 
 void ImageManager::cacheAsync(const sp<GraphicBuffer>& buffer,
-                              const std::shared_ptr<Barrier>& barrier) {
+                              const std::shared_ptr<Barrier>& barrier, Priority priority) {
     if (buffer == nullptr) {
         {
             std::lock_guard<std::mutex> lock(barrier->mutex);
@@ -66,14 +69,50 @@ void ImageManager::cacheAsync(const sp<GraphicBuffer>& buffer,
         return;
     }
     ATRACE_CALL();
-    QueueEntry entry = {QueueEntry::Operation::Insert, buffer, buffer->getId(), barrier};
+    QueueEntry entry = {QueueEntry::Operation::Insert, buffer, buffer->getId(), barrier, priority};
     queueOperation(std::move(entry));
 }
 
+void ImageManager::cacheBatchAsync(const std::vector<sp<GraphicBuffer>>& buffers,
+                                   const std::shared_ptr<Barrier>& barrier, Priority priority) {
+    ATRACE_CALL();
+    size_t queued = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const sp<GraphicBuffer>& buffer : buffers) {
+            if (buffer == nullptr) {
+                continue;
+            }
+            QueueEntry entry = {QueueEntry::Operation::Insert, buffer, buffer->getId(), nullptr,
+                                priority};
+            queueOperationLocked(entry);
+            queued++;
+        }
+        if (queued > 0) {
+            // The worker services each priority in FIFO order, so the barrier
+            // attached to the last entry opens once the whole batch is done.
+            (priority == Priority::Critical ? mCriticalQueue : mQueue).back().barrier = barrier;
+            traceQueueDepthLocked();
+        }
+    }
+    if (queued > 0) {
+        mCondition.notify_one();
+    } else if (barrier != nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(barrier->mutex);
+            barrier->isOpen = true;
+            barrier->result = BAD_VALUE;
+        }
+        barrier->condition.notify_one();
+    }
+}
+
 status_t ImageManager::cache(const sp<GraphicBuffer>& buffer) {
     ATRACE_CALL();
     auto barrier = std::make_shared<Barrier>();
-    cacheAsync(buffer, barrier);
+    // The caller blocks on the result, so jump ahead of any speculative
+    // prefetches sitting in the queue.
+    cacheAsync(buffer, barrier, Priority::Critical);
     std::lock_guard<std::mutex> lock(barrier->mutex);
     barrier->condition.wait(barrier->mutex,
                             [&]() REQUIRES(barrier->mutex) { return barrier->isOpen; });
@@ -82,19 +121,42 @@ status_t ImageManager::cache(const sp<GraphicBuffer>& buffer) {
 
 void ImageManager::releaseAsync(uint64_t bufferId, const std::shared_ptr<Barrier>& barrier) {
     ATRACE_CALL();
-    QueueEntry entry = {QueueEntry::Operation::Delete, nullptr, bufferId, barrier};
+    QueueEntry entry = {QueueEntry::Operation::Delete, nullptr, bufferId, barrier,
+                        Priority::Speculative};
     queueOperation(std::move(entry));
 }
 
+void ImageManager::dump(std::string& result) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    base::StringAppendF(&result,
+                        "ImageManager queue depth: %zu critical, %zu speculative (max seen: %zu)\n",
+                        mCriticalQueue.size(), mQueue.size(), mMaxQueueDepth);
+}
+
 void ImageManager::queueOperation(const QueueEntry&& entry) {
     {
         std::lock_guard<std::mutex> lock(mMutex);
-        mQueue.emplace(entry);
-        ATRACE_INT("ImageManagerQueueDepth", mQueue.size());
+        queueOperationLocked(entry);
+        traceQueueDepthLocked();
     }
     mCondition.notify_one();
 }
 
+void ImageManager::queueOperationLocked(const QueueEntry& entry) {
+    if (entry.priority == Priority::Critical) {
+        mCriticalQueue.emplace_back(entry);
+    } else {
+        mQueue.emplace_back(entry);
+    }
+}
+
+void ImageManager::traceQueueDepthLocked() {
+    const size_t depth = mCriticalQueue.size() + mQueue.size();
+    mMaxQueueDepth = std::max(mMaxQueueDepth, depth);
+    ATRACE_INT("ImageManagerQueueDepth", depth);
+    ATRACE_INT("ImageManagerCriticalQueueDepth", mCriticalQueue.size());
+}
+
 void ImageManager::threadMain() {
     set_sched_policy(0, SP_FOREGROUND);
     bool run;
@@ -106,8 +168,9 @@ void ImageManager::threadMain() {
         QueueEntry entry;
         {
             std::lock_guard<std::mutex> lock(mMutex);
-            mCondition.wait(mMutex,
-                            [&]() REQUIRES(mMutex) { return !mQueue.empty() || !mRunning; });
+            mCondition.wait(mMutex, [&]() REQUIRES(mMutex) {
+                return !mCriticalQueue.empty() || !mQueue.empty() || !mRunning;
+            });
             run = mRunning;
 
             if (!mRunning) {
@@ -116,9 +179,10 @@ void ImageManager::threadMain() {
                 break;
             }
 
-            entry = mQueue.front();
-            mQueue.pop();
-            ATRACE_INT("ImageManagerQueueDepth", mQueue.size());
+            auto& queue = !mCriticalQueue.empty() ? mCriticalQueue : mQueue;
+            entry = queue.front();
+            queue.pop_front();
+            traceQueueDepthLocked();
         }
 
         status_t result = NO_ERROR;
@@ -17,9 +17,10 @@
 #pragma once
 
 #include <condition_variable>
+#include <deque>
 #include <mutex>
-#include <queue>
 #include <thread>
+#include <vector>
 
 #include <ui/GraphicBuffer.h>
 
@@ -37,16 +38,28 @@ public:
         bool isOpen GUARDED_BY(mutex) = false;
         status_t result GUARDED_BY(mutex) = NO_ERROR;
     };
+    // Critical operations are serviced before Speculative ones, so a buffer
+    // that an in-flight frame is blocked on (e.g. a screenshot) does not
+    // queue behind prefetches issued on the off chance a buffer is used
+    // later.
+    enum class Priority { Critical, Speculative };
     ImageManager(GLESRenderEngine* engine);
     ~ImageManager();
     // Starts the background thread for the ImageManager
     // We need this to guarantee that the class is fully-constructed before the
     // thread begins running.
     void initThread();
-    void cacheAsync(const sp<GraphicBuffer>& buffer, const std::shared_ptr<Barrier>& barrier)
-            EXCLUDES(mMutex);
+    void cacheAsync(const sp<GraphicBuffer>& buffer, const std::shared_ptr<Barrier>& barrier,
+                    Priority priority = Priority::Speculative) EXCLUDES(mMutex);
+    // Queues all of the buffers under a single lock acquisition and wakes the
+    // worker thread once. The barrier, if any, opens after the last buffer in
+    // the batch has been processed.
+    void cacheBatchAsync(const std::vector<sp<GraphicBuffer>>& buffers,
+                         const std::shared_ptr<Barrier>& barrier,
+                         Priority priority = Priority::Speculative) EXCLUDES(mMutex);
     status_t cache(const sp<GraphicBuffer>& buffer);
     void releaseAsync(uint64_t bufferId, const std::shared_ptr<Barrier>& barrier) EXCLUDES(mMutex);
+    void dump(std::string& result) EXCLUDES(mMutex);
 
 private:
     struct QueueEntry {
@@ -56,15 +69,20 @@ private:
         sp<GraphicBuffer> buffer = nullptr;
         uint64_t bufferId = 0;
         std::shared_ptr<Barrier> barrier = nullptr;
+        Priority priority = Priority::Speculative;
     };
 
     void queueOperation(const QueueEntry&& entry);
+    void queueOperationLocked(const QueueEntry& entry) REQUIRES(mMutex);
+    void traceQueueDepthLocked() REQUIRES(mMutex);
     void threadMain();
     GLESRenderEngine* const mEngine;
     std::thread mThread;
     std::condition_variable_any mCondition;
     std::mutex mMutex;
-    std::queue<QueueEntry> mQueue GUARDED_BY(mMutex);
+    std::deque<QueueEntry> mCriticalQueue GUARDED_BY(mMutex);
+    std::deque<QueueEntry> mQueue GUARDED_BY(mMutex);
+    size_t mMaxQueueDepth GUARDED_BY(mMutex) = 0;
 
     bool mRunning GUARDED_BY(mMutex) = true;
 };
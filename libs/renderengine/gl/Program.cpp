@@ -18,6 +18,8 @@
 
 #include <stdint.h>
 
+#include <EGL/egl.h>
+#include <GLES2/gl2ext.h>
 #include <log/log.h>
 #include <math/mat4.h>
 #include <utils/String8.h>
@@ -27,6 +29,24 @@ namespace android {
 namespace renderengine {
 namespace gl {
 
+namespace {
+
+// GL_OES_get_program_binary entry points, resolved lazily so Program
+// keeps working on drivers without the extension.
+PFNGLGETPROGRAMBINARYOESPROC getProgramBinaryOES() {
+    static const auto proc = reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(
+            eglGetProcAddress("glGetProgramBinaryOES"));
+    return proc;
+}
+
+PFNGLPROGRAMBINARYOESPROC programBinaryOES() {
+    static const auto proc = reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(
+            eglGetProcAddress("glProgramBinaryOES"));
+    return proc;
+}
+
+} // anonymous namespace
+
 Program::Program(const ProgramCache::Key& /*needs*/, const char* vertex, const char* fragment)
       : mInitialized(false) {
     GLuint vertexId = buildShader(vertex, GL_VERTEX_SHADER);
@@ -58,30 +78,76 @@ Program::Program(const ProgramCache::Key& /*needs*/, const char* vertex, const c
         glDeleteShader(fragmentId);
         glDeleteProgram(programId);
     } else {
-        mProgram = programId;
         mVertexShader = vertexId;
         mFragmentShader = fragmentId;
-        mInitialized = true;
-        mProjectionMatrixLoc = glGetUniformLocation(programId, "projection");
-        mTextureMatrixLoc = glGetUniformLocation(programId, "texture");
-        mSamplerLoc = glGetUniformLocation(programId, "sampler");
-        mColorLoc = glGetUniformLocation(programId, "color");
-        mDisplayColorMatrixLoc = glGetUniformLocation(programId, "displayColorMatrix");
-        mDisplayMaxLuminanceLoc = glGetUniformLocation(programId, "displayMaxLuminance");
-        mMaxMasteringLuminanceLoc = glGetUniformLocation(programId, "maxMasteringLuminance");
-        mMaxContentLuminanceLoc = glGetUniformLocation(programId, "maxContentLuminance");
-        mInputTransformMatrixLoc = glGetUniformLocation(programId, "inputTransformMatrix");
-        mOutputTransformMatrixLoc = glGetUniformLocation(programId, "outputTransformMatrix");
-        mCornerRadiusLoc = glGetUniformLocation(programId, "cornerRadius");
-        mCropCenterLoc = glGetUniformLocation(programId, "cropCenter");
-
-        // set-up the default values for our uniforms
-        glUseProgram(programId);
-        glUniformMatrix4fv(mProjectionMatrixLoc, 1, GL_FALSE, mat4().asArray());
-        glEnableVertexAttribArray(0);
+        initAfterLink(programId);
     }
 }
 
+Program::Program(const ProgramCache::Key& /*needs*/, GLenum binaryFormat, const void* binary,
+                 GLsizei length)
+      : mInitialized(false), mVertexShader(0), mFragmentShader(0) {
+    const auto loadBinary = programBinaryOES();
+    if (!loadBinary) {
+        return;
+    }
+    GLuint programId = glCreateProgram();
+    loadBinary(programId, binaryFormat, binary, length);
+
+    // The driver rejects binaries produced by a different driver build;
+    // the caller falls back to compiling from source.
+    GLint status;
+    glGetProgramiv(programId, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        glDeleteProgram(programId);
+        return;
+    }
+    initAfterLink(programId);
+}
+
+void Program::initAfterLink(GLuint programId) {
+    mProgram = programId;
+    mInitialized = true;
+    mProjectionMatrixLoc = glGetUniformLocation(programId, "projection");
+    mTextureMatrixLoc = glGetUniformLocation(programId, "texture");
+    mSamplerLoc = glGetUniformLocation(programId, "sampler");
+    mColorLoc = glGetUniformLocation(programId, "color");
+    mDisplayColorMatrixLoc = glGetUniformLocation(programId, "displayColorMatrix");
+    mDisplayMaxLuminanceLoc = glGetUniformLocation(programId, "displayMaxLuminance");
+    mMaxMasteringLuminanceLoc = glGetUniformLocation(programId, "maxMasteringLuminance");
+    mMaxContentLuminanceLoc = glGetUniformLocation(programId, "maxContentLuminance");
+    mToneMapLutLoc = glGetUniformLocation(programId, "toneMapLut");
+    mInputTransformMatrixLoc = glGetUniformLocation(programId, "inputTransformMatrix");
+    mOutputTransformMatrixLoc = glGetUniformLocation(programId, "outputTransformMatrix");
+    mCornerRadiusLoc = glGetUniformLocation(programId, "cornerRadius");
+    mCropCenterLoc = glGetUniformLocation(programId, "cropCenter");
+
+    // set-up the default values for our uniforms
+    glUseProgram(programId);
+    glUniformMatrix4fv(mProjectionMatrixLoc, 1, GL_FALSE, mat4().asArray());
+    glEnableVertexAttribArray(0);
+}
+
+bool Program::getBinary(GLenum* outFormat, std::vector<uint8_t>* outBinary) const {
+    const auto retrieveBinary = getProgramBinaryOES();
+    if (!mInitialized || !retrieveBinary) {
+        return false;
+    }
+    GLint length = 0;
+    glGetProgramiv(mProgram, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0) {
+        return false;
+    }
+    outBinary->resize(length);
+    GLsizei written = 0;
+    retrieveBinary(mProgram, length, &written, outFormat, outBinary->data());
+    if (written <= 0 || written > length) {
+        return false;
+    }
+    outBinary->resize(written);
+    return true;
+}
+
 bool Program::isValid() const {
     return mInitialized;
 }
@@ -152,6 +218,11 @@ void Program::setUniforms(const Description& desc) {
     if (mMaxContentLuminanceLoc >= 0) {
         glUniform1f(mMaxContentLuminanceLoc, desc.maxContentLuminance);
     }
+    if (mToneMapLutLoc >= 0) {
+        // The caller binds the LUT on texture unit 1; unit 0 carries the
+        // layer texture.
+        glUniform1i(mToneMapLutLoc, 1);
+    }
     if (mCornerRadiusLoc >= 0) {
         glUniform1f(mCornerRadiusLoc, desc.cornerRadius);
     }
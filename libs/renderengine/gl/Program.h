@@ -19,6 +19,8 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 #include <GLES2/gl2.h>
 #include <renderengine/private/Description.h>
 #include "ProgramCache.h"
@@ -54,11 +56,22 @@ public:
     };
 
     Program(const ProgramCache::Key& needs, const char* vertex, const char* fragment);
+
+    /* Creates the program from a driver binary previously retrieved with
+     * getBinary(); yields an invalid Program when the driver rejects the
+     * binary (different driver build, no GL_OES_get_program_binary). */
+    Program(const ProgramCache::Key& needs, GLenum binaryFormat, const void* binary,
+            GLsizei length);
     ~Program() = default;
 
     /* whether this object is usable */
     bool isValid() const;
 
+    /* Retrieves the driver binary of a successfully linked program, for
+     * persisting across boots.  Returns false when the driver does not
+     * support GL_OES_get_program_binary. */
+    bool getBinary(GLenum* outFormat, std::vector<uint8_t>* outBinary) const;
+
     /* Binds this program to the GLES context */
     void use();
 
@@ -73,6 +86,7 @@ public:
 
 private:
     GLuint buildShader(const char* source, GLenum type);
+    void initAfterLink(GLuint programId);
 
     // whether the initialization succeeded
     bool mInitialized;
@@ -100,6 +114,8 @@ private:
     GLint mMaxMasteringLuminanceLoc;
     /* location of max content luminance uniform */
     GLint mMaxContentLuminanceLoc;
+    /* location of the tone-mapping LUT sampler uniform */
+    GLint mToneMapLutLoc;
 
     /* location of transform matrix */
     GLint mInputTransformMatrixLoc;
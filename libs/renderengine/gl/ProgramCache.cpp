@@ -18,12 +18,20 @@
 
 #include "ProgramCache.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 #include <log/log.h>
 #include <renderengine/private/Description.h>
 #include <utils/String8.h>
 #include <utils/Trace.h>
+#include "GLExtensions.h"
 #include "Program.h"
 
 ANDROID_SINGLETON_STATIC_INSTANCE(android::renderengine::gl::ProgramCache)
@@ -77,6 +85,155 @@ Formatter& dedent(Formatter& f) {
     return f;
 }
 
+namespace {
+
+// On-disk layout of the program binary store: a header followed by
+// `count` entries, each 4-byte aligned.
+struct BinaryCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t fingerprint;
+    uint32_t count;
+};
+
+struct BinaryCacheEntry {
+    uint32_t key;
+    uint32_t format;
+    uint32_t length;
+    // followed by `length` bytes of blob, padded to 4 bytes
+};
+
+constexpr uint32_t kBinaryCacheMagic = 0x53465042; // 'SFPB'
+constexpr uint32_t kBinaryCacheVersion = 1;
+constexpr size_t kBinaryCacheMaxSize = 4 * 1024 * 1024;
+
+size_t alignUp4(size_t v) {
+    return (v + 3) & ~size_t(3);
+}
+
+// A binary produced by one driver build is garbage to any other, so the
+// store is keyed to the GL implementation strings as a whole.
+uint64_t computeDriverFingerprint() {
+    const auto& extensions = GLExtensions::getInstance();
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char* s : {extensions.getVendor(), extensions.getRenderer(),
+                          extensions.getVersion()}) {
+        for (; s != nullptr && *s; s++) {
+            hash ^= static_cast<uint8_t>(*s);
+            hash *= 0x100000001b3ull;
+        }
+    }
+    return hash;
+}
+
+} // anonymous namespace
+
+void ProgramCache::setCacheFilename(const char* filename) {
+    mCacheFilename = filename ? filename : "";
+}
+
+void ProgramCache::loadBinaryCache() {
+    mBinaryCacheLoaded = true;
+    if (mCacheFilename.empty()) {
+        return;
+    }
+    const char* glExtensions = GLExtensions::getInstance().getExtensions();
+    if (glExtensions == nullptr || strstr(glExtensions, "GL_OES_get_program_binary") == nullptr) {
+        ALOGV("driver does not support GL_OES_get_program_binary, not caching binaries");
+        mCacheFilename.clear();
+        return;
+    }
+
+    const int fd = open(mCacheFilename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < static_cast<off_t>(sizeof(BinaryCacheHeader)) ||
+        st.st_size > static_cast<off_t>(kBinaryCacheMaxSize)) {
+        close(fd);
+        return;
+    }
+    const size_t size = st.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return;
+    }
+
+    const auto* bytes = static_cast<const uint8_t*>(mapped);
+    const auto* header = reinterpret_cast<const BinaryCacheHeader*>(bytes);
+    if (header->magic == kBinaryCacheMagic && header->version == kBinaryCacheVersion &&
+        header->fingerprint == computeDriverFingerprint()) {
+        size_t offset = sizeof(BinaryCacheHeader);
+        for (uint32_t i = 0; i < header->count; i++) {
+            if (offset + sizeof(BinaryCacheEntry) > size) break;
+            const auto* entry = reinterpret_cast<const BinaryCacheEntry*>(bytes + offset);
+            offset += sizeof(BinaryCacheEntry);
+            if (entry->length == 0 || offset + entry->length > size) break;
+
+            Key key;
+            key.mKey = entry->key;
+            ProgramBinary binary;
+            binary.format = entry->format;
+            binary.blob.assign(bytes + offset, bytes + offset + entry->length);
+            mBinaries.emplace(key, std::move(binary));
+            offset += alignUp4(entry->length);
+        }
+        ALOGV("loaded %zu program binaries from %s", mBinaries.size(), mCacheFilename.c_str());
+    }
+    munmap(mapped, size);
+}
+
+void ProgramCache::saveBinaryCache() {
+    if (!mBinaryCacheDirty || mCacheFilename.empty()) {
+        return;
+    }
+    ATRACE_CALL();
+
+    size_t size = sizeof(BinaryCacheHeader);
+    for (const auto& [key, binary] : mBinaries) {
+        size += sizeof(BinaryCacheEntry) + alignUp4(binary.blob.size());
+    }
+    if (size > kBinaryCacheMaxSize) {
+        return;
+    }
+
+    std::vector<uint8_t> buffer(size, 0);
+    auto* header = reinterpret_cast<BinaryCacheHeader*>(buffer.data());
+    header->magic = kBinaryCacheMagic;
+    header->version = kBinaryCacheVersion;
+    header->fingerprint = computeDriverFingerprint();
+    header->count = static_cast<uint32_t>(mBinaries.size());
+
+    size_t offset = sizeof(BinaryCacheHeader);
+    for (const auto& [key, binary] : mBinaries) {
+        auto* entry = reinterpret_cast<BinaryCacheEntry*>(buffer.data() + offset);
+        entry->key = key.mKey;
+        entry->format = binary.format;
+        entry->length = static_cast<uint32_t>(binary.blob.size());
+        offset += sizeof(BinaryCacheEntry);
+        memcpy(buffer.data() + offset, binary.blob.data(), binary.blob.size());
+        offset += alignUp4(binary.blob.size());
+    }
+
+    // Write to a temporary and rename so readers never see a torn file.
+    const std::string tempFilename = mCacheFilename + ".tmp";
+    const int fd = open(tempFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        ALOGW("unable to write program binary cache %s: %s", tempFilename.c_str(),
+              strerror(errno));
+        return;
+    }
+    const bool ok = write(fd, buffer.data(), buffer.size()) == static_cast<ssize_t>(buffer.size());
+    close(fd);
+    if (!ok || rename(tempFilename.c_str(), mCacheFilename.c_str()) < 0) {
+        unlink(tempFilename.c_str());
+        return;
+    }
+    mBinaryCacheDirty = false;
+}
+
 void ProgramCache::primeCache(
         EGLContext context, bool useColorManagement, bool toneMapperShaderOnly) {
     auto& cache = mCaches[context];
@@ -106,6 +263,7 @@ void ProgramCache::primeCache(
                 shaderCount++;
             }
         }
+        saveBinaryCache();
         return;
     }
 
@@ -153,6 +311,8 @@ void ProgramCache::primeCache(
         }
     }
 
+    saveBinaryCache();
+
     nsecs_t timeAfter = systemTime();
     float compileTimeMs = static_cast<float>(timeAfter - timeBefore) / 1.0E6;
     ALOGD("shader cache generated - %u shaders in %f ms\n", shaderCount, compileTimeMs);
@@ -225,6 +385,16 @@ ProgramCache::Key ProgramCache::computeKey(const Description& description) {
         }
     }
 
+    // The LUT replaces only the HDR -> SDR ToneMap curve; every other
+    // combination keeps the analytic shader.
+    const int inputTF = needs.getInputTF();
+    const int outputTF = needs.getOutputTF();
+    if (description.useToneMapLut &&
+        (inputTF == Key::INPUT_TF_ST2084 || inputTF == Key::INPUT_TF_HLG) &&
+        outputTF != Key::OUTPUT_TF_ST2084 && outputTF != Key::OUTPUT_TF_HLG) {
+        needs.set(Key::TONE_MAP_LUT_MASK, Key::TONE_MAP_LUT_ON);
+    }
+
     return needs;
 }
 
@@ -340,6 +510,29 @@ void ProgramCache::generateToneMappingProcess(Formatter& fs, const Key& needs) {
                     )__SHADER__";
                     break;
                 default:
+                    if (needs.hasToneMapLut()) {
+                        // The curve was tabulated on the CPU for exactly this
+                        // (maxInLumi, maxOutLumi) pair; the texel holds the
+                        // output luminance normalized to maxOutLumi, encoded
+                        // as 16 bits across the R and G bytes. One texture
+                        // sample replaces the whole Hermite spline below.
+                        fs << "uniform sampler2D toneMapLut;";
+                        fs << R"__SHADER__(
+                            highp vec3 ToneMap(highp vec3 color) {
+                                float maxInLumi = min(maxMasteringLuminance, maxContentLuminance);
+                                highp float nits = clamp(color.y, 0.0, maxInLumi);
+                                if (color.y <= 0.0) {
+                                    return vec3(0.0);
+                                }
+                                highp float x = (nits / maxInLumi) * (255.0 / 256.0) + 0.5 / 256.0;
+                                highp vec2 enc = texture2D(toneMapLut, vec2(x, 0.5)).rg;
+                                highp float outNits = dot(enc, vec2(65280.0, 255.0)) / 65535.0 *
+                                        displayMaxLuminance;
+                                return color * (outNits / color.y);
+                            }
+                        )__SHADER__";
+                        break;
+                    }
                     fs << R"__SHADER__(
                         highp vec3 ToneMap(highp vec3 color) {
                             float maxMasteringLumi = maxMasteringLuminance;
@@ -793,13 +986,40 @@ String8 ProgramCache::generateFragmentShader(const Key& needs) {
 std::unique_ptr<Program> ProgramCache::generateProgram(const Key& needs) {
     ATRACE_CALL();
 
+    if (!mBinaryCacheLoaded) {
+        loadBinaryCache();
+    }
+
+    auto cached = mBinaries.find(needs);
+    if (cached != mBinaries.end()) {
+        auto program = std::make_unique<Program>(needs, cached->second.format,
+                                                 cached->second.blob.data(),
+                                                 static_cast<GLsizei>(cached->second.blob.size()));
+        if (program->isValid()) {
+            return program;
+        }
+        // The driver rejected the binary; recompile from source below
+        // and replace the stale entry.
+        mBinaries.erase(cached);
+        mBinaryCacheDirty = true;
+    }
+
     // vertex shader
     String8 vs = generateVertexShader(needs);
 
     // fragment shader
     String8 fs = generateFragmentShader(needs);
 
-    return std::make_unique<Program>(needs, vs.string(), fs.string());
+    auto program = std::make_unique<Program>(needs, vs.string(), fs.string());
+
+    if (!mCacheFilename.empty() && program->isValid()) {
+        ProgramBinary binary;
+        if (program->getBinary(&binary.format, &binary.blob)) {
+            mBinaries.emplace(needs, std::move(binary));
+            mBinaryCacheDirty = true;
+        }
+    }
+    return program;
 }
 
 void ProgramCache::useProgram(EGLContext context, const Description& description) {
@@ -817,6 +1037,11 @@ void ProgramCache::useProgram(EGLContext context, const Description& description
 
         ALOGV(">>> generated new program for context %p: needs=%08X, time=%u ms (%zu programs)",
               context, needs.mKey, uint32_t(ns2ms(time)), cache.size());
+
+        // A shader showing up outside primeCache() (first blur layer,
+        // first wide-gamut layer, ...) is exactly the one worth having
+        // on disk for the next boot.
+        saveBinaryCache();
     }
 
     // here we have a suitable program for this description
@@ -18,7 +18,9 @@
 #define SF_RENDER_ENGINE_PROGRAMCACHE_H
 
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
@@ -122,6 +124,11 @@ public:
             DISPLAY_COLOR_TRANSFORM_MATRIX_MASK = 1 << DISPLAY_COLOR_TRANSFORM_MATRIX_SHIFT,
             DISPLAY_COLOR_TRANSFORM_MATRIX_OFF = 0 << DISPLAY_COLOR_TRANSFORM_MATRIX_SHIFT,
             DISPLAY_COLOR_TRANSFORM_MATRIX_ON = 1 << DISPLAY_COLOR_TRANSFORM_MATRIX_SHIFT,
+
+            TONE_MAP_LUT_SHIFT = 15,
+            TONE_MAP_LUT_MASK = 1 << TONE_MAP_LUT_SHIFT,
+            TONE_MAP_LUT_OFF = 0 << TONE_MAP_LUT_SHIFT,
+            TONE_MAP_LUT_ON = 1 << TONE_MAP_LUT_SHIFT,
         };
 
         inline Key() : mKey(0) {}
@@ -180,6 +187,7 @@ public:
             return inputTF != outputTF;
         }
         inline bool isY410BT2020() const { return (mKey & Y410_BT2020_MASK) == Y410_BT2020_ON; }
+        inline bool hasToneMapLut() const { return (mKey & TONE_MAP_LUT_MASK) == TONE_MAP_LUT_ON; }
 
         // for use by std::unordered_map
 
@@ -193,6 +201,11 @@ public:
     ProgramCache() = default;
     ~ProgramCache() = default;
 
+    // Sets the file backing the on-disk program binary store.  Must be
+    // called before primeCache() for first-use compiles to be avoided on
+    // subsequent boots; an empty filename disables persistence.
+    void setCacheFilename(const char* filename);
+
     // Generate shaders to populate the cache
     void primeCache(const EGLContext context, bool useColorManagement, bool toneMapperShaderOnly);
 
@@ -213,17 +226,34 @@ private:
     static void generateOOTF(Formatter& fs, const Key& needs);
     // Generate OETF based from Key.
     static void generateOETF(Formatter& fs, const Key& needs);
-    // generates a program from the Key
-    static std::unique_ptr<Program> generateProgram(const Key& needs);
+    // generates a program from the Key, preferring a cached driver
+    // binary over compiling from source
+    std::unique_ptr<Program> generateProgram(const Key& needs);
     // generates the vertex shader from the Key
     static String8 generateVertexShader(const Key& needs);
     // generates the fragment shader from the Key
     static String8 generateFragmentShader(const Key& needs);
 
+    // On-disk program binary store.  Entries are driver binaries keyed
+    // by Key; the file is guarded by a fingerprint of the GL driver
+    // strings so a driver update invalidates it wholesale.
+    struct ProgramBinary {
+        GLenum format;
+        std::vector<uint8_t> blob;
+    };
+
+    void loadBinaryCache();
+    void saveBinaryCache();
+
     // Key/Value map used for caching Programs. Currently the cache
     // is never shrunk (and the GL program objects are never deleted).
     std::unordered_map<EGLContext, std::unordered_map<Key, std::unique_ptr<Program>, Key::Hash>>
             mCaches;
+
+    std::string mCacheFilename;
+    bool mBinaryCacheLoaded = false;
+    bool mBinaryCacheDirty = false;
+    std::unordered_map<Key, ProgramBinary, Key::Hash> mBinaries;
 };
 
 } // namespace gl
@@ -23,18 +23,38 @@
 #include <GLES3/gl3ext.h>
 #include <ui/GraphicTypes.h>
 #include <cstdint>
+#include <cstdlib>
 
+#include <cutils/properties.h>
 #include <utils/Trace.h>
 
 namespace android {
 namespace renderengine {
 namespace gl {
 
+namespace {
+
+float compositionFboScale() {
+    // At 50 the content pass for the blurred backdrop only touches a quarter
+    // of the pixels; the blur itself hides the resolution loss. Useful for
+    // devices that keep a blurred panel on screen persistently.
+    char value[PROPERTY_VALUE_MAX];
+    property_get("debug.renderengine.blur_composition_scale", value, "100");
+    const int percent = atoi(value);
+    if (percent < 25 || percent >= 100) {
+        return 1.0f;
+    }
+    return percent / 100.0f;
+}
+
+} // namespace
+
 BlurFilter::BlurFilter(GLESRenderEngine& engine)
       : mEngine(engine),
         mCompositionFbo(engine),
         mPingFbo(engine),
         mPongFbo(engine),
+        mCompositionFboScale(compositionFboScale()),
         mMixProgram(engine),
         mBlurProgram(engine) {
     mMixProgram.compile(getVertexShader(), getMixFragShader());
@@ -77,7 +97,9 @@ status_t BlurFilter::setAsDrawTarget(const DisplaySettings& display, uint32_t ra
 
         mDisplayWidth = display.physicalDisplay.width();
         mDisplayHeight = display.physicalDisplay.height();
-        mCompositionFbo.allocateBuffers(mDisplayWidth, mDisplayHeight);
+        mCompositionFbo.allocateBuffers(floorf(mDisplayWidth * mCompositionFboScale),
+                                        floorf(mDisplayHeight * mCompositionFboScale));
+        mBlurCacheValid = false;
 
         const uint32_t fboWidth = floorf(mDisplayWidth * kFboScale);
         const uint32_t fboHeight = floorf(mDisplayHeight * kFboScale);
@@ -122,9 +144,22 @@ void BlurFilter::drawMesh(GLuint uv, GLuint position) {
     glDrawArrays(GL_TRIANGLES, 0 /* first */, 3 /* count */);
 }
 
+void BlurFilter::setSourceFingerprint(uint64_t fingerprint) {
+    mSourceUnchanged = fingerprint != 0 && fingerprint == mSourceFingerprint;
+    mSourceFingerprint = fingerprint;
+}
+
 status_t BlurFilter::prepare() {
     ATRACE_NAME("BlurFilter::prepare");
 
+    if (mSourceUnchanged && mBlurCacheValid && mRadius == mCachedRadius) {
+        // The backdrop is identical to the previous frame's, so the blurred
+        // result in mLastDrawTarget is still valid and we can skip the
+        // downsample and ping-pong passes entirely.
+        ATRACE_NAME("BlurFilter::reuseCachedBlur");
+        return NO_ERROR;
+    }
+
     // Kawase is an approximation of Gaussian, but it behaves differently from it.
     // A radius transformation is required for approximating them, and also to introduce
     // non-integer steps, necessary to smoothly interpolate large radii.
@@ -166,6 +201,8 @@ status_t BlurFilter::prepare() {
         read = tmp;
     }
     mLastDrawTarget = read;
+    mCachedRadius = mRadius;
+    mBlurCacheValid = true;
 
     return NO_ERROR;
 }
@@ -50,6 +50,12 @@ public:
     status_t prepare();
     // Render blur to the bound framebuffer (screen).
     status_t render(bool multiPass);
+    // Tells the filter what content is about to be composited into its
+    // draw target. When the fingerprint matches the previous frame's, the
+    // backdrop is static and prepare() reuses the blurred result from the
+    // last frame instead of re-running the downsample and blur passes.
+    // A fingerprint of 0 means "unknown" and always re-renders.
+    void setSourceFingerprint(uint64_t fingerprint);
 
 private:
     uint32_t mRadius;
@@ -71,6 +77,16 @@ private:
     // Buffer holding the final blur pass.
     GLFramebuffer* mLastDrawTarget;
 
+    // Scale applied to the composition buffer. Lowered to half resolution
+    // via debug.renderengine.blur_composition_scale for devices that keep a
+    // blur on screen persistently; the blurred result hides the loss.
+    const float mCompositionFboScale;
+    // State for the cached-downsample mode, see setSourceFingerprint().
+    uint64_t mSourceFingerprint = 0;
+    bool mSourceUnchanged = false;
+    bool mBlurCacheValid = false;
+    uint32_t mCachedRadius = 0;
+
     // VBO containing vertex and uv data of a fullscreen triangle.
     GLVertexBuffer mMeshBuffer;
 
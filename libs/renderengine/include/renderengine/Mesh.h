@@ -34,6 +34,8 @@ public:
         TRIANGLE_FAN = 0x0006    // GL_TRIANGLE_FAN
     };
 
+    Mesh(Mesh&&) = default;
+    Mesh& operator=(Mesh&&) = default;
     ~Mesh() = default;
 
     /*
@@ -19,7 +19,10 @@
 
 #include <stdint.h>
 #include <sys/types.h>
+#include <functional>
+#include <future>
 #include <memory>
+#include <vector>
 
 #include <android-base/unique_fd.h>
 #include <math/mat4.h>
@@ -35,6 +38,11 @@
  */
 #define PROPERTY_DEBUG_RENDERENGINE_BACKEND "debug.renderengine.backend"
 
+/**
+ * Number of GL contexts in the pool when the backend is set to "pooled".
+ */
+#define PROPERTY_DEBUG_RENDERENGINE_POOL_SIZE "debug.renderengine.pool_size"
+
 struct ANativeWindowBuffer;
 
 namespace android {
@@ -54,11 +62,24 @@ namespace impl {
 class RenderEngine;
 }
 
+namespace threaded {
+class RenderEnginePool;
+class RenderEngineThreaded;
+}
+
 enum class Protection {
     UNPROTECTED = 1,
     PROTECTED = 2,
 };
 
+// Result of a drawLayersAsync call. status matches what the synchronous
+// drawLayers call would have returned; drawFence fires when the output buffer
+// has been drawn to and is ready to be examined.
+struct DrawLayersResult {
+    status_t status = NO_ERROR;
+    base::unique_fd drawFence;
+};
+
 class RenderEngine {
 public:
     enum class ContextPriority {
@@ -131,6 +152,12 @@ public:
     // do any work.
     virtual bool cleanupPostRender(CleanupMode mode = CleanupMode::CLEAN_OUTPUT_RESOURCES) = 0;
 
+    // Registers a callback that is invoked, from an internal thread, when the GPU work
+    // of the most recent drawLayers call that returned a draw fence has completed.
+    // Callers use it to schedule cleanupPostRender right at GPU completion instead of
+    // at the start of the next frame. Pass nullptr to unregister.
+    virtual void setCleanupCallback(const std::function<void()>& callback) = 0;
+
     // queries
     virtual size_t getMaxTextureSize() const = 0;
     virtual size_t getMaxViewportDims() const = 0;
@@ -177,6 +204,19 @@ public:
                                 ANativeWindowBuffer* buffer, const bool useFramebufferCache,
                                 base::unique_fd&& bufferFence, base::unique_fd* drawFence) = 0;
 
+    // Asynchronous version of drawLayers. The layer settings are snapshotted
+    // by value, so the caller does not need to keep them alive; the caller
+    // remains responsible for keeping buffer alive until the returned fence
+    // fires. Backends with a dedicated render thread enqueue the draw and
+    // return immediately, keeping GL driver time off the calling thread;
+    // backends without one execute the draw in place and hand back an
+    // already-satisfied future.
+    virtual std::future<DrawLayersResult> drawLayersAsync(const DisplaySettings& display,
+                                                          std::vector<LayerSettings> layers,
+                                                          ANativeWindowBuffer* buffer,
+                                                          const bool useFramebufferCache,
+                                                          base::unique_fd&& bufferFence);
+
 protected:
     // Gets a framebuffer to render to. This framebuffer may or may not be
     // cached depending on the implementation.
@@ -185,6 +225,8 @@ protected:
     // live longer than RenderEngine.
     virtual Framebuffer* getFramebufferForDrawing() = 0;
     friend class BindNativeBufferAsFramebuffer;
+    friend class threaded::RenderEnginePool;
+    friend class threaded::RenderEngineThreaded;
 };
 
 struct RenderEngineCreationArgs {
@@ -59,6 +59,7 @@ public:
     MOCK_METHOD2(setViewportAndProjection,
                  void(Rect,  Rect));
     MOCK_METHOD1(cleanupPostRender, bool(CleanupMode mode));
+    MOCK_METHOD1(setCleanupCallback, void(const std::function<void()>&));
     MOCK_METHOD6(drawLayers,
                  status_t(const DisplaySettings&, const std::vector<const LayerSettings*>&,
                           ANativeWindowBuffer*, const bool, base::unique_fd&&, base::unique_fd*));
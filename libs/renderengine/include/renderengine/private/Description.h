@@ -75,6 +75,11 @@ struct Description {
     float maxMasteringLuminance;
     float maxContentLuminance;
 
+    // When true, the HDR->SDR tone-mapping curve is sampled from the
+    // precomputed LUT bound on texture unit 1 instead of being evaluated
+    // per fragment.
+    bool useToneMapLut = false;
+
     // projection matrix
     mat4 projectionMatrix;
 
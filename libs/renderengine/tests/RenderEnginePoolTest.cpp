@@ -0,0 +1,109 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <renderengine/mock/RenderEngine.h>
+#include "../threaded/RenderEnginePool.h"
+
+namespace android {
+
+using testing::Eq;
+using testing::Return;
+
+constexpr size_t kPoolSize = 2;
+
+struct RenderEnginePoolTest : public ::testing::Test {
+    ~RenderEnginePoolTest() {}
+
+    void SetUp() override {
+        for (size_t i = 0; i < kPoolSize; i++) {
+            mRenderEngines[i] = new renderengine::mock::RenderEngine();
+        }
+        // The factory runs once on each worker's render thread; hand each
+        // worker its own mock.
+        mPooledRE = renderengine::threaded::RenderEnginePool::create(
+                [this]() {
+                    return std::unique_ptr<renderengine::RenderEngine>(
+                            mRenderEngines[mNextEngine.fetch_add(1)]);
+                },
+                renderengine::RenderEngineCreationArgs::Builder().build(), kPoolSize);
+    }
+
+    // Owned by mPooledRE's workers after SetUp; destroyed on their render
+    // threads.
+    renderengine::mock::RenderEngine* mRenderEngines[kPoolSize];
+    std::atomic<size_t> mNextEngine{0};
+    std::unique_ptr<renderengine::threaded::RenderEnginePool> mPooledRE;
+};
+
+TEST_F(RenderEnginePoolTest, primeCache_reachesAllWorkers) {
+    for (auto* engine : mRenderEngines) {
+        EXPECT_CALL(*engine, primeCache());
+    }
+    mPooledRE->primeCache();
+}
+
+TEST_F(RenderEnginePoolTest, deleteTextures_reachesAllWorkers) {
+    uint32_t texName;
+    for (auto* engine : mRenderEngines) {
+        EXPECT_CALL(*engine, deleteTextures(1, &texName));
+    }
+    mPooledRE->deleteTextures(1, &texName);
+}
+
+TEST_F(RenderEnginePoolTest, useProtectedContext_reachesAllWorkers) {
+    for (auto* engine : mRenderEngines) {
+        EXPECT_CALL(*engine, useProtectedContext(Eq(true))).WillOnce(Return(true));
+    }
+    ASSERT_EQ(true, mPooledRE->useProtectedContext(true));
+}
+
+TEST_F(RenderEnginePoolTest, drawLayers_usesPrimaryWorker) {
+    renderengine::DisplaySettings settings;
+    std::vector<const renderengine::LayerSettings*> layers;
+    base::unique_fd bufferFence;
+    base::unique_fd drawFence;
+
+    EXPECT_CALL(*mRenderEngines[0], drawLayers).WillOnce(Return(NO_ERROR));
+
+    status_t result = mPooledRE->drawLayers(settings, layers, nullptr, false,
+                                            std::move(bufferFence), &drawFence);
+    ASSERT_EQ(NO_ERROR, result);
+}
+
+TEST_F(RenderEnginePoolTest, drawLayersAsync_roundRobinsAcrossWorkers) {
+    renderengine::DisplaySettings settings;
+
+    // Back to back draws, as issued for two displays in the same frame, must
+    // land on different workers.
+    for (auto* engine : mRenderEngines) {
+        EXPECT_CALL(*engine, drawLayers).WillOnce(Return(NO_ERROR));
+    }
+
+    std::future<renderengine::DrawLayersResult> first =
+            mPooledRE->drawLayersAsync(settings, std::vector<renderengine::LayerSettings>(),
+                                       nullptr, false, base::unique_fd());
+    std::future<renderengine::DrawLayersResult> second =
+            mPooledRE->drawLayersAsync(settings, std::vector<renderengine::LayerSettings>(),
+                                       nullptr, false, base::unique_fd());
+    ASSERT_EQ(NO_ERROR, first.get().status);
+    ASSERT_EQ(NO_ERROR, second.get().status);
+}
+
+} // namespace android
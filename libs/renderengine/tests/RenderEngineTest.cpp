@@ -1378,6 +1378,31 @@ TEST_F(RenderEngineTest, cacheExternalBuffer_withNullBuffer) {
     EXPECT_EQ(BAD_VALUE, barrier->result);
 }
 
+TEST_F(RenderEngineTest, cacheExternalBufferBatch_cachesImages) {
+    std::vector<sp<GraphicBuffer>> buffers = {allocateSourceBuffer(1, 1),
+                                              allocateSourceBuffer(1, 1)};
+    std::shared_ptr<renderengine::gl::ImageManager::Barrier> barrier =
+            sRE->cacheExternalTextureBufferBatchForTesting(buffers);
+    {
+        std::lock_guard<std::mutex> lock(barrier->mutex);
+        ASSERT_TRUE(barrier->condition.wait_for(barrier->mutex, std::chrono::seconds(5),
+                                                [&]() REQUIRES(barrier->mutex) {
+                                                    return barrier->isOpen;
+                                                }));
+        EXPECT_EQ(NO_ERROR, barrier->result);
+    }
+    for (const auto& buf : buffers) {
+        EXPECT_TRUE(sRE->isImageCachedForTesting(buf->getId()));
+        barrier = sRE->unbindExternalTextureBufferForTesting(buf->getId());
+        std::lock_guard<std::mutex> lock(barrier->mutex);
+        ASSERT_TRUE(barrier->condition.wait_for(barrier->mutex, std::chrono::seconds(5),
+                                                [&]() REQUIRES(barrier->mutex) {
+                                                    return barrier->isOpen;
+                                                }));
+        EXPECT_EQ(NO_ERROR, barrier->result);
+    }
+}
+
 TEST_F(RenderEngineTest, cacheExternalBuffer_cachesImages) {
     sp<GraphicBuffer> buf = allocateSourceBuffer(1, 1);
     uint64_t bufferId = buf->getId();
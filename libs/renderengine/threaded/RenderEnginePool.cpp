@@ -0,0 +1,189 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#undef LOG_TAG
+#define LOG_TAG "RenderEnginePool"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "RenderEnginePool.h"
+
+#include <log/log.h>
+#include <utils/Trace.h>
+
+namespace android {
+namespace renderengine {
+namespace threaded {
+
+std::unique_ptr<RenderEnginePool> RenderEnginePool::create(CreateInstanceFactory factory,
+                                                           const RenderEngineCreationArgs& args,
+                                                           size_t poolSize) {
+    return std::make_unique<RenderEnginePool>(std::move(factory), args, poolSize);
+}
+
+RenderEnginePool::RenderEnginePool(CreateInstanceFactory factory,
+                                   const RenderEngineCreationArgs& args, size_t poolSize)
+      : RenderEngine(args) {
+    ATRACE_CALL();
+    LOG_ALWAYS_FATAL_IF(poolSize < 2, "RenderEnginePool needs at least two workers");
+
+    mWorkers.reserve(poolSize);
+    for (size_t i = 0; i < poolSize; i++) {
+        mWorkers.push_back(RenderEngineThreaded::create(factory, args));
+    }
+    ALOGD("Created RenderEnginePool with %zu contexts", poolSize);
+}
+
+RenderEnginePool::~RenderEnginePool() = default;
+
+void RenderEnginePool::primeCache() const {
+    // Prime every context so the first frame on a secondary worker does not
+    // pay for shader compilation.
+    for (const auto& worker : mWorkers) {
+        worker->primeCache();
+    }
+}
+
+void RenderEnginePool::dump(std::string& result) {
+    for (size_t i = 0; i < mWorkers.size(); i++) {
+        result.append("RenderEnginePool worker ");
+        result.append(std::to_string(i));
+        result.append(":\n");
+        mWorkers[i]->dump(result);
+    }
+}
+
+void RenderEnginePool::genTextures(size_t count, uint32_t* names) {
+    primary().genTextures(count, names);
+}
+
+void RenderEnginePool::deleteTextures(size_t count, uint32_t const* names) {
+    // Texture names come from a display-wide pool and any worker may have
+    // instantiated a texture object for them, so every context must delete.
+    for (const auto& worker : mWorkers) {
+        worker->deleteTextures(count, names);
+    }
+}
+
+void RenderEnginePool::bindExternalTextureImage(uint32_t texName, const Image& image) {
+    primary().bindExternalTextureImage(texName, image);
+}
+
+status_t RenderEnginePool::bindExternalTextureBuffer(uint32_t texName,
+                                                     const sp<GraphicBuffer>& buffer,
+                                                     const sp<Fence>& fence) {
+    return primary().bindExternalTextureBuffer(texName, buffer, fence);
+}
+
+void RenderEnginePool::cacheExternalTextureBuffer(const sp<GraphicBuffer>& buffer) {
+    for (const auto& worker : mWorkers) {
+        worker->cacheExternalTextureBuffer(buffer);
+    }
+}
+
+void RenderEnginePool::unbindExternalTextureBuffer(uint64_t bufferId) {
+    // Must reach every worker or a context that drew with the buffer keeps
+    // its EGLImage alive after the caller dropped its last reference.
+    for (const auto& worker : mWorkers) {
+        worker->unbindExternalTextureBuffer(bufferId);
+    }
+}
+
+status_t RenderEnginePool::bindFrameBuffer(Framebuffer* framebuffer) {
+    return primary().bindFrameBuffer(framebuffer);
+}
+
+void RenderEnginePool::unbindFrameBuffer(Framebuffer* framebuffer) {
+    primary().unbindFrameBuffer(framebuffer);
+}
+
+bool RenderEnginePool::cleanupPostRender(CleanupMode mode) {
+    bool cleanedUp = false;
+    for (const auto& worker : mWorkers) {
+        cleanedUp |= worker->cleanupPostRender(mode);
+    }
+    return cleanedUp;
+}
+
+void RenderEnginePool::setCleanupCallback(const std::function<void()>& callback) {
+    // Each worker signals GPU completion from its own wrapped engine, so the
+    // callback must be registered with every context.
+    for (const auto& worker : mWorkers) {
+        worker->setCleanupCallback(callback);
+    }
+}
+
+size_t RenderEnginePool::getMaxTextureSize() const {
+    return primary().getMaxTextureSize();
+}
+
+size_t RenderEnginePool::getMaxViewportDims() const {
+    return primary().getMaxViewportDims();
+}
+
+bool RenderEnginePool::isProtected() const {
+    return primary().isProtected();
+}
+
+bool RenderEnginePool::supportsProtectedContent() const {
+    return primary().supportsProtectedContent();
+}
+
+bool RenderEnginePool::useProtectedContext(bool useProtectedContext) {
+    // Keep all workers in the same mode; a draw dispatched to any worker must
+    // see the protectedness the caller just asked for.
+    bool success = true;
+    for (const auto& worker : mWorkers) {
+        success &= worker->useProtectedContext(useProtectedContext);
+    }
+    return success;
+}
+
+void RenderEnginePool::setViewportAndProjection(Rect viewPort, Rect sourceCrop) {
+    primary().setViewportAndProjection(viewPort, sourceCrop);
+}
+
+status_t RenderEnginePool::drawLayers(const DisplaySettings& display,
+                                      const std::vector<const LayerSettings*>& layers,
+                                      ANativeWindowBuffer* buffer, const bool useFramebufferCache,
+                                      base::unique_fd&& bufferFence, base::unique_fd* drawFence) {
+    // The synchronous path blocks its caller anyway, so there is nothing to
+    // gain from fanning it out.
+    return primary().drawLayers(display, layers, buffer, useFramebufferCache,
+                                std::move(bufferFence), drawFence);
+}
+
+std::future<DrawLayersResult> RenderEnginePool::drawLayersAsync(
+        const DisplaySettings& display, std::vector<LayerSettings> layers,
+        ANativeWindowBuffer* buffer, const bool useFramebufferCache,
+        base::unique_fd&& bufferFence) {
+    ATRACE_CALL();
+    // Round-robin so that draws for different displays issued back to back in
+    // the same frame land on different contexts and overlap on the GPU.
+    const size_t index = mNextWorker.fetch_add(1) % mWorkers.size();
+    return mWorkers[index]->drawLayersAsync(display, std::move(layers), buffer,
+                                            useFramebufferCache, std::move(bufferFence));
+}
+
+Framebuffer* RenderEnginePool::getFramebufferForDrawing() {
+    // Accessed through the base class, where this class is a friend; the
+    // method is protected on RenderEngineThreaded itself.
+    return static_cast<renderengine::RenderEngine&>(primary()).getFramebufferForDrawing();
+}
+
+} // namespace threaded
+} // namespace renderengine
+} // namespace android
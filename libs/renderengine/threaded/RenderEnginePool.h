@@ -0,0 +1,108 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "RenderEngineThreaded.h"
+
+namespace android {
+namespace renderengine {
+namespace threaded {
+
+/**
+ * A pool of RenderEngineThreaded workers, each owning its own wrapped engine
+ * and therefore its own EGL context. drawLayersAsync calls are distributed
+ * round-robin across the workers, so GPU composition of two or more displays
+ * in the same frame proceeds on independent GL streams instead of serializing
+ * behind a single context.
+ *
+ * Sharing is safe because EGLImages are scoped to the EGLDisplay, not to a
+ * context: every worker can bind an image cached by any other worker, and GL
+ * texture names auto-instantiate per context on first bind. To keep the
+ * workers' caches and modes from diverging, buffer cache maintenance
+ * (cache/unbind/deleteTextures), useProtectedContext and primeCache are
+ * broadcast to every worker.
+ *
+ * The remaining synchronous single-context API (genTextures, bindFrameBuffer,
+ * queries, the legacy drawLayers) is serviced by the first worker only, which
+ * preserves the single-caller semantics existing users rely on.
+ */
+class RenderEnginePool : public impl::RenderEngine {
+public:
+    static std::unique_ptr<RenderEnginePool> create(CreateInstanceFactory factory,
+                                                    const RenderEngineCreationArgs& args,
+                                                    size_t poolSize);
+
+    RenderEnginePool(CreateInstanceFactory factory, const RenderEngineCreationArgs& args,
+                     size_t poolSize);
+    ~RenderEnginePool() override;
+
+    void primeCache() const override;
+
+    void dump(std::string& result) override;
+
+    void genTextures(size_t count, uint32_t* names) override;
+    void deleteTextures(size_t count, uint32_t const* names) override;
+    void bindExternalTextureImage(uint32_t texName, const Image& image) override;
+    status_t bindExternalTextureBuffer(uint32_t texName, const sp<GraphicBuffer>& buffer,
+                                       const sp<Fence>& fence) override;
+    void cacheExternalTextureBuffer(const sp<GraphicBuffer>& buffer) override;
+    void unbindExternalTextureBuffer(uint64_t bufferId) override;
+    status_t bindFrameBuffer(Framebuffer* framebuffer) override;
+    void unbindFrameBuffer(Framebuffer* framebuffer) override;
+    bool cleanupPostRender(CleanupMode mode) override;
+    void setCleanupCallback(const std::function<void()>& callback) override;
+
+    size_t getMaxTextureSize() const override;
+    size_t getMaxViewportDims() const override;
+
+    bool isProtected() const override;
+    bool supportsProtectedContent() const override;
+    bool useProtectedContext(bool useProtectedContext) override;
+    void setViewportAndProjection(Rect viewPort, Rect sourceCrop) override;
+
+    status_t drawLayers(const DisplaySettings& display,
+                        const std::vector<const LayerSettings*>& layers,
+                        ANativeWindowBuffer* buffer, const bool useFramebufferCache,
+                        base::unique_fd&& bufferFence, base::unique_fd* drawFence) override;
+
+    std::future<DrawLayersResult> drawLayersAsync(const DisplaySettings& display,
+                                                  std::vector<LayerSettings> layers,
+                                                  ANativeWindowBuffer* buffer,
+                                                  const bool useFramebufferCache,
+                                                  base::unique_fd&& bufferFence) override;
+
+protected:
+    Framebuffer* getFramebufferForDrawing() override;
+
+private:
+    RenderEngineThreaded& primary() const { return *mWorkers.front(); }
+
+    // One RenderEngineThreaded per pooled context. Populated once in the
+    // constructor and immutable afterwards, so no lock is needed.
+    std::vector<std::unique_ptr<RenderEngineThreaded>> mWorkers;
+
+    // Next worker to receive a drawLayersAsync call.
+    std::atomic<size_t> mNextWorker{0};
+};
+
+} // namespace threaded
+} // namespace renderengine
+} // namespace android
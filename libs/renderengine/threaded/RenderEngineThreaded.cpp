@@ -0,0 +1,446 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#undef LOG_TAG
+#define LOG_TAG "RenderEngineThreaded"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "RenderEngineThreaded.h"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <future>
+#include <memory>
+
+#include <log/log.h>
+#include <utils/Trace.h>
+
+namespace android {
+namespace renderengine {
+namespace threaded {
+
+std::unique_ptr<RenderEngineThreaded> RenderEngineThreaded::create(
+        CreateInstanceFactory factory, const RenderEngineCreationArgs& args) {
+    return std::make_unique<RenderEngineThreaded>(std::move(factory), args);
+}
+
+RenderEngineThreaded::RenderEngineThreaded(CreateInstanceFactory factory,
+                                           const RenderEngineCreationArgs& args)
+      : RenderEngine(args) {
+    ATRACE_CALL();
+
+    mThread = std::thread(&RenderEngineThreaded::threadMain, this, std::move(factory));
+    pthread_setname_np(mThread.native_handle(), "RenderEngine");
+    // Use SCHED_FIFO to minimize jitter
+    struct sched_param param = {0};
+    param.sched_priority = 2;
+    if (pthread_setschedparam(mThread.native_handle(), SCHED_FIFO, &param) != 0) {
+        ALOGE("Couldn't set SCHED_FIFO for RenderEngine thread");
+    }
+}
+
+RenderEngineThreaded::~RenderEngineThreaded() {
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mRunning = false;
+    }
+    mCondition.notify_one();
+
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+// NO_THREAD_SAFETY_ANALYSIS is because std::unique_lock presently lacks
+// thread safety annotations.
+void RenderEngineThreaded::threadMain(CreateInstanceFactory factory) NO_THREAD_SAFETY_ANALYSIS {
+    ATRACE_CALL();
+
+    // The wrapped engine is created here so that its EGL context is current
+    // on the render thread; every queued call below runs against it. Callers
+    // cannot observe a half-constructed engine because their calls are only
+    // serviced by the loop below.
+    mRenderEngine = factory();
+
+    std::unique_lock<std::mutex> lock(mThreadMutex);
+    while (mRunning) {
+        if (!mFunctionCalls.empty()) {
+            auto task = std::move(mFunctionCalls.front());
+            mFunctionCalls.pop_front();
+            // Drop the lock while servicing the call so that callers can keep
+            // queueing work behind a long draw.
+            lock.unlock();
+            task(*mRenderEngine);
+            lock.lock();
+            continue;
+        }
+        mCondition.wait(lock,
+                        [this]() REQUIRES(mThreadMutex) {
+                            return !mRunning || !mFunctionCalls.empty();
+                        });
+    }
+
+    // Tear the engine down on this thread too, while the context is still
+    // current here.
+    mRenderEngine = nullptr;
+}
+
+void RenderEngineThreaded::primeCache() const {
+    std::promise<void> resultPromise;
+    std::future<void> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back([&resultPromise](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::primeCache");
+            instance.primeCache();
+            resultPromise.set_value();
+        });
+    }
+    mCondition.notify_one();
+    resultFuture.wait();
+}
+
+void RenderEngineThreaded::dump(std::string& result) {
+    std::promise<void> resultPromise;
+    std::future<void> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back([&resultPromise, &result](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::dump");
+            instance.dump(result);
+            resultPromise.set_value();
+        });
+    }
+    mCondition.notify_one();
+    resultFuture.wait();
+}
+
+void RenderEngineThreaded::genTextures(size_t count, uint32_t* names) {
+    std::promise<void> resultPromise;
+    std::future<void> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back(
+                [&resultPromise, count, names](renderengine::RenderEngine& instance) {
+                    ATRACE_NAME("REThreaded::genTextures");
+                    instance.genTextures(count, names);
+                    resultPromise.set_value();
+                });
+    }
+    mCondition.notify_one();
+    resultFuture.wait();
+}
+
+void RenderEngineThreaded::deleteTextures(size_t count, uint32_t const* names) {
+    std::promise<void> resultPromise;
+    std::future<void> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back(
+                [&resultPromise, count, names](renderengine::RenderEngine& instance) {
+                    ATRACE_NAME("REThreaded::deleteTextures");
+                    instance.deleteTextures(count, names);
+                    resultPromise.set_value();
+                });
+    }
+    mCondition.notify_one();
+    resultFuture.wait();
+}
+
+void RenderEngineThreaded::bindExternalTextureImage(uint32_t texName, const Image& image) {
+    std::promise<void> resultPromise;
+    std::future<void> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back(
+                [&resultPromise, texName, &image](renderengine::RenderEngine& instance) {
+                    ATRACE_NAME("REThreaded::bindExternalTextureImage");
+                    instance.bindExternalTextureImage(texName, image);
+                    resultPromise.set_value();
+                });
+    }
+    mCondition.notify_one();
+    resultFuture.wait();
+}
+
+status_t RenderEngineThreaded::bindExternalTextureBuffer(uint32_t texName,
+                                                         const sp<GraphicBuffer>& buffer,
+                                                         const sp<Fence>& fence) {
+    std::promise<status_t> resultPromise;
+    std::future<status_t> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back(
+                [&resultPromise, texName, &buffer, &fence](renderengine::RenderEngine& instance) {
+                    ATRACE_NAME("REThreaded::bindExternalTextureBuffer");
+                    status_t status = instance.bindExternalTextureBuffer(texName, buffer, fence);
+                    resultPromise.set_value(status);
+                });
+    }
+    mCondition.notify_one();
+    return resultFuture.get();
+}
+
+void RenderEngineThreaded::cacheExternalTextureBuffer(const sp<GraphicBuffer>& buffer) {
+    // The underlying engine already defers this to its own worker, so there is
+    // no result to wait for; just hop to the render thread.
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back([buffer](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::cacheExternalTextureBuffer");
+            instance.cacheExternalTextureBuffer(buffer);
+        });
+    }
+    mCondition.notify_one();
+}
+
+void RenderEngineThreaded::unbindExternalTextureBuffer(uint64_t bufferId) {
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back([bufferId](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::unbindExternalTextureBuffer");
+            instance.unbindExternalTextureBuffer(bufferId);
+        });
+    }
+    mCondition.notify_one();
+}
+
+status_t RenderEngineThreaded::bindFrameBuffer(Framebuffer* framebuffer) {
+    std::promise<status_t> resultPromise;
+    std::future<status_t> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back(
+                [&resultPromise, framebuffer](renderengine::RenderEngine& instance) {
+                    ATRACE_NAME("REThreaded::bindFrameBuffer");
+                    status_t status = instance.bindFrameBuffer(framebuffer);
+                    resultPromise.set_value(status);
+                });
+    }
+    mCondition.notify_one();
+    return resultFuture.get();
+}
+
+void RenderEngineThreaded::unbindFrameBuffer(Framebuffer* framebuffer) {
+    std::promise<void> resultPromise;
+    std::future<void> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back(
+                [&resultPromise, framebuffer](renderengine::RenderEngine& instance) {
+                    ATRACE_NAME("REThreaded::unbindFrameBuffer");
+                    instance.unbindFrameBuffer(framebuffer);
+                    resultPromise.set_value();
+                });
+    }
+    mCondition.notify_one();
+    resultFuture.wait();
+}
+
+bool RenderEngineThreaded::cleanupPostRender(CleanupMode mode) {
+    std::promise<bool> resultPromise;
+    std::future<bool> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back([&resultPromise, mode](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::cleanupPostRender");
+            bool returnValue = instance.cleanupPostRender(mode);
+            resultPromise.set_value(returnValue);
+        });
+    }
+    mCondition.notify_one();
+    return resultFuture.get();
+}
+
+void RenderEngineThreaded::setCleanupCallback(const std::function<void()>& callback) {
+    std::promise<void> resultPromise;
+    std::future<void> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back([&resultPromise, callback](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::setCleanupCallback");
+            instance.setCleanupCallback(callback);
+            resultPromise.set_value();
+        });
+    }
+    mCondition.notify_one();
+    resultFuture.wait();
+}
+
+size_t RenderEngineThreaded::getMaxTextureSize() const {
+    std::promise<size_t> resultPromise;
+    std::future<size_t> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back([&resultPromise](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::getMaxTextureSize");
+            resultPromise.set_value(instance.getMaxTextureSize());
+        });
+    }
+    mCondition.notify_one();
+    return resultFuture.get();
+}
+
+size_t RenderEngineThreaded::getMaxViewportDims() const {
+    std::promise<size_t> resultPromise;
+    std::future<size_t> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back([&resultPromise](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::getMaxViewportDims");
+            resultPromise.set_value(instance.getMaxViewportDims());
+        });
+    }
+    mCondition.notify_one();
+    return resultFuture.get();
+}
+
+bool RenderEngineThreaded::isProtected() const {
+    std::promise<bool> resultPromise;
+    std::future<bool> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back([&resultPromise](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::isProtected");
+            resultPromise.set_value(instance.isProtected());
+        });
+    }
+    mCondition.notify_one();
+    return resultFuture.get();
+}
+
+bool RenderEngineThreaded::supportsProtectedContent() const {
+    std::promise<bool> resultPromise;
+    std::future<bool> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back([&resultPromise](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::supportsProtectedContent");
+            resultPromise.set_value(instance.supportsProtectedContent());
+        });
+    }
+    mCondition.notify_one();
+    return resultFuture.get();
+}
+
+bool RenderEngineThreaded::useProtectedContext(bool useProtectedContext) {
+    std::promise<bool> resultPromise;
+    std::future<bool> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back(
+                [&resultPromise, useProtectedContext](renderengine::RenderEngine& instance) {
+                    ATRACE_NAME("REThreaded::useProtectedContext");
+                    bool returnValue = instance.useProtectedContext(useProtectedContext);
+                    resultPromise.set_value(returnValue);
+                });
+    }
+    mCondition.notify_one();
+    return resultFuture.get();
+}
+
+void RenderEngineThreaded::setViewportAndProjection(Rect viewPort, Rect sourceCrop) {
+    std::promise<void> resultPromise;
+    std::future<void> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back(
+                [&resultPromise, viewPort, sourceCrop](renderengine::RenderEngine& instance) {
+                    ATRACE_NAME("REThreaded::setViewportAndProjection");
+                    instance.setViewportAndProjection(viewPort, sourceCrop);
+                    resultPromise.set_value();
+                });
+    }
+    mCondition.notify_one();
+    resultFuture.wait();
+}
+
+status_t RenderEngineThreaded::drawLayers(const DisplaySettings& display,
+                                          const std::vector<const LayerSettings*>& layers,
+                                          ANativeWindowBuffer* buffer,
+                                          const bool useFramebufferCache,
+                                          base::unique_fd&& bufferFence,
+                                          base::unique_fd* drawFence) {
+    std::promise<status_t> resultPromise;
+    std::future<status_t> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        // The caller blocks on the result below, so everything can be captured
+        // by reference.
+        mFunctionCalls.push_back([&resultPromise, &display, &layers, buffer, useFramebufferCache,
+                                  &bufferFence, drawFence](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::drawLayers");
+            status_t status = instance.drawLayers(display, layers, buffer, useFramebufferCache,
+                                                  std::move(bufferFence), drawFence);
+            resultPromise.set_value(status);
+        });
+    }
+    mCondition.notify_one();
+    return resultFuture.get();
+}
+
+std::future<DrawLayersResult> RenderEngineThreaded::drawLayersAsync(
+        const DisplaySettings& display, std::vector<LayerSettings> layers,
+        ANativeWindowBuffer* buffer, const bool useFramebufferCache,
+        base::unique_fd&& bufferFence) {
+    ATRACE_CALL();
+    // Unlike the synchronous path, the caller's stack unwinds before the draw
+    // runs, so everything is snapshotted. shared_ptr is only there to make
+    // the move-only pieces digestible by std::function.
+    auto layersSnapshot =
+            std::make_shared<std::vector<LayerSettings>>(std::move(layers));
+    auto fence = std::make_shared<base::unique_fd>(std::move(bufferFence));
+    auto resultPromise = std::make_shared<std::promise<DrawLayersResult>>();
+    std::future<DrawLayersResult> resultFuture = resultPromise->get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back([resultPromise, display, layersSnapshot, buffer,
+                                  useFramebufferCache,
+                                  fence](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::drawLayersAsync");
+            std::vector<const LayerSettings*> layerPointers(layersSnapshot->size());
+            std::transform(layersSnapshot->begin(), layersSnapshot->end(), layerPointers.begin(),
+                           std::pointer_traits<LayerSettings*>::pointer_to);
+            DrawLayersResult result;
+            result.status = instance.drawLayers(display, layerPointers, buffer,
+                                                useFramebufferCache, std::move(*fence),
+                                                &result.drawFence);
+            resultPromise->set_value(std::move(result));
+        });
+    }
+    mCondition.notify_one();
+    return resultFuture;
+}
+
+Framebuffer* RenderEngineThreaded::getFramebufferForDrawing() {
+    std::promise<Framebuffer*> resultPromise;
+    std::future<Framebuffer*> resultFuture = resultPromise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mThreadMutex);
+        mFunctionCalls.push_back([&resultPromise](renderengine::RenderEngine& instance) {
+            ATRACE_NAME("REThreaded::getFramebufferForDrawing");
+            resultPromise.set_value(instance.getFramebufferForDrawing());
+        });
+    }
+    mCondition.notify_one();
+    return resultFuture.get();
+}
+
+} // namespace threaded
+} // namespace renderengine
+} // namespace android
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include <android-base/thread_annotations.h>
+#include <renderengine/RenderEngine.h>
+
+namespace android {
+namespace renderengine {
+namespace threaded {
+
+using CreateInstanceFactory = std::function<std::unique_ptr<renderengine::RenderEngine>()>;
+
+/**
+ * This class extends a basic RenderEngine class. It contains a thread. Each
+ * time a function of this class is called, we create a lambda function that is
+ * post to the main thread queue. The main thread then executes the functions
+ * in order, against the wrapped engine whose GL context is current on that
+ * thread.
+ *
+ * Synchronous calls (the bulk of the interface) block until the render thread
+ * has serviced them, so existing callers see unchanged behavior. The win is
+ * drawLayersAsync, which snapshots its arguments, returns immediately with a
+ * future of the draw result, and leaves the GL driver time on the render
+ * thread.
+ */
+class RenderEngineThreaded : public impl::RenderEngine {
+public:
+    static std::unique_ptr<RenderEngineThreaded> create(CreateInstanceFactory factory,
+                                                        const RenderEngineCreationArgs& args);
+
+    RenderEngineThreaded(CreateInstanceFactory factory, const RenderEngineCreationArgs& args);
+    ~RenderEngineThreaded() override;
+
+    void primeCache() const override;
+
+    void dump(std::string& result) override;
+
+    void genTextures(size_t count, uint32_t* names) override;
+    void deleteTextures(size_t count, uint32_t const* names) override;
+    void bindExternalTextureImage(uint32_t texName, const Image& image) override;
+    status_t bindExternalTextureBuffer(uint32_t texName, const sp<GraphicBuffer>& buffer,
+                                       const sp<Fence>& fence) override;
+    void cacheExternalTextureBuffer(const sp<GraphicBuffer>& buffer) override;
+    void unbindExternalTextureBuffer(uint64_t bufferId) override;
+    status_t bindFrameBuffer(Framebuffer* framebuffer) override;
+    void unbindFrameBuffer(Framebuffer* framebuffer) override;
+    bool cleanupPostRender(CleanupMode mode) override;
+    void setCleanupCallback(const std::function<void()>& callback) override;
+
+    size_t getMaxTextureSize() const override;
+    size_t getMaxViewportDims() const override;
+
+    bool isProtected() const override;
+    bool supportsProtectedContent() const override;
+    bool useProtectedContext(bool useProtectedContext) override;
+    void setViewportAndProjection(Rect viewPort, Rect sourceCrop) override;
+
+    status_t drawLayers(const DisplaySettings& display,
+                        const std::vector<const LayerSettings*>& layers,
+                        ANativeWindowBuffer* buffer, const bool useFramebufferCache,
+                        base::unique_fd&& bufferFence, base::unique_fd* drawFence) override;
+
+    std::future<DrawLayersResult> drawLayersAsync(const DisplaySettings& display,
+                                                  std::vector<LayerSettings> layers,
+                                                  ANativeWindowBuffer* buffer,
+                                                  const bool useFramebufferCache,
+                                                  base::unique_fd&& bufferFence) override;
+
+protected:
+    Framebuffer* getFramebufferForDrawing() override;
+
+private:
+    void threadMain(CreateInstanceFactory factory);
+
+    /* ------------------------------------------------------------------------
+     * Threading
+     */
+    std::thread mThread;
+    bool mRunning GUARDED_BY(mThreadMutex) = true;
+    // The queue is mutable so that the const query methods (primeCache,
+    // getMaxTextureSize, ...) can be serviced by the render thread too.
+    mutable std::deque<std::function<void(renderengine::RenderEngine& instance)>> mFunctionCalls
+            GUARDED_BY(mThreadMutex);
+    mutable std::mutex mThreadMutex;
+    mutable std::condition_variable_any mCondition;
+
+    /* ------------------------------------------------------------------------
+     * Render Engine
+     */
+    // Created, used and destroyed exclusively on mThread, so that its EGL
+    // context never has to migrate.
+    std::unique_ptr<renderengine::RenderEngine> mRenderEngine;
+};
+
+} // namespace threaded
+} // namespace renderengine
+} // namespace android
@@ -27,6 +27,7 @@
 
 #include <binder/Parcel.h>
 #include <binder/IInterface.h>
+#include <binder/IMemory.h>
 #include <binder/IResultReceiver.h>
 
 #include <sensor/Sensor.h>
@@ -42,6 +43,7 @@ enum {
     GET_DYNAMIC_SENSOR_LIST,
     CREATE_SENSOR_DIRECT_CONNECTION,
     SET_OPERATION_PARAMETER,
+    GET_SENSOR_LIST_MEMORY,
 };
 
 class BpSensorServer : public BpInterface<ISensorServer>
@@ -90,6 +92,19 @@ public:
         return v;
     }
 
+    virtual sp<IMemory> getSensorListMemory()
+    {
+        Parcel data, reply;
+        data.writeInterfaceToken(ISensorServer::getInterfaceDescriptor());
+        status_t err = remote()->transact(GET_SENSOR_LIST_MEMORY, data, &reply);
+        if (err != NO_ERROR) {
+            // Older services without this transaction; the caller falls back
+            // to getSensorList().
+            return nullptr;
+        }
+        return interface_cast<IMemory>(reply.readStrongBinder());
+    }
+
     virtual sp<ISensorEventConnection> createSensorEventConnection(const String8& packageName,
              int mode, const String16& opPackageName)
     {
@@ -232,6 +247,12 @@ status_t BnSensorServer::onTransact(
             reply->writeInt32(ret);
             return NO_ERROR;
         }
+        case GET_SENSOR_LIST_MEMORY: {
+            CHECK_INTERFACE(ISensorServer, data, reply);
+            sp<IMemory> memory(getSensorListMemory());
+            reply->writeStrongBinder(IInterface::asBinder(memory));
+            return NO_ERROR;
+        }
         case SHELL_COMMAND_TRANSACTION: {
             int in = data.readFileDescriptor();
             int out = data.readFileDescriptor();
@@ -19,6 +19,7 @@
 #include <sensor/SensorManager.h>
 
 #include <stdint.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include <cutils/native_handle.h>
@@ -27,6 +28,7 @@
 #include <utils/Singleton.h>
 
 #include <binder/IBinder.h>
+#include <binder/IMemory.h>
 #include <binder/IPermissionController.h>
 #include <binder/IServiceManager.h>
 
@@ -160,7 +162,11 @@ status_t SensorManager::assertStateLocked() {
         mDeathObserver = new DeathObserver(*const_cast<SensorManager *>(this));
         IInterface::asBinder(mSensorServer)->linkToDeath(mDeathObserver);
 
-        mSensors = mSensorServer->getSensorList(mOpPackageName);
+        // Prefer the shared-memory snapshot: enumeration then costs an mmap
+        // and in-process unflattening instead of a multi-KB binder copy.
+        if (!initSensorListFromMemoryLocked()) {
+            mSensors = mSensorServer->getSensorList(mOpPackageName);
+        }
         size_t count = mSensors.size();
         mSensorList =
                 static_cast<Sensor const**>(malloc(count * sizeof(Sensor*)));
@@ -174,6 +180,55 @@ status_t SensorManager::assertStateLocked() {
     return NO_ERROR;
 }
 
+bool SensorManager::initSensorListFromMemoryLocked() {
+    sp<IMemory> memory = mSensorServer->getSensorListMemory();
+    if (memory == nullptr) {
+        return false;
+    }
+
+    // The snapshot comes from sensorservice but treat it as untrusted and
+    // bounds-check every record; any inconsistency falls back to binder.
+    const uint8_t* base = static_cast<const uint8_t*>(memory->unsecurePointer());
+    const size_t memorySize = memory->size();
+    if (base == nullptr || memorySize < sizeof(SensorListMemoryHeader)) {
+        return false;
+    }
+
+    SensorListMemoryHeader header;
+    memcpy(&header, base, sizeof(header));
+    if (header.magic != SensorListMemoryHeader::MAGIC ||
+        header.payloadSize > memorySize - sizeof(header)) {
+        return false;
+    }
+
+    const uint8_t* record = base + sizeof(header);
+    size_t remaining = header.payloadSize;
+    Vector<Sensor> sensors;
+    sensors.setCapacity(header.count);
+    for (uint32_t i = 0; i < header.count; i++) {
+        uint32_t recordSize;
+        if (remaining < sizeof(recordSize)) {
+            return false;
+        }
+        memcpy(&recordSize, record, sizeof(recordSize));
+        record += sizeof(recordSize);
+        remaining -= sizeof(recordSize);
+        if (recordSize > remaining) {
+            return false;
+        }
+        Sensor sensor;
+        if (sensor.unflatten(record, recordSize) != NO_ERROR) {
+            return false;
+        }
+        record += recordSize;
+        remaining -= recordSize;
+        sensors.add(sensor);
+    }
+
+    mSensors = sensors;
+    return true;
+}
+
 ssize_t SensorManager::getSensorList(Sensor const* const** list) {
     Mutex::Autolock _l(mLock);
     status_t err = assertStateLocked();
@@ -30,12 +30,28 @@ typedef struct native_handle native_handle_t;
 namespace android {
 // ----------------------------------------------------------------------------
 
+class IMemory;
 class ISensorEventConnection;
 class Parcel;
 class Sensor;
 class String8;
 class String16;
 
+// Layout of the shared-memory sensor list snapshot returned by
+// ISensorServer::getSensorListMemory(). The header is followed by `count`
+// flattened Sensor records, each prefixed with a uint32_t byte size, for a
+// total of `payloadSize` bytes of records.
+struct SensorListMemoryHeader {
+    static constexpr uint32_t MAGIC = 0x534c5331; // 'SLS1'
+
+    uint32_t magic;
+    // Bumped every time the service rebuilds the snapshot, e.g. when a
+    // dynamic sensor connects.
+    uint32_t version;
+    uint32_t count;
+    uint32_t payloadSize;
+};
+
 class ISensorServer : public IInterface
 {
 public:
@@ -44,6 +60,12 @@ public:
     virtual Vector<Sensor> getSensorList(const String16& opPackageName) = 0;
     virtual Vector<Sensor> getDynamicSensorList(const String16& opPackageName) = 0;
 
+    // Returns a read-only shared-memory snapshot of getSensorList(), in the
+    // SensorListMemoryHeader layout, shared by all clients. Returns nullptr
+    // when the service cannot publish a snapshot; callers fall back to
+    // getSensorList().
+    virtual sp<IMemory> getSensorListMemory() = 0;
+
     virtual sp<ISensorEventConnection> createSensorEventConnection(const String8& packageName,
              int mode, const String16& opPackageName) = 0;
     virtual int32_t isDataInjectionEnabled() = 0;
@@ -73,6 +73,10 @@ private:
 
     explicit SensorManager(const String16& opPackageName);
     status_t assertStateLocked();
+    // Populates mSensors from the service's shared-memory snapshot. Returns
+    // false when the service does not publish one or the snapshot cannot be
+    // parsed, in which case the caller fetches the list over binder.
+    bool initSensorListFromMemoryLocked();
 
 private:
     static Mutex sLock;
@@ -16,6 +16,8 @@
 
 #include <ui/ColorSpace.h>
 
+#include <algorithm>
+
 using namespace std::placeholders;
 
 namespace android {
@@ -376,6 +378,17 @@ std::unique_ptr<float3[]> ColorSpace::createLUT(uint32_t size, const ColorSpace&
     return lut;
 }
 
+std::vector<float> ColorSpace::createTransferLUT(const transfer_function& fn, uint32_t size) {
+    size = clamp(size, 2u, 4096u);
+    const float m = 1.0f / float(size - 1);
+
+    std::vector<float> lut(size);
+    for (uint32_t i = 0; i < size; i++) {
+        lut[i] = fn(float(i) * m);
+    }
+    return lut;
+}
+
 static const float2 ILLUMINANT_D50_XY = {0.34567f, 0.35850f};
 static const float3 ILLUMINANT_D50_XYZ = {0.964212f, 1.0f, 0.825188f};
 static const mat3 BRADFORD = mat3{
@@ -415,6 +428,34 @@ ColorSpaceConnector::ColorSpaceConnector(
 
         mTransform = xyzToRGB * rgbToXYZ;
     }
+
+    mSourceEOTFLut = ColorSpace::createTransferLUT(mSource.getEOTF(), TRANSFER_LUT_SIZE);
+    mDestinationOETFLut = ColorSpace::createTransferLUT(mDestination.getOETF(), TRANSFER_LUT_SIZE);
+}
+
+static float sampleLUT(const std::vector<float>& lut, float x) noexcept {
+    x = saturate(x);
+    const float index = x * float(lut.size() - 1);
+    const size_t lo = size_t(index);
+    const size_t hi = std::min(lo + 1, lut.size() - 1);
+    const float frac = index - float(lo);
+    return lut[lo] + (lut[hi] - lut[lo]) * frac;
+}
+
+void ColorSpaceConnector::transform(float3* v, size_t count) const noexcept {
+    // Written as plain indexed loops over flat tables so the compiler can
+    // vectorize the interpolation and matrix arithmetic on every target,
+    // rather than hand-coding one instruction set.
+    for (size_t i = 0; i < count; i++) {
+        float3 c;
+        c.r = sampleLUT(mSourceEOTFLut, v[i].r);
+        c.g = sampleLUT(mSourceEOTFLut, v[i].g);
+        c.b = sampleLUT(mSourceEOTFLut, v[i].b);
+        c = mTransform * c;
+        v[i].r = sampleLUT(mDestinationOETFLut, c.r);
+        v[i].g = sampleLUT(mDestinationOETFLut, c.g);
+        v[i].b = sampleLUT(mDestinationOETFLut, c.b);
+    }
 }
 
 }; // namespace android
@@ -19,14 +19,23 @@
 #define LOG_TAG "FenceTime"
 
 #include <cutils/compiler.h>  // For CC_[UN]LIKELY
+#include <cutils/properties.h>
 #include <utils/Log.h>
+#include <errno.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 #include <memory>
 
 namespace android {
 
+ANDROID_SINGLETON_STATIC_INSTANCE(FenceTimeWatcher);
+
 // ============================================================================
 // FenceTime
 // ============================================================================
@@ -175,6 +184,14 @@ FenceTime::FenceTime(const sp<Fence>& fence, bool forceValidForTest)
             Fence::SIGNAL_TIME_INVALID : Fence::SIGNAL_TIME_PENDING) {
 }
 
+int FenceTime::dupPendingFenceFd() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mFence.get() || !mFence->isValid()) {
+        return -1;
+    }
+    return mFence->dup();
+}
+
 void FenceTime::signalForTest(nsecs_t signalTime) {
     // To be realistic, this should really set a hidden value that
     // gets picked up in the next call to getSignalTime, but this should
@@ -260,7 +277,7 @@ status_t FenceTime::Snapshot::unflatten(
 // FenceTimeline
 // ============================================================================
 void FenceTimeline::push(const std::shared_ptr<FenceTime>& fence) {
-    std::lock_guard<std::mutex> lock(mMutex);
+    std::unique_lock<std::mutex> lock(mMutex);
     while (mQueue.size() >= MAX_ENTRIES) {
         // This is a sanity check to make sure the queue doesn't grow unbounded.
         // MAX_ENTRIES should be big enough not to trigger this path.
@@ -276,6 +293,11 @@ void FenceTimeline::push(const std::shared_ptr<FenceTime>& fence) {
         mQueue.pop();
     }
     mQueue.push(fence);
+    lock.unlock();
+
+    // Let the shared watcher resolve the signal time as soon as the fence
+    // fires, so updateSignalTimes() usually finds it already cached.
+    FenceTimeWatcher::getInstance().watch(fence);
 }
 
 void FenceTimeline::updateSignalTimes() {
@@ -299,6 +321,124 @@ void FenceTimeline::updateSignalTimes() {
     }
 }
 
+// ============================================================================
+// FenceTimeWatcher
+// ============================================================================
+FenceTimeWatcher::FenceTimeWatcher() {
+    char value[PROPERTY_VALUE_MAX];
+    property_get("debug.ui.fence_watcher", value, "1");
+    if (atoi(value) == 0) {
+        return;
+    }
+
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpollFd < 0) {
+        ALOGE("FenceTimeWatcher: epoll_create1 failed: %s", strerror(errno));
+        return;
+    }
+    mStopFd = eventfd(0, EFD_CLOEXEC);
+    if (mStopFd < 0) {
+        ALOGE("FenceTimeWatcher: eventfd failed: %s", strerror(errno));
+        close(mEpollFd);
+        mEpollFd = -1;
+        return;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = mStopFd;
+    epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mStopFd, &event);
+
+    mThread = std::thread(&FenceTimeWatcher::threadMain, this);
+}
+
+FenceTimeWatcher::~FenceTimeWatcher() {
+    if (mThread.joinable()) {
+        uint64_t one = 1;
+        TEMP_FAILURE_RETRY(write(mStopFd, &one, sizeof(one)));
+        mThread.join();
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& [fd, fenceTime] : mWatched) {
+        close(fd);
+    }
+    mWatched.clear();
+    if (mStopFd >= 0) {
+        close(mStopFd);
+    }
+    if (mEpollFd >= 0) {
+        close(mEpollFd);
+    }
+}
+
+void FenceTimeWatcher::watch(const std::shared_ptr<FenceTime>& fenceTime) {
+    if (mEpollFd < 0 || fenceTime == nullptr || !fenceTime->isValid()) {
+        return;
+    }
+    if (fenceTime->getCachedSignalTime() != Fence::SIGNAL_TIME_PENDING) {
+        return;
+    }
+    const int fd = fenceTime->dupPendingFenceFd();
+    if (fd < 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mWatched.emplace(fd, fenceTime);
+    }
+    // It is safe to add to the epoll set while the watcher thread is waiting
+    // on it.
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        ALOGE("FenceTimeWatcher: failed to watch fence: %s", strerror(errno));
+        std::lock_guard<std::mutex> lock(mMutex);
+        mWatched.erase(fd);
+        close(fd);
+    }
+}
+
+void FenceTimeWatcher::threadMain() {
+    pthread_setname_np(pthread_self(), "FenceWatcher");
+
+    epoll_event events[16];
+    while (true) {
+        const int count = epoll_wait(mEpollFd, events, 16, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ALOGE("FenceTimeWatcher: epoll_wait failed: %s", strerror(errno));
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            const int fd = events[i].data.fd;
+            if (fd == mStopFd) {
+                return;
+            }
+
+            std::shared_ptr<FenceTime> fenceTime;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                auto it = mWatched.find(fd);
+                if (it != mWatched.end()) {
+                    fenceTime = it->second.lock();
+                    mWatched.erase(it);
+                }
+            }
+            epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+
+            if (fenceTime) {
+                // The fence has signaled, so this caches the signal time and
+                // drops the FenceTime's reference without blocking.
+                fenceTime->getSignalTime();
+            }
+        }
+    }
+}
+
 // ============================================================================
 // FenceToFenceTimeMap
 // ============================================================================
@@ -26,7 +26,7 @@ size_t FrameStats::getFlattenedSize() const {
     const size_t timestampSize = sizeof(nsecs_t);
 
     size_t size = timestampSize;
-    size += 3 * desiredPresentTimesNano.size() * timestampSize;
+    size += 4 * desiredPresentTimesNano.size() * timestampSize;
 
     return size;
 }
@@ -50,6 +50,9 @@ status_t FrameStats::flatten(void* buffer, size_t size) const {
     timestamps += frameCount;
 
     memcpy(timestamps, frameReadyTimesNano.array(), frameCount * timestampSize);
+    timestamps += frameCount;
+
+    memcpy(timestamps, gpuCompositionDoneTimesNano.array(), frameCount * timestampSize);
 
     return NO_ERROR;
 }
@@ -62,7 +65,7 @@ status_t FrameStats::unflatten(void const* buffer, size_t size) {
     }
 
     nsecs_t const* timestamps = reinterpret_cast<nsecs_t const*>(buffer);
-    size_t frameCount = (size - timestampSize) / (3 * timestampSize);
+    size_t frameCount = (size - timestampSize) / (4 * timestampSize);
 
     memcpy(&refreshPeriodNano, timestamps, timestampSize);
     timestamps += 1;
@@ -77,6 +80,10 @@ status_t FrameStats::unflatten(void const* buffer, size_t size) {
 
     frameReadyTimesNano.resize(frameCount);
     memcpy(frameReadyTimesNano.editArray(), timestamps, frameCount * timestampSize);
+    timestamps += frameCount;
+
+    gpuCompositionDoneTimesNano.resize(frameCount);
+    memcpy(gpuCompositionDoneTimesNano.editArray(), timestamps, frameCount * timestampSize);
 
     return NO_ERROR;
 }
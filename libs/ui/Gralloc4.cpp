@@ -154,6 +154,11 @@ status_t Gralloc4Mapper::importBuffer(const hardware::hidl_handle& rawHandle,
 }
 
 void Gralloc4Mapper::freeBuffer(buffer_handle_t bufferHandle) const {
+    {
+        std::lock_guard<std::mutex> lock(mPlaneLayoutCacheMutex);
+        mPlaneLayoutCache.erase(bufferHandle);
+    }
+
     auto buffer = const_cast<native_handle_t*>(bufferHandle);
     auto ret = mMapper->freeBuffer(buffer);
 
@@ -589,8 +594,26 @@ status_t Gralloc4Mapper::getChromaSiting(buffer_handle_t bufferHandle,
 
 status_t Gralloc4Mapper::getPlaneLayouts(buffer_handle_t bufferHandle,
                                          std::vector<ui::PlaneLayout>* outPlaneLayouts) const {
-    return get(bufferHandle, gralloc4::MetadataType_PlaneLayouts, gralloc4::decodePlaneLayouts,
-               outPlaneLayouts);
+    if (!outPlaneLayouts) {
+        return BAD_VALUE;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mPlaneLayoutCacheMutex);
+        auto it = mPlaneLayoutCache.find(bufferHandle);
+        if (it != mPlaneLayoutCache.end()) {
+            *outPlaneLayouts = it->second;
+            return NO_ERROR;
+        }
+    }
+
+    status_t error = get(bufferHandle, gralloc4::MetadataType_PlaneLayouts,
+                         gralloc4::decodePlaneLayouts, outPlaneLayouts);
+    if (error == NO_ERROR) {
+        std::lock_guard<std::mutex> lock(mPlaneLayoutCacheMutex);
+        mPlaneLayoutCache.emplace(bufferHandle, *outPlaneLayouts);
+    }
+    return error;
 }
 
 status_t Gralloc4Mapper::getDataspace(buffer_handle_t bufferHandle,
@@ -19,7 +19,16 @@
 
 #include <ui/GraphicBuffer.h>
 
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include <cutils/atomic.h>
+#include <cutils/properties.h>
 
 #include <grallocusage/GrallocUsageConversion.h>
 
@@ -29,6 +38,137 @@
 
 namespace android {
 
+namespace {
+
+// Per-process cache of gralloc imports keyed by buffer ID. Consumers like
+// SurfaceFlinger receive the same client buffers over and over across
+// transactions; importing the handle once and refcounting the mapping turns
+// the repeat arrivals into a hash lookup instead of a gralloc call.
+//
+// Buffer IDs are predictable (pid + counter) and unflatten runs on
+// untrusted parcels, so an ID match alone must never hand out a cached
+// import. Each entry therefore records the dma-buf identity (st_dev,
+// st_ino) of the fds it was imported from plus the non-fd words of the raw
+// handle, and a hit requires the arriving handle to match both. The fds are
+// the unforgeable part: a client can only present fds for buffers it
+// legitimately holds, so a forged or colliding handle (manually flattened
+// buffers, a reused producer pid) gets a fresh uncached import instead.
+class BufferImportCache {
+public:
+    static BufferImportCache& get() {
+        static BufferImportCache instance;
+        return instance;
+    }
+
+    bool enabled() const { return mEnabled; }
+
+    // Resolves bufferId to an existing mapping when possible, importing
+    // rawHandle otherwise. The caller keeps ownership of rawHandle either
+    // way and releases the returned handle with freeBuffer().
+    status_t importBuffer(uint64_t bufferId, const native_handle_t* rawHandle, uint32_t width,
+                          uint32_t height, uint32_t layerCount, PixelFormat format, uint64_t usage,
+                          uint32_t stride, buffer_handle_t* outHandle) {
+        // A few fstat calls per arrival, much cheaper than a gralloc import.
+        std::vector<FdIdentity> fdIdentity;
+        if (!getFdIdentity(rawHandle, &fdIdentity)) {
+            return GraphicBufferMapper::get().importBuffer(rawHandle, width, height, layerCount,
+                                                           format, usage, stride, outHandle);
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mEntriesById.find(bufferId);
+        if (it != mEntriesById.end() && matches(it->second, rawHandle, fdIdentity)) {
+            it->second.refCount++;
+            *outHandle = it->second.handle;
+            return NO_ERROR;
+        }
+        status_t err = GraphicBufferMapper::get().importBuffer(rawHandle, width, height, layerCount,
+                                                               format, usage, stride, outHandle);
+        if (err != NO_ERROR) {
+            return err;
+        }
+        if (it == mEntriesById.end()) {
+            Entry entry;
+            entry.handle = *outHandle;
+            entry.refCount = 1;
+            entry.fdIdentity = std::move(fdIdentity);
+            entry.rawInts.assign(rawHandle->data + rawHandle->numFds,
+                                 rawHandle->data + rawHandle->numFds + rawHandle->numInts);
+            mIdsByHandle.emplace(*outHandle, bufferId);
+            mEntriesById.emplace(bufferId, std::move(entry));
+        }
+        // On an identity mismatch the existing entry stays in place (it is
+        // still referenced) and this arrival gets an uncached import.
+        return NO_ERROR;
+    }
+
+    // Drops one reference on an imported handle, freeing the mapping when
+    // the last reference goes away. Handles that did not come from this
+    // cache are freed directly.
+    void freeBuffer(buffer_handle_t handle) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mIdsByHandle.find(handle);
+            if (it != mIdsByHandle.end()) {
+                auto entryIt = mEntriesById.find(it->second);
+                if (--entryIt->second.refCount > 0) {
+                    return;
+                }
+                mEntriesById.erase(entryIt);
+                mIdsByHandle.erase(it);
+            }
+        }
+        GraphicBufferMapper::get().freeBuffer(handle);
+    }
+
+private:
+    BufferImportCache() {
+        char value[PROPERTY_VALUE_MAX];
+        property_get("debug.ui.buffer_import_cache", value, "1");
+        mEnabled = atoi(value) != 0;
+    }
+
+    // Identifies the dma-buf (or other kernel object) behind one handle fd.
+    using FdIdentity = std::pair<dev_t, ino_t>;
+
+    struct Entry {
+        buffer_handle_t handle = nullptr;
+        size_t refCount = 0;
+        // Identity of the fds and the non-fd words of the raw handle at
+        // first import, both of which an arriving handle must match before
+        // it resolves to this entry.
+        std::vector<FdIdentity> fdIdentity;
+        std::vector<int> rawInts;
+    };
+
+    static bool getFdIdentity(const native_handle_t* rawHandle,
+                              std::vector<FdIdentity>* outIdentity) {
+        outIdentity->reserve(static_cast<size_t>(rawHandle->numFds));
+        for (int i = 0; i < rawHandle->numFds; i++) {
+            struct stat st;
+            if (fstat(rawHandle->data[i], &st) != 0) {
+                return false;
+            }
+            outIdentity->emplace_back(st.st_dev, st.st_ino);
+        }
+        return true;
+    }
+
+    bool matches(const Entry& entry, const native_handle_t* rawHandle,
+                 const std::vector<FdIdentity>& fdIdentity) const {
+        return entry.fdIdentity == fdIdentity &&
+                entry.rawInts.size() == static_cast<size_t>(rawHandle->numInts) &&
+                std::equal(entry.rawInts.begin(), entry.rawInts.end(),
+                           rawHandle->data + rawHandle->numFds);
+    }
+
+    bool mEnabled;
+    std::mutex mMutex;
+    std::unordered_map<uint64_t, Entry> mEntriesById;
+    std::unordered_map<buffer_handle_t, uint64_t> mIdsByHandle;
+};
+
+} // anonymous namespace
+
 // ===========================================================================
 // Buffer and implementation of ANativeWindowBuffer
 // ===========================================================================
@@ -88,6 +228,23 @@ GraphicBuffer::GraphicBuffer(uint32_t inWidth, uint32_t inHeight, PixelFormat in
                               std::move(requestorName));
 }
 
+GraphicBuffer::GraphicBuffer(uint32_t inWidth, uint32_t inHeight, PixelFormat inFormat,
+                             uint32_t inLayerCount, uint64_t inUsage, uint32_t inStride,
+                             buffer_handle_t inHandle)
+      : GraphicBuffer() {
+    // mOwner stays ownData: the handle came from GraphicBufferAllocator and goes back
+    // to it in free_handle().
+    width = static_cast<int>(inWidth);
+    height = static_cast<int>(inHeight);
+    format = inFormat;
+    layerCount = inLayerCount;
+    usage = inUsage;
+    usage_deprecated = int(usage);
+    stride = static_cast<int>(inStride);
+    handle = inHandle;
+    mBufferMapper.getTransportSize(handle, &mTransportNumFds, &mTransportNumInts);
+}
+
 // deprecated
 GraphicBuffer::GraphicBuffer(uint32_t inWidth, uint32_t inHeight,
         PixelFormat inFormat, uint32_t inLayerCount, uint32_t inUsage,
@@ -120,7 +277,9 @@ GraphicBuffer::~GraphicBuffer()
 void GraphicBuffer::free_handle()
 {
     if (mOwner == ownHandle) {
-        mBufferMapper.freeBuffer(handle);
+        // The cache forwards to GraphicBufferMapper for handles it did not
+        // hand out (initWithHandle imports, or the cache being disabled).
+        BufferImportCache::get().freeBuffer(handle);
     } else if (mOwner == ownData) {
         GraphicBufferAllocator& allocator(GraphicBufferAllocator::get());
         allocator.free(handle);
@@ -496,8 +655,15 @@ status_t GraphicBuffer::unflatten(void const*& buffer, size_t& size, int const*&
 
     if (handle != nullptr) {
         buffer_handle_t importedHandle;
-        status_t err = mBufferMapper.importBuffer(handle, uint32_t(width), uint32_t(height),
-                uint32_t(layerCount), format, usage, uint32_t(stride), &importedHandle);
+        status_t err;
+        if (BufferImportCache::get().enabled()) {
+            err = BufferImportCache::get().importBuffer(mId, handle, uint32_t(width),
+                    uint32_t(height), uint32_t(layerCount), format, usage, uint32_t(stride),
+                    &importedHandle);
+        } else {
+            err = mBufferMapper.importBuffer(handle, uint32_t(width), uint32_t(height),
+                    uint32_t(layerCount), format, usage, uint32_t(stride), &importedHandle);
+        }
         if (err != NO_ERROR) {
             width = height = stride = format = usage_deprecated = 0;
             layerCount = 0;
@@ -26,6 +26,8 @@
 #include <grallocusage/GrallocUsageConversion.h>
 
 #include <android-base/stringprintf.h>
+#include <cutils/properties.h>
+#include <hardware/gralloc.h>
 #include <log/log.h>
 #include <utils/Singleton.h>
 #include <utils/Trace.h>
@@ -47,7 +49,26 @@ Mutex GraphicBufferAllocator::sLock;
 KeyedVector<buffer_handle_t,
     GraphicBufferAllocator::alloc_rec_t> GraphicBufferAllocator::sAllocList;
 
-GraphicBufferAllocator::GraphicBufferAllocator() : mMapper(GraphicBufferMapper::getInstance()) {
+namespace {
+
+// How long a freed buffer may sit on the free-list before it is handed back
+// to the HAL for real.
+constexpr nsecs_t kPoolEntryTTL = seconds_to_nanoseconds(1);
+
+size_t poolBudgetBytes() {
+    char value[PROPERTY_VALUE_MAX];
+    property_get("debug.ui.graphic_buffer_pool_kb", value, "0");
+    const int budgetKb = atoi(value);
+    if (budgetKb <= 0) {
+        return 0;
+    }
+    return static_cast<size_t>(budgetKb) * 1024;
+}
+
+} // namespace
+
+GraphicBufferAllocator::GraphicBufferAllocator()
+      : mMapper(GraphicBufferMapper::getInstance()), mPoolBudgetBytes(poolBudgetBytes()) {
     mAllocator = std::make_unique<const Gralloc4Allocator>(
             reinterpret_cast<const Gralloc4Mapper&>(mMapper.getGrallocMapper()));
     if (mAllocator->isLoaded()) {
@@ -101,6 +122,15 @@ void GraphicBufferAllocator::dump(std::string& result, bool less) const {
     }
     StringAppendF(&result, "Total allocated by GraphicBufferAllocator (estimate): %.2f KB\n",
                   static_cast<double>(total) / 1024.0);
+    if (mPoolBudgetBytes > 0) {
+        size_t poolCount = 0;
+        for (const auto& entries : mPool) {
+            poolCount += entries.second.size();
+        }
+        StringAppendF(&result, "Pooled for reuse: %zu buffer(s), %.2f KB of %.2f KB budget\n",
+                      poolCount, static_cast<double>(mPoolBytes) / 1024.0,
+                      static_cast<double>(mPoolBudgetBytes) / 1024.0);
+    }
 
     result.append(mAllocator->dumpDebugInfo(less));
 }
@@ -134,6 +164,14 @@ status_t GraphicBufferAllocator::allocateHelper(uint32_t width, uint32_t height,
     if (layerCount < 1)
         layerCount = 1;
 
+    if (importBuffer && mPoolBudgetBytes > 0) {
+        Mutex::Autolock _l(sLock);
+        if (takeFromPoolLocked(width, height, format, layerCount, usage, handle, stride,
+                               requestorName)) {
+            return NO_ERROR;
+        }
+    }
+
     status_t error;
     {
         // TODO(b/169449588) restore original behavior instead of always setting
@@ -188,6 +226,83 @@ status_t GraphicBufferAllocator::allocate(uint32_t width, uint32_t height, Pixel
                           true);
 }
 
+status_t GraphicBufferAllocator::allocateBatch(uint32_t width, uint32_t height, PixelFormat format,
+                                               uint32_t layerCount, uint64_t usage, uint32_t count,
+                                               buffer_handle_t* outHandles, uint32_t* outStride,
+                                               std::string requestorName) {
+    ATRACE_CALL();
+
+    if (count == 0 || !outHandles || !outStride) {
+        return BAD_VALUE;
+    }
+
+    // make sure to not allocate a N x 0 or 0 x N buffer, since this is
+    // allowed from an API stand-point allocate a 1x1 buffer instead.
+    if (!width || !height)
+        width = height = 1;
+
+    const uint32_t bpp = bytesPerPixel(format);
+    if (std::numeric_limits<size_t>::max() / width / height < static_cast<size_t>(bpp)) {
+        ALOGE("Failed to allocate (%u x %u) layerCount %u format %d "
+              "usage %" PRIx64 ": Requesting too large a buffer size",
+              width, height, layerCount, format, usage);
+        return BAD_VALUE;
+    }
+
+    // Ensure that layerCount is valid.
+    if (layerCount < 1)
+        layerCount = 1;
+
+    // Note: batch allocations go straight to the HAL rather than consulting the reuse
+    // free-list, since the batch needs a uniform stride and its main use is cold queue
+    // setup where the free-list is empty anyway.
+    status_t error;
+    {
+        // TODO(b/169449588) restore original behavior instead of always setting
+        //     flag back to zero
+        // TODO(b/158870657) assert error once all devices use scudo
+        (void)mallopt(M_THREAD_DISABLE_MEM_INIT, 1);
+        error = mAllocator->allocate(requestorName, width, height, format, layerCount, usage,
+                                     count, outStride, outHandles, true);
+        (void)mallopt(M_THREAD_DISABLE_MEM_INIT, 0);
+    }
+
+    if (error != NO_ERROR) {
+        ALOGE("Failed to allocate batch of %u (%u x %u) layerCount %u format %d "
+              "usage %" PRIx64 ": %d",
+              count, width, height, layerCount, format, usage, error);
+        return NO_MEMORY;
+    }
+
+    size_t bufSize;
+
+    // if stride has no meaning or is too large,
+    // approximate size with the input width instead
+    if ((*outStride) != 0 &&
+        std::numeric_limits<size_t>::max() / height / (*outStride) < static_cast<size_t>(bpp)) {
+        bufSize = static_cast<size_t>(width) * height * bpp;
+    } else {
+        bufSize = static_cast<size_t>((*outStride)) * height * bpp;
+    }
+
+    Mutex::Autolock _l(sLock);
+    KeyedVector<buffer_handle_t, alloc_rec_t>& list(sAllocList);
+    alloc_rec_t rec;
+    rec.width = width;
+    rec.height = height;
+    rec.stride = *outStride;
+    rec.format = format;
+    rec.layerCount = layerCount;
+    rec.usage = usage;
+    rec.size = bufSize;
+    rec.requestorName = std::move(requestorName);
+    for (uint32_t i = 0; i < count; i++) {
+        list.add(outHandles[i], rec);
+    }
+
+    return NO_ERROR;
+}
+
 status_t GraphicBufferAllocator::allocateRawHandle(uint32_t width, uint32_t height,
                                                    PixelFormat format, uint32_t layerCount,
                                                    uint64_t usage, buffer_handle_t* handle,
@@ -209,6 +324,13 @@ status_t GraphicBufferAllocator::free(buffer_handle_t handle)
 {
     ATRACE_CALL();
 
+    if (mPoolBudgetBytes > 0) {
+        Mutex::Autolock _l(sLock);
+        if (returnToPoolLocked(handle)) {
+            return NO_ERROR;
+        }
+    }
+
     // We allocated a buffer from the allocator and imported it into the
     // mapper to get the handle.  We just need to free the handle now.
     mMapper.freeBuffer(handle);
@@ -220,5 +342,102 @@ status_t GraphicBufferAllocator::free(buffer_handle_t handle)
     return NO_ERROR;
 }
 
+bool GraphicBufferAllocator::takeFromPoolLocked(uint32_t width, uint32_t height,
+                                                PixelFormat format, uint32_t layerCount,
+                                                uint64_t usage, buffer_handle_t* handle,
+                                                uint32_t* stride,
+                                                const std::string& requestorName) {
+    expirePoolEntriesLocked(systemTime());
+
+    auto it = mPool.find(PoolKey{width, height, format, layerCount, usage});
+    if (it == mPool.end()) {
+        return false;
+    }
+
+    // The most recently freed entry is the warmest one.
+    const PooledBuffer entry = it->second.back();
+    it->second.pop_back();
+    if (it->second.empty()) {
+        mPool.erase(it);
+    }
+    mPoolBytes -= entry.size;
+
+    *handle = entry.handle;
+    *stride = entry.stride;
+
+    const ssize_t idx = sAllocList.indexOfKey(entry.handle);
+    if (idx >= 0) {
+        sAllocList.editValueAt(static_cast<size_t>(idx)).requestorName = requestorName;
+    }
+    return true;
+}
+
+bool GraphicBufferAllocator::returnToPoolLocked(buffer_handle_t handle) {
+    const nsecs_t now = systemTime();
+    expirePoolEntriesLocked(now);
+
+    ssize_t idx = sAllocList.indexOfKey(handle);
+    if (idx < 0) {
+        return false;
+    }
+    const alloc_rec_t rec = sAllocList.valueAt(static_cast<size_t>(idx));
+
+    // Records without a known size cannot be accounted against the budget,
+    // and protected buffers must be released back to the HAL promptly.
+    if (rec.size == 0 || rec.size > mPoolBudgetBytes || (rec.usage & GRALLOC_USAGE_PROTECTED)) {
+        return false;
+    }
+
+    // Make room by retiring the coldest entries first.
+    while (mPoolBytes + rec.size > mPoolBudgetBytes && !mPool.empty()) {
+        auto oldest = mPool.end();
+        for (auto poolIt = mPool.begin(); poolIt != mPool.end(); ++poolIt) {
+            if (oldest == mPool.end() ||
+                poolIt->second.front().freeTime < oldest->second.front().freeTime) {
+                oldest = poolIt;
+            }
+        }
+        const PooledBuffer& evicted = oldest->second.front();
+        mMapper.freeBuffer(evicted.handle);
+        sAllocList.removeItem(evicted.handle);
+        mPoolBytes -= evicted.size;
+        oldest->second.pop_front();
+        if (oldest->second.empty()) {
+            mPool.erase(oldest);
+        }
+    }
+
+    // Evictions may have shuffled the alloc list; find the record again to
+    // relabel it.
+    idx = sAllocList.indexOfKey(handle);
+    if (idx < 0) {
+        return false;
+    }
+    sAllocList.editValueAt(static_cast<size_t>(idx)).requestorName = "[pooled]";
+
+    mPool[PoolKey{rec.width, rec.height, rec.format, rec.layerCount, rec.usage}].push_back(
+            PooledBuffer{handle, rec.stride, rec.size, now});
+    mPoolBytes += rec.size;
+    return true;
+}
+
+void GraphicBufferAllocator::expirePoolEntriesLocked(nsecs_t now) {
+    for (auto it = mPool.begin(); it != mPool.end();) {
+        auto& entries = it->second;
+        while (!entries.empty() && now - entries.front().freeTime > kPoolEntryTTL) {
+            const PooledBuffer& entry = entries.front();
+            mMapper.freeBuffer(entry.handle);
+            sAllocList.removeItem(entry.handle);
+            mPoolBytes -= entry.size;
+            entries.pop_front();
+        }
+        if (entries.empty()) {
+            it = mPool.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 // ---------------------------------------------------------------------------
 }; // namespace android
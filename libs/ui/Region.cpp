@@ -70,10 +70,7 @@ Region::Region() {
     mStorage.push_back(Rect(0, 0));
 }
 
-Region::Region(const Region& rhs)
-{
-    mStorage.clear();
-    mStorage.insert(mStorage.begin(), rhs.mStorage.begin(), rhs.mStorage.end());
+Region::Region(const Region& rhs) : mStorage(rhs.mStorage) {
 #if defined(VALIDATE_REGIONS)
     validate(rhs, "rhs copy-ctor");
 #endif
@@ -229,8 +226,7 @@ Region& Region::operator = (const Region& rhs)
         return *this;
     }
 
-    mStorage.clear();
-    mStorage.insert(mStorage.begin(), rhs.mStorage.begin(), rhs.mStorage.end());
+    mStorage = rhs.mStorage;
     return *this;
 }
 
@@ -329,8 +325,8 @@ Region& Region::subtractSelf(const Rect& r) {
     return operationSelf(r, op_nand);
 }
 Region& Region::operationSelf(const Rect& r, uint32_t op) {
-    Region lhs(*this);
-    boolean_operation(op, *this, lhs, r);
+    // boolean_operation copies the aliased storage only if the rasterizer runs
+    boolean_operation(op, *this, *this, r);
     return *this;
 }
 
@@ -353,8 +349,8 @@ Region& Region::subtractSelf(const Region& rhs) {
     return operationSelf(rhs, op_nand);
 }
 Region& Region::operationSelf(const Region& rhs, uint32_t op) {
-    Region lhs(*this);
-    boolean_operation(op, *this, lhs, rhs);
+    // boolean_operation copies the aliased storage only if the rasterizer runs
+    boolean_operation(op, *this, *this, rhs);
     return *this;
 }
 
@@ -438,8 +434,8 @@ Region& Region::subtractSelf(const Region& rhs, int dx, int dy) {
     return operationSelf(rhs, dx, dy, op_nand);
 }
 Region& Region::operationSelf(const Region& rhs, int dx, int dy, uint32_t op) {
-    Region lhs(*this);
-    boolean_operation(op, *this, lhs, rhs, dx, dy);
+    // boolean_operation copies the aliased storage only if the rasterizer runs
+    boolean_operation(op, *this, *this, rhs, dx, dy);
     return *this;
 }
 
@@ -643,6 +639,65 @@ bool Region::validate(const Region& reg, const char* name, bool silent)
     return result;
 }
 
+static inline bool rect_contains(const Rect& outer, const Rect& inner) {
+    return outer.left <= inner.left && outer.top <= inner.top
+        && outer.right >= inner.right && outer.bottom >= inner.bottom;
+}
+
+// Fast path for single-rect operands, which dominate damage-region math
+// (full-layer damage against a clip, visible-region against a screen
+// rect).  Handles the cases whose result is again at most one rectangle
+// without spinning up the span rasterizer; returns false to fall back.
+// `l` and `r` must be copies, since dst may alias an operand.
+static bool boolean_operation_1x1(uint32_t op, Region& dst,
+        const Rect& l, const Rect& r)
+{
+    switch (op) {
+        case op_and: {
+            Rect i;
+            if (!l.isEmpty() && !r.isEmpty() && l.intersect(r, &i)) {
+                dst.set(i);
+            } else {
+                dst.clear();
+            }
+            return true;
+        }
+        case op_or:
+            if (r.isEmpty() || rect_contains(l, r)) {
+                dst.set(l);
+                return true;
+            }
+            if (l.isEmpty() || rect_contains(r, l)) {
+                dst.set(r);
+                return true;
+            }
+            return false;
+        case op_nand: {
+            Rect i;
+            if (l.isEmpty() || rect_contains(r, l)) {
+                dst.clear();
+                return true;
+            }
+            if (r.isEmpty() || !l.intersect(r, &i)) {
+                dst.set(l);
+                return true;
+            }
+            return false;
+        }
+        case op_xor:
+            if (r.isEmpty()) {
+                dst.set(l);
+                return true;
+            }
+            if (l.isEmpty()) {
+                dst.set(r);
+                return true;
+            }
+            return false;
+    }
+    return false;
+}
+
 void Region::boolean_operation(uint32_t op, Region& dst,
         const Region& lhs,
         const Region& rhs, int dx, int dy)
@@ -659,6 +714,28 @@ void Region::boolean_operation(uint32_t op, Region& dst,
     size_t rhs_count;
     Rect const * const rhs_rects = rhs.getArray(&rhs_count);
 
+    if (lhs_count == 1 && rhs_count == 1) {
+        const Rect lhs_rect(lhs_rects[0]);
+        Rect rhs_rect(rhs_rects[0]);
+        rhs_rect.offsetBy(dx, dy);
+        if (boolean_operation_1x1(op, dst, lhs_rect, rhs_rect)) {
+            return;
+        }
+    }
+
+    // The rasterizer writes into dst's storage while the operand arrays are
+    // still being read from it, so when dst aliases an operand the aliased
+    // storage must be copied out first. Doing this here rather than in the
+    // *Self() operators skips the copy whenever a fast path above resolved
+    // the operation (which only reads the operands through locals).
+    if (&dst == &lhs || &dst == &rhs) {
+        const Region aliased(dst);
+        const Region& l = (&dst == &lhs) ? aliased : lhs;
+        const Region& r = (&dst == &rhs) ? aliased : rhs;
+        boolean_operation(op, dst, l, r, dx, dy);
+        return;
+    }
+
     region_operator<Rect>::region lhs_region(lhs_rects, lhs_count);
     region_operator<Rect>::region rhs_region(rhs_rects, rhs_count, dx, dy);
     region_operator<Rect> operation(op, lhs_region, rhs_region);
@@ -770,6 +847,28 @@ void Region::boolean_operation(uint32_t op, Region& dst,
     size_t lhs_count;
     Rect const * const lhs_rects = lhs.getArray(&lhs_count);
 
+    Rect rhs_rect(rhs);
+    rhs_rect.offsetBy(dx, dy);
+
+    if (lhs_count == 1) {
+        const Rect lhs_rect(lhs_rects[0]);
+        if (boolean_operation_1x1(op, dst, lhs_rect, rhs_rect)) {
+            return;
+        }
+    } else if (op == op_and && rect_contains(rhs_rect, lhs.getBounds())) {
+        // Clipping against a rect that already covers the whole region
+        // is a no-op even when many spans are present.
+        if (&dst != &lhs) dst = lhs;
+        return;
+    }
+
+    // See the aliasing note in the Region flavor above.
+    if (&dst == &lhs) {
+        const Region aliased(lhs);
+        boolean_operation(op, dst, aliased, rhs, dx, dy);
+        return;
+    }
+
     region_operator<Rect>::region lhs_region(lhs_rects, lhs_count);
     region_operator<Rect>::region rhs_region(&rhs, 1, dx, dy);
     region_operator<Rect> operation(op, lhs_region, rhs_region);
@@ -880,8 +979,7 @@ status_t Region::unflatten(void const* buffer, size_t size) {
         ALOGE("Region::unflatten() failed, invalid region");
         return BAD_VALUE;
     }
-    mStorage.clear();
-    mStorage.insert(mStorage.begin(), result.mStorage.begin(), result.mStorage.end());
+    mStorage = result.mStorage;
     return NO_ERROR;
 }
 
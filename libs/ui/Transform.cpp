@@ -29,9 +29,12 @@ Transform::Transform() {
     reset();
 }
 
-Transform::Transform(const Transform&  other)
-    : mMatrix(other.mMatrix), mType(other.mType) {
-}
+Transform::Transform(const Transform& other)
+      : mMatrix(other.mMatrix),
+        mType(other.mType),
+        mInverseValid(other.mInverseValid),
+        mInverseMatrix(other.mInverseMatrix),
+        mInverseType(other.mInverseType) {}
 
 Transform::Transform(uint32_t orientation, int w, int h) {
     set(orientation, w, h);
@@ -67,10 +70,46 @@ Transform Transform::operator * (const Transform& rhs) const
     if (rhs.mType == IDENTITY)
         return r;
 
-    // TODO: we could use mType to optimize the matrix multiply
+    r.mInverseValid = false;
+
+    // Translate-only composition just sums the offsets; set() keeps the
+    // TRANSLATE bit exact so the result never needs reclassification.
+    if ((type() | rhs.type()) == TRANSLATE) {
+        r.mType = mType; // the copy may predate the type() resolution above
+        r.set(mMatrix[2][0] + rhs.mMatrix[2][0], mMatrix[2][1] + rhs.mMatrix[2][1]);
+        return r;
+    }
+
     const mat33& A(mMatrix);
     const mat33& B(rhs.mMatrix);
           mat33& D(r.mMatrix);
+
+    // When neither side rotates by 90 degrees or is skewed, both 2x2 blocks
+    // are diagonal and so is the product: four multiplies instead of the full
+    // 3x3 multiply below, and the exact type can be derived from the result.
+    if ((((type() | rhs.type()) >> 8) & (ROT_90 | ROT_INVALID)) == 0) {
+        D[0][0] = A[0][0] * B[0][0];
+        D[1][1] = A[1][1] * B[1][1];
+        D[2][0] = A[0][0] * B[2][0] + A[2][0];
+        D[2][1] = A[1][1] * B[2][1] + A[2][1];
+
+        uint32_t flags = ROT_0;
+        if (D[0][0] < 0) flags |= FLIP_H;
+        if (D[1][1] < 0) flags |= FLIP_V;
+        r.mType = flags << 8;
+        if ((flags & ROT_180) == ROT_180)
+            r.mType |= ROTATE;
+        if (flags & FLIP_H)
+            r.mType ^= SCALE;
+        if (flags & FLIP_V)
+            r.mType ^= SCALE;
+        if (!absIsOne(D[0][0]) || !absIsOne(D[1][1]))
+            r.mType |= SCALE;
+        if (!isZero(D[2][0]) || !isZero(D[2][1]))
+            r.mType |= TRANSLATE;
+        return r;
+    }
+
     for (size_t i = 0; i < 3; i++) {
         const float v0 = A[0][i];
         const float v1 = A[1][i];
@@ -90,6 +129,9 @@ Transform Transform::operator * (const Transform& rhs) const
 Transform& Transform::operator=(const Transform& other) {
     mMatrix = other.mMatrix;
     mType = other.mType;
+    mInverseValid = other.mInverseValid;
+    mInverseMatrix = other.mInverseMatrix;
+    mInverseType = other.mInverseType;
     return *this;
 }
 
@@ -115,6 +157,7 @@ float Transform::sy() const {
 
 void Transform::reset() {
     mType = IDENTITY;
+    mInverseValid = false;
     for(size_t i = 0; i < 3; i++) {
         vec3& v(mMatrix[i]);
         for (size_t j = 0; j < 3; j++)
@@ -124,6 +167,7 @@ void Transform::reset() {
 
 void Transform::set(float tx, float ty)
 {
+    mInverseValid = false;
     mMatrix[2][0] = tx;
     mMatrix[2][1] = ty;
     mMatrix[2][2] = 1.0f;
@@ -137,6 +181,7 @@ void Transform::set(float tx, float ty)
 
 void Transform::set(float a, float b, float c, float d)
 {
+    mInverseValid = false;
     mat33& M(mMatrix);
     M[0][0] = a;    M[1][0] = b;
     M[0][1] = c;    M[1][1] = d;
@@ -209,6 +254,37 @@ vec2 Transform::transform(int x, int y) const
     return transform(vec2(x,y));
 }
 
+void Transform::transform(vec2* points, size_t count) const {
+    const uint32_t t = type();
+    if (t == IDENTITY) {
+        return;
+    }
+
+    const mat33& M(mMatrix);
+    if (t == TRANSLATE) {
+        const float x = M[2][0];
+        const float y = M[2][1];
+        for (size_t i = 0; i < count; i++) {
+            points[i][0] += x;
+            points[i][1] += y;
+        }
+        return;
+    }
+
+    const float a = M[0][0];
+    const float b = M[1][0];
+    const float c = M[0][1];
+    const float d = M[1][1];
+    const float x = M[2][0];
+    const float y = M[2][1];
+    for (size_t i = 0; i < count; i++) {
+        const float px = points[i][0];
+        const float py = points[i][1];
+        points[i][0] = a*px + b*py + x;
+        points[i][1] = c*px + d*py + y;
+    }
+}
+
 Rect Transform::makeBounds(int w, int h) const
 {
     return transform( Rect(w, h) );
@@ -217,15 +293,17 @@ Rect Transform::makeBounds(int w, int h) const
 Rect Transform::transform(const Rect& bounds, bool roundOutwards) const
 {
     Rect r;
-    vec2 lt( bounds.left,  bounds.top    );
-    vec2 rt( bounds.right, bounds.top    );
-    vec2 lb( bounds.left,  bounds.bottom );
-    vec2 rb( bounds.right, bounds.bottom );
-
-    lt = transform(lt);
-    rt = transform(rt);
-    lb = transform(lb);
-    rb = transform(rb);
+    vec2 corners[4] = {
+            vec2(bounds.left,  bounds.top),
+            vec2(bounds.right, bounds.top),
+            vec2(bounds.left,  bounds.bottom),
+            vec2(bounds.right, bounds.bottom),
+    };
+    transform(corners, 4);
+    const vec2& lt(corners[0]);
+    const vec2& rt(corners[1]);
+    const vec2& lb(corners[2]);
+    const vec2& rb(corners[3]);
 
     if (roundOutwards) {
         r.left   = static_cast<int32_t>(floorf(std::min({lt[0], rt[0], lb[0], rb[0]})));
@@ -244,15 +322,17 @@ Rect Transform::transform(const Rect& bounds, bool roundOutwards) const
 
 FloatRect Transform::transform(const FloatRect& bounds) const
 {
-    vec2 lt(bounds.left, bounds.top);
-    vec2 rt(bounds.right, bounds.top);
-    vec2 lb(bounds.left, bounds.bottom);
-    vec2 rb(bounds.right, bounds.bottom);
-
-    lt = transform(lt);
-    rt = transform(rt);
-    lb = transform(lb);
-    rb = transform(rb);
+    vec2 corners[4] = {
+            vec2(bounds.left,  bounds.top),
+            vec2(bounds.right, bounds.top),
+            vec2(bounds.left,  bounds.bottom),
+            vec2(bounds.right, bounds.bottom),
+    };
+    transform(corners, 4);
+    const vec2& lt(corners[0]);
+    const vec2& rt(corners[1]);
+    const vec2& lb(corners[2]);
+    const vec2& rb(corners[3]);
 
     FloatRect r;
     r.left = std::min({lt[0], rt[0], lb[0], rb[0]});
@@ -350,28 +430,37 @@ Transform Transform::inverse() const {
         result.mMatrix[2][0] = -result.mMatrix[2][0];
         result.mMatrix[2][1] = -result.mMatrix[2][1];
     } else {
-        // a c 0
-        // b d 0
-        // x y 1
-        const mat33& M(mMatrix);
-        const float a = M[0][0];
-        const float b = M[1][0];
-        const float c = M[0][1];
-        const float d = M[1][1];
-        const float x = M[2][0];
-        const float y = M[2][1];
-
-        const float idet = 1.0f / (a*d - b*c);
-        result.mMatrix[0][0] =  d*idet;
-        result.mMatrix[0][1] = -c*idet;
-        result.mMatrix[1][0] = -b*idet;
-        result.mMatrix[1][1] =  a*idet;
-        result.mType = mType;
-
-        vec2 T(-x, -y);
-        T = result.transform(T);
-        result.mMatrix[2][0] = T[0];
-        result.mMatrix[2][1] = T[1];
+        if (!mInverseValid) {
+            // a c 0
+            // b d 0
+            // x y 1
+            const mat33& M(mMatrix);
+            const float a = M[0][0];
+            const float b = M[1][0];
+            const float c = M[0][1];
+            const float d = M[1][1];
+            const float x = M[2][0];
+            const float y = M[2][1];
+
+            const float idet = 1.0f / (a*d - b*c);
+            result.mMatrix[0][0] =  d*idet;
+            result.mMatrix[0][1] = -c*idet;
+            result.mMatrix[1][0] = -b*idet;
+            result.mMatrix[1][1] =  a*idet;
+            result.mType = mType;
+
+            vec2 T(-x, -y);
+            T = result.transform(T);
+            result.mMatrix[2][0] = T[0];
+            result.mMatrix[2][1] = T[1];
+
+            mInverseMatrix = result.mMatrix;
+            mInverseType = result.mType;
+            mInverseValid = true;
+        } else {
+            result.mMatrix = mInverseMatrix;
+            result.mType = mInverseType;
+        }
     }
     return result;
 }
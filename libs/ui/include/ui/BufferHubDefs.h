@@ -18,6 +18,7 @@
 #define ANDROID_BUFFER_HUB_DEFS_H_
 
 #include <atomic>
+#include <cstddef>
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wpacked"
@@ -122,6 +123,12 @@ static inline uint32_t findNextAvailableClientStateMask(uint32_t union_bits) {
     return newLowBit + (newLowBit << kMaxNumberOfClients);
 }
 
+// Cache line size the shared state words are padded out to. Producer and
+// consumer clients spin on these words from different cores, so each group of
+// words with a distinct writer gets its own cache line to avoid false sharing
+// with the per-frame metadata writes.
+static constexpr size_t kCacheLineSize = 64;
+
 struct __attribute__((aligned(8))) MetadataHeader {
     // Internal data format, which can be updated as long as the size, padding and field alignment
     // of the struct is consistent within the same ABI. As this part is subject for future updates,
@@ -129,28 +136,29 @@ struct __attribute__((aligned(8))) MetadataHeader {
     // platform (include Apps and vendor HAL).
 
     // Every client takes up one bit from the higher 32 bits and one bit from the lower 32 bits in
-    // bufferState.
-    std::atomic<uint32_t> bufferState;
+    // bufferState. This is the word all clients CAS on every state transition, so it lives alone
+    // on its own cache line.
+    alignas(kCacheLineSize) std::atomic<uint32_t> bufferState;
 
     // Every client takes up one bit in fenceState. Only the lower 32 bits are valid. The upper 32
-    // bits are there for easier manipulation, but the value should be ignored.
-    std::atomic<uint32_t> fenceState;
+    // bits are there for easier manipulation, but the value should be ignored. Updated off the
+    // per-frame path (async fence signaling and client lifetime changes), so it shares a line
+    // with activeClientsBitMask rather than with bufferState.
+    alignas(kCacheLineSize) std::atomic<uint32_t> fenceState;
 
     // Every client takes up one bit from the higher 32 bits and one bit from the lower 32 bits in
     // activeClientsBitMask.
     std::atomic<uint32_t> activeClientsBitMask;
 
-    // Explicit padding 4 bytes.
-    uint32_t padding;
-
-    // The index of the buffer queue where the buffer belongs to.
-    uint64_t queueIndex;
+    // The index of the buffer queue where the buffer belongs to. Written by the producer along
+    // with metadata below, on a separate line from the state words consumers poll.
+    alignas(kCacheLineSize) uint64_t queueIndex;
 
     // Public data format, which should be updated with caution. See more details in dvr_api.h
     DvrNativeBufferMetadata metadata;
 };
 
-static_assert(sizeof(MetadataHeader) == 128, "Unexpected MetadataHeader size");
+static_assert(sizeof(MetadataHeader) == 256, "Unexpected MetadataHeader size");
 static constexpr size_t kMetadataHeaderSize = sizeof(MetadataHeader);
 
 /**
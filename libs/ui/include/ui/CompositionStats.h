@@ -0,0 +1,57 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_UI_COMPOSITION_STATS_H
+#define ANDROID_UI_COMPOSITION_STATS_H
+
+#include <stdint.h>
+
+#include <utils/Timers.h>
+
+namespace android {
+
+// Snapshot of SurfaceFlinger's per-stage composition timing, accumulated
+// since boot. The stats are recorded unconditionally on the main thread with
+// relaxed atomics, so reading them does not perturb composition the way
+// tracing does.
+struct CompositionStats {
+    enum Stage : uint32_t {
+        // Latching queued buffers and processing pending transactions.
+        STAGE_LATCH = 0,
+        // Building the refresh arguments for the composition engine.
+        STAGE_PREPARE = 1,
+        // Composition engine present: GPU (client) composition and the HWC
+        // validate/present round trips.
+        STAGE_COMPOSITE = 2,
+        // Post-composition bookkeeping: fences, timestamps and callbacks.
+        STAGE_PRESENT = 3,
+        NUM_STAGES = 4,
+    };
+
+    // Bucket b counts stage durations in [2^b, 2^(b+1)) microseconds;
+    // the first and last buckets also absorb anything below or above the
+    // covered range (2^23 us is about 8.4 s).
+    static constexpr size_t NUM_BUCKETS = 24;
+
+    uint64_t count[NUM_STAGES]{};
+    nsecs_t totalNs[NUM_STAGES]{};
+    nsecs_t maxNs[NUM_STAGES]{};
+    uint64_t histogram[NUM_STAGES][NUM_BUCKETS]{};
+};
+
+} // namespace android
+
+#endif // ANDROID_UI_COMPOSITION_STATS_H
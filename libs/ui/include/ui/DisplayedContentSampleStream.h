@@ -0,0 +1,121 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include <ui/DisplayedFrameStats.h>
+
+namespace android {
+
+/* Fixed layout of the shared memory region returned by
+ * ISurfaceComposer::getDisplayedContentSampleStream. SurfaceFlinger (the single writer)
+ * republishes the HWC color histograms into the region after every composited frame;
+ * clients map the region read-only and poll it with read(), without binder traffic or
+ * per-call vector allocations.
+ *
+ * The region is protected by a seqlock: `sequence` is odd while a publish is in
+ * progress and incremented to the next even value when it completes. A reader retries
+ * until it observes the same even sequence on both sides of its copy.
+ */
+struct DisplayedContentSampleStream {
+    /* Histograms are truncated to this many buckets; current HWC implementations report
+     * far fewer (typically 64). */
+    static constexpr uint32_t MAX_BINS = 256;
+
+    std::atomic<uint32_t> sequence{0};
+    /* Number of valid buckets in each component histogram. */
+    uint32_t binCount[4]{};
+    /* The number of frames represented by the histograms. */
+    uint64_t numFrames{0};
+    /* CLOCK_MONOTONIC time of the last publish, for staleness checks. */
+    int64_t lastUpdateTime{0};
+    uint64_t component0[MAX_BINS]{};
+    uint64_t component1[MAX_BINS]{};
+    uint64_t component2[MAX_BINS]{};
+    uint64_t component3[MAX_BINS]{};
+
+    /* Writer side. Must only be called from a single thread. */
+    void publish(const DisplayedFrameStats& stats, int64_t updateTime) {
+        const uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        numFrames = stats.numFrames;
+        lastUpdateTime = updateTime;
+        copyComponent(stats.component_0_sample, component0, &binCount[0]);
+        copyComponent(stats.component_1_sample, component1, &binCount[1]);
+        copyComponent(stats.component_2_sample, component2, &binCount[2]);
+        copyComponent(stats.component_3_sample, component3, &binCount[3]);
+
+        std::atomic_thread_fence(std::memory_order_release);
+        sequence.store(seq + 2, std::memory_order_relaxed);
+    }
+
+    /* Reader side. Returns false if no sample has been published yet or a consistent
+     * snapshot could not be obtained (the writer kept racing with us), in which case
+     * the out parameters are left untouched. outUpdateTime may be nullptr. */
+    bool read(DisplayedFrameStats* outStats, int64_t* outUpdateTime = nullptr) const {
+        constexpr int kMaxAttempts = 16;
+        for (int attempt = 0; attempt < kMaxAttempts; attempt++) {
+            const uint32_t seqBegin = sequence.load(std::memory_order_acquire);
+            if (seqBegin == 0) {
+                return false; // nothing published yet
+            }
+            if (seqBegin & 1) {
+                continue; // publish in progress
+            }
+
+            DisplayedFrameStats stats;
+            stats.numFrames = numFrames;
+            const int64_t updateTime = lastUpdateTime;
+            readComponent(component0, binCount[0], &stats.component_0_sample);
+            readComponent(component1, binCount[1], &stats.component_1_sample);
+            readComponent(component2, binCount[2], &stats.component_2_sample);
+            readComponent(component3, binCount[3], &stats.component_3_sample);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == seqBegin) {
+                *outStats = std::move(stats);
+                if (outUpdateTime) {
+                    *outUpdateTime = updateTime;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static void copyComponent(const std::vector<uint64_t>& in, uint64_t* out, uint32_t* outCount) {
+        const uint32_t count = std::min<uint32_t>(static_cast<uint32_t>(in.size()), MAX_BINS);
+        *outCount = count;
+        std::memcpy(out, in.data(), count * sizeof(uint64_t));
+    }
+
+    static void readComponent(const uint64_t* in, uint32_t count, std::vector<uint64_t>* out) {
+        // The count may be torn if the writer is racing; clamp before allocating. The
+        // final sequence check rejects the torn copy.
+        count = std::min(count, MAX_BINS);
+        out->assign(in, in + count);
+    }
+};
+
+} // namespace android
@@ -18,14 +18,34 @@
 #define ANDROID_REGION_FAT_VECTOR_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <utils/Log.h>
 #include <type_traits>
 
+#include <atomic>
+#include <initializer_list>
+#include <utility>
 #include <vector>
 
+// Set to 1 (or build with -DFAT_VECTOR_TRACK_HEAP_SPILLS=1) to count how often
+// a FatVector outgrows its inline storage and falls back to the heap. Useful
+// together with fatVectorHeapSpillCount() to verify that steady-state frames
+// perform no transient allocations.
+#ifndef FAT_VECTOR_TRACK_HEAP_SPILLS
+#define FAT_VECTOR_TRACK_HEAP_SPILLS 0
+#endif
+
 namespace android {
 
+#if FAT_VECTOR_TRACK_HEAP_SPILLS
+// Process-wide count of FatVector allocations that spilled to the heap.
+inline std::atomic<uint64_t>& fatVectorHeapSpillCount() {
+    static std::atomic<uint64_t> count{0};
+    return count;
+}
+#endif
+
 template <typename T, size_t SIZE = 4>
 class InlineStdAllocator {
 public:
@@ -53,6 +73,9 @@ public:
             mAllocation.inUse = true;
             return static_cast<T*>(static_cast<void*>(mAllocation.array));
         } else {
+#if FAT_VECTOR_TRACK_HEAP_SPILLS
+            fatVectorHeapSpillCount().fetch_add(1, std::memory_order_relaxed);
+#endif
             return static_cast<T*>(static_cast<void*>(malloc(num * sizeof(T))));
         }
     }
@@ -65,6 +88,16 @@ public:
             free(p);
         }
     }
+
+    // Two allocators only compare equal when they share the same inline
+    // storage. Containers rely on this to fall back to element-wise moves
+    // between distinct FatVectors instead of stealing a pointer into the
+    // source's inline buffer.
+    bool operator==(const InlineStdAllocator& other) const {
+        return &mAllocation == &other.mAllocation;
+    }
+    bool operator!=(const InlineStdAllocator& other) const { return !(*this == other); }
+
     Allocation& mAllocation;
 };
 
@@ -84,6 +117,40 @@ public:
 
     explicit FatVector(size_t capacity) : FatVector() { this->resize(capacity); }
 
+    FatVector(std::initializer_list<T> init) : FatVector() { this->assign(init); }
+
+    // The allocator holds a reference to this vector's inline storage, so the
+    // implicit copy and move operations cannot be used: a stolen buffer could
+    // point into the source's inline array. Copies and moves are element-wise
+    // into this vector's own storage; the base vector already does this when
+    // the allocators compare unequal, which is always the case for two
+    // distinct FatVectors.
+    FatVector(const FatVector& other) : FatVector() { *this = other; }
+
+    FatVector(FatVector&& other) : FatVector() { *this = std::move(other); }
+
+    FatVector& operator=(const FatVector& other) {
+        if (this != &other) {
+            this->assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    FatVector& operator=(FatVector&& other) {
+        if (this != &other) {
+            std::vector<T, InlineStdAllocator<T, SIZE>>::operator=(std::move(other));
+            // An element-wise move leaves the source's size unchanged; clear
+            // it to match the emptied-source behavior of a stolen-buffer move.
+            other.clear();
+        }
+        return *this;
+    }
+
+    FatVector& operator=(std::initializer_list<T> init) {
+        this->assign(init);
+        return *this;
+    }
+
 private:
     typename InlineStdAllocator<T, SIZE>::Allocation mAllocation;
 };
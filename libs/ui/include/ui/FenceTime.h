@@ -20,21 +20,25 @@
 #include <ui/Fence.h>
 #include <utils/Flattenable.h>
 #include <utils/Mutex.h>
+#include <utils/Singleton.h>
 #include <utils/Timers.h>
 
 #include <atomic>
 #include <mutex>
 #include <queue>
+#include <thread>
 #include <unordered_map>
 
 namespace android {
 
+class FenceTimeWatcher;
 class FenceToFenceTimeMap;
 
 // A wrapper around fence that only implements isValid and getSignalTime.
 // It automatically closes the fence in a thread-safe manner once the signal
 // time is known.
 class FenceTime {
+friend class FenceTimeWatcher;
 friend class FenceToFenceTimeMap;
 public:
     // An atomic snapshot of the FenceTime that is flattenable.
@@ -119,6 +123,11 @@ private:
     // never return SIGNAL_TIME_INVALID and isValid will always return true.
     FenceTime(const sp<Fence>& fence, bool forceValidForTest);
 
+    // Returns a dup of the underlying fence's fd, or -1 if the signal time
+    // is already known. Used by FenceTimeWatcher to wait for the fence
+    // without extending its lifetime.
+    int dupPendingFenceFd();
+
     enum class State {
         VALID,
         INVALID,
@@ -163,6 +172,40 @@ private:
     std::queue<std::weak_ptr<FenceTime>> mQueue GUARDED_BY(mMutex);
 };
 
+// Resolves fence signal times without blocking a thread per fence.
+//
+// Watched fences have a dup of their sync fd registered with a single
+// process-wide epoll thread; when the fd signals, the signal time is queried
+// once and cached into the FenceTime, so later calls to getSignalTime() and
+// FenceTimeline::updateSignalTimes() are satisfied by the cached atomic
+// instead of a syscall. Only a weak reference to the FenceTime is kept; a
+// fence whose FenceTime has been dropped is cleaned up when it signals.
+//
+// The watcher can be disabled with debug.ui.fence_watcher, in which case
+// watch() is a no-op and callers fall back to resolving signal times
+// themselves, exactly as before.
+class FenceTimeWatcher : public Singleton<FenceTimeWatcher> {
+public:
+    FenceTimeWatcher();
+    ~FenceTimeWatcher();
+
+    // Registers a FenceTime whose signal time should be cached as soon as
+    // the underlying fence signals. Safe to call from any thread.
+    void watch(const std::shared_ptr<FenceTime>& fenceTime);
+
+private:
+    friend class Singleton<FenceTimeWatcher>;
+
+    void threadMain();
+
+    int mEpollFd = -1;
+    int mStopFd = -1;
+    mutable std::mutex mMutex;
+    // Pending fences, keyed by the dup'd fd registered with epoll.
+    std::unordered_map<int, std::weak_ptr<FenceTime>> mWatched GUARDED_BY(mMutex);
+    std::thread mThread;
+};
+
 // Used by test code to create or get FenceTimes for a given Fence.
 //
 // By design, Fences cannot be signaled from user space. However, this class
@@ -52,6 +52,12 @@ public:
     */
     Vector<nsecs_t> frameReadyTimesNano;
 
+   /*
+    * The times in nanoseconds for when the GPU finished compositing the frame. Zero for frames
+    * that did not involve GPU composition, INT64_MAX while the completion fence is pending.
+    */
+    Vector<nsecs_t> gpuCompositionDoneTimesNano;
+
     // LightFlattenable
     bool isFixedSize() const;
     size_t getFlattenedSize() const;
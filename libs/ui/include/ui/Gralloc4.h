@@ -26,7 +26,9 @@
 #include <ui/Rect.h>
 #include <utils/StrongPointer.h>
 
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 namespace android {
 
@@ -182,6 +184,15 @@ private:
             std::ostringstream* outDump, uint64_t* outAllocationSize, bool less) const;
 
     sp<hardware::graphics::mapper::V4_0::IMapper> mMapper;
+
+    // A buffer's plane layouts are fixed at allocation time, but the generic
+    // get() path above does a full IMapper round trip (including a hidl_vec
+    // allocation and decode) per query, and both lock() variants query them on
+    // every call.  Cache the decoded layouts per imported handle so repeated
+    // lock/lockYCbCr calls on the same buffer hit the HAL only once; entries
+    // are dropped in freeBuffer(), after which the handle value may be reused.
+    mutable std::mutex mPlaneLayoutCacheMutex;
+    mutable std::unordered_map<buffer_handle_t, std::vector<ui::PlaneLayout>> mPlaneLayoutCache;
 };
 
 class Gralloc4Allocator : public GrallocAllocator {
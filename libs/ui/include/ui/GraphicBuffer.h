@@ -94,6 +94,13 @@ public:
             uint32_t inLayerCount, uint64_t inUsage,
             std::string requestorName = "<Unknown>");
 
+    // Create a GraphicBuffer that takes ownership of a handle allocated and imported
+    // by GraphicBufferAllocator::allocateBatch.  The handle is returned to the
+    // allocator when the buffer is destroyed.
+    GraphicBuffer(uint32_t inWidth, uint32_t inHeight, PixelFormat inFormat,
+            uint32_t inLayerCount, uint64_t inUsage, uint32_t inStride,
+            buffer_handle_t inHandle);
+
     // Create a GraphicBuffer from an existing handle.
     enum HandleWrapMethod : uint8_t {
         // Wrap and use the handle directly.  It assumes the handle has been
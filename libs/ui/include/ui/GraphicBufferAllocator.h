@@ -20,8 +20,11 @@
 
 #include <stdint.h>
 
+#include <list>
+#include <map>
 #include <memory>
 #include <string>
+#include <tuple>
 
 #include <cutils/native_handle.h>
 
@@ -31,6 +34,7 @@
 #include <utils/KeyedVector.h>
 #include <utils/Mutex.h>
 #include <utils/Singleton.h>
+#include <utils/Timers.h>
 
 namespace android {
 
@@ -51,6 +55,16 @@ public:
                       uint64_t usage, buffer_handle_t* handle, uint32_t* stride,
                       std::string requestorName);
 
+    /**
+     * Allocates and imports `count` buffers with identical parameters using a single
+     * allocator HAL call, for callers that set up several buffers at once (buffer queue
+     * preallocation, swapchains). On success outHandles[0..count-1] are valid, share
+     * *outStride, and must each be freed with GraphicBufferAllocator::free().
+     */
+    status_t allocateBatch(uint32_t w, uint32_t h, PixelFormat format, uint32_t layerCount,
+                           uint64_t usage, uint32_t count, buffer_handle_t* outHandles,
+                           uint32_t* outStride, std::string requestorName);
+
     /**
      * Allocates and does NOT import a gralloc buffer. Buffers cannot be used until they have
      * been imported. This function is for advanced use cases only.
@@ -102,6 +116,30 @@ protected:
 
     GraphicBufferMapper& mMapper;
     std::unique_ptr<const GrallocAllocator> mAllocator;
+
+private:
+    // Freed buffers are kept imported on a free-list keyed by their
+    // allocation parameters so an identical allocation shortly after (app
+    // launch, rotation) reuses the warm gralloc handle instead of a HAL
+    // round trip. Disabled unless debug.ui.graphic_buffer_pool_kb is set.
+    using PoolKey = std::tuple<uint32_t /*width*/, uint32_t /*height*/, PixelFormat,
+                               uint32_t /*layerCount*/, uint64_t /*usage*/>;
+    struct PooledBuffer {
+        buffer_handle_t handle;
+        uint32_t stride;
+        size_t size;
+        nsecs_t freeTime;
+    };
+
+    bool takeFromPoolLocked(uint32_t width, uint32_t height, PixelFormat format,
+                            uint32_t layerCount, uint64_t usage, buffer_handle_t* handle,
+                            uint32_t* stride, const std::string& requestorName);
+    bool returnToPoolLocked(buffer_handle_t handle);
+    void expirePoolEntriesLocked(nsecs_t now);
+
+    const size_t mPoolBudgetBytes;
+    size_t mPoolBytes = 0;
+    std::map<PoolKey, std::list<PooledBuffer>> mPool;
 };
 
 // ---------------------------------------------------------------------------
@@ -90,6 +90,10 @@ public:
     // assumes the last row is < 0 , 0 , 1 >
     vec2 transform(const vec2& v) const;
     vec3 transform(const vec3& v) const;
+    // Transforms a span of points in place. Equivalent to applying
+    // transform(vec2) to each point, but classifies the transform once and
+    // skips the 2x2 math for identity and translate-only transforms.
+    void transform(vec2* points, size_t count) const;
 
     // Expands from the internal 3x3 matrix to an equivalent 4x4 matrix
     mat4 asMatrix4() const;
@@ -117,6 +121,16 @@ private:
 
     mat33               mMatrix;
     mutable uint32_t    mType;
+
+    // Cached result of inverse() for transforms with a 2x2 component, so
+    // repeated inversions of a stable transform (common in per-frame layer
+    // geometry) do not redo the determinant math. Like mType, this is
+    // resolved lazily from a const method; callers are expected to
+    // synchronize access to a shared Transform as they already must for
+    // type().
+    mutable bool        mInverseValid = false;
+    mutable mat33       mInverseMatrix;
+    mutable uint32_t    mInverseType = 0;
 };
 
 inline void PrintTo(const Transform& t, ::std::ostream* os) {
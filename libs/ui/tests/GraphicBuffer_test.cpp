@@ -18,6 +18,10 @@
 
 #include <ui/GraphicBuffer.h>
 
+#include <unistd.h>
+
+#include <vector>
+
 #include <gtest/gtest.h>
 
 namespace android {
@@ -66,4 +70,45 @@ TEST_F(GraphicBufferTest, AllocateBadDimensions) {
     ASSERT_EQ(BAD_VALUE, gb2->initCheck());
 }
 
+TEST_F(GraphicBufferTest, UnflattenReusesImportForSameBuffer) {
+    sp<GraphicBuffer> gb(new GraphicBuffer(kTestWidth, kTestHeight, PIXEL_FORMAT_RGBA_8888,
+                                           kTestLayerCount, kTestUsage, std::string("test")));
+    ASSERT_EQ(NO_ERROR, gb->initCheck());
+
+    const size_t flattenedSize = gb->getFlattenedSize();
+    const size_t fdCount = gb->getFdCount();
+    std::vector<uint8_t> flattened(flattenedSize);
+    std::vector<int> fds(fdCount);
+    {
+        void* buffer = flattened.data();
+        size_t size = flattenedSize;
+        int* fdData = fds.data();
+        size_t count = fdCount;
+        ASSERT_EQ(NO_ERROR, gb->flatten(buffer, size, fdData, count));
+    }
+
+    // unflatten() consumes its fds, so hand it duplicates the way Parcel
+    // would on a real receive.
+    auto unflattenCopy = [&](const sp<GraphicBuffer>& out) {
+        std::vector<int> dupedFds(fdCount);
+        for (size_t i = 0; i < fdCount; i++) {
+            dupedFds[i] = dup(fds[i]);
+        }
+        void const* buffer = flattened.data();
+        size_t size = flattenedSize;
+        int const* fdData = dupedFds.data();
+        size_t count = fdCount;
+        ASSERT_EQ(NO_ERROR, out->unflatten(buffer, size, fdData, count));
+    };
+
+    sp<GraphicBuffer> imported1(new GraphicBuffer());
+    sp<GraphicBuffer> imported2(new GraphicBuffer());
+    ASSERT_NO_FATAL_FAILURE(unflattenCopy(imported1));
+    ASSERT_NO_FATAL_FAILURE(unflattenCopy(imported2));
+
+    EXPECT_EQ(gb->getId(), imported1->getId());
+    // Both arrivals resolve to the one per-process import of this buffer.
+    EXPECT_EQ(imported1->handle, imported2->handle);
+}
+
 } // namespace android
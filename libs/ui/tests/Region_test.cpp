@@ -152,6 +152,80 @@ TEST_F(RegionTest, Random_TJunction) {
     }
 }
 
+TEST_F(RegionTest, SingleRectOperations) {
+    Region r(Rect(0, 0, 100, 100));
+
+    // Intersection with an overlapping rect.
+    Region intersected(r);
+    intersected.andSelf(Rect(50, 50, 200, 200));
+    EXPECT_TRUE(intersected.isRect());
+    EXPECT_EQ(Rect(50, 50, 100, 100), intersected.getBounds());
+
+    // Intersection with a disjoint rect is empty.
+    Region disjoint(r);
+    disjoint.andSelf(Rect(200, 200, 300, 300));
+    EXPECT_TRUE(disjoint.isEmpty());
+
+    // Clipping against a covering rect leaves the region untouched.
+    Region clipped(r);
+    clipped.andSelf(Rect(-10, -10, 110, 110));
+    EXPECT_TRUE(clipped.hasSameRects(r));
+
+    // Union with a contained rect is a no-op; union with a containing
+    // rect adopts it.
+    Region unioned(r);
+    unioned.orSelf(Rect(10, 10, 20, 20));
+    EXPECT_TRUE(unioned.hasSameRects(r));
+    unioned.orSelf(Rect(-10, -10, 110, 110));
+    EXPECT_TRUE(unioned.isRect());
+    EXPECT_EQ(Rect(-10, -10, 110, 110), unioned.getBounds());
+
+    // Subtracting a disjoint rect is a no-op; subtracting a covering
+    // rect empties the region.
+    Region subtracted(r);
+    subtracted.subtractSelf(Rect(200, 200, 300, 300));
+    EXPECT_TRUE(subtracted.hasSameRects(r));
+    subtracted.subtractSelf(Rect(0, 0, 100, 100));
+    EXPECT_TRUE(subtracted.isEmpty());
+
+    // Shapes that need span merging still go through the rasterizer.
+    Region merged(r);
+    merged.orSelf(Rect(0, 100, 50, 200));
+    EXPECT_FALSE(merged.isRect());
+    EXPECT_EQ(Rect(0, 0, 100, 200), merged.getBounds());
+}
+
+TEST_F(RegionTest, InPlaceOperationsOnMultiRectRegions) {
+    // In-place operators pass the destination as an operand; these shapes
+    // force the rasterizer path, where the aliased storage must be copied.
+    Region r;
+    r.orSelf(Rect(0, 0, 100, 100));
+    r.orSelf(Rect(0, 100, 50, 200));
+    ASSERT_FALSE(r.isRect());
+
+    Region clipped(r);
+    clipped.andSelf(Rect(25, 50, 75, 150));
+    EXPECT_FALSE(clipped.isRect());
+    EXPECT_EQ(Rect(25, 50, 75, 150), clipped.getBounds());
+    EXPECT_TRUE(clipped.contains(30, 60));
+    EXPECT_TRUE(clipped.contains(30, 140));
+    EXPECT_FALSE(clipped.contains(80, 60));
+
+    Region subtracted(r);
+    subtracted.subtractSelf(Rect(0, 50, 100, 150));
+    EXPECT_TRUE(subtracted.contains(50, 25));
+    EXPECT_TRUE(subtracted.contains(25, 175));
+    EXPECT_FALSE(subtracted.contains(50, 100));
+
+    // A region combined with itself stays unchanged (or empties for xor).
+    Region selfOr(r);
+    selfOr.orSelf(selfOr);
+    EXPECT_TRUE(selfOr.hasSameRects(r));
+    Region selfXor(r);
+    selfXor.xorSelf(selfXor);
+    EXPECT_TRUE(selfXor.isEmpty());
+}
+
 TEST_F(RegionTest, EqualsToSelf) {
     Region touchableRegion;
     touchableRegion.orSelf(Rect(0, 0, 100, 100));
@@ -180,4 +180,34 @@ TEST_F(ColorSpaceTest, LUT) {
 
 }
 
+TEST_F(ColorSpaceTest, TransferLUT) {
+    auto lut = ColorSpace::createTransferLUT(ColorSpace::sRGB().getEOTF(), 1024);
+    EXPECT_EQ(1024u, lut.size());
+    EXPECT_NEAR(0.0f, lut.front(), 1e-6f);
+    EXPECT_NEAR(1.0f, lut.back(), 1e-6f);
+}
+
+TEST_F(ColorSpaceTest, ConnectBatch) {
+    ColorSpaceConnector connector(ColorSpace::sRGB(), ColorSpace::AdobeRGB());
+
+    float3 batch[] = {
+        {1.0f, 0.5f, 0.0f},
+        {0.0f, 0.0f, 0.0f},
+        {1.0f, 1.0f, 1.0f},
+        {0.25f, 0.5f, 0.75f},
+    };
+    const size_t count = sizeof(batch) / sizeof(batch[0]);
+
+    float3 expected[count];
+    for (size_t i = 0; i < count; i++) {
+        expected[i] = connector.transform(batch[i]);
+    }
+
+    connector.transform(batch, count);
+
+    for (size_t i = 0; i < count; i++) {
+        EXPECT_TRUE(all(lessThan(abs(batch[i] - expected[i]), float3{1e-3f})));
+    }
+}
+
 }; // namespace android
@@ -184,12 +184,12 @@ int BufferHubBase::UpdateSharedFence(const LocalHandle& new_fence,
       }
       // Set bit in fence state to indicate that there is a fence from this
       // producer or consumer.
-      fence_state_->fetch_or(client_state_mask());
+      fence_state_->fetch_or(client_state_mask(), std::memory_order_release);
     } else {
       // Unset bit in fence state to indicate that there is no fence, so that
       // when consumer to acquire or producer to acquire, it knows no need to
       // check fence for this buffer.
-      fence_state_->fetch_and(~client_state_mask());
+      fence_state_->fetch_and(~client_state_mask(), std::memory_order_release);
     }
   }
 
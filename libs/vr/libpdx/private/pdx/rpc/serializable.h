@@ -4,6 +4,7 @@
 #include <cstddef>
 #include <string>
 #include <tuple>
+#include <type_traits>
 
 #include <pdx/message_reader.h>
 #include <pdx/message_writer.h>
@@ -35,6 +36,9 @@ struct MemberPointer<Type Class::*, Pointer> {
   // Type of the member pointer this type represents.
   using PointerType = Type Class::*;
 
+  // Type of the member this pointer resolves to.
+  using MemberType = Type;
+
   // Resolves a pointer to member with the given instance, yielding a
   // reference to the member in that instance.
   static Type& Resolve(Class& instance) { return (instance.*Pointer); }
@@ -61,6 +65,25 @@ struct SerializableMembersType {
   using At = typename std::tuple_element<Index, Members>::type;
 };
 
+// Sums the sizes of the members described by a list of MemberPointer types.
+template <typename... MemberPointers>
+struct MemberSizeSum : std::integral_constant<std::size_t, 0> {};
+
+template <typename First, typename... Rest>
+struct MemberSizeSum<First, Rest...>
+    : std::integral_constant<std::size_t,
+                             sizeof(typename First::MemberType) +
+                                 MemberSizeSum<Rest...>::value> {};
+
+// Computes the combined size of the members of a SerializableMembersType
+// instantiation.
+template <typename MembersType>
+struct SerializableMembersSize;
+
+template <typename T, typename... MemberPointers>
+struct SerializableMembersSize<SerializableMembersType<T, MemberPointers...>>
+    : MemberSizeSum<MemberPointers...> {};
+
 // Classes must do the following to correctly define a serializable type:
 //     1. Define a type called "SerializableMembers" as a template instantiation
 //        of SerializableMembersType, describing the members of the class to
@@ -92,21 +115,61 @@ class SerializableTraits {
  public:
   // Gets the serialized size of type T.
   static std::size_t GetSerializedSize(const T& value) {
-    return GetEncodingSize(EncodeArrayType(SerializableMembers::MemberCount)) +
-           GetMembersSize<SerializableMembers>(value);
+    return GetSerializedSizeImpl(value, FlatTag{});
   }
 
   // Serializes type T.
   static void SerializeObject(const T& value, MessageWriter* writer,
                               void*& buffer) {
-    SerializeArrayEncoding(EncodeArrayType(SerializableMembers::MemberCount),
-                           SerializableMembers::MemberCount, buffer);
-    SerializeMembers<SerializableMembers>(value, writer, buffer);
+    SerializeObjectImpl(value, writer, buffer, FlatTag{});
   }
 
   // Deserializes type T.
   static ErrorType DeserializeObject(T* value, MessageReader* reader,
                                      const void*& start, const void* end) {
+    return DeserializeObjectImpl(value, reader, start, end, FlatTag{});
+  }
+
+ private:
+  using SerializableMembers = typename T::SerializableMembers;
+
+  // A type takes the flat fast path when it is trivially copyable and its
+  // serializable members cover every byte of the object: no padding, unlisted
+  // members or other hidden state can leak through the memcpy, and both
+  // endpoints agree on the layout at compile time since they instantiate the
+  // same trait. Such types encode as a single BIN blob instead of per-member
+  // encodings, which is substantially cheaper for high-rate payloads like
+  // pose and buffer metadata.
+  enum : bool {
+    IsFlat = std::is_trivially_copyable<T>::value &&
+        SerializableMembersSize<SerializableMembers>::value == sizeof(T)
+  };
+  using FlatTag = std::integral_constant<bool, IsFlat>;
+
+  static std::size_t GetSerializedSizeImpl(const T& value, std::false_type) {
+    return GetEncodingSize(EncodeArrayType(SerializableMembers::MemberCount)) +
+           GetMembersSize<SerializableMembers>(value);
+  }
+  static std::size_t GetSerializedSizeImpl(const T& /*value*/,
+                                           std::true_type) {
+    return GetEncodingSize(EncodeBinType(sizeof(T))) + sizeof(T);
+  }
+
+  static void SerializeObjectImpl(const T& value, MessageWriter* writer,
+                                  void*& buffer, std::false_type) {
+    SerializeArrayEncoding(EncodeArrayType(SerializableMembers::MemberCount),
+                           SerializableMembers::MemberCount, buffer);
+    SerializeMembers<SerializableMembers>(value, writer, buffer);
+  }
+  static void SerializeObjectImpl(const T& value, MessageWriter* /*writer*/,
+                                  void*& buffer, std::true_type) {
+    SerializeBinEncoding(EncodeBinType(sizeof(T)), sizeof(T), buffer);
+    WriteRawData(buffer, &value, sizeof(T));
+  }
+
+  static ErrorType DeserializeObjectImpl(T* value, MessageReader* reader,
+                                         const void*& start, const void* end,
+                                         std::false_type) {
     EncodingType encoding;
     std::size_t size;
 
@@ -119,9 +182,21 @@ class SerializableTraits {
       return DeserializeMembers<SerializableMembers>(value, reader, start, end);
     }
   }
+  static ErrorType DeserializeObjectImpl(T* value, MessageReader* reader,
+                                         const void*& start, const void* end,
+                                         std::true_type) {
+    EncodingType encoding;
+    std::size_t size;
 
- private:
-  using SerializableMembers = typename T::SerializableMembers;
+    if (const auto error =
+            DeserializeBinType(&encoding, &size, reader, start, end)) {
+      return error;
+    } else if (size != sizeof(T)) {
+      return ErrorCode::UNEXPECTED_TYPE_SIZE;
+    } else {
+      return ReadRawData(value, reader, start, end, sizeof(T));
+    }
+  }
 };
 
 // Utility macro to define a MemberPointer type for a member name.
@@ -65,6 +65,23 @@ struct TestType {
   PDX_SERIALIZABLE_MEMBERS(TestType, a, b, c, d);
 };
 
+// Trivially-copyable type whose members cover the whole object; this takes
+// the flat BIN fast path instead of per-member encoding.
+struct TestFlatType {
+  int a;
+  float b;
+
+  TestFlatType() : a(0), b(0.0f) {}
+  TestFlatType(int a, float b) : a(a), b(b) {}
+
+  bool operator==(const TestFlatType& other) const {
+    return a == other.a && b == other.b;
+  }
+
+ private:
+  PDX_SERIALIZABLE_MEMBERS(TestFlatType, a, b);
+};
+
 template <typename FileHandleType>
 struct TestTemplateType {
   FileHandleType fd;
@@ -1233,6 +1250,22 @@ TEST(SerializationTest, Serializable) {
   EXPECT_EQ(expected, result);
 }
 
+TEST(SerializationTest, SerializableFlat) {
+  Payload result;
+  Payload expected;
+
+  TestFlatType t1{10, 1.0f};
+  Serialize(t1, &result);
+
+  // Flat types encode as a BIN blob of the raw object bytes.
+  const auto bytes = reinterpret_cast<const std::uint8_t*>(&t1);
+  expected = decltype(expected)(
+      {ENCODING_TYPE_BIN8, static_cast<std::uint8_t>(sizeof(TestFlatType))});
+  for (std::size_t i = 0; i < sizeof(TestFlatType); i++)
+    expected.Append(1, bytes[i]);
+  EXPECT_EQ(expected, result);
+}
+
 TEST(SerializationTest, Variant) {
   Payload result;
   Payload expected;
@@ -2365,6 +2398,29 @@ TEST(DeserializationTest, Serializable) {
   EXPECT_EQ(TestTemplateType<LocalHandle>(LocalHandle(-1)), tt);
 }
 
+TEST(DeserializationTest, SerializableFlat) {
+  Payload buffer;
+  ErrorType error;
+
+  TestFlatType expected{10, 1.0f};
+  const auto bytes = reinterpret_cast<const std::uint8_t*>(&expected);
+  buffer = decltype(buffer)(
+      {ENCODING_TYPE_BIN8, static_cast<std::uint8_t>(sizeof(TestFlatType))});
+  for (std::size_t i = 0; i < sizeof(TestFlatType); i++)
+    buffer.Append(1, bytes[i]);
+
+  TestFlatType t1;
+  error = Deserialize(&t1, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(expected, t1);
+
+  // A blob whose size does not match the type is rejected instead of being
+  // partially copied.
+  buffer = decltype(buffer)({ENCODING_TYPE_BIN8, 4, 0, 0, 0, 0});
+  error = Deserialize(&t1, &buffer);
+  EXPECT_EQ(ErrorCode::UNEXPECTED_TYPE_SIZE, error);
+}
+
 TEST(DeserializationTest, Variant) {
   Payload buffer;
   ErrorType error;
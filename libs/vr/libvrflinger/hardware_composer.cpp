@@ -134,6 +134,13 @@ HardwareComposer::~HardwareComposer(void) {
   UpdatePostThreadState(PostThreadState::Quit, true);
   if (post_thread_.joinable())
     post_thread_.join();
+  {
+    std::lock_guard<std::mutex> lock(present_mutex_);
+    present_quit_ = true;
+  }
+  present_wait_.notify_all();
+  if (present_thread_.joinable())
+    present_thread_.join();
   composer_callback_->SetVsyncService(nullptr);
 }
 
@@ -181,6 +188,7 @@ bool HardwareComposer::Initialize(
   UpdateEdidData(composer, primary_display_id);
 
   post_thread_ = std::thread(&HardwareComposer::PostThread, this);
+  present_thread_ = std::thread(&HardwareComposer::PresentThread, this);
 
   initialized_ = true;
 
@@ -263,6 +271,9 @@ void HardwareComposer::OnPostThreadResumed() {
 
 void HardwareComposer::OnPostThreadPaused() {
   ALOGI("OnPostThreadPaused");
+  // Wait out any in-flight present before tearing down the layer stack and
+  // composer connection it is using.
+  WaitForPresentIdle();
   retire_fence_fds_.clear();
   layers_.clear();
 
@@ -496,9 +507,21 @@ std::string HardwareComposer::Dump() {
   return stream.str();
 }
 
-void HardwareComposer::PostLayers(hwc2_display_t display) {
+void HardwareComposer::PostLayers(hwc2_display_t display, int64_t deadline_ns) {
   ATRACE_NAME("HardwareComposer::PostLayers");
 
+  // Give the previous frame's present until this frame's scanout deadline to
+  // finish. If it is still in flight after that the pipeline is over a full
+  // frame behind; drop this frame instead of queuing behind it and pushing
+  // the next scanout window out as well. The skipped buffers stay queued and
+  // the next frame acquires the most recent one.
+  if (!WaitForPresentIdle(deadline_ns)) {
+    ATRACE_INT("present_busy_skip_count", ++present_busy_skip_count_);
+    ALOGW("HardwareComposer::PostLayers: dropping frame, previous present "
+          "still in flight (skips = %d)", present_busy_skip_count_);
+    return;
+  }
+
   // Setup the hardware composer layers with current buffers.
   for (auto& layer : layers_) {
     layer.Prepare();
@@ -544,16 +567,60 @@ void HardwareComposer::PostLayers(hwc2_display_t display) {
   }
 #endif
 
+  // Hand the prepared frame to the present thread so the blocking validate/
+  // present sequence cannot delay the next frame's vsync work.
+  {
+    std::lock_guard<std::mutex> lock(present_mutex_);
+    present_display_ = display;
+    present_busy_ = true;
+  }
+  present_wait_.notify_all();
+}
+
+void HardwareComposer::PresentThread() {
+  pthread_setname_np(pthread_self(), "VrHwcPresent");
+
+  std::unique_lock<std::mutex> lock(present_mutex_);
+  while (true) {
+    present_wait_.wait(lock, [this] { return present_busy_ || present_quit_; });
+    if (present_quit_)
+      break;
+
+    const hwc2_display_t display = present_display_;
+    lock.unlock();
+    PresentFrame(display);
+    lock.lock();
+
+    present_busy_ = false;
+    present_wait_.notify_all();
+  }
+}
+
+bool HardwareComposer::WaitForPresentIdle(int64_t deadline_ns) {
+  ATRACE_NAME("HardwareComposer::WaitForPresentIdle");
+  std::unique_lock<std::mutex> lock(present_mutex_);
+  if (deadline_ns < 0) {
+    present_wait_.wait(lock, [this] { return !present_busy_; });
+    return true;
+  }
+  return present_wait_.wait_for(
+      lock, std::chrono::nanoseconds(deadline_ns - GetSystemClockNs()),
+      [this] { return !present_busy_; });
+}
+
+void HardwareComposer::PresentFrame(hwc2_display_t display) {
+  ATRACE_NAME("HardwareComposer::PresentFrame");
+
   HWC::Error error = Validate(display);
   if (error != HWC::Error::None) {
-    ALOGE("HardwareComposer::PostLayers: Validate failed: %s display=%" PRIu64,
+    ALOGE("HardwareComposer::PresentFrame: Validate failed: %s display=%" PRIu64,
           error.to_string().c_str(), display);
     return;
   }
 
   error = Present(display);
   if (error != HWC::Error::None) {
-    ALOGE("HardwareComposer::PostLayers: Present failed: %s",
+    ALOGE("HardwareComposer::PresentFrame: Present failed: %s",
           error.to_string().c_str());
     return;
   }
@@ -563,7 +630,7 @@ void HardwareComposer::PostLayers(hwc2_display_t display) {
   error = composer_->getReleaseFences(display,
                                       &out_layers, &out_fences);
   ALOGE_IF(error != HWC::Error::None,
-           "HardwareComposer::PostLayers: Failed to get release fences: %s",
+           "HardwareComposer::PresentFrame: Failed to get release fences: %s",
            error.to_string().c_str());
 
   // Perform post-frame bookkeeping.
@@ -857,6 +924,8 @@ void HardwareComposer::PostThread() {
       // predictor will sync up with the real vsync.
       last_vsync_timestamp_ = GetSystemClockNs();
       vsync_prediction_interval_ = 1;
+      // An in-flight present may still append to retire_fence_fds_.
+      WaitForPresentIdle();
       retire_fence_fds_.clear();
     }
 
@@ -905,12 +974,13 @@ void HardwareComposer::PostThread() {
       vsync_ring_->Publish(vsync);
     }
 
+    const int64_t display_time_est_ns =
+        vsync_timestamp + target_display_->vsync_period_ns;
+
     {
       // Sleep until shortly before vsync.
       ATRACE_NAME("sleep");
 
-      const int64_t display_time_est_ns =
-          vsync_timestamp + target_display_->vsync_period_ns;
       const int64_t now_ns = GetSystemClockNs();
       const int64_t sleep_time_ns = display_time_est_ns - now_ns -
                                     post_thread_config_.frame_post_offset_ns;
@@ -958,7 +1028,7 @@ void HardwareComposer::PostThread() {
       }
     }
 
-    PostLayers(target_display_->id);
+    PostLayers(target_display_->id, display_time_est_ns);
   }
 }
 
@@ -994,6 +1064,10 @@ bool HardwareComposer::UpdateTargetDisplay() {
   }
 
   if (target_display_changed) {
+    // Wait for any in-flight present before reconfiguring displays or
+    // destroying layers underneath it.
+    WaitForPresentIdle();
+
     // If we're switching to the external display, turn the primary display off.
     if (!target_display_->is_primary) {
       EnableDisplay(primary_display_, false);
@@ -1032,6 +1106,10 @@ void HardwareComposer::UpdateLayerConfig() {
     surfaces_changed_ = false;
   }
 
+  // The present thread reads layer state; wait for it before rebuilding the
+  // layer list.
+  WaitForPresentIdle();
+
   ATRACE_NAME("UpdateLayerConfig_HwLayers");
 
   // Sort the new direct surface list by z-order to determine the relative order
@@ -416,7 +416,26 @@ class HardwareComposer {
   HWC::Error Validate(hwc2_display_t display);
   HWC::Error Present(hwc2_display_t display);
 
-  void PostLayers(hwc2_display_t display);
+  // Prepares the layer stack and hands the frame to the present thread. The
+  // deadline is the estimated scanout time for this frame; if the previous
+  // frame's present has not completed by then the frame is dropped instead of
+  // queuing behind it into the next scanout window.
+  void PostLayers(hwc2_display_t display, int64_t deadline_ns);
+
+  // Body of the present thread. Performs the blocking validate/present/fence
+  // sequence for one frame at a time so a slow present cannot delay the post
+  // thread's buffer acquisition for the next frame.
+  void PresentThread();
+
+  // Runs validate/present and the post-frame fence bookkeeping for the frame
+  // currently prepared in the layer stack. Called only on the present thread.
+  void PresentFrame(hwc2_display_t display);
+
+  // Blocks until the present thread has finished the in-flight frame, at most
+  // until deadline_ns (-1 means wait indefinitely). Returns true if the
+  // present thread is idle. Must be called before mutating layer or display
+  // state shared with the present thread.
+  bool WaitForPresentIdle(int64_t deadline_ns = -1);
   void PostThread();
 
   // The post thread has two controlling states:
@@ -514,6 +533,20 @@ class HardwareComposer {
   // hand buffers to hardware composer.
   std::thread post_thread_;
 
+  // The present thread. Executes the blocking validate/present/release-fence
+  // sequence handed off by PostLayers, bounded to one frame in flight.
+  std::thread present_thread_;
+  std::mutex present_mutex_;
+  std::condition_variable present_wait_;
+  // Display to present, valid while present_busy_ is true.
+  hwc2_display_t present_display_ = 0;
+  bool present_busy_ = false;
+  bool present_quit_ = false;
+
+  // Counter tracking frames dropped because the previous present was still in
+  // flight at the frame's deadline.
+  int present_busy_skip_count_ = 0;
+
   // Post thread state machine and synchronization primitives.
   PostThreadStateType post_thread_state_{PostThreadState::Idle |
                                          PostThreadState::Suspended};
@@ -78,12 +78,11 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
         return;
     }
 
-    std::shared_ptr<Blob> dummyKey(new Blob(key, keySize, false));
-    CacheEntry dummyEntry(dummyKey, nullptr);
+    const uint32_t digest = keyDigest(key, keySize);
 
     while (true) {
-        auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), dummyEntry);
-        if (index == mCacheEntries.end() || dummyEntry < *index) {
+        ssize_t index = findEntryIndex(digest, key, keySize);
+        if (index < 0) {
             // Create a new cache entry.
             std::shared_ptr<Blob> keyBlob(new Blob(key, keySize, true));
             std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
@@ -101,18 +100,21 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
                     break;
                 }
             }
-            mCacheEntries.insert(index, CacheEntry(keyBlob, valueBlob));
+            mCacheIndex.emplace(digest, mCacheEntries.size());
+            mCacheEntries.push_back(CacheEntry(keyBlob, valueBlob, digest));
             mTotalSize = newTotalSize;
             ALOGV("set: created new cache entry with %zu byte key and %zu byte value",
                     keySize, valueSize);
         } else {
             // Update the existing cache entry.
+            CacheEntry& entry = mCacheEntries[static_cast<size_t>(index)];
             std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
-            std::shared_ptr<Blob> oldValueBlob(index->getValue());
+            std::shared_ptr<Blob> oldValueBlob(entry.getValue());
             size_t newTotalSize = mTotalSize + valueSize - oldValueBlob->getSize();
             if (mMaxTotalSize < newTotalSize) {
                 if (isCleanable()) {
-                    // Clean the cache and try again.
+                    // Clean the cache and try again. This invalidates index,
+                    // so loop around to look the key up again.
                     clean();
                     continue;
                 } else {
@@ -122,7 +124,7 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
                     break;
                 }
             }
-            index->setValue(valueBlob);
+            entry.setValue(valueBlob);
             mTotalSize = newTotalSize;
             ALOGV("set: updated existing cache entry with %zu byte key and %zu byte "
                     "value", keySize, valueSize);
@@ -132,23 +134,21 @@ void BlobCache::set(const void* key, size_t keySize, const void* value,
 }
 
 size_t BlobCache::get(const void* key, size_t keySize, void* value,
-        size_t valueSize) {
+        size_t valueSize) const {
     if (mMaxKeySize < keySize) {
         ALOGV("get: not searching because the key is too large: %zu (limit %zu)",
                 keySize, mMaxKeySize);
         return 0;
     }
-    std::shared_ptr<Blob> dummyKey(new Blob(key, keySize, false));
-    CacheEntry dummyEntry(dummyKey, nullptr);
-    auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), dummyEntry);
-    if (index == mCacheEntries.end() || dummyEntry < *index) {
+    ssize_t index = findEntryIndex(keyDigest(key, keySize), key, keySize);
+    if (index < 0) {
         ALOGV("get: no cache entry found for key of size %zu", keySize);
         return 0;
     }
 
     // The key was found. Return the value if the caller's buffer is large
     // enough.
-    std::shared_ptr<Blob> valueBlob(index->getValue());
+    std::shared_ptr<Blob> valueBlob(mCacheEntries[static_cast<size_t>(index)].getValue());
     size_t valueBlobSize = valueBlob->getSize();
     if (valueBlobSize <= valueSize) {
         ALOGV("get: copying %zu bytes to caller's buffer", valueBlobSize);
@@ -227,7 +227,7 @@ int BlobCache::flatten(void* buffer, size_t size) const {
 
 int BlobCache::unflatten(void const* buffer, size_t size) {
     // All errors should result in the BlobCache being in an empty state.
-    mCacheEntries.clear();
+    clear();
 
     // Read the cache header
     if (size < sizeof(Header)) {
@@ -254,7 +254,7 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
     size_t numEntries = header->mNumEntries;
     for (size_t i = 0; i < numEntries; i++) {
         if (byteOffset + sizeof(EntryHeader) > size) {
-            mCacheEntries.clear();
+            clear();
             ALOGE("unflatten: not enough room for cache entry headers");
             return -EINVAL;
         }
@@ -267,7 +267,7 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
 
         size_t totalSize = align4(entrySize);
         if (byteOffset + totalSize > size) {
-            mCacheEntries.clear();
+            clear();
             ALOGE("unflatten: not enough room for cache entry headers");
             return -EINVAL;
         }
@@ -289,6 +289,38 @@ long int BlobCache::blob_random() {
 #endif
 }
 
+uint32_t BlobCache::keyDigest(const void* key, size_t keySize) {
+    // FNV-1a
+    uint32_t hash = 0x811c9dc5u;
+    const uint8_t* bytes = static_cast<const uint8_t*>(key);
+    for (size_t i = 0; i < keySize; i++) {
+        hash = (hash ^ bytes[i]) * 0x01000193u;
+    }
+    return hash;
+}
+
+ssize_t BlobCache::findEntryIndex(uint32_t digest, const void* key, size_t keySize) const {
+    auto range = mCacheIndex.equal_range(digest);
+    for (auto it = range.first; it != range.second; ++it) {
+        std::shared_ptr<Blob> entryKey(mCacheEntries[it->second].getKey());
+        if (entryKey->getSize() == keySize &&
+                memcmp(entryKey->getData(), key, keySize) == 0) {
+            return static_cast<ssize_t>(it->second);
+        }
+    }
+    return -1;
+}
+
+void BlobCache::eraseIndexMapping(uint32_t digest, size_t entryIndex) {
+    auto range = mCacheIndex.equal_range(digest);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == entryIndex) {
+            mCacheIndex.erase(it);
+            return;
+        }
+    }
+}
+
 void BlobCache::clean() {
     // Remove a random cache entry until the total cache size gets below half
     // the maximum total cache size.
@@ -296,7 +328,17 @@ void BlobCache::clean() {
         size_t i = size_t(blob_random() % (mCacheEntries.size()));
         const CacheEntry& entry(mCacheEntries[i]);
         mTotalSize -= entry.getKey()->getSize() + entry.getValue()->getSize();
-        mCacheEntries.erase(mCacheEntries.begin() + i);
+        eraseIndexMapping(entry.getDigest(), i);
+
+        // Move the last entry into the vacated position so the positions of
+        // all other entries stay valid in mCacheIndex.
+        size_t last = mCacheEntries.size() - 1;
+        if (i != last) {
+            eraseIndexMapping(mCacheEntries[last].getDigest(), last);
+            mCacheEntries[i] = mCacheEntries[last];
+            mCacheIndex.emplace(mCacheEntries[i].getDigest(), i);
+        }
+        mCacheEntries.pop_back();
     }
 }
 
@@ -335,18 +377,21 @@ size_t BlobCache::Blob::getSize() const {
     return mSize;
 }
 
-BlobCache::CacheEntry::CacheEntry() {
+BlobCache::CacheEntry::CacheEntry(): mDigest(0) {
 }
 
 BlobCache::CacheEntry::CacheEntry(
-        const std::shared_ptr<Blob>& key, const std::shared_ptr<Blob>& value):
+        const std::shared_ptr<Blob>& key, const std::shared_ptr<Blob>& value,
+        uint32_t digest):
         mKey(key),
-        mValue(value) {
+        mValue(value),
+        mDigest(digest) {
 }
 
 BlobCache::CacheEntry::CacheEntry(const CacheEntry& ce):
         mKey(ce.mKey),
-        mValue(ce.mValue) {
+        mValue(ce.mValue),
+        mDigest(ce.mDigest) {
 }
 
 bool BlobCache::CacheEntry::operator<(const CacheEntry& rhs) const {
@@ -356,6 +401,7 @@ bool BlobCache::CacheEntry::operator<(const CacheEntry& rhs) const {
 const BlobCache::CacheEntry& BlobCache::CacheEntry::operator=(const CacheEntry& rhs) {
     mKey = rhs.mKey;
     mValue = rhs.mValue;
+    mDigest = rhs.mDigest;
     return *this;
 }
 
@@ -367,6 +413,10 @@ std::shared_ptr<BlobCache::Blob> BlobCache::CacheEntry::getValue() const {
     return mValue;
 }
 
+uint32_t BlobCache::CacheEntry::getDigest() const {
+    return mDigest;
+}
+
 void BlobCache::CacheEntry::setValue(const std::shared_ptr<Blob>& value) {
     mValue = value;
 }
@@ -18,8 +18,11 @@
 #define ANDROID_BLOB_CACHE_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace android {
@@ -73,7 +76,10 @@ public:
     //   key != NULL
     //   0 < keySize
     //   0 <= valueSize
-    size_t get(const void* key, size_t keySize, void* value, size_t valueSize);
+    //
+    // get does not modify the cache, so concurrent calls to get are safe as
+    // long as no call to set, unflatten or clear is in progress.
+    size_t get(const void* key, size_t keySize, void* value, size_t valueSize) const;
 
 
     // getFlattenedSize returns the number of bytes needed to store the entire
@@ -97,9 +103,17 @@ public:
     //
     int unflatten(void const* buffer, size_t size);
 
+    // getEntryCount returns the number of key/value pairs currently resident
+    // in the cache.
+    size_t getEntryCount() const { return mCacheEntries.size(); }
+
     // clear flushes out all contents of the cache then the BlobCache, leaving
     // it in an empty state.
-    void clear() { mCacheEntries.clear(); }
+    void clear() {
+        mCacheEntries.clear();
+        mCacheIndex.clear();
+        mTotalSize = 0;
+    }
 
 protected:
     // mMaxTotalSize is the maximum size that all cache entries can occupy. This
@@ -156,7 +170,8 @@ private:
     class CacheEntry {
     public:
         CacheEntry();
-        CacheEntry(const std::shared_ptr<Blob>& key, const std::shared_ptr<Blob>& value);
+        CacheEntry(const std::shared_ptr<Blob>& key, const std::shared_ptr<Blob>& value,
+                uint32_t digest);
         CacheEntry(const CacheEntry& ce);
 
         bool operator<(const CacheEntry& rhs) const;
@@ -164,6 +179,7 @@ private:
 
         std::shared_ptr<Blob> getKey() const;
         std::shared_ptr<Blob> getValue() const;
+        uint32_t getDigest() const;
 
         void setValue(const std::shared_ptr<Blob>& value);
 
@@ -174,6 +190,11 @@ private:
 
         // mValue is the cached data associated with the key.
         std::shared_ptr<Blob> mValue;
+
+        // mDigest is the hash of mKey under which this entry is indexed in
+        // mCacheIndex, kept here so entries can be re-indexed without
+        // re-hashing the key.
+        uint32_t mDigest;
     };
 
     // A Header is the header for the entire BlobCache serialization format. No
@@ -240,9 +261,28 @@ private:
     // nrand48 to generate random numbers when needed.
     unsigned short mRandState[3];
 
+    // keyDigest computes the hash under which a key is indexed in
+    // mCacheIndex.
+    static uint32_t keyDigest(const void* key, size_t keySize);
+
+    // findEntryIndex returns the position in mCacheEntries of the entry with
+    // the given key, or -1 if the key is not cached. digest must be
+    // keyDigest(key, keySize).
+    ssize_t findEntryIndex(uint32_t digest, const void* key, size_t keySize) const;
+
+    // eraseIndexMapping removes the mCacheIndex mapping for the entry at
+    // position entryIndex in mCacheEntries.
+    void eraseIndexMapping(uint32_t digest, size_t entryIndex);
+
     // mCacheEntries stores all the cache entries that are resident in memory.
-    // Cache entries are added to it by the 'set' method.
+    // Cache entries are added to it by the 'set' method. The order of entries
+    // is not significant; lookups go through mCacheIndex.
     std::vector<CacheEntry> mCacheEntries;
+
+    // mCacheIndex maps key digests to positions in mCacheEntries, making
+    // set/get O(1) in the number of entries. Digest collisions are resolved
+    // by comparing the full keys.
+    std::unordered_multimap<uint32_t, size_t> mCacheIndex;
 };
 
 }
@@ -23,9 +23,19 @@
 #include <sys/stat.h>
 
 
-// Cache file header
-static const char* cacheFileMagic = "EGL$";
-static const size_t cacheFileHeaderSize = 8;
+// Cache file header: magic, CRC of the snapshot, snapshot size in bytes.
+// The snapshot is followed by zero or more journal records appended by
+// incremental saves.
+static const char* cacheFileMagic = "EGL&";
+static const size_t cacheFileHeaderSize = 12;
+
+// JournalEntryHeader::mMagic value identifying a journal record.
+static const uint32_t journalEntryMagic = ('j' << 24) + ('B' << 16) + ('b' << 8) + '$';
+
+// The maximum number of keys remembered for journal appends between saves.
+// If more entries than this are inserted, the next save falls back to a full
+// rewrite rather than accumulating an unbounded list of keys.
+static const size_t maxPendingJournalKeys = 64;
 
 namespace android {
 
@@ -45,10 +55,27 @@ static uint32_t crc32c(const uint8_t* buf, size_t len) {
     return r;
 }
 
+// A JournalEntryHeader precedes each key/value pair appended to the cache
+// file after the snapshot.  mCrc covers mKeySize, mValueSize and the key and
+// value data.  Each record is zero-padded to a 4-byte boundary.
+struct JournalEntryHeader {
+    uint32_t mMagic;
+    uint32_t mCrc;
+    uint32_t mKeySize;
+    uint32_t mValueSize;
+    uint8_t mData[];
+};
+
+static inline size_t align4(size_t size) {
+    return (size + 3) & ~3;
+}
+
 FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
         const std::string& filename)
         : BlobCache(maxKeySize, maxValueSize, maxTotalSize)
-        , mFilename(filename) {
+        , mFilename(filename)
+        , mFileValid(false)
+        , mJournalSize(0) {
     if (mFilename.length() > 0) {
         size_t headerSize = cacheFileHeaderSize;
 
@@ -86,21 +113,29 @@ FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxT
             return;
         }
 
-        // Check the file magic and CRC
-        size_t cacheSize = fileSize - headerSize;
-        if (memcmp(buf, cacheFileMagic, 4) != 0) {
+        // Check the file magic and the snapshot CRC
+        if (fileSize < headerSize || memcmp(buf, cacheFileMagic, 4) != 0) {
             ALOGE("cache file has bad mojo");
+            munmap(buf, fileSize);
+            close(fd);
+            return;
+        }
+        size_t snapshotSize = *reinterpret_cast<uint32_t*>(buf + 8);
+        if (snapshotSize > fileSize - headerSize) {
+            ALOGE("cache file snapshot is truncated");
+            munmap(buf, fileSize);
             close(fd);
             return;
         }
         uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
-        if (crc32c(buf + headerSize, cacheSize) != *crc) {
+        if (crc32c(buf + headerSize, snapshotSize) != *crc) {
             ALOGE("cache file failed CRC check");
+            munmap(buf, fileSize);
             close(fd);
             return;
         }
 
-        int err = unflatten(buf + headerSize, cacheSize);
+        int err = unflatten(buf + headerSize, snapshotSize);
         if (err < 0) {
             ALOGE("error reading cache contents: %s (%d)", strerror(-err),
                     -err);
@@ -109,78 +144,241 @@ FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxT
             return;
         }
 
+        // unflatten leaves the cache empty when the snapshot was written by
+        // a different build or cache version.  The journal records would
+        // then be just as stale, so treat the whole file as invalid and let
+        // the next save rewrite it.
+        if (getEntryCount() == 0) {
+            munmap(buf, fileSize);
+            close(fd);
+            return;
+        }
+
+        // Replay the journal records appended since the snapshot was
+        // written.  A record that fails validation - typically a partial
+        // append from an interrupted save - ends the replay, and the file is
+        // compacted on the next save.
+        size_t offset = headerSize + align4(snapshotSize);
+        bool journalValid = true;
+        while (offset + sizeof(JournalEntryHeader) <= fileSize) {
+            const JournalEntryHeader* jheader =
+                    reinterpret_cast<const JournalEntryHeader*>(buf + offset);
+            size_t journalKeySize = jheader->mKeySize;
+            size_t journalValueSize = jheader->mValueSize;
+            size_t recordSize = align4(sizeof(JournalEntryHeader) +
+                    journalKeySize + journalValueSize);
+            if (jheader->mMagic != journalEntryMagic ||
+                    journalKeySize == 0 || journalKeySize > maxKeySize ||
+                    journalValueSize == 0 || journalValueSize > maxValueSize ||
+                    recordSize > fileSize - offset) {
+                journalValid = false;
+                break;
+            }
+            if (crc32c(reinterpret_cast<const uint8_t*>(&jheader->mKeySize),
+                    2 * sizeof(uint32_t) + journalKeySize + journalValueSize) !=
+                    jheader->mCrc) {
+                journalValid = false;
+                break;
+            }
+            BlobCache::set(jheader->mData, journalKeySize,
+                    jheader->mData + journalKeySize, journalValueSize);
+            offset += recordSize;
+        }
+
+        if (journalValid && offset == fileSize) {
+            mFileValid = true;
+            mJournalSize = fileSize - headerSize - align4(snapshotSize);
+        } else {
+            ALOGW("cache file journal is invalid; the file will be "
+                    "rewritten on the next save");
+        }
+
         munmap(buf, fileSize);
         close(fd);
     }
 }
 
+void FileBlobCache::set(const void* key, size_t keySize, const void* value,
+        size_t valueSize) {
+    BlobCache::set(key, keySize, value, valueSize);
+
+    // When the file holds a valid snapshot, remember the key so the next
+    // save can append just this entry.  Otherwise the next save rewrites the
+    // whole file and captures the entry anyway.
+    if (mFilename.length() == 0 || !mFileValid) {
+        return;
+    }
+
+    // Skip keys whose entries were rejected by the cache; the journal only
+    // records what is actually resident.
+    if (BlobCache::get(key, keySize, nullptr, 0) == 0) {
+        return;
+    }
+
+    if (mPendingJournalKeys.size() >= maxPendingJournalKeys) {
+        mFileValid = false;
+        mPendingJournalKeys.clear();
+        return;
+    }
+
+    const uint8_t* keyBytes = static_cast<const uint8_t*>(key);
+    mPendingJournalKeys.emplace_back(keyBytes, keyBytes + keySize);
+}
+
 void FileBlobCache::writeToFile() {
-    if (mFilename.length() > 0) {
-        size_t cacheSize = getFlattenedSize();
-        size_t headerSize = cacheFileHeaderSize;
-        const char* fname = mFilename.c_str();
+    if (mFilename.length() == 0) {
+        return;
+    }
+    if (mFileValid) {
+        if (mPendingJournalKeys.empty()) {
+            // Nothing has been inserted since the last save.
+            return;
+        }
+        if (appendJournalEntries()) {
+            return;
+        }
+    }
+    writeSnapshotToFile();
+}
 
-        // Try to create the file with no permissions so we can write it
-        // without anyone trying to read it.
-        int fd = open(fname, O_CREAT | O_EXCL | O_RDWR, 0);
-        if (fd == -1) {
-            if (errno == EEXIST) {
-                // The file exists, delete it and try again.
-                if (unlink(fname) == -1) {
-                    // No point in retrying if the unlink failed.
-                    ALOGE("error unlinking cache file %s: %s (%d)", fname,
-                            strerror(errno), errno);
-                    return;
-                }
-                // Retry now that we've unlinked the file.
-                fd = open(fname, O_CREAT | O_EXCL | O_RDWR, 0);
-            }
-            if (fd == -1) {
-                ALOGE("error creating cache file %s: %s (%d)", fname,
+bool FileBlobCache::appendJournalEntries() {
+    // Serialize all pending entries into one buffer so they land in the file
+    // with a single append.  The values are looked up now rather than at
+    // insertion time, so the journal reflects the current cache contents.
+    std::vector<uint8_t> records;
+    for (const std::vector<uint8_t>& key : mPendingJournalKeys) {
+        size_t valueSize = BlobCache::get(key.data(), key.size(), nullptr, 0);
+        if (valueSize == 0) {
+            // The entry was evicted after it was inserted.
+            continue;
+        }
+        size_t recordSize = align4(sizeof(JournalEntryHeader) + key.size() +
+                valueSize);
+        size_t offset = records.size();
+        records.resize(offset + recordSize, 0);
+        JournalEntryHeader* jheader =
+                reinterpret_cast<JournalEntryHeader*>(&records[offset]);
+        jheader->mMagic = journalEntryMagic;
+        jheader->mKeySize = key.size();
+        jheader->mValueSize = valueSize;
+        memcpy(jheader->mData, key.data(), key.size());
+        if (BlobCache::get(key.data(), key.size(), jheader->mData + key.size(),
+                valueSize) != valueSize) {
+            return false;
+        }
+        jheader->mCrc = crc32c(reinterpret_cast<uint8_t*>(&jheader->mKeySize),
+                2 * sizeof(uint32_t) + key.size() + valueSize);
+    }
+
+    if (records.empty()) {
+        mPendingJournalKeys.clear();
+        return true;
+    }
+
+    // Once the journal takes up a significant fraction of the file, compact
+    // it back into the snapshot instead of letting the file grow without
+    // bound.
+    if (mJournalSize + records.size() > mMaxTotalSize / 2) {
+        return false;
+    }
+
+    const char* fname = mFilename.c_str();
+    int fd = open(fname, O_WRONLY | O_APPEND);
+    if (fd == -1) {
+        ALOGW("error opening cache file %s for append: %s (%d)", fname,
+                strerror(errno), errno);
+        return false;
+    }
+    if (write(fd, records.data(), records.size()) !=
+            static_cast<ssize_t>(records.size())) {
+        ALOGE("error appending to cache file %s: %s (%d)", fname,
+                strerror(errno), errno);
+        close(fd);
+        // A partial record at the end of the file is detected and discarded
+        // by the validation on the next load; rewrite the file now.
+        mFileValid = false;
+        return false;
+    }
+    close(fd);
+    mJournalSize += records.size();
+    mPendingJournalKeys.clear();
+    return true;
+}
+
+void FileBlobCache::writeSnapshotToFile() {
+    // Any append state refers to the file being replaced.
+    mFileValid = false;
+    mJournalSize = 0;
+    mPendingJournalKeys.clear();
+
+    size_t cacheSize = getFlattenedSize();
+    size_t headerSize = cacheFileHeaderSize;
+    const char* fname = mFilename.c_str();
+
+    // Try to create the file with no permissions so we can write it
+    // without anyone trying to read it.
+    int fd = open(fname, O_CREAT | O_EXCL | O_RDWR, 0);
+    if (fd == -1) {
+        if (errno == EEXIST) {
+            // The file exists, delete it and try again.
+            if (unlink(fname) == -1) {
+                // No point in retrying if the unlink failed.
+                ALOGE("error unlinking cache file %s: %s (%d)", fname,
                         strerror(errno), errno);
                 return;
             }
+            // Retry now that we've unlinked the file.
+            fd = open(fname, O_CREAT | O_EXCL | O_RDWR, 0);
         }
-
-        size_t fileSize = headerSize + cacheSize;
-
-        uint8_t* buf = new uint8_t [fileSize];
-        if (!buf) {
-            ALOGE("error allocating buffer for cache contents: %s (%d)",
+        if (fd == -1) {
+            ALOGE("error creating cache file %s: %s (%d)", fname,
                     strerror(errno), errno);
-            close(fd);
-            unlink(fname);
             return;
         }
+    }
 
-        int err = flatten(buf + headerSize, cacheSize);
-        if (err < 0) {
-            ALOGE("error writing cache contents: %s (%d)", strerror(-err),
-                    -err);
-            delete [] buf;
-            close(fd);
-            unlink(fname);
-            return;
-        }
+    size_t fileSize = headerSize + cacheSize;
 
-        // Write the file magic and CRC
-        memcpy(buf, cacheFileMagic, 4);
-        uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
-        *crc = crc32c(buf + headerSize, cacheSize);
+    uint8_t* buf = new uint8_t [fileSize];
+    if (!buf) {
+        ALOGE("error allocating buffer for cache contents: %s (%d)",
+                strerror(errno), errno);
+        close(fd);
+        unlink(fname);
+        return;
+    }
 
-        if (write(fd, buf, fileSize) == -1) {
-            ALOGE("error writing cache file: %s (%d)", strerror(errno),
-                    errno);
-            delete [] buf;
-            close(fd);
-            unlink(fname);
-            return;
-        }
+    int err = flatten(buf + headerSize, cacheSize);
+    if (err < 0) {
+        ALOGE("error writing cache contents: %s (%d)", strerror(-err),
+                -err);
+        delete [] buf;
+        close(fd);
+        unlink(fname);
+        return;
+    }
 
+    // Write the file magic, snapshot CRC and snapshot size
+    memcpy(buf, cacheFileMagic, 4);
+    uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
+    *crc = crc32c(buf + headerSize, cacheSize);
+    *reinterpret_cast<uint32_t*>(buf + 8) = cacheSize;
+
+    if (write(fd, buf, fileSize) == -1) {
+        ALOGE("error writing cache file: %s (%d)", strerror(errno),
+                errno);
         delete [] buf;
-        fchmod(fd, S_IRUSR);
         close(fd);
+        unlink(fname);
+        return;
     }
+
+    delete [] buf;
+    // Leave the file owner-writable so later saves can append journal
+    // records to it.
+    fchmod(fd, S_IRUSR | S_IWUSR);
+    close(fd);
+    mFileValid = true;
 }
 
 }
@@ -18,7 +18,9 @@
 #define ANDROID_FILE_BLOB_CACHE_H
 
 #include "BlobCache.h"
+#include <stdint.h>
 #include <string>
+#include <vector>
 
 namespace android {
 
@@ -29,13 +31,49 @@ public:
     FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
             const std::string& filename);
 
+    // set inserts the key/value pair into the cache and remembers the key so
+    // that the next call to writeToFile can append just this entry to the
+    // cache file rather than rewriting the whole file.  This hides
+    // BlobCache::set; entries inserted through a BlobCache pointer are only
+    // persisted by the next full rewrite.
+    void set(const void* key, size_t keySize, const void* value,
+            size_t valueSize);
+
     // writeToFile attempts to save the current contents of BlobCache to
-    // disk.
+    // disk.  If the file already holds a valid snapshot, the entries
+    // inserted since the last save are appended to it as journal records;
+    // the file is only rewritten from scratch when the journal portion has
+    // grown large enough to be worth compacting back into the snapshot.
     void writeToFile();
 
 private:
+    // appendJournalEntries appends one journal record per pending key to the
+    // cache file.  Returns false if the file should instead be rewritten as
+    // a fresh snapshot, either because the journal has grown too large or
+    // because the append failed.
+    bool appendJournalEntries();
+
+    // writeSnapshotToFile rewrites the entire cache file from the current
+    // cache contents, replacing any existing snapshot and journal records.
+    void writeSnapshotToFile();
+
     // mFilename is the name of the file for storing cache contents.
     std::string mFilename;
+
+    // mFileValid indicates whether the cache file currently holds a valid
+    // snapshot that journal records may be appended to.  It is false until
+    // the first successful load or full rewrite, and is cleared when the
+    // file is found to be stale or corrupt.
+    bool mFileValid;
+
+    // mJournalSize is the number of journal record bytes that follow the
+    // snapshot in the cache file.
+    size_t mJournalSize;
+
+    // mPendingJournalKeys holds copies of the keys inserted via set since
+    // the last save.  The corresponding values are looked up at save time,
+    // so only the latest value of a repeatedly updated key is written out.
+    std::vector<std::vector<uint8_t>> mPendingJournalKeys;
 };
 
 } // namespace android
@@ -19,7 +19,10 @@
 
 #include <EGL/Loader.h>
 
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <dirent.h>
 #include <dlfcn.h>
@@ -388,6 +391,36 @@ void Loader::init_api(void* dso,
     }
 }
 
+// Returns the (cached) list of regular files in a driver search directory.
+// The search directories live on read-only system and vendor partitions, so
+// their contents cannot change while the process is running; scanning each
+// directory once and remembering the result keeps repeated driver lookups
+// (one per library kind and naming scheme) from re-walking the filesystem.
+static const std::vector<std::string>& scan_driver_dir(const std::string& dir) {
+    static std::mutex cacheMutex;
+    static std::unordered_map<std::string, std::vector<std::string>> cache;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(dir);
+    if (it != cache.end()) {
+        return it->second;
+    }
+
+    std::vector<std::string>& names = cache[dir];
+    DIR* d = opendir(dir.c_str());
+    if (d != nullptr) {
+        struct dirent* e;
+        while ((e = readdir(d)) != nullptr) {
+            if (e->d_type == DT_DIR) {
+                continue;
+            }
+            names.push_back(e->d_name);
+        }
+        closedir(d);
+    }
+    return names;
+}
+
 static void* load_system_driver(const char* kind, const char* suffix, const bool exact) {
     ATRACE_CALL();
     class MatchFile {
@@ -425,26 +458,18 @@ static void* load_system_driver(const char* kind, const char* suffix, const bool
                 return false;
             }
 
-            DIR* d = opendir(search);
-            if (d != nullptr) {
-                struct dirent* e;
-                while ((e = readdir(d)) != nullptr) {
-                    if (e->d_type == DT_DIR) {
-                        continue;
-                    }
-                    if (!strcmp(e->d_name, "libGLES_android.so")) {
-                        // always skip the software renderer
-                        continue;
-                    }
-                    if (strstr(e->d_name, pattern.c_str()) == e->d_name) {
-                        if (!strcmp(e->d_name + strlen(e->d_name) - 3, ".so")) {
-                            result = std::string(search) + "/" + e->d_name;
-                            closedir(d);
-                            return true;
-                        }
+            for (const std::string& name : scan_driver_dir(search)) {
+                if (name == "libGLES_android.so") {
+                    // always skip the software renderer
+                    continue;
+                }
+                if (strstr(name.c_str(), pattern.c_str()) == name.c_str()) {
+                    if (name.size() > 3 &&
+                            !strcmp(name.c_str() + name.size() - 3, ".so")) {
+                        result = std::string(search) + "/" + name;
+                        return true;
                     }
                 }
-                closedir(d);
             }
             return false;
         }
@@ -77,7 +77,7 @@ egl_cache_t* egl_cache_t::get() {
 }
 
 void egl_cache_t::initialize(egl_display_t *display) {
-    std::lock_guard<std::mutex> lock(mMutex);
+    std::lock_guard<std::shared_mutex> lock(mMutex);
 
     egl_connection_t* const cnx = &gEGLImpl;
     if (cnx->dso && cnx->major >= 0 && cnx->minor >= 0) {
@@ -115,7 +115,7 @@ void egl_cache_t::initialize(egl_display_t *display) {
 }
 
 void egl_cache_t::terminate() {
-    std::lock_guard<std::mutex> lock(mMutex);
+    std::lock_guard<std::shared_mutex> lock(mMutex);
     if (mBlobCache) {
         mBlobCache->writeToFile();
     }
@@ -124,7 +124,7 @@ void egl_cache_t::terminate() {
 
 void egl_cache_t::setBlob(const void* key, EGLsizeiANDROID keySize,
         const void* value, EGLsizeiANDROID valueSize) {
-    std::lock_guard<std::mutex> lock(mMutex);
+    std::lock_guard<std::shared_mutex> lock(mMutex);
 
     if (keySize < 0 || valueSize < 0) {
         ALOGW("EGL_ANDROID_blob_cache set: negative sizes are not allowed");
@@ -132,14 +132,14 @@ void egl_cache_t::setBlob(const void* key, EGLsizeiANDROID keySize,
     }
 
     if (mInitialized) {
-        BlobCache* bc = getBlobCacheLocked();
+        FileBlobCache* bc = getBlobCacheLocked();
         bc->set(key, keySize, value, valueSize);
 
         if (!mSavePending) {
             mSavePending = true;
             std::thread deferredSaveThread([this]() {
                 sleep(deferredSaveDelay);
-                std::lock_guard<std::mutex> lock(mMutex);
+                std::lock_guard<std::shared_mutex> lock(mMutex);
                 if (mInitialized && mBlobCache) {
                     mBlobCache->writeToFile();
                 }
@@ -152,26 +152,39 @@ void egl_cache_t::setBlob(const void* key, EGLsizeiANDROID keySize,
 
 EGLsizeiANDROID egl_cache_t::getBlob(const void* key, EGLsizeiANDROID keySize,
         void* value, EGLsizeiANDROID valueSize) {
-    std::lock_guard<std::mutex> lock(mMutex);
-
     if (keySize < 0 || valueSize < 0) {
         ALOGW("EGL_ANDROID_blob_cache set: negative sizes are not allowed");
         return 0;
     }
 
+    // Once the cache exists, lookups are read-only and can run concurrently
+    // under a shared lock, so GL contexts on different threads don't
+    // serialize on every shader lookup.
+    {
+        std::shared_lock<std::shared_mutex> lock(mMutex);
+        if (!mInitialized) {
+            return 0;
+        }
+        if (mBlobCache) {
+            return mBlobCache->get(key, keySize, value, valueSize);
+        }
+    }
+
+    // The cache hasn't been loaded yet; create it under the exclusive lock.
+    std::lock_guard<std::shared_mutex> lock(mMutex);
     if (mInitialized) {
-        BlobCache* bc = getBlobCacheLocked();
+        FileBlobCache* bc = getBlobCacheLocked();
         return bc->get(key, keySize, value, valueSize);
     }
     return 0;
 }
 
 void egl_cache_t::setCacheFilename(const char* filename) {
-    std::lock_guard<std::mutex> lock(mMutex);
+    std::lock_guard<std::shared_mutex> lock(mMutex);
     mFilename = filename;
 }
 
-BlobCache* egl_cache_t::getBlobCacheLocked() {
+FileBlobCache* egl_cache_t::getBlobCacheLocked() {
     if (mBlobCache == nullptr) {
         mBlobCache.reset(new FileBlobCache(maxKeySize, maxValueSize, maxTotalSize, mFilename));
     }
@@ -24,6 +24,7 @@
 
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
 
 // ----------------------------------------------------------------------------
@@ -76,11 +77,11 @@ private:
     egl_cache_t(const egl_cache_t&); // not implemented
     void operator=(const egl_cache_t&); // not implemented
 
-    // getBlobCacheLocked returns the BlobCache object being used to store the
-    // key/value blob pairs.  If the BlobCache object has not yet been created,
-    // this will do so, loading the serialized cache contents from disk if
-    // possible.
-    BlobCache* getBlobCacheLocked();
+    // getBlobCacheLocked returns the FileBlobCache object being used to store
+    // the key/value blob pairs.  If the FileBlobCache object has not yet been
+    // created, this will do so, loading the serialized cache contents from
+    // disk if possible.
+    FileBlobCache* getBlobCacheLocked();
 
     // mInitialized indicates whether the egl_cache_t is in the initialized
     // state.  It is initialized to false at construction time, and gets set to
@@ -110,8 +111,10 @@ private:
     bool mSavePending;
 
     // mMutex is the mutex used to prevent concurrent access to the member
-    // variables. It must be locked whenever the member variables are accessed.
-    mutable std::mutex mMutex;
+    // variables. It must be locked whenever the member variables are accessed;
+    // getBlob only takes it shared, since cache lookups don't modify any
+    // state once the cache has been created.
+    mutable std::shared_mutex mMutex;
 
     // sCache is the singleton egl_cache_t object.
     static egl_cache_t sCache;
@@ -85,7 +85,8 @@ int egl_get_init_count(EGLDisplay dpy) {
 egl_display_t egl_display_t::sDisplay[NUM_DISPLAYS];
 
 egl_display_t::egl_display_t() :
-    magic('_dpy'), finishOnSwap(false), traceGpuCompletion(false), refs(0), eglIsInitialized(false) {
+    magic('_dpy'), finishOnSwap(false), traceGpuCompletion(false), refs(0),
+    eglIsInitialized(false), objectsGeneration(0) {
 }
 
 egl_display_t::~egl_display_t() {
@@ -113,6 +114,8 @@ void egl_display_t::addObject(egl_object_t* object) {
 void egl_display_t::removeObject(egl_object_t* object) {
     std::lock_guard<std::mutex> _l(lock);
     objects.erase(object);
+    // Invalidate any per-thread caches of validated handles.
+    objectsGeneration.fetch_add(1, std::memory_order_release);
 }
 
 bool egl_display_t::getObject(egl_object_t* object) const {
@@ -435,6 +438,10 @@ EGLBoolean egl_display_t::terminate() {
         // reinitialized.
         mExtensionString.clear();
 
+        // Invalidate any per-thread caches of validated handles before the
+        // objects are destroyed.
+        objectsGeneration.fetch_add(1, std::memory_order_release);
+
         // Mark all objects remaining in the list as terminated, unless
         // there are no reference to them, it which case, we're free to
         // delete them.
@@ -21,6 +21,7 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <string>
@@ -73,6 +74,14 @@ public:
     // add reference to this object. returns true if this is a valid object.
     bool getObject(egl_object_t* object) const;
 
+    // getObjectsGeneration returns a value that changes whenever an object is
+    // removed from this display's object list. A handle validated under one
+    // generation stays valid for as long as the generation is unchanged, which
+    // lets threads cache validation results without holding the display lock.
+    uint64_t getObjectsGeneration() const {
+        return objectsGeneration.load(std::memory_order_acquire);
+    }
+
     static egl_display_t* get(EGLDisplay dpy);
     static EGLDisplay getFromNativeDisplay(EGLNativeDisplayType disp, const EGLAttrib* attrib_list);
 
@@ -125,6 +134,7 @@ private:
     mutable std::mutex                  lock;
     mutable std::mutex                  refLock;
     mutable std::condition_variable     refCond;
+    mutable std::atomic<uint64_t>       objectsGeneration;
             std::unordered_set<egl_object_t*> objects;
             std::string mVendorString;
             std::string mVersionString;
@@ -18,6 +18,8 @@
 
 #include <sstream>
 
+#include "egl_tls.h"
+
 
 // ----------------------------------------------------------------------------
 namespace android {
@@ -48,6 +50,15 @@ void egl_object_t::destroy() {
 }
 
 bool egl_object_t::get(egl_display_t const* display, egl_object_t* object) {
+    // The objects this thread made current carry a reference held by the
+    // thread itself, so as long as no handle on the display has been
+    // invalidated since they were cached (tracked by the display's object
+    // generation) they can be revalidated without taking the display lock.
+    if (egl_tls_t::isHandleCached(display, display->getObjectsGeneration(),
+                                  object)) {
+        object->incRef();
+        return true;
+    }
     // used by LocalRef, this does an incRef() atomically with
     // checking that the object is valid.
     return display->getObject(object);
@@ -1013,6 +1013,8 @@ EGLBoolean eglDestroyContextImpl(EGLDisplay dpy, EGLContext ctx)
 EGLBoolean eglMakeCurrentImpl(  EGLDisplay dpy, EGLSurface draw,
                                 EGLSurface read, EGLContext ctx)
 {
+    EGL_PROFILE_CALL(MAKE_CURRENT);
+
     egl_display_ptr dp = validate_display(dpy);
     if (!dp) return setError(EGL_BAD_DISPLAY, (EGLBoolean)EGL_FALSE);
 
@@ -1024,6 +1026,12 @@ EGLBoolean eglMakeCurrentImpl(  EGLDisplay dpy, EGLSurface draw,
         if (!dp->isReady()) return setError(EGL_NOT_INITIALIZED, (EGLBoolean)EGL_FALSE);
     }
 
+    // Read the object generation before validating the handles below, so
+    // that if another thread invalidates a handle while we're here, the
+    // cached handles stored on success are already stale and force the slow
+    // validation path.
+    const uint64_t objectsGeneration = dp->getObjectsGeneration();
+
     // get a reference to the object passed in
     ContextRef _c(dp.get(), ctx);
     SurfaceRef _d(dp.get(), draw);
@@ -1090,9 +1098,14 @@ EGLBoolean eglMakeCurrentImpl(  EGLDisplay dpy, EGLSurface draw,
             _c.acquire();
             _r.acquire();
             _d.acquire();
+            // The references acquired above are held until the context stops
+            // being current on this thread, which is what makes it safe for
+            // later calls to validate these handles from the cache.
+            egl_tls_t::cacheCurrentHandles(dp.get(), objectsGeneration, c, d, r);
         } else {
             setGLHooksThreadSpecific(&gHooksNoContext);
             egl_tls_t::setContext(EGL_NO_CONTEXT);
+            egl_tls_t::clearCachedHandles();
         }
     } else {
         // this will ALOGE the error
@@ -1385,6 +1398,8 @@ private:
 EGLBoolean eglSwapBuffersWithDamageKHRImpl(EGLDisplay dpy, EGLSurface draw,
         EGLint *rects, EGLint n_rects)
 {
+    EGL_PROFILE_CALL(SWAP_BUFFERS);
+
     const egl_display_ptr dp = validate_display(dpy);
     if (!dp) return EGL_FALSE;
 
@@ -1764,6 +1779,8 @@ typedef EGLImage(EGLAPIENTRYP PFNEGLCREATEIMAGE)(EGLDisplay dpy, EGLContext ctx,
 
 EGLImageKHR eglCreateImageKHRImpl(EGLDisplay dpy, EGLContext ctx, EGLenum target,
                                   EGLClientBuffer buffer, const EGLint* attrib_list) {
+    EGL_PROFILE_CALL(CREATE_IMAGE);
+
     return eglCreateImageTmpl<EGLint, PFNEGLCREATEIMAGEKHRPROC>(dpy, ctx, target, buffer,
                                                                 attrib_list,
                                                                 gEGLImpl.egl.eglCreateImageKHR);
@@ -1771,6 +1788,8 @@ EGLImageKHR eglCreateImageKHRImpl(EGLDisplay dpy, EGLContext ctx, EGLenum target
 
 EGLImage eglCreateImageImpl(EGLDisplay dpy, EGLContext ctx, EGLenum target, EGLClientBuffer buffer,
                             const EGLAttrib* attrib_list) {
+    EGL_PROFILE_CALL(CREATE_IMAGE);
+
     egl_connection_t* const cnx = &gEGLImpl;
     if (cnx->driverVersion >= EGL_MAKE_VERSION(1, 5, 0)) {
         if (cnx->egl.eglCreateImage) {
@@ -29,7 +29,9 @@ pthread_key_t egl_tls_t::sKey = TLS_KEY_NOT_INITIALIZED;
 pthread_once_t egl_tls_t::sOnceKey = PTHREAD_ONCE_INIT;
 
 egl_tls_t::egl_tls_t()
-    : error(EGL_SUCCESS), ctx(nullptr), logCallWithNoContext(true) {
+    : error(EGL_SUCCESS), ctx(nullptr), logCallWithNoContext(true),
+      cachedDisplay(nullptr), cachedGeneration(0),
+      cachedHandles{nullptr, nullptr, nullptr} {
 }
 
 const char *egl_tls_t::egl_strerror(EGLint err) {
@@ -152,6 +154,52 @@ EGLint egl_tls_t::getError() {
     return error;
 }
 
+void egl_tls_t::cacheCurrentHandles(egl_display_t const* dpy, uint64_t generation,
+                                    egl_object_t const* ctx, egl_object_t const* draw,
+                                    egl_object_t const* read) {
+    validateTLSKey();
+    egl_tls_t* tls = getTLS();
+    tls->cachedDisplay = dpy;
+    tls->cachedGeneration = generation;
+    tls->cachedHandles[0] = ctx;
+    tls->cachedHandles[1] = draw;
+    tls->cachedHandles[2] = read;
+}
+
+void egl_tls_t::clearCachedHandles() {
+    if (sKey == TLS_KEY_NOT_INITIALIZED) {
+        return;
+    }
+    egl_tls_t* tls = (egl_tls_t*)pthread_getspecific(sKey);
+    if (!tls) {
+        return;
+    }
+    tls->cachedDisplay = nullptr;
+    for (size_t i = 0; i < CACHED_HANDLE_COUNT; i++) {
+        tls->cachedHandles[i] = nullptr;
+    }
+}
+
+bool egl_tls_t::isHandleCached(egl_display_t const* dpy, uint64_t generation,
+                               egl_object_t const* object) {
+    if (sKey == TLS_KEY_NOT_INITIALIZED) {
+        return false;
+    }
+    egl_tls_t* tls = (egl_tls_t*)pthread_getspecific(sKey);
+    if (!tls) {
+        return false;
+    }
+    if (tls->cachedDisplay != dpy || tls->cachedGeneration != generation) {
+        return false;
+    }
+    for (size_t i = 0; i < CACHED_HANDLE_COUNT; i++) {
+        if (tls->cachedHandles[i] == object) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void egl_tls_t::setContext(EGLContext ctx) {
     validateTLSKey();
     getTLS()->ctx = ctx;
@@ -20,15 +20,23 @@
 #include <EGL/egl.h>
 
 #include <pthread.h>
+#include <stdint.h>
 
 // ----------------------------------------------------------------------------
 namespace android {
 // ----------------------------------------------------------------------------
 
 class DbgContext;
+class egl_display_t;
+class egl_object_t;
 
 class egl_tls_t {
     enum { TLS_KEY_NOT_INITIALIZED = -1 };
+
+    // The number of handles remembered by the validated-handle cache: the
+    // current context and its draw and read surfaces.
+    enum { CACHED_HANDLE_COUNT = 3 };
+
     static pthread_key_t sKey;
     static pthread_once_t sOnceKey;
 
@@ -36,6 +44,14 @@ class egl_tls_t {
     EGLContext  ctx;
     bool        logCallWithNoContext;
 
+    // The handles this thread made current, revalidated against the display's
+    // object generation so hot calls like eglSwapBuffers can skip the display
+    // lock. The thread holds a reference on each cached object for as long as
+    // it is current, so a cache hit can never see freed memory.
+    egl_display_t const* cachedDisplay;
+    uint64_t             cachedGeneration;
+    egl_object_t const*  cachedHandles[CACHED_HANDLE_COUNT];
+
     egl_tls_t();
     static void validateTLSKey();
     static void destructTLSData(void* data);
@@ -52,6 +68,19 @@ public:
     static bool logNoContextCall();
     static const char *egl_strerror(EGLint err);
 
+    // cacheCurrentHandles remembers the objects made current on this thread.
+    // generation must have been read from the display before the handles were
+    // validated, so that a concurrent invalidation forces a cache miss.
+    static void cacheCurrentHandles(egl_display_t const* dpy, uint64_t generation,
+                                    egl_object_t const* ctx, egl_object_t const* draw,
+                                    egl_object_t const* read);
+    static void clearCachedHandles();
+
+    // isHandleCached returns true if object was made current on this thread
+    // and no handle on the display has been invalidated since.
+    static bool isHandleCached(egl_display_t const* dpy, uint64_t generation,
+                               egl_object_t const* object);
+
     template<typename T>
     static T setErrorEtc(const char* caller,
             int line, EGLint error, T returnValue, bool quiet = false) {
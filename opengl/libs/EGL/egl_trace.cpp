@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EGL_profile"
+
+#include "egl_trace.h"
+
+#include <inttypes.h>
+
+#include <atomic>
+
+#include <android-base/properties.h>
+#include <log/log.h>
+
+namespace android {
+namespace egl_profile {
+namespace {
+
+constexpr char kProfileProperty[] = "debug.egl.profile";
+// Re-read the property at most this often so steady-state calls stay cheap
+// while still allowing the profiler to be toggled without a restart.
+constexpr int64_t kPropertyRefreshNs = 1000000000;      // 1s
+// Emit a summary log at most this often while enabled.
+constexpr int64_t kReportIntervalNs = 10000000000;      // 10s
+
+// One counter slot per profiled entrypoint, each on its own cache line so
+// render and worker threads don't false-share. Updates are relaxed atomics;
+// the occasional torn view in the summary log is acceptable.
+struct alignas(64) Slot {
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> totalNs;
+    std::atomic<uint64_t> maxNs;
+};
+
+Slot gSlots[NUM_ENTRIES];
+const char* const gEntryNames[NUM_ENTRIES] = {
+    "eglSwapBuffers",
+    "eglMakeCurrent",
+    "eglCreateImage",
+};
+
+std::atomic<bool> gEnabled(false);
+std::atomic<int64_t> gNextRefreshNs(0);
+std::atomic<int64_t> gNextReportNs(0);
+
+int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void maybeReport(int64_t now) {
+    int64_t next = gNextReportNs.load(std::memory_order_relaxed);
+    if (now < next ||
+        !gNextReportNs.compare_exchange_strong(next, now + kReportIntervalNs,
+                                               std::memory_order_relaxed)) {
+        return;
+    }
+    for (uint32_t i = 0; i < NUM_ENTRIES; i++) {
+        Slot& slot = gSlots[i];
+        const uint64_t calls = slot.calls.exchange(0, std::memory_order_relaxed);
+        const uint64_t totalNs = slot.totalNs.exchange(0, std::memory_order_relaxed);
+        const uint64_t maxNs = slot.maxNs.exchange(0, std::memory_order_relaxed);
+        if (!calls)
+            continue;
+        ALOGD("%s: %" PRIu64 " calls, avg %" PRIu64 "us, max %" PRIu64 "us",
+              gEntryNames[i], calls, totalNs / calls / 1000, maxNs / 1000);
+    }
+}
+
+} // anonymous namespace
+
+bool isEnabled() {
+    const int64_t now = nowNs();
+    int64_t next = gNextRefreshNs.load(std::memory_order_relaxed);
+    if (now >= next &&
+        gNextRefreshNs.compare_exchange_strong(next, now + kPropertyRefreshNs,
+                                               std::memory_order_relaxed)) {
+        gEnabled.store(base::GetBoolProperty(kProfileProperty, false),
+                       std::memory_order_relaxed);
+    }
+    return gEnabled.load(std::memory_order_relaxed);
+}
+
+void noteCall(Entry entry, int64_t durationNs) {
+    Slot& slot = gSlots[entry];
+    slot.calls.fetch_add(1, std::memory_order_relaxed);
+    slot.totalNs.fetch_add(static_cast<uint64_t>(durationNs),
+                           std::memory_order_relaxed);
+    uint64_t prev = slot.maxNs.load(std::memory_order_relaxed);
+    while (static_cast<uint64_t>(durationNs) > prev &&
+           !slot.maxNs.compare_exchange_weak(prev, static_cast<uint64_t>(durationNs),
+                                             std::memory_order_relaxed)) {
+    }
+    maybeReport(nowNs());
+}
+
+} // namespace egl_profile
+} // namespace android
@@ -19,6 +19,7 @@
 #if defined(__ANDROID__)
 
 #include <stdint.h>
+#include <time.h>
 
 #include <cutils/trace.h>
 
@@ -48,11 +49,63 @@ private:
     uint64_t mTag;
 };
 
+// Sampling profiler for hot EGL entrypoints. Unlike ATRACE it has no
+// per-call tracing overhead: when enabled via debug.egl.profile (checked
+// periodically, so it can be toggled without restarting the app) each
+// profiled call adds its duration to a lock-free per-entrypoint counter
+// slot, and a summary of call rates and durations is logged at a fixed
+// interval. When disabled the cost is one relaxed atomic load per call.
+namespace egl_profile {
+
+enum Entry : uint32_t {
+    SWAP_BUFFERS = 0,
+    MAKE_CURRENT,
+    CREATE_IMAGE,
+    NUM_ENTRIES,
+};
+
+// Returns whether profiling is currently enabled, re-reading the property
+// at most once per refresh interval.
+bool isEnabled();
+// Records one profiled call. Also emits the periodic summary log.
+void noteCall(Entry entry, int64_t durationNs);
+
+class ScopedCall {
+public:
+    explicit ScopedCall(Entry entry)
+        : mEntry(entry), mStartNs(isEnabled() ? nowNs() : 0) {}
+    ~ScopedCall() {
+        if (mStartNs)
+            noteCall(mEntry, nowNs() - mStartNs);
+    }
+
+    ScopedCall(const ScopedCall&) = delete;
+    ScopedCall& operator=(const ScopedCall&) = delete;
+
+private:
+    static int64_t nowNs() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    const Entry mEntry;
+    int64_t mStartNs;
+};
+
+} // namespace egl_profile
+
 }; // namespace android
 
+// EGL_PROFILE_CALL samples the current entrypoint from its location until
+// the end of its enclosing scope.
+#define EGL_PROFILE_CALL(entry) \
+    android::egl_profile::ScopedCall PASTE(___profiler, __LINE__) (android::egl_profile::entry)
+
 #else // !__ANDROID__
 
 #define ATRACE_NAME(...)
 #define ATRACE_CALL()
+#define EGL_PROFILE_CALL(...)
 
 #endif // __ANDROID__
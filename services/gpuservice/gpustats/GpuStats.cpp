@@ -26,6 +26,7 @@
 #include <statslog.h>
 #include <utils/Trace.h>
 
+#include <limits>
 #include <unordered_set>
 
 namespace android {
@@ -84,6 +85,60 @@ static void addLoadingTime(GpuStatsInfo::Driver driver, int64_t driverLoadingTim
     }
 }
 
+// Appends loading times from one record to another, respecting the per-record cap.
+static void appendLoadingTimes(const std::vector<int64_t>& from, std::vector<int64_t>* const to) {
+    for (const int64_t time : from) {
+        if (to->size() >= GpuStats::MAX_NUM_LOADING_TIMES) break;
+        to->emplace_back(time);
+    }
+}
+
+void GpuStats::touchAppRecordLocked(const std::string& appStatsKey) {
+    mAppStatsUsage[appStatsKey] = mAppStatsSeq++;
+}
+
+bool GpuStats::evictLruAppRecordLocked() {
+    auto victim = mAppStats.end();
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (auto it = mAppStats.begin(); it != mAppStats.end(); ++it) {
+        if (it->second.appPackageName == OVERFLOW_APP_NAME) continue;
+        const uint64_t seq = mAppStatsUsage[it->first];
+        if (seq < oldest) {
+            oldest = seq;
+            victim = it;
+        }
+    }
+    if (victim == mAppStats.end()) return false;
+
+    // Fold the evicted record into its driver's overflow record so churning
+    // short-lived processes degrade attribution rather than drop the samples.
+    const std::string overflowKey =
+            std::string(OVERFLOW_APP_NAME) + std::to_string(victim->second.driverVersionCode);
+    GpuStatsAppInfo& overflow = mAppStats[overflowKey];
+    if (overflow.appPackageName.empty()) {
+        overflow.appPackageName = OVERFLOW_APP_NAME;
+        overflow.driverVersionCode = victim->second.driverVersionCode;
+    }
+    appendLoadingTimes(victim->second.glDriverLoadingTime, &overflow.glDriverLoadingTime);
+    appendLoadingTimes(victim->second.vkDriverLoadingTime, &overflow.vkDriverLoadingTime);
+    appendLoadingTimes(victim->second.angleDriverLoadingTime, &overflow.angleDriverLoadingTime);
+    overflow.cpuVulkanInUse |= victim->second.cpuVulkanInUse;
+    overflow.falsePrerotation |= victim->second.falsePrerotation;
+    overflow.gles1InUse |= victim->second.gles1InUse;
+    touchAppRecordLocked(overflowKey);
+
+    mAppStatsUsage.erase(victim->first);
+    mAppStats.erase(victim);
+    mNumEvictedAppRecords++;
+    return true;
+}
+
+void GpuStats::clearAppStatsLocked() {
+    mAppStats.clear();
+    mAppStatsUsage.clear();
+    mNumEvictedAppRecords = 0;
+}
+
 void GpuStats::insertDriverStats(const std::string& driverPackageName,
                                  const std::string& driverVersionName, uint64_t driverVersionCode,
                                  int64_t driverBuildTime, const std::string& appPackageName,
@@ -91,8 +146,6 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
                                  bool isDriverLoaded, int64_t driverLoadingTime) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
-    registerStatsdCallbacksIfNeeded();
     ALOGV("Received:\n"
           "\tdriverPackageName[%s]\n"
           "\tdriverVersionName[%s]\n"
@@ -107,6 +160,13 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
           appPackageName.c_str(), vulkanVersion, static_cast<int32_t>(driver), isDriverLoaded,
           driverLoadingTime);
 
+    // Statsd registration and key construction stay outside the critical section:
+    // driver loads from every process in the system funnel into this method, so the
+    // lock should only cover the map updates themselves.
+    registerStatsdCallbacksIfNeeded();
+    const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
+
+    std::lock_guard<std::mutex> lock(mLock);
     if (!mGlobalStats.count(driverVersionCode)) {
         GpuStatsGlobalInfo globalInfo;
         addLoadingCount(driver, isDriverLoaded, &globalInfo);
@@ -120,11 +180,13 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
         addLoadingCount(driver, isDriverLoaded, &mGlobalStats[driverVersionCode]);
     }
 
-    const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
-    if (!mAppStats.count(appStatsKey)) {
-        if (mAppStats.size() >= MAX_NUM_APP_RECORDS) {
-            ALOGV("GpuStatsAppInfo has reached maximum size. Ignore new stats.");
-            return;
+    auto it = mAppStats.find(appStatsKey);
+    if (it == mAppStats.end()) {
+        while (mAppStats.size() >= MAX_NUM_APP_RECORDS) {
+            if (!evictLruAppRecordLocked()) {
+                ALOGV("GpuStatsAppInfo has reached maximum size. Ignore new stats.");
+                return;
+            }
         }
 
         GpuStatsAppInfo appInfo;
@@ -132,10 +194,10 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
         appInfo.appPackageName = appPackageName;
         appInfo.driverVersionCode = driverVersionCode;
         mAppStats.insert({appStatsKey, appInfo});
-        return;
+    } else {
+        addLoadingTime(driver, driverLoadingTime, &it->second);
     }
-
-    addLoadingTime(driver, driverLoadingTime, &mAppStats[appStatsKey]);
+    touchAppRecordLocked(appStatsKey);
 }
 
 void GpuStats::insertTargetStats(const std::string& appPackageName,
@@ -143,27 +205,29 @@ void GpuStats::insertTargetStats(const std::string& appPackageName,
                                  const uint64_t /*value*/) {
     ATRACE_CALL();
 
+    registerStatsdCallbacksIfNeeded();
     const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
 
     std::lock_guard<std::mutex> lock(mLock);
-    registerStatsdCallbacksIfNeeded();
-    if (!mAppStats.count(appStatsKey)) {
+    auto it = mAppStats.find(appStatsKey);
+    if (it == mAppStats.end()) {
         return;
     }
 
     switch (stats) {
         case GpuStatsInfo::Stats::CPU_VULKAN_IN_USE:
-            mAppStats[appStatsKey].cpuVulkanInUse = true;
+            it->second.cpuVulkanInUse = true;
             break;
         case GpuStatsInfo::Stats::FALSE_PREROTATION:
-            mAppStats[appStatsKey].falsePrerotation = true;
+            it->second.falsePrerotation = true;
             break;
         case GpuStatsInfo::Stats::GLES_1_IN_USE:
-            mAppStats[appStatsKey].gles1InUse = true;
+            it->second.gles1InUse = true;
             break;
         default:
             break;
     }
+    touchAppRecordLocked(appStatsKey);
 }
 
 void GpuStats::interceptSystemDriverStatsLocked() {
@@ -177,12 +241,11 @@ void GpuStats::interceptSystemDriverStatsLocked() {
 }
 
 void GpuStats::registerStatsdCallbacksIfNeeded() {
-    if (!mStatsdRegistered) {
+    if (!mStatsdRegistered.exchange(true)) {
         AStatsManager_setPullAtomCallback(android::util::GPU_STATS_GLOBAL_INFO, nullptr,
                                          GpuStats::pullAtomCallback, this);
         AStatsManager_setPullAtomCallback(android::util::GPU_STATS_APP_INFO, nullptr,
                                          GpuStats::pullAtomCallback, this);
-        mStatsdRegistered = true;
     }
 }
 
@@ -228,13 +291,13 @@ void GpuStats::dump(const Vector<String16>& args, std::string* result) {
         }
 
         if (dumpApp) {
-            mAppStats.clear();
+            clearAppStatsLocked();
             clearAll = false;
         }
 
         if (clearAll) {
             mGlobalStats.clear();
-            mAppStats.clear();
+            clearAppStatsLocked();
         }
     }
 }
@@ -253,6 +316,10 @@ void GpuStats::dumpAppLocked(std::string* result) {
         result->append(ele.second.toString());
         result->append("\n");
     }
+    if (mNumEvictedAppRecords) {
+        result->append("appRecordsEvicted = " + std::to_string(mNumEvictedAppRecords));
+        result->append("\n");
+    }
 }
 
 static std::string protoOutputStreamToByteString(android::util::ProtoOutputStream& proto) {
@@ -312,7 +379,7 @@ AStatsManager_PullAtomCallbackReturn GpuStats::pullAppInfoAtom(AStatsEventList*
         }
     }
 
-    mAppStats.clear();
+    clearAppStatsLocked();
 
     return AStatsManager_PULL_SUCCESS;
 }
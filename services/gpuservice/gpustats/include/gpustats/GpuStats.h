@@ -22,6 +22,7 @@
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
 #include <vector>
@@ -46,6 +47,9 @@ public:
 
     // This limits the worst case number of loading times tracked.
     static const size_t MAX_NUM_LOADING_TIMES = 50;
+    // Synthetic package name of the per-driver record that evicted app records are
+    // folded into.
+    static constexpr char OVERFLOW_APP_NAME[] = "<overflow>";
 
 private:
     // Friend class for testing.
@@ -67,18 +71,32 @@ private:
     void interceptSystemDriverStatsLocked();
     // Registers statsd callbacks if they have not already been registered
     void registerStatsdCallbacksIfNeeded();
+    // Marks an app record as most recently used for LRU eviction.
+    void touchAppRecordLocked(const std::string& appStatsKey);
+    // Folds the least recently used app record into its driver's overflow record
+    // and erases it. Returns false when only overflow records are left.
+    bool evictLruAppRecordLocked();
+    // Drops all app records together with their LRU bookkeeping.
+    void clearAppStatsLocked();
 
     // Below limits the memory usage of GpuStats to be less than 10KB. This is
     // the preferred number for statsd while maintaining nice data quality.
     static const size_t MAX_NUM_APP_RECORDS = 100;
     // GpuStats access should be guarded by mLock.
     std::mutex mLock;
-    // True if statsd callbacks have been registered.
-    bool mStatsdRegistered = false;
+    // True if statsd callbacks have been registered. Atomic so the hot insert
+    // paths can skip the registration branch without taking mLock.
+    std::atomic<bool> mStatsdRegistered = false;
     // Key is driver version code.
     std::unordered_map<uint64_t, GpuStatsGlobalInfo> mGlobalStats;
     // Key is <app package name>+<driver version code>.
     std::unordered_map<std::string, GpuStatsAppInfo> mAppStats;
+    // Last-use sequence number per mAppStats key, used to pick LRU eviction
+    // victims once MAX_NUM_APP_RECORDS is reached.
+    std::unordered_map<std::string, uint64_t> mAppStatsUsage;
+    uint64_t mAppStatsSeq = 0;
+    // Number of app records folded into overflow records since the last clear.
+    uint64_t mNumEvictedAppRecords = 0;
 };
 
 } // namespace android
@@ -179,6 +179,28 @@ TEST_F(GpuStatsTest, canInsertAngleDriverStats) {
     EXPECT_THAT(inputCommand(InputCommand::DUMP_APP), HasSubstr(expectedResult));
 }
 
+TEST_F(GpuStatsTest, evictsLruAppRecordIntoOverflow) {
+    // One more app than the record cap: the least recently used record (the first
+    // one inserted) must be folded into the overflow record instead of the new
+    // stats being dropped.
+    TestableGpuStats testableGpuStats(mGpuStats.get());
+    for (size_t i = 0; i <= testableGpuStats.getMaxNumAppRecords(); i++) {
+        const std::string appName = "evict" + std::to_string(i);
+        mGpuStats->insertDriverStats(BUILTIN_DRIVER_PKG_NAME, BUILTIN_DRIVER_VER_NAME,
+                                     BUILTIN_DRIVER_VER_CODE, BUILTIN_DRIVER_BUILD_TIME,
+                                     appName, VULKAN_VERSION, GpuStatsInfo::Driver::GL, true,
+                                     DRIVER_LOADING_TIME_1);
+    }
+
+    const std::string dump = inputCommand(InputCommand::DUMP_APP);
+    EXPECT_THAT(dump, HasSubstr("appPackageName = <overflow>"));
+    EXPECT_THAT(dump, HasSubstr("appRecordsEvicted = 1"));
+    EXPECT_THAT(dump, testing::Not(HasSubstr("appPackageName = evict0")));
+    const std::string lastApp =
+            "evict" + std::to_string(testableGpuStats.getMaxNumAppRecords());
+    EXPECT_THAT(dump, HasSubstr("appPackageName = " + lastApp));
+}
+
 TEST_F(GpuStatsTest, canDump3dApiVersion) {
     mGpuStats->insertDriverStats(BUILTIN_DRIVER_PKG_NAME, BUILTIN_DRIVER_VER_NAME,
                                  BUILTIN_DRIVER_VER_CODE, BUILTIN_DRIVER_BUILD_TIME, APP_PKG_NAME_1,
@@ -29,6 +29,8 @@ public:
         return mGpuStats->pullAtomCallback(atomTag, nullptr, mGpuStats);
     }
 
+    size_t getMaxNumAppRecords() const { return GpuStats::MAX_NUM_APP_RECORDS; }
+
 private:
     GpuStats *mGpuStats;
 };
@@ -0,0 +1,349 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <binder/Binder.h>
+#include <input/DisplayViewport.h>
+#include <input/InputApplication.h>
+#include <input/InputTransport.h>
+#include <input/InputWindow.h>
+
+#include "../dispatcher/include/InputDispatcherFactory.h"
+#include "../include/InputListener.h"
+#include "../include/InputReaderBase.h"
+#include "../include/InputReaderFactory.h"
+#include "UinputDevice.h"
+
+using namespace std::chrono_literals;
+
+// End-to-end latency of the full evdev -> InputReader -> InputDispatcher ->
+// InputConsumer pipeline, fed by a synthetic uinput touch screen. Unlike
+// InputDispatcher_benchmarks, which injects NotifyMotionArgs directly into
+// the dispatcher, this exercises EventHub and the touch mappers as well, so
+// the numbers cover everything between the kernel timestamping an event and
+// an app consuming it. Must run as root to open /dev/uinput.
+
+namespace android {
+
+// An arbitrary pid / uid pair for the fake window.
+static constexpr int32_t WINDOW_PID = 999;
+static constexpr int32_t WINDOW_UID = 1001;
+
+static constexpr std::chrono::nanoseconds DISPATCHING_TIMEOUT = 100ms;
+static constexpr std::chrono::milliseconds CONSUME_TIMEOUT = 1000ms;
+
+static constexpr int32_t DISPLAY_WIDTH = 800;
+static constexpr int32_t DISPLAY_HEIGHT = 800;
+
+static nsecs_t now() {
+    return systemTime(SYSTEM_TIME_MONOTONIC);
+}
+
+// --- FakeReaderPolicy ---
+
+class FakeReaderPolicy : public InputReaderPolicyInterface {
+public:
+    void getReaderConfiguration(InputReaderConfiguration* outConfig) override {
+        DisplayViewport viewport;
+        viewport.displayId = ADISPLAY_ID_DEFAULT;
+        viewport.logicalRight = DISPLAY_WIDTH;
+        viewport.logicalBottom = DISPLAY_HEIGHT;
+        viewport.physicalRight = DISPLAY_WIDTH;
+        viewport.physicalBottom = DISPLAY_HEIGHT;
+        viewport.deviceWidth = DISPLAY_WIDTH;
+        viewport.deviceHeight = DISPLAY_HEIGHT;
+        viewport.isActive = true;
+        viewport.uniqueId = "local:0";
+        viewport.type = ViewportType::VIEWPORT_INTERNAL;
+        outConfig->setDisplayViewports({viewport});
+    }
+
+    sp<PointerControllerInterface> obtainPointerController(int32_t) override { return nullptr; }
+
+    void notifyInputDevicesChanged(const std::vector<InputDeviceInfo>&) override {}
+
+    sp<KeyCharacterMap> getKeyboardLayoutOverlay(const InputDeviceIdentifier&) override {
+        return nullptr;
+    }
+
+    std::string getDeviceAlias(const InputDeviceIdentifier&) override { return ""; }
+
+    TouchAffineTransformation getTouchAffineTransformation(const std::string&, int32_t) override {
+        return TouchAffineTransformation();
+    }
+};
+
+// --- FakeDispatcherPolicy ---
+
+class FakeDispatcherPolicy : public InputDispatcherPolicyInterface {
+public:
+    FakeDispatcherPolicy() {}
+
+protected:
+    virtual ~FakeDispatcherPolicy() {}
+
+private:
+    void notifyConfigurationChanged(nsecs_t) override {}
+
+    nsecs_t notifyAnr(const sp<InputApplicationHandle>&, const sp<IBinder>&,
+                      const std::string& name) override {
+        ALOGE("The window is not responding : %s", name.c_str());
+        return 0;
+    }
+
+    void notifyInputChannelBroken(const sp<IBinder>&) override {}
+
+    void notifyFocusChanged(const sp<IBinder>&, const sp<IBinder>&) override {}
+
+    void getDispatcherConfiguration(InputDispatcherConfiguration* outConfig) override {
+        *outConfig = mConfig;
+    }
+
+    bool filterInputEvent(const InputEvent*, uint32_t) override { return true; }
+
+    void interceptKeyBeforeQueueing(const KeyEvent*, uint32_t&) override {}
+
+    void interceptMotionBeforeQueueing(int32_t, nsecs_t, uint32_t&) override {}
+
+    nsecs_t interceptKeyBeforeDispatching(const sp<IBinder>&, const KeyEvent*, uint32_t) override {
+        return 0;
+    }
+
+    bool dispatchUnhandledKey(const sp<IBinder>&, const KeyEvent*, uint32_t, KeyEvent*) override {
+        return false;
+    }
+
+    void notifySwitch(nsecs_t, uint32_t, uint32_t, uint32_t) override {}
+
+    void pokeUserActivity(nsecs_t, int32_t) override {}
+
+    bool checkInjectEventsPermissionNonReentrant(int32_t, int32_t) override { return false; }
+
+    void onPointerDownOutsideFocus(const sp<IBinder>&) override {}
+
+    InputDispatcherConfiguration mConfig;
+};
+
+// --- LatencyRecordingListener ---
+
+// Sits between InputReader and InputDispatcher, in the spot InputClassifier
+// occupies in production, and records how old each NotifyMotionArgs already
+// is when the reader publishes it. This splits the end-to-end number into
+// its reader and dispatcher halves.
+class LatencyRecordingListener : public InputListenerInterface {
+public:
+    explicit LatencyRecordingListener(const sp<InputDispatcherInterface>& dispatcher)
+          : mDispatcher(dispatcher) {}
+
+    void notifyConfigurationChanged(const NotifyConfigurationChangedArgs* args) override {
+        mDispatcher->notifyConfigurationChanged(args);
+    }
+
+    void notifyKey(const NotifyKeyArgs* args) override { mDispatcher->notifyKey(args); }
+
+    void notifyMotion(const NotifyMotionArgs* args) override {
+        mReaderLatencies.push_back(now() - args->eventTime);
+        mDispatcher->notifyMotion(args);
+    }
+
+    void notifySwitch(const NotifySwitchArgs* args) override { mDispatcher->notifySwitch(args); }
+
+    void notifyDeviceReset(const NotifyDeviceResetArgs* args) override {
+        mDispatcher->notifyDeviceReset(args);
+    }
+
+    std::vector<nsecs_t> mReaderLatencies;
+
+private:
+    sp<InputDispatcherInterface> mDispatcher;
+};
+
+// --- FakeApplication ---
+
+class FakeApplication : public InputApplicationHandle {
+public:
+    bool updateInfo() override {
+        mInfo.dispatchingTimeout = DISPATCHING_TIMEOUT.count();
+        return true;
+    }
+};
+
+// --- FakeWindow ---
+
+class FakeWindow : public InputWindowHandle {
+public:
+    FakeWindow(const sp<InputApplicationHandle>& inputApplicationHandle,
+               const sp<InputDispatcherInterface>& dispatcher)
+          : mFrame(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT) {
+        InputChannel::openInputChannelPair("FakeWindow", mServerChannel, mClientChannel);
+        mConsumer = std::make_unique<InputConsumer>(mClientChannel);
+        dispatcher->registerInputChannel(mServerChannel);
+
+        inputApplicationHandle->updateInfo();
+        mInfo.applicationInfo = *inputApplicationHandle->getInfo();
+    }
+
+    bool updateInfo() override {
+        mInfo.token = mServerChannel->getConnectionToken();
+        mInfo.name = "FakeWindow";
+        mInfo.layoutParamsFlags = 0;
+        mInfo.layoutParamsType = InputWindowInfo::TYPE_APPLICATION;
+        mInfo.dispatchingTimeout = DISPATCHING_TIMEOUT.count();
+        mInfo.frameLeft = mFrame.left;
+        mInfo.frameTop = mFrame.top;
+        mInfo.frameRight = mFrame.right;
+        mInfo.frameBottom = mFrame.bottom;
+        mInfo.globalScaleFactor = 1.0;
+        mInfo.touchableRegion.clear();
+        mInfo.addTouchableRegion(mFrame);
+        mInfo.visible = true;
+        mInfo.canReceiveKeys = true;
+        mInfo.hasFocus = true;
+        mInfo.hasWallpaper = false;
+        mInfo.paused = false;
+        mInfo.ownerPid = WINDOW_PID;
+        mInfo.ownerUid = WINDOW_UID;
+        mInfo.inputFeatures = 0;
+        mInfo.displayId = ADISPLAY_ID_DEFAULT;
+
+        return true;
+    }
+
+    // Consumes one event and returns its age relative to the evdev
+    // timestamp, or -1 on timeout.
+    nsecs_t consumeEvent() {
+        uint32_t consumeSeq;
+        InputEvent* event;
+
+        std::chrono::time_point start = std::chrono::steady_clock::now();
+        status_t result = WOULD_BLOCK;
+        while (result == WOULD_BLOCK) {
+            if (std::chrono::steady_clock::now() - start > CONSUME_TIMEOUT) {
+                return -1;
+            }
+            result = mConsumer->consume(&mEventFactory, true /*consumeBatches*/, -1, &consumeSeq,
+                                        &event);
+        }
+        if (result != OK) {
+            ALOGE("Received result = %d from consume()", result);
+            return -1;
+        }
+        const nsecs_t latency = now() - event->getEventTime();
+        result = mConsumer->sendFinishedSignal(consumeSeq, true);
+        if (result != OK) {
+            ALOGE("Received result = %d from sendFinishedSignal", result);
+        }
+        return latency;
+    }
+
+private:
+    Rect mFrame;
+    sp<InputChannel> mServerChannel, mClientChannel;
+    std::unique_ptr<InputConsumer> mConsumer;
+    PreallocatedInputEventFactory mEventFactory;
+};
+
+static void reportPercentiles(benchmark::State& state, const std::string& prefix,
+                              std::vector<nsecs_t> latencies) {
+    if (latencies.empty()) {
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&](double p) {
+        return double(latencies[size_t(p * (latencies.size() - 1))]) * 1E-3; // us
+    };
+    state.counters[prefix + "P50us"] = benchmark::Counter(percentile(0.50));
+    state.counters[prefix + "P95us"] = benchmark::Counter(percentile(0.95));
+    state.counters[prefix + "P99us"] = benchmark::Counter(percentile(0.99));
+}
+
+static void benchmarkEvdevToConsumerLatency(benchmark::State& state) {
+    if (getuid() != 0) {
+        state.SkipWithError("must run as root to open /dev/uinput");
+        return;
+    }
+
+    sp<FakeDispatcherPolicy> dispatcherPolicy = new FakeDispatcherPolicy();
+    sp<InputDispatcherInterface> dispatcher = createInputDispatcher(dispatcherPolicy);
+    dispatcher->setInputDispatchMode(/*enabled*/ true, /*frozen*/ false);
+    dispatcher->start();
+
+    sp<LatencyRecordingListener> listener = new LatencyRecordingListener(dispatcher);
+    sp<FakeReaderPolicy> readerPolicy = new FakeReaderPolicy();
+    sp<InputReaderInterface> reader = createInputReader(readerPolicy, listener);
+    reader->start();
+
+    sp<InputApplicationHandle> application = new FakeApplication();
+    sp<FakeWindow> window = new FakeWindow(application, dispatcher);
+    dispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, {window}}});
+
+    std::unique_ptr<UinputTouchScreen> touchScreen =
+            createUinputDevice<UinputTouchScreen>(Rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT));
+    const Point center = touchScreen->getCenterPoint();
+
+    // Wait for EventHub to pick up the new device: keep tapping until an
+    // event makes it through the pipeline.
+    nsecs_t latency = -1;
+    for (int i = 0; i < 20 && latency < 0; i++) {
+        touchScreen->sendSlot(0);
+        touchScreen->sendTrackingId(i);
+        touchScreen->sendDown(center);
+        touchScreen->sendUp();
+        latency = window->consumeEvent();
+        if (latency >= 0) {
+            window->consumeEvent(); // matching up event
+        }
+    }
+    if (latency < 0) {
+        state.SkipWithError("synthetic touch events never reached the consumer");
+        return;
+    }
+    listener->mReaderLatencies.clear();
+
+    std::vector<nsecs_t> endToEndLatencies;
+    int32_t trackingId = 100;
+    for (auto _ : state) {
+        touchScreen->sendSlot(0);
+        touchScreen->sendTrackingId(trackingId++);
+        touchScreen->sendDown(center);
+        touchScreen->sendUp();
+
+        const nsecs_t downLatency = window->consumeEvent();
+        const nsecs_t upLatency = window->consumeEvent();
+        if (downLatency < 0 || upLatency < 0) {
+            state.SkipWithError("timed out waiting for a touch event");
+            break;
+        }
+        endToEndLatencies.push_back(downLatency);
+        endToEndLatencies.push_back(upLatency);
+    }
+
+    reportPercentiles(state, "endToEnd", std::move(endToEndLatencies));
+    reportPercentiles(state, "reader", std::move(listener->mReaderLatencies));
+
+    reader->stop();
+    dispatcher->stop();
+}
+
+BENCHMARK(benchmarkEvdevToConsumerLatency);
+
+} // namespace android
@@ -23,11 +23,69 @@
 #include <cutils/atomic.h>
 #include <inttypes.h>
 
+#include <mutex>
+#include <new>
+
 using android::base::GetBoolProperty;
 using android::base::StringPrintf;
 
 namespace android::inputdispatcher {
 
+namespace {
+
+/**
+ * A thread-safe freelist of fixed-size storage blocks.  Entries are allocated on the
+ * threads that feed the dispatcher and destroyed on the dispatcher thread, so the
+ * freelist is shared and guarded by a mutex; the critical section is a single pointer
+ * swap, which is still far cheaper than a round trip through the allocator.  The pool
+ * is bounded so that a burst of events cannot permanently pin memory.
+ */
+template <size_t kBlockSize, size_t kMaxBlocks>
+class EntryPool {
+public:
+    void* alloc() {
+        {
+            std::scoped_lock lock(mMutex);
+            if (mHead != nullptr) {
+                FreeBlock* block = mHead;
+                mHead = block->next;
+                mNumBlocks--;
+                return block;
+            }
+        }
+        return ::operator new(kBlockSize);
+    }
+
+    void free(void* ptr) {
+        {
+            std::scoped_lock lock(mMutex);
+            if (mNumBlocks < kMaxBlocks) {
+                FreeBlock* block = static_cast<FreeBlock*>(ptr);
+                block->next = mHead;
+                mHead = block;
+                mNumBlocks++;
+                return;
+            }
+        }
+        ::operator delete(ptr);
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    std::mutex mMutex;
+    FreeBlock* mHead = nullptr;
+    size_t mNumBlocks = 0;
+};
+
+EntryPool<sizeof(KeyEntry), 32> gKeyEntryPool;
+EntryPool<sizeof(MotionEntry), 32> gMotionEntryPool;
+EntryPool<sizeof(DispatchEntry), 128> gDispatchEntryPool;
+
+} // namespace
+
 VerifiedKeyEvent verifiedKeyEventFromKeyEntry(const KeyEntry& entry) {
     return {{VerifiedInputEvent::Type::KEY, entry.deviceId, entry.eventTime, entry.source,
              entry.displayId},
@@ -172,6 +230,21 @@ void KeyEntry::recycle() {
     interceptKeyWakeupTime = 0;
 }
 
+void* KeyEntry::operator new(size_t size) {
+    if (size != sizeof(KeyEntry)) {
+        return ::operator new(size);
+    }
+    return gKeyEntryPool.alloc();
+}
+
+void KeyEntry::operator delete(void* ptr, size_t size) {
+    if (size != sizeof(KeyEntry)) {
+        ::operator delete(ptr);
+        return;
+    }
+    gKeyEntryPool.free(ptr);
+}
+
 // --- MotionEntry ---
 
 MotionEntry::MotionEntry(int32_t id, nsecs_t eventTime, int32_t deviceId, uint32_t source,
@@ -236,6 +309,21 @@ void MotionEntry::appendDescription(std::string& msg) const {
     msg += StringPrintf("]), policyFlags=0x%08x", policyFlags);
 }
 
+void* MotionEntry::operator new(size_t size) {
+    if (size != sizeof(MotionEntry)) {
+        return ::operator new(size);
+    }
+    return gMotionEntryPool.alloc();
+}
+
+void MotionEntry::operator delete(void* ptr, size_t size) {
+    if (size != sizeof(MotionEntry)) {
+        ::operator delete(ptr);
+        return;
+    }
+    gMotionEntryPool.free(ptr);
+}
+
 // --- DispatchEntry ---
 
 volatile int32_t DispatchEntry::sNextSeqAtomic;
@@ -270,6 +358,21 @@ uint32_t DispatchEntry::nextSeq() {
     return seq;
 }
 
+void* DispatchEntry::operator new(size_t size) {
+    if (size != sizeof(DispatchEntry)) {
+        return ::operator new(size);
+    }
+    return gDispatchEntryPool.alloc();
+}
+
+void DispatchEntry::operator delete(void* ptr, size_t size) {
+    if (size != sizeof(DispatchEntry)) {
+        ::operator delete(ptr);
+        return;
+    }
+    gDispatchEntryPool.free(ptr);
+}
+
 // --- CommandEntry ---
 
 CommandEntry::CommandEntry(Command command)
@@ -22,6 +22,7 @@
 
 #include <input/Input.h>
 #include <input/InputApplication.h>
+#include <input/InputTransport.h>
 #include <stdint.h>
 #include <utils/Timers.h>
 #include <functional>
@@ -149,6 +150,11 @@ struct KeyEntry : EventEntry {
     virtual void appendDescription(std::string& msg) const;
     void recycle();
 
+    // Key entries are created and destroyed for every key event; draw their storage from
+    // a freelist to keep the allocator off the dispatch hot path.
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+
 protected:
     virtual ~KeyEntry();
 };
@@ -173,6 +179,10 @@ struct MotionEntry : EventEntry {
     uint32_t pointerCount;
     PointerProperties pointerProperties[MAX_POINTERS];
     PointerCoords pointerCoords[MAX_POINTERS];
+    // Computed once by the dispatcher before the entry is published to its
+    // targets, so every client receives the same velocity/prediction instead
+    // of re-deriving it. Invalid (default) for non-touch streams.
+    PointerComputedState computedStates[MAX_POINTERS];
 
     MotionEntry(int32_t id, nsecs_t eventTime, int32_t deviceId, uint32_t source, int32_t displayId,
                 uint32_t policyFlags, int32_t action, int32_t actionButton, int32_t flags,
@@ -183,6 +193,11 @@ struct MotionEntry : EventEntry {
                 float xOffset, float yOffset);
     virtual void appendDescription(std::string& msg) const;
 
+    // Motion entries are created and destroyed for every motion event; draw their storage
+    // from a freelist to keep the allocator off the dispatch hot path.
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+
 protected:
     virtual ~MotionEntry();
 };
@@ -217,6 +232,11 @@ struct DispatchEntry {
 
     inline bool isSplit() const { return targetFlags & InputTarget::FLAG_SPLIT; }
 
+    // A dispatch entry is created per target for every dispatched event; draw their storage
+    // from a freelist to keep the allocator off the dispatch hot path.
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr, size_t size);
+
 private:
     static volatile int32_t sNextSeqAtomic;
 
@@ -26,6 +26,7 @@ InjectionState::InjectionState(int32_t injectorPid, int32_t injectorUid)
         injectorUid(injectorUid),
         injectionResult(INPUT_EVENT_INJECTION_PENDING),
         injectionIsAsync(false),
+        preAuthorized(false),
         pendingForegroundDispatches(0) {}
 
 InjectionState::~InjectionState() {}
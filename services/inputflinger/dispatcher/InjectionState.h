@@ -46,6 +46,8 @@ struct InjectionState {
     int32_t injectorUid;
     int32_t injectionResult;             // initially INPUT_EVENT_INJECTION_PENDING
     bool injectionIsAsync;               // set to true if injection is not waiting for the result
+    bool preAuthorized;                  // the injector was validated once at registration, so
+                                         // per-event permission checks are skipped
     int32_t pendingForegroundDispatches; // the number of foreground dispatches in progress
 
     InjectionState(int32_t injectorPid, int32_t injectorUid);
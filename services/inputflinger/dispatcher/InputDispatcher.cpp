@@ -54,6 +54,7 @@ static constexpr bool DEBUG_FOCUS = false;
 #include <stddef.h>
 #include <time.h>
 #include <unistd.h>
+#include <limits>
 #include <queue>
 #include <sstream>
 
@@ -835,43 +836,49 @@ sp<InputWindowHandle> InputDispatcher::findTouchedWindowAtLocked(int32_t display
         LOG_ALWAYS_FATAL(
                 "Must provide a valid touch state if adding portal windows or outside targets");
     }
-    // Traverse windows from front to back to find touched window.
-    const std::vector<sp<InputWindowHandle>> windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<InputWindowHandle>& windowHandle : windowHandles) {
-        const InputWindowInfo* windowInfo = windowHandle->getInfo();
-        if (windowInfo->displayId == displayId) {
-            int32_t flags = windowInfo->layoutParamsFlags;
-
-            if (windowInfo->visible) {
-                if (!(flags & InputWindowInfo::FLAG_NOT_TOUCHABLE)) {
-                    bool isTouchModal = (flags &
-                                         (InputWindowInfo::FLAG_NOT_FOCUSABLE |
-                                          InputWindowInfo::FLAG_NOT_TOUCH_MODAL)) == 0;
-                    if (isTouchModal || windowInfo->touchableRegionContainsPoint(x, y)) {
-                        int32_t portalToDisplayId = windowInfo->portalToDisplayId;
-                        if (portalToDisplayId != ADISPLAY_ID_NONE &&
-                            portalToDisplayId != displayId) {
-                            if (addPortalWindows) {
-                                // For the monitoring channels of the display.
-                                touchState->addPortalWindow(windowHandle);
-                            }
-                            return findTouchedWindowAtLocked(portalToDisplayId, x, y, touchState,
-                                                             addOutsideTargets, addPortalWindows);
-                        }
-                        // Found window.
-                        return windowHandle;
-                    }
-                }
+    auto indexIt = mWindowHitIndexByDisplay.find(displayId);
+    if (indexIt == mWindowHitIndexByDisplay.end()) {
+        return nullptr;
+    }
+    const WindowHitIndex& index = indexIt->second;
+
+    // Ask the spatial index for the windows near (x, y) instead of walking the
+    // display's full window list; the candidates come back front to back.
+    sp<InputWindowHandle> touchedWindow;
+    size_t touchedOrder = std::numeric_limits<size_t>::max();
+    for (const WindowHitIndex::Candidate& candidate : index.candidatesAt(x, y)) {
+        if (candidate.touchModal ||
+            candidate.window->getInfo()->touchableRegionContainsPoint(x, y)) {
+            touchedWindow = candidate.window;
+            touchedOrder = candidate.order;
+            break;
+        }
+    }
 
-                if (addOutsideTargets && (flags & InputWindowInfo::FLAG_WATCH_OUTSIDE_TOUCH)) {
-                    touchState->addOrUpdateWindow(windowHandle,
-                                                  InputTarget::FLAG_DISPATCH_AS_OUTSIDE,
-                                                  BitSet32(0));
-                }
+    if (addOutsideTargets) {
+        // Watchers in front of the touched window (all of them if nothing was
+        // touched) are dispatched the touch as an outside event.
+        for (const WindowHitIndex::Candidate& watcher : index.outsideWatchers()) {
+            if (watcher.order >= touchedOrder) {
+                break;
             }
+            touchState->addOrUpdateWindow(watcher.window, InputTarget::FLAG_DISPATCH_AS_OUTSIDE,
+                                          BitSet32(0));
         }
     }
-    return nullptr;
+
+    if (touchedWindow != nullptr) {
+        int32_t portalToDisplayId = touchedWindow->getInfo()->portalToDisplayId;
+        if (portalToDisplayId != ADISPLAY_ID_NONE && portalToDisplayId != displayId) {
+            if (addPortalWindows) {
+                // For the monitoring channels of the display.
+                touchState->addPortalWindow(touchedWindow);
+            }
+            return findTouchedWindowAtLocked(portalToDisplayId, x, y, touchState,
+                                             addOutsideTargets, addPortalWindows);
+        }
+    }
+    return touchedWindow;
 }
 
 std::vector<TouchedMonitor> InputDispatcher::findTouchedGestureMonitorsLocked(
@@ -1264,6 +1271,7 @@ bool InputDispatcher::dispatchMotionLocked(nsecs_t currentTime, MotionEntry* ent
     if (!entry->dispatchInProgress) {
         entry->dispatchInProgress = true;
 
+        updateComputedStatesLocked(entry);
         logOutboundMotionDetails("dispatchMotion - ", *entry);
     }
 
@@ -1340,6 +1348,56 @@ bool InputDispatcher::dispatchMotionLocked(nsecs_t currentTime, MotionEntry* ent
     return true;
 }
 
+void InputDispatcher::updateComputedStatesLocked(MotionEntry* entry) {
+    if (!(entry->source & AINPUT_SOURCE_CLASS_POINTER)) {
+        return;
+    }
+
+    std::unique_ptr<VelocityTracker>& trackerPtr = mVelocityTrackers[entry->deviceId];
+    if (trackerPtr == nullptr) {
+        trackerPtr = std::make_unique<VelocityTracker>();
+    }
+    VelocityTracker& tracker = *trackerPtr;
+    const int32_t actionMasked = entry->action & AMOTION_EVENT_ACTION_MASK;
+    if (actionMasked == AMOTION_EVENT_ACTION_DOWN) {
+        tracker.clear();
+    }
+
+    BitSet32 idBits;
+    for (uint32_t i = 0; i < entry->pointerCount; i++) {
+        idBits.markBit(entry->pointerProperties[i].id);
+    }
+    // VelocityTracker expects positions indexed by the rank of the pointer id
+    // in idBits, not by the event's pointer index.
+    VelocityTracker::Position positions[MAX_POINTERS];
+    for (uint32_t i = 0; i < entry->pointerCount; i++) {
+        const uint32_t index = idBits.getIndexOfBit(entry->pointerProperties[i].id);
+        positions[index].x = entry->pointerCoords[i].getAxisValue(AMOTION_EVENT_AXIS_X);
+        positions[index].y = entry->pointerCoords[i].getAxisValue(AMOTION_EVENT_AXIS_Y);
+    }
+    tracker.addMovement(entry->eventTime, idBits, positions);
+
+    // Extrapolate one 60Hz frame ahead of the latest sample.
+    constexpr float kPredictionAheadSeconds = 0.0166667f;
+    for (uint32_t i = 0; i < entry->pointerCount; i++) {
+        float vx, vy;
+        if (tracker.getVelocity(entry->pointerProperties[i].id, &vx, &vy)) {
+            PointerComputedState& state = entry->computedStates[i];
+            state.valid = true;
+            state.velocityX = vx;
+            state.velocityY = vy;
+            state.predictedX = entry->pointerCoords[i].getAxisValue(AMOTION_EVENT_AXIS_X) +
+                    vx * kPredictionAheadSeconds;
+            state.predictedY = entry->pointerCoords[i].getAxisValue(AMOTION_EVENT_AXIS_Y) +
+                    vy * kPredictionAheadSeconds;
+        }
+    }
+
+    if (actionMasked == AMOTION_EVENT_ACTION_UP || actionMasked == AMOTION_EVENT_ACTION_CANCEL) {
+        mVelocityTrackers.erase(entry->deviceId);
+    }
+}
+
 void InputDispatcher::logOutboundMotionDetails(const char* prefix, const MotionEntry& entry) {
 #if DEBUG_OUTBOUND_EVENT_DETAILS
     ALOGD("%seventTime=%" PRId64 ", deviceId=%d, source=0x%x, displayId=%" PRId32
@@ -1909,9 +1967,8 @@ int32_t InputDispatcher::findTouchedWindowTargetsLocked(nsecs_t currentTime,
         sp<InputWindowHandle> foregroundWindowHandle =
                 tempTouchState.getFirstForegroundWindowHandle();
         if (foregroundWindowHandle && foregroundWindowHandle->getInfo()->hasWallpaper) {
-            const std::vector<sp<InputWindowHandle>> windowHandles =
-                    getWindowHandlesLocked(displayId);
-            for (const sp<InputWindowHandle>& windowHandle : windowHandles) {
+            const auto windowHandles = getWindowHandlesLocked(displayId);
+            for (const sp<InputWindowHandle>& windowHandle : *windowHandles) {
                 const InputWindowInfo* info = windowHandle->getInfo();
                 if (info->displayId == displayId &&
                     windowHandle->getInfo()->layoutParamsType == InputWindowInfo::TYPE_WALLPAPER) {
@@ -2091,6 +2148,9 @@ void InputDispatcher::addMonitoringTargetLocked(const Monitor& monitor, float xO
 
 bool InputDispatcher::checkInjectionPermission(const sp<InputWindowHandle>& windowHandle,
                                                const InjectionState* injectionState) {
+    if (injectionState && injectionState->preAuthorized) {
+        return true;
+    }
     if (injectionState &&
         (windowHandle == nullptr ||
          windowHandle->getInfo()->ownerUid != injectionState->injectorUid) &&
@@ -2139,8 +2199,8 @@ static bool canBeObscuredBy(const sp<InputWindowHandle>& windowHandle,
 bool InputDispatcher::isWindowObscuredAtPointLocked(const sp<InputWindowHandle>& windowHandle,
                                                     int32_t x, int32_t y) const {
     int32_t displayId = windowHandle->getInfo()->displayId;
-    const std::vector<sp<InputWindowHandle>> windowHandles = getWindowHandlesLocked(displayId);
-    for (const sp<InputWindowHandle>& otherHandle : windowHandles) {
+    const auto windowHandles = getWindowHandlesLocked(displayId);
+    for (const sp<InputWindowHandle>& otherHandle : *windowHandles) {
         if (windowHandle == otherHandle) {
             break; // All future windows are below us. Exit early.
         }
@@ -2155,9 +2215,9 @@ bool InputDispatcher::isWindowObscuredAtPointLocked(const sp<InputWindowHandle>&
 
 bool InputDispatcher::isWindowObscuredLocked(const sp<InputWindowHandle>& windowHandle) const {
     int32_t displayId = windowHandle->getInfo()->displayId;
-    const std::vector<sp<InputWindowHandle>> windowHandles = getWindowHandlesLocked(displayId);
+    const auto windowHandles = getWindowHandlesLocked(displayId);
     const InputWindowInfo* windowInfo = windowHandle->getInfo();
-    for (const sp<InputWindowHandle>& otherHandle : windowHandles) {
+    for (const sp<InputWindowHandle>& otherHandle : *windowHandles) {
         if (windowHandle == otherHandle) {
             break; // All future windows are below us. Exit early.
         }
@@ -2586,7 +2646,8 @@ void InputDispatcher::startDispatchCycleLocked(nsecs_t currentTime,
                                                      motionEntry->yCursorPosition,
                                                      motionEntry->downTime, motionEntry->eventTime,
                                                      motionEntry->pointerCount,
-                                                     motionEntry->pointerProperties, usingCoords);
+                                                     motionEntry->pointerProperties, usingCoords,
+                                                     motionEntry->computedStates);
                 reportTouchEventForStatistics(*motionEntry);
                 break;
             }
@@ -3318,8 +3379,16 @@ int32_t InputDispatcher::injectInputEvent(const InputEvent* event, int32_t injec
 
     nsecs_t endTime = now() + std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
 
+    const bool preAuthorized = isPreAuthorizedInjector(injectorPid, injectorUid);
+
     policyFlags |= POLICY_FLAG_INJECTED;
-    if (hasInjectionPermission(injectorPid, injectorUid)) {
+    if (preAuthorized) {
+        // The injector's permission was validated once at registration, and the
+        // policy consented to its events then; skip the per-event permission and
+        // interception round trips. POLICY_FLAG_FILTERED bypasses the
+        // interceptXxxBeforeQueueing calls below.
+        policyFlags |= POLICY_FLAG_TRUSTED | POLICY_FLAG_FILTERED;
+    } else if (hasInjectionPermission(injectorPid, injectorUid)) {
         policyFlags |= POLICY_FLAG_TRUSTED;
     }
 
@@ -3432,6 +3501,7 @@ int32_t InputDispatcher::injectInputEvent(const InputEvent* event, int32_t injec
     }
 
     InjectionState* injectionState = new InjectionState(injectorPid, injectorUid);
+    injectionState->preAuthorized = preAuthorized;
     if (syncMode == INPUT_EVENT_INJECTION_SYNC_NONE) {
         injectionState->injectionIsAsync = true;
     }
@@ -3548,6 +3618,40 @@ bool InputDispatcher::hasInjectionPermission(int32_t injectorPid, int32_t inject
             mPolicy->checkInjectEventsPermissionNonReentrant(injectorPid, injectorUid);
 }
 
+status_t InputDispatcher::registerPreAuthorizedInjector(int32_t injectorPid, int32_t injectorUid,
+                                                        base::unique_fd notifyFd) {
+    if (!hasInjectionPermission(injectorPid, injectorUid)) {
+        ALOGW("Refusing to pre-authorize injector pid %d uid %d without injection permission",
+              injectorPid, injectorUid);
+        return PERMISSION_DENIED;
+    }
+
+    std::scoped_lock _l(mInjectorRegistryLock);
+    mPreAuthorizedInjectors[{injectorPid, injectorUid}] = std::move(notifyFd);
+    return OK;
+}
+
+void InputDispatcher::unregisterPreAuthorizedInjector(int32_t injectorPid, int32_t injectorUid) {
+    std::scoped_lock _l(mInjectorRegistryLock);
+    mPreAuthorizedInjectors.erase({injectorPid, injectorUid});
+}
+
+bool InputDispatcher::isPreAuthorizedInjector(int32_t injectorPid, int32_t injectorUid) {
+    std::scoped_lock _l(mInjectorRegistryLock);
+    return mPreAuthorizedInjectors.count({injectorPid, injectorUid}) != 0;
+}
+
+bool InputDispatcher::signalPreAuthorizedInjector(int32_t injectorPid, int32_t injectorUid) {
+    std::scoped_lock _l(mInjectorRegistryLock);
+    auto it = mPreAuthorizedInjectors.find({injectorPid, injectorUid});
+    if (it == mPreAuthorizedInjectors.end() || it->second.get() < 0) {
+        return false;
+    }
+    const uint64_t one = 1;
+    TEMP_FAILURE_RETRY(write(it->second.get(), &one, sizeof(one)));
+    return true;
+}
+
 void InputDispatcher::setInjectionResult(EventEntry* entry, int32_t injectionResult) {
     InjectionState* injectionState = entry->injectionState;
     if (injectionState) {
@@ -3576,6 +3680,12 @@ void InputDispatcher::setInjectionResult(EventEntry* entry, int32_t injectionRes
         }
 
         injectionState->injectionResult = injectionResult;
+        if (injectionState->injectionIsAsync && injectionState->preAuthorized &&
+            signalPreAuthorizedInjector(injectionState->injectorPid,
+                                        injectionState->injectorUid)) {
+            // Completion was delivered on the injector's eventfd; no waiter to wake.
+            return;
+        }
         mInjectionResultAvailable.notify_all();
     }
 }
@@ -3598,9 +3708,12 @@ void InputDispatcher::decrementPendingForegroundDispatches(EventEntry* entry) {
     }
 }
 
-std::vector<sp<InputWindowHandle>> InputDispatcher::getWindowHandlesLocked(
+std::shared_ptr<const std::vector<sp<InputWindowHandle>>> InputDispatcher::getWindowHandlesLocked(
         int32_t displayId) const {
-    return getValueByKey(mWindowHandlesByDisplay, displayId);
+    static const auto kNoWindowHandles =
+            std::make_shared<const std::vector<sp<InputWindowHandle>>>();
+    auto it = mWindowHandlesByDisplay.find(displayId);
+    return it != mWindowHandlesByDisplay.end() ? it->second : kNoWindowHandles;
 }
 
 sp<InputWindowHandle> InputDispatcher::getFocusedWindowHandleLocked(int displayId) const {
@@ -3614,7 +3727,7 @@ sp<InputWindowHandle> InputDispatcher::getWindowHandleLocked(
     }
 
     for (auto& it : mWindowHandlesByDisplay) {
-        const std::vector<sp<InputWindowHandle>> windowHandles = it.second;
+        const std::vector<sp<InputWindowHandle>>& windowHandles = *it.second;
         for (const sp<InputWindowHandle>& windowHandle : windowHandles) {
             if (windowHandle->getToken() == windowHandleToken) {
                 return windowHandle;
@@ -3626,7 +3739,7 @@ sp<InputWindowHandle> InputDispatcher::getWindowHandleLocked(
 
 bool InputDispatcher::hasWindowHandleLocked(const sp<InputWindowHandle>& windowHandle) const {
     for (auto& it : mWindowHandlesByDisplay) {
-        const std::vector<sp<InputWindowHandle>> windowHandles = it.second;
+        const std::vector<sp<InputWindowHandle>>& windowHandles = *it.second;
         for (const sp<InputWindowHandle>& handle : windowHandles) {
             if (handle->getId() == windowHandle->getId() &&
                 handle->getToken() == windowHandle->getToken()) {
@@ -3656,14 +3769,15 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
     if (inputWindowHandles.empty()) {
         // Remove all handles on a display if there are no windows left.
         mWindowHandlesByDisplay.erase(displayId);
+        mWindowHitIndexByDisplay.erase(displayId);
         return;
     }
 
     // Since we compare the pointer of input window handles across window updates, we need
     // to make sure the handle object for the same window stays unchanged across updates.
-    const std::vector<sp<InputWindowHandle>>& oldHandles = getWindowHandlesLocked(displayId);
+    const auto oldHandles = getWindowHandlesLocked(displayId);
     std::unordered_map<int32_t /*id*/, sp<InputWindowHandle>> oldHandlesById;
-    for (const sp<InputWindowHandle>& handle : oldHandles) {
+    for (const sp<InputWindowHandle>& handle : *oldHandles) {
         oldHandlesById[handle->getId()] = handle;
     }
 
@@ -3705,8 +3819,11 @@ void InputDispatcher::updateWindowHandlesForDisplayLocked(
         }
     }
 
-    // Insert or replace
-    mWindowHandlesByDisplay[displayId] = newHandles;
+    // Insert or replace.  The previous snapshot is left untouched so that readers still
+    // holding it continue to see a consistent window list.
+    mWindowHandlesByDisplay[displayId] =
+            std::make_shared<const std::vector<sp<InputWindowHandle>>>(std::move(newHandles));
+    mWindowHitIndexByDisplay[displayId].rebuild(*mWindowHandlesByDisplay[displayId], displayId);
 }
 
 void InputDispatcher::setInputWindows(
@@ -3738,14 +3855,14 @@ void InputDispatcher::setInputWindowsLocked(
         ALOGD("setInputWindows displayId=%" PRId32 " %s", displayId, windowList.c_str());
     }
 
-    // Copy old handles for release if they are no longer present.
-    const std::vector<sp<InputWindowHandle>> oldWindowHandles = getWindowHandlesLocked(displayId);
+    // Keep the old snapshot so that windows which are no longer present can be released.
+    const auto oldWindowHandles = getWindowHandlesLocked(displayId);
 
     updateWindowHandlesForDisplayLocked(inputWindowHandles, displayId);
 
     sp<InputWindowHandle> newFocusedWindowHandle = nullptr;
     bool foundHoveredWindow = false;
-    for (const sp<InputWindowHandle>& windowHandle : getWindowHandlesLocked(displayId)) {
+    for (const sp<InputWindowHandle>& windowHandle : *getWindowHandlesLocked(displayId)) {
         // Set newFocusedWindowHandle to the top most focused window instead of the last one
         if (!newFocusedWindowHandle && windowHandle->getInfo()->hasFocus &&
             windowHandle->getInfo()->visible) {
@@ -3823,7 +3940,7 @@ void InputDispatcher::setInputWindowsLocked(
     // This ensures that unused input channels are released promptly.
     // Otherwise, they might stick around until the window handle is destroyed
     // which might not happen until the next GC.
-    for (const sp<InputWindowHandle>& oldWindowHandle : oldWindowHandles) {
+    for (const sp<InputWindowHandle>& oldWindowHandle : *oldWindowHandles) {
         if (!hasWindowHandleLocked(oldWindowHandle)) {
             if (DEBUG_FOCUS) {
                 ALOGD("Window went away: %s", oldWindowHandle->getName().c_str());
@@ -4164,7 +4281,7 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) {
 
     if (!mWindowHandlesByDisplay.empty()) {
         for (auto& it : mWindowHandlesByDisplay) {
-            const std::vector<sp<InputWindowHandle>> windowHandles = it.second;
+            const std::vector<sp<InputWindowHandle>>& windowHandles = *it.second;
             dump += StringPrintf(INDENT "Display: %" PRId32 "\n", it.first);
             if (!windowHandles.empty()) {
                 dump += INDENT2 "Windows:\n";
@@ -4321,6 +4438,16 @@ void InputDispatcher::dumpDispatchStateLocked(std::string& dump) {
         dump += INDENT "AppSwitch: not pending\n";
     }
 
+    if (mTouchStatistics.getCount() != 0) {
+        dump += StringPrintf(INDENT "TouchStatistics: min=%0.1fus, max=%0.1fus, mean=%0.1fus, "
+                                    "p95=%0.1fus, p99=%0.1fus, count=%zu\n",
+                             mTouchStatistics.getMin(), mTouchStatistics.getMax(),
+                             mTouchStatistics.getMean(), mTouchStatistics.getPercentile(0.95f),
+                             mTouchStatistics.getPercentile(0.99f), mTouchStatistics.getCount());
+    } else {
+        dump += INDENT "TouchStatistics: <no samples>\n";
+    }
+
     dump += INDENT "Configuration:\n";
     dump += StringPrintf(INDENT2 "KeyRepeatDelay: %" PRId64 "ms\n", ns2ms(mConfig.keyRepeatDelay));
     dump += StringPrintf(INDENT2 "KeyRepeatTimeout: %" PRId64 "ms\n",
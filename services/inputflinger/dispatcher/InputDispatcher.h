@@ -30,12 +30,14 @@
 #include "Monitor.h"
 #include "TouchState.h"
 #include "TouchedWindow.h"
+#include "WindowHitIndex.h"
 
 #include <input/Input.h>
 #include <input/InputApplication.h>
 #include <input/InputTransport.h>
 #include <input/InputWindow.h>
 #include <input/LatencyStatistics.h>
+#include <input/VelocityTracker.h>
 #include <limits.h>
 #include <stddef.h>
 #include <ui/Region.h>
@@ -47,6 +49,8 @@
 #include <utils/threads.h>
 #include <condition_variable>
 #include <deque>
+#include <map>
+#include <memory>
 #include <optional>
 #include <unordered_map>
 
@@ -108,6 +112,10 @@ public:
                                      std::chrono::milliseconds timeout,
                                      uint32_t policyFlags) override;
 
+    virtual status_t registerPreAuthorizedInjector(int32_t injectorPid, int32_t injectorUid,
+                                                   base::unique_fd notifyFd) override;
+    virtual void unregisterPreAuthorizedInjector(int32_t injectorPid, int32_t injectorUid) override;
+
     virtual std::unique_ptr<VerifiedInputEvent> verifyInputEvent(const InputEvent& event) override;
 
     virtual void setInputWindows(
@@ -236,6 +244,18 @@ private:
     bool hasInjectionPermission(int32_t injectorPid, int32_t injectorUid);
     void setInjectionResult(EventEntry* entry, int32_t injectionResult);
 
+    // Pre-authorized injectors, validated once at registration. Guarded by a
+    // dedicated lock because injectInputEvent consults the registry before
+    // taking mLock; mLock may be held when the registry lock is acquired, but
+    // never the other way around.
+    std::mutex mInjectorRegistryLock;
+    std::map<std::pair<int32_t, int32_t>, base::unique_fd> mPreAuthorizedInjectors
+            GUARDED_BY(mInjectorRegistryLock);
+    bool isPreAuthorizedInjector(int32_t injectorPid, int32_t injectorUid);
+    // Increments the injector's completion eventfd, returning false when the
+    // injector is no longer registered.
+    bool signalPreAuthorizedInjector(int32_t injectorPid, int32_t injectorUid);
+
     std::condition_variable mInjectionSyncFinished;
     void incrementPendingForegroundDispatches(EventEntry* entry);
     void decrementPendingForegroundDispatches(EventEntry* entry);
@@ -291,13 +311,22 @@ private:
     bool mInputFilterEnabled GUARDED_BY(mLock);
     bool mInTouchMode GUARDED_BY(mLock);
 
-    std::unordered_map<int32_t, std::vector<sp<InputWindowHandle>>> mWindowHandlesByDisplay
-            GUARDED_BY(mLock);
+    // The window list of each display is stored as an immutable snapshot that is replaced
+    // wholesale whenever the windows change.  Publication still happens under mLock, but
+    // readers share the snapshot by reference instead of copying the vector per query, and
+    // a snapshot stays valid if held across a lock release.
+    std::unordered_map<int32_t, std::shared_ptr<const std::vector<sp<InputWindowHandle>>>>
+            mWindowHandlesByDisplay GUARDED_BY(mLock);
+    // Spatial index over each display's touchable windows, rebuilt together
+    // with the window list so per-touch hit testing only scans the windows
+    // near the touched point.
+    std::unordered_map<int32_t, WindowHitIndex> mWindowHitIndexByDisplay GUARDED_BY(mLock);
     void setInputWindowsLocked(const std::vector<sp<InputWindowHandle>>& inputWindowHandles,
                                int32_t displayId) REQUIRES(mLock);
-    // Get window handles by display, return an empty vector if not found.
-    std::vector<sp<InputWindowHandle>> getWindowHandlesLocked(int32_t displayId) const
-            REQUIRES(mLock);
+    // Get the current window handle snapshot for a display. Never returns null;
+    // an empty list is returned for displays with no windows.
+    std::shared_ptr<const std::vector<sp<InputWindowHandle>>> getWindowHandlesLocked(
+            int32_t displayId) const REQUIRES(mLock);
     sp<InputWindowHandle> getWindowHandleLocked(const sp<IBinder>& windowHandleToken) const
             REQUIRES(mLock);
     sp<InputWindowHandle> getFocusedWindowHandleLocked(int displayId) const REQUIRES(mLock);
@@ -335,6 +364,12 @@ private:
                            nsecs_t* nextWakeupTime) REQUIRES(mLock);
     bool dispatchMotionLocked(nsecs_t currentTime, MotionEntry* entry, DropReason* dropReason,
                               nsecs_t* nextWakeupTime) REQUIRES(mLock);
+    // Runs the per-device VelocityTracker over the outbound pointer stream and
+    // fills in the entry's computed states (velocity and one-frame position
+    // prediction), so the work is done once here rather than in every client.
+    void updateComputedStatesLocked(MotionEntry* entry) REQUIRES(mLock);
+    std::unordered_map<int32_t /*deviceId*/, std::unique_ptr<VelocityTracker>> mVelocityTrackers
+            GUARDED_BY(mLock);
     void dispatchFocusLocked(nsecs_t currentTime, FocusEntry* entry) REQUIRES(mLock);
     void dispatchEventLocked(nsecs_t currentTime, EventEntry* entry,
                              const std::vector<InputTarget>& inputTargets) REQUIRES(mLock);
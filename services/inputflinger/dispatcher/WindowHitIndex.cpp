@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "WindowHitIndex.h"
+
+#include <algorithm>
+
+#include <ui/Rect.h>
+
+namespace android {
+namespace inputdispatcher {
+
+void WindowHitIndex::rebuild(const std::vector<sp<InputWindowHandle>>& windowHandles,
+                             int32_t displayId) {
+    for (std::vector<Candidate>& cell : mCells) {
+        cell.clear();
+    }
+    mOutsideWatchers.clear();
+
+    // First pass: classify the windows and compute the union of the
+    // non-modal windows' touchable bounds, which defines the grid.
+    struct IndexedWindow {
+        Candidate candidate;
+        Rect bounds;
+    };
+    std::vector<IndexedWindow> touchables;
+    touchables.reserve(windowHandles.size());
+    Rect unionBounds(Rect::EMPTY_RECT);
+    bool haveBounds = false;
+
+    for (size_t order = 0; order < windowHandles.size(); order++) {
+        const sp<InputWindowHandle>& windowHandle = windowHandles[order];
+        const InputWindowInfo* windowInfo = windowHandle->getInfo();
+        if (windowInfo->displayId != displayId || !windowInfo->visible) {
+            continue;
+        }
+        const int32_t flags = windowInfo->layoutParamsFlags;
+        if (flags & InputWindowInfo::FLAG_WATCH_OUTSIDE_TOUCH) {
+            mOutsideWatchers.push_back({windowHandle, order, false});
+        }
+        if (flags & InputWindowInfo::FLAG_NOT_TOUCHABLE) {
+            continue;
+        }
+        const bool touchModal = (flags &
+                                 (InputWindowInfo::FLAG_NOT_FOCUSABLE |
+                                  InputWindowInfo::FLAG_NOT_TOUCH_MODAL)) == 0;
+        const Rect bounds = touchModal ? Rect::EMPTY_RECT : windowInfo->touchableRegion.bounds();
+        if (!touchModal) {
+            if (bounds.isEmpty()) {
+                // An empty touchable region can never contain a point.
+                continue;
+            }
+            if (!haveBounds) {
+                unionBounds = bounds;
+                haveBounds = true;
+            } else {
+                unionBounds.left = std::min(unionBounds.left, bounds.left);
+                unionBounds.top = std::min(unionBounds.top, bounds.top);
+                unionBounds.right = std::max(unionBounds.right, bounds.right);
+                unionBounds.bottom = std::max(unionBounds.bottom, bounds.bottom);
+            }
+        }
+        touchables.push_back({{windowHandle, order, touchModal}, bounds});
+    }
+
+    if (touchables.empty()) {
+        mLeft = mTop = mRight = mBottom = 0;
+        return;
+    }
+    if (!haveBounds) {
+        // Only touch modal windows; any cell will do.
+        unionBounds = Rect(0, 0, 1, 1);
+    }
+    mLeft = unionBounds.left;
+    mTop = unionBounds.top;
+    mRight = unionBounds.right;
+    mBottom = unionBounds.bottom;
+
+    // Second pass: distribute the windows over the cells their bounds
+    // overlap. Iterating in z order keeps every cell sorted front to back.
+    for (const IndexedWindow& indexed : touchables) {
+        size_t colBegin = 0;
+        size_t colEnd = kGridSize - 1;
+        size_t rowBegin = 0;
+        size_t rowEnd = kGridSize - 1;
+        if (!indexed.candidate.touchModal) {
+            colBegin = cellIndexOf(indexed.bounds.left, mTop) % kGridSize;
+            colEnd = cellIndexOf(indexed.bounds.right - 1, mTop) % kGridSize;
+            rowBegin = cellIndexOf(mLeft, indexed.bounds.top) / kGridSize;
+            rowEnd = cellIndexOf(mLeft, indexed.bounds.bottom - 1) / kGridSize;
+        }
+        for (size_t row = rowBegin; row <= rowEnd; row++) {
+            for (size_t col = colBegin; col <= colEnd; col++) {
+                mCells[row * kGridSize + col].push_back(indexed.candidate);
+            }
+        }
+    }
+}
+
+size_t WindowHitIndex::cellIndexOf(int32_t x, int32_t y) const {
+    const int64_t width = int64_t(mRight) - mLeft;
+    const int64_t height = int64_t(mBottom) - mTop;
+    int64_t col = width > 0 ? (int64_t(x) - mLeft) * int64_t(kGridSize) / width : 0;
+    int64_t row = height > 0 ? (int64_t(y) - mTop) * int64_t(kGridSize) / height : 0;
+    col = std::max<int64_t>(0, std::min<int64_t>(col, kGridSize - 1));
+    row = std::max<int64_t>(0, std::min<int64_t>(row, kGridSize - 1));
+    return size_t(row) * kGridSize + size_t(col);
+}
+
+const std::vector<WindowHitIndex::Candidate>& WindowHitIndex::candidatesAt(int32_t x,
+                                                                           int32_t y) const {
+    return mCells[cellIndexOf(x, y)];
+}
+
+} // namespace inputdispatcher
+} // namespace android
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _UI_INPUT_INPUTDISPATCHER_WINDOWHITINDEX_H
+#define _UI_INPUT_INPUTDISPATCHER_WINDOWHITINDEX_H
+
+#include <array>
+#include <vector>
+
+#include <input/InputWindow.h>
+#include <utils/RefBase.h>
+
+namespace android {
+namespace inputdispatcher {
+
+/**
+ * Spatial index over the touchable windows of one display.
+ *
+ * The index is a sorted-interval grid: the union of the windows' touchable
+ * bounds is divided into kGridSize x kGridSize cells, and every cell lists,
+ * front to back, the windows whose touchable bounds overlap it. Touch modal
+ * windows, which accept a touch anywhere on the display, are listed in every
+ * cell. A hit test therefore only has to consider the windows of one cell
+ * instead of the display's full window list.
+ *
+ * The index is rebuilt whenever the display's window list or geometry
+ * changes, which happens at most once per committed transaction rather than
+ * once per touch.
+ */
+class WindowHitIndex {
+public:
+    struct Candidate {
+        sp<InputWindowHandle> window;
+        // Position in the display's front-to-back window list, used to order
+        // outside-touch watchers relative to the touched window.
+        size_t order;
+        // True if the window accepts a touch anywhere on the display.
+        bool touchModal;
+    };
+
+    void rebuild(const std::vector<sp<InputWindowHandle>>& windowHandles, int32_t displayId);
+
+    /**
+     * Returns the windows that may be touched at (x, y), front to back. The
+     * list is a superset of the true hits - the caller still performs the
+     * exact touchable region test - but excludes invisible and untouchable
+     * windows and everything whose touchable bounds lie elsewhere.
+     */
+    const std::vector<Candidate>& candidatesAt(int32_t x, int32_t y) const;
+
+    /** Visible windows with FLAG_WATCH_OUTSIDE_TOUCH, front to back. */
+    const std::vector<Candidate>& outsideWatchers() const { return mOutsideWatchers; }
+
+private:
+    static constexpr size_t kGridSize = 16;
+
+    size_t cellIndexOf(int32_t x, int32_t y) const;
+
+    std::array<std::vector<Candidate>, kGridSize * kGridSize> mCells;
+    std::vector<Candidate> mOutsideWatchers;
+
+    // Union of the indexed windows' touchable bounds; the grid covers exactly
+    // this rectangle. Points outside it are clamped to the nearest cell,
+    // which can only over-approximate the candidate set.
+    int32_t mLeft = 0;
+    int32_t mTop = 0;
+    int32_t mRight = 0;
+    int32_t mBottom = 0;
+};
+
+} // namespace inputdispatcher
+} // namespace android
+
+#endif // _UI_INPUT_INPUTDISPATCHER_WINDOWHITINDEX_H
@@ -18,6 +18,7 @@
 #define _UI_INPUT_INPUTDISPATCHER_INPUTDISPATCHERINTERFACE_H
 
 #include <InputListener.h>
+#include <android-base/unique_fd.h>
 #include <input/ISetInputWindowsListener.h>
 #include <unordered_map>
 
@@ -93,6 +94,25 @@ public:
                                      int32_t injectorUid, int32_t syncMode,
                                      std::chrono::milliseconds timeout, uint32_t policyFlags) = 0;
 
+    /* Registers the given pid/uid as a pre-authorized injector for high-rate trusted
+     * pipelines. The injection permission is checked once here rather than on every
+     * injected event; subsequent injectInputEvent calls from this injector skip the
+     * per-event policy interception and permission round trips. Results of asynchronous
+     * injections are signalled by incrementing notifyFd (an eventfd) instead of waking
+     * the injection condition variable.
+     * Returns OK, or PERMISSION_DENIED if the injector may not inject events.
+     *
+     * This method may be called on any thread (usually by the input manager).
+     */
+    virtual status_t registerPreAuthorizedInjector(int32_t injectorPid, int32_t injectorUid,
+                                                   base::unique_fd notifyFd) = 0;
+
+    /* Removes a previously registered pre-authorized injector.
+     *
+     * This method may be called on any thread (usually by the input manager).
+     */
+    virtual void unregisterPreAuthorizedInjector(int32_t injectorPid, int32_t injectorUid) = 0;
+
     /*
      * Check whether InputEvent actually happened by checking the signature of the event.
      *
@@ -822,26 +822,14 @@ EventHub::Device* EventHub::getDeviceByPathLocked(const char* devicePath) const
 
 /**
  * The file descriptor could be either input device, or a video device (associated with a
- * specific input device). Check both cases here, and return the device that this event
- * belongs to. Caller can compare the fd's once more to determine event type.
- * Looks through all input devices, and only attached video devices. Unattached video
- * devices are ignored.
+ * specific input device). Return the device that this event belongs to. Caller can
+ * compare the fd's once more to determine event type.
+ * Covers all input devices, and only attached video devices. Unattached video
+ * devices are not registered in epoll and therefore are never looked up by fd.
  */
 EventHub::Device* EventHub::getDeviceByFdLocked(int fd) const {
-    for (size_t i = 0; i < mDevices.size(); i++) {
-        Device* device = mDevices.valueAt(i);
-        if (device->fd == fd) {
-            // This is an input device event
-            return device;
-        }
-        if (device->videoDevice && device->videoDevice->getFd() == fd) {
-            // This is a video device event
-            return device;
-        }
-    }
-    // We do not check mUnattachedVideoDevices here because they should not participate in epoll,
-    // and therefore should never be looked up by fd.
-    return nullptr;
+    auto it = mDevicesByFd.find(fd);
+    return it != mDevicesByFd.end() ? it->second : nullptr;
 }
 
 size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSize) {
@@ -956,7 +944,10 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
                 if (eventItem.events & EPOLLIN) {
                     size_t numFrames = device->videoDevice->readAndQueueFrames();
                     if (numFrames == 0) {
-                        ALOGE("Received epoll event for video device %s, but could not read frame",
+                        // Not necessarily an error: the frames may already have been drained
+                        // inline while reading the associated input device in this pass.
+                        ALOGV("Received epoll event for video device %s, but no frames were "
+                              "pending",
                               device->videoDevice->getName().c_str());
                     }
                 } else if (eventItem.events & EPOLLHUP) {
@@ -1003,6 +994,13 @@ size_t EventHub::getEvents(int timeoutMillis, RawEvent* buffer, size_t bufferSiz
                         event += 1;
                         capacity -= 1;
                     }
+                    if (device->videoDevice) {
+                        // Drain any frames the video device has produced by now, so that
+                        // frames belonging to the touch events just read are queued in the
+                        // same pass instead of waiting for the video fd's own epoll item in
+                        // a later batch, where they would attach to the wrong gesture frame.
+                        device->videoDevice->readAndQueueFrames();
+                    }
                     if (capacity == 0) {
                         // The result buffer is full.  Reset the pending event index
                         // so we will try to read the device again on the next iteration.
@@ -1178,20 +1176,30 @@ status_t EventHub::registerDeviceForEpollLocked(Device* device) {
         ALOGE("Could not add input device fd to epoll for device %" PRId32, device->id);
         return result;
     }
+    mDevicesByFd[device->fd] = device;
     if (device->videoDevice) {
-        registerVideoDeviceForEpollLocked(*device->videoDevice);
+        registerVideoDeviceForEpollLocked(device);
     }
     return result;
 }
 
-void EventHub::registerVideoDeviceForEpollLocked(const TouchVideoDevice& videoDevice) {
+void EventHub::registerVideoDeviceForEpollLocked(Device* device) {
+    const TouchVideoDevice& videoDevice = *device->videoDevice;
     status_t result = registerFdForEpoll(videoDevice.getFd());
     if (result != OK) {
         ALOGE("Could not add video device %s to epoll", videoDevice.getName().c_str());
+        return;
     }
+    mDevicesByFd[videoDevice.getFd()] = device;
 }
 
 status_t EventHub::unregisterDeviceFromEpollLocked(Device* device) {
+    // Drop the fd lookup entries first, so that a failure to detach from epoll can
+    // never leave a dangling device pointer behind for a stale event.
+    mDevicesByFd.erase(device->fd);
+    if (device->videoDevice) {
+        mDevicesByFd.erase(device->videoDevice->getFd());
+    }
     if (device->hasValidFd()) {
         status_t result = unregisterFdFromEpoll(device->fd);
         if (result != OK) {
@@ -1207,6 +1215,7 @@ status_t EventHub::unregisterDeviceFromEpollLocked(Device* device) {
 
 void EventHub::unregisterVideoDeviceFromEpollLocked(const TouchVideoDevice& videoDevice) {
     if (videoDevice.hasValidFd()) {
+        mDevicesByFd.erase(videoDevice.getFd());
         status_t result = unregisterFdFromEpoll(videoDevice.getFd());
         if (result != OK) {
             ALOGW("Could not remove video device fd from epoll for device: %s",
@@ -1532,7 +1541,7 @@ void EventHub::openVideoDeviceLocked(const std::string& devicePath) {
         if (videoDevice->getName() == device->identifier.name) {
             device->videoDevice = std::move(videoDevice);
             if (device->enabled) {
-                registerVideoDeviceForEpollLocked(*device->videoDevice);
+                registerVideoDeviceForEpollLocked(device);
             }
             return;
         }
@@ -19,6 +19,7 @@
 #include "InputReader.h"
 
 #include <android-base/stringprintf.h>
+#include <cutils/properties.h>
 #include <errno.h>
 #include <input/Keyboard.h>
 #include <input/VirtualKeyMap.h>
@@ -32,6 +33,8 @@
 #include <utils/Errors.h>
 #include <utils/Thread.h>
 
+#include <algorithm>
+
 #include "InputDevice.h"
 
 using android::base::StringPrintf;
@@ -51,9 +54,15 @@ InputReader::InputReader(std::shared_ptr<EventHubInterface> eventHub,
         mNextInputDeviceId(END_RESERVED_ID),
         mDisableVirtualKeysTimeout(LLONG_MIN),
         mNextTimeout(LLONG_MAX),
-        mConfigurationChangesToRefresh(0) {
+        mConfigurationChangesToRefresh(0),
+        mConfigurationChangesToApply(0) {
     mQueuedListener = new QueuedInputListener(listener);
 
+    const int32_t watermark =
+            property_get_int32("ro.input.reader_batch_watermark", DEFAULT_BATCH_WATERMARK);
+    mBatchWatermark = static_cast<size_t>(
+            std::max(int32_t(1), std::min(watermark, int32_t(EVENT_BUFFER_SIZE))));
+
     { // acquire lock
         AutoMutex _l(mLock);
 
@@ -87,29 +96,60 @@ void InputReader::loopOnce() {
     int32_t timeoutMillis;
     bool inputDevicesChanged = false;
     std::vector<InputDeviceInfo> inputDevices;
+    uint32_t changes = 0;
     { // acquire lock
         AutoMutex _l(mLock);
 
         oldGeneration = mGeneration;
         timeoutMillis = -1;
 
-        uint32_t changes = mConfigurationChangesToRefresh;
+        changes = mConfigurationChangesToRefresh;
         if (changes) {
             mConfigurationChangesToRefresh = 0;
             timeoutMillis = 0;
-            refreshConfigurationLocked(changes);
+        } else if (!mEventHubIdsToConfigure.empty()) {
+            // Keep draining the pending reconfiguration instead of blocking on the hub.
+            timeoutMillis = 0;
         } else if (mNextTimeout != LLONG_MAX) {
             nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
             timeoutMillis = toMillisecondTimeoutDelay(now, mNextTimeout);
         }
     } // release lock
 
+    if (changes) {
+        // Fetch the new configuration into the staging copy without holding the lock so
+        // that a slow policy upcall cannot stall queries from other threads.
+        mPolicy->getReaderConfiguration(&mStagingConfig);
+    }
+
     size_t count = mEventHub->getEvents(timeoutMillis, mEventBuffer, EVENT_BUFFER_SIZE);
 
+    // At high evdev rates (1kHz touch sampling) a single wakeup rarely
+    // drains the hub.  Top the batch up with non-blocking reads until the
+    // watermark is reached so the lock acquisition and per-device mapper
+    // dispatch below are amortized over more events.
+    while (count > 0 && count < mBatchWatermark) {
+        const size_t more =
+                mEventHub->getEvents(0, mEventBuffer + count, EVENT_BUFFER_SIZE - count);
+        if (more == 0) {
+            break;
+        }
+        count += more;
+    }
+
     { // acquire lock
         AutoMutex _l(mLock);
         mReaderIsAliveCondition.broadcast();
 
+        if (changes) {
+            mConfig = mStagingConfig;
+            applyConfigurationLocked(changes);
+        }
+
+        if (!mEventHubIdsToConfigure.empty()) {
+            configureDevicesIncrementallyLocked();
+        }
+
         if (count) {
             processEventsLocked(mEventBuffer, count);
         }
@@ -318,12 +358,15 @@ void InputReader::handleConfigurationChangedLocked(nsecs_t when) {
 
 void InputReader::refreshConfigurationLocked(uint32_t changes) {
     mPolicy->getReaderConfiguration(&mConfig);
+    applyConfigurationLocked(changes);
+}
+
+void InputReader::applyConfigurationLocked(uint32_t changes) {
     mEventHub->setExcludedDevices(mConfig.excludedDeviceNames);
 
     if (changes) {
         ALOGI("Reconfiguring input devices, changes=%s",
               InputReaderConfiguration::changesToString(changes).c_str());
-        nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
 
         if (changes & InputReaderConfiguration::CHANGE_DISPLAY_INFO) {
             updatePointerDisplayLocked();
@@ -332,14 +375,38 @@ void InputReader::refreshConfigurationLocked(uint32_t changes) {
         if (changes & InputReaderConfiguration::CHANGE_MUST_REOPEN) {
             mEventHub->requestReopenDevices();
         } else {
-            for (auto& devicePair : mDevices) {
-                std::shared_ptr<InputDevice>& device = devicePair.second;
-                device->configure(now, &mConfig, changes);
+            // Queue the devices for incremental reconfiguration.  The walk is spread
+            // over the next few loop iterations so that it never delays an event batch
+            // by more than MAX_DEVICES_CONFIGURED_PER_LOOP configure calls.
+            mConfigurationChangesToApply |= changes;
+            mEventHubIdsToConfigure.clear();
+            for (const auto& devicePair : mDevices) {
+                mEventHubIdsToConfigure.push_back(devicePair.first);
             }
         }
     }
 }
 
+void InputReader::configureDevicesIncrementallyLocked() {
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    for (size_t i = 0; i < MAX_DEVICES_CONFIGURED_PER_LOOP && !mEventHubIdsToConfigure.empty();
+         i++) {
+        int32_t eventHubId = mEventHubIdsToConfigure.back();
+        mEventHubIdsToConfigure.pop_back();
+
+        auto deviceIt = mDevices.find(eventHubId);
+        if (deviceIt == mDevices.end()) {
+            // The device was removed while it was waiting to be reconfigured.
+            continue;
+        }
+        deviceIt->second->configure(now, &mConfig, mConfigurationChangesToApply);
+    }
+
+    if (mEventHubIdsToConfigure.empty()) {
+        mConfigurationChangesToApply = 0;
+    }
+}
+
 void InputReader::updateGlobalMetaStateLocked() {
     mGlobalMetaState = 0;
 
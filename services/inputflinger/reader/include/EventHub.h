@@ -17,6 +17,7 @@
 #ifndef _RUNTIME_EVENT_HUB_H
 #define _RUNTIME_EVENT_HUB_H
 
+#include <unordered_map>
 #include <vector>
 
 #include <input/Input.h>
@@ -392,7 +393,7 @@ private:
     status_t registerFdForEpoll(int fd);
     status_t unregisterFdFromEpoll(int fd);
     status_t registerDeviceForEpollLocked(Device* device);
-    void registerVideoDeviceForEpollLocked(const TouchVideoDevice& videoDevice);
+    void registerVideoDeviceForEpollLocked(Device* device);
     status_t unregisterDeviceFromEpollLocked(Device* device);
     void unregisterVideoDeviceFromEpollLocked(const TouchVideoDevice& videoDevice);
 
@@ -405,8 +406,8 @@ private:
     Device* getDeviceLocked(int32_t deviceId) const;
     Device* getDeviceByPathLocked(const char* devicePath) const;
     /**
-     * Look through all available fd's (both for input devices and for video devices),
-     * and return the device pointer.
+     * Return the device that owns the given fd (either its input device fd or the fd
+     * of its attached video device).  Only fds registered in epoll are resolvable.
      */
     Device* getDeviceByFdLocked(int fd) const;
 
@@ -443,6 +444,16 @@ private:
     BitSet32 mControllerNumbers;
 
     KeyedVector<int32_t, Device*> mDevices;
+
+    /**
+     * Device lookup keyed by the fds registered in epoll, covering both input device
+     * fds and attached video device fds.  Lets the drain loop in getEvents resolve
+     * each ready fd in constant time instead of scanning every device per epoll item.
+     * Entries are maintained alongside epoll registration and must be removed before
+     * the device is deleted.
+     */
+    std::unordered_map<int, Device*> mDevicesByFd;
+
     /**
      * Video devices that report touchscreen heatmap, but have not (yet) been paired
      * with a specific input device. Video device discovery is independent from input device
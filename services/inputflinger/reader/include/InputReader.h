@@ -137,6 +137,12 @@ private:
     static const int EVENT_BUFFER_SIZE = 256;
     RawEvent mEventBuffer[EVENT_BUFFER_SIZE];
 
+    // Number of events to accumulate per loop before processing when more
+    // input is immediately available; overridable for latency-sensitive
+    // products through ro.input.reader_batch_watermark.
+    static const int DEFAULT_BATCH_WATERMARK = 64;
+    size_t mBatchWatermark;
+
     // An input device can represent a collection of EventHub devices. This map provides a way
     // to lookup the input device instance from the EventHub device id.
     std::unordered_map<int32_t /*eventHubId*/, std::shared_ptr<InputDevice>> mDevices;
@@ -183,6 +189,20 @@ private:
     uint32_t mConfigurationChangesToRefresh;
     void refreshConfigurationLocked(uint32_t changes);
 
+    // Double-buffered configuration.  When a refresh is requested, the new configuration
+    // is fetched from the policy into this staging copy without holding the lock (the
+    // policy upcall can be slow) and then swapped into mConfig under the lock.  Only
+    // touched by the reader thread.
+    InputReaderConfiguration mStagingConfig;
+
+    // Configuration changes are applied to devices a few at a time between event batches
+    // so that a reconfiguration never blocks the event path for the full device walk.
+    static const size_t MAX_DEVICES_CONFIGURED_PER_LOOP = 4;
+    uint32_t mConfigurationChangesToApply;
+    std::vector<int32_t> mEventHubIdsToConfigure;
+    void applyConfigurationLocked(uint32_t changes);
+    void configureDevicesIncrementallyLocked();
+
     // state queries
     typedef int32_t (InputDevice::*GetStateFunc)(uint32_t sourceMask, int32_t code);
     int32_t getStateLocked(int32_t deviceId, uint32_t sourceMask, int32_t code,
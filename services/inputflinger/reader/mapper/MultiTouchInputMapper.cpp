@@ -23,6 +23,7 @@ namespace android {
 // --- Constants ---
 
 // Maximum number of slots supported when using the slot-based Multitouch Protocol B.
+// Must not exceed the capacity of the BitSet32 used to track the slots in use.
 static constexpr size_t MAX_SLOTS = 32;
 
 // --- MultiTouchMotionAccumulator ---
@@ -79,6 +80,7 @@ void MultiTouchMotionAccumulator::clearSlots(int32_t initialSlot) {
             mSlots[i].clear();
         }
     }
+    mInUseSlots.clear();
     mCurrentSlot = initialSlot;
 }
 
@@ -160,6 +162,12 @@ void MultiTouchMotionAccumulator::process(const RawEvent* rawEvent) {
                     slot->mHaveAbsMTToolType = true;
                     break;
             }
+
+            if (slot->mInUse) {
+                mInUseSlots.markBit(uint32_t(mCurrentSlot));
+            } else {
+                mInUseSlots.clearBit(uint32_t(mCurrentSlot));
+            }
         }
     } else if (rawEvent->type == EV_SYN && rawEvent->code == SYN_MT_REPORT) {
         // MultiTouch Sync: The driver has returned all data for *one* of the pointers.
@@ -237,17 +245,17 @@ void MultiTouchInputMapper::process(const RawEvent* rawEvent) {
 }
 
 void MultiTouchInputMapper::syncTouch(nsecs_t when, RawState* outState) {
-    size_t inCount = mMultiTouchMotionAccumulator.getSlotCount();
     size_t outCount = 0;
     BitSet32 newPointerIdBits;
     mHavePointerIds = true;
 
-    for (size_t inIndex = 0; inIndex < inCount; inIndex++) {
+    // Only walk the slots that currently hold a pointer instead of scanning
+    // the entire slot array on every sync.
+    for (BitSet32 inUseSlots(mMultiTouchMotionAccumulator.getInUseSlots());
+            !inUseSlots.isEmpty();) {
+        size_t inIndex = inUseSlots.clearFirstMarkedBit();
         const MultiTouchMotionAccumulator::Slot* inSlot =
                 mMultiTouchMotionAccumulator.getSlot(inIndex);
-        if (!inSlot->isInUse()) {
-            continue;
-        }
 
         if (inSlot->getToolType() == AMOTION_EVENT_TOOL_TYPE_PALM) {
             if (!mCurrentMotionAborted) {
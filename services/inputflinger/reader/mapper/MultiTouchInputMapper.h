@@ -79,9 +79,14 @@ public:
     inline size_t getSlotCount() const { return mSlotCount; }
     inline const Slot* getSlot(size_t index) const { return &mSlots[index]; }
 
+    // Returns the set of slot indices that currently hold a pointer, so that
+    // callers can iterate over active slots without scanning the whole array.
+    inline BitSet32 getInUseSlots() const { return mInUseSlots; }
+
 private:
     int32_t mCurrentSlot;
     Slot* mSlots;
+    BitSet32 mInUseSlots;
     size_t mSlotCount;
     bool mUsingSlotsProtocol;
     bool mHaveStylus;
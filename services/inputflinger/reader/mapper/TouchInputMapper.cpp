@@ -168,7 +168,8 @@ TouchInputMapper::TouchInputMapper(InputDeviceContext& deviceContext)
         mPhysicalHeight(-1),
         mPhysicalLeft(0),
         mPhysicalTop(0),
-        mSurfaceOrientation(DISPLAY_ORIENTATION_0) {}
+        mSurfaceOrientation(DISPLAY_ORIENTATION_0),
+        mHavePointerPresentation(false) {}
 
 TouchInputMapper::~TouchInputMapper() {}
 
@@ -763,9 +764,11 @@ void TouchInputMapper::configureSurface(nsecs_t when, bool* outResetNeeded) {
         (mDeviceMode == DEVICE_MODE_DIRECT && mConfig.showTouches)) {
         if (mPointerController == nullptr) {
             mPointerController = getContext()->getPointerController(getDeviceId());
+            mHavePointerPresentation = false;
         }
     } else {
         mPointerController.clear();
+        mHavePointerPresentation = false;
     }
 
     if (viewportChanged || deviceModeChanged) {
@@ -1589,7 +1592,7 @@ void TouchInputMapper::cookAndDispatch(nsecs_t when) {
     } else {
         if (mDeviceMode == DEVICE_MODE_DIRECT && mConfig.showTouches &&
             mPointerController != nullptr) {
-            mPointerController->setPresentation(PointerControllerInterface::PRESENTATION_SPOT);
+            setPointerPresentation(PointerControllerInterface::PRESENTATION_SPOT);
             mPointerController->fade(PointerControllerInterface::TRANSITION_GRADUAL);
 
             mPointerController->setButtonState(mCurrentRawState.buttonState);
@@ -2239,7 +2242,8 @@ void TouchInputMapper::cookPointerData() {
                 break;
         }
 
-        // Write output coords.
+        // Write output coords in increasing axis id order so that each call
+        // appends to the packed value array instead of inserting into it.
         PointerCoords& out = mCurrentCookedState.cookedPointerData.pointerCoords[i];
         out.clear();
         out.setAxisValue(AMOTION_EVENT_AXIS_X, xTransformed);
@@ -2248,17 +2252,18 @@ void TouchInputMapper::cookPointerData() {
         out.setAxisValue(AMOTION_EVENT_AXIS_SIZE, size);
         out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MAJOR, touchMajor);
         out.setAxisValue(AMOTION_EVENT_AXIS_TOUCH_MINOR, touchMinor);
+        if (mCalibration.coverageCalibration != Calibration::COVERAGE_CALIBRATION_BOX) {
+            out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MAJOR, toolMajor);
+            out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MINOR, toolMinor);
+        }
         out.setAxisValue(AMOTION_EVENT_AXIS_ORIENTATION, orientation);
-        out.setAxisValue(AMOTION_EVENT_AXIS_TILT, tilt);
         out.setAxisValue(AMOTION_EVENT_AXIS_DISTANCE, distance);
+        out.setAxisValue(AMOTION_EVENT_AXIS_TILT, tilt);
         if (mCalibration.coverageCalibration == Calibration::COVERAGE_CALIBRATION_BOX) {
             out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_1, left);
             out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_2, top);
             out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_3, right);
             out.setAxisValue(AMOTION_EVENT_AXIS_GENERIC_4, bottom);
-        } else {
-            out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MAJOR, toolMajor);
-            out.setAxisValue(AMOTION_EVENT_AXIS_TOOL_MINOR, toolMinor);
         }
 
         // Write output properties.
@@ -2313,6 +2318,16 @@ void TouchInputMapper::abortPointerUsage(nsecs_t when, uint32_t policyFlags) {
     mPointerUsage = POINTER_USAGE_NONE;
 }
 
+void TouchInputMapper::setPointerPresentation(
+        PointerControllerInterface::Presentation presentation) {
+    if (mHavePointerPresentation && mPointerPresentation == presentation) {
+        return;
+    }
+    mHavePointerPresentation = true;
+    mPointerPresentation = presentation;
+    mPointerController->setPresentation(presentation);
+}
+
 void TouchInputMapper::dispatchPointerGestures(nsecs_t when, uint32_t policyFlags, bool isTimeout) {
     // Update current gesture coordinates.
     bool cancelPreviousGesture, finishPreviousGesture;
@@ -2327,7 +2342,7 @@ void TouchInputMapper::dispatchPointerGestures(nsecs_t when, uint32_t policyFlag
 
     // Update the pointer presentation and spots.
     if (mParameters.gestureMode == Parameters::GESTURE_MODE_MULTI_TOUCH) {
-        mPointerController->setPresentation(PointerControllerInterface::PRESENTATION_POINTER);
+        setPointerPresentation(PointerControllerInterface::PRESENTATION_POINTER);
         if (finishPreviousGesture || cancelPreviousGesture) {
             mPointerController->clearSpots();
         }
@@ -2339,7 +2354,7 @@ void TouchInputMapper::dispatchPointerGestures(nsecs_t when, uint32_t policyFlag
                                          mPointerController->getDisplayId());
         }
     } else {
-        mPointerController->setPresentation(PointerControllerInterface::PRESENTATION_POINTER);
+        setPointerPresentation(PointerControllerInterface::PRESENTATION_POINTER);
     }
 
     // Show or hide the pointer if needed.
@@ -3396,7 +3411,7 @@ void TouchInputMapper::dispatchPointerSimple(nsecs_t when, uint32_t policyFlags,
     int32_t displayId = mViewport.displayId;
 
     if (down || hovering) {
-        mPointerController->setPresentation(PointerControllerInterface::PRESENTATION_POINTER);
+        setPointerPresentation(PointerControllerInterface::PRESENTATION_POINTER);
         mPointerController->clearSpots();
         mPointerController->setButtonState(mCurrentRawState.buttonState);
         mPointerController->unfade(PointerControllerInterface::TRANSITION_IMMEDIATE);
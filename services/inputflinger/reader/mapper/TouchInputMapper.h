@@ -378,6 +378,12 @@ protected:
     // The pointer controller, or null if the device is not a pointer.
     sp<PointerControllerInterface> mPointerController;
 
+    // Whether a presentation has been pushed to the pointer controller yet, and
+    // the last one pushed.  Used to avoid re-sending an unchanged presentation
+    // to the controller on every processed report.
+    bool mHavePointerPresentation;
+    PointerControllerInterface::Presentation mPointerPresentation;
+
     std::vector<VirtualKey> mVirtualKeys;
 
     virtual void configureParameters();
@@ -721,6 +727,7 @@ private:
     void abortPointerUsage(nsecs_t when, uint32_t policyFlags);
 
     void dispatchPointerGestures(nsecs_t when, uint32_t policyFlags, bool isTimeout);
+    void setPointerPresentation(PointerControllerInterface::Presentation presentation);
     void abortPointerGestures(nsecs_t when, uint32_t policyFlags);
     bool preparePointerGestures(nsecs_t when, bool* outCancelPreviousGesture,
                                 bool* outFinishPreviousGesture, bool isTimeout);
@@ -23,6 +23,7 @@
 
 #include <gtest/gtest.h>
 #include <linux/input.h>
+#include <sys/eventfd.h>
 #include <cinttypes>
 #include <thread>
 #include <unordered_set>
@@ -1049,6 +1050,65 @@ TEST_F(InputDispatcherTest, SetInputWindow_SingleWindowTouch) {
     window->consumeMotionDown(ADISPLAY_ID_DEFAULT);
 }
 
+TEST_F(InputDispatcherTest, RegisterPreAuthorizedInjector_ChecksPermissionOnce) {
+    base::unique_fd notifyFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    // The fake policy denies the injection permission, so registration of a
+    // non-root injector is refused up front.
+    ASSERT_EQ(PERMISSION_DENIED,
+              mDispatcher->registerPreAuthorizedInjector(INJECTOR_PID, INJECTOR_UID,
+                                                         std::move(notifyFd)));
+}
+
+TEST_F(InputDispatcherTest, PreAuthorizedInjector_AsyncInjectionSignalsEventFd) {
+    sp<FakeApplicationHandle> application = new FakeApplicationHandle();
+    sp<FakeWindowHandle> window =
+            new FakeWindowHandle(application, mDispatcher, "Fake Window", ADISPLAY_ID_DEFAULT);
+    mDispatcher->setInputWindows({{ADISPLAY_ID_DEFAULT, {window}}});
+
+    base::unique_fd notifyFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+    base::unique_fd readFd(dup(notifyFd.get()));
+    // Root always has the injection permission, so registration succeeds.
+    ASSERT_EQ(OK,
+              mDispatcher->registerPreAuthorizedInjector(INJECTOR_PID, /*injectorUid=*/0,
+                                                         std::move(notifyFd)));
+
+    MotionEvent event;
+    PointerProperties pointerProperties[1];
+    PointerCoords pointerCoords[1];
+    pointerProperties[0].clear();
+    pointerProperties[0].id = 0;
+    pointerProperties[0].toolType = AMOTION_EVENT_TOOL_TYPE_FINGER;
+    pointerCoords[0].clear();
+    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_X, 100);
+    pointerCoords[0].setAxisValue(AMOTION_EVENT_AXIS_Y, 200);
+    const nsecs_t eventTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    event.initialize(InputEvent::nextId(), DEVICE_ID, AINPUT_SOURCE_TOUCHSCREEN,
+                     ADISPLAY_ID_DEFAULT, INVALID_HMAC, AMOTION_EVENT_ACTION_DOWN,
+                     /* actionButton */ 0, /* flags */ 0, /* edgeFlags */ 0, AMETA_NONE,
+                     /* buttonState */ 0, MotionClassification::NONE, /* xScale */ 1,
+                     /* yScale */ 1, /* xOffset */ 0, /* yOffset */ 0, /* xPrecision */ 0,
+                     /* yPrecision */ 0, AMOTION_EVENT_INVALID_CURSOR_POSITION,
+                     AMOTION_EVENT_INVALID_CURSOR_POSITION, eventTime, eventTime,
+                     /* pointerCount */ 1, pointerProperties, pointerCoords);
+
+    // Async injection from the pre-authorized injector succeeds even though the
+    // fake policy would deny the per-event permission check.
+    ASSERT_EQ(INPUT_EVENT_INJECTION_SUCCEEDED,
+              mDispatcher->injectInputEvent(&event, INJECTOR_PID, /*injectorUid=*/0,
+                                            INPUT_EVENT_INJECTION_SYNC_NONE, INJECT_EVENT_TIMEOUT,
+                                            POLICY_FLAG_PASS_TO_USER));
+    window->consumeMotionDown(ADISPLAY_ID_DEFAULT);
+
+    // By the time the window consumed the event, the injection result was set and
+    // the completion delivered on the eventfd.
+    uint64_t completions = 0;
+    ASSERT_EQ(static_cast<ssize_t>(sizeof(completions)),
+              read(readFd.get(), &completions, sizeof(completions)));
+    EXPECT_GE(completions, 1u);
+
+    mDispatcher->unregisterPreAuthorizedInjector(INJECTOR_PID, /*injectorUid=*/0);
+}
+
 /**
  * Calling setInputWindows once with FLAG_NOT_TOUCH_MODAL should not cause any issues.
  * To ensure that window receives only events that were directly inside of it, add
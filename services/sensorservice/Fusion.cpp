@@ -195,6 +195,8 @@ void Fusion::init(int mode) {
 
     mGyroRate = 0;
 
+    mInitialBias = 0;
+
     mCount[0] = 0;
     mCount[1] = 0;
     mCount[2] = 0;
@@ -215,11 +217,15 @@ void Fusion::init(int mode) {
     }
 }
 
+void Fusion::setInitialBias(const vec3_t& bias) {
+    mInitialBias = bias;
+}
+
 void Fusion::initFusion(const vec4_t& q, float dT)
 {
     // initial estimate: E{ x(t0) }
     x0 = q;
-    x1 = 0;
+    x1 = mInitialBias;
 
     // process noise covariance matrix: G.Q.Gt, with
     //
@@ -487,7 +493,7 @@ void Fusion::predict(const vec3_t& w, float dT) {
     if (x0.w < 0)
         x0 = -x0;
 
-    P = Phi*P*transpose(Phi) + GQGt;
+    P = multiplyByTranspose(Phi*P, Phi) + GQGt;
 
     checkState();
 }
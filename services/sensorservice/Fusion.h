@@ -63,6 +63,11 @@ class Fusion {
 public:
     Fusion();
     void init(int mode = FUSION_9AXIS);
+    // Seed the gyro bias estimate the filter starts from once its initial attitude has
+    // formed, so that a re-enabled filter does not re-learn a bias it had already
+    // converged to.  Must be called after init() and before samples are handled;
+    // init() resets the seed to zero.
+    void setInitialBias(const vec3_t& bias);
     void handleGyro(const vec3_t& w, float dT);
     status_t handleAcc(const vec3_t& a, float dT);
     status_t handleMag(const vec3_t& m);
@@ -81,6 +86,7 @@ private:
 
     mat<mat33_t, 2, 2> Phi;
     vec3_t Ba, Bm;
+    vec3_t mInitialBias;
     uint32_t mInitState;
     float mGyroRate;
     vec<vec3_t, 3> mData;
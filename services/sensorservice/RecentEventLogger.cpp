@@ -27,22 +27,35 @@ namespace android {
 namespace SensorServiceUtil {
 
 namespace {
-    constexpr size_t LOG_SIZE = 10;
-    constexpr size_t LOG_SIZE_MED = 30;  // debugging for slower sensors
-    constexpr size_t LOG_SIZE_LARGE = 50;  // larger samples for debugging
+    // Powers of two so the RingBuffer wraps with a mask instead of a division.
+    constexpr size_t LOG_SIZE = 16;
+    constexpr size_t LOG_SIZE_MED = 32;  // debugging for slower sensors
+    constexpr size_t LOG_SIZE_LARGE = 64;  // larger samples for debugging
 }// unnamed namespace
 
 RecentEventLogger::RecentEventLogger(int sensorType) :
         mSensorType(sensorType), mEventSize(eventSizeBySensorType(mSensorType)),
-        mRecentEvents(logSizeBySensorType(sensorType)), mMaskData(false),
+        mSeq(0), mRecentEvents(logSizeBySensorType(sensorType)), mMaskData(false),
         mIsLastEventCurrent(false) {
     // blank
 }
 
 void RecentEventLogger::addEvent(const sensors_event_t& event) {
-    std::lock_guard<std::mutex> lk(mLock);
-    mRecentEvents.emplace(event);
-    mIsLastEventCurrent = true;
+    addEvents(&event, 1);
+}
+
+void RecentEventLogger::addEvents(const sensors_event_t* events, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    // Seqlock write side. The caller serializes writers (SensorService::mLock), so this
+    // never blocks: two counter stores bracket the ring mutation and readers retry.
+    const uint32_t seq = mSeq.load(std::memory_order_relaxed);
+    mSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    mRecentEvents.emplace(events, count);
+    mSeq.store(seq + 2, std::memory_order_release);
+    mIsLastEventCurrent.store(true, std::memory_order_relaxed);
 }
 
 bool RecentEventLogger::isEmpty() const {
@@ -50,20 +63,41 @@ bool RecentEventLogger::isEmpty() const {
 }
 
 void RecentEventLogger::setLastEventStale() {
-    std::lock_guard<std::mutex> lk(mLock);
-    mIsLastEventCurrent = false;
+    mIsLastEventCurrent.store(false, std::memory_order_relaxed);
+}
+
+std::vector<RecentEventLogger::SensorEventLog> RecentEventLogger::snapshot() const {
+    std::vector<SensorEventLog> events;
+    for (;;) {
+        const uint32_t seqBegin = mSeq.load(std::memory_order_acquire);
+        if (seqBegin & 1) {
+            // A write is in flight; the writer only holds the odd state for the duration
+            // of one RingBuffer::emplace().
+            continue;
+        }
+        events.clear();
+        const size_t count = mRecentEvents.size();
+        events.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            events.push_back(mRecentEvents[i]);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (mSeq.load(std::memory_order_relaxed) == seqBegin) {
+            return events;
+        }
+    }
 }
 
 std::string RecentEventLogger::dump() const {
-    std::lock_guard<std::mutex> lk(mLock);
+    const std::vector<SensorEventLog> events = snapshot();
 
     //TODO: replace String8 with std::string completely in this function
     String8 buffer;
 
-    buffer.appendFormat("last %zu events\n", mRecentEvents.size());
+    buffer.appendFormat("last %zu events\n", events.size());
     int j = 0;
-    for (int i = mRecentEvents.size() - 1; i >= 0; --i) {
-        const auto& ev = mRecentEvents[i];
+    for (int i = events.size() - 1; i >= 0; --i) {
+        const auto& ev = events[i];
         struct tm * timeinfo = localtime(&(ev.mWallTime.tv_sec));
         buffer.appendFormat("\t%2d (ts=%.9f, wall=%02d:%02d:%02d.%03d) ",
                 ++j, ev.mEvent.timestamp/1e9, timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec,
@@ -95,11 +129,11 @@ std::string RecentEventLogger::dump() const {
  */
 void RecentEventLogger::dump(util::ProtoOutputStream* proto) const {
     using namespace service::SensorEventsProto;
-    std::lock_guard<std::mutex> lk(mLock);
+    const std::vector<SensorEventLog> events = snapshot();
 
-    proto->write(RecentEventsLog::RECENT_EVENTS_COUNT, int(mRecentEvents.size()));
-    for (int i = mRecentEvents.size() - 1; i >= 0; --i) {
-        const auto& ev = mRecentEvents[i];
+    proto->write(RecentEventsLog::RECENT_EVENTS_COUNT, int(events.size()));
+    for (int i = events.size() - 1; i >= 0; --i) {
+        const auto& ev = events[i];
         const uint64_t token = proto->start(RecentEventsLog::EVENTS);
         proto->write(Event::TIMESTAMP_SEC, float(ev.mEvent.timestamp) / 1e9f);
         proto->write(Event::WALL_TIMESTAMP_MS, ev.mWallTime.tv_sec * 1000LL
@@ -129,15 +163,25 @@ void RecentEventLogger::setFormat(std::string format) {
 }
 
 bool RecentEventLogger::populateLastEventIfCurrent(sensors_event_t *event) const {
-    std::lock_guard<std::mutex> lk(mLock);
-
-    if (mIsLastEventCurrent && mRecentEvents.size()) {
-        // Index 0 contains the latest event emplace()'ed
-        *event = mRecentEvents[0].mEvent;
-        return true;
-    } else {
+    if (!mIsLastEventCurrent.load(std::memory_order_relaxed)) {
         return false;
     }
+    for (;;) {
+        const uint32_t seqBegin = mSeq.load(std::memory_order_acquire);
+        if (seqBegin & 1) {
+            continue;
+        }
+        if (mRecentEvents.size() == 0) {
+            return false;
+        }
+        // Index 0 contains the latest event emplace()'ed
+        const sensors_event_t latest = mRecentEvents[0].mEvent;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (mSeq.load(std::memory_order_relaxed) == seqBegin) {
+            *event = latest;
+            return mIsLastEventCurrent.load(std::memory_order_relaxed);
+        }
+    }
 }
 
 
@@ -23,7 +23,8 @@
 #include <hardware/sensors.h>
 #include <utils/String8.h>
 
-#include <mutex>
+#include <atomic>
+#include <vector>
 
 namespace android {
 namespace SensorServiceUtil {
@@ -33,11 +34,20 @@ namespace SensorServiceUtil {
 // generated from the sensor are stored in this buffer.  The buffer is NOT cleared when the sensor
 // unregisters and as a result very old data in the dumpsys output can be seen, which is an intended
 // behavior.
+//
+// The ring is guarded by a sequence counter instead of a mutex: addEvent() runs on the event path
+// at sensor rate and must never wait on a dumpsys reader. The writer (already serialized by
+// SensorService::mLock) bumps the counter to an odd value before mutating the ring and to the next
+// even value afterwards; readers copy the ring and retry if the counter changed underneath them.
 class RecentEventLogger : public Dumpable {
 public:
     explicit RecentEventLogger(int sensorType);
     void addEvent(const sensors_event_t& event);
 
+    // Record a contiguous run of events from this sensor under a single seqlock write,
+    // instead of paying the counter stores and fences once per event.
+    void addEvents(const sensors_event_t* events, size_t count);
+
     // Populate event with the last recorded sensor event if it is not stale. An event is
     // considered stale if the sensor has become deactivated since the event was recorded.
     // returns true on success, false if no recent event is available or the last event is stale
@@ -52,7 +62,9 @@ public:
     virtual void setFormat(std::string format) override;
 
 protected:
-    struct SensorEventLog {
+    // Each entry is aligned to its own cache lines so that the event-path writer never
+    // shares a line with the neighbouring entries a dumpsys reader is copying.
+    struct alignas(64) SensorEventLog {
         explicit SensorEventLog(const sensors_event_t& e);
         timespec mWallTime;
         sensors_event_t mEvent;
@@ -61,14 +73,20 @@ protected:
     const int mSensorType;
     const size_t mEventSize;
 
-    mutable std::mutex mLock;
+    // Seqlock over mRecentEvents: odd while addEvent() is mutating the ring, bumped to the
+    // next even value once the write completes.
+    mutable std::atomic<uint32_t> mSeq;
     RingBuffer<SensorEventLog> mRecentEvents;
 
     bool mMaskData;
-    bool mIsLastEventCurrent;
+    std::atomic<bool> mIsLastEventCurrent;
 
 private:
     static size_t logSizeBySensorType(int sensorType);
+
+    // Returns a consistent copy of the ring contents, retrying if addEvent() raced with the
+    // copy. Index 0 holds the most recent event, matching RingBuffer.
+    std::vector<SensorEventLog> snapshot() const;
 };
 
 } // namespace SensorServiceUtil
@@ -121,6 +121,16 @@ public:
     template <class... Args>
     void emplace(Args&&... args);
 
+    /**
+     * Construct items in-place in the front of this RingBuffer from a contiguous run of
+     * source values, oldest first.  Equivalent to calling emplace() once per item; when
+     * count exceeds the maximum length only the newest items are kept.
+     *
+     * All current iterators are invalidated.
+     */
+    template <class InputT>
+    void emplace(const InputT* items, size_t count);
+
     /**
      * Get an iterator to the front of this RingBuffer.
      */
@@ -164,14 +174,34 @@ public:
     void clear();
 
 private:
+    /**
+     * Advance a ring index by one slot.  Power-of-two capacities wrap with a mask and all
+     * others with a compare, so the append path never divides.
+     */
+    size_t nextIdx(size_t idx) const {
+        if (mWrapMask != 0) {
+            return (idx + 1) & mWrapMask;
+        }
+        const size_t next = idx + 1;
+        return next == mMaxBufferSize ? 0 : next;
+    }
+
     size_t mFrontIdx;
     size_t mMaxBufferSize;
+    size_t mWrapMask;
     std::vector<T> mBuffer;
 }; // class RingBuffer
 
 
 template <class T>
-RingBuffer<T>::RingBuffer(size_t length) : mFrontIdx{0}, mMaxBufferSize{length} {}
+RingBuffer<T>::RingBuffer(size_t length) : mFrontIdx{0}, mMaxBufferSize{length},
+        mWrapMask{length != 0 && (length & (length - 1)) == 0 ? length - 1 : 0} {
+    // Reserve the full capacity up front so appends never reallocate the
+    // storage. Lock-free readers (see the seqlock in RecentEventLogger) copy
+    // elements concurrently with emplace() and only recheck the sequence
+    // afterwards, which is only safe if the element addresses stay stable.
+    mBuffer.reserve(length);
+}
 
 template <class T>
 RingBuffer<T>::iterator::iterator(T* ptr, size_t size, size_t pos, size_t ctr) :
@@ -265,25 +295,25 @@ template <class T>
 void RingBuffer<T>::add(const T& item) {
     if (mBuffer.size() < mMaxBufferSize) {
         mBuffer.push_back(item);
-        mFrontIdx = ((mFrontIdx + 1) % mMaxBufferSize);
+        mFrontIdx = nextIdx(mFrontIdx);
         return;
     }
 
     mBuffer[mFrontIdx] = item;
-    mFrontIdx = ((mFrontIdx + 1) % mMaxBufferSize);
+    mFrontIdx = nextIdx(mFrontIdx);
 }
 
 template <class T>
 void RingBuffer<T>::add(T&& item) {
     if (mBuffer.size() != mMaxBufferSize) {
         mBuffer.push_back(std::forward<T>(item));
-        mFrontIdx = ((mFrontIdx + 1) % mMaxBufferSize);
+        mFrontIdx = nextIdx(mFrontIdx);
         return;
     }
 
     // Only works for types with move assignment operator
     mBuffer[mFrontIdx] = std::forward<T>(item);
-    mFrontIdx = ((mFrontIdx + 1) % mMaxBufferSize);
+    mFrontIdx = nextIdx(mFrontIdx);
 }
 
 template <class T>
@@ -291,13 +321,31 @@ template <class... Args>
 void RingBuffer<T>::emplace(Args&&... args) {
     if (mBuffer.size() != mMaxBufferSize) {
         mBuffer.emplace_back(std::forward<Args>(args)...);
-        mFrontIdx = ((mFrontIdx + 1) % mMaxBufferSize);
+        mFrontIdx = nextIdx(mFrontIdx);
         return;
     }
 
     // Only works for types with move assignment operator
     mBuffer[mFrontIdx] = T(std::forward<Args>(args)...);
-    mFrontIdx = ((mFrontIdx + 1) % mMaxBufferSize);
+    mFrontIdx = nextIdx(mFrontIdx);
+}
+
+template <class T>
+template <class InputT>
+void RingBuffer<T>::emplace(const InputT* items, size_t count) {
+    if (count > mMaxBufferSize) {
+        // Older items would be overwritten before the append completes; skip them.
+        items += count - mMaxBufferSize;
+        count = mMaxBufferSize;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (mBuffer.size() != mMaxBufferSize) {
+            mBuffer.emplace_back(items[i]);
+        } else {
+            mBuffer[mFrontIdx] = T(items[i]);
+        }
+        mFrontIdx = nextIdx(mFrontIdx);
+    }
 }
 
 template <class T>
@@ -175,6 +175,7 @@ void SensorDevice::initializeSensorList() {
                         sensor.power = minPowerMa;
                     }
                     mSensorList.push_back(sensor);
+                    mSensorResolutions[sensor.handle] = sensor.resolution;
 
                     mActivationCount.add(list[i].sensorHandle, model);
 
@@ -626,6 +627,7 @@ Return<void> SensorDevice::onDynamicSensorsConnected(
 
         mConnectedDynamicSensors.insert(
                 std::make_pair(sensor->handle, sensor));
+        mSensorResolutions[sensor->handle] = sensor->resolution;
     }
 
     return Return<void>();
@@ -840,6 +842,17 @@ status_t SensorDevice::setDelay(void* ident, int handle, int64_t samplingPeriodN
     return batch(ident, handle, 0, samplingPeriodNs, 0);
 }
 
+int64_t SensorDevice::getBatchLatencyNs(void* ident, int handle) const {
+    Mutex::Autolock _l(mLock);
+    ssize_t activationIndex = mActivationCount.indexOfKey(handle);
+    if (activationIndex < 0) {
+        return 0;
+    }
+    const Info& info(mActivationCount.valueAt(activationIndex));
+    ssize_t batchIndex = info.batchParams.indexOfKey(ident);
+    return batchIndex < 0 ? 0 : info.batchParams.valueAt(batchIndex).mTBatch;
+}
+
 int SensorDevice::getHalDeviceVersion() const {
     if (mSensors == nullptr) return -1;
     return SENSORS_DEVICE_API_VERSION_1_4;
@@ -1187,6 +1200,13 @@ void SensorDevice::convertToSensorEventsAndQuantize(
 }
 
 float SensorDevice::getResolutionForSensor(int sensorHandle) {
+    auto resolution = mSensorResolutions.find(sensorHandle);
+    if (resolution != mSensorResolutions.end()) {
+        return resolution->second;
+    }
+
+    // Fall back to scanning the source lists in case the handle has not been mirrored into
+    // mSensorResolutions.
     for (size_t i = 0; i < mSensorList.size(); i++) {
       if (sensorHandle == mSensorList[i].handle) {
         return mSensorList[i].resolution;
@@ -95,6 +95,9 @@ public:
                    int64_t maxBatchReportLatencyNs);
     // Call batch with timeout zero instead of calling setDelay() for newer devices.
     status_t setDelay(void* ident, int handle, int64_t ns);
+    // Returns the max report latency this ident requested for the given sensor through batch(),
+    // or zero if no batch parameters are recorded for it (continuous mode requests store zero).
+    int64_t getBatchLatencyNs(void* ident, int handle) const;
     status_t flush(void* ident, int handle);
     status_t setMode(uint32_t mode);
 
@@ -135,6 +138,11 @@ private:
     Vector<sensor_t> mSensorList;
     std::unordered_map<int32_t, sensor_t*> mConnectedDynamicSensors;
 
+    // Resolution per sensor handle, mirroring mSensorList and mConnectedDynamicSensors so that
+    // the per-event quantization on the poll path does not rescan the sensor list. Updated
+    // wherever the source lists are: initialization, reconnect and dynamic sensor connection.
+    std::unordered_map<int32_t, float> mSensorResolutions;
+
     static const nsecs_t MINIMUM_EVENTS_PERIOD =   1000000; // 1000 Hz
     mutable Mutex mLock; // protect mActivationCount[].batchParams
     // fixed-size array after construction
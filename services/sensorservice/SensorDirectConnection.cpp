@@ -31,7 +31,8 @@ SensorService::SensorDirectConnection::SensorDirectConnection(const sp<SensorSer
         const String16& opPackageName)
         : mService(service), mUid(uid), mMem(*mem),
         mHalChannelHandle(halChannelHandle),
-        mOpPackageName(opPackageName), mDestroyed(false) {
+        mOpPackageName(opPackageName), mConfigureCalls(0), mHalRoundTrips(0),
+        mConfigureCallsCoalesced(0), mDestroyed(false) {
     ALOGD_IF(DEBUG_CONNECTIONS, "Created SensorDirectConnection");
 }
 
@@ -63,6 +64,8 @@ void SensorService::SensorDirectConnection::dump(String8& result) const {
     Mutex::Autolock _l(mConnectionLock);
     result.appendFormat("\tPackage %s, HAL channel handle %d, total sensor activated %zu\n",
             String8(mOpPackageName).string(), getHalChannelHandle(), mActivated.size());
+    result.appendFormat("\t\tconfigure calls %u | HAL round trips %u | coalesced %u\n",
+            mConfigureCalls, mHalRoundTrips, mConfigureCallsCoalesced);
     for (auto &i : mActivated) {
         result.appendFormat("\t\tSensor %#08x, rate %d\n", i.first, i.second);
     }
@@ -162,18 +165,44 @@ int32_t SensorService::SensorDirectConnection::configureChannel(int handle, int
     };
 
     Mutex::Autolock _l(mConnectionLock);
+    ++mConfigureCalls;
+
+    // Coalesce redundant reconfigurations (last-writer-wins per sensor): a request that
+    // does not change the effective rate is answered from the bookkeeping alone, without
+    // another HAL round trip.  Apps that reassert their rates on every mode switch
+    // otherwise serialize behind the HAL for each call.
+    if (rateLevel == SENSOR_DIRECT_RATE_STOP) {
+        if (mActivated.count(handle) == 0) {
+            // The sensor is not running on this channel; stopping it is a no-op.
+            ++mConfigureCallsCoalesced;
+            return NO_ERROR;
+        }
+    } else {
+        auto activeRate = mActivated.find(handle);
+        if (activeRate != mActivated.end() && activeRate->second == rateLevel) {
+            auto token = mReportTokens.find(handle);
+            if (token != mReportTokens.end()) {
+                ++mConfigureCallsCoalesced;
+                return token->second;
+            }
+        }
+    }
+
     SensorDevice& dev(SensorDevice::getInstance());
+    ++mHalRoundTrips;
     int ret = dev.configureDirectChannel(handle, getHalChannelHandle(), &config);
 
     if (rateLevel == SENSOR_DIRECT_RATE_STOP) {
         if (ret == NO_ERROR) {
             mActivated.erase(handle);
+            mReportTokens.erase(handle);
         } else if (ret > 0) {
             ret = UNKNOWN_ERROR;
         }
     } else {
         if (ret > 0) {
             mActivated[handle] = rateLevel;
+            mReportTokens[handle] = ret;
         }
     }
 
@@ -192,6 +221,7 @@ void SensorService::SensorDirectConnection::stopAllLocked(bool backupRecord) {
 
     SensorDevice& dev(SensorDevice::getInstance());
     for (auto &i : mActivated) {
+        ++mHalRoundTrips;
         dev.configureDirectChannel(i.first, getHalChannelHandle(), &config);
     }
 
@@ -199,6 +229,7 @@ void SensorService::SensorDirectConnection::stopAllLocked(bool backupRecord) {
         mActivatedBackup = mActivated;
     }
     mActivated.clear();
+    mReportTokens.clear();
 }
 
 void SensorService::SensorDirectConnection::recoverAll() {
@@ -219,7 +250,11 @@ void SensorService::SensorDirectConnection::recoverAll() {
             struct sensors_direct_cfg_t config = {
                 .rate_level = i.second
             };
-            dev.configureDirectChannel(i.first, getHalChannelHandle(), &config);
+            ++mHalRoundTrips;
+            int ret = dev.configureDirectChannel(i.first, getHalChannelHandle(), &config);
+            if (ret > 0) {
+                mReportTokens[i.first] = ret;
+            }
         }
     }
 }
@@ -92,6 +92,15 @@ private:
     std::unordered_map<int, int> mActivated;
     std::unordered_map<int, int> mActivatedBackup;
 
+    // Report token the HAL returned for each currently activated sensor.  Used to answer a
+    // reconfiguration that does not change the effective rate without another HAL round trip.
+    std::unordered_map<int, int> mReportTokens;
+
+    // Per-channel configuration statistics reported in dump().
+    uint32_t mConfigureCalls;
+    uint32_t mHalRoundTrips;
+    uint32_t mConfigureCallsCoalesced;
+
     mutable Mutex mDestroyLock;
     bool mDestroyed;
 };
@@ -14,6 +14,9 @@
  * limitations under the License.
  */
 
+#include <inttypes.h>
+
+#include <cutils/properties.h>
 #include <log/log.h>
 #include <sys/socket.h>
 #include <utils/threads.h>
@@ -34,6 +37,16 @@ namespace {
 // Used as the default value for the target SDK until it's obtained via getTargetSdkVersion.
 constexpr int kTargetSdkUnknown = 0;
 
+// Maximum number of flush complete events gathered into a single socket write when draining
+// a backlog of pending flushes.
+constexpr int kMaxFlushCompleteEventsPerWrite = 16;
+
+// Batched delivery is opt-in while it soaks: it cuts socket writes and app wakeups for
+// latency-tolerant clients but delays their events by up to the requested report latency.
+bool isBatchedDeliveryEnabled() {
+    return property_get_bool("debug.sensors.batched_delivery", false);
+}
+
 }  // namespace
 
 SensorService::SensorEventConnection::SensorEventConnection(
@@ -41,7 +54,9 @@ SensorService::SensorEventConnection::SensorEventConnection(
         const String16& opPackageName)
     : mService(service), mUid(uid), mWakeLockRefCount(0), mHasLooperCallbacks(false),
       mDead(false), mDataInjectionMode(isDataInjectionMode), mEventCache(nullptr),
-      mCacheSize(0), mMaxCacheSize(0), mTimeOfLastEventDrop(0), mEventsDropped(0),
+      mCacheStart(0), mCacheSize(0), mMaxCacheSize(0), mTimeOfLastEventDrop(0), mEventsDropped(0),
+      mTotalEventsDropped(0), mWriteFailures(0), mCacheHighWaterMark(0),
+      mBatchedDeliveryWindowNs(0), mNextBatchedDeliveryTime(0),
       mPackageName(packageName), mOpPackageName(opPackageName), mTargetSdk(kTargetSdkUnknown),
       mDestroyed(false) {
     mChannel = new BitTube(mService->mSocketBufferSize);
@@ -91,6 +106,13 @@ void SensorService::SensorEventConnection::dump(String8& result) {
     result.appendFormat("\t %s | WakeLockRefCount %d | uid %d | cache size %d | "
             "max cache size %d\n", mPackageName.string(), mWakeLockRefCount, mUid, mCacheSize,
             mMaxCacheSize);
+    result.appendFormat("\t backpressure: %u events dropped | %u socket write failures | "
+            "cache high water mark %d\n", mTotalEventsDropped, mWriteFailures,
+            mCacheHighWaterMark);
+    if (mBatchedDeliveryWindowNs > 0) {
+        result.appendFormat("\t batched delivery window %" PRId64 " ns\n",
+                            mBatchedDeliveryWindowNs);
+    }
     for (auto& it : mSensorInfo) {
         const FlushInfo& flushInfo = it.second;
         result.appendFormat("\t %s 0x%08x | status: %s | pending flush events %d \n",
@@ -172,11 +194,38 @@ bool SensorService::SensorEventConnection::addSensor(int32_t handle) {
 bool SensorService::SensorEventConnection::removeSensor(int32_t handle) {
     Mutex::Autolock _l(mConnectionLock);
     if (mSensorInfo.erase(handle) >= 0) {
+        updateBatchedDeliveryWindowLocked();
         return true;
     }
     return false;
 }
 
+void SensorService::SensorEventConnection::updateBatchedDeliveryWindow() {
+    Mutex::Autolock _l(mConnectionLock);
+    updateBatchedDeliveryWindowLocked();
+}
+
+void SensorService::SensorEventConnection::updateBatchedDeliveryWindowLocked() {
+    nsecs_t window = 0;
+    if (isBatchedDeliveryEnabled() && !mDataInjectionMode && !mSensorInfo.empty()) {
+        // Align deliveries to the smallest latency requested across this connection's
+        // sensors. A sensor registered for continuous delivery (latency zero) disables
+        // batching for the whole connection.
+        SensorDevice& dev(SensorDevice::getInstance());
+        window = INT64_MAX;
+        for (auto& it : mSensorInfo) {
+            window = std::min(window, nsecs_t(dev.getBatchLatencyNs(this, it.first)));
+        }
+        if (window == INT64_MAX) {
+            window = 0;
+        }
+    }
+    mBatchedDeliveryWindowNs = window;
+    if (window == 0) {
+        mNextBatchedDeliveryTime = 0;
+    }
+}
+
 std::vector<int32_t> SensorService::SensorEventConnection::getActiveSensorHandles() const {
     Mutex::Autolock _l(mConnectionLock);
     std::vector<int32_t> list;
@@ -295,6 +344,38 @@ status_t SensorService::SensorEventConnection::sendEvents(
 
     int count = 0;
     Mutex::Autolock _l(mConnectionLock);
+
+    // Zero-copy fast path: when every event in the shared buffer passes this
+    // connection's filter unmodified we can write straight from the buffer that
+    // the service hands to all connections instead of staging the events through
+    // the scratch area first.  This is the common case when one high-rate sensor
+    // is fanned out to many listeners.  Any event that needs filtering, an AppOp
+    // check, or a wake-up flag rewrite takes the regular path below.
+    if (scratch && mCacheSize == 0 && mBatchedDeliveryWindowNs == 0 &&
+            canSendEventsDirectlyLocked(buffer, numEvents)) {
+        sendPendingFlushEventsLocked();
+        ssize_t size = SensorEventQueue::write(mChannel,
+                                        reinterpret_cast<ASensorEvent const*>(buffer), numEvents);
+        if (size >= 0) {
+#if DEBUG_CONNECTIONS
+            mEventsReceived += numEvents;
+            mEventsSent += numEvents;
+#endif
+            return status_t(NO_ERROR);
+        }
+        // Write error, cache the events for retransmission.  No flags were modified,
+        // so the shared buffer can be appended as-is.
+        ++mWriteFailures;
+        if (mEventCache == nullptr) {
+            mMaxCacheSize = computeMaxCacheSizeLocked();
+            mEventCache = new sensors_event_t[mMaxCacheSize];
+            mCacheSize = 0;
+        }
+        appendEventsToCacheLocked(buffer, numEvents);
+        updateLooperRegistrationLocked(mService->getLooper());
+        return size;
+    }
+
     if (scratch) {
         size_t i=0;
         while (i<numEvents) {
@@ -379,6 +460,36 @@ status_t SensorService::SensorEventConnection::sendEvents(
 #if DEBUG_CONNECTIONS
      mEventsReceived += count;
 #endif
+    // Batched delivery: while the current window is open, park the filtered events in the
+    // cache instead of waking the app for every HAL batch. Wake-up events are never held;
+    // they close the window early and drain the cache along with this batch.
+    if (mBatchedDeliveryWindowNs > 0 && hasSensorAccess()) {
+        const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+        if (now < mNextBatchedDeliveryTime && findWakeUpSensorEventLocked(scratch, count) < 0) {
+            if (mEventCache == nullptr) {
+                mMaxCacheSize = computeMaxCacheSizeLocked();
+                mEventCache = new sensors_event_t[mMaxCacheSize];
+                mCacheSize = 0;
+            }
+            if (mCacheSize + count <= mMaxCacheSize) {
+                appendEventsToCacheLocked(scratch, count);
+                return status_t(NO_ERROR);
+            }
+            // The cache filled up before the window closed; deliver early.
+        }
+        mNextBatchedDeliveryTime = now + mBatchedDeliveryWindowNs;
+        if (mCacheSize > 0) {
+            writeToSocketFromCacheLocked();
+            if (mCacheSize > 0) {
+                // The socket is full. Queue this batch behind the cached events and let the
+                // looper drain both once the socket becomes writable again.
+                appendEventsToCacheLocked(scratch, count);
+                updateLooperRegistrationLocked(mService->getLooper());
+                return status_t(NO_ERROR);
+            }
+        }
+    }
+
     if (mCacheSize != 0) {
         // There are some events in the cache which need to be sent first. Copy this buffer to
         // the end of cache.
@@ -403,6 +514,7 @@ status_t SensorService::SensorEventConnection::sendEvents(
                                     reinterpret_cast<ASensorEvent const*>(scratch), count);
     if (size < 0) {
         // Write error, copy events to local cache.
+        ++mWriteFailures;
         if (index_wake_up_event >= 0) {
             // If there was a wake_up sensor_event, reset the flag.
             scratch[index_wake_up_event].flags &= ~WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
@@ -436,6 +548,33 @@ status_t SensorService::SensorEventConnection::sendEvents(
     return size < 0 ? status_t(size) : status_t(NO_ERROR);
 }
 
+bool SensorService::SensorEventConnection::canSendEventsDirectlyLocked(
+        sensors_event_t const* buffer, size_t numEvents) {
+    if (!hasSensorAccess()) {
+        return false;
+    }
+    for (size_t i = 0; i < numEvents; i++) {
+        const sensors_event_t& event = buffer[i];
+        if (event.type == SENSOR_TYPE_META_DATA) {
+            // Flush-complete events are only delivered to the connection that
+            // requested the flush.
+            return false;
+        }
+        const auto info = mSensorInfo.find(event.sensor);
+        if (info == mSensorInfo.end() || info->second.mFirstFlushPending) {
+            return false;
+        }
+        if (mHandleToAppOp.find(event.sensor) != mHandleToAppOp.end()) {
+            return false;
+        }
+        if (mService->isWakeUpSensorEvent(event)) {
+            // Wake-up events need the ACK flag set on a mutable copy.
+            return false;
+        }
+    }
+    return true;
+}
+
 bool SensorService::SensorEventConnection::hasSensorAccess() {
     return mService->isUidActive(mUid)
         && !mService->mSensorPrivacyPolicy->isSensorPrivacyEnabled();
@@ -472,9 +611,12 @@ void SensorService::SensorEventConnection::reAllocateCacheLocked(sensors_event_t
                                                                  int count) {
     sensors_event_t *eventCache_new;
     const int new_cache_size = computeMaxCacheSizeLocked();
-    // Allocate new cache, copy over events from the old cache & scratch, free up memory.
+    // Allocate new cache, linearize the ring and scratch into it, free up memory.
     eventCache_new = new sensors_event_t[new_cache_size];
-    memcpy(eventCache_new, mEventCache, mCacheSize * sizeof(sensors_event_t));
+    const int contiguous = std::min(mCacheSize, mMaxCacheSize - mCacheStart);
+    memcpy(eventCache_new, &mEventCache[mCacheStart], contiguous * sizeof(sensors_event_t));
+    memcpy(&eventCache_new[contiguous], mEventCache,
+            (mCacheSize - contiguous) * sizeof(sensors_event_t));
     memcpy(&eventCache_new[mCacheSize], scratch, count * sizeof(sensors_event_t));
 
     ALOGD_IF(DEBUG_CONNECTIONS, "reAllocateCacheLocked maxCacheSize=%d %d", mMaxCacheSize,
@@ -482,68 +624,101 @@ void SensorService::SensorEventConnection::reAllocateCacheLocked(sensors_event_t
 
     delete[] mEventCache;
     mEventCache = eventCache_new;
+    mCacheStart = 0;
     mCacheSize += count;
     mMaxCacheSize = new_cache_size;
+    if (mCacheSize > mCacheHighWaterMark) {
+        mCacheHighWaterMark = mCacheSize;
+    }
+}
+
+int SensorService::SensorEventConnection::ringIndexLocked(int index) const {
+    return index >= mMaxCacheSize ? index - mMaxCacheSize : index;
 }
 
 void SensorService::SensorEventConnection::appendEventsToCacheLocked(sensors_event_t const* events,
                                                                      int count) {
     if (count <= 0) {
         return;
-    } else if (mCacheSize + count <= mMaxCacheSize) {
-        // The events fit within the current cache: add them
-        memcpy(&mEventCache[mCacheSize], events, count * sizeof(sensors_event_t));
-        mCacheSize += count;
-    } else if (mCacheSize + count <= computeMaxCacheSizeLocked()) {
-        // The events fit within a resized cache: resize the cache and add the events
-        reAllocateCacheLocked(events, count);
-    } else {
-        // The events do not fit within the cache: drop the oldest events.
-        int freeSpace = mMaxCacheSize - mCacheSize;
+    }
 
-        // Drop up to the currently cached number of events to make room for new events
-        int cachedEventsToDrop = std::min(mCacheSize, count - freeSpace);
+    if (mCacheSize + count > mMaxCacheSize) {
+        if (mCacheSize + count <= computeMaxCacheSizeLocked()) {
+            // The events fit within a resized cache: resize the cache and add the events
+            reAllocateCacheLocked(events, count);
+            return;
+        }
+
+        // The events do not fit within the cache: drop the oldest events.
+        int cachedEventsToDrop = std::min(mCacheSize, mCacheSize + count - mMaxCacheSize);
 
         // New events need to be dropped if there are more new events than the size of the cache
         int newEventsToDrop = std::max(0, count - mMaxCacheSize);
 
-        // Determine the number of new events to copy into the cache
-        int eventsToCopy = std::min(mMaxCacheSize, count);
-
         constexpr nsecs_t kMinimumTimeBetweenDropLogNs = 2 * 1000 * 1000 * 1000; // 2 sec
         if (events[0].timestamp - mTimeOfLastEventDrop > kMinimumTimeBetweenDropLogNs) {
             ALOGW("Dropping %d cached events (%d/%d) to save %d/%d new events. %d events previously"
-                    " dropped", cachedEventsToDrop, mCacheSize, mMaxCacheSize, eventsToCopy,
-                    count, mEventsDropped);
+                    " dropped", cachedEventsToDrop, mCacheSize, mMaxCacheSize,
+                    count - newEventsToDrop, count, mEventsDropped);
             mEventsDropped = 0;
             mTimeOfLastEventDrop = events[0].timestamp;
         } else {
             // Record the number dropped
             mEventsDropped += cachedEventsToDrop + newEventsToDrop;
         }
+        mTotalEventsDropped += cachedEventsToDrop + newEventsToDrop;
 
-        // Check for any flush complete events in the events that will be dropped
-        countFlushCompleteEventsLocked(mEventCache, cachedEventsToDrop);
+        // Check for any flush complete events in the events that will be dropped.  The
+        // dropped cached events form up to two contiguous runs of the ring.
+        const int contiguous = std::min(cachedEventsToDrop, mMaxCacheSize - mCacheStart);
+        countFlushCompleteEventsLocked(&mEventCache[mCacheStart], contiguous);
+        countFlushCompleteEventsLocked(mEventCache, cachedEventsToDrop - contiguous);
         countFlushCompleteEventsLocked(events, newEventsToDrop);
 
-        // Only shift the events if they will not all be overwritten
-        if (eventsToCopy != mMaxCacheSize) {
-            memmove(mEventCache, &mEventCache[cachedEventsToDrop],
-                    (mCacheSize - cachedEventsToDrop) * sizeof(sensors_event_t));
-        }
+        // Dropping the oldest cached events just advances the head of the ring.
+        mCacheStart = ringIndexLocked(mCacheStart + cachedEventsToDrop);
         mCacheSize -= cachedEventsToDrop;
+        events += newEventsToDrop;
+        count -= newEventsToDrop;
+    }
 
-        // Copy the events into the cache
-        memcpy(&mEventCache[mCacheSize], &events[newEventsToDrop],
-                eventsToCopy * sizeof(sensors_event_t));
-        mCacheSize += eventsToCopy;
+    // Copy the events into the ring, wrapping at the end of the buffer.
+    const int tail = ringIndexLocked(mCacheStart + mCacheSize);
+    const int contiguous = std::min(count, mMaxCacheSize - tail);
+    memcpy(&mEventCache[tail], events, contiguous * sizeof(sensors_event_t));
+    memcpy(mEventCache, events + contiguous, (count - contiguous) * sizeof(sensors_event_t));
+    mCacheSize += count;
+    if (mCacheSize > mCacheHighWaterMark) {
+        mCacheHighWaterMark = mCacheSize;
     }
 }
 
 void SensorService::SensorEventConnection::sendPendingFlushEventsLocked() {
-    ASensorEvent flushCompleteEvent;
-    memset(&flushCompleteEvent, 0, sizeof(flushCompleteEvent));
-    flushCompleteEvent.type = SENSOR_TYPE_META_DATA;
+    // Batch pending flush complete events into as few socket writes as possible.  A packet
+    // carries at most one event with the wake-up ACK flag set because the receiver
+    // acknowledges once per packet, so a wake-up flush always terminates its packet.
+    ASensorEvent batch[kMaxFlushCompleteEventsPerWrite];
+    int count = 0;
+
+    auto writeBatch = [&]() -> bool {
+        const bool wakeUp = (batch[count - 1].flags & WAKE_UP_SENSOR_EVENT_NEEDS_ACK) != 0;
+        if (wakeUp) {
+            ++mWakeLockRefCount;
+        }
+        ssize_t size = SensorEventQueue::write(mChannel, batch, count);
+        if (size < 0) {
+            if (wakeUp) --mWakeLockRefCount;
+            return false;
+        }
+        for (int i = 0; i < count; ++i) {
+            mSensorInfo[batch[i].meta_data.sensor].mPendingFlushEventsToSend--;
+            ALOGD_IF(DEBUG_CONNECTIONS, "sent dropped flush complete event==%d ",
+                    batch[i].meta_data.sensor);
+        }
+        count = 0;
+        return true;
+    };
+
     // Loop through all the sensors for this connection and check if there are any pending
     // flush complete events to be sent.
     for (auto& it : mSensorInfo) {
@@ -552,43 +727,50 @@ void SensorService::SensorEventConnection::sendPendingFlushEventsLocked() {
         if (si == nullptr) {
             continue;
         }
+        const bool wakeUpSensor = si->getSensor().isWakeUpSensor();
 
-        FlushInfo& flushInfo = it.second;
-        while (flushInfo.mPendingFlushEventsToSend > 0) {
+        for (int pending = it.second.mPendingFlushEventsToSend; pending > 0; --pending) {
+            ASensorEvent& flushCompleteEvent = batch[count++];
+            memset(&flushCompleteEvent, 0, sizeof(flushCompleteEvent));
+            flushCompleteEvent.type = SENSOR_TYPE_META_DATA;
             flushCompleteEvent.meta_data.sensor = handle;
-            bool wakeUpSensor = si->getSensor().isWakeUpSensor();
             if (wakeUpSensor) {
-               ++mWakeLockRefCount;
-               flushCompleteEvent.flags |= WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
+                flushCompleteEvent.flags |= WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
             }
-            ssize_t size = SensorEventQueue::write(mChannel, &flushCompleteEvent, 1);
-            if (size < 0) {
-                if (wakeUpSensor) --mWakeLockRefCount;
-                return;
+            if (count == kMaxFlushCompleteEventsPerWrite || wakeUpSensor) {
+                if (!writeBatch()) {
+                    return;
+                }
             }
-            ALOGD_IF(DEBUG_CONNECTIONS, "sent dropped flush complete event==%d ",
-                    flushCompleteEvent.meta_data.sensor);
-            flushInfo.mPendingFlushEventsToSend--;
         }
     }
+    if (count > 0) {
+        writeBatch();
+    }
 }
 
 void SensorService::SensorEventConnection::writeToSocketFromCache() {
+    Mutex::Autolock _l(mConnectionLock);
+    writeToSocketFromCacheLocked();
+}
+
+void SensorService::SensorEventConnection::writeToSocketFromCacheLocked() {
     // At a time write at most half the size of the receiver buffer in SensorEventQueue OR
     // half the size of the socket buffer allocated in BitTube whichever is smaller.
     const int maxWriteSize = helpers::min(SensorEventQueue::MAX_RECEIVE_BUFFER_EVENT_COUNT/2,
             int(mService->mSocketBufferSize/(sizeof(sensors_event_t)*2)));
-    Mutex::Autolock _l(mConnectionLock);
     // Send pending flush complete events (if any)
     sendPendingFlushEventsLocked();
-    for (int numEventsSent = 0; numEventsSent < mCacheSize;) {
-        const int numEventsToWrite = helpers::min(mCacheSize - numEventsSent, maxWriteSize);
+    while (mCacheSize > 0) {
+        // Write contiguous runs of the ring; a run never extends past the end of the buffer.
+        const int numEventsToWrite = helpers::min(helpers::min(mCacheSize, maxWriteSize),
+                mMaxCacheSize - mCacheStart);
         int index_wake_up_event = -1;
         if (hasSensorAccess()) {
             index_wake_up_event =
-                      findWakeUpSensorEventLocked(mEventCache + numEventsSent, numEventsToWrite);
+                      findWakeUpSensorEventLocked(mEventCache + mCacheStart, numEventsToWrite);
             if (index_wake_up_event >= 0) {
-                mEventCache[index_wake_up_event + numEventsSent].flags |=
+                mEventCache[index_wake_up_event + mCacheStart].flags |=
                         WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
                 ++mWakeLockRefCount;
 #if DEBUG_CONNECTIONS
@@ -598,12 +780,12 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
         }
 
         ssize_t size = SensorEventQueue::write(mChannel,
-                          reinterpret_cast<ASensorEvent const*>(mEventCache + numEventsSent),
+                          reinterpret_cast<ASensorEvent const*>(mEventCache + mCacheStart),
                           numEventsToWrite);
         if (size < 0) {
             if (index_wake_up_event >= 0) {
                 // If there was a wake_up sensor_event, reset the flag.
-                mEventCache[index_wake_up_event + numEventsSent].flags  &=
+                mEventCache[index_wake_up_event + mCacheStart].flags  &=
                         ~WAKE_UP_SENSOR_EVENT_NEEDS_ACK;
                 if (mWakeLockRefCount > 0) {
                     --mWakeLockRefCount;
@@ -612,21 +794,21 @@ void SensorService::SensorEventConnection::writeToSocketFromCache() {
                 --mTotalAcksNeeded;
 #endif
             }
-            memmove(mEventCache, &mEventCache[numEventsSent],
-                                 (mCacheSize - numEventsSent) * sizeof(sensors_event_t));
-            ALOGD_IF(DEBUG_CONNECTIONS, "wrote %d events from cache size==%d ",
-                    numEventsSent, mCacheSize);
-            mCacheSize -= numEventsSent;
+            // The events written so far were already consumed off the head of the ring,
+            // so there is nothing to shift; the remainder stays in place.
+            ++mWriteFailures;
+            ALOGD_IF(DEBUG_CONNECTIONS, "wrote partial cache, remaining size==%d ", mCacheSize);
             return;
         }
-        numEventsSent += numEventsToWrite;
+        mCacheStart = ringIndexLocked(mCacheStart + numEventsToWrite);
+        mCacheSize -= numEventsToWrite;
 #if DEBUG_CONNECTIONS
         mEventsSentFromCache += numEventsToWrite;
 #endif
     }
-    ALOGD_IF(DEBUG_CONNECTIONS, "wrote all events from cache size=%d ", mCacheSize);
-    // All events from the cache have been sent. Reset cache size to zero.
-    mCacheSize = 0;
+    ALOGD_IF(DEBUG_CONNECTIONS, "wrote all events from cache");
+    // All events from the cache have been sent. Reset the ring to the start of the buffer.
+    mCacheStart = 0;
     // There are no more events in the cache. We don't need to poll for write on the fd.
     // Update Looper registration.
     updateLooperRegistrationLocked(mService->getLooper());
@@ -61,6 +61,9 @@ public:
     bool removeSensor(int32_t handle);
     std::vector<int32_t> getActiveSensorHandles() const;
     void setFirstFlushPending(int32_t handle, bool value);
+    // Recompute the batched delivery window from the max report latencies this connection
+    // requested in SensorDevice. Must be called after the batch parameters change.
+    void updateBatchedDeliveryWindow();
     void dump(String8& result);
     void dump(util::ProtoOutputStream* proto) const;
     bool needsWakeLock();
@@ -91,6 +94,13 @@ private:
     // flag set. SOCK_SEQPACKET ensures that either the entire packet is read or dropped.
     int findWakeUpSensorEventLocked(sensors_event_t const* scratch, int count);
 
+    // Returns true if every event in the buffer would be delivered to this connection
+    // unmodified: no flush-complete events, every sensor registered with no pending
+    // first flush, no AppOp checks and no wake-up flag rewrites.  In that case the
+    // events can be written to the socket straight from the shared buffer without
+    // staging them through the scratch area.
+    bool canSendEventsDirectlyLocked(sensors_event_t const* buffer, size_t numEvents);
+
     // Send pending flush_complete events. There may have been flush_complete_events that are
     // dropped which need to be sent separately before other events. On older HALs (1_0) this method
     // emulates the behavior of flush().
@@ -98,6 +108,10 @@ private:
 
     // Writes events from mEventCache to the socket.
     void writeToSocketFromCache();
+    void writeToSocketFromCacheLocked();
+
+    // See updateBatchedDeliveryWindow().
+    void updateBatchedDeliveryWindowLocked();
 
     // Compute the approximate cache size from the FIFO sizes of various sensors registered for this
     // connection. Wake up and non-wake up sensors have separate FIFOs but FIFO may be shared
@@ -108,10 +122,13 @@ private:
     // size, reallocate memory and copy over events from the older cache.
     void reAllocateCacheLocked(sensors_event_t const* scratch, int count);
 
-    // Add the events to the cache. If the cache would be exceeded, drop events at the beginning of
-    // the cache.
+    // Add the events to the cache. If the cache would be exceeded, drop the oldest events by
+    // advancing the head of the ring.
     void appendEventsToCacheLocked(sensors_event_t const* events, int count);
 
+    // Reduce a ring index that may have run past the end of mEventCache back into range.
+    int ringIndexLocked(int index) const;
+
     // LooperCallback method. If there is data to read on this fd, it is an ack from the app that it
     // has read events from a wake up sensor, decrement mWakeLockRefCount.  If this fd is available
     // for writing send the data from the cache.
@@ -171,10 +188,29 @@ private:
     // protected by SensorService::mLock. Key for this map is the sensor handle.
     std::unordered_map<int32_t, FlushInfo> mSensorInfo;
 
+    // Circular buffer of events that could not be delivered to the socket yet.  mCacheStart
+    // indexes the oldest cached event; dropping old events or draining a prefix advances the
+    // head instead of copying the remaining events down.  Guarded by mConnectionLock.
     sensors_event_t *mEventCache;
+    int mCacheStart;
     int mCacheSize, mMaxCacheSize;
     int64_t mTimeOfLastEventDrop;
     int mEventsDropped;
+
+    // Cumulative backpressure statistics reported in dump().  Unlike mEventsDropped, which is
+    // reset every time a drop is logged, these are never reset for the lifetime of the
+    // connection.
+    uint32_t mTotalEventsDropped;
+    uint32_t mWriteFailures;
+    int mCacheHighWaterMark;
+
+    // Batched delivery: when every sensor registered on this connection tolerates a non-zero
+    // max report latency, incoming events are parked in mEventCache and written to the socket
+    // once per window instead of once per HAL batch. The window is the smallest latency
+    // requested across the connection's sensors; it is zero (disabled) when any sensor was
+    // registered for continuous delivery. Both guarded by mConnectionLock.
+    nsecs_t mBatchedDeliveryWindowNs;
+    nsecs_t mNextBatchedDeliveryTime;
     String8 mPackageName;
     const String16 mOpPackageName;
     int mTargetSdk;
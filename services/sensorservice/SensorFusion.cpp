@@ -39,6 +39,11 @@ SensorFusion::SensorFusion()
     mEnabled[FUSION_NOMAG] = false;
     mEnabled[FUSION_NOGYRO] = false;
 
+    for (int i = 0; i < NUM_FUSION_MODE; ++i) {
+        mWarmStartTime[i] = 0;
+        mHasWarmStartBias[i] = false;
+    }
+
     if (count > 0) {
         for (size_t i=0 ; i<size_t(count) ; i++) {
             if (list[i].type == SENSOR_TYPE_ACCELEROMETER) {
@@ -123,6 +128,31 @@ void SensorFusion::process(const sensors_event_t& event) {
 template <typename T> inline T min(T a, T b) { return a<b ? a : b; }
 template <typename T> inline T max(T a, T b) { return a>b ? a : b; }
 
+// A saved gyro bias estimate older than this is discarded entirely; within the window it
+// is faded linearly towards zero since the bias drifts with temperature and aging.
+static const nsecs_t WARM_START_BIAS_MAX_AGE_NS = 3600LL * 1000000000LL;  // 1 hour
+
+void SensorFusion::saveWarmStartBias(int mode) {
+    if (mFusions[mode].hasEstimate()) {
+        mWarmStartBias[mode] = mFusions[mode].getBias();
+        mWarmStartTime[mode] = systemTime(SYSTEM_TIME_MONOTONIC);
+        mHasWarmStartBias[mode] = true;
+    }
+}
+
+void SensorFusion::applyWarmStartBias(int mode) {
+    if (!mHasWarmStartBias[mode]) {
+        return;
+    }
+    const nsecs_t age = systemTime(SYSTEM_TIME_MONOTONIC) - mWarmStartTime[mode];
+    if (age < 0 || age >= WARM_START_BIAS_MAX_AGE_NS) {
+        mHasWarmStartBias[mode] = false;
+        return;
+    }
+    const float weight = 1.0f - float(age) / float(WARM_START_BIAS_MAX_AGE_NS);
+    mFusions[mode].setInitialBias(mWarmStartBias[mode] * weight);
+}
+
 status_t SensorFusion::activate(int mode, void* ident, bool enabled) {
 
     ALOGD_IF(DEBUG_CONNECTIONS,
@@ -145,6 +175,9 @@ status_t SensorFusion::activate(int mode, void* ident, bool enabled) {
         mEnabled[mode] = newState;
         if (newState) {
             mFusions[mode].init(mode);
+            applyWarmStartBias(mode);
+        } else {
+            saveWarmStartBias(mode);
         }
     }
 
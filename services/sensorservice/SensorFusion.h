@@ -58,6 +58,16 @@ class SensorFusion : public Singleton<SensorFusion> {
     nsecs_t mGyroTime;
     nsecs_t mAccTime;
 
+    // Warm start: the converged gyro bias estimate is saved when the last client of a
+    // fusion mode goes away and seeded back into the filter on the next enable, so an
+    // enable/disable cycle does not pay the multi-second bias convergence again.
+    vec3_t mWarmStartBias[NUM_FUSION_MODE];
+    nsecs_t mWarmStartTime[NUM_FUSION_MODE];
+    bool mHasWarmStartBias[NUM_FUSION_MODE];
+
+    void saveWarmStartBias(int mode);
+    void applyWarmStartBias(int mode);
+
     SensorFusion();
 
 public:
@@ -19,6 +19,8 @@
 #include <binder/ActivityManager.h>
 #include <binder/BinderService.h>
 #include <binder/IServiceManager.h>
+#include <binder/MemoryBase.h>
+#include <binder/MemoryHeapBase.h>
 #include <binder/PermissionCache.h>
 #include <binder/PermissionController.h>
 #include <cutils/ashmem.h>
@@ -55,6 +57,7 @@
 #include <math.h>
 #include <sched.h>
 #include <stdint.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -94,7 +97,7 @@ static const String16 sManageSensorsPermission("android.permission.MANAGE_SENSOR
 
 SensorService::SensorService()
     : mInitCheck(NO_INIT), mSocketBufferSize(SOCKET_BUFFER_SIZE_NON_BATCHED),
-      mWakeLockAcquired(false) {
+      mWakeLockAcquired(false), mSensorListMemoryVersion(0), mSensorListMemoryIsDebug(false) {
     mUidPolicy = new UidPolicy(this);
     mSensorPrivacyPolicy = new SensorPrivacyPolicy(this);
 }
@@ -342,10 +345,12 @@ const Sensor& SensorService::registerSensor(SensorInterface* s, bool isDebug, bo
 }
 
 const Sensor& SensorService::registerDynamicSensorLocked(SensorInterface* s, bool isDebug) {
+    invalidateSensorListMemory();
     return registerSensor(s, isDebug);
 }
 
 bool SensorService::unregisterDynamicSensorLocked(int handle) {
+    invalidateSensorListMemory();
     bool ret = mSensors.remove(handle);
 
     const auto i = mRecentEvent.find(handle);
@@ -1080,17 +1085,31 @@ bool SensorService::SensorEventAckReceiver::threadLoop() {
 
 void SensorService::recordLastValueLocked(
         const sensors_event_t* buffer, size_t count) {
-    for (size_t i = 0; i < count; i++) {
-        if (buffer[i].type == SENSOR_TYPE_META_DATA ||
-            buffer[i].type == SENSOR_TYPE_DYNAMIC_SENSOR_META ||
-            buffer[i].type == SENSOR_TYPE_ADDITIONAL_INFO) {
+    auto isLoggable = [](const sensors_event_t& event) {
+        return event.type != SENSOR_TYPE_META_DATA &&
+                event.type != SENSOR_TYPE_DYNAMIC_SENSOR_META &&
+                event.type != SENSOR_TYPE_ADDITIONAL_INFO;
+    };
+
+    // High-rate sensors deliver runs of consecutive events from the same sensor; record
+    // each run with one logger lookup and one bulk append instead of per-event calls.
+    for (size_t i = 0; i < count;) {
+        if (!isLoggable(buffer[i])) {
+            i++;
             continue;
         }
 
-        auto logger = mRecentEvent.find(buffer[i].sensor);
+        const int32_t sensor = buffer[i].sensor;
+        size_t end = i + 1;
+        while (end < count && buffer[end].sensor == sensor && isLoggable(buffer[end])) {
+            end++;
+        }
+
+        auto logger = mRecentEvent.find(sensor);
         if (logger != mRecentEvent.end()) {
-            logger->second->addEvent(buffer[i]);
+            logger->second->addEvents(buffer + i, end - i);
         }
+        i = end;
     }
 }
 
@@ -1216,6 +1235,64 @@ Vector<Sensor> SensorService::getSensorList(const String16& /* opPackageName */)
     return accessibleSensorList;
 }
 
+sp<IMemory> SensorService::getSensorListMemory() {
+    Mutex::Autolock _l(mSensorListMemoryLock);
+
+    // getSensorList() honors debug.sensors per call, so a snapshot built
+    // under the other setting is stale and gets rebuilt here.
+    char value[PROPERTY_VALUE_MAX];
+    property_get("debug.sensors", value, "0");
+    const bool isDebug = atoi(value) != 0;
+    if (mSensorListMemory != nullptr && isDebug == mSensorListMemoryIsDebug) {
+        return mSensorListMemory;
+    }
+    mSensorListMemory.clear();
+
+    const Vector<Sensor> sensors = getSensorList(String16());
+    size_t payloadSize = 0;
+    for (const Sensor& sensor : sensors) {
+        payloadSize += sizeof(uint32_t) + sensor.getFlattenedSize();
+    }
+
+    const size_t memorySize = sizeof(SensorListMemoryHeader) + payloadSize;
+    sp<MemoryHeapBase> heap =
+            new MemoryHeapBase(memorySize, MemoryHeapBase::READ_ONLY, "SensorListSnapshot");
+    void* const heapBase = heap->getBase();
+    if (heapBase == nullptr || heapBase == MAP_FAILED) {
+        ALOGE("getSensorListMemory: cannot allocate %zu byte snapshot", memorySize);
+        return nullptr;
+    }
+
+    SensorListMemoryHeader header;
+    header.magic = SensorListMemoryHeader::MAGIC;
+    header.version = ++mSensorListMemoryVersion;
+    header.count = static_cast<uint32_t>(sensors.size());
+    header.payloadSize = static_cast<uint32_t>(payloadSize);
+
+    uint8_t* p = static_cast<uint8_t*>(heapBase);
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    for (const Sensor& sensor : sensors) {
+        const uint32_t recordSize = static_cast<uint32_t>(sensor.getFlattenedSize());
+        memcpy(p, &recordSize, sizeof(recordSize));
+        p += sizeof(recordSize);
+        if (sensor.flatten(p, recordSize) != NO_ERROR) {
+            ALOGE("getSensorListMemory: cannot flatten sensor %s", sensor.getName().string());
+            return nullptr;
+        }
+        p += recordSize;
+    }
+
+    mSensorListMemory = new MemoryBase(heap, 0, memorySize);
+    mSensorListMemoryIsDebug = isDebug;
+    return mSensorListMemory;
+}
+
+void SensorService::invalidateSensorListMemory() {
+    Mutex::Autolock _l(mSensorListMemoryLock);
+    mSensorListMemory.clear();
+}
+
 Vector<Sensor> SensorService::getDynamicSensorList(const String16& opPackageName) {
     Vector<Sensor> accessibleSensorList;
     mSensors.forEachSensor(
@@ -1666,6 +1743,7 @@ status_t SensorService::enable(const sp<SensorEventConnection>& connection,
 
     if (err == NO_ERROR) {
         connection->updateLooperRegistration(mLooper);
+        connection->updateBatchedDeliveryWindow();
 
         if (sensor->getSensor().getRequiredPermission().size() > 0 &&
                 sensor->getSensor().getRequiredAppOp() >= 0) {
@@ -1752,7 +1830,13 @@ status_t SensorService::setEventRate(const sp<SensorEventConnection>& connection
         ns = minDelayNs;
     }
 
-    return sensor->setDelay(connection.get(), handle, ns);
+    status_t err = sensor->setDelay(connection.get(), handle, ns);
+    if (err == NO_ERROR) {
+        // setDelay() rewrites the batch parameters with a zero report latency, so the
+        // connection's delivery window has to be recomputed.
+        connection->updateBatchedDeliveryWindow();
+    }
+    return err;
 }
 
 status_t SensorService::flushSensor(const sp<SensorEventConnection>& connection,
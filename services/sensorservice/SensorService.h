@@ -284,6 +284,7 @@ private:
     // ISensorServer interface
     virtual Vector<Sensor> getSensorList(const String16& opPackageName);
     virtual Vector<Sensor> getDynamicSensorList(const String16& opPackageName);
+    virtual sp<IMemory> getSensorListMemory();
     virtual sp<ISensorEventConnection> createSensorEventConnection(
             const String8& packageName,
             int requestedMode, const String16& opPackageName);
@@ -349,6 +350,11 @@ private:
     status_t resetToNormalMode();
     status_t resetToNormalModeLocked();
 
+    // Drops the shared-memory sensor list snapshot so the next
+    // getSensorListMemory() call rebuilds it with a bumped version, e.g.
+    // after a dynamic sensor connects or disconnects.
+    void invalidateSensorListMemory();
+
     // Transforms the UUIDs for all the sensors into proper IDs.
     void makeUuidsIntoIdsForSensorList(Vector<Sensor> &sensorList) const;
     // Gets the appropriate ID from the given UUID.
@@ -421,6 +427,14 @@ private:
     sp<UidPolicy> mUidPolicy;
     sp<SensorPrivacyPolicy> mSensorPrivacyPolicy;
 
+    // Shared-memory sensor list snapshot served to clients, rebuilt lazily
+    // after invalidateSensorListMemory(). Guarded by its own lock so client
+    // enumeration does not contend with the event loop on mLock.
+    mutable Mutex mSensorListMemoryLock;
+    sp<IMemory> mSensorListMemory;
+    uint32_t mSensorListMemoryVersion;
+    bool mSensorListMemoryIsDebug;
+
     static AppOpsManager sAppOpsManager;
     static std::map<String16, int> sPackageTargetVersion;
     static Mutex sPackageTargetVersionLock;
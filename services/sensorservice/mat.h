@@ -116,6 +116,16 @@ mat<TYPE, C, R> PURE doMul(
 }
 
 
+#if defined(__ARM_NEON)
+// Explicit float32x4 overloads for the 3x3 float multiplies. The sensor
+// fusion runs several of these per sample (the covariance blocks are mat33),
+// and the compiler does not vectorize the k-loop of the generic doMul above.
+// Being non-template exact matches, these win overload resolution over the
+// templates for mat33_t operands. Defined after mat<> below.
+inline mat<float, 3, 3> PURE doMul(const mat<float, 3, 3>& lhs, const mat<float, 3, 3>& rhs);
+inline vec<float, 3> PURE doMul(const mat<float, 3, 3>& lhs, const vec<float, 3>& rhs);
+#endif
+
 }; // namespace helpers
 
 // -----------------------------------------------------------------------
@@ -277,6 +287,51 @@ public:
     void operator << (const vec<TYPE, R>& rhs) { base::operator[](0) = rhs; }
 };
 
+// -----------------------------------------------------------------------
+
+#if defined(__ARM_NEON)
+
+namespace helpers {
+
+// Loads the three columns of a column-major 3x3 into q registers. Columns are
+// only three floats apart, so the first two 4-wide loads read one float into
+// the next column (still inside the matrix) and the last column is assembled
+// lane-wise to avoid reading past the end of the object.
+inline mat<float, 3, 3> PURE doMul(const mat<float, 3, 3>& lhs, const mat<float, 3, 3>& rhs) {
+    const float32x4_t c0 = vld1q_f32(&lhs[0][0]);
+    const float32x4_t c1 = vld1q_f32(&lhs[1][0]);
+    const float32x4_t c2 = vcombine_f32(vld1_f32(&lhs[2][0]), vdup_n_f32(lhs[2][2]));
+    mat<float, 3, 3> res;
+    float32x4_t v;
+    // The 4-wide stores spill lane 3 into the first float of the next column,
+    // which the following store then rewrites; the last column is stored
+    // narrow so nothing lands past the end of the result.
+    v = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(c0, rhs[0][0]), c1, rhs[0][1]), c2, rhs[0][2]);
+    vst1q_f32(&res[0][0], v);
+    v = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(c0, rhs[1][0]), c1, rhs[1][1]), c2, rhs[1][2]);
+    vst1q_f32(&res[1][0], v);
+    v = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(c0, rhs[2][0]), c1, rhs[2][1]), c2, rhs[2][2]);
+    vst1_f32(&res[2][0], vget_low_f32(v));
+    res[2][2] = vgetq_lane_f32(v, 2);
+    return res;
+}
+
+inline vec<float, 3> PURE doMul(const mat<float, 3, 3>& lhs, const vec<float, 3>& rhs) {
+    const float32x4_t c0 = vld1q_f32(&lhs[0][0]);
+    const float32x4_t c1 = vld1q_f32(&lhs[1][0]);
+    const float32x4_t c2 = vcombine_f32(vld1_f32(&lhs[2][0]), vdup_n_f32(lhs[2][2]));
+    const float32x4_t v =
+            vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(c0, rhs[0]), c1, rhs[1]), c2, rhs[2]);
+    vec<float, 3> res;
+    vst1_f32(&res[0], vget_low_f32(v));
+    res[2] = vgetq_lane_f32(v, 2);
+    return res;
+}
+
+}; // namespace helpers
+
+#endif // __ARM_NEON
+
 // -----------------------------------------------------------------------
 // matrix functions
 
@@ -295,6 +350,26 @@ mat<TYPE, R, C> PURE transpose(const mat<TYPE, C, R>& m) {
     return r;
 }
 
+// Multiply by a transposed matrix without materializing the transpose,
+// i.e. computes lhs * transpose(rhs).  Like transpose() this handles
+// matrices of matrices, transposing the inner elements as it goes.
+template <typename TYPE, size_t C, size_t R, size_t D>
+mat<TYPE, C, R> PURE multiplyByTranspose(
+        const mat<TYPE, D, R>& lhs,
+        const mat<TYPE, D, C>& rhs) {
+    mat<TYPE, C, R> res;
+    for (size_t c=0 ; c<C ; c++) {
+        for (size_t r=0 ; r<R ; r++) {
+            TYPE v(0);
+            for (size_t k=0 ; k<D ; k++) {
+                v += lhs[k][r] * transpose(rhs[k][c]);
+            }
+            res[c][r] = v;
+        }
+    }
+    return res;
+}
+
 // Calculate the trace of a matrix
 template <typename TYPE, size_t C> static TYPE trace(const mat<TYPE, C, C>& m) {
     TYPE t;
@@ -380,6 +455,32 @@ mat<T, N, N> PURE invert(const mat<T, N, N>& src) {
     return inverse;
 }
 
+// Closed-form inverse for the 3x3 float case.  The generic elimination above
+// spends most of its time pivoting; the adjugate form is branch-free and much
+// cheaper for the innovation covariance the sensor fusion inverts per update.
+inline mat<float, 3, 3> PURE invert(const mat<float, 3, 3>& src) {
+    const float a = src[0][0], b = src[1][0], c = src[2][0];
+    const float d = src[0][1], e = src[1][1], f = src[2][1];
+    const float g = src[0][2], h = src[1][2], i = src[2][2];
+
+    const float c00 =  (e*i - f*h);
+    const float c01 = -(d*i - f*g);
+    const float c02 =  (d*h - e*g);
+    const float invdet = 1.0f / (a*c00 + b*c01 + c*c02);
+
+    mat<float, 3, 3> dst;
+    dst[0][0] = c00 * invdet;
+    dst[1][0] = -(b*i - c*h) * invdet;
+    dst[2][0] =  (b*f - c*e) * invdet;
+    dst[0][1] = c01 * invdet;
+    dst[1][1] =  (a*i - c*g) * invdet;
+    dst[2][1] = -(a*f - c*d) * invdet;
+    dst[0][2] = c02 * invdet;
+    dst[1][2] = -(a*h - b*g) * invdet;
+    dst[2][2] =  (a*e - b*d) * invdet;
+    return dst;
+}
+
 // -----------------------------------------------------------------------
 
 typedef mat<float, 2, 2> mat22_t;
@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replay harness for sensorservice. Feeds a recorded (or synthetic) HAL
+// event stream through the data injection path at a controllable speed
+// multiplier while a configurable number of SensorEventConnections listen,
+// and reports throughput, delivery latency percentiles and drops per
+// connection. The recorded file is a flat array of ASensorEvent records,
+// i.e. the same event struct the HAL FMQ carries.
+//
+// The device must be switched into data injection mode first:
+//   adb shell dumpsys sensorservice data_injection .replay
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <android/sensor.h>
+#include <sensor/Sensor.h>
+#include <sensor/SensorEventQueue.h>
+#include <sensor/SensorManager.h>
+#include <utils/Looper.h>
+#include <utils/Timers.h>
+
+using namespace android;
+
+namespace {
+
+// Matches SensorService::Mode::DATA_INJECTION.
+constexpr int kDataInjectionMode = 1;
+
+struct ConnectionStats {
+    uint64_t received = 0;
+    std::vector<nsecs_t> latencies;
+};
+
+struct Options {
+    const char* file = nullptr;
+    double speed = 1.0;
+    int connections = 1;
+    int sensorType = ASENSOR_TYPE_GYROSCOPE;
+    // Synthetic stream parameters, used when no file is given.
+    int rateHz = 2000;
+    int durationSec = 5;
+};
+
+void consumerLoop(const sp<SensorEventQueue>& queue, const std::atomic<bool>& done,
+                  ConnectionStats* stats) {
+    sp<Looper> looper = new Looper(true /* allowNonCallbacks */);
+    looper->addFd(queue->getFd(), 0, ALOOPER_EVENT_INPUT, nullptr, nullptr);
+
+    ASensorEvent buffer[64];
+    while (!done.load()) {
+        looper->pollOnce(50 /* ms */);
+        ssize_t n;
+        while ((n = queue->read(buffer, 64)) > 0) {
+            const nsecs_t now = systemTime();
+            for (ssize_t i = 0; i < n; i++) {
+                stats->received++;
+                stats->latencies.push_back(now - buffer[i].timestamp);
+            }
+        }
+    }
+}
+
+double percentileMs(std::vector<nsecs_t>& latencies, double p) {
+    if (latencies.empty()) {
+        return 0.0;
+    }
+    return double(latencies[size_t(p * (latencies.size() - 1))]) / 1e6;
+}
+
+std::vector<ASensorEvent> loadEvents(const Options& opts, const Sensor& sensor) {
+    std::vector<ASensorEvent> events;
+
+    if (opts.file != nullptr) {
+        FILE* f = fopen(opts.file, "r");
+        if (f == nullptr) {
+            fprintf(stderr, "cannot open %s\n", opts.file);
+            return events;
+        }
+        ASensorEvent event;
+        while (fread(&event, sizeof(event), 1, f) == 1) {
+            // Retarget the recorded stream at the locally selected sensor;
+            // handles are not stable across devices.
+            event.sensor = sensor.getHandle();
+            event.type = sensor.getType();
+            events.push_back(event);
+        }
+        fclose(f);
+        return events;
+    }
+
+    // No recording: synthesize a constant-rate stream.
+    const nsecs_t period = s2ns(1) / opts.rateHz;
+    const size_t count = size_t(opts.rateHz) * opts.durationSec;
+    events.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        ASensorEvent event;
+        memset(&event, 0, sizeof(event));
+        event.version = sizeof(ASensorEvent);
+        event.sensor = sensor.getHandle();
+        event.type = sensor.getType();
+        event.timestamp = nsecs_t(i) * period;
+        event.data[0] = 0.1f;
+        event.data[1] = 0.2f;
+        event.data[2] = 0.3f;
+        events.push_back(event);
+    }
+    return events;
+}
+
+void showHelp(const char* cmd) {
+    fprintf(stderr, "usage: %s [options]\n", cmd);
+    fprintf(stderr,
+            "  -f FILE   replay FILE (flat ASensorEvent records); default synthetic\n"
+            "  -x N      speed multiplier (default 1.0)\n"
+            "  -c N      number of listening connections (default 1)\n"
+            "  -t TYPE   sensor type to target (default gyroscope)\n"
+            "  -r HZ     synthetic stream rate (default 2000)\n"
+            "  -d SEC    synthetic stream duration (default 5)\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opts;
+
+    int c;
+    while ((c = getopt(argc, argv, "f:x:c:t:r:d:h")) != -1) {
+        switch (c) {
+            case 'f': opts.file = optarg; break;
+            case 'x': opts.speed = atof(optarg); break;
+            case 'c': opts.connections = atoi(optarg); break;
+            case 't': opts.sensorType = atoi(optarg); break;
+            case 'r': opts.rateHz = atoi(optarg); break;
+            case 'd': opts.durationSec = atoi(optarg); break;
+            case 'h':
+            default:
+                showHelp(argv[0]);
+                return c == 'h' ? 0 : 2;
+        }
+    }
+    if (opts.speed <= 0 || opts.connections < 1) {
+        showHelp(argv[0]);
+        return 2;
+    }
+
+    SensorManager& mgr = SensorManager::getInstanceForPackage(String16(".replay"));
+    if (!mgr.isDataInjectionEnabled()) {
+        fprintf(stderr,
+                "sensorservice is not in data injection mode; run\n"
+                "  adb shell dumpsys sensorservice data_injection .replay\n");
+        return 1;
+    }
+
+    Sensor const* const* sensorList;
+    ssize_t count = mgr.getSensorList(&sensorList);
+    const Sensor* sensor = nullptr;
+    for (ssize_t i = 0; i < count; i++) {
+        if (sensorList[i]->getType() == opts.sensorType) {
+            sensor = sensorList[i];
+            break;
+        }
+    }
+    if (sensor == nullptr) {
+        fprintf(stderr, "no sensor of type %d\n", opts.sensorType);
+        return 1;
+    }
+
+    std::vector<ASensorEvent> events = loadEvents(opts, *sensor);
+    if (events.empty()) {
+        fprintf(stderr, "nothing to replay\n");
+        return 1;
+    }
+
+    // Start the listening connections before injecting.
+    std::atomic<bool> done(false);
+    std::vector<sp<SensorEventQueue>> queues;
+    std::vector<ConnectionStats> stats(opts.connections);
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < opts.connections; i++) {
+        sp<SensorEventQueue> queue = mgr.createEventQueue();
+        if (queue == nullptr || queue->enableSensor(sensor) != NO_ERROR) {
+            fprintf(stderr, "failed to create connection %d\n", i);
+            return 1;
+        }
+        queues.push_back(queue);
+        consumers.emplace_back(consumerLoop, queue, std::cref(done), &stats[i]);
+    }
+
+    sp<SensorEventQueue> injectionQueue = mgr.createEventQueue(String8(".replay"),
+                                                               kDataInjectionMode);
+    if (injectionQueue == nullptr) {
+        fprintf(stderr, "failed to create injection queue\n");
+        return 1;
+    }
+
+    // Replay, preserving the recorded inter-event gaps scaled by the speed
+    // multiplier. Timestamps are rewritten to injection time so listeners
+    // can measure delivery latency.
+    const nsecs_t replayStart = systemTime();
+    const nsecs_t recordingStart = events[0].timestamp;
+    uint64_t injected = 0;
+    uint64_t injectErrors = 0;
+    for (ASensorEvent& event : events) {
+        const nsecs_t offset = nsecs_t(double(event.timestamp - recordingStart) / opts.speed);
+        const nsecs_t target = replayStart + offset;
+        const nsecs_t now = systemTime();
+        if (target > now) {
+            usleep(ns2us(target - now));
+        }
+
+        event.timestamp = systemTime();
+        if (injectionQueue->injectSensorEvent(event) == NO_ERROR) {
+            injected++;
+        } else {
+            injectErrors++;
+        }
+    }
+    const nsecs_t replayDuration = systemTime() - replayStart;
+
+    // Let in-flight events drain before stopping the consumers.
+    usleep(500 * 1000);
+    done.store(true);
+    for (std::thread& consumer : consumers) {
+        consumer.join();
+    }
+    for (const sp<SensorEventQueue>& queue : queues) {
+        queue->disableSensor(sensor);
+    }
+
+    printf("injected %" PRIu64 " events in %.3f s (%.0f ev/s), %" PRIu64 " inject errors\n",
+           injected, replayDuration / 1e9, injected / (replayDuration / 1e9), injectErrors);
+    printf(" conn | received |  drops | ev/s   | p50 ms | p95 ms | p99 ms\n");
+    for (int i = 0; i < opts.connections; i++) {
+        std::sort(stats[i].latencies.begin(), stats[i].latencies.end());
+        const uint64_t drops = injected > stats[i].received ? injected - stats[i].received : 0;
+        printf(" %4d | %8" PRIu64 " | %6" PRIu64 " | %6.0f | %6.3f | %6.3f | %6.3f\n", i,
+               stats[i].received, drops, stats[i].received / (replayDuration / 1e9),
+               percentileMs(stats[i].latencies, 0.50), percentileMs(stats[i].latencies, 0.95),
+               percentileMs(stats[i].latencies, 0.99));
+    }
+
+    return 0;
+}
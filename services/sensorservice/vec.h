@@ -22,6 +22,10 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "traits.h"
 
 // -----------------------------------------------------------------------
@@ -116,6 +120,19 @@ VEC<TYPE, SIZE> PURE doScalarMul(
     return r;
 }
 
+#if defined(__ARM_NEON)
+// Explicit float32x4 overloads for the four-element float case. The generic
+// loops above are not reliably auto-vectorized (the trailing scalar iteration
+// defeats the cost model), so the exact-match overloads below are picked by
+// overload resolution instead of the templates whenever both operands are
+// vec<float, 4>. Defined after vec<> below; declared here so the operators
+// find them.
+inline vec<float, 4> PURE doAdd(const vec<float, 4>& lhs, const vec<float, 4>& rhs);
+inline vec<float, 4> PURE doSub(const vec<float, 4>& lhs, const vec<float, 4>& rhs);
+inline vec<float, 4> PURE doMulScalar(const vec<float, 4>& lhs, float rhs);
+inline vec<float, 4> PURE doScalarMul(float lhs, const vec<float, 4>& rhs);
+#endif
+
 }; // namespace helpers
 
 // -----------------------------------------------------------------------
@@ -427,6 +444,40 @@ vec<TYPE, SIZE>& vec<TYPE, SIZE>::operator *= (vec<TYPE, SIZE>::pTYPE rhs) {
 
 // -----------------------------------------------------------------------
 
+#if defined(__ARM_NEON)
+
+namespace helpers {
+
+inline vec<float, 4> PURE doAdd(const vec<float, 4>& lhs, const vec<float, 4>& rhs) {
+    vec<float, 4> r;
+    vst1q_f32(r.v, vaddq_f32(vld1q_f32(lhs.v), vld1q_f32(rhs.v)));
+    return r;
+}
+
+inline vec<float, 4> PURE doSub(const vec<float, 4>& lhs, const vec<float, 4>& rhs) {
+    vec<float, 4> r;
+    vst1q_f32(r.v, vsubq_f32(vld1q_f32(lhs.v), vld1q_f32(rhs.v)));
+    return r;
+}
+
+inline vec<float, 4> PURE doMulScalar(const vec<float, 4>& lhs, float rhs) {
+    vec<float, 4> r;
+    vst1q_f32(r.v, vmulq_n_f32(vld1q_f32(lhs.v), rhs));
+    return r;
+}
+
+inline vec<float, 4> PURE doScalarMul(float lhs, const vec<float, 4>& rhs) {
+    vec<float, 4> r;
+    vst1q_f32(r.v, vmulq_n_f32(vld1q_f32(rhs.v), lhs));
+    return r;
+}
+
+}; // namespace helpers
+
+#endif // __ARM_NEON
+
+// -----------------------------------------------------------------------
+
 typedef vec<float, 2> vec2_t;
 typedef vec<float, 3> vec3_t;
 typedef vec<float, 4> vec4_t;
@@ -366,6 +366,12 @@ bool BufferLayer::onPostComposition(const DisplayDevice* display,
         mFrameTracker.setFrameReadyTime(desiredPresentTime);
     }
 
+    if (glDoneFence->isValid()) {
+        // Only valid for frames that involved client composition; exposes
+        // the time the GPU finished compositing this frame in FrameStats.
+        mFrameTracker.setGpuCompositionDoneFence(std::shared_ptr<FenceTime>(glDoneFence));
+    }
+
     if (presentFence->isValid()) {
         mFlinger->mTimeStats->setPresentFence(layerId, mCurrentFrameNumber, presentFence);
         mFlinger->mFrameTracer->traceFence(layerId, getCurrentBufferId(), mCurrentFrameNumber,
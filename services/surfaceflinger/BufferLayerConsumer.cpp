@@ -224,7 +224,7 @@ status_t BufferLayerConsumer::acquireBufferLocked(BufferItem* item, nsecs_t pres
         std::lock_guard<std::mutex> lock(mImagesMutex);
         if (mImages[item->mSlot] == nullptr || mImages[item->mSlot]->graphicBuffer() == nullptr ||
             mImages[item->mSlot]->graphicBuffer()->getId() != item->mGraphicBuffer->getId()) {
-            mImages[item->mSlot] = std::make_shared<Image>(item->mGraphicBuffer, mRE);
+            mImages[item->mSlot] = Image::lookup(item->mGraphicBuffer, mRE);
         }
     }
 
@@ -486,7 +486,7 @@ void BufferLayerConsumer::onBufferAvailable(const BufferItem& item) {
         const std::shared_ptr<Image>& oldImage = mImages[item.mSlot];
         if (oldImage == nullptr || oldImage->graphicBuffer() == nullptr ||
             oldImage->graphicBuffer()->getId() != item.mGraphicBuffer->getId()) {
-            mImages[item.mSlot] = std::make_shared<Image>(item.mGraphicBuffer, mRE);
+            mImages[item.mSlot] = Image::lookup(item.mGraphicBuffer, mRE);
         }
     }
 }
@@ -527,6 +527,22 @@ void BufferLayerConsumer::dumpLocked(String8& result, const char* prefix) const
     ConsumerBase::dumpLocked(result, prefix);
 }
 
+std::mutex BufferLayerConsumer::Image::sCacheMutex;
+std::unordered_map<uint64_t, std::weak_ptr<BufferLayerConsumer::Image>>
+        BufferLayerConsumer::Image::sCache;
+
+std::shared_ptr<BufferLayerConsumer::Image> BufferLayerConsumer::Image::lookup(
+        const sp<GraphicBuffer>& graphicBuffer, renderengine::RenderEngine& engine) {
+    std::lock_guard<std::mutex> lock(sCacheMutex);
+    std::weak_ptr<Image>& entry = sCache[graphicBuffer->getId()];
+    std::shared_ptr<Image> image = entry.lock();
+    if (image == nullptr) {
+        image = std::make_shared<Image>(graphicBuffer, engine);
+        entry = image;
+    }
+    return image;
+}
+
 BufferLayerConsumer::Image::Image(const sp<GraphicBuffer>& graphicBuffer,
                                   renderengine::RenderEngine& engine)
       : mGraphicBuffer(graphicBuffer), mRE(engine) {
@@ -535,8 +551,19 @@ BufferLayerConsumer::Image::Image(const sp<GraphicBuffer>& graphicBuffer,
 
 BufferLayerConsumer::Image::~Image() {
     if (mGraphicBuffer != nullptr) {
-        ALOGV("Destroying buffer: %" PRId64, mGraphicBuffer->getId());
-        mRE.unbindExternalTextureBuffer(mGraphicBuffer->getId());
+        const uint64_t bufferId = mGraphicBuffer->getId();
+        std::lock_guard<std::mutex> lock(sCacheMutex);
+        auto it = sCache.find(bufferId);
+        if (it != sCache.end() && !it->second.expired()) {
+            // Another Image for this buffer was created after our last strong
+            // reference was dropped; the renderengine binding now belongs to it.
+            return;
+        }
+        if (it != sCache.end()) {
+            sCache.erase(it);
+        }
+        ALOGV("Destroying buffer: %" PRId64, bufferId);
+        mRE.unbindExternalTextureBuffer(bufferId);
     }
 }
 }; // namespace android
@@ -31,6 +31,10 @@
 #include <utils/Vector.h>
 #include <utils/threads.h>
 
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 namespace android {
 // ----------------------------------------------------------------------------
 
@@ -227,11 +231,26 @@ private:
         virtual ~Image();
         const sp<GraphicBuffer>& graphicBuffer() { return mGraphicBuffer; }
 
+        // Returns the process-wide Image for the buffer, creating one if no
+        // consumer holds it yet. Images are shared by buffer ID across all
+        // BufferLayerConsumer instances, so the same GraphicBuffer attached to
+        // several layers (e.g. picture-in-picture) maps to a single
+        // renderengine external texture binding. The binding is released only
+        // when the last reference is dropped.
+        static std::shared_ptr<Image> lookup(const sp<GraphicBuffer>& graphicBuffer,
+                                             renderengine::RenderEngine& engine);
+
     private:
         // mGraphicBuffer is the buffer that was used to create this image.
         sp<GraphicBuffer> mGraphicBuffer;
         // Back-reference into renderengine to initiate cleanup.
         renderengine::RenderEngine& mRE;
+
+        // Live Images keyed by buffer ID. Entries are weak so ownership stays
+        // with the consumers; ~Image prunes its own entry before unbinding.
+        static std::mutex sCacheMutex;
+        static std::unordered_map<uint64_t, std::weak_ptr<Image>> sCache GUARDED_BY(sCacheMutex);
+
         DISALLOW_COPY_AND_ASSIGN(Image);
     };
 
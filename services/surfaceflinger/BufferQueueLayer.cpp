@@ -28,6 +28,8 @@
 #include <gui/BufferQueueConsumer.h>
 #include <system/window.h>
 
+#include <cmath>
+
 #include "LayerRejecter.h"
 #include "SurfaceInterceptor.h"
 
@@ -139,9 +141,54 @@ bool BufferQueueLayer::shouldPresentNow(nsecs_t expectedPresentTime) const {
         isDue = mFlinger->mSmoMo->ShouldPresentNow(bufferStats, expectedPresentTime);
     }
 
+    if (isDue && !frameRateAllowsPresentAt(expectedPresentTime)) {
+        ATRACE_NAME("throttledByFrameRate");
+        return false;
+    }
+
     return isDue || !isPlausible;
 }
 
+bool BufferQueueLayer::frameRateAllowsPresentAt(nsecs_t expectedPresentTime) const {
+    if (!mFlinger->mFrameRateThrottlingEnabled) {
+        return true;
+    }
+
+    const FrameRate frameRate = getFrameRateForLayerTree();
+    if (frameRate.type != FrameRateCompatibility::ExactOrMultiple || frameRate.rate <= 0) {
+        return true;
+    }
+
+    if (!mFlinger->mRefreshRateConfigs) {
+        return true;
+    }
+    const nsecs_t vsyncPeriod =
+            mFlinger->mRefreshRateConfigs->getCurrentRefreshRate().getVsyncPeriod();
+    if (vsyncPeriod <= 0) {
+        return true;
+    }
+
+    // Only throttle layers asking for an integer divisor of the active
+    // refresh rate (e.g. a 30Hz vote on a 60Hz display). Anything else keeps
+    // the default latch-every-frame behavior so we never fight the refresh
+    // rate selection in Scheduler.
+    const nsecs_t layerPeriod = static_cast<nsecs_t>(1e9f / frameRate.rate);
+    const auto divisor = static_cast<nsecs_t>(
+            std::round(static_cast<float>(layerPeriod) / static_cast<float>(vsyncPeriod)));
+    if (divisor < 2 || std::abs(layerPeriod - divisor * vsyncPeriod) > vsyncPeriod / 10) {
+        return true;
+    }
+
+    // Present when the layer's own cadence is due, with half a vsync of
+    // tolerance for timestamp jitter.
+    if (expectedPresentTime - mLastThrottledPresentTime < divisor * vsyncPeriod - vsyncPeriod / 2) {
+        return false;
+    }
+
+    mLastThrottledPresentTime = expectedPresentTime;
+    return true;
+}
+
 // -----------------------------------------------------------------------
 // Interface implementation for BufferLayer
 // -----------------------------------------------------------------------
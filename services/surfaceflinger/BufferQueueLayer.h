@@ -125,6 +125,13 @@ private:
     // Temporary - Used only for LEGACY camera mode.
     uint32_t getProducerStickyTransform() const;
 
+    // Returns false when frame rate throttling is enabled, the layer has an
+    // ExactOrMultiple vote for an integer divisor of the active refresh rate
+    // and the next frame is not yet due at that cadence. The queued frame
+    // stays pending, so a slow layer naturally backpressures its producer
+    // once the queue fills.
+    bool frameRateAllowsPresentAt(nsecs_t expectedPresentTime) const;
+
     void onFirstRef() override;
 
     sp<BufferLayerConsumer> mConsumer;
@@ -149,6 +156,10 @@ private:
 
     sp<ContentsChangedListener> mContentsChangedListener;
     nsecs_t mLastTimeStamp = -1;
+
+    // Expected present time of the last frame allowed through the frame rate
+    // throttle. Only written from shouldPresentNow on the main thread.
+    mutable nsecs_t mLastThrottledPresentTime = 0;
 };
 
 } // namespace android
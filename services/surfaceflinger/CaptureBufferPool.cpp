@@ -0,0 +1,55 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CaptureBufferPool.h"
+
+namespace android {
+
+sp<GraphicBuffer> CaptureBufferPool::getBuffer(uint32_t width, uint32_t height, PixelFormat format,
+                                               uint32_t usage) {
+    std::lock_guard lock(mMutex);
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        const auto& buffer = it->buffer;
+        if (buffer->getWidth() != width || buffer->getHeight() != height ||
+            buffer->getPixelFormat() != format || buffer->getUsage() != usage) {
+            continue;
+        }
+        if (it->readyFence->getStatus() == Fence::Status::Unsignaled) {
+            // Still being rendered to or consumed; try another entry.
+            continue;
+        }
+        sp<GraphicBuffer> found = buffer;
+        mEntries.erase(it);
+        return found;
+    }
+    return nullptr;
+}
+
+void CaptureBufferPool::returnBuffer(const sp<GraphicBuffer>& buffer,
+                                     const sp<Fence>& readyFence) {
+    if (buffer == nullptr) {
+        return;
+    }
+    std::lock_guard lock(mMutex);
+    if (mEntries.size() >= kMaxPoolSize) {
+        // Drop the oldest entry; stale geometries (e.g. after a display size
+        // change) age out of the pool this way.
+        mEntries.erase(mEntries.begin());
+    }
+    mEntries.push_back({buffer, readyFence != nullptr ? readyFence : Fence::NO_FENCE});
+}
+
+} // namespace android
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+#include <ui/Fence.h>
+#include <ui/GraphicBuffer.h>
+#include <utils/StrongPointer.h>
+
+#include <mutex>
+#include <vector>
+
+namespace android {
+
+// A small pool of GraphicBuffers reused across asynchronous screen captures,
+// so that steady-state captures do not pay for a gralloc allocation on every
+// request. Each pooled buffer remembers the fence of the last render that
+// targeted it and is only handed out again once that fence has signaled,
+// which also gives the previous consumer of the buffer a bounded window to
+// read it before it is overwritten.
+class CaptureBufferPool {
+public:
+    // Returns a pooled buffer matching the requested allocation parameters
+    // whose last render has completed, or nullptr if none is available.
+    sp<GraphicBuffer> getBuffer(uint32_t width, uint32_t height, PixelFormat format,
+                                uint32_t usage);
+
+    // Makes the buffer available to future captures. readyFence is the fence
+    // returned by the render into the buffer, and gates its reuse.
+    void returnBuffer(const sp<GraphicBuffer>& buffer, const sp<Fence>& readyFence);
+
+private:
+    // Enough depth to absorb back-to-back captures without an unsignaled
+    // fence forcing a fresh allocation, while bounding how much memory idle
+    // screen-sized buffers can pin.
+    static constexpr size_t kMaxPoolSize = 3;
+
+    struct Entry {
+        sp<GraphicBuffer> buffer;
+        sp<Fence> readyFence;
+    };
+
+    std::mutex mMutex;
+    std::vector<Entry> mEntries GUARDED_BY(mMutex);
+};
+
+} // namespace android
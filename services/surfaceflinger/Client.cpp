@@ -85,6 +85,19 @@ status_t Client::createSurface(const String8& name, uint32_t w, uint32_t h, Pixe
                                  parentHandle, nullptr, outTransformHint);
 }
 
+status_t Client::createSurfaces(const std::vector<SurfaceCreationArgs>& args,
+                                std::vector<SurfaceCreationResult>* outResults) {
+    outResults->clear();
+    outResults->reserve(args.size());
+    for (const auto& arg : args) {
+        SurfaceCreationResult& result = outResults->emplace_back();
+        result.result = createSurface(arg.name, arg.w, arg.h, arg.format, arg.flags, arg.parent,
+                                      arg.metadata, &result.handle, &result.gbp,
+                                      &result.transformHint);
+    }
+    return NO_ERROR;
+}
+
 status_t Client::createWithSurfaceParent(const String8& name, uint32_t w, uint32_t h,
                                          PixelFormat format, uint32_t flags,
                                          const sp<IGraphicBufferProducer>& parent,
@@ -57,6 +57,9 @@ private:
                                    sp<IGraphicBufferProducer>* gbp,
                                    uint32_t* outTransformHint = nullptr);
 
+    virtual status_t createSurfaces(const std::vector<SurfaceCreationArgs>& args,
+                                    std::vector<SurfaceCreationResult>* outResults);
+
     virtual status_t createWithSurfaceParent(const String8& name, uint32_t w, uint32_t h,
                                              PixelFormat format, uint32_t flags,
                                              const sp<IGraphicBufferProducer>& parent,
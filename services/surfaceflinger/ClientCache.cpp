@@ -21,13 +21,39 @@
 
 #include <cinttypes>
 
+#include <android-base/stringprintf.h>
+#include <cutils/properties.h>
+#include <ui/PixelFormat.h>
+
 #include "ClientCache.h"
 
 namespace android {
 
 ANDROID_SINGLETON_STATIC_INSTANCE(ClientCache);
 
-ClientCache::ClientCache() : mDeathRecipient(new CacheDeathRecipient) {}
+namespace {
+
+size_t budgetBytes() {
+    char value[PROPERTY_VALUE_MAX];
+    property_get("debug.sf.client_cache_budget_mb", value, "0");
+    const int budgetMb = atoi(value);
+    if (budgetMb <= 0) {
+        return 0;
+    }
+    return static_cast<size_t>(budgetMb) * 1024 * 1024;
+}
+
+// Estimate of the gralloc allocation backing a buffer, matching the
+// accounting GraphicBufferAllocator uses in its own dump.
+size_t estimatedSize(const sp<GraphicBuffer>& buffer) {
+    return static_cast<size_t>(buffer->getStride()) * buffer->getHeight() *
+            bytesPerPixel(buffer->getPixelFormat());
+}
+
+} // namespace
+
+ClientCache::ClientCache()
+      : mBudgetBytes(budgetBytes()), mDeathRecipient(new CacheDeathRecipient) {}
 
 bool ClientCache::getBuffer(const client_cache_t& cacheId,
                             ClientCacheBuffer** outClientCacheBuffer) {
@@ -67,43 +93,106 @@ bool ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& bu
         return false;
     }
 
-    std::lock_guard lock(mMutex);
-    sp<IBinder> token;
+    std::vector<std::pair<sp<ErasedRecipient>, client_cache_t>> pendingErase;
+    {
+        std::lock_guard lock(mMutex);
+        sp<IBinder> token;
+
+        // If this is a new process token, set a death recipient. If the client process dies, we
+        // will get a callback through binderDied.
+        auto it = mBuffers.find(processToken);
+        if (it == mBuffers.end()) {
+            token = processToken.promote();
+            if (!token) {
+                ALOGE("failed to cache buffer: invalid token");
+                return false;
+            }
 
-    // If this is a new process token, set a death recipient. If the client process dies, we will
-    // get a callback through binderDied.
-    auto it = mBuffers.find(processToken);
-    if (it == mBuffers.end()) {
-        token = processToken.promote();
-        if (!token) {
-            ALOGE("failed to cache buffer: invalid token");
-            return false;
+            status_t err = token->linkToDeath(mDeathRecipient);
+            if (err != NO_ERROR) {
+                ALOGE("failed to cache buffer: could not link to death");
+                return false;
+            }
+            auto [itr, success] =
+                    mBuffers.emplace(processToken,
+                                     std::make_pair(token,
+                                                    std::unordered_map<uint64_t,
+                                                                       ClientCacheBuffer>()));
+            LOG_ALWAYS_FATAL_IF(!success, "failed to insert new process into client cache");
+            it = itr;
         }
 
-        status_t err = token->linkToDeath(mDeathRecipient);
-        if (err != NO_ERROR) {
-            ALOGE("failed to cache buffer: could not link to death");
+        auto& processBuffers = it->second.second;
+
+        if (processBuffers.size() > BUFFER_CACHE_MAX_SIZE) {
+            ALOGE("failed to cache buffer: cache is full");
             return false;
         }
-        auto [itr, success] =
-                mBuffers.emplace(processToken,
-                                 std::make_pair(token,
-                                                std::unordered_map<uint64_t, ClientCacheBuffer>()));
-        LOG_ALWAYS_FATAL_IF(!success, "failed to insert new process into client cache");
-        it = itr;
+
+        ClientCacheBuffer& buf = processBuffers[id];
+        buf.buffer = buffer;
+        buf.sizeBytes = estimatedSize(buffer);
+        mLruList.emplace_front(cacheId);
+        buf.lruEntry = mLruList.begin();
+        mTotalBytes += buf.sizeBytes;
+
+        // Evict from the cold end until we are back under budget, but never
+        // the entry that was just added.
+        while (mBudgetBytes > 0 && mTotalBytes > mBudgetBytes && mLruList.size() > 1) {
+            if (!evictLeastRecentlyUsedLocked(&pendingErase)) {
+                break;
+            }
+        }
     }
 
-    auto& processBuffers = it->second.second;
+    for (auto& [recipient, erasedId] : pendingErase) {
+        recipient->bufferErased(erasedId);
+    }
+    return true;
+}
+
+bool ClientCache::evictLeastRecentlyUsedLocked(
+        std::vector<std::pair<sp<ErasedRecipient>, client_cache_t>>* pendingErase) {
+    if (mLruList.empty()) {
+        return false;
+    }
+    const client_cache_t evictId = mLruList.back();
 
-    if (processBuffers.size() > BUFFER_CACHE_MAX_SIZE) {
-        ALOGE("failed to cache buffer: cache is full");
+    ClientCacheBuffer* buf = nullptr;
+    if (!getBuffer(evictId, &buf)) {
+        ALOGE("failed to evict buffer, could not retrieve buffer");
+        mLruList.pop_back();
         return false;
     }
 
-    processBuffers[id].buffer = buffer;
+    for (auto& recipient : buf->recipients) {
+        sp<ErasedRecipient> erasedRecipient = recipient.promote();
+        if (erasedRecipient) {
+            pendingErase->emplace_back(erasedRecipient, evictId);
+        }
+    }
+
+    mTotalBytes -= buf->sizeBytes;
+    mLruList.pop_back();
+    mBuffers[evictId.token].second.erase(evictId.id);
+    mEvictions++;
     return true;
 }
 
+bool ClientCache::eraseLeastRecentlyUsed() {
+    std::vector<std::pair<sp<ErasedRecipient>, client_cache_t>> pendingErase;
+    bool evicted;
+    {
+        std::lock_guard lock(mMutex);
+        evicted = evictLeastRecentlyUsedLocked(&pendingErase);
+    }
+
+    for (auto& [recipient, cacheId] : pendingErase) {
+        recipient->bufferErased(cacheId);
+    }
+    return evicted;
+}
+
 void ClientCache::erase(const client_cache_t& cacheId) {
     auto& [processToken, id] = cacheId;
     std::vector<sp<ErasedRecipient>> pendingErase;
@@ -122,6 +211,8 @@ void ClientCache::erase(const client_cache_t& cacheId) {
             }
         }
 
+        mTotalBytes -= buf->sizeBytes;
+        mLruList.erase(buf->lruEntry);
         mBuffers[processToken].second.erase(id);
     }
 
@@ -136,9 +227,12 @@ sp<GraphicBuffer> ClientCache::get(const client_cache_t& cacheId) {
     ClientCacheBuffer* buf = nullptr;
     if (!getBuffer(cacheId, &buf)) {
         ALOGE("failed to get buffer, could not retrieve buffer");
+        mMisses++;
         return nullptr;
     }
 
+    mHits++;
+    mLruList.splice(mLruList.begin(), mLruList, buf->lruEntry);
     return buf->buffer;
 }
 
@@ -190,6 +284,8 @@ void ClientCache::removeProcess(const wp<IBinder>& processToken) {
                     pendingErase.emplace_back(erasedRecipient, cacheId);
                 }
             }
+            mTotalBytes -= clientCacheBuffer.sizeBytes;
+            mLruList.erase(clientCacheBuffer.lruEntry);
         }
         mBuffers.erase(itr);
     }
@@ -199,6 +295,21 @@ void ClientCache::removeProcess(const wp<IBinder>& processToken) {
     }
 }
 
+void ClientCache::dump(std::string& result) {
+    std::lock_guard lock(mMutex);
+
+    base::StringAppendF(&result, "ClientCache: %zu process(es), %zu buffer(s), %zu bytes",
+                        mBuffers.size(), mLruList.size(), mTotalBytes);
+    if (mBudgetBytes > 0) {
+        base::StringAppendF(&result, " (budget %zu bytes)", mBudgetBytes);
+    } else {
+        result.append(" (unbounded)");
+    }
+    base::StringAppendF(&result, "\n  hits: %" PRIu64 " misses: %" PRIu64 " evictions: %" PRIu64
+                                 "\n",
+                        mHits, mMisses, mEvictions);
+}
+
 void ClientCache::CacheDeathRecipient::binderDied(const wp<IBinder>& who) {
     ClientCache::getInstance().removeProcess(who);
 }
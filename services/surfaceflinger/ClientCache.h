@@ -23,10 +23,13 @@
 #include <utils/RefBase.h>
 #include <utils/Singleton.h>
 
+#include <list>
 #include <map>
 #include <mutex>
 #include <set>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #define BUFFER_CACHE_MAX_SIZE 64
 
@@ -43,6 +46,12 @@ public:
 
     void removeProcess(const wp<IBinder>& processToken);
 
+    // Erases the least recently used buffer across all processes, notifying
+    // its erased recipients. Returns false if the cache is empty.
+    bool eraseLeastRecentlyUsed();
+
+    void dump(std::string& result);
+
     class ErasedRecipient : public virtual RefBase {
     public:
         virtual void bufferErased(const client_cache_t& clientCacheId) = 0;
@@ -59,12 +68,29 @@ private:
     struct ClientCacheBuffer {
         sp<GraphicBuffer> buffer;
         std::set<wp<ErasedRecipient>> recipients;
+        // Estimated gralloc allocation size, accounted against mTotalBytes.
+        size_t sizeBytes = 0;
+        std::list<client_cache_t>::iterator lruEntry;
     };
     std::map<wp<IBinder> /*caching process*/,
              std::pair<sp<IBinder> /*strong ref to caching process*/,
                        std::unordered_map<uint64_t /*cache id*/, ClientCacheBuffer>>>
             mBuffers GUARDED_BY(mMutex);
 
+    // Cache ids ordered from most to least recently used. get() refreshes an
+    // entry; add() evicts from the back while the cache exceeds mBudgetBytes.
+    std::list<client_cache_t> mLruList GUARDED_BY(mMutex);
+
+    // Byte budget from debug.sf.client_cache_budget_mb, read once at startup.
+    // 0 keeps the cache unbounded. Eviction drops imports the client has
+    // abandoned; a client that reuses an evicted id must re-send the buffer.
+    const size_t mBudgetBytes;
+
+    size_t mTotalBytes GUARDED_BY(mMutex) = 0;
+    uint64_t mHits GUARDED_BY(mMutex) = 0;
+    uint64_t mMisses GUARDED_BY(mMutex) = 0;
+    uint64_t mEvictions GUARDED_BY(mMutex) = 0;
+
     class CacheDeathRecipient : public IBinder::DeathRecipient {
     public:
         void binderDied(const wp<IBinder>& who) override;
@@ -74,6 +100,9 @@ private:
 
     bool getBuffer(const client_cache_t& cacheId, ClientCacheBuffer** outClientCacheBuffer)
             REQUIRES(mMutex);
+    bool evictLeastRecentlyUsedLocked(
+            std::vector<std::pair<sp<ErasedRecipient>, client_cache_t>>* pendingErase)
+            REQUIRES(mMutex);
 };
 
 }; // namespace android
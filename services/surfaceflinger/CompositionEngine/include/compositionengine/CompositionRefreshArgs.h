@@ -24,12 +24,16 @@
 #include <compositionengine/LayerFE.h>
 #include <compositionengine/OutputColorSetting.h>
 #include <math/mat4.h>
+#include <ui/FatVector.h>
 #include <ui/Transform.h>
 
 namespace android::compositionengine {
 
-using Layers = std::vector<sp<compositionengine::LayerFE>>;
-using Outputs = std::vector<std::shared_ptr<compositionengine::Output>>;
+// These lists are rebuilt every frame; the inline capacities are sized so a
+// typical frame (tens of layers, a few outputs) assembles them without any
+// heap allocation.
+using Layers = FatVector<sp<compositionengine::LayerFE>, 32>;
+using Outputs = FatVector<std::shared_ptr<compositionengine::Output>, 4>;
 
 /**
  * A parameter object for refreshing a set of outputs
@@ -64,6 +68,11 @@ struct CompositionRefreshArgs {
     // If true, GPU clocks will be increased when rendering blurs
     bool blursAreExpensive{false};
 
+    // If true, the outputs should prefer cheaper composition strategies, such
+    // as skipping background blurs, because recent frames missed their present
+    // deadlines while GPU composition was in use.
+    bool reduceCompositionEffort{false};
+
     // If true, the complete output geometry needs to be recomputed this frame
     bool updatingOutputGeometryThisFrame{false};
 
@@ -112,6 +112,11 @@ public:
         // If set to true, change the layer settings to render a clear output.
         // This may be requested by the HWC
         const bool clearContent;
+
+        // If set to true, the layer should not request a background blur pass,
+        // because composition effort is being reduced to meet the present
+        // deadline.
+        const bool disableBackgroundBlur;
     };
 
     // A superset of LayerSettings required by RenderEngine to compose a layer
@@ -154,7 +159,8 @@ static inline bool operator==(const LayerFE::ClientCompositionTargetSettings& lh
             lhs.clearRegion.hasSameRects(rhs.clearRegion) && lhs.viewport == rhs.viewport &&
             lhs.dataspace == rhs.dataspace &&
             lhs.realContentIsVisible == rhs.realContentIsVisible &&
-            lhs.clearContent == rhs.clearContent;
+            lhs.clearContent == rhs.clearContent &&
+            lhs.disableBackgroundBlur == rhs.disableBackgroundBlur;
 }
 
 static inline bool operator==(const LayerFE::LayerSettings& lhs,
@@ -182,6 +188,7 @@ static inline void PrintTo(const LayerFE::ClientCompositionTargetSettings& setti
     PrintTo(settings.dataspace, os);
     *os << "\n    .realContentIsVisible = " << settings.realContentIsVisible;
     *os << "\n    .clearContent = " << settings.clearContent;
+    *os << "\n    .disableBackgroundBlur = " << settings.disableBackgroundBlur;
     *os << "\n}";
 }
 
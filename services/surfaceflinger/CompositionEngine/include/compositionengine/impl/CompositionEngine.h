@@ -18,6 +18,11 @@
 
 #include <compositionengine/CompositionEngine.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace android::compositionengine::impl {
 
 class CompositionEngine : public compositionengine::CompositionEngine {
@@ -57,11 +62,33 @@ public:
     void setNeedsAnotherUpdateForTest(bool);
 
 private:
+    void presentOutputs(CompositionRefreshArgs&);
+    void presentThreadMain();
+    std::shared_ptr<compositionengine::Output> takeNextPresentJobLocked();
+    void ensurePresentThreadsLocked(size_t jobCount);
+
     std::unique_ptr<HWComposer> mHwComposer;
     std::unique_ptr<renderengine::RenderEngine> mRenderEngine;
     std::shared_ptr<TimeStats> mTimeStats;
     bool mNeedsAnotherUpdate = false;
     nsecs_t mRefreshStartTime = 0;
+
+    // True when debug.sf.parallel_present is set. Outputs whose previous
+    // frame composed entirely through the HWC are presented on a small pool
+    // of worker threads so independent displays overlap instead of running
+    // back to back. See presentOutputs() for the constraints.
+    const bool mParallelPresentEnabled;
+
+    static constexpr size_t kMaxPresentThreads = 3;
+
+    // All present pool state below is guarded by mPresentMutex.
+    std::mutex mPresentMutex;
+    std::condition_variable mPresentCondition;
+    std::vector<std::thread> mPresentThreads;
+    std::vector<std::shared_ptr<compositionengine::Output>> mPresentJobs;
+    CompositionRefreshArgs* mPresentArgs = nullptr;
+    size_t mPresentJobsInFlight = 0;
+    bool mPresentThreadsExit = false;
 };
 
 std::unique_ptr<compositionengine::CompositionEngine> createCompositionEngine();
@@ -56,12 +56,21 @@ public:
     void getHwcBuffer(int slot, const sp<GraphicBuffer>& buffer, uint32_t* outSlot,
                       sp<GraphicBuffer>* outBuffer);
 
+    // Number of times a slot that already mirrored a buffer was overwritten with
+    // a different one. A high value relative to the frame count means the client
+    // cycles through more buffers than the cache has slots, forcing the HWC to
+    // re-import buffers it has already seen.
+    uint32_t getSlotEvictionCount() const { return mSlotEvictions; }
+
 private:
-    // an array where the index corresponds to a slot and the value corresponds to a (counter,
-    // buffer) pair. "counter" is a unique value that indicates the last time this slot was updated
-    // or used and allows us to keep track of the least-recently used buffer.
-    wp<GraphicBuffer> mBuffers[BufferQueue::NUM_BUFFER_SLOTS];
+    // an array where the index corresponds to a slot and the value is the id of
+    // the buffer the HWC has cached there, or 0 when the slot is empty. Buffer
+    // ids are unique for the lifetime of the process and are never reused, so a
+    // stale entry can never alias a new buffer and the hit check is a single
+    // integer compare with no weak pointer promotion.
+    uint64_t mBufferIds[BufferQueue::NUM_BUFFER_SLOTS] = {};
     uint32_t mNextSlot = 0;
+    uint32_t mSlotEvictions = 0;
     bool mReduceSlotsForWideVideo = false;
 };
 
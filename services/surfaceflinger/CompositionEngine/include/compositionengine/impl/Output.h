@@ -22,6 +22,7 @@
 #include <compositionengine/impl/OutputCompositionState.h>
 #include <renderengine/DisplaySettings.h>
 #include <renderengine/LayerSettings.h>
+#include <ui/FatVector.h>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -98,6 +99,10 @@ protected:
     std::optional<size_t> findCurrentOutputLayerForLayer(
             const sp<compositionengine::LayerFE>&) const;
     void chooseCompositionStrategy() override;
+    // Called by prepareFrame() instead of chooseCompositionStrategy() on a
+    // repeat frame, so the HWC-backed implementation can reset any per-frame
+    // bookkeeping the skipped call would have reset.
+    virtual void reuseCompositionStrategy();
     bool getSkipColorTransform() const override;
     compositionengine::Output::FrameFences presentAndGetFrameFences() override;
     std::vector<LayerFE::LayerSettings> generateClientCompositionRequests(
@@ -117,6 +122,10 @@ protected:
 
 private:
     void dirtyEntireOutput();
+    uint64_t computeVisibilityInputHash(const CompositionRefreshArgs&, LayerFESet&);
+    bool canReuseCompositionStrategy(const CompositionRefreshArgs&);
+    uint64_t computeRepeatFrameHash(const CompositionRefreshArgs&) const;
+    void writeRepeatFrameStateToHWC();
     compositionengine::OutputLayer* findLayerRequestingBackgroundComposition() const;
     ui::Dataspace getBestDataspace(ui::Dataspace*, bool*) const;
     compositionengine::Output::ColorProfile pickColorProfile(
@@ -128,7 +137,20 @@ private:
     std::unique_ptr<compositionengine::RenderSurface> mRenderSurface;
 
     ReleasedLayers mReleasedLayers;
+    // Fingerprint of the inputs consumed by the last full visibility
+    // recomputation in rebuildLayerStacks; zero means no cached result.
+    uint64_t mVisibilityInputHash = 0;
+    // Fingerprint of the per-frame inputs consumed by the color and composition
+    // strategy decisions. When consecutive fully device-composed frames match,
+    // present() skips straight to writing the new buffers to the HWC.
+    std::optional<uint64_t> mRepeatFrameHash;
+    // True while the current frame reuses the previous frame's composition strategy,
+    // letting prepareFrame() skip re-validation with the HWC.
+    bool mReuseCompositionStrategy = false;
     OutputLayer* mLayerRequestingBackgroundBlur = nullptr;
+    // True while composition should use cheaper strategies because frames are
+    // predicted to miss their present deadlines.
+    bool mReduceCompositionEffort = false;
     std::unique_ptr<ClientCompositionRequestCache> mClientCompositionRequestCache;
 };
 
@@ -220,8 +242,10 @@ std::shared_ptr<BaseOutput> createOutputTemplated(const CompositionEngine& compo
 
         const CompositionEngine& mCompositionEngine;
         OutputCompositionState mState;
-        std::vector<std::unique_ptr<OutputLayer>> mCurrentOutputLayersOrderedByZ;
-        std::vector<std::unique_ptr<OutputLayer>> mPendingOutputLayersOrderedByZ;
+        // Rebuilt on every visibility recomputation; inline storage keeps the
+        // rebuild allocation-free for typical layer counts.
+        FatVector<std::unique_ptr<OutputLayer>, 16> mCurrentOutputLayersOrderedByZ;
+        FatVector<std::unique_ptr<OutputLayer>, 16> mPendingOutputLayersOrderedByZ;
     };
 
     return std::make_shared<Output>(compositionEngine, std::forward<Args>(args)...);
@@ -21,6 +21,11 @@
 #include <compositionengine/impl/CompositionEngine.h>
 #include <compositionengine/impl/Display.h>
 
+#include <pthread.h>
+
+#include <algorithm>
+
+#include <cutils/properties.h>
 #include <renderengine/RenderEngine.h>
 #include <utils/Trace.h>
 
@@ -43,8 +48,28 @@ std::unique_ptr<compositionengine::CompositionEngine> createCompositionEngine()
     return std::make_unique<CompositionEngine>();
 }
 
-CompositionEngine::CompositionEngine() = default;
-CompositionEngine::~CompositionEngine() = default;
+namespace {
+
+bool parallelPresentEnabled() {
+    char value[PROPERTY_VALUE_MAX];
+    property_get("debug.sf.parallel_present", value, "0");
+    return atoi(value) != 0;
+}
+
+} // namespace
+
+CompositionEngine::CompositionEngine() : mParallelPresentEnabled(parallelPresentEnabled()) {}
+
+CompositionEngine::~CompositionEngine() {
+    {
+        std::lock_guard lock(mPresentMutex);
+        mPresentThreadsExit = true;
+    }
+    mPresentCondition.notify_all();
+    for (auto& thread : mPresentThreads) {
+        thread.join();
+    }
+}
 
 std::shared_ptr<compositionengine::Display> CompositionEngine::createDisplay(
         const DisplayCreationArgs& args) {
@@ -107,9 +132,96 @@ void CompositionEngine::present(CompositionRefreshArgs& args) {
 
     updateLayerStateFromFE(args);
 
-    for (const auto& output : args.outputs) {
+    presentOutputs(args);
+}
+
+void CompositionEngine::presentOutputs(CompositionRefreshArgs& args) {
+    // The GLES context is current on this thread only, so any output that may
+    // need client composition has to be presented here. Outputs that composed
+    // entirely through the HWC on their previous frame are queued for the
+    // worker pool instead; a display that unexpectedly falls back to client
+    // composition on a worker skips that frame and is routed back here from
+    // the next frame on.
+    if (!mParallelPresentEnabled || args.outputs.size() < 2 || args.devOptForceClientComposition ||
+        args.devOptFlashDirtyRegionsDelay) {
+        for (const auto& output : args.outputs) {
+            output->present(args);
+        }
+        return;
+    }
+
+    ATRACE_NAME("parallelPresent");
+    std::vector<std::shared_ptr<compositionengine::Output>> localOutputs;
+    {
+        std::lock_guard lock(mPresentMutex);
+        mPresentArgs = &args;
+        for (const auto& output : args.outputs) {
+            if (output->getState().usesClientComposition) {
+                localOutputs.emplace_back(output);
+            } else {
+                mPresentJobs.emplace_back(output);
+            }
+        }
+        ensurePresentThreadsLocked(mPresentJobs.size());
+    }
+    mPresentCondition.notify_all();
+
+    for (const auto& output : localOutputs) {
         output->present(args);
     }
+
+    // Help drain the queue, then wait out any job a worker still has in
+    // flight before the frame is allowed to complete.
+    {
+        std::unique_lock lock(mPresentMutex);
+        while (auto output = takeNextPresentJobLocked()) {
+            lock.unlock();
+            output->present(args);
+            lock.lock();
+            mPresentJobsInFlight--;
+        }
+        mPresentCondition.wait(lock, [this] { return mPresentJobsInFlight == 0; });
+        mPresentArgs = nullptr;
+    }
+}
+
+void CompositionEngine::presentThreadMain() {
+    pthread_setname_np(pthread_self(), "PresentThread");
+
+    std::unique_lock lock(mPresentMutex);
+    while (true) {
+        mPresentCondition.wait(lock,
+                               [this] { return mPresentThreadsExit || !mPresentJobs.empty(); });
+        if (mPresentThreadsExit) {
+            return;
+        }
+        auto output = takeNextPresentJobLocked();
+        CompositionRefreshArgs* args = mPresentArgs;
+        lock.unlock();
+        output->present(*args);
+        lock.lock();
+        mPresentJobsInFlight--;
+        if (mPresentJobsInFlight == 0 && mPresentJobs.empty()) {
+            mPresentCondition.notify_all();
+        }
+    }
+}
+
+std::shared_ptr<compositionengine::Output> CompositionEngine::takeNextPresentJobLocked() {
+    if (mPresentJobs.empty()) {
+        return nullptr;
+    }
+    auto output = std::move(mPresentJobs.back());
+    mPresentJobs.pop_back();
+    mPresentJobsInFlight++;
+    return output;
+}
+
+void CompositionEngine::ensurePresentThreadsLocked(size_t jobCount) {
+    const size_t wanted = std::min(jobCount, kMaxPresentThreads);
+    while (mPresentThreads.size() < wanted) {
+        mPresentThreads.emplace_back(&CompositionEngine::presentThreadMain, this);
+    }
 }
 
 void CompositionEngine::updateCursorAsync(CompositionRefreshArgs& args) {
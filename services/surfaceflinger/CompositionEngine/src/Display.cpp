@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <type_traits>
+
 #include <android-base/stringprintf.h>
 #include <compositionengine/CompositionEngine.h>
 #include <compositionengine/CompositionRefreshArgs.h>
@@ -25,6 +27,7 @@
 #include <compositionengine/impl/DisplayColorProfile.h>
 #include <compositionengine/impl/DumpHelpers.h>
 #include <compositionengine/impl/OutputLayer.h>
+#include <compositionengine/impl/OutputLayerCompositionState.h>
 #include <compositionengine/impl/RenderSurface.h>
 
 #ifdef QTI_DISPLAY_CONFIG_ENABLED
@@ -290,6 +293,7 @@ void Display::chooseCompositionStrategy() {
     }
 #endif
     if (status_t result = hwc.getDeviceCompositionChanges(*mId, anyLayersRequireClientComposition(),
+                                                          computeCompositionStateDigest(),
                                                           &changes);
         result != NO_ERROR) {
         ALOGE("chooseCompositionStrategy failed for %s: %d (%s)", getName().c_str(), result,
@@ -309,6 +313,22 @@ void Display::chooseCompositionStrategy() {
     state.usesDeviceComposition = !allLayersRequireClientComposition();
 }
 
+void Display::reuseCompositionStrategy() {
+    ATRACE_CALL();
+    ALOGV(__FUNCTION__);
+
+    if (!mId) {
+        return;
+    }
+
+    // The strategy chosen for the previous frame stays in force, but the
+    // skip-validate flags in HWComposer are only meaningful for the frame
+    // whose getDeviceCompositionChanges call set them. Left stale, they make
+    // presentAndGetReleaseFences report the previous frame's present instead
+    // of presenting this one.
+    getCompositionEngine().getHwComposer().clearSkipValidateState(*mId);
+}
+
 bool Display::getSkipColorTransform() const {
     const auto& hwc = getCompositionEngine().getHwComposer();
     return mId ? hwc.hasDisplayCapability(*mId, hal::DisplayCapability::SKIP_CLIENT_COLOR_TRANSFORM)
@@ -327,6 +347,62 @@ bool Display::allLayersRequireClientComposition() const {
                        [](const auto& layer) { return layer->requiresClientComposition(); });
 }
 
+namespace {
+
+// FNV-1a, folded over the raw bytes of trivially-copyable state fields.
+uint64_t digestBytes(uint64_t digest, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        digest = (digest ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return digest;
+}
+
+template <typename T>
+uint64_t digestField(uint64_t digest, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    return digestBytes(digest, &value, sizeof(value));
+}
+
+} // namespace
+
+uint64_t Display::computeCompositionStateDigest() const {
+    uint64_t digest = 0xcbf29ce484222325ull; // FNV offset basis
+
+    const auto& outputState = getState();
+    digest = digestField(digest, outputState.colorMode);
+    digest = digestField(digest, outputState.renderIntent);
+    digest = digestField(digest, outputState.dataspace);
+
+    for (const auto* layer : getOutputLayersOrderedByZ()) {
+        const auto& state = layer->getState();
+        if (!state.hwc) {
+            // A layer without HWC backing cannot reuse a device verdict.
+            return 0;
+        }
+        HWC2::Layer* const hwcLayer = state.hwc->hwcLayer.get();
+        digest = digestField(digest, hwcLayer);
+        digest = digestField(digest, state.forceClientComposition);
+        digest = digestField(digest, state.displayFrame);
+        digest = digestField(digest, state.sourceCrop);
+        digest = digestField(digest, state.bufferTransform);
+        digest = digestField(digest, state.dataspace);
+        digest = digestField(digest, state.z);
+
+        const auto* layerFEState = layer->getLayerFE().getCompositionState();
+        if (layerFEState == nullptr) {
+            return 0;
+        }
+        digest = digestField(digest, layerFEState->blendMode);
+        digest = digestField(digest, layerFEState->alpha);
+        digest = digestField(digest, layerFEState->hasProtectedContent);
+        digest = digestField(digest, layerFEState->sidebandStream != nullptr);
+    }
+
+    // 0 is reserved to mean "no digest, always validate".
+    return digest == 0 ? 1 : digest;
+}
+
 void Display::applyChangedTypesToLayers(const ChangedTypes& changedTypes) {
     if (changedTypes.empty()) {
         return;
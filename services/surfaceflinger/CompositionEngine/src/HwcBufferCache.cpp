@@ -36,7 +36,6 @@ constexpr int MAX_NUM_SLOTS_FOR_WIDE_VIDEOS = 4;
 namespace android::compositionengine::impl {
 
 HwcBufferCache::HwcBufferCache() {
-    std::fill(std::begin(mBuffers), std::end(mBuffers), wp<GraphicBuffer>(nullptr));
     char value[PROPERTY_VALUE_MAX];
     property_get("vendor.display.reduce_slots_for_wide_video", value, "1");
     mReduceSlotsForWideVideo = atoi(value);
@@ -82,7 +81,6 @@ static bool formatIsYuv(const PixelFormat format) {
 void HwcBufferCache::getHwcBuffer(int slot, const sp<GraphicBuffer>& buffer, uint32_t* outSlot,
                                   sp<GraphicBuffer>* outBuffer) {
     // default is 0
-    wp<GraphicBuffer> weakCopy(buffer);
     uint32_t width = 0;
     uint32_t height = 0;
     PixelFormat format = PIXEL_FORMAT_NONE;
@@ -111,15 +109,19 @@ void HwcBufferCache::getHwcBuffer(int slot, const sp<GraphicBuffer>& buffer, uin
         *outSlot = static_cast<uint32_t>(slot);
     }
 
-    auto& currentBuffer = mBuffers[*outSlot];
-    if (currentBuffer == weakCopy) {
+    const uint64_t bufferId = buffer ? buffer->getId() : 0;
+    uint64_t& cachedId = mBufferIds[*outSlot];
+    if (cachedId == bufferId) {
         // already cached in HWC, skip sending the buffer
         *outBuffer = nullptr;
     } else {
         *outBuffer = buffer;
 
         // update cache
-        currentBuffer = buffer;
+        if (cachedId != 0 && bufferId != 0) {
+            mSlotEvictions++;
+        }
+        cachedId = bufferId;
     }
 }
 
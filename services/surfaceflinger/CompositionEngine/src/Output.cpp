@@ -308,9 +308,18 @@ void Output::present(const compositionengine::CompositionRefreshArgs& refreshArg
     ATRACE_CALL();
     ALOGV(__FUNCTION__);
 
-    updateColorProfile(refreshArgs);
-    updateAndWriteCompositionState(refreshArgs);
-    setColorTransform(refreshArgs);
+    mReuseCompositionStrategy = canReuseCompositionStrategy(refreshArgs);
+    ATRACE_INT("RepeatFrameFastPath", mReuseCompositionStrategy);
+
+    if (mReuseCompositionStrategy) {
+        // Only per-frame content changed since the previous frame: forward the new
+        // buffers to the HWC and keep the cached color and strategy decisions.
+        writeRepeatFrameStateToHWC();
+    } else {
+        updateColorProfile(refreshArgs);
+        updateAndWriteCompositionState(refreshArgs);
+        setColorTransform(refreshArgs);
+    }
     beginFrame();
     prepareFrame();
     devOptRepaintFlash(refreshArgs);
@@ -318,6 +327,159 @@ void Output::present(const compositionengine::CompositionRefreshArgs& refreshArg
     postFramebuffer();
 }
 
+namespace {
+
+// 64-bit FNV-1a, used to fingerprint the inputs of the visibility
+// computation.  A collision would skip a needed recomputation, but at
+// 64 bits that is not a practical concern.
+constexpr uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+constexpr uint64_t kFnvPrime = 0x100000001b3ull;
+
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+template <typename T>
+uint64_t hashValue(uint64_t hash, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    return hashBytes(hash, &value, sizeof(value));
+}
+
+uint64_t hashTransform(uint64_t hash, const ui::Transform& transform) {
+    for (size_t i = 0; i < 3; i++) {
+        hash = hashValue(hash, transform[i]);
+    }
+    return hash;
+}
+
+uint64_t hashRegion(uint64_t hash, const Region& region) {
+    for (const Rect* rect = region.begin(); rect != region.end(); rect++) {
+        hash = hashValue(hash, *rect);
+    }
+    return hash;
+}
+
+} // anonymous namespace
+
+uint64_t Output::computeVisibilityInputHash(
+        const compositionengine::CompositionRefreshArgs& refreshArgs, LayerFESet& layerFESet) {
+    const auto& outputState = getState();
+
+    uint64_t hash = kFnvOffset;
+    hash = hashValue(hash, outputState.bounds);
+    hash = hashTransform(hash, outputState.transform);
+
+    for (const auto& layerFE : refreshArgs.layers) {
+        // Latch the basic geometry snapshot if no other output has done
+        // so yet this frame; ensureOutputLayerIfVisible performs the
+        // same once-per-frame latch and will see it as already taken.
+        if (!layerFESet.count(layerFE)) {
+            layerFESet.insert(layerFE);
+            layerFE->prepareCompositionState(
+                    compositionengine::LayerFE::StateSubset::BasicGeometry);
+        }
+
+        if (!belongsInOutput(layerFE)) {
+            continue;
+        }
+
+        const auto* layerFEState = layerFE->getCompositionState();
+        if (!layerFEState) {
+            continue;
+        }
+
+        const void* identity = layerFE.get();
+        hash = hashValue(hash, identity);
+        hash = hashValue(hash, layerFEState->isVisible);
+        hash = hashValue(hash, layerFEState->isOpaque);
+        hash = hashValue(hash, layerFEState->contentDirty);
+        hash = hashValue(hash, layerFEState->shadowRadius);
+        hash = hashValue(hash, layerFEState->geomLayerBounds);
+        hash = hashTransform(hash, layerFEState->geomLayerTransform);
+        hash = hashRegion(hash, layerFEState->transparentRegionHint);
+    }
+    return hash;
+}
+
+uint64_t Output::computeRepeatFrameHash(
+        const compositionengine::CompositionRefreshArgs& refreshArgs) const {
+    uint64_t hash = kFnvOffset;
+    hash = hashValue(hash, refreshArgs.outputColorSetting);
+    hash = hashValue(hash, refreshArgs.colorSpaceAgnosticDataspace);
+    hash = hashValue(hash, refreshArgs.forceOutputColorMode);
+    const mat4 colorTransform = refreshArgs.colorTransformMatrix.value_or(mat4());
+    hash = hashBytes(hash, colorTransform.asArray(), sizeof(mat4));
+
+    for (const auto* layer : getOutputLayersOrderedByZ()) {
+        const auto* layerFEState = layer->getLayerFE().getCompositionState();
+        if (!layerFEState) {
+            continue;
+        }
+
+        // Everything the color and composition strategy decisions consume, except the
+        // buffer itself and its fences and damage, which are exempt from
+        // re-validation by the HWC.
+        const void* identity = &layer->getLayerFE();
+        hash = hashValue(hash, identity);
+        hash = hashValue(hash, layerFEState->forceClientComposition);
+        hash = hashValue(hash, layerFEState->isVisible);
+        hash = hashValue(hash, layerFEState->isOpaque);
+        hash = hashValue(hash, layerFEState->alpha);
+        hash = hashValue(hash, layerFEState->backgroundBlurRadius);
+        hash = hashValue(hash, layerFEState->blendMode);
+        hash = hashValue(hash, layerFEState->compositionType);
+        hash = hashValue(hash, layerFEState->isColorspaceAgnostic);
+        hash = hashValue(hash, layerFEState->dataspace);
+        hash = hashValue(hash, layerFEState->hdrMetadata.validTypes);
+        hash = hashValue(hash, layerFEState->colorTransformIsIdentity);
+        hash = hashValue(hash, layerFEState->hasProtectedContent);
+        hash = hashValue(hash, layerFEState->color);
+        const void* sidebandStream = layerFEState->sidebandStream.get();
+        hash = hashValue(hash, sidebandStream);
+    }
+    return hash;
+}
+
+bool Output::canReuseCompositionStrategy(
+        const compositionengine::CompositionRefreshArgs& refreshArgs) {
+    const auto& outputState = getState();
+
+    // The fast path only applies to fully device-composed outputs with a stable layer
+    // stack: geometry updates, client composition and the developer options all force
+    // the full per-frame evaluation.
+    const bool eligible = outputState.isEnabled && !refreshArgs.updatingGeometryThisFrame &&
+            !refreshArgs.updatingOutputGeometryThisFrame &&
+            !refreshArgs.devOptForceClientComposition &&
+            !refreshArgs.devOptFlashDirtyRegionsDelay && !outputState.usesClientComposition &&
+            outputState.usesDeviceComposition &&
+            findLayerRequestingBackgroundComposition() == nullptr;
+    if (!eligible) {
+        mRepeatFrameHash.reset();
+        return false;
+    }
+
+    const uint64_t hash = computeRepeatFrameHash(refreshArgs);
+    const bool repeat = mRepeatFrameHash == std::make_optional(hash);
+    mRepeatFrameHash = hash;
+    return repeat;
+}
+
+void Output::writeRepeatFrameStateToHWC() {
+    ATRACE_CALL();
+    ALOGV(__FUNCTION__);
+
+    // Only per-frame content (buffer, fences, damage) changed, so the derived output
+    // layer state from the previous frame still holds.
+    for (auto* layer : getOutputLayersOrderedByZ()) {
+        layer->writeStateToHWC(false);
+    }
+}
+
 void Output::rebuildLayerStacks(const compositionengine::CompositionRefreshArgs& refreshArgs,
                                 LayerFESet& layerFESet) {
     ATRACE_CALL();
@@ -330,6 +492,17 @@ void Output::rebuildLayerStacks(const compositionengine::CompositionRefreshArgs&
         return;
     }
 
+    // updatingOutputGeometryThisFrame is a global signal: one layer
+    // changing geometry forces every output to rebuild.  Fingerprint the
+    // inputs this output's visibility computation actually consumes, and
+    // keep the cached output layer stack and coverage when nothing
+    // relevant changed since the last rebuild.
+    const uint64_t visibilityInputHash = computeVisibilityInputHash(refreshArgs, layerFESet);
+    if (visibilityInputHash == mVisibilityInputHash) {
+        return;
+    }
+    mVisibilityInputHash = visibilityInputHash;
+
     // Process the layers to determine visibility and coverage
     compositionengine::Output::CoverageState coverage{layerFESet};
     collectVisibleLayers(refreshArgs, coverage);
@@ -582,13 +755,38 @@ void Output::updateAndWriteCompositionState(
         return;
     }
 
+    mReduceCompositionEffort = refreshArgs.reduceCompositionEffort;
     mLayerRequestingBackgroundBlur = findLayerRequestingBackgroundComposition();
+    if (mLayerRequestingBackgroundBlur != nullptr && mReduceCompositionEffort) {
+        // Skipping the blur keeps the layers beneath it eligible for device
+        // composition, trading visual polish for meeting the present deadline.
+        ALOGV("Skipping background blur to reduce composition effort");
+        mLayerRequestingBackgroundBlur = nullptr;
+    }
     bool forceClientComposition = mLayerRequestingBackgroundBlur != nullptr;
 
+    // The blur only samples the client target within the blur layer's visible
+    // region, grown by the blur radius. Layers beneath the blur whose visible
+    // region does not reach that area contribute nothing to the blurred
+    // pixels, so they can keep their overlays and only the affected subregion
+    // needs to be client composed.
+    Region blurSampleRegion;
+    if (mLayerRequestingBackgroundBlur != nullptr) {
+        const auto* blurFEState = mLayerRequestingBackgroundBlur->getLayerFE().getCompositionState();
+        const auto growth = static_cast<int32_t>(ceilf(blurFEState->backgroundBlurRadius));
+        for (const Rect& rect : mLayerRequestingBackgroundBlur->getState().visibleRegion) {
+            Rect sampleRect = rect;
+            sampleRect.inset(-growth, -growth, -growth, -growth);
+            blurSampleRegion.orSelf(sampleRect);
+        }
+    }
+
     for (auto* layer : getOutputLayersOrderedByZ()) {
+        const bool affectedByBlur = forceClientComposition &&
+                (mLayerRequestingBackgroundBlur == layer ||
+                 !layer->getState().visibleRegion.intersect(blurSampleRegion).isEmpty());
         layer->updateCompositionState(refreshArgs.updatingGeometryThisFrame,
-                                      refreshArgs.devOptForceClientComposition ||
-                                              forceClientComposition,
+                                      refreshArgs.devOptForceClientComposition || affectedByBlur,
                                       refreshArgs.internalDisplayRotationFlags);
 
         if (mLayerRequestingBackgroundBlur == layer) {
@@ -769,7 +967,13 @@ void Output::prepareFrame() {
         return;
     }
 
-    chooseCompositionStrategy();
+    // On a repeat frame only exempt per-frame state (buffers, fences, damage) reached
+    // the HWC, so the strategy chosen for the previous frame is still valid.
+    if (mReuseCompositionStrategy) {
+        reuseCompositionStrategy();
+    } else {
+        chooseCompositionStrategy();
+    }
 
     mRenderSurface->prepareFrame(outputState.usesClientComposition,
                                  outputState.usesDeviceComposition);
@@ -1018,6 +1222,7 @@ std::vector<LayerFE::LayerSettings> Output::generateClientCompositionRequests(
                     outputDataspace,
                     realContentIsVisible,
                     !clientComposition, /* clearContent  */
+                    mReduceCompositionEffort, /* disableBackgroundBlur */
             };
             std::vector<LayerFE::LayerSettings> results =
                     layerFE.prepareClientCompositionList(targetSettings);
@@ -1126,6 +1331,11 @@ void Output::chooseCompositionStrategy() {
     outputState.reusedClientComposition = false;
 }
 
+void Output::reuseCompositionStrategy() {
+    // The previous strategy carries over unchanged; the base output has no
+    // per-frame bookkeeping to reset.
+}
+
 bool Output::getSkipColorTransform() const {
     return true;
 }
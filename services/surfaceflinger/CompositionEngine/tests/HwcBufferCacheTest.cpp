@@ -78,6 +78,23 @@ TEST_F(HwcBufferCacheTest, cacheWorksForMaxSlot) {
     testSlot(BufferQueue::NUM_BUFFER_SLOTS - 1, BufferQueue::NUM_BUFFER_SLOTS - 1);
 }
 
+TEST_F(HwcBufferCacheTest, countsEvictionWhenOccupiedSlotIsReused) {
+    uint32_t outSlot;
+    sp<GraphicBuffer> outBuffer;
+
+    // Populating an empty slot is not an eviction.
+    mCache.getHwcBuffer(0, mBuffer1, &outSlot, &outBuffer);
+    EXPECT_EQ(0u, mCache.getSlotEvictionCount());
+
+    // Neither is sending the cached buffer again.
+    mCache.getHwcBuffer(0, mBuffer1, &outSlot, &outBuffer);
+    EXPECT_EQ(0u, mCache.getSlotEvictionCount());
+
+    // Replacing the cached buffer with a different one is.
+    mCache.getHwcBuffer(0, mBuffer2, &outSlot, &outBuffer);
+    EXPECT_EQ(1u, mCache.getSlotEvictionCount());
+}
+
 TEST_F(HwcBufferCacheTest, cacheMapsNegativeSlotToZero) {
     testSlot(-123, 0);
 }
@@ -49,9 +49,10 @@ public:
     MOCK_METHOD2(allocatePhysicalDisplay, void(hal::HWDisplayId, DisplayId));
     MOCK_METHOD1(createLayer, HWC2::Layer*(DisplayId));
     MOCK_METHOD2(destroyLayer, void(DisplayId, HWC2::Layer*));
-    MOCK_METHOD3(getDeviceCompositionChanges,
-                 status_t(DisplayId, bool,
+    MOCK_METHOD4(getDeviceCompositionChanges,
+                 status_t(DisplayId, bool, uint64_t,
                           std::optional<android::HWComposer::DeviceRequestedChanges>*));
+    MOCK_METHOD1(clearSkipValidateState, void(DisplayId));
     MOCK_METHOD5(setClientTarget,
                  status_t(DisplayId, uint32_t, const sp<Fence>&, const sp<GraphicBuffer>&,
                           ui::Dataspace));
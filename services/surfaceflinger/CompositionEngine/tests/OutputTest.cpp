@@ -3916,7 +3916,8 @@ TEST_F(OutputUpdateAndWriteCompositionStateTest, handlesBackgroundBlurRequests)
     InjectedLayer layer2;
     InjectedLayer layer3;
 
-    // Layer requesting blur, or below, should request client composition.
+    // Layer requesting blur, or below and within the sampled region, should
+    // request client composition.
     EXPECT_CALL(*layer1.outputLayer, updateCompositionState(false, true, ui::Transform::ROT_0));
     EXPECT_CALL(*layer1.outputLayer, writeStateToHWC(false));
     EXPECT_CALL(*layer2.outputLayer, updateCompositionState(false, true, ui::Transform::ROT_0));
@@ -3924,7 +3925,10 @@ TEST_F(OutputUpdateAndWriteCompositionStateTest, handlesBackgroundBlurRequests)
     EXPECT_CALL(*layer3.outputLayer, updateCompositionState(false, false, ui::Transform::ROT_0));
     EXPECT_CALL(*layer3.outputLayer, writeStateToHWC(false));
 
+    layer1.outputLayerState.visibleRegion = Region(Rect(0, 0, 200, 200));
+    layer2.outputLayerState.visibleRegion = Region(Rect(50, 50, 150, 150));
     layer2.layerFEState.backgroundBlurRadius = 10;
+    layer3.outputLayerState.visibleRegion = Region(Rect(0, 0, 200, 200));
 
     injectOutputLayer(layer1);
     injectOutputLayer(layer2);
@@ -3938,6 +3942,74 @@ TEST_F(OutputUpdateAndWriteCompositionStateTest, handlesBackgroundBlurRequests)
     mOutput->updateAndWriteCompositionState(args);
 }
 
+TEST_F(OutputUpdateAndWriteCompositionStateTest, scopesBackgroundBlurToSampledRegion) {
+    InjectedLayer layer1;
+    InjectedLayer layer2;
+    InjectedLayer layer3;
+    InjectedLayer layer4;
+
+    // Layers below the blur that stay outside the blurred region, even after
+    // it is grown by the blur radius, contribute nothing to the blurred
+    // pixels and keep their overlays. Layers above the blur are never forced.
+    EXPECT_CALL(*layer1.outputLayer, updateCompositionState(false, false, ui::Transform::ROT_0));
+    EXPECT_CALL(*layer1.outputLayer, writeStateToHWC(false));
+    EXPECT_CALL(*layer2.outputLayer, updateCompositionState(false, true, ui::Transform::ROT_0));
+    EXPECT_CALL(*layer2.outputLayer, writeStateToHWC(false));
+    EXPECT_CALL(*layer3.outputLayer, updateCompositionState(false, true, ui::Transform::ROT_0));
+    EXPECT_CALL(*layer3.outputLayer, writeStateToHWC(false));
+    EXPECT_CALL(*layer4.outputLayer, updateCompositionState(false, false, ui::Transform::ROT_0));
+    EXPECT_CALL(*layer4.outputLayer, writeStateToHWC(false));
+
+    // The blur layer covers [100,100,200,200] with radius 10, so it samples
+    // out to [90,90,210,210].
+    layer1.outputLayerState.visibleRegion = Region(Rect(300, 300, 400, 400));
+    layer2.outputLayerState.visibleRegion = Region(Rect(200, 100, 205, 200));
+    layer3.outputLayerState.visibleRegion = Region(Rect(100, 100, 200, 200));
+    layer3.layerFEState.backgroundBlurRadius = 10;
+    layer4.outputLayerState.visibleRegion = Region(Rect(0, 0, 400, 400));
+
+    injectOutputLayer(layer1);
+    injectOutputLayer(layer2);
+    injectOutputLayer(layer3);
+    injectOutputLayer(layer4);
+
+    mOutput->editState().isEnabled = true;
+
+    CompositionRefreshArgs args;
+    args.updatingGeometryThisFrame = false;
+    args.devOptForceClientComposition = false;
+    mOutput->updateAndWriteCompositionState(args);
+}
+
+TEST_F(OutputUpdateAndWriteCompositionStateTest, skipsBackgroundBlurWhenReducingEffort) {
+    InjectedLayer layer1;
+    InjectedLayer layer2;
+    InjectedLayer layer3;
+
+    // When composition effort is reduced, the blur request is dropped, so no
+    // layer should be forced to client composition because of it.
+    EXPECT_CALL(*layer1.outputLayer, updateCompositionState(false, false, ui::Transform::ROT_0));
+    EXPECT_CALL(*layer1.outputLayer, writeStateToHWC(false));
+    EXPECT_CALL(*layer2.outputLayer, updateCompositionState(false, false, ui::Transform::ROT_0));
+    EXPECT_CALL(*layer2.outputLayer, writeStateToHWC(false));
+    EXPECT_CALL(*layer3.outputLayer, updateCompositionState(false, false, ui::Transform::ROT_0));
+    EXPECT_CALL(*layer3.outputLayer, writeStateToHWC(false));
+
+    layer2.layerFEState.backgroundBlurRadius = 10;
+
+    injectOutputLayer(layer1);
+    injectOutputLayer(layer2);
+    injectOutputLayer(layer3);
+
+    mOutput->editState().isEnabled = true;
+
+    CompositionRefreshArgs args;
+    args.updatingGeometryThisFrame = false;
+    args.devOptForceClientComposition = false;
+    args.reduceCompositionEffort = true;
+    mOutput->updateAndWriteCompositionState(args);
+}
+
 TEST_F(GenerateClientCompositionRequestsTest, handlesLandscapeModeSplitScreenRequests) {
     // In split-screen landscape mode, the screen is rotated 90 degrees, with
     // one layer on the left covering the left side of the output, and one layer
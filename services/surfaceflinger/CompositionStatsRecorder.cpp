@@ -0,0 +1,102 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CompositionStatsRecorder.h"
+
+#include <inttypes.h>
+
+#include <android-base/stringprintf.h>
+
+namespace android {
+
+using base::StringAppendF;
+
+namespace {
+
+const char* stageName(size_t stage) {
+    switch (stage) {
+        case CompositionStats::STAGE_LATCH:
+            return "latch";
+        case CompositionStats::STAGE_PREPARE:
+            return "prepare";
+        case CompositionStats::STAGE_COMPOSITE:
+            return "composite";
+        case CompositionStats::STAGE_PRESENT:
+            return "present";
+        default:
+            return "unknown";
+    }
+}
+
+size_t durationToBucket(nsecs_t duration) {
+    const uint64_t us = duration > 0 ? static_cast<uint64_t>(duration) / 1000 : 0;
+    if (us < 2) {
+        return 0;
+    }
+    const size_t bucket = 63 - static_cast<size_t>(__builtin_clzll(us));
+    return bucket < CompositionStats::NUM_BUCKETS ? bucket
+                                                  : CompositionStats::NUM_BUCKETS - 1;
+}
+
+} // namespace
+
+void CompositionStatsRecorder::recordDuration(CompositionStats::Stage stage, nsecs_t duration) {
+    if (stage >= CompositionStats::NUM_STAGES || duration < 0) {
+        return;
+    }
+    mCount[stage].fetch_add(1, std::memory_order_relaxed);
+    mTotalNs[stage].fetch_add(duration, std::memory_order_relaxed);
+    mHistogram[stage][durationToBucket(duration)].fetch_add(1, std::memory_order_relaxed);
+
+    nsecs_t max = mMaxNs[stage].load(std::memory_order_relaxed);
+    while (duration > max &&
+           !mMaxNs[stage].compare_exchange_weak(max, duration, std::memory_order_relaxed)) {
+    }
+}
+
+void CompositionStatsRecorder::get(CompositionStats* outStats) const {
+    for (size_t stage = 0; stage < CompositionStats::NUM_STAGES; stage++) {
+        outStats->count[stage] = mCount[stage].load(std::memory_order_relaxed);
+        outStats->totalNs[stage] = mTotalNs[stage].load(std::memory_order_relaxed);
+        outStats->maxNs[stage] = mMaxNs[stage].load(std::memory_order_relaxed);
+        for (size_t bucket = 0; bucket < CompositionStats::NUM_BUCKETS; bucket++) {
+            outStats->histogram[stage][bucket] =
+                    mHistogram[stage][bucket].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void CompositionStatsRecorder::dump(std::string& result) const {
+    CompositionStats stats;
+    get(&stats);
+
+    result.append("Composition stage stats (since boot):\n");
+    for (size_t stage = 0; stage < CompositionStats::NUM_STAGES; stage++) {
+        const uint64_t count = stats.count[stage];
+        const double avgMs = count > 0 ? stats.totalNs[stage] / (1e6 * count) : 0.0;
+        StringAppendF(&result, "  %-9s count=%" PRIu64 " avg=%.3f ms max=%.3f ms\n",
+                      stageName(stage), count, avgMs, stats.maxNs[stage] / 1e6);
+        for (size_t bucket = 0; bucket < CompositionStats::NUM_BUCKETS; bucket++) {
+            if (stats.histogram[stage][bucket] == 0) {
+                continue;
+            }
+            StringAppendF(&result, "    < %" PRIu64 " us: %" PRIu64 "\n",
+                          uint64_t(1) << (bucket + 1), stats.histogram[stage][bucket]);
+        }
+    }
+}
+
+} // namespace android
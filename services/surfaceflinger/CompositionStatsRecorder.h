@@ -0,0 +1,50 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include <ui/CompositionStats.h>
+#include <utils/Timers.h>
+
+namespace android {
+
+// Always-on, lock-free accumulator for per-stage composition timing. The
+// main thread records each stage with relaxed atomic increments, which is
+// cheap enough to leave enabled in production builds where atrace is off.
+// Readers (dumpsys and getCompositionStats) take a snapshot that is
+// consistent enough for trending; no attempt is made to read all counters
+// atomically as a group.
+class CompositionStatsRecorder {
+public:
+    void recordDuration(CompositionStats::Stage stage, nsecs_t duration);
+
+    // Copies the current counters into *outStats.
+    void get(CompositionStats* outStats) const;
+
+    void dump(std::string& result) const;
+
+private:
+    std::atomic<uint64_t> mCount[CompositionStats::NUM_STAGES]{};
+    std::atomic<nsecs_t> mTotalNs[CompositionStats::NUM_STAGES]{};
+    std::atomic<nsecs_t> mMaxNs[CompositionStats::NUM_STAGES]{};
+    std::atomic<uint64_t> mHistogram[CompositionStats::NUM_STAGES]
+                                    [CompositionStats::NUM_BUCKETS]{};
+};
+
+} // namespace android
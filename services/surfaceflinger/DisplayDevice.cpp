@@ -72,9 +72,9 @@ DisplayDevice::DisplayDevice(DisplayDeviceCreationArgs& args)
                                                          args.nativeWindow, args.displaySurface});
 
     if (!mFlinger->mDisableClientCompositionCache &&
-        SurfaceFlinger::maxFrameBufferAcquiredBuffers > 0) {
+        SurfaceFlinger::clientTargetBufferDepth > 0) {
         mCompositionDisplay->createClientCompositionCache(
-                static_cast<uint32_t>(SurfaceFlinger::maxFrameBufferAcquiredBuffers));
+                static_cast<uint32_t>(SurfaceFlinger::clientTargetBufferDepth));
     }
 
     mCompositionDisplay->createDisplayColorProfile(
@@ -128,17 +128,13 @@ namespace impl {
 
 void Composer::CommandWriter::setLayerType(uint32_t type)
 {
-    constexpr uint16_t kSetLayerTypeLength = 1;
-    beginCommand(static_cast<V2_1::IComposerClient::Command>(
-                         IQtiComposerClient::Command::SET_LAYER_TYPE),
-                 kSetLayerTypeLength);
-    write(type);
-    endCommand();
+    writeFixedCommand<static_cast<V2_1::IComposerClient::Command>(
+            IQtiComposerClient::Command::SET_LAYER_TYPE)>(type);
 }
 
 #if defined(USE_VR_COMPOSER) && USE_VR_COMPOSER
 Composer::CommandWriter::CommandWriter(uint32_t initialMaxSize)
-    : CommandWriterBase(initialMaxSize) {}
+    : TypedCommandWriterBase(initialMaxSize) {}
 
 Composer::CommandWriter::~CommandWriter()
 {
@@ -191,12 +187,8 @@ void Composer::CommandWriter::writeBufferMetadata(
 
 void Composer::CommandWriter::setDisplayElapseTime(uint64_t time)
 {
-    constexpr uint16_t kSetDisplayElapseTimeLength = 2;
-    beginCommand(static_cast<V2_1::IComposerClient::Command>(
-                         IQtiComposerClient::Command::SET_DISPLAY_ELAPSE_TIME),
-                 kSetDisplayElapseTimeLength);
-    write64(time);
-    endCommand();
+    writeFixedCommand<static_cast<V2_1::IComposerClient::Command>(
+            IQtiComposerClient::Command::SET_DISPLAY_ELAPSE_TIME)>(time);
 }
 
 Composer::Composer(const std::string& serviceName)
@@ -319,13 +311,52 @@ bool Composer::isRemote() {
 }
 
 void Composer::resetCommands() {
-    mWriter.reset();
+    std::lock_guard lock(mCommandMutex);
+    resetWriter();
 }
 
 Error Composer::executeCommands() {
+    std::lock_guard lock(mCommandMutex);
     return execute();
 }
 
+void Composer::resetWriter()
+{
+    mWriter.reset();
+    mSelectedDisplayValid = false;
+    mSelectedLayerValid = false;
+}
+
+void Composer::selectDisplay(Display display)
+{
+    if (mSelectedDisplayValid && mSelectedDisplay == display) {
+        return;
+    }
+    mWriter.selectDisplay(display);
+    mSelectedDisplay = display;
+    mSelectedDisplayValid = true;
+    // Layer ids are scoped to a display, so switching displays invalidates
+    // the current layer selection.
+    mSelectedLayerValid = false;
+}
+
+void Composer::selectLayer(Layer layer)
+{
+    if (updateLayerSelection(layer)) {
+        mWriter.selectLayer(layer);
+    }
+}
+
+bool Composer::updateLayerSelection(Layer layer)
+{
+    if (mSelectedLayerValid && mSelectedLayer == layer) {
+        return false;
+    }
+    mSelectedLayer = layer;
+    mSelectedLayerValid = true;
+    return true;
+}
+
 uint32_t Composer::getMaxVirtualDisplayCount()
 {
     auto ret = mClient->getMaxVirtualDisplayCount();
@@ -378,7 +409,8 @@ Error Composer::destroyVirtualDisplay(Display display)
 
 Error Composer::acceptDisplayChanges(Display display)
 {
-    mWriter.selectDisplay(display);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
     mWriter.acceptDisplayChanges();
     return Error::NONE;
 }
@@ -425,6 +457,7 @@ Error Composer::getChangedCompositionTypes(Display display,
         std::vector<Layer>* outLayers,
         std::vector<IComposerClient::Composition>* outTypes)
 {
+    std::lock_guard lock(mCommandMutex);
     mReader.takeChangedCompositionTypes(display, outLayers, outTypes);
     return Error::NONE;
 }
@@ -537,6 +570,7 @@ Error Composer::getDisplayRequests(Display display,
         uint32_t* outDisplayRequestMask, std::vector<Layer>* outLayers,
         std::vector<uint32_t>* outLayerRequestMasks)
 {
+    std::lock_guard lock(mCommandMutex);
     mReader.takeDisplayRequests(display, outDisplayRequestMask,
             outLayers, outLayerRequestMasks);
     return Error::NONE;
@@ -607,13 +641,15 @@ Error Composer::getHdrCapabilities(Display display,
 Error Composer::getReleaseFences(Display display,
         std::vector<Layer>* outLayers, std::vector<int>* outReleaseFences)
 {
+    std::lock_guard lock(mCommandMutex);
     mReader.takeReleaseFences(display, outLayers, outReleaseFences);
     return Error::NONE;
 }
 
 Error Composer::presentDisplay(Display display, int* outPresentFence)
 {
-    mWriter.selectDisplay(display);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
     mWriter.presentDisplay();
 
     Error error = execute();
@@ -637,7 +673,8 @@ Error Composer::setClientTarget(Display display, uint32_t slot,
         int acquireFence, Dataspace dataspace,
         const std::vector<IComposerClient::Rect>& damage)
 {
-    mWriter.selectDisplay(display);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
 
 #if defined(USE_VR_COMPOSER) && USE_VR_COMPOSER
     if (mIsUsingVrComposer && target.get()) {
@@ -681,7 +718,8 @@ Error Composer::setColorMode(Display display, ColorMode mode,
 Error Composer::setColorTransform(Display display, const float* matrix,
         ColorTransform hint)
 {
-    mWriter.selectDisplay(display);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
     mWriter.setColorTransform(matrix, hint);
     return Error::NONE;
 }
@@ -689,14 +727,16 @@ Error Composer::setColorTransform(Display display, const float* matrix,
 Error Composer::setOutputBuffer(Display display, const native_handle_t* buffer,
         int releaseFence)
 {
-    mWriter.selectDisplay(display);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
     mWriter.setOutputBuffer(0, buffer, dup(releaseFence));
     return Error::NONE;
 }
 
 Error Composer::setDisplayElapseTime(Display display, uint64_t timeStamp)
 {
-    mWriter.selectDisplay(display);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
     mWriter.setDisplayElapseTime(timeStamp);
     return Error::NONE;
 }
@@ -728,7 +768,8 @@ Error Composer::setClientTargetSlotCount(Display display)
 Error Composer::validateDisplay(Display display, uint32_t* outNumTypes,
         uint32_t* outNumRequests)
 {
-    mWriter.selectDisplay(display);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
     mWriter.validateDisplay();
 
     Error error = execute();
@@ -743,7 +784,8 @@ Error Composer::validateDisplay(Display display, uint32_t* outNumTypes,
 
 Error Composer::presentOrValidateDisplay(Display display, uint32_t* outNumTypes,
                                uint32_t* outNumRequests, int* outPresentFence, uint32_t* state) {
-   mWriter.selectDisplay(display);
+    std::lock_guard lock(mCommandMutex);
+   selectDisplay(display);
    mWriter.presentOrvalidateDisplay();
 
    Error error = execute();
@@ -767,8 +809,9 @@ Error Composer::presentOrValidateDisplay(Display display, uint32_t* outNumTypes,
 Error Composer::setCursorPosition(Display display, Layer layer,
         int32_t x, int32_t y)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerCursorPosition(x, y);
     return Error::NONE;
 }
@@ -776,10 +819,11 @@ Error Composer::setCursorPosition(Display display, Layer layer,
 Error Composer::setLayerBuffer(Display display, Layer layer,
         uint32_t slot, const sp<GraphicBuffer>& buffer, int acquireFence)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
 
 #if defined(USE_VR_COMPOSER) && USE_VR_COMPOSER
+    selectLayer(layer);
     if (mIsUsingVrComposer && buffer.get()) {
         IVrComposerClient::BufferMetadata metadata = {
                 .width = buffer->getWidth(),
@@ -798,15 +842,20 @@ Error Composer::setLayerBuffer(Display display, Layer layer,
         handle = buffer->getNativeBuffer()->handle;
     }
 
-    mWriter.setLayerBuffer(slot, handle, acquireFence);
+    if (updateLayerSelection(layer)) {
+        mWriter.selectLayerAndSetBuffer(layer, slot, handle, acquireFence);
+    } else {
+        mWriter.setLayerBuffer(slot, handle, acquireFence);
+    }
     return Error::NONE;
 }
 
 Error Composer::setLayerSurfaceDamage(Display display, Layer layer,
         const std::vector<IComposerClient::Rect>& damage)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerSurfaceDamage(damage);
     return Error::NONE;
 }
@@ -814,8 +863,9 @@ Error Composer::setLayerSurfaceDamage(Display display, Layer layer,
 Error Composer::setLayerBlendMode(Display display, Layer layer,
         IComposerClient::BlendMode mode)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerBlendMode(mode);
     return Error::NONE;
 }
@@ -823,8 +873,9 @@ Error Composer::setLayerBlendMode(Display display, Layer layer,
 Error Composer::setLayerColor(Display display, Layer layer,
         const IComposerClient::Color& color)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerColor(color);
     return Error::NONE;
 }
@@ -832,8 +883,9 @@ Error Composer::setLayerColor(Display display, Layer layer,
 Error Composer::setLayerCompositionType(Display display, Layer layer,
         IComposerClient::Composition type)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerCompositionType(type);
     return Error::NONE;
 }
@@ -841,17 +893,22 @@ Error Composer::setLayerCompositionType(Display display, Layer layer,
 Error Composer::setLayerDataspace(Display display, Layer layer,
         Dataspace dataspace)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
-    mWriter.setLayerDataspace(dataspace);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
+    if (updateLayerSelection(layer)) {
+        mWriter.selectLayerAndSetDataspace(layer, dataspace);
+    } else {
+        mWriter.setLayerDataspace(dataspace);
+    }
     return Error::NONE;
 }
 
 Error Composer::setLayerDisplayFrame(Display display, Layer layer,
         const IComposerClient::Rect& frame)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerDisplayFrame(frame);
     return Error::NONE;
 }
@@ -859,8 +916,9 @@ Error Composer::setLayerDisplayFrame(Display display, Layer layer,
 Error Composer::setLayerPlaneAlpha(Display display, Layer layer,
         float alpha)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerPlaneAlpha(alpha);
     return Error::NONE;
 }
@@ -868,8 +926,9 @@ Error Composer::setLayerPlaneAlpha(Display display, Layer layer,
 Error Composer::setLayerSidebandStream(Display display, Layer layer,
         const native_handle_t* stream)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerSidebandStream(stream);
     return Error::NONE;
 }
@@ -877,8 +936,9 @@ Error Composer::setLayerSidebandStream(Display display, Layer layer,
 Error Composer::setLayerSourceCrop(Display display, Layer layer,
         const IComposerClient::FRect& crop)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerSourceCrop(crop);
     return Error::NONE;
 }
@@ -886,8 +946,9 @@ Error Composer::setLayerSourceCrop(Display display, Layer layer,
 Error Composer::setLayerTransform(Display display, Layer layer,
         Transform transform)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerTransform(transform);
     return Error::NONE;
 }
@@ -895,16 +956,18 @@ Error Composer::setLayerTransform(Display display, Layer layer,
 Error Composer::setLayerVisibleRegion(Display display, Layer layer,
         const std::vector<IComposerClient::Rect>& visible)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerVisibleRegion(visible);
     return Error::NONE;
 }
 
 Error Composer::setLayerZOrder(Display display, Layer layer, uint32_t z)
 {
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    std::lock_guard lock(mCommandMutex);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerZOrder(z);
     return Error::NONE;
 }
@@ -913,18 +976,20 @@ Error Composer::setLayerZOrder(Display display, Layer layer, uint32_t z)
 Error Composer::setLayerInfo(Display display, Layer layer, uint32_t type,
                              uint32_t appId)
 {
+    std::lock_guard lock(mCommandMutex);
     if (mIsUsingVrComposer) {
-        mWriter.selectDisplay(display);
-        mWriter.selectLayer(layer);
+        selectDisplay(display);
+        selectLayer(layer);
         mWriter.setLayerInfo(type, appId);
     }
     return Error::NONE;
 }
 #else
 Error Composer::setLayerInfo(Display display, Layer layer, uint32_t, uint32_t) {
+    std::lock_guard lock(mCommandMutex);
     if (mIsUsingVrComposer) {
-        mWriter.selectDisplay(display);
-        mWriter.selectLayer(layer);
+        selectDisplay(display);
+        selectLayer(layer);
     }
     return Error::NONE;
 }
@@ -932,10 +997,11 @@ Error Composer::setLayerInfo(Display display, Layer layer, uint32_t, uint32_t) {
 
 Error Composer::setLayerType(Display display, Layer layer, uint32_t type)
 {
+    std::lock_guard lock(mCommandMutex);
     if (mClient_2_4) {
         if (sp<IQtiComposerClient> qClient = IQtiComposerClient::castFrom(mClient_2_4)) {
-            mWriter.selectDisplay(display);
-            mWriter.selectLayer(layer);
+            selectDisplay(display);
+            selectLayer(layer);
             mWriter.setLayerType(type);
         }
     }
@@ -950,7 +1016,7 @@ Error Composer::execute()
     uint32_t commandLength = 0;
     hidl_vec<hidl_handle> commandHandles;
     if (!mWriter.writeQueue(&queueChanged, &commandLength, &commandHandles)) {
-        mWriter.reset();
+        resetWriter();
         return Error::NO_RESOURCES;
     }
 
@@ -959,13 +1025,13 @@ Error Composer::execute()
         auto ret = mClient->setInputCommandQueue(*mWriter.getMQDescriptor());
         auto error = unwrapRet(ret);
         if (error != Error::NONE) {
-            mWriter.reset();
+            resetWriter();
             return error;
         }
     }
 
     if (commandLength == 0) {
-        mWriter.reset();
+        resetWriter();
         return Error::NONE;
     }
 
@@ -1033,7 +1099,7 @@ Error Composer::execute()
         }
     }
 
-    mWriter.reset();
+    resetWriter();
 
     return error;
 }
@@ -1042,12 +1108,13 @@ Error Composer::execute()
 
 Error Composer::setLayerPerFrameMetadata(Display display, Layer layer,
         const std::vector<IComposerClient::PerFrameMetadata>& perFrameMetadatas) {
+    std::lock_guard lock(mCommandMutex);
     if (!mClient_2_2) {
         return Error::UNSUPPORTED;
     }
 
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerPerFrameMetadata(perFrameMetadatas);
     return Error::NONE;
 }
@@ -1165,12 +1232,13 @@ Error Composer::getDisplayIdentificationData(Display display, uint8_t* outPort,
 
 Error Composer::setLayerColorTransform(Display display, Layer layer, const float* matrix)
 {
+    std::lock_guard lock(mCommandMutex);
     if (!mClient_2_3) {
         return Error::UNSUPPORTED;
     }
 
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerColorTransform(matrix);
     return Error::NONE;
 }
@@ -1242,12 +1310,13 @@ Error Composer::getDisplayedContentSample(Display display, uint64_t maxFrames, u
 Error Composer::setLayerPerFrameMetadataBlobs(
         Display display, Layer layer,
         const std::vector<IComposerClient::PerFrameMetadataBlob>& metadata) {
+    std::lock_guard lock(mCommandMutex);
     if (!mClient_2_3) {
         return Error::UNSUPPORTED;
     }
 
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerPerFrameMetadataBlobs(metadata);
     return Error::NONE;
 }
@@ -1398,12 +1467,13 @@ V2_4::Error Composer::setContentType(Display display, IComposerClient::ContentTy
 
 V2_4::Error Composer::setLayerGenericMetadata(Display display, Layer layer, const std::string& key,
                                               bool mandatory, const std::vector<uint8_t>& value) {
+    std::lock_guard lock(mCommandMutex);
     using Error = V2_4::Error;
     if (!mClient_2_4) {
         return Error::UNSUPPORTED;
     }
-    mWriter.selectDisplay(display);
-    mWriter.selectLayer(layer);
+    selectDisplay(display);
+    selectLayer(layer);
     mWriter.setLayerGenericMetadata(key, mandatory, value);
     return Error::NONE;
 }
@@ -1428,6 +1498,7 @@ V2_4::Error Composer::getLayerGenericMetadataKeys(
 
 Error Composer::getClientTargetProperty(
         Display display, IComposerClient::ClientTargetProperty* outClientTargetProperty) {
+    std::lock_guard lock(mCommandMutex);
     mReader.takeClientTargetProperty(display, outClientTargetProperty);
     return Error::NONE;
 }
@@ -18,7 +18,9 @@
 #define ANDROID_SF_COMPOSER_HAL_H
 
 #include <memory>
+#include <mutex>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -494,8 +496,99 @@ public:
             IComposerClient::ClientTargetProperty* outClientTargetProperty) override;
 
 private:
+    // Compile-time sized encoding of fixed-shape commands.  The payload
+    // length of a command is folded from its argument types at compile time
+    // and the whole command is emitted from one variadic call, instead of
+    // the opcode/length bookkeeping being spelled out per call site.
+    // Commands with variable payloads (regions, metadata blobs) keep using
+    // the runtime helpers from CommandWriterBase.
+    class TypedCommandWriterBase : public CommandWriterBase {
+    public:
+        explicit TypedCommandWriterBase(uint32_t initialMaxSize)
+              : CommandWriterBase(initialMaxSize) {}
+
+        // Tags for payload words that travel out-of-band of the raw word
+        // stream (the handle and fence tables of the FMQ protocol).  Each
+        // occupies a single index word in the payload.
+        struct BufferHandle {
+            const native_handle_t* handle;
+        };
+        struct FenceFd {
+            int fd;
+        };
+
+        template <typename T>
+        static constexpr uint16_t wordCount() {
+            if constexpr (std::is_same_v<T, BufferHandle> || std::is_same_v<T, FenceFd>) {
+                return 1;
+            } else {
+                static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>,
+                              "unsupported command payload type");
+                static_assert(sizeof(T) == 4 || sizeof(T) == 8,
+                              "unsupported command payload size");
+                return sizeof(T) / sizeof(uint32_t);
+            }
+        }
+
+        // Emits one complete fixed-shape command; the length handed to
+        // beginCommand is a compile-time constant.
+        template <V2_1::IComposerClient::Command command, typename... Args>
+        void writeFixedCommand(Args... args) {
+            constexpr uint16_t length = (uint16_t(0) + ... + wordCount<Args>());
+            beginCommand(command, length);
+            (writeWord(args), ...);
+            endCommand();
+        }
+
+        // Compile-time batched select+set pairs for the per-layer hot path:
+        // when the selected layer changes, the selection and the state write
+        // are emitted back to back from a single call.
+        void selectLayerAndSetBuffer(Layer layer, uint32_t slot, const native_handle_t* buffer,
+                                     int acquireFence) {
+            writeFixedCommand<V2_1::IComposerClient::Command::SELECT_LAYER>(layer);
+            setLayerBuffer(slot, buffer, acquireFence);
+        }
+        void selectLayerAndSetDataspace(Layer layer, Dataspace dataspace) {
+            writeFixedCommand<V2_1::IComposerClient::Command::SELECT_LAYER>(layer);
+            setLayerDataspace(dataspace);
+        }
+
+        // Fixed-shape commands routed through the compile-time encoder.
+        // These shadow the runtime-encoded versions in CommandWriterBase.
+        void selectDisplay(Display display) {
+            writeFixedCommand<V2_1::IComposerClient::Command::SELECT_DISPLAY>(display);
+        }
+        void selectLayer(Layer layer) {
+            writeFixedCommand<V2_1::IComposerClient::Command::SELECT_LAYER>(layer);
+        }
+        void setLayerBuffer(uint32_t slot, const native_handle_t* buffer, int acquireFence) {
+            writeFixedCommand<V2_1::IComposerClient::Command::SET_LAYER_BUFFER>(
+                    slot, BufferHandle{buffer}, FenceFd{acquireFence});
+        }
+        void setLayerDataspace(Dataspace dataspace) {
+            writeFixedCommand<V2_1::IComposerClient::Command::SET_LAYER_DATASPACE>(dataspace);
+        }
+        void validateDisplay() {
+            writeFixedCommand<V2_1::IComposerClient::Command::VALIDATE_DISPLAY>();
+        }
+        void presentDisplay() {
+            writeFixedCommand<V2_1::IComposerClient::Command::PRESENT_DISPLAY>();
+        }
+
+    private:
+        void writeWord(BufferHandle buffer) { writeHandle(buffer.handle, true); }
+        void writeWord(FenceFd fence) { writeFence(fence.fd); }
+        void writeWord(float value) { writeFloat(value); }
+        void writeWord(uint64_t value) { write64(value); }
+        template <typename T>
+        void writeWord(T value) {
+            static_assert(sizeof(T) == 4, "unsupported command payload type");
+            write(static_cast<uint32_t>(value));
+        }
+    };
+
 #if defined(USE_VR_COMPOSER) && USE_VR_COMPOSER
-    class CommandWriter : public CommandWriterBase {
+    class CommandWriter : public TypedCommandWriterBase {
     public:
         explicit CommandWriter(uint32_t initialMaxSize);
         ~CommandWriter() override;
@@ -513,9 +606,9 @@ private:
                 const IVrComposerClient::BufferMetadata& metadata);
     };
 #else
-    class CommandWriter : public CommandWriterBase {
+    class CommandWriter : public TypedCommandWriterBase {
     public:
-        explicit CommandWriter(uint32_t initialMaxSize) : CommandWriterBase(initialMaxSize) {}
+        explicit CommandWriter(uint32_t initialMaxSize) : TypedCommandWriterBase(initialMaxSize) {}
         ~CommandWriter() override {}
 
         void setDisplayElapseTime(uint64_t time);
@@ -525,9 +618,23 @@ private:
 
     // Many public functions above simply write a command into the command
     // queue to batch the calls.  validateDisplay and presentDisplay will call
-    // this function to execute the command queue.
+    // this function to execute the command queue.  Must be called with
+    // mCommandMutex held.
     Error execute();
 
+    // Helpers for writing into the command queue.  They keep track of the
+    // display and layer currently selected in the buffer so that runs of
+    // consecutive writes to the same target emit a single
+    // SELECT_DISPLAY/SELECT_LAYER command.  Must be called with mCommandMutex
+    // held.
+    void resetWriter();
+    void selectDisplay(Display display);
+    void selectLayer(Layer layer);
+    // Updates the layer selection cache without emitting the SELECT_LAYER
+    // command, returning true when one is still needed.  Used by callers
+    // that emit the selection through a fused select+set writer call.
+    bool updateLayerSelection(Layer layer);
+
     sp<V2_1::IComposer> mComposer;
 
     sp<V2_1::IComposerClient> mClient;
@@ -538,9 +645,21 @@ private:
     // 64KiB minus a small space for metadata such as read/write pointers
     static constexpr size_t kWriterInitialSize =
         64 * 1024 / sizeof(uint32_t) - 16;
+    // Serializes access to the command writer/reader pair below, so displays
+    // may be composed and presented from more than one thread.  The HAL round
+    // trips themselves still execute one at a time over the shared queue.
+    std::mutex mCommandMutex;
     CommandWriter mWriter;
     CommandReader mReader;
 
+    // The selection currently in effect in mWriter, mirroring the state the
+    // HAL will reconstruct when it parses the buffer.  Cleared along with the
+    // writer.
+    bool mSelectedDisplayValid = false;
+    Display mSelectedDisplay = 0;
+    bool mSelectedLayerValid = false;
+    Layer mSelectedLayer = 0;
+
     // When true, the we attach to the vr_hwcomposer service instead of the
     // hwcomposer. This allows us to redirect surfaces to 3d surfaces in vr.
     const bool mIsUsingVrComposer;
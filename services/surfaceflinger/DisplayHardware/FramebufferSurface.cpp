@@ -81,8 +81,12 @@ FramebufferSurface::FramebufferSurface(HWComposer& hwc, DisplayId displayId,
     ui::Size limitedSize =
             limitFramebufferSize(activeConfig->getWidth(), activeConfig->getHeight());
     mConsumer->setDefaultBufferSize(limitedSize.width, limitedSize.height);
+    // The acquired count controls the overall depth of the client target
+    // pipeline. With a depth of three, RenderSurface can dequeue a buffer
+    // whose release fence signaled a frame ago instead of waiting for the
+    // display to release the client target currently on screen.
     mConsumer->setMaxAcquiredBufferCount(
-            SurfaceFlinger::maxFrameBufferAcquiredBuffers - 1);
+            SurfaceFlinger::clientTargetBufferDepth - 1);
 }
 
 void FramebufferSurface::resizeBuffers(uint32_t width, uint32_t height) {
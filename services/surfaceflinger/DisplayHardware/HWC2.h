@@ -20,6 +20,7 @@
 #include <gui/HdrMetadata.h>
 #include <math/mat4.h>
 #include <ui/DisplayInfo.h>
+#include <ui/FloatRect.h>
 #include <ui/HdrCapabilities.h>
 #include <ui/Region.h>
 #include <utils/Log.h>
@@ -28,6 +29,7 @@
 
 #include <functional>
 #include <future>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -454,6 +456,14 @@ private:
     android::mat4 mColorMatrix;
     uint32_t mBufferSlot;
     uint32_t mType{0};
+    hal::BlendMode mBlendMode = hal::BlendMode::INVALID;
+    std::optional<hal::Color> mColor;
+    std::optional<android::Rect> mDisplayFrame;
+    std::optional<float> mPlaneAlpha;
+    std::optional<android::FloatRect> mSourceCrop;
+    std::optional<hal::Transform> mTransform;
+    std::optional<uint32_t> mZOrder;
+    std::optional<std::pair<uint32_t, uint32_t>> mInfo;
 };
 
 } // namespace impl
@@ -29,12 +29,20 @@
 #include <compositionengine/Output.h>
 #include <compositionengine/OutputLayer.h>
 #include <compositionengine/impl/OutputLayerCompositionState.h>
+#include <cutils/properties.h>
 #include <log/log.h>
+#include <sched.h>
+#include <semaphore.h>
 #include <ui/DebugUtils.h>
 #include <ui/GraphicBuffer.h>
 #include <utils/Errors.h>
 #include <utils/Trace.h>
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+
 #include "../Layer.h" // needed only for debugging
 #include "../Promise.h"
 #include "../SurfaceFlinger.h"
@@ -78,13 +86,150 @@ using android::hardware::Return;
 using android::hardware::Void;
 using android::HWC2::ComposerCallback;
 
+// Dispatches vsync and refresh callbacks to SurfaceFlinger from a dedicated
+// thread instead of the hwbinder thread they arrive on. Those callbacks take
+// locks shared with the main thread, so dispatching them inline can block the
+// vendor HAL's callback thread for a full composition; some HALs watchdog
+// their callback delivery and abort when that happens. Events are handed off
+// through a bounded lock-free ring so the hwbinder thread never takes a lock
+// on this path. HAL timestamps are carried through untouched.
+class AsyncCallbackDispatch {
+public:
+    AsyncCallbackDispatch(ComposerCallback* callback, int32_t sequenceId)
+          : mCallback(callback), mSequenceId(sequenceId) {
+        for (size_t i = 0; i < kQueueDepth; i++) {
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        sem_init(&mEventCount, 0, 0);
+        mThread = std::thread([this] { threadMain(); });
+    }
+
+    ~AsyncCallbackDispatch() {
+        mRunning = false;
+        sem_post(&mEventCount);
+        mThread.join();
+        sem_destroy(&mEventCount);
+    }
+
+    void postVsync(hal::HWDisplayId display, int64_t timestamp,
+                   std::optional<hal::VsyncPeriodNanos> vsyncPeriod) {
+        post({EventType::Vsync, display, timestamp, vsyncPeriod});
+    }
+
+    void postRefresh(hal::HWDisplayId display) {
+        post({EventType::Refresh, display, 0, std::nullopt});
+    }
+
+private:
+    enum class EventType { Vsync, Refresh };
+
+    struct Event {
+        EventType type;
+        hal::HWDisplayId display;
+        int64_t timestamp;
+        std::optional<hal::VsyncPeriodNanos> vsyncPeriod;
+    };
+
+    // Bounded multi-producer ring (Vyukov-style, per-slot sequence numbers).
+    // Producers are hwbinder threads; the only consumer is mThread. sem_post
+    // is the sole syscall on the producer path and never blocks.
+    static constexpr size_t kQueueDepth = 64;
+    static_assert((kQueueDepth & (kQueueDepth - 1)) == 0,
+                  "kQueueDepth must be a power of two");
+
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        Event event;
+    };
+
+    void post(const Event& event) {
+        uint32_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = mSlots[pos & (kQueueDepth - 1)];
+            const uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const int32_t delta = static_cast<int32_t>(sequence - pos);
+            if (delta == 0) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1,
+                                                      std::memory_order_relaxed)) {
+                    slot.event = event;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    sem_post(&mEventCount);
+                    return;
+                }
+            } else if (delta < 0) {
+                // Queue full: the dispatch thread has been stalled for tens of
+                // frames. Dropping here keeps callback delivery bounded; vsync
+                // samples are resent every period and a lost refresh is
+                // recovered by the next invalidate.
+                ALOGE("AsyncCallbackDispatch: dropping HWC callback, queue full");
+                return;
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void threadMain() {
+        if (pthread_setname_np(pthread_self(), "HwcCallback")) {
+            ALOGW("Failed to set HWC callback dispatch thread name");
+        }
+        while (true) {
+            sem_wait(&mEventCount);
+            if (!mRunning) {
+                return;
+            }
+
+            Slot& slot = mSlots[mDequeuePos & (kQueueDepth - 1)];
+            // The semaphore counts published events, but the head slot may
+            // belong to a producer that claimed it and is an instruction away
+            // from publishing; spin out that window.
+            while (static_cast<int32_t>(slot.sequence.load(std::memory_order_acquire) -
+                                        (mDequeuePos + 1)) < 0) {
+                if (!mRunning) {
+                    return;
+                }
+                sched_yield();
+            }
+            const Event event = slot.event;
+            slot.sequence.store(mDequeuePos + kQueueDepth, std::memory_order_release);
+            mDequeuePos++;
+
+            switch (event.type) {
+                case EventType::Vsync:
+                    mCallback->onVsyncReceived(mSequenceId, event.display, event.timestamp,
+                                               event.vsyncPeriod);
+                    break;
+                case EventType::Refresh:
+                    mCallback->onRefreshReceived(mSequenceId, event.display);
+                    break;
+            }
+        }
+    }
+
+    ComposerCallback* const mCallback;
+    const int32_t mSequenceId;
+
+    std::array<Slot, kQueueDepth> mSlots;
+    std::atomic<uint32_t> mEnqueuePos{0};
+    uint32_t mDequeuePos = 0; // Only touched by mThread.
+
+    sem_t mEventCount;
+    std::atomic<bool> mRunning{true};
+    std::thread mThread;
+};
+
 class ComposerCallbackBridge : public hal::IComposerCallback {
 public:
     ComposerCallbackBridge(ComposerCallback* callback, int32_t sequenceId,
                            bool vsyncSwitchingSupported)
           : mCallback(callback),
             mSequenceId(sequenceId),
-            mVsyncSwitchingSupported(vsyncSwitchingSupported) {}
+            mVsyncSwitchingSupported(vsyncSwitchingSupported) {
+        if (property_get_bool("debug.sf.async_hwc_callbacks", false)) {
+            ALOGI("Dispatching HWC vsync/refresh callbacks asynchronously");
+            mAsyncDispatch = std::make_unique<AsyncCallbackDispatch>(callback, sequenceId);
+        }
+    }
 
     android::hardware::Return<void> onHotplug(hal::HWDisplayId display,
                                               hal::Connection conn) override {
@@ -93,13 +238,21 @@ public:
     }
 
     android::hardware::Return<void> onRefresh(hal::HWDisplayId display) override {
-        mCallback->onRefreshReceived(mSequenceId, display);
+        if (mAsyncDispatch) {
+            mAsyncDispatch->postRefresh(display);
+        } else {
+            mCallback->onRefreshReceived(mSequenceId, display);
+        }
         return android::hardware::Void();
     }
 
     android::hardware::Return<void> onVsync(hal::HWDisplayId display, int64_t timestamp) override {
         if (!mVsyncSwitchingSupported) {
-            mCallback->onVsyncReceived(mSequenceId, display, timestamp, std::nullopt);
+            if (mAsyncDispatch) {
+                mAsyncDispatch->postVsync(display, timestamp, std::nullopt);
+            } else {
+                mCallback->onVsyncReceived(mSequenceId, display, timestamp, std::nullopt);
+            }
         } else {
             ALOGW("Unexpected onVsync callback on composer >= 2.4, ignoring.");
         }
@@ -109,8 +262,13 @@ public:
     android::hardware::Return<void> onVsync_2_4(hal::HWDisplayId display, int64_t timestamp,
                                                 hal::VsyncPeriodNanos vsyncPeriodNanos) override {
         if (mVsyncSwitchingSupported) {
-            mCallback->onVsyncReceived(mSequenceId, display, timestamp,
-                                       std::make_optional(vsyncPeriodNanos));
+            if (mAsyncDispatch) {
+                mAsyncDispatch->postVsync(display, timestamp,
+                                          std::make_optional(vsyncPeriodNanos));
+            } else {
+                mCallback->onVsyncReceived(mSequenceId, display, timestamp,
+                                           std::make_optional(vsyncPeriodNanos));
+            }
         } else {
             ALOGW("Unexpected onVsync_2_4 callback on composer <= 2.3, ignoring.");
         }
@@ -133,6 +291,7 @@ private:
     ComposerCallback* mCallback;
     const int32_t mSequenceId;
     const bool mVsyncSwitchingSupported;
+    std::unique_ptr<AsyncCallbackDispatch> mAsyncDispatch;
 };
 
 } // namespace
@@ -338,11 +497,20 @@ std::vector<std::shared_ptr<const HWC2::Display::Config>> HWComposer::getConfigs
     RETURN_IF_INVALID_DISPLAY(displayId, {});
 
     const auto& displayData = mDisplayData.at(displayId);
-    auto configs = displayData.hwcDisplay->getConfigs();
     if (displayData.configMap.empty()) {
+        auto configs = displayData.hwcDisplay->getConfigs();
         for (size_t i = 0; i < configs.size(); ++i) {
             displayData.configMap[i] = configs[i];
         }
+        return configs;
+    }
+
+    // Serve repeat queries from the cached map instead of walking the HWC2
+    // display state again.
+    std::vector<std::shared_ptr<const HWC2::Display::Config>> configs;
+    configs.reserve(displayData.configMap.size());
+    for (size_t i = 0; i < displayData.configMap.size(); ++i) {
+        configs.push_back(displayData.configMap.at(i));
     }
     return configs;
 }
@@ -487,7 +655,7 @@ status_t HWComposer::setClientTarget(DisplayId displayId, uint32_t slot,
 }
 
 status_t HWComposer::getDeviceCompositionChanges(
-        DisplayId displayId, bool frameUsesClientComposition,
+        DisplayId displayId, bool frameUsesClientComposition, uint64_t compositionStateDigest,
         std::optional<android::HWComposer::DeviceRequestedChanges>* outChanges) {
     ATRACE_CALL();
 
@@ -509,6 +677,22 @@ status_t HWComposer::getDeviceCompositionChanges(
     // rendered to the client target yet, we should not attempt to skip
     // validate.
     displayData.validateWasSkipped = false;
+    displayData.validationReused = false;
+    if (frameUsesClientComposition && compositionStateDigest != 0 &&
+        compositionStateDigest == displayData.lastValidatedDigest &&
+        displayData.cachedChanges.has_value()) {
+        // The composition state is identical to the last frame the device
+        // validated, so its verdict still holds: reuse the cached changes and
+        // skip the validate round trip.  The client target is rendered and set
+        // as usual, and present runs from presentAndGetReleaseFences, which
+        // falls back to a full validate if the device disagrees.
+        ATRACE_NAME("validateReused");
+        *outChanges = displayData.cachedChanges;
+        displayData.validationReused = true;
+        return NO_ERROR;
+    }
+    displayData.lastValidatedDigest = 0;
+    displayData.cachedChanges.reset();
     if (!frameUsesClientComposition) {
         sp<Fence> outPresentFence;
         uint32_t state = UINT32_MAX;
@@ -554,9 +738,22 @@ status_t HWComposer::getDeviceCompositionChanges(
     error = hwcDisplay->acceptChanges();
     RETURN_IF_HWC_ERROR_FOR("acceptChanges", error, displayId, BAD_INDEX);
 
+    if (compositionStateDigest != 0) {
+        displayData.lastValidatedDigest = compositionStateDigest;
+        displayData.cachedChanges = **outChanges;
+    }
+
     return NO_ERROR;
 }
 
+void HWComposer::clearSkipValidateState(DisplayId displayId) {
+    RETURN_IF_INVALID_DISPLAY(displayId);
+
+    auto& displayData = mDisplayData[displayId];
+    displayData.validateWasSkipped = false;
+    displayData.validationReused = false;
+}
+
 sp<Fence> HWComposer::getPresentFence(DisplayId displayId) const {
     RETURN_IF_INVALID_DISPLAY(displayId, Fence::NO_FENCE);
     return mDisplayData.at(displayId).lastPresentFence;
@@ -591,6 +788,25 @@ status_t HWComposer::presentAndGetReleaseFences(DisplayId displayId) {
 
     displayData.lastPresentFence = Fence::NO_FENCE;
     auto error = hwcDisplay->present(&displayData.lastPresentFence);
+    if (error == hal::Error::NOT_VALIDATED && displayData.validationReused) {
+        // The cached verdict was stale after all: the device tracked a state
+        // change our digest missed.  Drop the cache, run the full validate,
+        // accept whatever the device requests (the client target for this
+        // frame is already rendered, so the composition plan cannot change
+        // anymore) and present again.
+        ALOGV("Reused validation rejected, falling back to SLOW validate/present");
+        displayData.lastValidatedDigest = 0;
+        displayData.cachedChanges.reset();
+        uint32_t numTypes = 0;
+        uint32_t numRequests = 0;
+        error = hwcDisplay->validate(&numTypes, &numRequests);
+        if (error == hal::Error::NONE || hasChangesError(error)) {
+            error = hwcDisplay->acceptChanges();
+        }
+        if (error == hal::Error::NONE) {
+            error = hwcDisplay->present(&displayData.lastPresentFence);
+        }
+    }
     RETURN_IF_HWC_ERROR_FOR("present", error, displayId, UNKNOWN_ERROR);
 
     std::unordered_map<HWC2::Layer*, sp<Fence>> releaseFences;
@@ -799,7 +1015,7 @@ status_t HWComposer::getDisplayedContentSample(DisplayId displayId, uint64_t max
     return NO_ERROR;
 }
 
-std::future<status_t> HWComposer::setDisplayBrightness(DisplayId displayId, float brightness) {
+promise::Future<status_t> HWComposer::setDisplayBrightness(DisplayId displayId, float brightness) {
     RETURN_IF_INVALID_DISPLAY(displayId, promise::yield<status_t>(BAD_INDEX));
     auto& display = mDisplayData[displayId].hwcDisplay;
 
@@ -882,6 +1098,17 @@ std::optional<hal::HWDisplayId> HWComposer::fromPhysicalDisplayId(DisplayId disp
     return {};
 }
 
+// FNV-1a over the port and the raw identification blob.
+static uint64_t hashIdentificationData(uint8_t port, const DisplayIdentificationData& data) {
+    uint64_t hash = 14695981039346656037ull;
+    const auto accumulate = [&hash](uint8_t byte) { hash = (hash ^ byte) * 1099511628211ull; };
+    accumulate(port);
+    for (const uint8_t byte : data) {
+        accumulate(byte);
+    }
+    return hash;
+}
+
 bool HWComposer::shouldIgnoreHotplugConnect(hal::HWDisplayId hwcDisplayId,
                                             bool hasDisplayIdentificationData) const {
     if (isUsingVrComposer() && mInternalHwcDisplayId) {
@@ -928,7 +1155,14 @@ std::optional<DisplayIdentificationInfo> HWComposer::onHotplugConnect(
         info = [this, hwcDisplayId, &port, &data, hasDisplayIdentificationData] {
             const bool isPrimary = !mInternalHwcDisplayId;
             if (mHasMultiDisplaySupport) {
+                const uint64_t cacheKey = hashIdentificationData(port, data);
+                if (const auto it = mIdentificationCache.find(cacheKey);
+                    it != mIdentificationCache.end() && it->second.data == data) {
+                    return it->second.info;
+                }
                 if (const auto info = parseDisplayIdentificationData(port, data)) {
+                    mIdentificationCache.insert_or_assign(cacheKey,
+                                                          CachedIdentificationInfo{data, *info});
                     return *info;
                 }
                 ALOGE("Failed to parse identification data for display %" PRIu64, hwcDisplayId);
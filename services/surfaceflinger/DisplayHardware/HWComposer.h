@@ -38,6 +38,7 @@
 #include <utils/StrongPointer.h>
 #include <utils/Timers.h>
 
+#include "../Promise.h"
 #include "DisplayIdentification.h"
 #include "HWC2.h"
 #include "Hal.h"
@@ -107,10 +108,23 @@ public:
     // false some internal optimizations are allowed to present the display
     // with fewer handshakes, but this does not work if client composition is
     // expected.
+    //
+    // compositionStateDigest is a hash of the composition-affecting state the
+    // caller is about to present. When it matches the digest of the last
+    // validated frame, the validate round trip may be skipped and the cached
+    // verdict reused; presentAndGetReleaseFences revalidates if the device
+    // disagrees. A digest of 0 disables the cache for this frame.
     virtual status_t getDeviceCompositionChanges(
-            DisplayId, bool frameUsesClientComposition,
+            DisplayId, bool frameUsesClientComposition, uint64_t compositionStateDigest,
             std::optional<DeviceRequestedChanges>* outChanges) = 0;
 
+    // Clears the per-frame skip-validate bookkeeping left behind by the
+    // previous frame's getDeviceCompositionChanges call. Must be called on
+    // frames that reuse the previous composition strategy and skip that call
+    // entirely, so that a stale skip verdict cannot suppress the present in
+    // presentAndGetReleaseFences.
+    virtual void clearSkipValidateState(DisplayId) = 0;
+
     virtual status_t setClientTarget(DisplayId displayId, uint32_t slot,
                                      const sp<Fence>& acquireFence, const sp<GraphicBuffer>& target,
                                      ui::Dataspace dataspace) = 0;
@@ -166,7 +180,8 @@ public:
                                                DisplayedFrameStats* outStats) = 0;
 
     // Sets the brightness of a display.
-    virtual std::future<status_t> setDisplayBrightness(DisplayId displayId, float brightness) = 0;
+    virtual promise::Future<status_t> setDisplayBrightness(DisplayId displayId,
+                                                           float brightness) = 0;
 
     // Events handling ---------------------------------------------------------
 
@@ -257,9 +272,11 @@ public:
     void destroyLayer(DisplayId displayId, HWC2::Layer* layer) override;
 
     status_t getDeviceCompositionChanges(
-            DisplayId, bool frameUsesClientComposition,
+            DisplayId, bool frameUsesClientComposition, uint64_t compositionStateDigest,
             std::optional<DeviceRequestedChanges>* outChanges) override;
 
+    void clearSkipValidateState(DisplayId) override;
+
     status_t setClientTarget(DisplayId displayId, uint32_t slot, const sp<Fence>& acquireFence,
                              const sp<GraphicBuffer>& target, ui::Dataspace dataspace) override;
 
@@ -309,7 +326,7 @@ public:
                                               uint8_t componentMask, uint64_t maxFrames) override;
     status_t getDisplayedContentSample(DisplayId displayId, uint64_t maxFrames, uint64_t timestamp,
                                        DisplayedFrameStats* outStats) override;
-    std::future<status_t> setDisplayBrightness(DisplayId displayId, float brightness) override;
+    promise::Future<status_t> setDisplayBrightness(DisplayId displayId, float brightness) override;
 
     // Events handling ---------------------------------------------------------
 
@@ -395,6 +412,14 @@ private:
         bool validateWasSkipped;
         hal::Error presentError;
 
+        // Verdict cache for skip-validate: the composition state digest of the
+        // last frame the device validated, and the changes it requested then.
+        // When the digest repeats, getDeviceCompositionChanges reuses the
+        // cached verdict instead of issuing another validate round trip.
+        uint64_t lastValidatedDigest = 0;
+        std::optional<DeviceRequestedChanges> cachedChanges;
+        bool validationReused = false;
+
         bool vsyncTraceToggle = false;
 
         std::mutex vsyncEnabledLock;
@@ -416,6 +441,16 @@ private:
     std::optional<hal::HWDisplayId> mExternalHwcDisplayId;
     bool mHasMultiDisplaySupport = false;
 
+    // Memoized results of parseDisplayIdentificationData(), keyed by a hash
+    // of the port and the raw identification blob, so reconnecting a known
+    // display (e.g. during a DP daisy-chain hotplug storm) does not re-parse
+    // its EDID. The raw blob is kept to reject hash collisions.
+    struct CachedIdentificationInfo {
+        DisplayIdentificationData data;
+        DisplayIdentificationInfo info;
+    };
+    std::unordered_map<uint64_t, CachedIdentificationInfo> mIdentificationCache;
+
     std::unordered_set<DisplayId> mFreeVirtualDisplayIds;
     uint32_t mNextVirtualDisplayId = 0;
     uint32_t mRemainingHwcVirtualDisplays{getMaxVirtualDisplayCount()};
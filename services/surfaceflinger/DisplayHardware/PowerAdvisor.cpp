@@ -59,6 +59,15 @@ int32_t getUpdateTimeout() {
     return timeout;
 }
 
+// Consecutive frames missed during GPU composition before the advisor asks
+// CompositionEngine to fall back to cheaper strategies.
+constexpr uint32_t kGpuMissesToReduceEffort = 2;
+
+// Clean frames before full effort is restored. Thermal headroom recovers
+// slowly, so hold the cheap strategies long enough to avoid flapping between
+// expensive and cheap frames.
+constexpr uint32_t kCleanFramesToRestoreEffort = 300;
+
 } // namespace
 
 PowerAdvisor::PowerAdvisor()
@@ -66,7 +75,9 @@ PowerAdvisor::PowerAdvisor()
         mUpdateImminentTimer(
                 OneShotTimer::Interval(getUpdateTimeout()),
                 /* resetCallback */ [this] { mSendUpdateImminent.store(false); },
-                /* timeoutCallback */ [this] { mSendUpdateImminent.store(true); }) {
+                /* timeoutCallback */ [this] { mSendUpdateImminent.store(true); }),
+        mAdaptiveEffortEnabled(
+                base::GetBoolProperty("debug.sf.adaptive_composition_effort", true)) {
     if (mUseUpdateImminentTimer) {
         mUpdateImminentTimer.start();
     }
@@ -77,6 +88,9 @@ void PowerAdvisor::onBootFinished() {
 }
 
 void PowerAdvisor::setExpensiveRenderingExpected(DisplayId displayId, bool expected) {
+    // Hold the lock for the whole update: when displays are presented in
+    // parallel this can be called from more than one thread per frame.
+    std::lock_guard lock(mPowerHalMutex);
     if (expected) {
         mExpensiveDisplays.insert(displayId);
     } else {
@@ -85,7 +99,6 @@ void PowerAdvisor::setExpensiveRenderingExpected(DisplayId displayId, bool expec
 
     const bool expectsExpensiveRendering = !mExpensiveDisplays.empty();
     if (mNotifiedExpensiveRendering != expectsExpensiveRendering) {
-        std::lock_guard lock(mPowerHalMutex);
         HalWrapper* const halWrapper = getPowerHal();
         if (halWrapper == nullptr) {
             return;
@@ -101,6 +114,33 @@ void PowerAdvisor::setExpensiveRenderingExpected(DisplayId displayId, bool expec
     }
 }
 
+void PowerAdvisor::setGpuFrameMissed(bool missed) {
+    if (!mAdaptiveEffortEnabled) {
+        return;
+    }
+
+    if (missed) {
+        mConsecutiveGpuMisses++;
+        mCleanFramesSinceReduction = 0;
+        if (!mReduceCompositionEffort && mConsecutiveGpuMisses >= kGpuMissesToReduceEffort) {
+            ALOGV("Reducing composition effort after %u consecutive GPU frame misses",
+                  mConsecutiveGpuMisses);
+            mReduceCompositionEffort = true;
+        }
+    } else {
+        mConsecutiveGpuMisses = 0;
+        if (mReduceCompositionEffort &&
+            ++mCleanFramesSinceReduction >= kCleanFramesToRestoreEffort) {
+            ALOGV("Restoring full composition effort");
+            mReduceCompositionEffort = false;
+        }
+    }
+}
+
+bool PowerAdvisor::shouldReduceCompositionEffort() {
+    return mReduceCompositionEffort;
+}
+
 void PowerAdvisor::notifyDisplayUpdateImminent() {
     // Only start sending this notification once the system has booted so we don't introduce an
     // early-boot dependency on Power HAL
@@ -33,6 +33,12 @@ public:
 
     virtual void onBootFinished() = 0;
     virtual void setExpensiveRenderingExpected(DisplayId displayId, bool expected) = 0;
+    // Feeds the advisor one frame of feedback: whether the previous frame
+    // missed its present deadline while GPU composition was in use.
+    virtual void setGpuFrameMissed(bool missed) = 0;
+    // True when recent feedback predicts that upcoming frames will also miss
+    // their deadlines, and composition should prefer cheaper strategies.
+    virtual bool shouldReduceCompositionEffort() = 0;
     virtual void notifyDisplayUpdateImminent() = 0;
     virtual bool canNotifyDisplayUpdateImminent() = 0;
 };
@@ -56,6 +62,8 @@ public:
 
     void onBootFinished() override;
     void setExpensiveRenderingExpected(DisplayId displayId, bool expected) override;
+    void setGpuFrameMissed(bool missed) override;
+    bool shouldReduceCompositionEffort() override;
     void notifyDisplayUpdateImminent() override;
     bool canNotifyDisplayUpdateImminent() override;
 
@@ -66,12 +74,19 @@ private:
 
     std::atomic_bool mBootFinished = false;
 
-    std::unordered_set<DisplayId> mExpensiveDisplays;
-    bool mNotifiedExpensiveRendering = false;
+    std::unordered_set<DisplayId> mExpensiveDisplays GUARDED_BY(mPowerHalMutex);
+    bool mNotifiedExpensiveRendering GUARDED_BY(mPowerHalMutex) = false;
 
     const bool mUseUpdateImminentTimer;
     std::atomic_bool mSendUpdateImminent = true;
     scheduler::OneShotTimer mUpdateImminentTimer;
+
+    // Composition effort feedback. Only touched from the main thread, which
+    // both reports the per-frame outcome and queries the hint each refresh.
+    const bool mAdaptiveEffortEnabled;
+    uint32_t mConsecutiveGpuMisses = 0;
+    uint32_t mCleanFramesSinceReduction = 0;
+    bool mReduceCompositionEffort = false;
 };
 
 } // namespace impl
@@ -57,6 +57,23 @@ static const char* dbgCompositionTypeStr(compositionengine::DisplaySurface::Comp
     }
 }
 
+// Returns true if the format is an RGB format that HWC would have nothing to
+// convert when copying into the output buffer for a video encoder.
+static bool isRgbFormat(int format) {
+    switch (format) {
+        case HAL_PIXEL_FORMAT_RGBA_8888:
+        case HAL_PIXEL_FORMAT_RGBX_8888:
+        case HAL_PIXEL_FORMAT_RGB_888:
+        case HAL_PIXEL_FORMAT_RGB_565:
+        case HAL_PIXEL_FORMAT_BGRA_8888:
+        case HAL_PIXEL_FORMAT_RGBA_FP16:
+        case HAL_PIXEL_FORMAT_RGBA_1010102:
+            return true;
+        default:
+            return false;
+    }
+}
+
 VirtualDisplaySurface::VirtualDisplaySurface(HWComposer& hwc,
                                              const std::optional<DisplayId>& displayId,
                                              const sp<IGraphicBufferProducer>& sink,
@@ -116,6 +133,19 @@ VirtualDisplaySurface::VirtualDisplaySurface(HWComposer& hwc,
     }
     mOutputFormat = mDefaultOutputFormat;
 
+    // The forced HWC copy exists so that RGB->YUV conversion for a video
+    // encoder happens in hardware controlled by HWC instead of in the encoder.
+    // If the sink never asked for an encoder-consumable buffer, or explicitly
+    // asked for an RGB format, there is no conversion to perform and the copy
+    // turns every GPU-composed frame into an extra full-screen blit. Negotiate
+    // it away up front so those sinks receive GPU output zero-copy.
+    if (mForceHwcCopy &&
+        (!(sinkUsage & GRALLOC_USAGE_HW_VIDEO_ENCODER) || isRgbFormat(mDefaultOutputFormat))) {
+        VDS_LOGV("Disabling forced HWC copy: sink usage %#x format %d needs no conversion",
+                 sinkUsage, mDefaultOutputFormat);
+        mForceHwcCopy = false;
+    }
+
     ConsumerBase::mName = String8::format("VDS: %s", mDisplayName.c_str());
     mConsumer->setConsumerName(ConsumerBase::mName);
     mConsumer->setConsumerUsageBits(GRALLOC_USAGE_HW_COMPOSER);
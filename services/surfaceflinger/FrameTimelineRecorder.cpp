@@ -0,0 +1,182 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+
+#include <android-base/stringprintf.h>
+
+#include "FrameTimelineRecorder.h"
+
+namespace android {
+
+void FrameTimelineRecorder::beginUpdate() {
+    // Move the sequence count to an odd value. The release fence keeps the
+    // record stores that follow from becoming visible ahead of it.
+    mUpdateSeq.store(mUpdateSeq.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void FrameTimelineRecorder::endUpdate() {
+    // Back to an even value; the release store publishes the record updates.
+    mUpdateSeq.store(mUpdateSeq.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_release);
+}
+
+uint64_t FrameTimelineRecorder::beginFrame(nsecs_t expectedPresentTime) {
+    beginUpdate();
+
+    processFences();
+
+    const size_t offset =
+            (mOffset.load(std::memory_order_relaxed) + 1) % NUM_FRAME_RECORDS;
+    mOffset.store(offset, std::memory_order_relaxed);
+
+    FrameRecord& record = mRecords[offset];
+    if (record.presentFence != nullptr) {
+        // Clobbering a frame whose fence never resolved.
+        record.presentFence = nullptr;
+        mNumPendingFences--;
+    }
+
+    const uint64_t token = mNextToken++;
+    record.token.store(token, std::memory_order_relaxed);
+    record.expectedPresentTime.store(expectedPresentTime, std::memory_order_relaxed);
+    record.invalidateTime.store(systemTime(), std::memory_order_relaxed);
+    record.latchTime.store(0, std::memory_order_relaxed);
+    record.numLayersLatched.store(0, std::memory_order_relaxed);
+    record.refreshTime.store(0, std::memory_order_relaxed);
+    record.presentQueuedTime.store(0, std::memory_order_relaxed);
+    record.presentTime.store(0, std::memory_order_relaxed);
+
+    endUpdate();
+    return token;
+}
+
+void FrameTimelineRecorder::recordLatch(size_t numLayersLatched) {
+    beginUpdate();
+    FrameRecord& record = mRecords[mOffset.load(std::memory_order_relaxed)];
+    record.latchTime.store(systemTime(), std::memory_order_relaxed);
+    record.numLayersLatched.store(static_cast<uint32_t>(numLayersLatched),
+                                  std::memory_order_relaxed);
+    endUpdate();
+}
+
+void FrameTimelineRecorder::recordRefreshStart() {
+    beginUpdate();
+    FrameRecord& record = mRecords[mOffset.load(std::memory_order_relaxed)];
+    record.refreshTime.store(systemTime(), std::memory_order_relaxed);
+    endUpdate();
+}
+
+void FrameTimelineRecorder::recordPresentQueued(
+        const std::shared_ptr<FenceTime>& presentFence) {
+    beginUpdate();
+    FrameRecord& record = mRecords[mOffset.load(std::memory_order_relaxed)];
+    record.presentQueuedTime.store(systemTime(), std::memory_order_relaxed);
+    if (presentFence != nullptr && presentFence->isValid()) {
+        record.presentFence = presentFence;
+        record.presentTime.store(INT64_MAX, std::memory_order_relaxed);
+        mNumPendingFences++;
+    }
+    endUpdate();
+}
+
+void FrameTimelineRecorder::processFences() {
+    const size_t offset = mOffset.load(std::memory_order_relaxed);
+    for (int i = 0; i < NUM_FRAME_RECORDS && mNumPendingFences > 0; i++) {
+        const size_t idx = (offset + NUM_FRAME_RECORDS - i) % NUM_FRAME_RECORDS;
+        FrameRecord& record = mRecords[idx];
+        if (record.presentFence == nullptr) {
+            continue;
+        }
+        const nsecs_t signalTime = record.presentFence->getSignalTime();
+        if (signalTime < INT64_MAX) {
+            record.presentTime.store(signalTime, std::memory_order_relaxed);
+            record.presentFence = nullptr;
+            mNumPendingFences--;
+        }
+    }
+}
+
+void FrameTimelineRecorder::dump(std::string& result) const {
+    uint64_t token[NUM_FRAME_RECORDS];
+    nsecs_t expected[NUM_FRAME_RECORDS];
+    nsecs_t invalidate[NUM_FRAME_RECORDS];
+    nsecs_t latch[NUM_FRAME_RECORDS];
+    uint32_t layers[NUM_FRAME_RECORDS];
+    nsecs_t refresh[NUM_FRAME_RECORDS];
+    nsecs_t queued[NUM_FRAME_RECORDS];
+    nsecs_t present[NUM_FRAME_RECORDS];
+    size_t offset;
+
+    // Seqlock read: retry whenever an update was in progress (odd sequence
+    // value) or completed while the records were being copied.
+    uint32_t seqBegin, seqEnd;
+    do {
+        seqBegin = mUpdateSeq.load(std::memory_order_acquire);
+        offset = mOffset.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < NUM_FRAME_RECORDS; i++) {
+            token[i] = mRecords[i].token.load(std::memory_order_relaxed);
+            expected[i] = mRecords[i].expectedPresentTime.load(std::memory_order_relaxed);
+            invalidate[i] = mRecords[i].invalidateTime.load(std::memory_order_relaxed);
+            latch[i] = mRecords[i].latchTime.load(std::memory_order_relaxed);
+            layers[i] = mRecords[i].numLayersLatched.load(std::memory_order_relaxed);
+            refresh[i] = mRecords[i].refreshTime.load(std::memory_order_relaxed);
+            queued[i] = mRecords[i].presentQueuedTime.load(std::memory_order_relaxed);
+            present[i] = mRecords[i].presentTime.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        seqEnd = mUpdateSeq.load(std::memory_order_relaxed);
+    } while ((seqBegin & 1) || seqBegin != seqEnd);
+
+    result.append("Frame timeline (most recent frame last, times relative to invalidate):\n");
+    result.append("   token    invalidate (ns)  latch (ms) layers  refresh (ms)"
+                  "  queued (ms)  present (ms)  vs expected (ms)\n");
+
+    const auto appendDelta = [&result](nsecs_t time, nsecs_t base) {
+        if (time == 0) {
+            result.append("           -");
+        } else if (time == INT64_MAX) {
+            result.append("     pending");
+        } else {
+            base::StringAppendF(&result, "%12.3f", (time - base) / 1e6);
+        }
+    };
+
+    for (size_t i = 1; i < NUM_FRAME_RECORDS; i++) {
+        const size_t index = (offset + i) % NUM_FRAME_RECORDS;
+        if (token[index] == 0) {
+            // Not yet written (ring not full).
+            continue;
+        }
+        base::StringAppendF(&result, "%8" PRIu64 " %18" PRId64, token[index],
+                            invalidate[index]);
+        appendDelta(latch[index], invalidate[index]);
+        base::StringAppendF(&result, " %6u", layers[index]);
+        appendDelta(refresh[index], invalidate[index]);
+        appendDelta(queued[index], invalidate[index]);
+        appendDelta(present[index], invalidate[index]);
+        if (present[index] != 0 && present[index] != INT64_MAX && expected[index] != 0) {
+            base::StringAppendF(&result, "      %12.3f",
+                                (present[index] - expected[index]) / 1e6);
+        }
+        result.append("\n");
+    }
+    result.append("\n");
+}
+
+} // namespace android
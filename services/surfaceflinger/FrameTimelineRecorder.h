@@ -0,0 +1,99 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <ui/FenceTime.h>
+#include <utils/Timers.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace android {
+
+// FrameTimelineRecorder keeps an always-on, in-memory timeline of the most
+// recent frames the main thread worked on. Each frame is issued a
+// monotonically increasing token when its invalidate begins, and the stages
+// that follow (latch, composition start, present queued, present fence
+// signal) are recorded against that token. A jank report can then show
+// exactly which stage of which frame blew its deadline without an external
+// tracing session.
+//
+// Records are written only from the main thread; dump() snapshots them
+// through a sequence count (a seqlock, as in FrameTracker) so a slow dumpsys
+// never blocks composition.
+class FrameTimelineRecorder {
+public:
+    enum { NUM_FRAME_RECORDS = 128 };
+
+    // beginFrame starts a new record at the top of the invalidate and
+    // returns the token issued for the frame. It also resolves the present
+    // fences of earlier frames that have signaled since the last call.
+    uint64_t beginFrame(nsecs_t expectedPresentTime);
+
+    // recordLatch notes when buffer latching finished for the current frame
+    // and how many layers had queued frames.
+    void recordLatch(size_t numLayersLatched);
+
+    // recordRefreshStart notes when composition started for the current
+    // frame.
+    void recordRefreshStart();
+
+    // recordPresentQueued notes when the frame was handed to the display,
+    // along with the fence that signals when it is actually presented.
+    void recordPresentQueued(const std::shared_ptr<FenceTime>& presentFence);
+
+    void dump(std::string& result) const;
+
+private:
+    struct FrameRecord {
+        // The times are atomic because dump() reads them without a lock;
+        // they are accessed with relaxed ordering, relying on the fences in
+        // beginUpdate/endUpdate for consistency. Zero means the stage was
+        // not reached; INT64_MAX that the present fence is still pending.
+        std::atomic<uint64_t> token{0};
+        std::atomic<nsecs_t> expectedPresentTime{0};
+        std::atomic<nsecs_t> invalidateTime{0};
+        std::atomic<nsecs_t> latchTime{0};
+        std::atomic<uint32_t> numLayersLatched{0};
+        std::atomic<nsecs_t> refreshTime{0};
+        std::atomic<nsecs_t> presentQueuedTime{0};
+        std::atomic<nsecs_t> presentTime{0};
+        // Only touched by the main thread.
+        std::shared_ptr<FenceTime> presentFence;
+    };
+
+    // beginUpdate and endUpdate bracket every mutation, moving the sequence
+    // count through an odd value so dump() can detect an in-progress or
+    // intervening update and retry.
+    void beginUpdate();
+    void endUpdate();
+
+    // processFences resolves the present fences of recent frames that have
+    // signaled. Bounded by the number of outstanding fences.
+    void processFences();
+
+    FrameRecord mRecords[NUM_FRAME_RECORDS];
+    std::atomic<size_t> mOffset{0};
+    uint64_t mNextToken = 1;
+    int mNumPendingFences = 0;
+    mutable std::atomic<uint32_t> mUpdateSeq{0};
+};
+
+} // namespace android
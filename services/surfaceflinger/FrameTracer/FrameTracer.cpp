@@ -25,9 +25,11 @@
 #include "FrameTracer.h"
 
 #include <android-base/stringprintf.h>
+#include <cutils/properties.h>
 #include <perfetto/trace/clock_snapshot.pbzero.h>
 
 #include <algorithm>
+#include <inttypes.h>
 #include <mutex>
 
 PERFETTO_DEFINE_DATA_SOURCE_STATIC_MEMBERS(android::FrameTracer::FrameTracerDataSource);
@@ -41,6 +43,9 @@ void FrameTracer::initialize() {
         args.backends = perfetto::kSystemBackend;
         perfetto::Tracing::Initialize(args);
         registerDataSource();
+        if (property_get_bool("debug.sf.frame_tracer_ring", false)) {
+            setRingBufferEnabled(true);
+        }
     });
 }
 
@@ -62,6 +67,12 @@ void FrameTracer::traceNewLayer(int32_t layerId, const std::string& layerName) {
 void FrameTracer::traceTimestamp(int32_t layerId, uint64_t bufferID, uint64_t frameNumber,
                                  nsecs_t timestamp, FrameEvent::BufferEventType type,
                                  nsecs_t duration) {
+    // The ring buffer records unconditionally; the Trace lambda below only
+    // runs while a perfetto session is active.
+    if (mRingEnabled) {
+        recordRingEvent(layerId, bufferID, frameNumber, timestamp, type, duration);
+    }
+
     FrameTracerDataSource::Trace([this, layerId, bufferID, frameNumber, timestamp, type,
                                   duration](FrameTracerDataSource::TraceContext ctx) {
         std::lock_guard<std::mutex> lock(mTraceMutex);
@@ -80,6 +91,10 @@ void FrameTracer::traceTimestamp(int32_t layerId, uint64_t bufferID, uint64_t fr
 void FrameTracer::traceFence(int32_t layerId, uint64_t bufferID, uint64_t frameNumber,
                              const std::shared_ptr<FenceTime>& fence,
                              FrameEvent::BufferEventType type, nsecs_t startTime) {
+    if (mRingEnabled) {
+        recordRingFence(layerId, bufferID, frameNumber, fence, type, startTime);
+    }
+
     FrameTracerDataSource::Trace([this, layerId, bufferID, frameNumber, &fence, type,
                                   startTime](FrameTracerDataSource::TraceContext ctx) {
         const nsecs_t signalTime = fence->getSignalTime();
@@ -174,11 +189,156 @@ void FrameTracer::onDestroy(int32_t layerId) {
     mTraceTracker.erase(layerId);
 }
 
+void FrameTracer::setRingBufferEnabled(bool enabled) {
+    for (auto& shard : mRingShards) {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        if (enabled) {
+            shard.records.resize(kRingShardCapacity);
+        } else {
+            shard.records.clear();
+            shard.records.shrink_to_fit();
+            shard.pendingFences.clear();
+        }
+        shard.head = 0;
+        shard.totalRecords = 0;
+    }
+    mRingEnabled = enabled;
+}
+
+FrameTracer::RingShard& FrameTracer::ringShardForLayer(int32_t layerId) {
+    return mRingShards[static_cast<size_t>(layerId) % kRingShardCount];
+}
+
+void FrameTracer::recordRingEvent(int32_t layerId, uint64_t bufferID, uint64_t frameNumber,
+                                  nsecs_t timestamp, FrameEvent::BufferEventType type,
+                                  nsecs_t duration) {
+    RingShard& shard = ringShardForLayer(layerId);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    if (shard.records.empty()) {
+        return;
+    }
+    resolveRingPendingFencesLocked(shard);
+    recordRingEventLocked(shard, layerId, bufferID, frameNumber, timestamp, type, duration);
+}
+
+void FrameTracer::recordRingFence(int32_t layerId, uint64_t bufferID, uint64_t frameNumber,
+                                  const std::shared_ptr<FenceTime>& fence,
+                                  FrameEvent::BufferEventType type, nsecs_t startTime) {
+    const nsecs_t signalTime = fence ? fence->getSignalTime() : Fence::SIGNAL_TIME_INVALID;
+    if (signalTime == Fence::SIGNAL_TIME_INVALID) {
+        return;
+    }
+
+    RingShard& shard = ringShardForLayer(layerId);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    if (shard.records.empty()) {
+        return;
+    }
+    resolveRingPendingFencesLocked(shard);
+
+    if (signalTime != Fence::SIGNAL_TIME_PENDING) {
+        nsecs_t timestamp = signalTime;
+        nsecs_t duration = 0;
+        if (startTime > 0 && startTime < signalTime) {
+            timestamp = startTime;
+            duration = signalTime - startTime;
+        }
+        recordRingEventLocked(shard, layerId, bufferID, frameNumber, timestamp, type, duration);
+        return;
+    }
+
+    if (shard.pendingFences.size() >= kRingMaxPendingFences) {
+        shard.pendingFences.erase(shard.pendingFences.begin());
+    }
+    shard.pendingFences.push_back({.fence = fence,
+                                   .bufferID = bufferID,
+                                   .frameNumber = frameNumber,
+                                   .layerId = layerId,
+                                   .type = type,
+                                   .startTime = startTime});
+}
+
+void FrameTracer::recordRingEventLocked(RingShard& shard, int32_t layerId, uint64_t bufferID,
+                                        uint64_t frameNumber, nsecs_t timestamp,
+                                        FrameEvent::BufferEventType type, nsecs_t duration) {
+    shard.records[shard.head] = {.timestamp = timestamp,
+                                 .duration = duration,
+                                 .bufferID = bufferID,
+                                 .frameNumber = frameNumber,
+                                 .layerId = layerId,
+                                 .type = static_cast<int32_t>(type)};
+    shard.head = (shard.head + 1) % shard.records.size();
+    ++shard.totalRecords;
+}
+
+void FrameTracer::resolveRingPendingFencesLocked(RingShard& shard) {
+    for (size_t i = 0; i < shard.pendingFences.size(); ++i) {
+        auto& pending = shard.pendingFences[i];
+
+        nsecs_t signalTime = Fence::SIGNAL_TIME_INVALID;
+        if (pending.fence && pending.fence->isValid()) {
+            signalTime = pending.fence->getSignalTime();
+            if (signalTime == Fence::SIGNAL_TIME_PENDING) {
+                continue;
+            }
+        }
+
+        if (signalTime != Fence::SIGNAL_TIME_INVALID &&
+            systemTime() - signalTime < kFenceSignallingDeadline) {
+            nsecs_t timestamp = signalTime;
+            nsecs_t duration = 0;
+            if (pending.startTime > 0 && pending.startTime < signalTime) {
+                timestamp = pending.startTime;
+                duration = signalTime - pending.startTime;
+            }
+            recordRingEventLocked(shard, pending.layerId, pending.bufferID, pending.frameNumber,
+                                  timestamp, pending.type, duration);
+        }
+
+        shard.pendingFences.erase(shard.pendingFences.begin() + i);
+        --i;
+    }
+}
+
+void FrameTracer::dumpRingBuffer(std::string& result) {
+    uint64_t total = 0;
+    size_t retained = 0;
+    for (size_t shardIndex = 0; shardIndex < kRingShardCount; ++shardIndex) {
+        RingShard& shard = mRingShards[shardIndex];
+        std::lock_guard<std::mutex> lock(shard.lock);
+        if (shard.records.empty()) {
+            continue;
+        }
+        total += shard.totalRecords;
+        const size_t count = std::min<uint64_t>(shard.totalRecords, shard.records.size());
+        retained += count;
+        // Replay the ring oldest-first: when wrapped, head is also the oldest
+        // record.
+        const size_t start = shard.totalRecords > shard.records.size() ? shard.head : 0;
+        for (size_t i = 0; i < count; ++i) {
+            const RingRecord& record = shard.records[(start + i) % shard.records.size()];
+            android::base::StringAppendF(&result,
+                                         "  layer=%d buffer=%" PRIu64 " frame=%" PRIu64
+                                         " type=%d timestamp=%" PRId64 " duration=%" PRId64 "\n",
+                                         record.layerId, record.bufferID, record.frameNumber,
+                                         record.type, record.timestamp, record.duration);
+        }
+    }
+    android::base::StringAppendF(&result,
+                                 "Ring buffer: %" PRIu64 " events recorded, %zu retained\n", total,
+                                 retained);
+}
+
 std::string FrameTracer::miniDump() {
     std::string result = "FrameTracer miniDump:\n";
-    std::lock_guard<std::mutex> lock(mTraceMutex);
-    android::base::StringAppendF(&result, "Number of layers currently being traced is %zu\n",
-                                 mTraceTracker.size());
+    {
+        std::lock_guard<std::mutex> lock(mTraceMutex);
+        android::base::StringAppendF(&result, "Number of layers currently being traced is %zu\n",
+                                     mTraceTracker.size());
+    }
+    if (mRingEnabled) {
+        dumpRingBuffer(result);
+    }
     return result;
 }
 
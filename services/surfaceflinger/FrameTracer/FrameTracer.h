@@ -20,8 +20,11 @@
 #include <perfetto/tracing.h>
 #include <ui/FenceTime.h>
 
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace android {
 
@@ -65,6 +68,12 @@ public:
 
     std::string miniDump();
 
+    // Enables or disables the always-on ring buffer mode. Normally driven by
+    // the debug.sf.frame_tracer_ring property at initialize(); public so
+    // tests can toggle it directly.
+    void setRingBufferEnabled(bool enabled);
+    bool isRingBufferEnabled() const { return mRingEnabled; }
+
     static constexpr char kFrameTracerDataSource[] = "android.surfaceflinger.frame";
 
     // The maximum amount of time a fence has to signal before it is discarded.
@@ -72,6 +81,17 @@ public:
     // Public for testing.
     static constexpr nsecs_t kFenceSignallingDeadline = 60'000'000'000; // 60 seconds
 
+    // Ring buffer mode keeps the last kRingShardCapacity frame events per
+    // shard as fixed-size binary records, with layers hashed across
+    // kRingShardCount shards so concurrent writers only contend when their
+    // layers share a shard. The records are harvested post-hoc through
+    // miniDump, so frame-lifecycle data is available from devices where no
+    // perfetto session was running when the problem happened.
+    static constexpr size_t kRingShardCount = 8;
+    static constexpr size_t kRingShardCapacity = 512;
+    // Bounds the per-shard list of fences still waiting to signal.
+    static constexpr size_t kRingMaxPendingFences = 64;
+
 private:
     struct PendingFence {
         uint64_t frameNumber;
@@ -100,9 +120,54 @@ private:
                      uint64_t frameNumber, nsecs_t timestamp, FrameEvent::BufferEventType type,
                      nsecs_t duration = 0);
 
+    // One fixed-size binary record in the ring; 40 bytes, no per-event
+    // allocation.
+    struct RingRecord {
+        nsecs_t timestamp;
+        nsecs_t duration;
+        uint64_t bufferID;
+        uint64_t frameNumber;
+        int32_t layerId;
+        int32_t type;
+    };
+
+    struct RingPendingFence {
+        std::shared_ptr<FenceTime> fence;
+        uint64_t bufferID;
+        uint64_t frameNumber;
+        int32_t layerId;
+        FrameEvent::BufferEventType type;
+        nsecs_t startTime;
+    };
+
+    struct RingShard {
+        std::mutex lock;
+        // Sized to kRingShardCapacity when the ring is enabled; head is the
+        // next write position and totalRecords tells whether it has wrapped.
+        std::vector<RingRecord> records;
+        size_t head = 0;
+        uint64_t totalRecords = 0;
+        std::vector<RingPendingFence> pendingFences;
+    };
+
+    RingShard& ringShardForLayer(int32_t layerId);
+    void recordRingEvent(int32_t layerId, uint64_t bufferID, uint64_t frameNumber,
+                         nsecs_t timestamp, FrameEvent::BufferEventType type, nsecs_t duration);
+    void recordRingFence(int32_t layerId, uint64_t bufferID, uint64_t frameNumber,
+                         const std::shared_ptr<FenceTime>& fence, FrameEvent::BufferEventType type,
+                         nsecs_t startTime);
+    void recordRingEventLocked(RingShard& shard, int32_t layerId, uint64_t bufferID,
+                               uint64_t frameNumber, nsecs_t timestamp,
+                               FrameEvent::BufferEventType type, nsecs_t duration);
+    void resolveRingPendingFencesLocked(RingShard& shard);
+    void dumpRingBuffer(std::string& result);
+
     std::mutex mTraceMutex;
     std::unordered_map<int32_t, TraceRecord> mTraceTracker;
     std::once_flag mInitializationFlag;
+
+    std::atomic<bool> mRingEnabled{false};
+    std::array<RingShard, kRingShardCount> mRingShards;
 };
 
 } // namespace android
@@ -40,33 +40,71 @@ FrameTracker::FrameTracker() :
     resetFrameCountersLocked();
 }
 
+void FrameTracker::beginUpdateLocked() const {
+    // Move the sequence count to an odd value.  The release fence keeps the
+    // record stores that follow from becoming visible ahead of it.
+    mUpdateSeq.store(mUpdateSeq.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void FrameTracker::endUpdateLocked() const {
+    // Back to an even value; the release store publishes the record updates.
+    mUpdateSeq.store(mUpdateSeq.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release);
+}
+
 void FrameTracker::setDesiredPresentTime(nsecs_t presentTime) {
     Mutex::Autolock lock(mMutex);
-    mFrameRecords[mOffset].desiredPresentTime = presentTime;
+    beginUpdateLocked();
+    mFrameRecords[mOffset].desiredPresentTime.store(presentTime,
+            std::memory_order_relaxed);
+    endUpdateLocked();
 }
 
 void FrameTracker::setFrameReadyTime(nsecs_t readyTime) {
     Mutex::Autolock lock(mMutex);
-    mFrameRecords[mOffset].frameReadyTime = readyTime;
+    beginUpdateLocked();
+    mFrameRecords[mOffset].frameReadyTime.store(readyTime,
+            std::memory_order_relaxed);
+    endUpdateLocked();
 }
 
 void FrameTracker::setFrameReadyFence(
         std::shared_ptr<FenceTime>&& readyFence) {
     Mutex::Autolock lock(mMutex);
+    beginUpdateLocked();
     mFrameRecords[mOffset].frameReadyFence = std::move(readyFence);
     mNumFences++;
+    endUpdateLocked();
 }
 
 void FrameTracker::setActualPresentTime(nsecs_t presentTime) {
     Mutex::Autolock lock(mMutex);
-    mFrameRecords[mOffset].actualPresentTime = presentTime;
+    beginUpdateLocked();
+    mFrameRecords[mOffset].actualPresentTime.store(presentTime,
+            std::memory_order_relaxed);
+    endUpdateLocked();
 }
 
 void FrameTracker::setActualPresentFence(
         std::shared_ptr<FenceTime>&& readyFence) {
     Mutex::Autolock lock(mMutex);
+    beginUpdateLocked();
     mFrameRecords[mOffset].actualPresentFence = std::move(readyFence);
     mNumFences++;
+    endUpdateLocked();
+}
+
+void FrameTracker::setGpuCompositionDoneFence(
+        std::shared_ptr<FenceTime>&& fence) {
+    Mutex::Autolock lock(mMutex);
+    beginUpdateLocked();
+    mFrameRecords[mOffset].gpuCompositionDoneFence = std::move(fence);
+    mFrameRecords[mOffset].gpuCompositionDoneTime.store(INT64_MAX,
+            std::memory_order_relaxed);
+    mNumFences++;
+    endUpdateLocked();
 }
 
 void FrameTracker::setDisplayRefreshPeriod(nsecs_t displayPeriod) {
@@ -76,47 +114,79 @@ void FrameTracker::setDisplayRefreshPeriod(nsecs_t displayPeriod) {
 
 void FrameTracker::advanceFrame() {
     Mutex::Autolock lock(mMutex);
+    beginUpdateLocked();
 
     // Update the statistic to include the frame we just finished.
     updateStatsLocked(mOffset);
 
     // Advance to the next frame.
-    mOffset = (mOffset+1) % NUM_FRAME_RECORDS;
-    mFrameRecords[mOffset].desiredPresentTime = INT64_MAX;
-    mFrameRecords[mOffset].frameReadyTime = INT64_MAX;
-    mFrameRecords[mOffset].actualPresentTime = INT64_MAX;
+    size_t offset = (mOffset.load(std::memory_order_relaxed) + 1) %
+            NUM_FRAME_RECORDS;
+    mOffset.store(offset, std::memory_order_relaxed);
+    mFrameRecords[offset].desiredPresentTime.store(INT64_MAX,
+            std::memory_order_relaxed);
+    mFrameRecords[offset].frameReadyTime.store(INT64_MAX,
+            std::memory_order_relaxed);
+    mFrameRecords[offset].actualPresentTime.store(INT64_MAX,
+            std::memory_order_relaxed);
+    // Zero means the frame did not involve GPU composition.
+    mFrameRecords[offset].gpuCompositionDoneTime.store(0,
+            std::memory_order_relaxed);
+
+    if (mFrameRecords[offset].frameReadyFence != nullptr) {
+        // We're clobbering an unsignaled fence, so we need to decrement the
+        // fence count.
+        mFrameRecords[offset].frameReadyFence = nullptr;
+        mNumFences--;
+    }
 
-    if (mFrameRecords[mOffset].frameReadyFence != nullptr) {
+    if (mFrameRecords[offset].actualPresentFence != nullptr) {
         // We're clobbering an unsignaled fence, so we need to decrement the
         // fence count.
-        mFrameRecords[mOffset].frameReadyFence = nullptr;
+        mFrameRecords[offset].actualPresentFence = nullptr;
         mNumFences--;
     }
 
-    if (mFrameRecords[mOffset].actualPresentFence != nullptr) {
+    if (mFrameRecords[offset].gpuCompositionDoneFence != nullptr) {
         // We're clobbering an unsignaled fence, so we need to decrement the
         // fence count.
-        mFrameRecords[mOffset].actualPresentFence = nullptr;
+        mFrameRecords[offset].gpuCompositionDoneFence = nullptr;
         mNumFences--;
     }
+
+    // Resolve any fences that have signaled since the last frame.  The
+    // compositor's FenceTimelines have usually cached the signal times by
+    // now, so this rarely queries the driver.  Doing it here keeps the
+    // resolution off the dump path, which reads the records without mMutex.
+    processFencesLocked();
+
+    endUpdateLocked();
 }
 
 nsecs_t FrameTracker::getPreviousGfxInfo() {
     Mutex::Autolock lock(mMutex);
     size_t previous = -1;
-    if (mOffset > 0) {
-        previous = (mOffset-1) % NUM_FRAME_RECORDS;
-    } else if (mOffset == 0) {
+    size_t offset = mOffset.load(std::memory_order_relaxed);
+    if (offset > 0) {
+        previous = (offset-1) % NUM_FRAME_RECORDS;
+    } else if (offset == 0) {
         previous = NUM_FRAME_RECORDS - 1;
     }
     if (previous >= 0) {
-        nsecs_t desiredPresentTime = mFrameRecords[previous].desiredPresentTime;
-        const std::shared_ptr<FenceTime>& rfence = mFrameRecords[previous].frameReadyFence;
-        if (rfence != nullptr) {
-            nsecs_t frameReadyTime = rfence->getSignalTime();
-            if (desiredPresentTime != INT64_MAX && frameReadyTime != INT64_MAX) {
-                return (frameReadyTime - desiredPresentTime);
-            }
+        nsecs_t desiredPresentTime =
+                mFrameRecords[previous].desiredPresentTime.load(
+                        std::memory_order_relaxed);
+        // The fence may already have been resolved into the record by
+        // advanceFrame, in which case the signal time lives in
+        // frameReadyTime.
+        const std::shared_ptr<FenceTime>& rfence =
+                mFrameRecords[previous].frameReadyFence;
+        nsecs_t frameReadyTime = rfence != nullptr
+                ? rfence->getSignalTime()
+                : mFrameRecords[previous].frameReadyTime.load(
+                        std::memory_order_relaxed);
+        if (desiredPresentTime != INT64_MAX && frameReadyTime != INT64_MAX) {
+            return (frameReadyTime - desiredPresentTime);
         }
     }
     return INT64_MAX;
@@ -124,42 +194,66 @@ nsecs_t FrameTracker::getPreviousGfxInfo() {
 
 void FrameTracker::clearStats() {
     Mutex::Autolock lock(mMutex);
+    beginUpdateLocked();
     for (size_t i = 0; i < NUM_FRAME_RECORDS; i++) {
-        mFrameRecords[i].desiredPresentTime = 0;
-        mFrameRecords[i].frameReadyTime = 0;
-        mFrameRecords[i].actualPresentTime = 0;
+        mFrameRecords[i].desiredPresentTime.store(0, std::memory_order_relaxed);
+        mFrameRecords[i].frameReadyTime.store(0, std::memory_order_relaxed);
+        mFrameRecords[i].actualPresentTime.store(0, std::memory_order_relaxed);
+        mFrameRecords[i].gpuCompositionDoneTime.store(0,
+                std::memory_order_relaxed);
         mFrameRecords[i].frameReadyFence.reset();
         mFrameRecords[i].actualPresentFence.reset();
+        mFrameRecords[i].gpuCompositionDoneFence.reset();
     }
     mNumFences = 0;
-    mFrameRecords[mOffset].desiredPresentTime = INT64_MAX;
-    mFrameRecords[mOffset].frameReadyTime = INT64_MAX;
-    mFrameRecords[mOffset].actualPresentTime = INT64_MAX;
+    size_t offset = mOffset.load(std::memory_order_relaxed);
+    mFrameRecords[offset].desiredPresentTime.store(INT64_MAX,
+            std::memory_order_relaxed);
+    mFrameRecords[offset].frameReadyTime.store(INT64_MAX,
+            std::memory_order_relaxed);
+    mFrameRecords[offset].actualPresentTime.store(INT64_MAX,
+            std::memory_order_relaxed);
+    endUpdateLocked();
 }
 
 void FrameTracker::getStats(FrameStats* outStats) const {
     Mutex::Autolock lock(mMutex);
+    beginUpdateLocked();
     processFencesLocked();
+    endUpdateLocked();
 
     outStats->refreshPeriodNano = mDisplayPeriod;
 
-    const size_t offset = mOffset;
+    const size_t offset = mOffset.load(std::memory_order_relaxed);
     for (size_t i = 1; i < NUM_FRAME_RECORDS; i++) {
         const size_t index = (offset + i) % NUM_FRAME_RECORDS;
 
         // Skip frame records with no data (if buffer not yet full).
-        if (mFrameRecords[index].desiredPresentTime == 0) {
+        if (mFrameRecords[index].desiredPresentTime.load(
+                std::memory_order_relaxed) == 0) {
             continue;
         }
 
-        nsecs_t desiredPresentTimeNano = mFrameRecords[index].desiredPresentTime;
+        nsecs_t desiredPresentTimeNano =
+                mFrameRecords[index].desiredPresentTime.load(
+                        std::memory_order_relaxed);
         outStats->desiredPresentTimesNano.push_back(desiredPresentTimeNano);
 
-        nsecs_t actualPresentTimeNano = mFrameRecords[index].actualPresentTime;
+        nsecs_t actualPresentTimeNano =
+                mFrameRecords[index].actualPresentTime.load(
+                        std::memory_order_relaxed);
         outStats->actualPresentTimesNano.push_back(actualPresentTimeNano);
 
-        nsecs_t frameReadyTimeNano = mFrameRecords[index].frameReadyTime;
+        nsecs_t frameReadyTimeNano =
+                mFrameRecords[index].frameReadyTime.load(
+                        std::memory_order_relaxed);
         outStats->frameReadyTimesNano.push_back(frameReadyTimeNano);
+
+        nsecs_t gpuCompositionDoneTimeNano =
+                mFrameRecords[index].gpuCompositionDoneTime.load(
+                        std::memory_order_relaxed);
+        outStats->gpuCompositionDoneTimesNano.push_back(
+                gpuCompositionDoneTimeNano);
     }
 }
 
@@ -173,14 +267,17 @@ void FrameTracker::processFencesLocked() const {
     FrameRecord* records = const_cast<FrameRecord*>(mFrameRecords);
     int& numFences = const_cast<int&>(mNumFences);
 
+    const size_t offset = mOffset.load(std::memory_order_relaxed);
     for (int i = 1; i < NUM_FRAME_RECORDS && numFences > 0; i++) {
-        size_t idx = (mOffset+NUM_FRAME_RECORDS-i) % NUM_FRAME_RECORDS;
+        size_t idx = (offset+NUM_FRAME_RECORDS-i) % NUM_FRAME_RECORDS;
         bool updated = false;
 
         const std::shared_ptr<FenceTime>& rfence = records[idx].frameReadyFence;
         if (rfence != nullptr) {
-            records[idx].frameReadyTime = rfence->getSignalTime();
-            if (records[idx].frameReadyTime < INT64_MAX) {
+            nsecs_t signalTime = rfence->getSignalTime();
+            records[idx].frameReadyTime.store(signalTime,
+                    std::memory_order_relaxed);
+            if (signalTime < INT64_MAX) {
                 records[idx].frameReadyFence = nullptr;
                 numFences--;
                 updated = true;
@@ -190,14 +287,30 @@ void FrameTracker::processFencesLocked() const {
         const std::shared_ptr<FenceTime>& pfence =
                 records[idx].actualPresentFence;
         if (pfence != nullptr) {
-            records[idx].actualPresentTime = pfence->getSignalTime();
-            if (records[idx].actualPresentTime < INT64_MAX) {
+            nsecs_t signalTime = pfence->getSignalTime();
+            records[idx].actualPresentTime.store(signalTime,
+                    std::memory_order_relaxed);
+            if (signalTime < INT64_MAX) {
                 records[idx].actualPresentFence = nullptr;
                 numFences--;
                 updated = true;
             }
         }
 
+        const std::shared_ptr<FenceTime>& gfence =
+                records[idx].gpuCompositionDoneFence;
+        if (gfence != nullptr) {
+            nsecs_t signalTime = gfence->getSignalTime();
+            records[idx].gpuCompositionDoneTime.store(signalTime,
+                    std::memory_order_relaxed);
+            if (signalTime < INT64_MAX) {
+                records[idx].gpuCompositionDoneFence = nullptr;
+                numFences--;
+                // The GPU completion time does not feed the duration
+                // buckets, so no stats update is needed.
+            }
+        }
+
         if (updated) {
             updateStatsLocked(idx);
         }
@@ -213,9 +326,11 @@ void FrameTracker::updateStatsLocked(size_t newFrameIdx) const {
 
         if (isFrameValidLocked(prevFrameIdx)) {
             nsecs_t newPresentTime =
-                    mFrameRecords[newFrameIdx].actualPresentTime;
+                    mFrameRecords[newFrameIdx].actualPresentTime.load(
+                            std::memory_order_relaxed);
             nsecs_t prevPresentTime =
-                    mFrameRecords[prevFrameIdx].actualPresentTime;
+                    mFrameRecords[prevFrameIdx].actualPresentTime.load(
+                            std::memory_order_relaxed);
 
             nsecs_t duration = newPresentTime - prevPresentTime;
             int numPeriods = int((duration + mDisplayPeriod/2) /
@@ -251,21 +366,46 @@ void FrameTracker::logStatsLocked(const std::string_view& name) const {
 }
 
 bool FrameTracker::isFrameValidLocked(size_t idx) const {
-    return mFrameRecords[idx].actualPresentTime > 0 &&
-            mFrameRecords[idx].actualPresentTime < INT64_MAX;
+    nsecs_t actualPresentTime =
+            mFrameRecords[idx].actualPresentTime.load(std::memory_order_relaxed);
+    return actualPresentTime > 0 && actualPresentTime < INT64_MAX;
 }
 
 void FrameTracker::dumpStats(std::string& result) const {
-    Mutex::Autolock lock(mMutex);
-    processFencesLocked();
+    nsecs_t desired[NUM_FRAME_RECORDS];
+    nsecs_t actual[NUM_FRAME_RECORDS];
+    nsecs_t ready[NUM_FRAME_RECORDS];
+    nsecs_t gpuDone[NUM_FRAME_RECORDS];
+    size_t offset;
+
+    // Seqlock read: retry whenever an update was in progress (odd sequence
+    // value) or completed while the records were being copied.  Fences are
+    // resolved by the compositor in advanceFrame, so entries still pending
+    // simply read as INT64_MAX here; they are not resolved on this path.
+    uint32_t seqBegin, seqEnd;
+    do {
+        seqBegin = mUpdateSeq.load(std::memory_order_acquire);
+        offset = mOffset.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < NUM_FRAME_RECORDS; i++) {
+            desired[i] = mFrameRecords[i].desiredPresentTime.load(
+                    std::memory_order_relaxed);
+            actual[i] = mFrameRecords[i].actualPresentTime.load(
+                    std::memory_order_relaxed);
+            ready[i] = mFrameRecords[i].frameReadyTime.load(
+                    std::memory_order_relaxed);
+            gpuDone[i] = mFrameRecords[i].gpuCompositionDoneTime.load(
+                    std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        seqEnd = mUpdateSeq.load(std::memory_order_relaxed);
+    } while ((seqBegin & 1) || seqBegin != seqEnd);
 
-    const size_t o = mOffset;
     for (size_t i = 1; i < NUM_FRAME_RECORDS; i++) {
-        const size_t index = (o+i) % NUM_FRAME_RECORDS;
-        base::StringAppendF(&result, "%" PRId64 "\t%" PRId64 "\t%" PRId64 "\n",
-                            mFrameRecords[index].desiredPresentTime,
-                            mFrameRecords[index].actualPresentTime,
-                            mFrameRecords[index].frameReadyTime);
+        const size_t index = (offset+i) % NUM_FRAME_RECORDS;
+        base::StringAppendF(&result,
+                            "%" PRId64 "\t%" PRId64 "\t%" PRId64 "\t%" PRId64 "\n",
+                            desired[index], actual[index], ready[index],
+                            gpuDone[index]);
     }
     result.append("\n");
 }
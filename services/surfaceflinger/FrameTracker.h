@@ -21,15 +21,20 @@
 #include <utils/RefBase.h>
 #include <utils/Timers.h>
 
+#include <atomic>
 #include <cstddef>
 #include <string_view>
 
 namespace android {
 
 // FrameTracker tracks information about the most recently rendered frames. It
-// uses a circular buffer of frame records, and is *NOT* thread-safe -
-// mutexing must be done at a higher level if multi-threaded access is
-// possible.
+// uses a circular buffer of frame records.
+//
+// All mutation happens under mMutex, bracketed by a sequence count so that
+// dumpStats can take a consistent snapshot of the ring without blocking the
+// compositor (a seqlock). Fence times are resolved on the mutating side in
+// advanceFrame - by then the compositor's FenceTimelines have usually cached
+// the signal times, so resolution rarely touches the driver.
 //
 // Some of the time values tracked may be set either as a specific timestamp
 // or a fence.  When a non-nullptr fence is set for a given time value, the
@@ -68,6 +73,11 @@ public:
     // at which the current frame became visible to the user.
     void setActualPresentFence(std::shared_ptr<FenceTime>&& fence);
 
+    // setGpuCompositionDoneFence sets the fence that is used to get the time
+    // at which the GPU finished compositing the current frame.  It is only
+    // set for frames that involved client (GPU) composition.
+    void setGpuCompositionDoneFence(std::shared_ptr<FenceTime>&& fence);
+
     // setDisplayRefreshPeriod sets the display refresh period in nanoseconds.
     // This is used to compute frame presentation duration statistics relative
     // to this period.
@@ -86,7 +96,11 @@ public:
     // and then resets the accumulated statistics to their initial values.
     void logAndResetStats(const std::string_view& name);
 
-    // dumpStats dump appends the current frame display time history to the result string.
+    // dumpStats dump appends the current frame display time history to the
+    // result string.  It reads the frame records through the sequence
+    // protocol rather than taking mMutex, so a slow dump never blocks the
+    // compositor; entries whose fences have not been resolved yet appear as
+    // INT64_MAX.
     void dumpStats(std::string& result) const;
 
     //get previous frame gfx info.
@@ -94,24 +108,35 @@ public:
 
 private:
     struct FrameRecord {
-        FrameRecord() :
-            desiredPresentTime(0),
-            frameReadyTime(0),
-            actualPresentTime(0) {}
-        nsecs_t desiredPresentTime;
-        nsecs_t frameReadyTime;
-        nsecs_t actualPresentTime;
+        // The times are atomic because dumpStats reads them without holding
+        // mMutex; they are accessed with relaxed ordering, relying on the
+        // fences in beginUpdateLocked/endUpdateLocked for consistency.
+        std::atomic<nsecs_t> desiredPresentTime{0};
+        std::atomic<nsecs_t> frameReadyTime{0};
+        std::atomic<nsecs_t> actualPresentTime{0};
+        std::atomic<nsecs_t> gpuCompositionDoneTime{0};
         std::shared_ptr<FenceTime> frameReadyFence;
         std::shared_ptr<FenceTime> actualPresentFence;
+        std::shared_ptr<FenceTime> gpuCompositionDoneFence;
     };
 
+    // beginUpdateLocked and endUpdateLocked bracket every mutation of the
+    // frame records, moving the sequence count through an odd value so that
+    // lock-free readers can detect an in-progress or intervening update and
+    // retry.  Writers are serialized by mMutex.  They are const for the same
+    // reason processFencesLocked is.
+    void beginUpdateLocked() const;
+    void endUpdateLocked() const;
+
     // processFences iterates over all the frame records that have a fence set
     // and replaces that fence with a timestamp if the fence has signaled.  If
     // the fence is not signaled the record's displayTime is set to INT64_MAX.
     //
     // This method is const because although it modifies the frame records it
     // does so in such a way that the information represented should not
-    // change.  This allows it to be called from the dump method.
+    // change.  This allows it to be called from the getStats method.
+    //
+    // Callers must bracket the call with beginUpdateLocked/endUpdateLocked.
     void processFencesLocked() const;
 
     // updateStatsLocked updates the running statistics that are gathered
@@ -134,7 +159,7 @@ private:
     FrameRecord mFrameRecords[NUM_FRAME_RECORDS];
 
     // mOffset is the offset into mFrameRecords of the current frame.
-    size_t mOffset;
+    std::atomic<size_t> mOffset;
 
     // mNumFences is the total number of fences set in the frame records.  It
     // is incremented each time a fence is added and decremented each time a
@@ -156,7 +181,12 @@ private:
     // this FrameTracker is gathering information.
     nsecs_t mDisplayPeriod;
 
-    // mMutex is used to protect access to all member variables.
+    // mUpdateSeq is the sequence count used by dumpStats to snapshot the
+    // frame records without taking mMutex; it is odd while an update is in
+    // progress.
+    mutable std::atomic<uint32_t> mUpdateSeq{0};
+
+    // mMutex serializes all mutation of the member variables.
     mutable Mutex mMutex;
 };
 
@@ -649,7 +649,8 @@ std::optional<compositionengine::LayerFE::LayerSettings> Layer::prepareClientCom
 
     layerSettings.alpha = alpha;
     layerSettings.sourceDataspace = getDataSpace();
-    layerSettings.backgroundBlurRadius = getBackgroundBlurRadius();
+    layerSettings.backgroundBlurRadius =
+            targetSettings.disableBackgroundBlur ? 0 : getBackgroundBlurRadius();
     return layerSettings;
 }
 
@@ -850,7 +851,9 @@ void Layer::pushPendingState() {
 
 void Layer::popPendingState(State* stateToCommit) {
     ATRACE_CALL();
-    *stateToCommit = mPendingStates[0];
+    // The popped state is consumed, so move it out rather than deep-copying
+    // the Region and blob members just to destroy the originals.
+    *stateToCommit = std::move(mPendingStates.front());
 
     mPendingStates.pop_front();
     ATRACE_INT(mTransactionName.c_str(), mPendingStates.size());
@@ -1008,7 +1011,10 @@ uint32_t Layer::doTransaction(uint32_t flags) {
     }
 
     pushPendingState();
-    State c = getCurrentState();
+    // Any state popped by applyPendingStates() fully overwrites the scratch
+    // state before it is read, so there is no need to pay for a deep copy of
+    // the current state here.
+    State c;
     if (!applyPendingStates(&c)) {
         return flags;
     }
@@ -1038,15 +1044,25 @@ uint32_t Layer::doTransaction(uint32_t flags) {
     }
 
     // Commit the transaction
-    commitTransaction(c);
-    mPendingStatesSnapshot = mPendingStates;
+    commitTransaction(std::move(c));
+
+    // Only the barrier bookkeeping from the pending states is consumed by the
+    // tracing snapshot, so capture just that instead of deep-copying every
+    // still-pending State.
+    mPendingBarrierSnapshot.clear();
+    for (const State& pending : mPendingStates) {
+        if (pending.barrierLayer_legacy != nullptr) {
+            mPendingBarrierSnapshot.push_back(
+                    {pending.barrierLayer_legacy, pending.frameNumber_legacy});
+        }
+    }
     mCurrentState.callbackHandles = {};
 
     return flags;
 }
 
-void Layer::commitTransaction(const State& stateToCommit) {
-    mDrawingState = stateToCommit;
+void Layer::commitTransaction(State&& stateToCommit) {
+    mDrawingState = std::move(stateToCommit);
 }
 
 uint32_t Layer::getTransactionFlags(uint32_t flags) {
@@ -2300,12 +2316,12 @@ void Layer::writeToProtoDrawingState(LayerProto* layerInfo, uint32_t traceFlags,
     ui::Transform transform = getTransform();
 
     if (traceFlags & SurfaceTracing::TRACE_CRITICAL) {
-        for (const auto& pendingState : mPendingStatesSnapshot) {
-            auto barrierLayer = pendingState.barrierLayer_legacy.promote();
+        for (const auto& barrier : mPendingBarrierSnapshot) {
+            auto barrierLayer = barrier.barrierLayer.promote();
             if (barrierLayer != nullptr) {
                 BarrierLayerProto* barrierLayerProto = layerInfo->add_barrier_layer();
                 barrierLayerProto->set_id(barrierLayer->sequence);
-                barrierLayerProto->set_frame_number(pendingState.frameNumber_legacy);
+                barrierLayerProto->set_frame_number(barrier.frameNumber);
             }
         }
 
@@ -871,7 +871,7 @@ protected:
     friend class RefreshRateSelectionTest;
     friend class SetFrameRateTest;
 
-    virtual void commitTransaction(const State& stateToCommit);
+    virtual void commitTransaction(State&& stateToCommit);
 
     uint32_t getEffectiveUsage(uint32_t usage) const;
 
@@ -1021,9 +1021,14 @@ protected:
 
     // These are only accessed by the main thread or the tracing thread.
     State mDrawingState;
-    // Store a copy of the pending state so that the drawing thread can access the
-    // states without a lock.
-    std::deque<State> mPendingStatesSnapshot;
+    // The tracing thread only needs the barrier bookkeeping from the pending
+    // states, so store a copy of just that rather than the full states, which
+    // would deep-copy Region and blob members every transaction.
+    struct PendingBarrierSnapshot {
+        wp<Layer> barrierLayer;
+        uint64_t frameNumber;
+    };
+    std::vector<PendingBarrierSnapshot> mPendingBarrierSnapshot;
 
     // these are protected by an external lock (mStateLock)
     State mCurrentState;
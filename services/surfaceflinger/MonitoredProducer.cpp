@@ -24,8 +24,15 @@
 
 #include "Scheduler/MessageQueue.h"
 
+#include <android-base/stringprintf.h>
+#include <cutils/properties.h>
+
+#include <algorithm>
+
 namespace android {
 
+using base::StringAppendF;
+
 MonitoredProducer::MonitoredProducer(const sp<IGraphicBufferProducer>& producer,
         const sp<SurfaceFlinger>& flinger,
         const wp<Layer>& layer) :
@@ -64,7 +71,15 @@ status_t MonitoredProducer::dequeueBuffer(int* slot, sp<Fence>* fence, uint32_t
             mFlinger->mDolphinDequeueBuffer(layer->getName().c_str());
         }
     }
-    return mProducer->dequeueBuffer(slot, fence, w, h, format, usage, outBufferAge, outTimestamps);
+    if (!latencyTracingEnabled()) {
+        return mProducer->dequeueBuffer(slot, fence, w, h, format, usage, outBufferAge,
+                                        outTimestamps);
+    }
+    const nsecs_t startNs = systemTime();
+    status_t result = mProducer->dequeueBuffer(slot, fence, w, h, format, usage, outBufferAge,
+                                               outTimestamps);
+    recordLatency(Call::Dequeue, startNs);
+    return result;
 }
 
 status_t MonitoredProducer::detachBuffer(int slot) {
@@ -89,11 +104,23 @@ status_t MonitoredProducer::queueBuffer(int slot, const QueueBufferInput& input,
             mFlinger->mDolphinQueueBuffer(layer->getName().c_str());
         }
     }
-    return mProducer->queueBuffer(slot, input, output);
+    if (!latencyTracingEnabled()) {
+        return mProducer->queueBuffer(slot, input, output);
+    }
+    const nsecs_t startNs = systemTime();
+    status_t result = mProducer->queueBuffer(slot, input, output);
+    recordLatency(Call::Queue, startNs);
+    return result;
 }
 
 status_t MonitoredProducer::cancelBuffer(int slot, const sp<Fence>& fence) {
-    return mProducer->cancelBuffer(slot, fence);
+    if (!latencyTracingEnabled()) {
+        return mProducer->cancelBuffer(slot, fence);
+    }
+    const nsecs_t startNs = systemTime();
+    status_t result = mProducer->cancelBuffer(slot, fence);
+    recordLatency(Call::Cancel, startNs);
+    return result;
 }
 
 int MonitoredProducer::query(int what, int* value) {
@@ -168,6 +195,10 @@ status_t MonitoredProducer::setAutoPrerotation(bool autoPrerotation) {
     return mProducer->setAutoPrerotation(autoPrerotation);
 }
 
+status_t MonitoredProducer::setStuffingRecovery(bool enable) {
+    return mProducer->setStuffingRecovery(enable);
+}
+
 IBinder* MonitoredProducer::onAsBinder() {
     return this;
 }
@@ -176,6 +207,39 @@ sp<Layer> MonitoredProducer::getLayer() const {
     return mLayer.promote();
 }
 
+bool MonitoredProducer::latencyTracingEnabled() {
+    static const bool enabled = property_get_bool("debug.sf.producer_latency", false);
+    return enabled;
+}
+
+void MonitoredProducer::recordLatency(Call call, nsecs_t startNs) {
+    const uint32_t index =
+            mNextLatencyRecord.fetch_add(1, std::memory_order_relaxed) % kLatencyRecordCount;
+    mLatencyRecords[index] = {startNs, systemTime() - startNs, call};
+}
+
+void MonitoredProducer::dumpLatency(std::string& result) const {
+    static const char* kCallNames[kNumCallTypes] = {"dequeue", "queue", "cancel"};
+    size_t counts[kNumCallTypes] = {};
+    nsecs_t totals[kNumCallTypes] = {};
+    nsecs_t maxima[kNumCallTypes] = {};
+
+    for (const LatencyRecord& record : mLatencyRecords) {
+        if (record.startNs == 0) continue;
+        const size_t call = static_cast<size_t>(record.call);
+        counts[call]++;
+        totals[call] += record.durationNs;
+        maxima[call] = std::max(maxima[call], record.durationNs);
+    }
+
+    StringAppendF(&result, "  %s\n", getConsumerName().string());
+    for (size_t call = 0; call < kNumCallTypes; call++) {
+        if (counts[call] == 0) continue;
+        StringAppendF(&result, "    %-8s count=%3zu avg=%6.3f ms max=%6.3f ms\n", kCallNames[call],
+                      counts[call], totals[call] / (1e6 * counts[call]), maxima[call] / 1e6);
+    }
+}
+
 // ---------------------------------------------------------------------------
 }; // namespace android
 
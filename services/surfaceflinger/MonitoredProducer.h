@@ -18,6 +18,11 @@
 #define ANDROID_MONITORED_PRODUCER_H
 
 #include <gui/IGraphicBufferProducer.h>
+#include <utils/Timers.h>
+
+#include <array>
+#include <atomic>
+#include <string>
 
 namespace android {
 
@@ -71,15 +76,46 @@ public:
     virtual status_t getUniqueId(uint64_t* outId) const override;
     virtual status_t getConsumerUsage(uint64_t* outUsage) const override;
     virtual status_t setAutoPrerotation(bool autoPrerotation) override;
+    virtual status_t setStuffingRecovery(bool enable) override;
 
     // The Layer which created this producer, and on which queued Buffer's will be displayed.
     sp<Layer> getLayer() const;
 
+    // Whether per-call latency tracing is enabled. Read once from
+    // debug.sf.producer_latency; opt-in so the timestamping cost is not paid
+    // on production devices by default.
+    static bool latencyTracingEnabled();
+
+    // Appends per-call latency statistics for this producer to result.
+    // Requires latency tracing to be enabled.
+    void dumpLatency(std::string& result) const;
+
 private:
+    enum class Call : uint8_t { Dequeue, Queue, Cancel };
+    static constexpr size_t kNumCallTypes = 3;
+
+    struct LatencyRecord {
+        nsecs_t startNs = 0;
+        nsecs_t durationNs = 0;
+        Call call = Call::Dequeue;
+    };
+
+    // Per-producer ring of the most recent call latencies, written lock-free
+    // from binder threads. The dump path reads it without synchronization;
+    // a record being overwritten mid-read only skews debug output.
+    static constexpr size_t kLatencyRecordCount = 128;
+    static_assert((kLatencyRecordCount & (kLatencyRecordCount - 1)) == 0,
+                  "kLatencyRecordCount must be a power of two");
+
+    void recordLatency(Call call, nsecs_t startNs);
+
     sp<IGraphicBufferProducer> mProducer;
     sp<SurfaceFlinger> mFlinger;
     // The Layer which created this producer, and on which queued Buffer's will be displayed.
     wp<Layer> mLayer;
+
+    std::array<LatencyRecord, kLatencyRecordCount> mLatencyRecords;
+    std::atomic<uint32_t> mNextLatencyRecord{0};
 };
 
 }; // namespace android
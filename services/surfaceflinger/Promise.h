@@ -19,8 +19,13 @@
 #include <future>
 #include <type_traits>
 #include <utility>
+#include <variant>
 
 namespace android::promise {
+
+template <typename T>
+class Future;
+
 namespace impl {
 
 template <typename T>
@@ -33,6 +38,11 @@ struct FutureResult<std::future<T>> {
     using Type = T;
 };
 
+template <typename T>
+struct FutureResult<Future<T>> {
+    using Type = T;
+};
+
 } // namespace impl
 
 template <typename T>
@@ -43,37 +53,63 @@ inline auto defer(Args... args) {
     return std::async(std::launch::deferred, std::forward<Args>(args)...);
 }
 
+// A Future<T> holds either a value that has already been resolved, or a
+// std::future<T> for a result that has not. Continuations attached to a
+// resolved value run inline at the point of the then() call, so chains built
+// from values - the common case for work that completes on the calling
+// thread - allocate no shared state and never touch the futex-backed
+// std::future machinery. Only links wrapping an actual std::future fall back
+// to deferred composition.
 template <typename T>
-inline std::future<T> yield(T&& v) {
-    return defer([](T&& v) { return std::forward<T>(v); }, std::forward<T>(v));
-}
-
-template <typename T>
-struct Chain {
-    Chain(std::future<T>&& f) : future(std::move(f)) {}
-    operator std::future<T>&&() && { return std::move(future); }
+class Future {
+public:
+    Future(const T& value) : mState(std::in_place_index<0>, value) {}
+    Future(T&& value) : mState(std::in_place_index<0>, std::move(value)) {}
+    Future(std::future<T>&& future) : mState(std::in_place_index<1>, std::move(future)) {}
 
-    T get() && { return future.get(); }
+    T get() && {
+        if (mState.index() == 0) {
+            return std::move(std::get<0>(mState));
+        }
+        return std::get<1>(mState).get();
+    }
 
     template <typename F, typename R = std::invoke_result_t<F, T>>
-    auto then(F&& op) && -> Chain<FutureResult<R>> {
+    auto then(F&& op) && -> Future<FutureResult<R>> {
+        if (mState.index() == 0) {
+            R r = op(std::move(std::get<0>(mState)));
+            if constexpr (std::is_same_v<R, FutureResult<R>>) {
+                return r;
+            } else {
+                // The continuation produced another future(-like) result;
+                // forward it rather than resolving it here.
+                return std::move(r);
+            }
+        }
         return defer(
                 [](auto&& f, F&& op) {
                     R r = op(f.get());
                     if constexpr (std::is_same_v<R, FutureResult<R>>) {
                         return r;
                     } else {
-                        return r.get();
+                        return std::move(r).get();
                     }
                 },
-                std::move(future), std::forward<F>(op));
+                std::move(std::get<1>(mState)), std::forward<F>(op));
     }
 
-    std::future<T> future;
+private:
+    std::variant<T, std::future<T>> mState;
 };
 
+// yield produces an already-resolved Future, without allocating shared state.
+template <typename T>
+inline Future<T> yield(T&& v) {
+    return Future<T>(std::forward<T>(v));
+}
+
 template <typename T>
-inline Chain<T> chain(std::future<T>&& f) {
+inline Future<T> chain(std::future<T>&& f) {
     return std::move(f);
 }
 
@@ -32,22 +32,19 @@ namespace android {
 void RefreshRateOverlay::SevenSegmentDrawer::drawRect(const Rect& r, const half4& color,
                                                       const sp<GraphicBuffer>& buffer,
                                                       uint8_t* pixels) {
-    for (int32_t j = r.top; j < r.bottom; j++) {
-        if (j >= buffer->getHeight()) {
-            break;
-        }
-
-        for (int32_t i = r.left; i < r.right; i++) {
-            if (i >= buffer->getWidth()) {
-                break;
-            }
-
-            uint8_t* iter = pixels + 4 * (i + (buffer->getStride() * j));
-            iter[0] = uint8_t(color.r * 255);
-            iter[1] = uint8_t(color.g * 255);
-            iter[2] = uint8_t(color.b * 255);
-            iter[3] = uint8_t(color.a * 255);
-        }
+    // Quantize the color once and fill whole rows, rather than converting
+    // from half floats for every pixel.
+    uint32_t pixel = 0;
+    reinterpret_cast<uint8_t*>(&pixel)[0] = uint8_t(color.r * 255);
+    reinterpret_cast<uint8_t*>(&pixel)[1] = uint8_t(color.g * 255);
+    reinterpret_cast<uint8_t*>(&pixel)[2] = uint8_t(color.b * 255);
+    reinterpret_cast<uint8_t*>(&pixel)[3] = uint8_t(color.a * 255);
+
+    const int32_t right = std::min(r.right, int32_t(buffer->getWidth()));
+    const int32_t bottom = std::min(r.bottom, int32_t(buffer->getHeight()));
+    for (int32_t j = r.top; j < bottom; j++) {
+        uint32_t* row = reinterpret_cast<uint32_t*>(pixels) + buffer->getStride() * j;
+        std::fill(row + r.left, row + right, pixel);
     }
 }
 
@@ -209,8 +206,20 @@ void RefreshRateOverlay::setViewport(ui::Size viewport) {
 }
 
 void RefreshRateOverlay::changeRefreshRate(const RefreshRate& refreshRate) {
-    auto buffer = mBufferCache[refreshRate.getFps()];
-    mLayer->setBuffer(buffer, Fence::NO_FENCE, 0, 0, {});
+    const int fps = refreshRate.getFps();
+    if (fps == mCurrentFps) {
+        return;
+    }
+
+    auto it = mBufferCache.find(fps);
+    if (it == mBufferCache.end()) {
+        // All supported rates are pre-rasterized in primeCache(), so a miss
+        // means the configs changed under us; rasterize on demand.
+        it = mBufferCache.emplace(fps, SevenSegmentDrawer::drawNumber(fps, {LOW_FPS_COLOR, ALPHA}))
+                     .first;
+    }
+    mLayer->setBuffer(it->second, Fence::NO_FENCE, 0, 0, {});
+    mCurrentFps = fps;
 
     mFlinger.mTransactionFlags.fetch_or(eTransactionMask);
 }
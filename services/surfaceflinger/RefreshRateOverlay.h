@@ -77,7 +77,11 @@ private:
     sp<IBinder> mIBinder;
     sp<IGraphicBufferProducer> mGbp;
 
+    // Pre-rasterized digit buffers, keyed by fps. The buffers are uploaded
+    // once and stay resident on the GPU; a refresh rate change only swaps
+    // which cached buffer the layer points at.
     std::unordered_map<int, sp<GraphicBuffer>> mBufferCache;
+    int mCurrentFps = -1;
 
     static constexpr float ALPHA = 0.8f;
     const half3 LOW_FPS_COLOR = half3(1.0f, 0.0f, 0.0f);
@@ -62,6 +62,13 @@ constexpr auto maxRegionSamplingSkips = 10;
 constexpr auto defaultRegionSamplingOffset = -3ms;
 constexpr auto defaultRegionSamplingPeriod = 100ms;
 constexpr auto defaultRegionSamplingTimerTimeout = 100ms;
+// Scaling the capture down on the GPU before reading it back shrinks both the
+// readback and the per-pixel luma loop by the square of the factor, while the
+// bilinear filtering preserves the mean since luma is linear in RGB.
+constexpr uint32_t defaultRegionSamplingDownscale = 8;
+// Keep enough downscaled pixels in each dimension that small sampling regions
+// still cover a meaningful number of samples.
+constexpr uint32_t minSampledDimension = 16;
 // TODO: (b/127403193) duration to string conversion could probably be constexpr
 template <typename Rep, typename Per>
 inline std::string toNsString(std::chrono::duration<Rep, Per> t) {
@@ -95,6 +102,24 @@ RegionSamplingThread::EnvironmentTimingTunables::EnvironmentTimingTunables() {
     }
 }
 
+uint32_t samplingDownscale() {
+    char value[PROPERTY_VALUE_MAX] = {};
+    property_get("debug.sf.region_sampling_downscale", value,
+                 std::to_string(defaultRegionSamplingDownscale).c_str());
+    const int raw = atoi(value);
+    if (raw < 1) {
+        ALOGW("User-specified sampling downscale nonsensical. Using default");
+        return defaultRegionSamplingDownscale;
+    }
+    // Round down to a power of two so sampling regions map onto the scaled
+    // buffer exactly.
+    uint32_t downscale = 1;
+    while (downscale * 2 <= static_cast<uint32_t>(raw) && downscale < 32) {
+        downscale *= 2;
+    }
+    return downscale;
+}
+
 struct SamplingOffsetCallback : DispSync::Callback {
     SamplingOffsetCallback(RegionSamplingThread& samplingThread, Scheduler& scheduler,
                            std::chrono::nanoseconds targetSamplingOffset)
@@ -168,6 +193,7 @@ RegionSamplingThread::RegionSamplingThread(SurfaceFlinger& flinger, Scheduler& s
       : mFlinger(flinger),
         mScheduler(scheduler),
         mTunables(tunables),
+        mSamplingDownscale(samplingDownscale()),
         mIdleTimer(std::chrono::duration_cast<std::chrono::milliseconds>(
                            mTunables.mSamplingTimerTimeout),
                    [] {}, [this] { checkForStaleLuma(); }),
@@ -307,9 +333,30 @@ float sampleArea(const uint32_t* data, int32_t width, int32_t height, int32_t st
     return accumulatedLuma / (255.0f * pixelCount);
 }
 
+// Maps a sampling region expressed in screen coordinates onto a buffer that
+// was captured at 1/downscale resolution, keeping at least one pixel so thin
+// regions still produce a sample.
+static Rect scaleRect(const Rect& area, uint32_t downscale) {
+    if (downscale == 1) {
+        return area;
+    }
+    Rect scaled(area.left / static_cast<int32_t>(downscale),
+                area.top / static_cast<int32_t>(downscale),
+                area.right / static_cast<int32_t>(downscale),
+                area.bottom / static_cast<int32_t>(downscale));
+    if (scaled.right <= scaled.left) {
+        scaled.right = scaled.left + 1;
+    }
+    if (scaled.bottom <= scaled.top) {
+        scaled.bottom = scaled.top + 1;
+    }
+    return scaled;
+}
+
 std::vector<float> RegionSamplingThread::sampleBuffer(
         const sp<GraphicBuffer>& buffer, const Point& leftTop,
-        const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation) {
+        const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation,
+        uint32_t downscale) {
     void* data_raw = nullptr;
     buffer->lock(GRALLOC_USAGE_SW_READ_OFTEN, &data_raw);
     std::shared_ptr<uint32_t> data(reinterpret_cast<uint32_t*>(data_raw),
@@ -323,7 +370,7 @@ std::vector<float> RegionSamplingThread::sampleBuffer(
     std::transform(descriptors.begin(), descriptors.end(), lumas.begin(),
                    [&](auto const& descriptor) {
                        return sampleArea(data.get(), width, height, stride, orientation,
-                                         descriptor.area - leftTop);
+                                         scaleRect(descriptor.area - leftTop, downscale));
                    });
     return lumas;
 }
@@ -368,8 +415,21 @@ void RegionSamplingThread::captureSample() {
     ui::Transform t(orientation);
     auto screencapRegion = t.transform(sampleRegion);
     screencapRegion = screencapRegion.translate(dx, dy);
-    DisplayRenderArea renderArea(device, screencapRegion.bounds(), sampledArea.getWidth(),
-                                 sampledArea.getHeight(), ui::Dataspace::V0_SRGB, orientation);
+
+    // Capture at reduced resolution when possible: the GPU does the averaging
+    // while scaling the render down, so the readback and the luma loop only
+    // touch 1/(downscale^2) of the pixels.
+    uint32_t downscale = mSamplingDownscale;
+    while (downscale > 1 &&
+           (sampledArea.getWidth() / downscale < minSampledDimension ||
+            sampledArea.getHeight() / downscale < minSampledDimension)) {
+        downscale /= 2;
+    }
+    const uint32_t sampleWidth = sampledArea.getWidth() / downscale;
+    const uint32_t sampleHeight = sampledArea.getHeight() / downscale;
+
+    DisplayRenderArea renderArea(device, screencapRegion.bounds(), sampleWidth, sampleHeight,
+                                 ui::Dataspace::V0_SRGB, orientation);
 
     std::unordered_set<sp<IRegionSamplingListener>, SpHash<IRegionSamplingListener>> listeners;
 
@@ -415,13 +475,13 @@ void RegionSamplingThread::captureSample() {
     };
 
     sp<GraphicBuffer> buffer = nullptr;
-    if (mCachedBuffer && mCachedBuffer->getWidth() == sampledArea.getWidth() &&
-        mCachedBuffer->getHeight() == sampledArea.getHeight()) {
+    if (mCachedBuffer && mCachedBuffer->getWidth() == sampleWidth &&
+        mCachedBuffer->getHeight() == sampleHeight) {
         buffer = mCachedBuffer;
     } else {
         const uint32_t usage = GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_HW_RENDER;
-        buffer = new GraphicBuffer(sampledArea.getWidth(), sampledArea.getHeight(),
-                                   PIXEL_FORMAT_RGBA_8888, 1, usage, "RegionSamplingThread");
+        buffer = new GraphicBuffer(sampleWidth, sampleHeight, PIXEL_FORMAT_RGBA_8888, 1, usage,
+                                   "RegionSamplingThread");
     }
 
     bool ignored;
@@ -436,8 +496,8 @@ void RegionSamplingThread::captureSample() {
     }
 
     ALOGV("Sampling %zu descriptors", activeDescriptors.size());
-    std::vector<float> lumas =
-            sampleBuffer(buffer, sampledArea.leftTop(), activeDescriptors, orientation);
+    std::vector<float> lumas = sampleBuffer(buffer, sampledArea.leftTop(), activeDescriptors,
+                                            orientation, downscale);
     if (lumas.size() != activeDescriptors.size()) {
         ALOGW("collected %zu median luma values for %zu descriptors", lumas.size(),
               activeDescriptors.size());
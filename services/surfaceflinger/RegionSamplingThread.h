@@ -95,7 +95,8 @@ private:
     };
     std::vector<float> sampleBuffer(
             const sp<GraphicBuffer>& buffer, const Point& leftTop,
-            const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation);
+            const std::vector<RegionSamplingThread::Descriptor>& descriptors, uint32_t orientation,
+            uint32_t downscale);
 
     void doSample();
     void binderDied(const wp<IBinder>& who) override;
@@ -107,6 +108,11 @@ private:
     SurfaceFlinger& mFlinger;
     Scheduler& mScheduler;
     const TimingTunables mTunables;
+    // debug.sf.region_sampling_downscale
+    // Power-of-two factor by which the screen capture is scaled down on the
+    // GPU before being read back for the luma loop; 1 reads back at full
+    // resolution.
+    const uint32_t mSamplingDownscale;
     scheduler::OneShotTimer mIdleTimer;
 
     std::unique_ptr<SamplingOffsetCallback> const mPhaseCallback;
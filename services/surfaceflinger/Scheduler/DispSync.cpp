@@ -61,6 +61,17 @@ static const bool kEnableZeroPhaseTracer = false;
 // present time and the nearest software-predicted vsync.
 static const nsecs_t kErrorThreshold = 160000000000; // 400 usec squared
 
+// Number of consecutive low-error present samples after which the panel is
+// considered stable enough to tolerate a single marginal error sample before
+// turning hardware vsync back on. Hardware vsync interrupts are a measurable
+// battery cost on always-on displays, so we avoid re-enabling them for what is
+// most likely present fence jitter rather than real model drift.
+static const size_t kStableSamplesForConfidence = 16;
+
+// An error this far past kErrorThreshold means the model is broken rather than
+// jittery, so resynchronize immediately regardless of past stability.
+static const nsecs_t kBlownErrorThreshold = kErrorThreshold * 4;
+
 #undef LOG_TAG
 #define LOG_TAG "DispSyncThread"
 class DispSyncThread : public Thread {
@@ -554,7 +565,29 @@ bool DispSync::addPresentFence(const std::shared_ptr<FenceTime>& fenceTime) {
 
     updateErrorLocked();
 
-    return !mModelUpdated || mError > kErrorThreshold;
+    if (!mModelUpdated) {
+        return true;
+    }
+
+    if (mError > kErrorThreshold) {
+        // On a panel that has proven stable, a single sample just past the
+        // threshold is more likely fence jitter than real drift, so tolerate
+        // it before paying for hardware vsync again. An error far past the
+        // threshold means the model is broken and must be resynced now.
+        const bool stablePanel = mStableSamples >= kStableSamplesForConfidence;
+        mHighErrorSamples++;
+        if (mError > kBlownErrorThreshold || mHighErrorSamples > 1 || !stablePanel) {
+            mStableSamples = 0;
+            return true;
+        }
+        return false;
+    }
+
+    mHighErrorSamples = 0;
+    if (mError < kErrorThreshold / 4 && mStableSamples < kStableSamplesForConfidence) {
+        mStableSamples++;
+    }
+    return false;
 }
 
 void DispSync::beginResync() {
@@ -601,7 +634,6 @@ bool DispSync::addResyncSample(nsecs_t timestamp, std::optional<nsecs_t> /*hwcVs
     }
     // Always update the reference time with the most recent timestamp.
     mReferenceTime = timestamp;
-    mThread->updateModel(mPeriod, mPhase, mReferenceTime);
 
     if (mNumResyncSamples < MAX_RESYNC_SAMPLES) {
         mNumResyncSamples++;
@@ -611,6 +643,16 @@ bool DispSync::addResyncSample(nsecs_t timestamp, std::optional<nsecs_t> /*hwcVs
 
     updateModelLocked();
 
+    if (mNumResyncSamples < MIN_RESYNC_SAMPLES_FOR_UPDATE) {
+        // Not enough samples to recompute the model, so updateModelLocked did
+        // not push anything to the callback thread. Push the raw reference
+        // time so callbacks track the latest hardware vsync. Pushing the model
+        // once per sample, instead of unconditionally and then again after
+        // recomputation, halves the lock traffic on the callback thread
+        // during a resync burst.
+        mThread->updateModel(mPeriod, mPhase, mReferenceTime);
+    }
+
     if (mNumResyncSamplesSincePresent++ > MAX_RESYNC_SAMPLES_WITHOUT_PRESENT) {
         resetErrorLocked();
     }
@@ -785,6 +827,8 @@ void DispSync::resetErrorLocked() {
     mPresentSampleOffset = 0;
     mError = 0;
     mZeroErrSamplesCount = 0;
+    mStableSamples = 0;
+    mHighErrorSamples = 0;
     if (mTraceDetailedInfo) {
         ATRACE_INT64("DispSync:Error", mError);
     }
@@ -816,6 +860,8 @@ void DispSync::dump(std::string& result) const {
     StringAppendF(&result, "mPeriod: %" PRId64 " ns (%.3f fps)\n", mPeriod, 1000000000.0 / mPeriod);
     StringAppendF(&result, "mPhase: %" PRId64 " ns\n", mPhase);
     StringAppendF(&result, "mError: %" PRId64 " ns (sqrt=%.1f)\n", mError, sqrt(mError));
+    StringAppendF(&result, "mStableSamples: %zu (confident at %zu), mHighErrorSamples: %zu\n",
+                  mStableSamples, kStableSamplesForConfidence, mHighErrorSamples);
     StringAppendF(&result, "mNumResyncSamplesSincePresent: %d (limit %d)\n",
                   mNumResyncSamplesSincePresent, MAX_RESYNC_SAMPLES_WITHOUT_PRESENT);
     StringAppendF(&result, "mNumResyncSamples: %zd (max %d)\n", mNumResyncSamples,
@@ -873,6 +919,11 @@ nsecs_t DispSync::expectedPresentTime(nsecs_t now) {
     return mThread->computeNextRefresh(hwcLatency, now);
 }
 
+nsecs_t DispSync::getPredictionError() const {
+    Mutex::Autolock lock(mMutex);
+    return mError;
+}
+
 } // namespace impl
 
 } // namespace android
@@ -62,6 +62,12 @@ public:
     virtual void setIgnorePresentFences(bool ignore) = 0;
     virtual nsecs_t expectedPresentTime(nsecs_t now) = 0;
 
+    // Returns the squared error (in ns^2) between the modeled and the observed
+    // present times, as a confidence signal for consumers deciding how
+    // aggressively hardware vsync can be kept off. Implementations that do not
+    // track a model error report zero, i.e. full confidence.
+    virtual nsecs_t getPredictionError() const { return 0; }
+
     virtual void dump(std::string& result) const = 0;
 
 protected:
@@ -180,6 +186,10 @@ public:
     // Determine the expected present time when a buffer acquired now will be displayed.
     nsecs_t expectedPresentTime(nsecs_t now);
 
+    // Returns the current model error, i.e. the variance of the observed
+    // present times around the modeled vsync events.
+    nsecs_t getPredictionError() const override;
+
     // dump appends human-readable debug info to the result string.
     void dump(std::string& result) const override;
 
@@ -230,6 +240,16 @@ private:
     // Used to sanity check that we are able to calculate the model error.
     size_t mZeroErrSamplesCount;
 
+    // mStableSamples counts consecutive present samples whose error stayed
+    // well below kErrorThreshold. Once the panel has proven stable, a single
+    // marginal error sample is tolerated before hardware vsync is requested
+    // again.
+    size_t mStableSamples = 0;
+
+    // mHighErrorSamples counts consecutive present samples whose error
+    // exceeded kErrorThreshold, to implement the tolerance above.
+    size_t mHighErrorSamples = 0;
+
     // Whether we have updated the vsync event model since the last resync.
     bool mModelUpdated;
 
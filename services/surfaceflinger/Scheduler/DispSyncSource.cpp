@@ -129,7 +129,10 @@ void DispSyncSource::onDispSyncEvent(nsecs_t when, nsecs_t expectedVSyncTimestam
     }
 
     if (callback != nullptr) {
-        callback->onVSyncEvent(when, expectedVSyncTimestamp);
+        // The consumer must have its frame queued roughly one refresh period
+        // before the expected present time for SurfaceFlinger to latch it.
+        const nsecs_t deadlineTimestamp = expectedVSyncTimestamp - mDispSync->getPeriod();
+        callback->onVSyncEvent(when, expectedVSyncTimestamp, deadlineTimestamp);
     }
 }
 
@@ -80,9 +80,11 @@ std::string toString(const DisplayEventReceiver::Event& event) {
                                 event.hotplug.connected ? "connected" : "disconnected");
         case DisplayEventReceiver::DISPLAY_EVENT_VSYNC:
             return StringPrintf("VSync{displayId=%" ANDROID_PHYSICAL_DISPLAY_ID_FORMAT
-                                ", count=%u, expectedVSyncTimestamp=%" PRId64 "}",
+                                ", count=%u, expectedVSyncTimestamp=%" PRId64
+                                ", deadlineTimestamp=%" PRId64 "}",
                                 event.header.displayId, event.vsync.count,
-                                event.vsync.expectedVSyncTimestamp);
+                                event.vsync.expectedVSyncTimestamp,
+                                event.vsync.deadlineTimestamp);
         case DisplayEventReceiver::DISPLAY_EVENT_CONFIG_CHANGED:
             return StringPrintf("ConfigChanged{displayId=%" ANDROID_PHYSICAL_DISPLAY_ID_FORMAT
                                 ", configId=%u}",
@@ -101,11 +103,13 @@ DisplayEventReceiver::Event makeHotplug(PhysicalDisplayId displayId, nsecs_t tim
 }
 
 DisplayEventReceiver::Event makeVSync(PhysicalDisplayId displayId, nsecs_t timestamp,
-                                      uint32_t count, nsecs_t expectedVSyncTimestamp) {
+                                      uint32_t count, nsecs_t expectedVSyncTimestamp,
+                                      nsecs_t deadlineTimestamp) {
     DisplayEventReceiver::Event event;
     event.header = {DisplayEventReceiver::DISPLAY_EVENT_VSYNC, displayId, timestamp};
     event.vsync.count = count;
     event.vsync.expectedVSyncTimestamp = expectedVSyncTimestamp;
+    event.vsync.deadlineTimestamp = deadlineTimestamp;
     return event;
 }
 
@@ -159,6 +163,11 @@ status_t EventThreadConnection::postEvent(const DisplayEventReceiver::Event& eve
     return size < 0 ? status_t(size) : status_t(NO_ERROR);
 }
 
+status_t EventThreadConnection::postEvents(const std::vector<DisplayEventReceiver::Event>& events) {
+    ssize_t size = DisplayEventReceiver::sendEvents(&mChannel, events.data(), events.size());
+    return size < 0 ? status_t(size) : status_t(NO_ERROR);
+}
+
 // ---------------------------------------------------------------------------
 
 EventThread::~EventThread() = default;
@@ -247,6 +256,21 @@ void EventThread::removeDisplayEventConnectionLocked(const wp<EventThreadConnect
     if (it != mDisplayEventConnections.cend()) {
         mDisplayEventConnections.erase(it);
     }
+    removeVsyncEventConnectionLocked(connection);
+}
+
+void EventThread::addVsyncEventConnectionLocked(const wp<EventThreadConnection>& connection) {
+    auto it = std::find(mVsyncEventConnections.cbegin(), mVsyncEventConnections.cend(), connection);
+    if (it == mVsyncEventConnections.cend()) {
+        mVsyncEventConnections.push_back(connection);
+    }
+}
+
+void EventThread::removeVsyncEventConnectionLocked(const wp<EventThreadConnection>& connection) {
+    auto it = std::find(mVsyncEventConnections.cbegin(), mVsyncEventConnections.cend(), connection);
+    if (it != mVsyncEventConnections.cend()) {
+        mVsyncEventConnections.erase(it);
+    }
 }
 
 void EventThread::setVsyncRate(uint32_t rate, const sp<EventThreadConnection>& connection) {
@@ -258,6 +282,11 @@ void EventThread::setVsyncRate(uint32_t rate, const sp<EventThreadConnection>& c
 
     const auto request = rate == 0 ? VSyncRequest::None : static_cast<VSyncRequest>(rate);
     if (connection->vsyncRequest != request) {
+        if (request == VSyncRequest::None) {
+            removeVsyncEventConnectionLocked(connection);
+        } else if (connection->vsyncRequest == VSyncRequest::None) {
+            addVsyncEventConnectionLocked(connection);
+        }
         connection->vsyncRequest = request;
         mCondition.notify_all();
     }
@@ -272,6 +301,7 @@ void EventThread::requestNextVsync(const sp<EventThreadConnection>& connection)
 
     if (connection->vsyncRequest == VSyncRequest::None) {
         connection->vsyncRequest = VSyncRequest::Single;
+        addVsyncEventConnectionLocked(connection);
         mCondition.notify_all();
     }
 }
@@ -296,12 +326,13 @@ void EventThread::onScreenAcquired() {
     mCondition.notify_all();
 }
 
-void EventThread::onVSyncEvent(nsecs_t timestamp, nsecs_t expectedVSyncTimestamp) {
+void EventThread::onVSyncEvent(nsecs_t timestamp, nsecs_t expectedVSyncTimestamp,
+                               nsecs_t deadlineTimestamp) {
     std::lock_guard<std::mutex> lock(mMutex);
 
     LOG_FATAL_IF(!mVSyncState);
     mPendingEvents.push_back(makeVSync(mVSyncState->displayId, timestamp, ++mVSyncState->count,
-                                       expectedVSyncTimestamp));
+                                       expectedVSyncTimestamp, deadlineTimestamp));
     mCondition.notify_all();
 }
 
@@ -357,21 +388,46 @@ void EventThread::threadMain(std::unique_lock<std::mutex>& lock) {
         bool vsyncRequested = false;
 
         int aliveCount = 0;
-        // Find connections that should consume this event.
-        auto it = mDisplayEventConnections.begin();
-        while (it != mDisplayEventConnections.end()) {
-            if (const auto connection = it->promote()) {
-                vsyncRequested |= connection->vsyncRequest != VSyncRequest::None;
-
-                if (event && shouldConsumeEvent(*event, connection)) {
-                    consumers.push_back(connection);
-                    if (mDolphinCheck)
-                        aliveCount++;
+        // Find connections that should consume this event. VSYNC events only consult
+        // the ready list of connections with a pending request, so the per-frame path
+        // does not touch idle connections.
+        if (event && event->header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC) {
+            auto it = mVsyncEventConnections.begin();
+            while (it != mVsyncEventConnections.end()) {
+                if (const auto connection = it->promote()) {
+                    if (shouldConsumeEvent(*event, connection)) {
+                        consumers.push_back(connection);
+                        if (mDolphinCheck)
+                            aliveCount++;
+                    }
+
+                    if (connection->vsyncRequest == VSyncRequest::None) {
+                        // A single-shot request was just consumed.
+                        it = mVsyncEventConnections.erase(it);
+                    } else {
+                        ++it;
+                    }
+                } else {
+                    it = mVsyncEventConnections.erase(it);
                 }
+            }
+            vsyncRequested = !mVsyncEventConnections.empty();
+        } else {
+            auto it = mDisplayEventConnections.begin();
+            while (it != mDisplayEventConnections.end()) {
+                if (const auto connection = it->promote()) {
+                    vsyncRequested |= connection->vsyncRequest != VSyncRequest::None;
 
-                ++it;
-            } else {
-                it = mDisplayEventConnections.erase(it);
+                    if (event && shouldConsumeEvent(*event, connection)) {
+                        consumers.push_back(connection);
+                        if (mDolphinCheck)
+                            aliveCount++;
+                    }
+
+                    ++it;
+                } else {
+                    it = mDisplayEventConnections.erase(it);
+                }
             }
         }
         if (mDolphinCheck) {
@@ -391,8 +447,21 @@ void EventThread::threadMain(std::unique_lock<std::mutex>& lock) {
         }
 
         if (!consumers.empty()) {
-            dispatchEvent(*event, consumers);
+            if (mPendingEvents.empty()) {
+                if (mEventBatches.empty()) {
+                    dispatchEvent(*event, consumers);
+                } else {
+                    batchEvent(*event, consumers);
+                    dispatchBatchedEvents();
+                }
+            } else {
+                // More events are queued for this wakeup; coalesce them so each
+                // connection gets one write per wakeup instead of one per event.
+                batchEvent(*event, consumers);
+            }
             consumers.clear();
+        } else if (!mEventBatches.empty() && mPendingEvents.empty()) {
+            dispatchBatchedEvents();
         }
 
         State nextState;
@@ -443,7 +512,8 @@ void EventThread::threadMain(std::unique_lock<std::mutex>& lock) {
                 const auto now = systemTime(SYSTEM_TIME_MONOTONIC);
                 const auto expectedVSyncTime = now + timeout.count();
                 mPendingEvents.push_back(makeVSync(mVSyncState->displayId, now,
-                                                   ++mVSyncState->count, expectedVSyncTime));
+                                                   ++mVSyncState->count, expectedVSyncTime,
+                                                   expectedVSyncTime - timeout.count()));
             }
         }
     }
@@ -503,6 +573,47 @@ void EventThread::dispatchEvent(const DisplayEventReceiver::Event& event,
     }
 }
 
+void EventThread::batchEvent(const DisplayEventReceiver::Event& event,
+                             const DisplayEventConsumers& consumers) {
+    for (const auto& consumer : consumers) {
+        auto it = std::find_if(mEventBatches.begin(), mEventBatches.end(),
+                               [&](const auto& batch) { return batch.first == consumer; });
+        if (it == mEventBatches.end()) {
+            it = mEventBatches.emplace(mEventBatches.end(), consumer,
+                                       std::vector<DisplayEventReceiver::Event>());
+        }
+        it->second.push_back(event);
+    }
+}
+
+void EventThread::dispatchBatchedEvents() {
+    const uint8_t num_attempts = 3;
+    for (auto& [consumer, events] : mEventBatches) {
+        bool needs_retry = true;
+        for (uint8_t attempt = 0; needs_retry && (attempt < num_attempts); attempt++) {
+            const status_t status = events.size() == 1 ? consumer->postEvent(events.front())
+                                                       : consumer->postEvents(events);
+            switch (status) {
+                case NO_ERROR:
+                    needs_retry = false;
+                    break;
+
+                case -EAGAIN:
+                    ALOGW("Failed dispatching batch of %zu events for %s. attempt %d",
+                          events.size(), toString(*consumer).c_str(), attempt + 1);
+                    needs_retry = true;
+                    break;
+
+                default:
+                    // Treat EPIPE and other errors as fatal.
+                    removeDisplayEventConnectionLocked(consumer);
+                    needs_retry = false;
+            }
+        }
+    }
+    mEventBatches.clear();
+}
+
 void EventThread::dump(std::string& result) const {
     std::lock_guard<std::mutex> lock(mMutex);
 
@@ -520,7 +631,8 @@ void EventThread::dump(std::string& result) const {
         StringAppendF(&result, "    %s\n", toString(event).c_str());
     }
 
-    StringAppendF(&result, "  connections (count=%zu):\n", mDisplayEventConnections.size());
+    StringAppendF(&result, "  connections (count=%zu, vsync-ready=%zu):\n",
+                  mDisplayEventConnections.size(), mVsyncEventConnections.size());
     for (const auto& ptr : mDisplayEventConnections) {
         if (const auto connection = ptr.promote()) {
             StringAppendF(&result, "    %s\n", toString(*connection).c_str());
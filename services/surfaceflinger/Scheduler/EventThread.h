@@ -57,7 +57,8 @@ public:
     class Callback {
     public:
         virtual ~Callback() {}
-        virtual void onVSyncEvent(nsecs_t when, nsecs_t expectedVSyncTimestamp) = 0;
+        virtual void onVSyncEvent(nsecs_t when, nsecs_t expectedVSyncTimestamp,
+                                  nsecs_t deadlineTimestamp) = 0;
     };
 
     virtual ~VSyncSource() {}
@@ -77,6 +78,8 @@ public:
     virtual ~EventThreadConnection();
 
     virtual status_t postEvent(const DisplayEventReceiver::Event& event);
+    // Writes a batch of coalesced events to the connection in a single send.
+    virtual status_t postEvents(const std::vector<DisplayEventReceiver::Event>& events);
 
     status_t stealReceiveChannel(gui::BitTube* outChannel) override;
     status_t setVsyncRate(uint32_t rate) override;
@@ -172,12 +175,20 @@ private:
                             const sp<EventThreadConnection>& connection) const REQUIRES(mMutex);
     void dispatchEvent(const DisplayEventReceiver::Event& event,
                        const DisplayEventConsumers& consumers) REQUIRES(mMutex);
+    void batchEvent(const DisplayEventReceiver::Event& event, const DisplayEventConsumers& consumers)
+            REQUIRES(mMutex);
+    void dispatchBatchedEvents() REQUIRES(mMutex);
 
     void removeDisplayEventConnectionLocked(const wp<EventThreadConnection>& connection)
             REQUIRES(mMutex);
+    void addVsyncEventConnectionLocked(const wp<EventThreadConnection>& connection)
+            REQUIRES(mMutex);
+    void removeVsyncEventConnectionLocked(const wp<EventThreadConnection>& connection)
+            REQUIRES(mMutex);
 
     // Implements VSyncSource::Callback
-    void onVSyncEvent(nsecs_t timestamp, nsecs_t expectedVSyncTimestamp) override;
+    void onVSyncEvent(nsecs_t timestamp, nsecs_t expectedVSyncTimestamp,
+                      nsecs_t deadlineTimestamp) override;
 
     const std::unique_ptr<VSyncSource> mVSyncSource GUARDED_BY(mMutex);
 
@@ -189,8 +200,18 @@ private:
     mutable std::condition_variable mCondition;
 
     std::vector<wp<EventThreadConnection>> mDisplayEventConnections GUARDED_BY(mMutex);
+
+    // Subset of mDisplayEventConnections with a pending vsync request, indexed so the
+    // per-frame path in threadMain only touches interested connections.
+    std::vector<wp<EventThreadConnection>> mVsyncEventConnections GUARDED_BY(mMutex);
+
     std::deque<DisplayEventReceiver::Event> mPendingEvents GUARDED_BY(mMutex);
 
+    // Per-connection coalescing buffers, used when a single wakeup drains more than
+    // one pending event so each connection gets at most one socket write per wakeup.
+    std::vector<std::pair<sp<EventThreadConnection>, std::vector<DisplayEventReceiver::Event>>>
+            mEventBatches GUARDED_BY(mMutex);
+
     // VSYNC state of connected display.
     struct VSyncState {
         explicit VSyncState(PhysicalDisplayId displayId) : displayId(displayId) {}
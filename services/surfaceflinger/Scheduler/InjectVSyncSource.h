@@ -38,7 +38,9 @@ public:
     void onInjectSyncEvent(nsecs_t when, nsecs_t expectedVSyncTimestamp) {
         std::lock_guard<std::mutex> lock(mCallbackMutex);
         if (mCallback) {
-            mCallback->onVSyncEvent(when, expectedVSyncTimestamp);
+            // Injected vsyncs carry no pipeline information, so the deadline
+            // degenerates to the expected present time.
+            mCallback->onVSyncEvent(when, expectedVSyncTimestamp, expectedVSyncTimestamp);
         }
     }
 
@@ -22,6 +22,7 @@
 
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -185,6 +186,10 @@ private:
     LayerInfos mLayerInfos GUARDED_BY(mLock);
     size_t mActiveLayersEnd GUARDED_BY(mLock) = 0;
 
+    // O(1) lookup for record(). LayerInfoV2 pointers are stable across the partition
+    // swaps in mLayerInfos, so the index only changes on registration and expiry.
+    std::unordered_map<Layer*, LayerInfoV2*> mLayerIndex GUARDED_BY(mLock);
+
     uint32_t mDisplayArea = 0;
 
     // Whether to emit systrace output and debug logs.
@@ -91,6 +91,7 @@ void LayerHistoryV2::registerLayer(Layer* layer, float /*lowRefreshRate*/, float
     const nsecs_t highRefreshRatePeriod = static_cast<nsecs_t>(1e9f / highRefreshRate);
     auto info = std::make_unique<LayerInfoV2>(layer->getName(), highRefreshRatePeriod, type);
     std::lock_guard lock(mLock);
+    mLayerIndex[layer] = info.get();
     mLayerInfos.emplace_back(layer, std::move(info));
 }
 
@@ -98,17 +99,22 @@ void LayerHistoryV2::record(Layer* layer, nsecs_t presentTime, nsecs_t now,
                             LayerUpdateType updateType) {
     std::lock_guard lock(mLock);
 
-    const auto it = std::find_if(mLayerInfos.begin(), mLayerInfos.end(),
-                                 [layer](const auto& pair) { return pair.first == layer; });
-    LOG_FATAL_IF(it == mLayerInfos.end(), "%s: unknown layer %p", __FUNCTION__, layer);
+    const auto idx = mLayerIndex.find(layer);
+    LOG_FATAL_IF(idx == mLayerIndex.end(), "%s: unknown layer %p", __FUNCTION__, layer);
 
-    const auto& info = it->second;
+    LayerInfoV2* const info = idx->second;
     info->setLastPresentTime(presentTime, now, updateType, mConfigChangePending);
 
-    // Activate layer if inactive.
-    if (const auto end = activeLayers().end(); it >= end) {
-        std::iter_swap(it, end);
-        mActiveLayersEnd++;
+    // Activate layer if inactive. An already-active layer queueing another buffer is
+    // the common case and skips the partition scan entirely.
+    if (!info->isActive()) {
+        const auto it = std::find_if(mLayerInfos.begin(), mLayerInfos.end(),
+                                     [layer](const auto& pair) { return pair.first == layer; });
+        if (const auto end = activeLayers().end(); it >= end) {
+            std::iter_swap(it, end);
+            mActiveLayersEnd++;
+        }
+        info->setActive(true);
     }
 }
 
@@ -190,6 +196,7 @@ void LayerHistoryV2::partitionLayers(nsecs_t now) {
         }
 
         info->onLayerInactive(now);
+        info->setActive(false);
         std::swap(mLayerInfos[i], mLayerInfos[--mActiveLayersEnd]);
     }
 
@@ -203,6 +210,15 @@ void LayerHistoryV2::partitionLayers(nsecs_t now) {
         }
     }
 
+    // Drop expired layers from the lookup index before truncating. Compare the mapped
+    // info in case a new layer was registered at a recycled address.
+    for (size_t j = end; j < mLayerInfos.size(); j++) {
+        const auto it = mLayerIndex.find(mLayerInfos[j].first.unsafe_get());
+        if (it != mLayerIndex.end() && it->second == mLayerInfos[j].second.get()) {
+            mLayerIndex.erase(it);
+        }
+    }
+
     mLayerInfos.erase(mLayerInfos.begin() + static_cast<long>(end), mLayerInfos.end());
 }
 
@@ -18,6 +18,7 @@
 
 #include <utils/Timers.h>
 
+#include <atomic>
 #include <chrono>
 #include <deque>
 
@@ -92,6 +93,11 @@ public:
     // updated time, the updated time is the present time.
     nsecs_t getLastUpdatedTime() const { return mLastUpdatedTime; }
 
+    // Whether the layer is currently in the active partition of LayerHistory. Kept here so
+    // record() can skip the partition scan when the layer is already active.
+    bool isActive() const { return mIsActive; }
+    void setActive(bool active) { mIsActive = active; }
+
     // Returns a C string for tracing a vote
     const char* getTraceTag(LayerHistory::LayerVoteType type) const;
 
@@ -200,6 +206,9 @@ private:
 
     nsecs_t mLastAnimationTime = 0;
 
+    // Whether the layer currently sits in the active partition of LayerHistory.
+    std::atomic<bool> mIsActive = false;
+
     RefreshRateHeuristicData mLastRefreshRate;
 
     std::deque<FrameTimeData> mFrameTimes;
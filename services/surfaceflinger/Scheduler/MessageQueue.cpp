@@ -18,10 +18,13 @@
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wconversion"
 
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
 #include <binder/IPCThreadState.h>
 
 #include <utils/Log.h>
 #include <utils/Timers.h>
+#include <utils/Trace.h>
 #include <utils/threads.h>
 
 #include <gui/DisplayEventReceiver.h>
@@ -35,14 +38,28 @@ namespace android::impl {
 
 void MessageQueue::Handler::dispatchRefresh() {
     if ((android_atomic_or(eventMaskRefresh, &mEventMask) & eventMaskRefresh) == 0) {
-        mQueue.mLooper->sendMessage(this, Message(MessageQueue::REFRESH));
+        mRefreshEnqueueTime = systemTime();
+        // Send at time zero so vsync-critical work sorts ahead of client work queued
+        // through postMessage, which is stamped with the current time.
+        mQueue.mLooper->sendMessageAtTime(0, this, Message(MessageQueue::REFRESH));
     }
 }
 
 void MessageQueue::Handler::dispatchInvalidate(nsecs_t expectedVSyncTimestamp) {
     if ((android_atomic_or(eventMaskInvalidate, &mEventMask) & eventMaskInvalidate) == 0) {
         mExpectedVSyncTime = expectedVSyncTimestamp;
-        mQueue.mLooper->sendMessage(this, Message(MessageQueue::INVALIDATE));
+        mInvalidateEnqueueTime = systemTime();
+        mQueue.mLooper->sendMessageAtTime(0, this, Message(MessageQueue::INVALIDATE));
+    }
+}
+
+void MessageQueue::Handler::trackQueueDelay(nsecs_t enqueueTime) {
+    const nsecs_t now = systemTime();
+    const nsecs_t expectedVSyncTime = mExpectedVSyncTime;
+    // Attribute the miss to queue delay only if the message was queued before the
+    // frame deadline but handled after it.
+    if (now > expectedVSyncTime && enqueueTime <= expectedVSyncTime) {
+        ATRACE_INT("QueueDelayMissedFrames", ++mQueueDelayMissCount);
     }
 }
 
@@ -50,10 +67,12 @@ void MessageQueue::Handler::handleMessage(const Message& message) {
     switch (message.what) {
         case INVALIDATE:
             android_atomic_and(~eventMaskInvalidate, &mEventMask);
+            trackQueueDelay(mInvalidateEnqueueTime);
             mQueue.mFlinger->onMessageReceived(message.what, mExpectedVSyncTime);
             break;
         case REFRESH:
             android_atomic_and(~eventMaskRefresh, &mEventMask);
+            trackQueueDelay(mRefreshEnqueueTime);
             mQueue.mFlinger->onMessageReceived(message.what, mExpectedVSyncTime);
             break;
     }
@@ -105,6 +124,11 @@ void MessageQueue::postMessage(sp<MessageHandler>&& handler) {
 }
 
 void MessageQueue::invalidate() {
+    if (mInvalidatePending.exchange(true)) {
+        // A vsync has already been requested; this invalidate rides along with it.
+        ATRACE_INT("InvalidatesCoalesced", ++mInvalidatesCoalesced);
+        return;
+    }
     mEvents->requestNextVsync();
 }
 
@@ -124,6 +148,10 @@ int MessageQueue::eventReceiver(int /*fd*/, int /*events*/) {
         for (int i = 0; i < n; i++) {
             if (buffer[i].header.type == DisplayEventReceiver::DISPLAY_EVENT_VSYNC) {
                 mFlinger->mVsyncTimeStamp = systemTime(SYSTEM_TIME_MONOTONIC);
+                // Clear before dispatching so an invalidate() racing with this vsync
+                // schedules the next frame rather than being coalesced into one that
+                // has already been delivered.
+                mInvalidatePending = false;
                 mHandler->dispatchInvalidate(buffer[i].vsync.expectedVSyncTimestamp);
                 break;
             }
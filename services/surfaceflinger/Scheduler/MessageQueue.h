@@ -80,6 +80,13 @@ class MessageQueue final : public android::MessageQueue {
         MessageQueue& mQueue;
         int32_t mEventMask;
         std::atomic<nsecs_t> mExpectedVSyncTime;
+        std::atomic<nsecs_t> mInvalidateEnqueueTime{0};
+        std::atomic<nsecs_t> mRefreshEnqueueTime{0};
+        // Frames whose INVALIDATE/REFRESH dispatch was pushed past the expected vsync
+        // time by messages queued ahead of it.
+        std::atomic<int32_t> mQueueDelayMissCount{0};
+
+        void trackQueueDelay(nsecs_t enqueueTime);
 
     public:
         explicit Handler(MessageQueue& queue) : mQueue(queue), mEventMask(0) {}
@@ -96,6 +103,14 @@ class MessageQueue final : public android::MessageQueue {
     gui::BitTube mEventTube;
     sp<Handler> mHandler;
 
+    // Coalescing state for invalidate(): set while a vsync has been requested but
+    // not yet received, so repeated invalidate calls (e.g. a transaction storm from
+    // a misbehaving app) cost one EventThread wakeup per frame instead of one per
+    // call.
+    std::atomic<bool> mInvalidatePending{false};
+    // Number of invalidate() calls suppressed because one was already pending.
+    std::atomic<uint32_t> mInvalidatesCoalesced{0};
+
     static int cb_eventReceiver(int fd, int events, void* data);
     int eventReceiver(int fd, int events);
 
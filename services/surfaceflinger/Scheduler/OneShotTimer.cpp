@@ -14,99 +14,277 @@
  * limitations under the License.
  */
 
+#undef LOG_TAG
+#define LOG_TAG "OneShotTimer"
+
 #include "OneShotTimer.h"
 
+#include <android-base/thread_annotations.h>
+#include <log/log.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/unistd.h>
+#include <utils/Timers.h>
+
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <sstream>
 #include <thread>
+#include <vector>
 
 namespace android {
 namespace scheduler {
 
-OneShotTimer::OneShotTimer(const Interval& interval, const ResetCallback& resetCallback,
-                           const TimeoutCallback& timeoutCallback)
-      : mInterval(interval), mResetCallback(resetCallback), mTimeoutCallback(timeoutCallback) {}
+namespace {
+constexpr size_t kReadPipe = 0;
+constexpr size_t kWritePipe = 1;
+} // namespace
 
-OneShotTimer::~OneShotTimer() {
-    stop();
-}
+/*
+ * Dispatches every OneShotTimer in the process from a single thread over one
+ * timerfd. Pending deadlines live in a min-heap, so rearming after a reset or
+ * an expiry is one timerfd_settime on the earliest deadline instead of a
+ * dedicated thread wakeup per timer instance.
+ */
+class TimerDispatch {
+public:
+    static TimerDispatch& getInstance() {
+        // Deliberately leaked: timers created from static objects may still be
+        // stopped during process teardown.
+        static TimerDispatch* const instance = new TimerDispatch();
+        return *instance;
+    }
 
-void OneShotTimer::start() {
-    {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mState = TimerState::RESET;
+    // Queues the reset callback for the timer and (re)arms its timeout.
+    void scheduleReset(OneShotTimer* timer) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (std::find(mPendingResets.begin(), mPendingResets.end(), timer) ==
+                mPendingResets.end()) {
+                mPendingResets.push_back(timer);
+            }
+        }
+        wakeDispatch();
     }
-    mThread = std::thread(&OneShotTimer::loop, this);
-}
 
-void OneShotTimer::stop() {
-    {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mState = TimerState::STOPPED;
+    // Removes the timer. Once this returns no callback for the timer is
+    // running or will run until it is scheduled again.
+    void remove(OneShotTimer* timer) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mPendingResets.erase(std::remove(mPendingResets.begin(), mPendingResets.end(), timer),
+                             mPendingResets.end());
+        auto stale = std::remove_if(mDeadlines.begin(), mDeadlines.end(),
+                                    [timer](const Entry& entry) { return entry.timer == timer; });
+        if (stale != mDeadlines.end()) {
+            mDeadlines.erase(stale, mDeadlines.end());
+            std::make_heap(mDeadlines.begin(), mDeadlines.end(), EntryLater());
+            rearmLocked();
+        }
+        // A callback may be in flight on the dispatch thread; wait it out
+        // unless we are that thread (a callback stopping its own timer).
+        while (mActiveTimer == timer && std::this_thread::get_id() != mThreadId) {
+            mActiveDone.wait(lock);
+        }
     }
-    mCondition.notify_all();
-    if (mThread.joinable()) {
-        mThread.join();
+
+private:
+    struct Entry {
+        nsecs_t deadline;
+        OneShotTimer* timer;
+    };
+    struct EntryLater {
+        bool operator()(const Entry& lhs, const Entry& rhs) const {
+            return lhs.deadline > rhs.deadline;
+        }
+    };
+
+    TimerDispatch() {
+        mTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (pipe2(mPipes.data(), O_CLOEXEC | O_NONBLOCK)) {
+            ALOGE("could not create TimerDispatch pipes");
+        }
+        mThread = std::thread([this] { threadMain(); });
+    }
+
+    void wakeDispatch() {
+        static constexpr unsigned char wake = 'w';
+        write(mPipes[kWritePipe], &wake, sizeof(wake));
     }
-}
 
-void OneShotTimer::loop() {
-    while (true) {
-        bool triggerReset = false;
-        bool triggerTimeout = false;
+    void threadMain() {
+        if (pthread_setname_np(pthread_self(), "TimerDispatch")) {
+            ALOGW("Failed to set thread name on dispatch thread");
+        }
         {
             std::lock_guard<std::mutex> lock(mMutex);
-            if (mState == TimerState::STOPPED) {
-                break;
-            }
+            mThreadId = std::this_thread::get_id();
+        }
+
+        enum DispatchType : uint32_t { TIMER, WAKE, MAX_DISPATCH_TYPE };
+        epoll_event timerEvent;
+        timerEvent.events = EPOLLIN;
+        timerEvent.data.u32 = DispatchType::TIMER;
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mTimerFd, &timerEvent) == -1) {
+            ALOGE("Error adding timer fd to epoll dispatch loop");
+            return;
+        }
+
+        epoll_event wakeEvent;
+        wakeEvent.events = EPOLLIN;
+        wakeEvent.data.u32 = DispatchType::WAKE;
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mPipes[kReadPipe], &wakeEvent) == -1) {
+            ALOGE("Error adding control fd to dispatch loop");
+            return;
+        }
 
-            if (mState == TimerState::IDLE) {
-                mCondition.wait(mMutex);
+        while (true) {
+            epoll_event events[DispatchType::MAX_DISPATCH_TYPE];
+            int nfds = epoll_wait(mEpollFd, events, DispatchType::MAX_DISPATCH_TYPE, -1);
+            if (nfds == -1) {
+                if (errno != EINTR) {
+                    ALOGE("Error waiting on epoll: %s", strerror(errno));
+                    return;
+                }
                 continue;
             }
 
-            if (mState == TimerState::RESET) {
-                triggerReset = true;
+            for (auto i = 0; i < nfds; i++) {
+                if (events[i].data.u32 == DispatchType::TIMER) {
+                    uint64_t ignored = 0;
+                    read(mTimerFd, &ignored, sizeof(ignored));
+                } else if (events[i].data.u32 == DispatchType::WAKE) {
+                    unsigned char drain[16];
+                    while (read(mPipes[kReadPipe], drain, sizeof(drain)) > 0) {
+                    }
+                }
             }
+            dispatch();
         }
-        if (triggerReset && mResetCallback) {
-            mResetCallback();
-        }
+    }
 
-        { // lock the mutex again. someone might have called stop meanwhile
-            std::lock_guard<std::mutex> lock(mMutex);
-            if (mState == TimerState::STOPPED) {
-                break;
-            }
+    void dispatch() {
+        std::unique_lock<std::mutex> lock(mMutex);
 
-            auto triggerTime = std::chrono::steady_clock::now() + mInterval;
-            mState = TimerState::WAITING;
-            while (mState == TimerState::WAITING) {
-                constexpr auto zero = std::chrono::steady_clock::duration::zero();
-                auto waitTime = triggerTime - std::chrono::steady_clock::now();
-                if (waitTime > zero) mCondition.wait_for(mMutex, waitTime);
-                if (mState == TimerState::RESET) {
-                    triggerTime = std::chrono::steady_clock::now() + mInterval;
-                    mState = TimerState::WAITING;
-                } else if (mState == TimerState::WAITING &&
-                           (triggerTime - std::chrono::steady_clock::now()) <= zero) {
-                    triggerTimeout = true;
-                    mState = TimerState::IDLE;
-                }
+        // Rearm reset timers, firing the reset callback only when the timer
+        // was idle: a reset while a timeout is pending just pushes the
+        // deadline out, matching the original per-thread behavior. A callback
+        // may schedule further resets; the loop picks them up.
+        while (!mPendingResets.empty()) {
+            OneShotTimer* timer = mPendingResets.front();
+            mPendingResets.erase(mPendingResets.begin());
+            auto stale = std::remove_if(mDeadlines.begin(), mDeadlines.end(),
+                                        [timer](const Entry& entry) {
+                                            return entry.timer == timer;
+                                        });
+            const bool wasWaiting = stale != mDeadlines.end();
+            if (wasWaiting) {
+                mDeadlines.erase(stale, mDeadlines.end());
+                std::make_heap(mDeadlines.begin(), mDeadlines.end(), EntryLater());
+            }
+            const nsecs_t deadline = systemTime(SYSTEM_TIME_MONOTONIC) +
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(timer->mInterval).count();
+            mDeadlines.push_back({deadline, timer});
+            std::push_heap(mDeadlines.begin(), mDeadlines.end(), EntryLater());
+            if (!wasWaiting) {
+                fire(lock, timer, timer->mResetCallback);
             }
         }
-        if (triggerTimeout && mTimeoutCallback) {
-            mTimeoutCallback();
+
+        // Fire expired timeouts; the timer then stays idle until reset again.
+        while (!mDeadlines.empty() &&
+               mDeadlines.front().deadline <= systemTime(SYSTEM_TIME_MONOTONIC)) {
+            OneShotTimer* timer = mDeadlines.front().timer;
+            std::pop_heap(mDeadlines.begin(), mDeadlines.end(), EntryLater());
+            mDeadlines.pop_back();
+            fire(lock, timer, timer->mTimeoutCallback);
+        }
+
+        rearmLocked();
+    }
+
+    // Runs the callback with the lock dropped so callbacks can reset or stop
+    // timers; remove() synchronizes against mActiveTimer.
+    void fire(std::unique_lock<std::mutex>& lock, OneShotTimer* timer,
+              const std::function<void()>& callback) {
+        mActiveTimer = timer;
+        lock.unlock();
+        if (callback) {
+            callback();
+        }
+        lock.lock();
+        mActiveTimer = nullptr;
+        mActiveDone.notify_all();
+    }
+
+    // Arms the timerfd to the earliest pending deadline, or disarms it when
+    // nothing is pending. Skips the syscall when the deadline is unchanged.
+    void rearmLocked() {
+        using namespace std::literals;
+        static constexpr int ns_per_s =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(1s).count();
+
+        const nsecs_t deadline = mDeadlines.empty() ? 0 : mDeadlines.front().deadline;
+        if (deadline == mArmedDeadline) {
+            return;
+        }
+
+        struct itimerspec old_timer;
+        struct itimerspec new_timer {
+            .it_interval = {.tv_sec = 0, .tv_nsec = 0},
+            .it_value = {.tv_sec = static_cast<long>(deadline / ns_per_s),
+                         .tv_nsec = static_cast<long>(deadline % ns_per_s)},
+        };
+
+        if (timerfd_settime(mTimerFd, deadline ? TFD_TIMER_ABSTIME : 0, &new_timer, &old_timer)) {
+            ALOGW("Failed to set timerfd %s (%i)", strerror(errno), errno);
         }
+        mArmedDeadline = deadline;
     }
+
+    int mTimerFd = -1;
+    int mEpollFd = -1;
+    std::array<int, 2> mPipes = {-1, -1};
+    std::thread mThread;
+
+    std::mutex mMutex;
+    std::thread::id mThreadId GUARDED_BY(mMutex);
+    // Timers whose reset callback is pending, in scheduling order.
+    std::vector<OneShotTimer*> mPendingResets GUARDED_BY(mMutex);
+    // Min-heap (via std::push_heap/pop_heap) of pending timeouts.
+    std::vector<Entry> mDeadlines GUARDED_BY(mMutex);
+    // Deadline currently programmed into the timerfd, 0 when disarmed.
+    nsecs_t mArmedDeadline GUARDED_BY(mMutex) = 0;
+    // Timer whose callback is currently running with mMutex dropped.
+    OneShotTimer* mActiveTimer GUARDED_BY(mMutex) = nullptr;
+    std::condition_variable mActiveDone;
+};
+
+OneShotTimer::OneShotTimer(const Interval& interval, const ResetCallback& resetCallback,
+                           const TimeoutCallback& timeoutCallback)
+      : mInterval(interval), mResetCallback(resetCallback), mTimeoutCallback(timeoutCallback) {}
+
+OneShotTimer::~OneShotTimer() {
+    stop();
+}
+
+void OneShotTimer::start() {
+    mStarted = true;
+    TimerDispatch::getInstance().scheduleReset(this);
+}
+
+void OneShotTimer::stop() {
+    mStarted = false;
+    TimerDispatch::getInstance().remove(this);
 }
 
 void OneShotTimer::reset() {
-    {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mState = TimerState::RESET;
+    if (mStarted) {
+        TimerDispatch::getInstance().scheduleReset(this);
     }
-    mCondition.notify_all();
 }
 
 std::string OneShotTimer::dump() const {
@@ -16,11 +16,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
-#include <condition_variable>
-#include <thread>
-
-#include <android-base/thread_annotations.h>
+#include <functional>
+#include <string>
 
 namespace android {
 namespace scheduler {
@@ -28,6 +27,11 @@ namespace scheduler {
 /*
  * Class that sets off a timer for a given interval, and fires a callback when the
  * interval expires.
+ *
+ * All instances in the process are dispatched from a single timerfd-backed
+ * thread (see TimerDispatch in OneShotTimer.cpp), so creating a timer does not
+ * create a thread and rearming is a single syscall on the earliest deadline.
+ * Callbacks therefore share that thread and should stay short.
  */
 class OneShotTimer {
 public:
@@ -41,7 +45,8 @@ public:
 
     // Initializes and turns on the idle timer.
     void start();
-    // Stops the idle timer and any held resources.
+    // Stops the idle timer and any held resources. No callback for this timer
+    // is running or will run once this returns.
     void stop();
     // Resets the wakeup time and fires the reset callback.
     void reset();
@@ -49,38 +54,10 @@ public:
     std::string dump() const;
 
 private:
-    // Enum to track in what state is the timer.
-    enum class TimerState {
-        // The internal timer thread has been destroyed, and no state is
-        // tracked.
-        // Possible state transitions: RESET
-        STOPPED = 0,
-        // An external thread has just reset this timer.
-        // If there is a reset callback, then that callback is fired.
-        // Possible state transitions: STOPPED, WAITING
-        RESET = 1,
-        // This timer is waiting for the timeout interval to expire.
-        // Possible state transaitions: STOPPED, RESET, IDLE
-        WAITING = 2,
-        // The timeout interval has expired, so we are sleeping now.
-        // Possible state transaitions: STOPPED, RESET
-        IDLE = 3
-    };
-
-    // Function that loops until the condition for stopping is met.
-    void loop();
-
-    // Thread waiting for timer to expire.
-    std::thread mThread;
-
-    // Condition used to notify mThread.
-    std::condition_variable_any mCondition;
-
-    // Lock used for synchronizing the waiting thread with the application thread.
-    std::mutex mMutex;
+    friend class TimerDispatch;
 
-    // Current timer state
-    TimerState mState GUARDED_BY(mMutex) = TimerState::RESET;
+    // True between start() and stop(); reset() is a no-op while stopped.
+    std::atomic<bool> mStarted{false};
 
     // Interval after which timer expires.
     const Interval mInterval;
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PhaseOffsetTuner.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+
+#include <android-base/stringprintf.h>
+
+namespace android::scheduler {
+
+namespace {
+
+bool fpsEqualsWithMargin(float fpsA, float fpsB) {
+    static constexpr float MARGIN = 0.01f;
+    return std::abs(fpsA - fpsB) <= MARGIN;
+}
+
+} // namespace
+
+PhaseOffsetTuner::PhaseOffsetTuner(const PhaseConfiguration& phaseConfiguration)
+      : mPhaseConfiguration(phaseConfiguration) {}
+
+PhaseOffsetTuner::RateState& PhaseOffsetTuner::getStateForFps(float fps) {
+    auto it = std::find_if(mRateStates.begin(), mRateStates.end(), [fps](const auto& candidate) {
+        return fpsEqualsWithMargin(fps, candidate.first);
+    });
+    if (it != mRateStates.end()) {
+        return it->second;
+    }
+
+    // Capture the baseline before the first UpdateSfOffsets for this rate, so
+    // the tuner always knows where the untuned configuration would wake SF.
+    RateState state;
+    state.baselineSfOffset = mPhaseConfiguration.getOffsetsForRefreshRate(fps).late.sf;
+    return mRateStates.emplace(fps, state).first->second;
+}
+
+bool PhaseOffsetTuner::onFrameCompleted(float fps, nsecs_t vsyncPeriod, bool frameMissed) {
+    std::lock_guard lock(mMutex);
+    RateState& state = getStateForFps(fps);
+
+    if (frameMissed) {
+        state.framesInWindow = 0;
+        state.cooldownWindows = kCooldownWindows;
+        if (state.advance > 0) {
+            state.advance = std::max<nsecs_t>(0, state.advance - kBackoffStepNs);
+            return true;
+        }
+        // Already at the configured offsets. The miss is the device's
+        // baseline behavior, not something the tuner caused.
+        return false;
+    }
+
+    if (++state.framesInWindow < kFramesPerWindow) {
+        return false;
+    }
+    state.framesInWindow = 0;
+
+    if (state.cooldownWindows > 0) {
+        state.cooldownWindows--;
+        return false;
+    }
+
+    const nsecs_t limit = maxAdvance(vsyncPeriod);
+    if (state.advance >= limit) {
+        return false;
+    }
+    state.advance = std::min(limit, state.advance + kAdvanceStepNs);
+    return true;
+}
+
+std::unordered_map<float, int64_t> PhaseOffsetTuner::getTunedSfOffsets() const {
+    std::lock_guard lock(mMutex);
+    std::unordered_map<float, int64_t> offsets;
+    offsets.reserve(mRateStates.size());
+    for (const auto& [fps, state] : mRateStates) {
+        offsets.emplace(fps, state.baselineSfOffset + state.advance);
+    }
+    return offsets;
+}
+
+void PhaseOffsetTuner::dump(std::string& result) const {
+    std::lock_guard lock(mMutex);
+    using base::StringAppendF;
+    StringAppendF(&result, "Phase offset tuner:\n");
+    for (const auto& [fps, state] : mRateStates) {
+        StringAppendF(&result,
+                      "  %6.2f fps: SF phase %9" PRId64 " ns (baseline %9" PRId64
+                      " ns, advance %9" PRId64 " ns)%s\n",
+                      fps, state.baselineSfOffset + state.advance, state.baselineSfOffset,
+                      state.advance, state.cooldownWindows > 0 ? " [cooldown]" : "");
+    }
+}
+
+} // namespace android::scheduler
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+
+#include <android-base/thread_annotations.h>
+#include <utils/Timers.h>
+
+#include "PhaseOffsets.h"
+
+namespace android::scheduler {
+
+/*
+ * Closed-loop tuner for the SF phase offsets. The sysprop-configured offsets
+ * have to be conservative enough for the slowest device that ships with them,
+ * so on most devices SF finishes composition well before its deadline. The
+ * tuner watches the per-frame missed/on-time signal and, per refresh rate,
+ * gradually moves the SF offset later, shrinking the scheduling slack towards
+ * what the device actually needs. Any missed frame backs the offset off
+ * immediately and starts a cooldown before the tuner advances again. The
+ * configured offsets are the floor - the tuner never schedules SF earlier
+ * than the sysprops do - so falling back is always safe.
+ *
+ * Enabled with debug.sf.auto_tune_phase_offsets. Only effective with the
+ * offset-based PhaseConfiguration; the durations-based configuration does not
+ * support UpdateSfOffsets.
+ */
+class PhaseOffsetTuner {
+public:
+    explicit PhaseOffsetTuner(const PhaseConfiguration& phaseConfiguration);
+
+    // Records the outcome of the frame that was just handled at the given
+    // refresh rate. Returns true when the tuned offsets changed and the caller
+    // should push them through PhaseConfiguration::UpdateSfOffsets.
+    bool onFrameCompleted(float fps, nsecs_t vsyncPeriod, bool frameMissed) EXCLUDES(mMutex);
+
+    // Tuned SF offsets for every refresh rate the tuner has seen, in the
+    // format PhaseConfiguration::UpdateSfOffsets expects.
+    std::unordered_map<float, int64_t> getTunedSfOffsets() const EXCLUDES(mMutex);
+
+    void dump(std::string& result) const EXCLUDES(mMutex);
+
+protected:
+    // Number of consecutive on-time frames required before the offset is
+    // advanced by one step.
+    static constexpr size_t kFramesPerWindow = 120;
+
+    // How far a clean window moves the SF offset towards the deadline.
+    static constexpr nsecs_t kAdvanceStepNs = 500'000;
+
+    // A missed frame retreats twice as fast as a clean window advances.
+    static constexpr nsecs_t kBackoffStepNs = 2 * kAdvanceStepNs;
+
+    // Number of clean windows to sit out after a backoff before advancing
+    // again, so a workload that misses at a given offset oscillates slowly.
+    static constexpr size_t kCooldownWindows = 4;
+
+    // The tuner never reclaims more than a quarter of the vsync period, which
+    // keeps the tuned offset well away from the next-vsync threshold.
+    static constexpr nsecs_t maxAdvance(nsecs_t vsyncPeriod) { return vsyncPeriod / 4; }
+
+private:
+    struct RateState {
+        nsecs_t baselineSfOffset; // late.sf of the untuned configuration.
+        nsecs_t advance = 0;      // How much later than baseline SF wakes up.
+        size_t framesInWindow = 0;
+        size_t cooldownWindows = 0;
+    };
+
+    RateState& getStateForFps(float fps) REQUIRES(mMutex);
+
+    const PhaseConfiguration& mPhaseConfiguration;
+
+    mutable std::mutex mMutex;
+    std::unordered_map<float, RateState> mRateStates GUARDED_BY(mMutex);
+};
+
+} // namespace android::scheduler
@@ -102,8 +102,8 @@ const RefreshRate& RefreshRateConfigs::getRefreshRateForContent(
     return *bestSoFar;
 }
 
-std::pair<nsecs_t, nsecs_t> RefreshRateConfigs::getDisplayFrames(nsecs_t layerPeriod,
-                                                                 nsecs_t displayPeriod) const {
+std::pair<nsecs_t, nsecs_t> RefreshRateConfigs::calculateDisplayFrames(nsecs_t layerPeriod,
+                                                                       nsecs_t displayPeriod) {
     auto [displayFramesQuot, displayFramesRem] = std::div(layerPeriod, displayPeriod);
     if (displayFramesRem <= MARGIN_FOR_PERIOD_CALCULATION ||
         std::abs(displayFramesRem - displayPeriod) <= MARGIN_FOR_PERIOD_CALCULATION) {
@@ -114,9 +114,42 @@ std::pair<nsecs_t, nsecs_t> RefreshRateConfigs::getDisplayFrames(nsecs_t layerPe
     return {displayFramesQuot, displayFramesRem};
 }
 
+std::pair<nsecs_t, nsecs_t> RefreshRateConfigs::getDisplayFrames(nsecs_t layerPeriod,
+                                                                 nsecs_t displayPeriod) const {
+    const auto it = mPrecomputedDisplayFrames.find({layerPeriod, displayPeriod});
+    if (it != mPrecomputedDisplayFrames.end()) {
+        return it->second;
+    }
+
+    return calculateDisplayFrames(layerPeriod, displayPeriod);
+}
+
 const RefreshRate& RefreshRateConfigs::getBestRefreshRate(
         const std::vector<LayerRequirement>& layers, const GlobalSignals& globalSignals,
         GlobalSignals* outSignalsConsidered) const {
+    std::lock_guard lock(mLock);
+
+    if (mGetBestRefreshRateCache &&
+        mGetBestRefreshRateCache->arguments == std::make_pair(layers, globalSignals)) {
+        if (outSignalsConsidered) {
+            *outSignalsConsidered = mGetBestRefreshRateCache->outSignalsConsidered;
+        }
+        return *mGetBestRefreshRateCache->bestRefreshRate;
+    }
+
+    GlobalSignals signalsConsidered;
+    const RefreshRate& result = getBestRefreshRateLocked(layers, globalSignals, &signalsConsidered);
+    mGetBestRefreshRateCache =
+            GetBestRefreshRateCache{{layers, globalSignals}, &result, signalsConsidered};
+    if (outSignalsConsidered) {
+        *outSignalsConsidered = signalsConsidered;
+    }
+    return result;
+}
+
+const RefreshRate& RefreshRateConfigs::getBestRefreshRateLocked(
+        const std::vector<LayerRequirement>& layers, const GlobalSignals& globalSignals,
+        GlobalSignals* outSignalsConsidered) const {
     ATRACE_CALL();
     ALOGV("getRefreshRateForContent %zu layers", layers.size());
 
@@ -133,8 +166,6 @@ const RefreshRate& RefreshRateConfigs::getBestRefreshRate(
         }
     };
 
-    std::lock_guard lock(mLock);
-
     int noVoteLayers = 0;
     int minVoteLayers = 0;
     int maxVoteLayers = 0;
@@ -294,6 +325,16 @@ const RefreshRate& RefreshRateConfigs::getBestRefreshRate(
         }
     }
 
+    if (mThermalHeadroom < 1.0f) {
+        // Bias the scores toward lower refresh rates as thermal headroom shrinks, so the
+        // display steps down progressively instead of clamping straight to the minimum.
+        // Content that strongly prefers a high rate can still win until the headroom
+        // gets close to zero.
+        for (auto& [refreshRate, score] : scores) {
+            score *= thermalScoreFactor(*refreshRate);
+        }
+    }
+
     // Now that we scored all the refresh rates we need to pick the one that got the highest score.
     // In case of a tie we will pick the higher refresh rate if any of the layers wanted Max,
     // or the lower otherwise.
@@ -420,6 +461,17 @@ RefreshRateConfigs::RefreshRateConfigs(
     mMinSupportedRefreshRate = sortedConfigs.front();
     mMaxSupportedRefreshRate = sortedConfigs.back();
     constructAvailableRefreshRates();
+
+    // Precompute the frame-rate-matching divisions for each known layer frame rate
+    // against each config, so the scoring loop does not redo them per layer.
+    for (const float frameRate : mKnownFrameRates) {
+        const auto layerPeriod = round<nsecs_t>(1e9f / frameRate);
+        for (const auto& config : configs) {
+            const auto displayPeriod = config->getVsyncPeriod();
+            mPrecomputedDisplayFrames.emplace(std::make_pair(layerPeriod, displayPeriod),
+                                              calculateDisplayFrames(layerPeriod, displayPeriod));
+        }
+    }
 }
 
 bool RefreshRateConfigs::isPolicyValid(const Policy& policy) {
@@ -488,6 +540,42 @@ bool RefreshRateConfigs::isConfigAllowed(HwcConfigIndexType config) const {
     return false;
 }
 
+bool RefreshRateConfigs::setThermalHeadroom(float headroom) {
+    std::lock_guard lock(mLock);
+    const float clamped = std::clamp(headroom, 0.0f, 1.0f);
+    // Apply hysteresis so marginal headroom updates from the thermal service don't make
+    // the selected refresh rate oscillate. The endpoints are always applied, so we can
+    // fully recover once the device cools down and fully throttle when it has to.
+    if (clamped != 0.0f && clamped != 1.0f &&
+        std::abs(clamped - mThermalHeadroom) < THERMAL_HEADROOM_HYSTERESIS) {
+        return false;
+    }
+    if (clamped == mThermalHeadroom) {
+        return false;
+    }
+    mThermalHeadroom = clamped;
+    ATRACE_INT("ThermalHeadroom", round<int>(clamped * 100));
+    // The headroom biases refresh rate scoring, so a cached result is no longer valid.
+    mGetBestRefreshRateCache.reset();
+    return true;
+}
+
+float RefreshRateConfigs::getThermalHeadroom() const {
+    std::lock_guard lock(mLock);
+    return mThermalHeadroom;
+}
+
+float RefreshRateConfigs::thermalScoreFactor(const RefreshRate& refreshRate) const {
+    const float minFps = mMinSupportedRefreshRate->getFps();
+    const float maxFps = mMaxSupportedRefreshRate->getFps();
+    if (mThermalHeadroom >= 1.0f || maxFps <= minFps) {
+        return 1.0f;
+    }
+    // Penalize rates above the device min proportionally to how little headroom is left.
+    const float normalized = (refreshRate.getFps() - minFps) / (maxFps - minFps);
+    return 1.0f - (1.0f - mThermalHeadroom) * normalized;
+}
+
 void RefreshRateConfigs::getSortedRefreshRateList(
         const std::function<bool(const RefreshRate&)>& shouldAddRefreshRate,
         std::vector<const RefreshRate*>* outRefreshRates) {
@@ -515,6 +603,9 @@ void RefreshRateConfigs::getSortedRefreshRateList(
 }
 
 void RefreshRateConfigs::constructAvailableRefreshRates() {
+    // The policy affects refresh rate selection, so a cached result is no longer valid.
+    mGetBestRefreshRateCache.reset();
+
     // Filter configs based on current policy and sort based on vsync period
     const Policy* policy = getCurrentPolicyLocked();
     const auto& defaultConfig = mRefreshRates.at(policy->defaultConfig)->hwcConfig;
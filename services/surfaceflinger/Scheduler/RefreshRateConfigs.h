@@ -19,6 +19,7 @@
 #include <android-base/stringprintf.h>
 
 #include <algorithm>
+#include <map>
 #include <numeric>
 #include <optional>
 #include <type_traits>
@@ -180,6 +181,20 @@ public:
     // Returns true if config is allowed by the current policy.
     bool isConfigAllowed(HwcConfigIndexType config) const EXCLUDES(mLock);
 
+    // Hysteresis applied to thermal headroom hints. Updates closer than this to the
+    // currently applied headroom are ignored, so a headroom that hovers around a scoring
+    // boundary doesn't make the selected refresh rate oscillate.
+    static constexpr float THERMAL_HEADROOM_HYSTERESIS = 0.05f;
+
+    // Sets the thermal headroom hint used to bias refresh rate selection. A headroom of
+    // 1.0 means no thermal pressure; as it approaches 0.0 the scoring in
+    // getBestRefreshRate() progressively prefers lower refresh rates. The value is
+    // clamped to [0.0, 1.0]. Returns true if the applied headroom changed, i.e. the hint
+    // was outside the hysteresis band around the previous value.
+    bool setThermalHeadroom(float headroom) EXCLUDES(mLock);
+    // Returns the currently applied thermal headroom.
+    float getThermalHeadroom() const EXCLUDES(mLock);
+
     // Describes the different options the layer voted for refresh rate
     enum class LayerVoteType {
         NoVote,          // Doesn't care about the refresh rate
@@ -226,6 +241,10 @@ public:
         bool touch = false;
         // True if the system hasn't seen any buffers posted to layers recently.
         bool idle = false;
+
+        bool operator==(const GlobalSignals& other) const {
+            return touch == other.touch && idle == other.idle;
+        }
     };
 
     // Returns the refresh rate that fits best to the given layers.
@@ -308,9 +327,16 @@ private:
     template <typename Iter>
     const RefreshRate* getBestRefreshRate(Iter begin, Iter end) const;
 
+    const RefreshRate& getBestRefreshRateLocked(const std::vector<LayerRequirement>& layers,
+                                                const GlobalSignals& globalSignals,
+                                                GlobalSignals* outSignalsConsidered) const
+            REQUIRES(mLock);
+
     // Returns number of display frames and remainder when dividing the layer refresh period by
     // display refresh period.
     std::pair<nsecs_t, nsecs_t> getDisplayFrames(nsecs_t layerPeriod, nsecs_t displayPeriod) const;
+    static std::pair<nsecs_t, nsecs_t> calculateDisplayFrames(nsecs_t layerPeriod,
+                                                              nsecs_t displayPeriod);
 
     // Returns the lowest refresh rate according to the current policy. May change at runtime. Only
     // uses the primary range, not the app request range.
@@ -327,6 +353,10 @@ private:
     const Policy* getCurrentPolicyLocked() const REQUIRES(mLock);
     bool isPolicyValid(const Policy& policy);
 
+    // Returns the multiplier in (0, 1] applied to the score of refreshRate to account for
+    // the current thermal headroom. Lower refresh rates get a factor closer to 1.
+    float thermalScoreFactor(const RefreshRate& refreshRate) const REQUIRES(mLock);
+
     // The list of refresh rates, indexed by display config ID. This must not change after this
     // object is initialized.
     AllRefreshRatesMapType mRefreshRates;
@@ -348,6 +378,11 @@ private:
     Policy mDisplayManagerPolicy GUARDED_BY(mLock);
     std::optional<Policy> mOverridePolicy GUARDED_BY(mLock);
 
+    // The thermal headroom currently applied to refresh rate scoring. Set by
+    // SurfaceFlinger on behalf of the thermal service, and read during refresh rate
+    // selection. 1.0 means no thermal throttling.
+    float mThermalHeadroom GUARDED_BY(mLock) = 1.0f;
+
     // The min and max refresh rates supported by the device.
     // This will not change at runtime.
     const RefreshRate* mMinSupportedRefreshRate;
@@ -358,6 +393,21 @@ private:
     // A sorted list of known frame rates that a Heuristic layer will choose
     // from based on the closest value.
     const std::vector<float> mKnownFrameRates;
+
+    // Memoization of the last getBestRefreshRate() call: repeated calls with an identical
+    // set of layer votes and global signals are answered from the cache. Invalidated
+    // whenever the policy changes.
+    struct GetBestRefreshRateCache {
+        std::pair<std::vector<LayerRequirement>, GlobalSignals> arguments;
+        const RefreshRate* bestRefreshRate;
+        GlobalSignals outSignalsConsidered;
+    };
+    mutable std::optional<GetBestRefreshRateCache> mGetBestRefreshRateCache GUARDED_BY(mLock);
+
+    // getDisplayFrames() results precomputed at construction for each known layer frame
+    // rate against each config's vsync period, keyed by {layerPeriod, displayPeriod}.
+    // Immutable after construction.
+    std::map<std::pair<nsecs_t, nsecs_t>, std::pair<nsecs_t, nsecs_t>> mPrecomputedDisplayFrames;
 };
 
 } // namespace android::scheduler
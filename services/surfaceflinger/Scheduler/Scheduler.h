@@ -148,6 +148,10 @@ public:
 
     void setDisplayPowerState(bool normal);
 
+    // Re-evaluates the refresh rate choice after the thermal headroom applied to
+    // RefreshRateConfigs scoring changed.
+    void thermalHeadroomChanged();
+
     void dump(std::string&) const;
     void dump(ConnectionHandle, std::string&) const;
 
@@ -345,6 +345,24 @@ CancelResult VSyncDispatchTimerQueue::cancel(CallbackToken token) {
         callback->disarm();
 
         if (*wakeupTime == mIntendedWakeupTime) {
+            // If another armed entry falls within the slack window of the pending alarm, the
+            // wakeup would group into the same dispatch anyway, so reuse the alarm instead of
+            // programming the timer again.
+            std::optional<nsecs_t> nextArmedWakeup;
+            for (auto const& [token, entry] : mCallbacks) {
+                auto const entryWakeup = entry->wakeupTime();
+                if (!entryWakeup) {
+                    continue;
+                }
+                if (!nextArmedWakeup || *entryWakeup < *nextArmedWakeup) {
+                    nextArmedWakeup = *entryWakeup;
+                }
+            }
+            if (nextArmedWakeup && *nextArmedWakeup >= mIntendedWakeupTime &&
+                *nextArmedWakeup <= mIntendedWakeupTime + mTimerSlack) {
+                return CancelResult::Cancelled;
+            }
+
             mIntendedWakeupTime = kInvalidTime;
             rearmTimer(mTimeKeeper->now());
         }
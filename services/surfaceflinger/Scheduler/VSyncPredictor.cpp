@@ -43,9 +43,12 @@ VSyncPredictor::VSyncPredictor(nsecs_t idealPeriod, size_t historySize,
       : mTraceOn(property_get_bool("debug.sf.vsp_trace", true)),
         kHistorySize(historySize),
         kMinimumSamplesForPrediction(minimumSamplesForPrediction),
+        kMinimumSamplesForRelearnedPrediction(std::max(minimumSamplesForPrediction / 2, size_t(2))),
         kOutlierTolerancePercent(std::min(outlierTolerancePercent, kMaxPercent)),
         mIdealPeriod(idealPeriod) {
     resetModel();
+    mScratchTimestamps.reserve(kHistorySize);
+    mScratchOrdinals.reserve(kHistorySize);
 }
 
 inline void VSyncPredictor::traceInt64If(const char* name, int64_t value) const {
@@ -73,6 +76,20 @@ nsecs_t VSyncPredictor::currentPeriod() const {
     return std::get<0>(mRateMap.find(mIdealPeriod)->second);
 }
 
+bool VSyncPredictor::fitConfident(uint32_t errorPercent) const {
+    // A fit whose worst residual is well inside the outlier tolerance is unlikely to be
+    // improved upon by more samples.
+    return errorPercent * 2 < kOutlierTolerancePercent;
+}
+
+size_t VSyncPredictor::minimumSamplesForPrediction() const {
+    auto const errorIt = mRateModelError.find(mIdealPeriod);
+    if (errorIt != mRateModelError.end() && fitConfident(errorIt->second)) {
+        return kMinimumSamplesForRelearnedPrediction;
+    }
+    return kMinimumSamplesForPrediction;
+}
+
 bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     std::lock_guard<std::mutex> lk(mMutex);
 
@@ -100,7 +117,9 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
         mTimestamps[mLastTimestampIndex] = timestamp;
     }
 
-    if (mTimestamps.size() < kMinimumSamplesForPrediction) {
+    // A rate whose previous fit was confident is refit from fewer samples, so that a rate
+    // switch back to it releases hardware vsync sooner.
+    if (mTimestamps.size() < minimumSamplesForPrediction()) {
         mRateMap[mIdealPeriod] = {mIdealPeriod, 0};
         return true;
     }
@@ -120,8 +139,10 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     //
     // intercept = mean(Y) - slope * mean(X)
     //
-    std::vector<nsecs_t> vsyncTS(mTimestamps.size());
-    std::vector<nsecs_t> ordinals(mTimestamps.size());
+    std::vector<nsecs_t>& vsyncTS = mScratchTimestamps;
+    std::vector<nsecs_t>& ordinals = mScratchOrdinals;
+    vsyncTS.resize(mTimestamps.size());
+    ordinals.resize(mTimestamps.size());
 
     // normalizing to the oldest timestamp cuts down on error in calculating the intercept.
     auto const oldest_ts = *std::min_element(mTimestamps.begin(), mTimestamps.end());
@@ -156,6 +177,7 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
 
     if (CC_UNLIKELY(bottom == 0)) {
         it->second = {mIdealPeriod, 0};
+        mRateModelError.erase(mIdealPeriod);
         clearTimestamps();
         return false;
     }
@@ -166,10 +188,31 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     auto const percent = std::abs(anticipatedPeriod - mIdealPeriod) * kMaxPercent / mIdealPeriod;
     if (percent >= kOutlierTolerancePercent) {
         it->second = {mIdealPeriod, 0};
+        mRateModelError.erase(mIdealPeriod);
         clearTimestamps();
         return false;
     }
 
+    // Record the quality of the fit: the worst residual of the samples against the new model,
+    // as a percent of the ideal period. The values are already mean-subtracted, so the
+    // residual is simply the distance from the fitted line.
+    nsecs_t maxResidual = 0;
+    for (auto i = 0u; i < vsyncTS.size(); i++) {
+        auto const residual =
+                std::abs(vsyncTS[i] - anticipatedPeriod * ordinals[i] / kScalingFactor);
+        maxResidual = std::max(maxResidual, residual);
+    }
+    auto const errorPercent = maxResidual * kMaxPercent / mIdealPeriod;
+    mRateModelError[mIdealPeriod] = errorPercent;
+    traceInt64If("VSP-fitError", errorPercent);
+
+    if (mTimestamps.size() < kMinimumSamplesForPrediction && !fitConfident(errorPercent)) {
+        // An early refit of a relearned rate is not clean enough to publish; keep the ideal
+        // model until the full sample count arrives.
+        it->second = {mIdealPeriod, 0};
+        return true;
+    }
+
     traceInt64If("VSP-period", anticipatedPeriod);
     traceInt64If("VSP-intercept", intercept);
 
@@ -228,12 +271,22 @@ std::tuple<nsecs_t, nsecs_t> VSyncPredictor::getVSyncPredictionModel(
     return mRateMap.find(mIdealPeriod)->second;
 }
 
+std::optional<uint32_t> VSyncPredictor::getVSyncPredictionModelError() const {
+    std::lock_guard<std::mutex> lk(mMutex);
+    auto const it = mRateModelError.find(mIdealPeriod);
+    if (it == mRateModelError.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
 void VSyncPredictor::setPeriod(nsecs_t period) {
     ATRACE_CALL();
 
     std::lock_guard<std::mutex> lk(mMutex);
     static constexpr size_t kSizeLimit = 30;
     if (CC_UNLIKELY(mRateMap.size() == kSizeLimit)) {
+        mRateModelError.erase(mRateMap.begin()->first);
         mRateMap.erase(mRateMap.begin());
     }
 
@@ -261,12 +314,13 @@ void VSyncPredictor::clearTimestamps() {
 
 bool VSyncPredictor::needsMoreSamples() const {
     std::lock_guard<std::mutex> lk(mMutex);
-    return mTimestamps.size() < kMinimumSamplesForPrediction;
+    return mTimestamps.size() < minimumSamplesForPrediction();
 }
 
 void VSyncPredictor::resetModel() {
     std::lock_guard<std::mutex> lk(mMutex);
     mRateMap[mIdealPeriod] = {mIdealPeriod, 0};
+    mRateModelError.erase(mIdealPeriod);
     clearTimestamps();
 }
 
@@ -276,9 +330,14 @@ void VSyncPredictor::dump(std::string& result) const {
     StringAppendF(&result, "\tRefresh Rate Map:\n");
     for (const auto& [idealPeriod, periodInterceptTuple] : mRateMap) {
         StringAppendF(&result,
-                      "\t\tFor ideal period %.2fms: period = %.2fms, intercept = %" PRId64 "\n",
+                      "\t\tFor ideal period %.2fms: period = %.2fms, intercept = %" PRId64,
                       idealPeriod / 1e6f, std::get<0>(periodInterceptTuple) / 1e6f,
                       std::get<1>(periodInterceptTuple));
+        auto const errorIt = mRateModelError.find(idealPeriod);
+        if (errorIt != mRateModelError.end()) {
+            StringAppendF(&result, ", error = %u%%", errorIt->second);
+        }
+        result.append("\n");
     }
 }
 
@@ -59,6 +59,12 @@ public:
 
     std::tuple<nsecs_t /* slope */, nsecs_t /* intercept */> getVSyncPredictionModel() const;
 
+    /* Query the quality of the last computed model for the current ideal period.
+     * \return  The worst residual of the samples against the model, as a percent of the ideal
+     * period, or std::nullopt if no model has been computed for the current period yet.
+     */
+    std::optional<uint32_t> getVSyncPredictionModelError() const;
+
     void dump(std::string& result) const final;
 
 private:
@@ -71,11 +77,16 @@ private:
 
     size_t const kHistorySize;
     size_t const kMinimumSamplesForPrediction;
+    // A rate whose last fit was confident can be relearned from fewer samples after a rate
+    // switch, letting the scheduler turn hardware vsync off sooner.
+    size_t const kMinimumSamplesForRelearnedPrediction;
     size_t const kOutlierTolerancePercent;
 
     std::mutex mutable mMutex;
     size_t next(int i) const REQUIRES(mMutex);
     bool validate(nsecs_t timestamp) const REQUIRES(mMutex);
+    bool fitConfident(uint32_t errorPercent) const;
+    size_t minimumSamplesForPrediction() const REQUIRES(mMutex);
     std::tuple<nsecs_t, nsecs_t> getVSyncPredictionModel(std::lock_guard<std::mutex> const&) const
             REQUIRES(mMutex);
 
@@ -84,8 +95,17 @@ private:
 
     std::unordered_map<nsecs_t, std::tuple<nsecs_t, nsecs_t>> mutable mRateMap GUARDED_BY(mMutex);
 
+    // Worst residual of the last accepted fit for each ideal period, as a percent of the
+    // period. Entries are erased when the model for the rate is reset or invalidated.
+    std::unordered_map<nsecs_t, uint32_t> mRateModelError GUARDED_BY(mMutex);
+
     int mLastTimestampIndex GUARDED_BY(mMutex) = 0;
     std::vector<nsecs_t> mTimestamps GUARDED_BY(mMutex);
+
+    // Scratch space for the regression, kept as members so the per-hwvsync refit does not
+    // allocate.
+    std::vector<nsecs_t> mScratchTimestamps GUARDED_BY(mMutex);
+    std::vector<nsecs_t> mScratchOrdinals GUARDED_BY(mMutex);
 };
 
 } // namespace android::scheduler
@@ -32,6 +32,7 @@
 #include <android/native_window.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
+#include <binder/MemoryHeapBase.h>
 #include <binder/PermissionCache.h>
 #include <compositionengine/CompositionEngine.h>
 #include <compositionengine/CompositionRefreshArgs.h>
@@ -43,6 +44,7 @@
 #include <compositionengine/RenderSurface.h>
 #include <compositionengine/impl/OutputCompositionState.h>
 #include <configstore/Utils.h>
+#include <cutils/ashmem.h>
 #include <cutils/compiler.h>
 #include <cutils/properties.h>
 #include <dlfcn.h>
@@ -50,6 +52,7 @@
 #include <errno.h>
 #include <gui/BufferQueue.h>
 #include <gui/DebugEGLImageTracker.h>
+#include <gui/DisplayConfigTable.h>
 #include <gui/GuiConfig.h>
 #include <gui/IDisplayEventConnection.h>
 #include <gui/IProducerListener.h>
@@ -64,6 +67,7 @@
 #include <private/gui/SyncFeatures.h>
 #include <renderengine/RenderEngine.h>
 #include <statslog.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fstream>
@@ -73,6 +77,7 @@
 #include <ui/DisplayInfo.h>
 #include <ui/DisplayStatInfo.h>
 #include <ui/DisplayState.h>
+#include <ui/FatVector.h>
 #include <ui/GraphicBufferAllocator.h>
 #include <ui/PixelFormat.h>
 #include <ui/UiConfig.h>
@@ -88,7 +93,9 @@
 #include <cmath>
 #include <cstdint>
 #include <functional>
+#include <future>
 #include <mutex>
+#include <new>
 #include <optional>
 #include <unordered_map>
 
@@ -120,6 +127,7 @@
 #include "Scheduler/EventThread.h"
 #include "Scheduler/LayerHistory.h"
 #include "Scheduler/MessageQueue.h"
+#include "Scheduler/PhaseOffsetTuner.h"
 #include "Scheduler/PhaseOffsets.h"
 #include "Scheduler/Scheduler.h"
 #include "StartPropertySetThread.h"
@@ -308,6 +316,7 @@ uint64_t SurfaceFlinger::maxVirtualDisplaySize;
 bool SurfaceFlinger::hasSyncFramework;
 bool SurfaceFlinger::useVrFlinger;
 int64_t SurfaceFlinger::maxFrameBufferAcquiredBuffers;
+int64_t SurfaceFlinger::clientTargetBufferDepth;
 uint32_t SurfaceFlinger::maxGraphicsWidth;
 uint32_t SurfaceFlinger::maxGraphicsHeight;
 bool SurfaceFlinger::hasWideColorDisplay;
@@ -457,6 +466,7 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
     useVrFlinger = use_vr_flinger(false);
 
     maxFrameBufferAcquiredBuffers = max_frame_buffer_acquired_buffers(2);
+    clientTargetBufferDepth = maxFrameBufferAcquiredBuffers;
 
     maxGraphicsWidth = std::max(max_graphics_width(0), 0);
     maxGraphicsHeight = std::max(max_graphics_height(0), 0);
@@ -559,6 +569,34 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
     property_get("debug.sf.disable_client_composition_cache", value, "0");
     mDisableClientCompositionCache = atoi(value);
 
+    property_get("debug.sf.client_target_buffer_depth", value, "0");
+    if (const int depth = atoi(value); depth > 0) {
+        clientTargetBufferDepth = std::clamp(depth, 2, 4);
+        ALOGI_IF(clientTargetBufferDepth != maxFrameBufferAcquiredBuffers,
+                 "Client target buffer depth overridden to %" PRId64, clientTargetBufferDepth);
+    }
+
+    property_get("debug.sf.enable_parallel_latch", value, "0");
+    mParallelLatchEnabled = atoi(value);
+    ALOGI_IF(mParallelLatchEnabled, "Enabling parallel buffer latching");
+
+    property_get("debug.sf.enable_frame_rate_throttling", value, "0");
+    mFrameRateThrottlingEnabled = atoi(value);
+    ALOGI_IF(mFrameRateThrottlingEnabled, "Enabling per-layer frame rate throttling");
+
+    mDisplayConfigTableHeap = new MemoryHeapBase(sizeof(DisplayConfigTable),
+                                                 MemoryHeapBase::READ_ONLY,
+                                                 "SurfaceFlinger display configs");
+    if (mDisplayConfigTableHeap->getBase() != MAP_FAILED) {
+        const auto table = new (mDisplayConfigTableHeap->getBase()) DisplayConfigTable;
+        table->version = DisplayConfigTable::kVersion;
+        table->seq.store(0, std::memory_order_relaxed);
+        table->numDisplays = 0;
+    } else {
+        ALOGE("Failed to allocate the display config table heap");
+        mDisplayConfigTableHeap.clear();
+    }
+
     char property[PROPERTY_VALUE_MAX] = {0};
     if((property_get("vendor.display.vsync_reliable_on_doze", property, "0") > 0) &&
         (!strncmp(property, "1", PROPERTY_VALUE_MAX ) ||
@@ -899,13 +937,34 @@ void SurfaceFlinger::init() {
             "Initializing graphics H/W...");
     Mutex::Autolock _l(mStateLock);
 
+    // Stamp each init phase so cold boot regressions can be attributed from
+    // dumpsys instead of a rebuild with manual logs. The phase is also
+    // published as a service.sf.boottime property for boot tooling.
+    nsecs_t initPhaseStart = systemTime();
+    const nsecs_t initStart = initPhaseStart;
+    const auto recordInitPhase = [this, &initPhaseStart](const char* name) {
+        const nsecs_t now = systemTime();
+        mInitPhases.push_back({name, now - initPhaseStart});
+        char value[PROPERTY_VALUE_MAX];
+        snprintf(value, sizeof(value), "%" PRId64, ns2ms(now - initPhaseStart));
+        std::string key = std::string("service.sf.boottime.") + name;
+        property_set(key.c_str(), value);
+        initPhaseStart = now;
+    };
+
+    // Connecting to the Composer HAL is independent of RenderEngine setup,
+    // and both block for tens of milliseconds on cold boot, so overlap them.
+    auto hwComposer = std::async(std::launch::async, [this] {
+        return getFactory().createHWComposer(getBE().mHwcServiceName);
+    });
+
     // Get a RenderEngine for the given display / config (can't fail)
     // TODO(b/77156734): We need to stop casting and use HAL types when possible.
-    // Sending maxFrameBufferAcquiredBuffers as the cache size is tightly tuned to single-display.
+    // Sending clientTargetBufferDepth as the cache size is tightly tuned to single-display.
     mCompositionEngine->setRenderEngine(renderengine::RenderEngine::create(
             renderengine::RenderEngineCreationArgs::Builder()
                 .setPixelFormat(static_cast<int32_t>(defaultCompositionPixelFormat))
-                .setImageCacheSize(maxFrameBufferAcquiredBuffers)
+                .setImageCacheSize(clientTargetBufferDepth)
                 .setUseColorManagerment(useColorManagement)
                 .setEnableProtectedContext(enable_protected_contents(false))
                 .setPrecacheToneMapperShaderOnly(false)
@@ -915,17 +974,25 @@ void SurfaceFlinger::init() {
                         : renderengine::RenderEngine::ContextPriority::MEDIUM)
                 .build()));
     mCompositionEngine->setTimeStats(mTimeStats);
+    // Schedule post-render cleanup as soon as the GPU finishes the previous frame's
+    // work, rather than deferring it to the start of the next composition.
+    getRenderEngine().setCleanupCallback([this] {
+        static_cast<void>(schedule([this] { getRenderEngine().cleanupPostRender(); }));
+    });
+    recordInitPhase("renderengine");
 
     LOG_ALWAYS_FATAL_IF(mVrFlingerRequestsDisplay,
             "Starting with vr flinger active is not currently supported.");
-    mCompositionEngine->setHwComposer(getFactory().createHWComposer(getBE().mHwcServiceName));
+    mCompositionEngine->setHwComposer(hwComposer.get());
     mCompositionEngine->getHwComposer().setConfiguration(this, getBE().mComposerSequenceId);
+    recordInitPhase("composer_hal");
     // Process any initial hotplug and resulting display changes.
     processDisplayHotplugEventsLocked();
     const auto display = getDefaultDisplayDeviceLocked();
     LOG_ALWAYS_FATAL_IF(!display, "Missing internal display after registering composer callback.");
     LOG_ALWAYS_FATAL_IF(!getHwComposer().isConnected(*display->getId()),
                         "Internal display is disconnected.");
+    recordInitPhase("display_bootstrap");
 #ifdef QTI_DISPLAY_CONFIG_ENABLED
     if (!mDisplayConfigIntf) {
         ALOGE("DisplayConfig HIDL not present\n");
@@ -965,12 +1032,14 @@ void SurfaceFlinger::init() {
 
     // set initial conditions (e.g. unblank default device)
     initializeDisplays();
+    recordInitPhase("initialize_displays");
 
     char primeShaderCache[PROPERTY_VALUE_MAX];
     property_get("service.sf.prime_shader_cache", primeShaderCache, "1");
     if (atoi(primeShaderCache)) {
         getRenderEngine().primeCache();
     }
+    recordInitPhase("prime_shader_cache");
 
     // Inform native graphics APIs whether the present timestamp is supported:
 
@@ -1032,6 +1101,13 @@ void SurfaceFlinger::init() {
 
         createPhaseOffsetExtn();
     }
+    recordInitPhase("vendor_extensions");
+
+    const nsecs_t initTotal = systemTime() - initStart;
+    for (const InitPhase& phase : mInitPhases) {
+        ALOGI("init phase %s took %" PRId64 " ms", phase.name, ns2ms(phase.durationNs));
+    }
+    ALOGI("init took %" PRId64 " ms in total", ns2ms(initTotal));
     ALOGV("Done initializing");
 }
 
@@ -1170,7 +1246,11 @@ status_t SurfaceFlinger::getDisplayConfigs(const sp<IBinder>& displayToken,
     }
 
     Mutex::Autolock lock(mStateLock);
+    return getDisplayConfigsLocked(displayToken, configs);
+}
 
+status_t SurfaceFlinger::getDisplayConfigsLocked(const sp<IBinder>& displayToken,
+                                                 Vector<DisplayConfig>* configs) {
     const auto displayId = getPhysicalDisplayIdLocked(displayToken);
     if (!displayId) {
         return NAME_NOT_FOUND;
@@ -1234,6 +1314,62 @@ status_t SurfaceFlinger::getDisplayConfigs(const sp<IBinder>& displayToken,
     return NO_ERROR;
 }
 
+status_t SurfaceFlinger::getDisplayConfigTable(sp<IMemoryHeap>* outHeap) {
+    if (!outHeap) {
+        return BAD_VALUE;
+    }
+    if (mDisplayConfigTableHeap == nullptr) {
+        return NO_MEMORY;
+    }
+    *outHeap = mDisplayConfigTableHeap;
+    return NO_ERROR;
+}
+
+void SurfaceFlinger::updateDisplayConfigTableLocked() {
+    if (mDisplayConfigTableHeap == nullptr) {
+        return;
+    }
+    const auto table = static_cast<DisplayConfigTable*>(mDisplayConfigTableHeap->getBase());
+
+    // Seqlock write: bump to an odd value, rewrite the payload, bump back to
+    // even. Readers retry while the sequence is odd or changes under them.
+    const uint32_t seq = table->seq.load(std::memory_order_relaxed);
+    table->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint32_t numDisplays = 0;
+    for (const auto& [id, token] : mPhysicalDisplayTokens) {
+        if (numDisplays >= DisplayConfigTable::kMaxDisplays) {
+            ALOGW("Too many physical displays to publish in the config table");
+            break;
+        }
+
+        const auto display = getDisplayDeviceLocked(token);
+        if (!display) {
+            // The display device is created a transaction after the hotplug;
+            // the table will be refreshed again once it exists.
+            continue;
+        }
+
+        Vector<DisplayConfig> configs;
+        if (getDisplayConfigsLocked(token, &configs) != NO_ERROR) {
+            continue;
+        }
+
+        auto& entry = table->displays[numDisplays++];
+        entry.displayId = id.value;
+        entry.activeConfig = display->getActiveConfig().value();
+        entry.numConfigs = std::min(configs.size(), DisplayConfigTable::kMaxConfigs);
+        for (size_t i = 0; i < entry.numConfigs; i++) {
+            entry.configs[i] = configs[i];
+        }
+    }
+    table->numDisplays = numDisplays;
+
+    std::atomic_thread_fence(std::memory_order_release);
+    table->seq.store(seq + 2, std::memory_order_release);
+}
+
 status_t SurfaceFlinger::getDisplayStats(const sp<IBinder>&, DisplayStatInfo* stats) {
     if (!stats) {
         return BAD_VALUE;
@@ -1243,6 +1379,15 @@ status_t SurfaceFlinger::getDisplayStats(const sp<IBinder>&, DisplayStatInfo* st
     return NO_ERROR;
 }
 
+status_t SurfaceFlinger::getCompositionStats(CompositionStats* outStats) {
+    if (!outStats) {
+        return BAD_VALUE;
+    }
+
+    mCompositionStats.get(outStats);
+    return NO_ERROR;
+}
+
 int SurfaceFlinger::getActiveConfig(const sp<IBinder>& displayToken) {
     int activeConfig;
     bool isPrimary;
@@ -1374,6 +1519,8 @@ void SurfaceFlinger::setActiveConfigInternal() {
         mScheduler->onPrimaryDisplayConfigChanged(mAppConnectionHandle, display->getId()->value,
                                                   mUpcomingActiveConfig.configId, vsyncPeriod);
     }
+
+    updateDisplayConfigTableLocked();
 }
 
 void SurfaceFlinger::desiredActiveConfigChangeDone() {
@@ -1741,6 +1888,75 @@ status_t SurfaceFlinger::getDisplayedContentSample(const sp<IBinder>& displayTok
     return getHwComposer().getDisplayedContentSample(*displayId, maxFrames, timestamp, outStats);
 }
 
+status_t SurfaceFlinger::getDisplayedContentSampleStream(const sp<IBinder>& displayToken,
+                                                         base::unique_fd* outFd) {
+    if (!displayToken || !outFd) {
+        return BAD_VALUE;
+    }
+
+    std::optional<DisplayId> displayId;
+    {
+        Mutex::Autolock lock(mStateLock);
+        displayId = getPhysicalDisplayIdLocked(displayToken);
+    }
+    if (!displayId) {
+        return NAME_NOT_FOUND;
+    }
+
+    std::lock_guard lock(mSampleStreamMutex);
+    ContentSampleStream& stream = mContentSampleStreams[*displayId];
+    if (stream.buffer == nullptr) {
+        base::unique_fd fd(ashmem_create_region("DisplayedContentSampleStream",
+                                                sizeof(DisplayedContentSampleStream)));
+        if (!fd.ok()) {
+            ALOGE("getDisplayedContentSampleStream: ashmem_create_region failed: %s",
+                  strerror(errno));
+            mContentSampleStreams.erase(*displayId);
+            return NO_MEMORY;
+        }
+        void* base = mmap(nullptr, sizeof(DisplayedContentSampleStream), PROT_READ | PROT_WRITE,
+                          MAP_SHARED, fd.get(), 0);
+        if (base == MAP_FAILED) {
+            ALOGE("getDisplayedContentSampleStream: mmap failed: %s", strerror(errno));
+            mContentSampleStreams.erase(*displayId);
+            return NO_MEMORY;
+        }
+        // We keep the writable mapping made above; restricting the region to PROT_READ
+        // now means clients receiving the fd can only map it read-only.
+        if (ashmem_set_prot_region(fd.get(), PROT_READ) != 0) {
+            ALOGE("getDisplayedContentSampleStream: ashmem_set_prot_region failed: %s",
+                  strerror(errno));
+            munmap(base, sizeof(DisplayedContentSampleStream));
+            mContentSampleStreams.erase(*displayId);
+            return NO_MEMORY;
+        }
+        stream.fd = std::move(fd);
+        stream.buffer = new (base) DisplayedContentSampleStream();
+    }
+
+    outFd->reset(dup(stream.fd.get()));
+    if (!outFd->ok()) {
+        return NO_MEMORY;
+    }
+    return NO_ERROR;
+}
+
+void SurfaceFlinger::publishContentSampleStreams() {
+    std::lock_guard lock(mSampleStreamMutex);
+    if (mContentSampleStreams.empty()) {
+        return;
+    }
+    for (auto& [displayId, stream] : mContentSampleStreams) {
+        DisplayedFrameStats stats;
+        // maxFrames = 0 and timestamp = 0 request the full sample accumulated since
+        // sampling was enabled; clients diff successive snapshots if they want deltas.
+        if (getHwComposer().getDisplayedContentSample(displayId, 0, 0, &stats) != NO_ERROR) {
+            continue;
+        }
+        stream.buffer->publish(stats, systemTime());
+    }
+}
+
 status_t SurfaceFlinger::getProtectedContentSupport(bool* outSupported) const {
     if (!outSupported) {
         return BAD_VALUE;
@@ -1856,7 +2072,7 @@ status_t SurfaceFlinger::setDisplayBrightness(const sp<IBinder>& displayToken, f
                    return promise::yield<status_t>(NAME_NOT_FOUND);
                }
            }))
-            .then([](std::future<status_t> task) { return task; })
+            .then([](promise::Future<status_t> task) { return task; })
             .get();
 }
 
@@ -2281,6 +2497,10 @@ void SurfaceFlinger::onMessageInvalidate(nsecs_t expectedVSyncTime) {
         mExpectedPresentTime = mScheduler->getDispSyncExpectedPresentTime(frameStart);
     }
 
+    // Issue the token for this frame; the stages that follow (latch,
+    // refresh, present) are recorded against it.
+    mFrameTimeline.beginFrame(mExpectedPresentTime);
+
     const nsecs_t lastScheduledPresentTime = mScheduledPresentTime;
     mScheduledPresentTime = expectedVSyncTime;
 
@@ -2335,6 +2555,15 @@ void SurfaceFlinger::onMessageInvalidate(nsecs_t expectedVSyncTime) {
     if (gpuFrameMissed) {
         mGpuFrameMissedCount++;
     }
+    mPowerAdvisor.setGpuFrameMissed(gpuFrameMissed);
+
+    if (mPhaseOffsetTuner &&
+        mPhaseOffsetTuner->onFrameCompleted(mRefreshRateConfigs->getCurrentRefreshRate().getFps(),
+                                            stats.vsyncPeriod, frameMissed)) {
+        std::lock_guard<std::mutex> lock(mActiveConfigLock);
+        mPhaseConfiguration->UpdateSfOffsets(mPhaseOffsetTuner->getTunedSfOffsets());
+        mVSyncModulator->setPhaseOffsets(mPhaseConfiguration->getCurrentOffsets());
+    }
 
     // If we are in the middle of a config change and the fence hasn't
     // fired yet just wait for the next invalidate
@@ -2440,8 +2669,11 @@ void SurfaceFlinger::onMessageInvalidate(nsecs_t expectedVSyncTime) {
     {
         ConditionalLockGuard<std::mutex> lock(mTracingLock, mTracingEnabled);
 
+        const nsecs_t latchStart = systemTime();
         refreshNeeded = handleMessageTransaction();
         refreshNeeded |= handleMessageInvalidate();
+        mCompositionStats.recordDuration(CompositionStats::STAGE_LATCH,
+                                         systemTime() - latchStart);
         if (mTracingEnabled) {
             mAddCompositionStateToTrace =
                     mTracing.flagIsSetLocked(SurfaceTracing::TRACE_COMPOSITION);
@@ -2514,6 +2746,9 @@ bool SurfaceFlinger::handleMessageTransaction() {
 void SurfaceFlinger::onMessageRefresh() {
     ATRACE_CALL();
 
+    const nsecs_t refreshStart = systemTime();
+    mFrameTimeline.recordRefreshStart();
+
     mRefreshPending = false;
 
     compositionengine::CompositionRefreshArgs refreshArgs;
@@ -2542,6 +2777,7 @@ void SurfaceFlinger::onMessageRefresh() {
     refreshArgs.updatingOutputGeometryThisFrame = mVisibleRegionsDirty;
     refreshArgs.updatingGeometryThisFrame = mGeometryInvalid || mVisibleRegionsDirty;
     refreshArgs.blursAreExpensive = mBlursAreExpensive;
+    refreshArgs.reduceCompositionEffort = mPowerAdvisor.shouldReduceCompositionEffort();
     refreshArgs.internalDisplayRotationFlags = DisplayDevice::getPrimaryDisplayRotationFlags();
 
     if (CC_UNLIKELY(mDrawingState.colorMatrixChanged)) {
@@ -2570,16 +2806,26 @@ void SurfaceFlinger::onMessageRefresh() {
         }
     }
 
+    const nsecs_t compositeStart = systemTime();
+    mCompositionStats.recordDuration(CompositionStats::STAGE_PREPARE,
+                                     compositeStart - refreshStart);
+
     mCompositionEngine->present(refreshArgs);
 
+    mCompositionStats.recordDuration(CompositionStats::STAGE_COMPOSITE,
+                                     systemTime() - compositeStart);
+
     mTimeStats->recordFrameDuration(mFrameStartTime, systemTime());
     // Reset the frame start time now that we've recorded this frame.
     mFrameStartTime = 0;
 
     mScheduler->onDisplayRefreshed(presentTime);
 
+    const nsecs_t postCompositionStart = systemTime();
     postFrame();
     postComposition();
+    mCompositionStats.recordDuration(CompositionStats::STAGE_PRESENT,
+                                     systemTime() - postCompositionStart);
 
     const bool prevFrameHadDeviceComposition = mHadDeviceComposition;
 
@@ -2727,6 +2973,7 @@ void SurfaceFlinger::postComposition()
         getHwComposer().getPresentFence(*vSyncSource->getId()) : Fence::NO_FENCE;
     auto presentFenceTime = std::make_shared<FenceTime>(mPreviousPresentFences[0]);
     getBE().mDisplayTimeline.push(presentFenceTime);
+    mFrameTimeline.recordPresentQueued(presentFenceTime);
 
     DisplayStatInfo stats;
     mScheduler->getDisplayStatInfo(&stats);
@@ -2888,6 +3135,8 @@ void SurfaceFlinger::postComposition()
     }
 
 
+    publishContentSampleStreams();
+
     // Even though ATRACE_INT64 already checks if tracing is enabled, it doesn't prevent the
     // side-effect of getTotalSize(), so we check that again here
     if (ATRACE_ENABLED()) {
@@ -3176,7 +3425,7 @@ sp<DisplayDevice> SurfaceFlinger::setupNewDisplayDeviceInternal(
 
     sp<DisplayDevice> display = getFactory().createDisplayDevice(creationArgs);
 
-    if (maxFrameBufferAcquiredBuffers >= 3) {
+    if (clientTargetBufferDepth >= 3) {
         nativeWindowSurface->preallocateBuffers();
     }
 
@@ -3473,6 +3722,8 @@ void SurfaceFlinger::processDisplayChangesLocked() {
                 processDisplayAdded(displayToken, curr[i]);
             }
         }
+
+        updateDisplayConfigTableLocked();
     }
 
     mDrawingState.displays = mCurrentState.displays;
@@ -3694,6 +3945,13 @@ void SurfaceFlinger::initScheduler(DisplayId primaryDisplayId) {
 
     mPhaseConfiguration = getFactory().createPhaseConfiguration(*mRefreshRateConfigs);
 
+    // The tuner only knows how to adjust offsets, so leave it off when the
+    // phase configuration is duration-based.
+    if (property_get_bool("debug.sf.auto_tune_phase_offsets", false) &&
+        !property_get_bool("debug.sf.use_phase_offsets_as_durations", false)) {
+        mPhaseOffsetTuner = std::make_unique<scheduler::PhaseOffsetTuner>(*mPhaseConfiguration);
+    }
+
     // start the EventThread
     mScheduler =
             getFactory().createScheduler([this](bool enabled) { setVsyncEnabled(enabled); },
@@ -3776,6 +4034,10 @@ void SurfaceFlinger::commitTransactionLocked() {
 
     commitOffscreenLayers();
     mDrawingState.traverse([&](Layer* layer) { layer->updateMirrorInfo(); });
+
+    // Re-flatten the drawing-state traversal while mStateLock is still held,
+    // so per-frame traversals and dump threads only ever read the cache.
+    mDrawingState.flattenZOrder();
 }
 
 void SurfaceFlinger::commitOffscreenLayers() {
@@ -3856,15 +4118,69 @@ bool SurfaceFlinger::handlePageFlip()
         // writes to Layer current state. See also b/119481871
         Mutex::Autolock lock(mStateLock);
 
-        for (auto& layer : mLayersWithQueuedFrames) {
-            if (layer->latchBuffer(visibleRegions, latchTime, expectedPresentTime)) {
-                mLayersPendingRefresh.push_back(layer);
+        // With many independent producers updating at once (video walls,
+        // camera grids) the per-layer fence and consumer work adds up, so
+        // spread the latches over a transient worker pool.  Each layer in
+        // the list is distinct, so a latch only touches its own consumer
+        // state; flinger-wide side effects (TimeStats, FrameTracer,
+        // client cache) take their own locks, and EGLImage creation is
+        // already funneled through RenderEngine's ImageManager thread.
+        const size_t layerCount = mLayersWithQueuedFrames.size();
+        if (mParallelLatchEnabled && layerCount >= kMinLayersForParallelLatch) {
+            const unsigned hwThreads = std::thread::hardware_concurrency();
+            const size_t workerCount =
+                    std::min(layerCount, static_cast<size_t>(hwThreads > 0 ? hwThreads : 4));
+            std::vector<uint8_t> latched(layerCount, 0);
+            std::atomic<size_t> nextLayer(0);
+            std::atomic<bool> visibleRegionsChanged(false);
+            const auto latchWork = [&] {
+                size_t i;
+                while ((i = nextLayer.fetch_add(1)) < layerCount) {
+                    const sp<Layer>& layer = mLayersWithQueuedFrames[i];
+                    bool layerVisibleRegions = false;
+                    if (layer->latchBuffer(layerVisibleRegions, latchTime, expectedPresentTime)) {
+                        latched[i] = 1;
+                    }
+                    if (layerVisibleRegions) {
+                        visibleRegionsChanged = true;
+                    }
+                    layer->useSurfaceDamage();
+                }
+            };
+            std::vector<std::thread> workers;
+            workers.reserve(workerCount - 1);
+            for (size_t i = 1; i < workerCount; i++) {
+                workers.emplace_back(latchWork);
+            }
+            latchWork();
+            for (auto& worker : workers) {
+                worker.join();
             }
-            layer->useSurfaceDamage();
-            if (layer->isBufferLatched()) {
-                newDataLatched = true;
+            visibleRegions |= visibleRegionsChanged.load();
+            // Aggregate in list order so downstream processing stays
+            // deterministic regardless of which worker latched what.
+            for (size_t i = 0; i < layerCount; i++) {
+                const sp<Layer>& layer = mLayersWithQueuedFrames[i];
+                if (latched[i]) {
+                    mLayersPendingRefresh.push_back(layer);
+                }
+                if (layer->isBufferLatched()) {
+                    newDataLatched = true;
+                }
+            }
+        } else {
+            for (auto& layer : mLayersWithQueuedFrames) {
+                if (layer->latchBuffer(visibleRegions, latchTime, expectedPresentTime)) {
+                    mLayersPendingRefresh.push_back(layer);
+                }
+                layer->useSurfaceDamage();
+                if (layer->isBufferLatched()) {
+                    newDataLatched = true;
+                }
             }
         }
+
+        mFrameTimeline.recordLatch(mLayersWithQueuedFrames.size());
     }
 
     mVisibleRegionsDirty |= visibleRegions;
@@ -4009,9 +4325,20 @@ bool SurfaceFlinger::flushTransactionQueues() {
 
             while (!transactionQueue.empty()) {
                 const auto& transaction = transactionQueue.front();
-                if (!transactionIsReadyToBeApplied(transaction.desiredPresentTime,
-                                                   transaction.states)) {
-                    setTransactionFlags(eTransactionFlushNeeded);
+                const bool timeIsDue = desiredPresentTimeIsDue(transaction.desiredPresentTime);
+                // The watcher decrements the counter as acquire fences signal, so
+                // testing fence readiness costs one atomic load instead of a
+                // getStatus syscall per fence per frame.
+                const bool fencesAreReady = transaction.unsignaledFenceCount == nullptr ||
+                        transaction.unsignaledFenceCount->load() == 0;
+                if (!timeIsDue || !fencesAreReady) {
+                    if (!timeIsDue) {
+                        // Time-based readiness must be re-evaluated against the next
+                        // frame's expected present time.  Fence-based readiness needs
+                        // no re-arm here: the watcher sets the flush flag itself when
+                        // the last fence signals.
+                        setTransactionFlags(eTransactionFlushNeeded);
+                    }
                     break;
                 }
                 transactions.push_back(transaction);
@@ -4040,14 +4367,17 @@ bool SurfaceFlinger::transactionFlushNeeded() {
 }
 
 
-bool SurfaceFlinger::transactionIsReadyToBeApplied(int64_t desiredPresentTime,
-                                                   const Vector<ComposerState>& states) {
-
+bool SurfaceFlinger::desiredPresentTimeIsDue(int64_t desiredPresentTime) const {
     const nsecs_t expectedPresentTime = mExpectedPresentTime.load();
     // Do not present if the desiredPresentTime has not passed unless it is more than one second
     // in the future. We ignore timestamps more than 1 second in the future for stability reasons.
-    if (desiredPresentTime >= 0 && desiredPresentTime >= expectedPresentTime &&
-        desiredPresentTime < expectedPresentTime + s2ns(1)) {
+    return !(desiredPresentTime >= 0 && desiredPresentTime >= expectedPresentTime &&
+             desiredPresentTime < expectedPresentTime + s2ns(1));
+}
+
+bool SurfaceFlinger::transactionIsReadyToBeApplied(int64_t desiredPresentTime,
+                                                   const Vector<ComposerState>& states) {
+    if (!desiredPresentTimeIsDue(desiredPresentTime)) {
         return false;
     }
 
@@ -4063,6 +4393,25 @@ bool SurfaceFlinger::transactionIsReadyToBeApplied(int64_t desiredPresentTime,
     return true;
 }
 
+void SurfaceFlinger::watchTransactionFences(TransactionState& transaction) {
+    std::vector<sp<Fence>> fences;
+    for (const ComposerState& state : transaction.states) {
+        const layer_state_t& s = state.state;
+        if (!(s.what & layer_state_t::eAcquireFenceChanged) || s.acquireFence == nullptr) {
+            continue;
+        }
+        fences.push_back(s.acquireFence);
+    }
+    if (fences.empty()) {
+        return;
+    }
+    transaction.unsignaledFenceCount = mTransactionFenceWatcher.watch(fences, [this] {
+        // The transaction's last acquire fence signaled; have the main thread revisit
+        // the queues.
+        setTransactionFlags(eTransactionFlushNeeded);
+    });
+}
+
 void SurfaceFlinger::setTransactionState(
         const Vector<ComposerState>& states, const Vector<DisplayState>& displays, uint32_t flags,
         const sp<IBinder>& applyToken, const InputWindowCommands& inputWindowCommands,
@@ -4104,9 +4453,10 @@ void SurfaceFlinger::setTransactionState(
     }
 
     if (pendingTransactions || !transactionIsReadyToBeApplied(desiredPresentTime, states)) {
-        mTransactionQueues[applyToken].emplace(states, displays, flags, desiredPresentTime,
-                                               uncacheBuffer, postTime, privileged,
-                                               hasListenerCallbacks, listenerCallbacks);
+        auto& queue = mTransactionQueues[applyToken];
+        queue.emplace(states, displays, flags, desiredPresentTime, uncacheBuffer, postTime,
+                      privileged, hasListenerCallbacks, listenerCallbacks);
+        watchTransactionFences(queue.back());
         setTransactionFlags(eTransactionFlushNeeded);
         return;
     }
@@ -5215,6 +5565,7 @@ status_t SurfaceFlinger::doDump(int fd, const DumpArgs& args, bool asProto) {
                 {"--latency"s, argsDumper(&SurfaceFlinger::dumpStatsLocked)},
                 {"--latency-clear"s, argsDumper(&SurfaceFlinger::clearStatsLocked)},
                 {"--list"s, dumper(&SurfaceFlinger::listLayersLocked)},
+                {"--producer-latency"s, dumper(&SurfaceFlinger::dumpProducerLatency)},
                 {"--static-screen"s, dumper(&SurfaceFlinger::dumpStaticScreenStats)},
                 {"--timestats"s, protoDumper(&SurfaceFlinger::dumpTimeStats)},
                 {"--vsync"s, dumper(&SurfaceFlinger::dumpVSync)},
@@ -5452,6 +5803,7 @@ void SurfaceFlinger::appendSfConfigString(std::string& result) const {
     StringAppendF(&result, " RUNNING_WITHOUT_SYNC_FRAMEWORK=%d", !hasSyncFramework);
     StringAppendF(&result, " NUM_FRAMEBUFFER_SURFACE_BUFFERS=%" PRId64,
                   maxFrameBufferAcquiredBuffers);
+    StringAppendF(&result, " CLIENT_TARGET_BUFFER_DEPTH=%" PRId64, clientTargetBufferDepth);
     result.append("]");
 }
 
@@ -5462,6 +5814,9 @@ void SurfaceFlinger::dumpVSync(std::string& result) const {
     result.append("\n");
 
     mPhaseConfiguration->dump(result);
+    if (mPhaseOffsetTuner) {
+        mPhaseOffsetTuner->dump(result);
+    }
     StringAppendF(&result,
                   "      present offset: %9" PRId64 " ns\t     VSYNC period: %9" PRId64 " ns\n\n",
                   dispSyncPresentTimeOffset, getVsyncPeriodFromHWC());
@@ -5503,6 +5858,25 @@ void SurfaceFlinger::dumpStaticScreenStats(std::string& result) const {
                   bucketTimeSec, percent);
 }
 
+void SurfaceFlinger::dumpProducerLatency(std::string& result) const {
+    if (!MonitoredProducer::latencyTracingEnabled()) {
+        result.append("Producer latency tracing is disabled.\n"
+                      "Set debug.sf.producer_latency and restart to enable.\n");
+        return;
+    }
+
+    result.append("Producer call latency (over the most recent calls):\n");
+    for (const auto& weakBinder : mGraphicBufferProducerList) {
+        sp<IBinder> binder = weakBinder.promote();
+        if (binder == nullptr) {
+            continue;
+        }
+        // Entries in mGraphicBufferProducerList are the MonitoredProducers
+        // themselves; see onAsBinder().
+        static_cast<MonitoredProducer*>(binder.get())->dumpLatency(result);
+    }
+}
+
 void SurfaceFlinger::recordBufferingStats(const std::string& layerName,
                                           std::vector<OccupancyTracker::Segment>&& history) {
     Mutex::Autolock lock(getBE().mBufferingStatsMutex);
@@ -5769,12 +6143,26 @@ void SurfaceFlinger::dumpAllLocked(const DumpArgs& args, std::string& result) co
     dumpStaticScreenStats(result);
     result.append("\n");
 
+    mCompositionStats.dump(result);
+    result.append("\n");
+
+    mFrameTimeline.dump(result);
+
+    result.append("Init phases:\n");
+    for (const InitPhase& phase : mInitPhases) {
+        StringAppendF(&result, "  %-20s %4" PRId64 " ms\n", phase.name, ns2ms(phase.durationNs));
+    }
+    result.append("\n");
+
     StringAppendF(&result, "Total missed frame count: %u\n", mFrameMissedCount.load());
     StringAppendF(&result, "HWC missed frame count: %u\n", mHwcFrameMissedCount.load());
     StringAppendF(&result, "GPU missed frame count: %u\n\n", mGpuFrameMissedCount.load());
 
     dumpBufferingStats(result);
 
+    ClientCache::getInstance().dump(result);
+    result.append("\n");
+
     /*
      * Dump the visible layer list
      */
@@ -5901,6 +6289,9 @@ void SurfaceFlinger::dumpAllLocked(const DumpArgs& args, std::string& result) co
 
     result.append(mTimeStats->miniDump());
     result.append("\n");
+
+    result.append(mFrameTracer->miniDump());
+    result.append("\n");
 }
 
 void SurfaceFlinger::updateColorMatrixLocked() {
@@ -5952,8 +6343,10 @@ status_t SurfaceFlinger::CheckTransactCodeCredentials(uint32_t code) {
         case GET_DISPLAYED_CONTENT_SAMPLING_ATTRIBUTES:
         case SET_DISPLAY_CONTENT_SAMPLING_ENABLED:
         case GET_DISPLAYED_CONTENT_SAMPLE:
+        case GET_DISPLAYED_CONTENT_SAMPLE_STREAM:
         case NOTIFY_POWER_HINT:
         case SET_GLOBAL_SHADOW_SETTINGS:
+        case SET_THERMAL_REFRESH_RATE_HEADROOM:
         case ACQUIRE_FRAME_RATE_FLEXIBILITY_TOKEN: {
             // ACQUIRE_FRAME_RATE_FLEXIBILITY_TOKEN is used by CTS tests, which acquire the
             // necessary permission dynamically. Don't use the permission cache for this check.
@@ -5992,6 +6385,7 @@ status_t SurfaceFlinger::CheckTransactCodeCredentials(uint32_t code) {
         case GET_DISPLAY_CONFIGS:
         case GET_DISPLAY_STATE:
         case GET_DISPLAY_STATS:
+        case GET_COMPOSITION_STATS:
         case GET_SUPPORTED_FRAME_TIMESTAMPS:
         // Calling setTransactionState is safe, because you need to have been
         // granted a reference to Client* and Handle* to do anything with it.
@@ -6635,6 +7029,33 @@ status_t SurfaceFlinger::captureScreen(const sp<IBinder>& displayToken,
                                        const Rect& sourceCrop, uint32_t reqWidth,
                                        uint32_t reqHeight, bool useIdentityTransform,
                                        ui::Rotation rotation, bool captureSecureLayers) {
+    return captureDisplayCommon(displayToken, outBuffer, nullptr /* outFence */,
+                                outCapturedSecureLayers, reqDataspace, reqPixelFormat, sourceCrop,
+                                reqWidth, reqHeight, useIdentityTransform, rotation,
+                                captureSecureLayers);
+}
+
+status_t SurfaceFlinger::captureScreenAsync(const sp<IBinder>& displayToken,
+                                            sp<GraphicBuffer>* outBuffer, sp<Fence>* outFence,
+                                            bool& outCapturedSecureLayers, Dataspace reqDataspace,
+                                            ui::PixelFormat reqPixelFormat, const Rect& sourceCrop,
+                                            uint32_t reqWidth, uint32_t reqHeight,
+                                            bool useIdentityTransform, ui::Rotation rotation,
+                                            bool captureSecureLayers) {
+    if (!outFence) return BAD_VALUE;
+
+    return captureDisplayCommon(displayToken, outBuffer, outFence, outCapturedSecureLayers,
+                                reqDataspace, reqPixelFormat, sourceCrop, reqWidth, reqHeight,
+                                useIdentityTransform, rotation, captureSecureLayers);
+}
+
+status_t SurfaceFlinger::captureDisplayCommon(const sp<IBinder>& displayToken,
+                                              sp<GraphicBuffer>* outBuffer, sp<Fence>* outFence,
+                                              bool& outCapturedSecureLayers, Dataspace reqDataspace,
+                                              ui::PixelFormat reqPixelFormat,
+                                              const Rect& sourceCrop, uint32_t reqWidth,
+                                              uint32_t reqHeight, bool useIdentityTransform,
+                                              ui::Rotation rotation, bool captureSecureLayers) {
     ATRACE_CALL();
 
     if (!displayToken) return BAD_VALUE;
@@ -6665,7 +7086,7 @@ status_t SurfaceFlinger::captureScreen(const sp<IBinder>& displayToken,
     auto traverseLayers = std::bind(&SurfaceFlinger::traverseLayersInDisplay, this, display,
                                     std::placeholders::_1);
     return captureScreenCommon(renderArea, traverseLayers, outBuffer, reqPixelFormat,
-                               useIdentityTransform, outCapturedSecureLayers);
+                               useIdentityTransform, outCapturedSecureLayers, outFence);
 }
 
 static Dataspace pickDataspaceFromColorMode(const ColorMode colorMode) {
@@ -6957,26 +7378,45 @@ status_t SurfaceFlinger::captureScreenCommon(RenderArea& renderArea,
                                              sp<GraphicBuffer>* outBuffer,
                                              const ui::PixelFormat reqPixelFormat,
                                              bool useIdentityTransform,
-                                             bool& outCapturedSecureLayers) {
+                                             bool& outCapturedSecureLayers, sp<Fence>* outFence) {
     ATRACE_CALL();
 
     // TODO(b/116112787) Make buffer usage a parameter.
     const uint32_t usage = GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN |
             GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE | GRALLOC_USAGE_HW_COMPOSER;
-    *outBuffer =
-            getFactory().createGraphicBuffer(renderArea.getReqWidth(), renderArea.getReqHeight(),
-                                             static_cast<android_pixel_format>(reqPixelFormat), 1,
-                                             usage, "screenshot");
-
-    return captureScreenCommon(renderArea, traverseLayers, *outBuffer, useIdentityTransform,
-                               false /* regionSampling */, outCapturedSecureLayers);
+    *outBuffer = nullptr;
+    if (outFence) {
+        // Asynchronous captures recycle buffers through a small pool so that
+        // steady-state captures skip the gralloc allocation.
+        *outBuffer = mCaptureBufferPool.getBuffer(renderArea.getReqWidth(),
+                                                  renderArea.getReqHeight(),
+                                                  static_cast<PixelFormat>(reqPixelFormat), usage);
+    }
+    if (*outBuffer == nullptr) {
+        *outBuffer = getFactory().createGraphicBuffer(renderArea.getReqWidth(),
+                                                      renderArea.getReqHeight(),
+                                                      static_cast<android_pixel_format>(
+                                                              reqPixelFormat),
+                                                      1, usage, "screenshot");
+    }
+
+    const status_t result =
+            captureScreenCommon(renderArea, traverseLayers, *outBuffer, useIdentityTransform,
+                                false /* regionSampling */, outCapturedSecureLayers, outFence);
+    if (result == NO_ERROR && outFence) {
+        // Make the buffer available again once the render has finished. The
+        // caller gets a bounded window to consume it before a later capture
+        // reuses it; see the contract on ISurfaceComposer::captureScreenAsync.
+        mCaptureBufferPool.returnBuffer(*outBuffer, *outFence);
+    }
+    return result;
 }
 
 status_t SurfaceFlinger::captureScreenCommon(RenderArea& renderArea,
                                              TraverseLayersFunction traverseLayers,
                                              const sp<GraphicBuffer>& buffer,
                                              bool useIdentityTransform, bool regionSampling,
-                                             bool& outCapturedSecureLayers) {
+                                             bool& outCapturedSecureLayers, sp<Fence>* outFence) {
     const int uid = IPCThreadState::self()->getCallingUid();
     const bool forSystem = uid == AID_GRAPHICS || uid == AID_SYSTEM;
 
@@ -7006,8 +7446,14 @@ status_t SurfaceFlinger::captureScreenCommon(RenderArea& renderArea,
     } while (result == EAGAIN);
 
     if (result == NO_ERROR) {
-        sync_wait(syncFd, -1);
-        close(syncFd);
+        if (outFence) {
+            // Hand the render fence to the caller instead of blocking on it;
+            // the capture is complete once the fence signals.
+            *outFence = syncFd >= 0 ? sp<Fence>(new Fence(syncFd)) : Fence::NO_FENCE;
+        } else {
+            sync_wait(syncFd, -1);
+            close(syncFd);
+        }
     }
 
     return result;
@@ -7049,7 +7495,7 @@ void SurfaceFlinger::renderScreenImplLocked(const RenderArea& renderArea,
     clientCompositionLayers.push_back(fillLayer);
 
     const auto display = renderArea.getDisplayDevice();
-    std::vector<Layer*> renderedLayers;
+    FatVector<Layer*, 16> renderedLayers;
     Region clearRegion = Region::INVALID_REGION;
     traverseLayers([&](Layer* layer) {
         if (layer->isSecureDisplay()) {
@@ -7069,6 +7515,7 @@ void SurfaceFlinger::renderScreenImplLocked(const RenderArea& renderArea,
                 clientCompositionDisplay.outputDataspace,
                 true,  /* realContentIsVisible */
                 false, /* clearContent */
+                false, /* disableBackgroundBlur */
         };
         std::vector<compositionengine::LayerFE::LayerSettings> results =
                 layer->prepareClientCompositionList(targetSettings);
@@ -7154,12 +7601,38 @@ void SurfaceFlinger::State::traverse(const LayerVector::Visitor& visitor) const
     layersSortedByZ.traverse(visitor);
 }
 
+void SurfaceFlinger::State::flattenZOrder() const {
+    mFlattenedZOrder.clear();
+    layersSortedByZ.traverseInZOrder(stateSet, [this](Layer* layer) {
+        mFlattenedZOrder.emplace_back(layer);
+    });
+    mFlattenedZOrderValid = true;
+}
+
 void SurfaceFlinger::State::traverseInZOrder(const LayerVector::Visitor& visitor) const {
-    layersSortedByZ.traverseInZOrder(stateSet, visitor);
+    if (stateSet != LayerVector::StateSet::Drawing) {
+        layersSortedByZ.traverseInZOrder(stateSet, visitor);
+        return;
+    }
+    if (!mFlattenedZOrderValid) {
+        flattenZOrder();
+    }
+    for (const sp<Layer>& layer : mFlattenedZOrder) {
+        visitor(layer.get());
+    }
 }
 
 void SurfaceFlinger::State::traverseInReverseZOrder(const LayerVector::Visitor& visitor) const {
-    layersSortedByZ.traverseInReverseZOrder(stateSet, visitor);
+    if (stateSet != LayerVector::StateSet::Drawing) {
+        layersSortedByZ.traverseInReverseZOrder(stateSet, visitor);
+        return;
+    }
+    if (!mFlattenedZOrderValid) {
+        flattenZOrder();
+    }
+    for (auto it = mFlattenedZOrder.rbegin(); it != mFlattenedZOrder.rend(); it++) {
+        visitor(it->get());
+    }
 }
 
 void SurfaceFlinger::traverseLayersInDisplay(const sp<const DisplayDevice>& display,
@@ -7555,6 +8028,21 @@ status_t SurfaceFlinger::acquireFrameRateFlexibilityToken(sp<IBinder>* outToken)
     return result;
 }
 
+status_t SurfaceFlinger::setThermalRefreshRateHeadroom(float headroom) {
+    ATRACE_CALL();
+
+    if (std::isnan(headroom) || headroom < 0.0f || headroom > 1.0f) {
+        return BAD_VALUE;
+    }
+
+    if (mRefreshRateConfigs->setThermalHeadroom(headroom)) {
+        // The headroom changed enough to get past the hysteresis, so re-evaluate the
+        // refresh rate choice with the new bias.
+        mScheduler->thermalHeadroomChanged();
+    }
+    return NO_ERROR;
+}
+
 void SurfaceFlinger::onFrameRateFlexibilityTokenReleased() {
     static_cast<void>(schedule([this] {
         LOG_ALWAYS_FATAL_IF(mFrameRateFlexibilityTokenCount == 0,
@@ -39,6 +39,7 @@
 #include <renderengine/LayerSettings.h>
 #include <serviceutils/PriorityDumper.h>
 #include <system/graphics.h>
+#include <ui/DisplayedContentSampleStream.h>
 #include <ui/FenceTime.h>
 #include <ui/PixelFormat.h>
 #include <ui/Size.h>
@@ -49,7 +50,10 @@
 #include <utils/Trace.h>
 #include <utils/threads.h>
 
+#include "CaptureBufferPool.h"
 #include "ClientCache.h"
+#include "CompositionStatsRecorder.h"
+#include "FrameTimelineRecorder.h"
 #include "DisplayDevice.h"
 #include "DisplayHardware/HWC2.h"
 #include "DisplayHardware/PowerAdvisor.h"
@@ -64,6 +68,7 @@
 #include "SurfaceTracing.h"
 #include "TracedOrdinal.h"
 #include "TransactionCompletedThread.h"
+#include "TransactionFenceWatcher.h"
 
 #include <atomic>
 #include <cstdint>
@@ -117,6 +122,7 @@ class HWComposer;
 class IGraphicBufferProducer;
 class IInputFlinger;
 class Layer;
+class MemoryHeapBase;
 class MessageBase;
 class RefreshRateOverlay;
 class RegionSamplingThread;
@@ -138,6 +144,10 @@ namespace dvr {
 class VrFlinger;
 } // namespace dvr
 
+namespace scheduler {
+class PhaseOffsetTuner;
+} // namespace scheduler
+
 enum {
     eTransactionNeeded = 0x01,
     eTraversalNeeded = 0x02,
@@ -297,6 +307,13 @@ public:
     // FramebufferSurface
     static int64_t maxFrameBufferAcquiredBuffers;
 
+    // Depth of the client target buffer pipeline for physical displays.
+    // Defaults to maxFrameBufferAcquiredBuffers; debug.sf.client_target_buffer_depth
+    // can deepen it so that GPU composition of the next frame does not wait
+    // for the display to release the client target currently on screen, at the
+    // cost of one framebuffer of extra memory.
+    static int64_t clientTargetBufferDepth;
+
     // Controls the maximum width and height in pixels that the graphics pipeline can support for
     // GPU fallback composition. For example, 8k devices with 4k GPUs, or 4k devices with 2k GPUs.
     static uint32_t maxGraphicsWidth;
@@ -457,6 +474,11 @@ private:
             }
             globalShadowSettings = other.globalShadowSettings;
 
+            // The layer hierarchy or z-order may have changed; the flattened
+            // traversal is rebuilt once the new child lists are committed.
+            mFlattenedZOrder.clear();
+            mFlattenedZOrderValid = false;
+
             return *this;
         }
 
@@ -472,6 +494,20 @@ private:
         void traverse(const LayerVector::Visitor& visitor) const;
         void traverseInZOrder(const LayerVector::Visitor& visitor) const;
         void traverseInReverseZOrder(const LayerVector::Visitor& visitor) const;
+
+        // Rebuilds the flattened z-order traversal from the layer tree.
+        void flattenZOrder() const;
+
+    private:
+        // Flattened visitation order of traverseInZOrder, cached so that
+        // steady-state frames iterate a contiguous array instead of
+        // re-walking and re-sorting the layer tree. Only maintained for the
+        // Drawing state, whose hierarchy and z-order change solely through
+        // the assignment above; commitTransactionLocked re-flattens it once
+        // the new child lists are committed. The reverse traversal is the
+        // exact mirror of the forward one, so both share the cache.
+        mutable std::vector<sp<Layer>> mFlattenedZOrder;
+        mutable bool mFlattenedZOrderValid = true;
     };
 
     /* ------------------------------------------------------------------------
@@ -510,6 +546,12 @@ private:
                            ui::PixelFormat reqPixelFormat, const Rect& sourceCrop,
                            uint32_t reqWidth, uint32_t reqHeight, bool useIdentityTransform,
                            ui::Rotation rotation, bool captureSecureLayers) override;
+    status_t captureScreenAsync(const sp<IBinder>& displayToken, sp<GraphicBuffer>* outBuffer,
+                                sp<Fence>* outFence, bool& outCapturedSecureLayers,
+                                ui::Dataspace reqDataspace, ui::PixelFormat reqPixelFormat,
+                                const Rect& sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
+                                bool useIdentityTransform, ui::Rotation rotation,
+                                bool captureSecureLayers) override;
     status_t captureScreen(uint64_t displayOrLayerStack, ui::Dataspace* outDataspace,
                            sp<GraphicBuffer>* outBuffer) override;
     status_t captureLayers(
@@ -520,9 +562,11 @@ private:
             float frameScale, bool childrenOnly) override;
 
     status_t getDisplayStats(const sp<IBinder>& displayToken, DisplayStatInfo* stats) override;
+    status_t getCompositionStats(CompositionStats* outStats) override;
     status_t getDisplayState(const sp<IBinder>& displayToken, ui::DisplayState*) override;
     status_t getDisplayInfo(const sp<IBinder>& displayToken, DisplayInfo*) override;
     status_t getDisplayConfigs(const sp<IBinder>& displayToken, Vector<DisplayConfig>*) override;
+    status_t getDisplayConfigTable(sp<IMemoryHeap>* outHeap) override;
     int getActiveConfig(const sp<IBinder>& displayToken) override;
     status_t getDisplayColorModes(const sp<IBinder>& displayToken, Vector<ui::ColorMode>*) override;
     status_t getDisplayNativePrimaries(const sp<IBinder>& displayToken,
@@ -581,6 +625,9 @@ private:
     status_t setFrameRate(const sp<IGraphicBufferProducer>& surface, float frameRate,
                           int8_t compatibility) override;
     status_t acquireFrameRateFlexibilityToken(sp<IBinder>* outToken) override;
+    status_t setThermalRefreshRateHeadroom(float headroom) override;
+    status_t getDisplayedContentSampleStream(const sp<IBinder>& displayToken,
+                                             base::unique_fd* outFd) override;
     status_t setDisplayElapseTime(const sp<DisplayDevice>& display) const;
     status_t isSupportedConfigSwitch(const sp<IBinder>& displayToken, int config);
 
@@ -708,6 +755,7 @@ private:
                                bool privileged, bool hasListenerCallbacks,
                                const std::vector<ListenerCallbacks>& listenerCallbacks,
                                bool isMainThread = false) REQUIRES(mStateLock);
+    struct TransactionState; // defined with mTransactionQueues below
     // Returns true if at least one transaction was flushed
     bool flushTransactionQueues();
     // Returns true if there is at least one transaction that needs to be flushed
@@ -727,6 +775,12 @@ private:
     void commitOffscreenLayers();
     bool transactionIsReadyToBeApplied(int64_t desiredPresentTime,
                                        const Vector<ComposerState>& states);
+    // Returns false while the desiredPresentTime lies between now and one second into
+    // the future, per the policy in transactionIsReadyToBeApplied.
+    bool desiredPresentTimeIsDue(int64_t desiredPresentTime) const;
+    // Hands the transaction's unsignaled acquire fences to mTransactionFenceWatcher,
+    // which re-arms the transaction flush once the last of them signals.
+    void watchTransactionFences(TransactionState& transaction) REQUIRES(mStateLock);
     uint32_t setDisplayStateLocked(const DisplayState& s) REQUIRES(mStateLock);
     void checkVirtualDisplayHint(const Vector<DisplayState>& displays);
     uint32_t addInputWindowCommands(const InputWindowCommands& inputWindowCommands)
@@ -805,12 +859,24 @@ private:
     void renderScreenImplLocked(const RenderArea& renderArea, TraverseLayersFunction traverseLayers,
                                 ANativeWindowBuffer* buffer, bool useIdentityTransform,
                                 bool regionSampling, int* outSyncFd);
+    // When outFence is non-null, the capture returns as soon as the render has
+    // been queued, with *outFence signaling its completion; the buffer is drawn
+    // from (and recycled through) mCaptureBufferPool. Otherwise the calls block
+    // until the render has finished.
+    status_t captureDisplayCommon(const sp<IBinder>& displayToken, sp<GraphicBuffer>* outBuffer,
+                                  sp<Fence>* outFence, bool& outCapturedSecureLayers,
+                                  ui::Dataspace reqDataspace, ui::PixelFormat reqPixelFormat,
+                                  const Rect& sourceCrop, uint32_t reqWidth, uint32_t reqHeight,
+                                  bool useIdentityTransform, ui::Rotation rotation,
+                                  bool captureSecureLayers);
     status_t captureScreenCommon(RenderArea& renderArea, TraverseLayersFunction traverseLayers,
                                  sp<GraphicBuffer>* outBuffer, const ui::PixelFormat reqPixelFormat,
-                                 bool useIdentityTransform, bool& outCapturedSecureLayers);
+                                 bool useIdentityTransform, bool& outCapturedSecureLayers,
+                                 sp<Fence>* outFence = nullptr);
     status_t captureScreenCommon(RenderArea& renderArea, TraverseLayersFunction traverseLayers,
                                  const sp<GraphicBuffer>& buffer, bool useIdentityTransform,
-                                 bool regionSampling, bool& outCapturedSecureLayers);
+                                 bool regionSampling, bool& outCapturedSecureLayers,
+                                 sp<Fence>* outFence = nullptr);
     sp<DisplayDevice> getDisplayByIdOrLayerStack(uint64_t displayOrLayerStack) REQUIRES(mStateLock);
     sp<DisplayDevice> getDisplayByLayerStack(uint64_t layerStack) REQUIRES(mStateLock);
     status_t captureScreenImplLocked(const RenderArea& renderArea,
@@ -940,6 +1006,14 @@ private:
 
     void dispatchDisplayHotplugEvent(PhysicalDisplayId displayId, bool connected);
 
+    status_t getDisplayConfigsLocked(const sp<IBinder>& displayToken, Vector<DisplayConfig>*)
+            REQUIRES(mStateLock);
+
+    // Republishes the configs and active config of every physical display in
+    // the shared-memory table handed out by getDisplayConfigTable. All writers
+    // run on the main thread, which keeps the seqlock single-writer.
+    void updateDisplayConfigTableLocked() REQUIRES(mStateLock);
+
     /* ------------------------------------------------------------------------
      * VSync
      */
@@ -1044,6 +1118,7 @@ private:
 
     void dumpVSync(std::string& result) const REQUIRES(mStateLock);
     void dumpStaticScreenStats(std::string& result) const;
+    void dumpProducerLatency(std::string& result) const REQUIRES(mStateLock);
     // Not const because each Layer needs to query Fences and cache timestamps.
     void dumpFrameEventsLocked(std::string& result);
 
@@ -1172,6 +1247,13 @@ private:
     bool mGeometryInvalid = false;
     bool mAnimCompositionPending = false;
     std::vector<sp<Layer>> mLayersWithQueuedFrames;
+    // Latch buffers on a worker pool when enough independent layers have
+    // queued frames (debug.sf.enable_parallel_latch).
+    static constexpr size_t kMinLayersForParallelLatch = 4;
+    bool mParallelLatchEnabled = false;
+    // Skip latching layers with an ExactOrMultiple frame rate vote until
+    // their own cadence is due (debug.sf.enable_frame_rate_throttling).
+    bool mFrameRateThrottlingEnabled = false;
     // Tracks layers that need to update a display's dirty region.
     std::vector<sp<Layer>> mLayersPendingRefresh;
     std::array<sp<Fence>, 2> mPreviousPresentFences = {Fence::NO_FENCE, Fence::NO_FENCE};
@@ -1204,6 +1286,10 @@ private:
     std::map<wp<IBinder>, sp<DisplayDevice>> mDisplays GUARDED_BY(mStateLock);
     std::unordered_map<DisplayId, sp<IBinder>> mPhysicalDisplayTokens GUARDED_BY(mStateLock);
 
+    // Shared-memory heap holding the DisplayConfigTable published to clients.
+    // Allocated once at construction; only the main thread writes to it.
+    sp<MemoryHeapBase> mDisplayConfigTableHeap;
+
     std::unordered_map<BBinder*, wp<Layer>> mLayersByLocalBinderToken GUARDED_BY(mStateLock);
 
     // don't use a lock for these, we don't care
@@ -1240,6 +1326,23 @@ private:
     std::atomic<uint32_t> mHwcFrameMissedCount = 0;
     std::atomic<uint32_t> mGpuFrameMissedCount = 0;
 
+    // Per-stage composition timing, recorded on the main thread and read by
+    // dumpsys and getCompositionStats.
+    CompositionStatsRecorder mCompositionStats;
+
+    // Per-frame token timeline, recorded on the main thread and read by
+    // dumpsys.
+    FrameTimelineRecorder mFrameTimeline;
+
+    // Durations of the init() phases, recorded once at startup and reported
+    // through dumpsys so boot regressions can be attributed without a
+    // rebuild.
+    struct InitPhase {
+        const char* name;
+        nsecs_t durationNs;
+    };
+    std::vector<InitPhase> mInitPhases;
+
     std::mutex mVsyncPeriodMutex;
     std::vector<nsecs_t> mVsyncPeriods;
 
@@ -1292,9 +1395,36 @@ private:
         bool privileged;
         bool hasListenerCallbacks;
         std::vector<ListenerCallbacks> listenerCallbacks;
+
+        // Number of acquire fences in this transaction that have not signaled yet,
+        // decremented asynchronously by mTransactionFenceWatcher.  Null when the
+        // transaction was queued with no unsignaled fences.  Lets the flush path test
+        // fence readiness without polling each fence every frame.
+        std::shared_ptr<const std::atomic<uint32_t>> unsignaledFenceCount;
     };
     std::unordered_map<sp<IBinder>, std::queue<TransactionState>, IListenerHash> mTransactionQueues;
 
+    // Tracks the acquire fences of queued transactions and re-arms the transaction
+    // flush from its own thread once a transaction's last fence signals, so the main
+    // thread does not need to rescan fence-pending transactions every invalidate.
+    TransactionFenceWatcher mTransactionFenceWatcher;
+
+    // One ashmem region per display that a client has requested with
+    // getDisplayedContentSampleStream.  SurfaceFlinger keeps the only writable mapping;
+    // clients can only map the fd read-only.  Guarded by its own mutex so the per-frame
+    // publish does not take mStateLock.
+    struct ContentSampleStream {
+        base::unique_fd fd;
+        DisplayedContentSampleStream* buffer = nullptr;
+    };
+    mutable std::mutex mSampleStreamMutex;
+    std::unordered_map<DisplayId, ContentSampleStream> mContentSampleStreams
+            GUARDED_BY(mSampleStreamMutex);
+
+    // Republishes the latest HWC color histogram of each streamed display; called once
+    // per composited frame from postComposition.
+    void publishContentSampleStreams();
+
     /* ------------------------------------------------------------------------
      * Feature prototyping
      */
@@ -1352,6 +1482,10 @@ private:
     // Stores phase offsets configured per refresh rate.
     std::unique_ptr<scheduler::PhaseConfiguration> mPhaseConfiguration;
 
+    // Adjusts the configured phase offsets at runtime based on how the device
+    // actually keeps its deadlines. Null unless enabled via sysprop.
+    std::unique_ptr<scheduler::PhaseOffsetTuner> mPhaseOffsetTuner;
+
     // Optional to defer construction until scheduler connections are created.
     std::optional<scheduler::VSyncModulator> mVSyncModulator;
 
@@ -1392,6 +1526,9 @@ private:
 
     bool mLumaSampling = true;
     sp<RegionSamplingThread> mRegionSamplingThread;
+
+    // Recycles buffers across captures requested through captureScreenAsync.
+    CaptureBufferPool mCaptureBufferPool;
     ui::DisplayPrimaries mInternalDisplayPrimaries;
 
     const float mInternalDisplayDensity;
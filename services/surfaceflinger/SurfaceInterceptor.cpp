@@ -45,6 +45,11 @@ SurfaceInterceptor::SurfaceInterceptor(SurfaceFlinger* flinger)
 {
 }
 
+SurfaceInterceptor::~SurfaceInterceptor() {
+    stopWriterThread();
+    drainQueue(nullptr);
+}
+
 void SurfaceInterceptor::enable(const SortedVector<sp<Layer>>& layers,
         const DefaultKeyedVector< wp<IBinder>, DisplayDeviceState>& displays)
 {
@@ -52,10 +57,15 @@ void SurfaceInterceptor::enable(const SortedVector<sp<Layer>>& layers,
         return;
     }
     ATRACE_CALL();
+    // Discard anything a racing producer managed to enqueue after the
+    // previous session's final drain.
+    drainQueue(nullptr);
+    // The initial snapshot is enqueued before mEnabled lets producers in, so
+    // it is guaranteed to precede every intercepted event in the trace.
+    saveExistingDisplays(displays);
+    saveExistingSurfaces(layers);
+    startWriterThread();
     mEnabled = true;
-    std::lock_guard<std::mutex> protoGuard(mTraceMutex);
-    saveExistingDisplaysLocked(displays);
-    saveExistingSurfacesLocked(layers);
 }
 
 void SurfaceInterceptor::disable() {
@@ -63,9 +73,12 @@ void SurfaceInterceptor::disable() {
         return;
     }
     ATRACE_CALL();
-    std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     mEnabled = false;
-    status_t err(writeProtoFileLocked());
+    // Once the writer has been joined this thread is the only one touching
+    // mTrace; pick up whatever the writer had not drained yet.
+    stopWriterThread();
+    drainQueue(&mTrace);
+    status_t err(writeProtoFile());
     ALOGE_IF(err == PERMISSION_DENIED, "Could not save the proto file! Permission denied");
     ALOGE_IF(err == NOT_ENOUGH_DATA, "Could not save the proto file! There are missing fields");
     mTrace.Clear();
@@ -75,28 +88,36 @@ bool SurfaceInterceptor::isEnabled() {
     return mEnabled;
 }
 
-void SurfaceInterceptor::saveExistingDisplaysLocked(
+void SurfaceInterceptor::saveExistingDisplays(
         const DefaultKeyedVector< wp<IBinder>, DisplayDeviceState>& displays)
 {
     // Caveat: The initial snapshot does not capture the power mode of the existing displays
     ATRACE_CALL();
     for (size_t i = 0 ; i < displays.size() ; i++) {
-        addDisplayCreationLocked(createTraceIncrementLocked(), displays[i]);
-        addInitialDisplayStateLocked(createTraceIncrementLocked(), displays[i]);
+        Increment* creation = createIncrement();
+        addDisplayCreation(creation, displays[i]);
+        enqueueIncrement(creation);
+        Increment* state = createIncrement();
+        addInitialDisplayState(state, displays[i]);
+        enqueueIncrement(state);
     }
 }
 
-void SurfaceInterceptor::saveExistingSurfacesLocked(const SortedVector<sp<Layer>>& layers) {
+void SurfaceInterceptor::saveExistingSurfaces(const SortedVector<sp<Layer>>& layers) {
     ATRACE_CALL();
     for (const auto& l : layers) {
         l->traverseInZOrder(LayerVector::StateSet::Drawing, [this](Layer* layer) {
-            addSurfaceCreationLocked(createTraceIncrementLocked(), layer);
-            addInitialSurfaceStateLocked(createTraceIncrementLocked(), layer);
+            Increment* creation = createIncrement();
+            addSurfaceCreation(creation, layer);
+            enqueueIncrement(creation);
+            Increment* state = createIncrement();
+            addInitialSurfaceState(state, layer);
+            enqueueIncrement(state);
         });
     }
 }
 
-void SurfaceInterceptor::addInitialSurfaceStateLocked(Increment* increment,
+void SurfaceInterceptor::addInitialSurfaceState(Increment* increment,
         const sp<const Layer>& layer)
 {
     Transaction* transaction(increment->mutable_transaction());
@@ -105,48 +126,48 @@ void SurfaceInterceptor::addInitialSurfaceStateLocked(Increment* increment,
     transaction->set_animation(layerFlags & BnSurfaceComposer::eAnimation);
 
     const int32_t layerId(getLayerId(layer));
-    addPositionLocked(transaction, layerId, layer->mCurrentState.active_legacy.transform.tx(),
+    addPosition(transaction, layerId, layer->mCurrentState.active_legacy.transform.tx(),
                       layer->mCurrentState.active_legacy.transform.ty());
-    addDepthLocked(transaction, layerId, layer->mCurrentState.z);
-    addAlphaLocked(transaction, layerId, layer->mCurrentState.color.a);
-    addTransparentRegionLocked(transaction, layerId,
+    addDepth(transaction, layerId, layer->mCurrentState.z);
+    addAlpha(transaction, layerId, layer->mCurrentState.color.a);
+    addTransparentRegion(transaction, layerId,
                                layer->mCurrentState.activeTransparentRegion_legacy);
-    addLayerStackLocked(transaction, layerId, layer->mCurrentState.layerStack);
-    addCropLocked(transaction, layerId, layer->mCurrentState.crop_legacy);
-    addCornerRadiusLocked(transaction, layerId, layer->mCurrentState.cornerRadius);
-    addBackgroundBlurRadiusLocked(transaction, layerId, layer->mCurrentState.backgroundBlurRadius);
+    addLayerStack(transaction, layerId, layer->mCurrentState.layerStack);
+    addCrop(transaction, layerId, layer->mCurrentState.crop_legacy);
+    addCornerRadius(transaction, layerId, layer->mCurrentState.cornerRadius);
+    addBackgroundBlurRadius(transaction, layerId, layer->mCurrentState.backgroundBlurRadius);
     if (layer->mCurrentState.barrierLayer_legacy != nullptr) {
-        addDeferTransactionLocked(transaction, layerId,
+        addDeferTransaction(transaction, layerId,
                                   layer->mCurrentState.barrierLayer_legacy.promote(),
                                   layer->mCurrentState.frameNumber_legacy);
     }
-    addOverrideScalingModeLocked(transaction, layerId, layer->getEffectiveScalingMode());
-    addFlagsLocked(transaction, layerId, layer->mCurrentState.flags,
+    addOverrideScalingMode(transaction, layerId, layer->getEffectiveScalingMode());
+    addFlags(transaction, layerId, layer->mCurrentState.flags,
                    layer_state_t::eLayerHidden | layer_state_t::eLayerOpaque |
                            layer_state_t::eLayerSecure);
-    addReparentLocked(transaction, layerId, getLayerIdFromWeakRef(layer->mCurrentParent));
-    addDetachChildrenLocked(transaction, layerId, layer->isLayerDetached());
-    addRelativeParentLocked(transaction, layerId,
+    addReparent(transaction, layerId, getLayerIdFromWeakRef(layer->mCurrentParent));
+    addDetachChildren(transaction, layerId, layer->isLayerDetached());
+    addRelativeParent(transaction, layerId,
                             getLayerIdFromWeakRef(layer->mCurrentState.zOrderRelativeOf),
                             layer->mCurrentState.z);
-    addShadowRadiusLocked(transaction, layerId, layer->mCurrentState.shadowRadius);
+    addShadowRadius(transaction, layerId, layer->mCurrentState.shadowRadius);
 }
 
-void SurfaceInterceptor::addInitialDisplayStateLocked(Increment* increment,
+void SurfaceInterceptor::addInitialDisplayState(Increment* increment,
         const DisplayDeviceState& display)
 {
     Transaction* transaction(increment->mutable_transaction());
     transaction->set_synchronous(false);
     transaction->set_animation(false);
 
-    addDisplaySurfaceLocked(transaction, display.sequenceId, display.surface);
-    addDisplayLayerStackLocked(transaction, display.sequenceId, display.layerStack);
-    addDisplaySizeLocked(transaction, display.sequenceId, display.width, display.height);
-    addDisplayProjectionLocked(transaction, display.sequenceId, toRotationInt(display.orientation),
+    addDisplaySurface(transaction, display.sequenceId, display.surface);
+    addDisplayLayerStack(transaction, display.sequenceId, display.layerStack);
+    addDisplaySize(transaction, display.sequenceId, display.width, display.height);
+    addDisplayProjection(transaction, display.sequenceId, toRotationInt(display.orientation),
                                display.viewport, display.frame);
 }
 
-status_t SurfaceInterceptor::writeProtoFileLocked() {
+status_t SurfaceInterceptor::writeProtoFile() {
     ATRACE_CALL();
     std::string output;
 
@@ -192,13 +213,77 @@ int32_t SurfaceInterceptor::getLayerIdFromHandle(const sp<const IBinder>& handle
     return layer == nullptr ? -1 : getLayerId(layer);
 }
 
-Increment* SurfaceInterceptor::createTraceIncrementLocked() {
-    Increment* increment(mTrace.add_increment());
+Increment* SurfaceInterceptor::createIncrement() {
+    Increment* increment(new Increment());
     increment->set_time_stamp(elapsedRealtimeNano());
     return increment;
 }
 
-SurfaceChange* SurfaceInterceptor::createSurfaceChangeLocked(Transaction* transaction,
+void SurfaceInterceptor::enqueueIncrement(Increment* increment) {
+    IncrementNode* node = new IncrementNode{increment, mQueueHead.load(std::memory_order_relaxed)};
+    while (!mQueueHead.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+    }
+    // Opportunistic wakeup; the writer also polls, so a notification lost to
+    // the race with its predicate check only delays the append.
+    mWriterCondition.notify_one();
+}
+
+void SurfaceInterceptor::drainQueue(Trace* trace) {
+    IncrementNode* node = mQueueHead.exchange(nullptr, std::memory_order_acquire);
+    // The stack is in LIFO order; reverse it back into enqueue order.
+    IncrementNode* ordered = nullptr;
+    while (node != nullptr) {
+        IncrementNode* next = node->next;
+        node->next = ordered;
+        ordered = node;
+        node = next;
+    }
+    while (ordered != nullptr) {
+        if (trace != nullptr) {
+            // Hands the increment over without copying it.
+            trace->mutable_increment()->AddAllocated(ordered->increment);
+        } else {
+            delete ordered->increment;
+        }
+        IncrementNode* next = ordered->next;
+        delete ordered;
+        ordered = next;
+    }
+}
+
+void SurfaceInterceptor::startWriterThread() {
+    mWriterRunning = true;
+    mWriter = std::thread(&SurfaceInterceptor::writerThread, this);
+}
+
+void SurfaceInterceptor::stopWriterThread() {
+    if (!mWriterRunning.exchange(false)) {
+        return;
+    }
+    mWriterCondition.notify_one();
+    if (mWriter.joinable()) {
+        mWriter.join();
+    }
+}
+
+void SurfaceInterceptor::writerThread() {
+    // Producers enqueue without taking mWriterMutex, so a notification can
+    // slip past the predicate check below; the timed wait bounds how long an
+    // increment can sit in the queue when that happens.
+    constexpr auto MAX_DRAIN_DELAY = std::chrono::milliseconds(100);
+    std::unique_lock<std::mutex> lock(mWriterMutex);
+    while (mWriterRunning) {
+        mWriterCondition.wait_for(lock, MAX_DRAIN_DELAY, [this] {
+            return !mWriterRunning || mQueueHead.load(std::memory_order_relaxed) != nullptr;
+        });
+        lock.unlock();
+        drainQueue(&mTrace);
+        lock.lock();
+    }
+}
+
+SurfaceChange* SurfaceInterceptor::createSurfaceChange(Transaction* transaction,
         int32_t layerId)
 {
     SurfaceChange* change(transaction->add_surface_change());
@@ -206,7 +291,7 @@ SurfaceChange* SurfaceInterceptor::createSurfaceChangeLocked(Transaction* transa
     return change;
 }
 
-DisplayChange* SurfaceInterceptor::createDisplayChangeLocked(Transaction* transaction,
+DisplayChange* SurfaceInterceptor::createDisplayChange(Transaction* transaction,
         int32_t sequenceId)
 {
     DisplayChange* dispChange(transaction->add_display_change());
@@ -214,51 +299,51 @@ DisplayChange* SurfaceInterceptor::createDisplayChangeLocked(Transaction* transa
     return dispChange;
 }
 
-void SurfaceInterceptor::setProtoRectLocked(Rectangle* protoRect, const Rect& rect) {
+void SurfaceInterceptor::setProtoRect(Rectangle* protoRect, const Rect& rect) {
     protoRect->set_left(rect.left);
     protoRect->set_top(rect.top);
     protoRect->set_right(rect.right);
     protoRect->set_bottom(rect.bottom);
 }
 
-void SurfaceInterceptor::addPositionLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addPosition(Transaction* transaction, int32_t layerId,
         float x, float y)
 {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     PositionChange* posChange(change->mutable_position());
     posChange->set_x(x);
     posChange->set_y(y);
 }
 
-void SurfaceInterceptor::addDepthLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addDepth(Transaction* transaction, int32_t layerId,
         uint32_t z)
 {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     LayerChange* depthChange(change->mutable_layer());
     depthChange->set_layer(z);
 }
 
-void SurfaceInterceptor::addSizeLocked(Transaction* transaction, int32_t layerId, uint32_t w,
+void SurfaceInterceptor::addSize(Transaction* transaction, int32_t layerId, uint32_t w,
         uint32_t h)
 {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     SizeChange* sizeChange(change->mutable_size());
     sizeChange->set_w(w);
     sizeChange->set_h(h);
 }
 
-void SurfaceInterceptor::addAlphaLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addAlpha(Transaction* transaction, int32_t layerId,
         float alpha)
 {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     AlphaChange* alphaChange(change->mutable_alpha());
     alphaChange->set_alpha(alpha);
 }
 
-void SurfaceInterceptor::addMatrixLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addMatrix(Transaction* transaction, int32_t layerId,
         const layer_state_t::matrix22_t& matrix)
 {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     MatrixChange* matrixChange(change->mutable_matrix());
     matrixChange->set_dsdx(matrix.dsdx);
     matrixChange->set_dtdx(matrix.dtdx);
@@ -266,74 +351,74 @@ void SurfaceInterceptor::addMatrixLocked(Transaction* transaction, int32_t layer
     matrixChange->set_dtdy(matrix.dtdy);
 }
 
-void SurfaceInterceptor::addTransparentRegionLocked(Transaction* transaction,
+void SurfaceInterceptor::addTransparentRegion(Transaction* transaction,
         int32_t layerId, const Region& transRegion)
 {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     TransparentRegionHintChange* transparentChange(change->mutable_transparent_region_hint());
 
     for (const auto& rect : transRegion) {
         Rectangle* protoRect(transparentChange->add_region());
-        setProtoRectLocked(protoRect, rect);
+        setProtoRect(protoRect, rect);
     }
 }
 
-void SurfaceInterceptor::addFlagsLocked(Transaction* transaction, int32_t layerId, uint8_t flags,
+void SurfaceInterceptor::addFlags(Transaction* transaction, int32_t layerId, uint8_t flags,
                                         uint8_t mask) {
     // There can be multiple flags changed
     if (mask & layer_state_t::eLayerHidden) {
-        SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+        SurfaceChange* change(createSurfaceChange(transaction, layerId));
         HiddenFlagChange* flagChange(change->mutable_hidden_flag());
         flagChange->set_hidden_flag(flags & layer_state_t::eLayerHidden);
     }
     if (mask & layer_state_t::eLayerOpaque) {
-        SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+        SurfaceChange* change(createSurfaceChange(transaction, layerId));
         OpaqueFlagChange* flagChange(change->mutable_opaque_flag());
         flagChange->set_opaque_flag(flags & layer_state_t::eLayerOpaque);
     }
     if (mask & layer_state_t::eLayerSecure) {
-        SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+        SurfaceChange* change(createSurfaceChange(transaction, layerId));
         SecureFlagChange* flagChange(change->mutable_secure_flag());
         flagChange->set_secure_flag(flags & layer_state_t::eLayerSecure);
     }
 }
 
-void SurfaceInterceptor::addLayerStackLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addLayerStack(Transaction* transaction, int32_t layerId,
         uint32_t layerStack)
 {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     LayerStackChange* layerStackChange(change->mutable_layer_stack());
     layerStackChange->set_layer_stack(layerStack);
 }
 
-void SurfaceInterceptor::addCropLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addCrop(Transaction* transaction, int32_t layerId,
         const Rect& rect)
 {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     CropChange* cropChange(change->mutable_crop());
     Rectangle* protoRect(cropChange->mutable_rectangle());
-    setProtoRectLocked(protoRect, rect);
+    setProtoRect(protoRect, rect);
 }
 
-void SurfaceInterceptor::addCornerRadiusLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addCornerRadius(Transaction* transaction, int32_t layerId,
                                        float cornerRadius)
 {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     CornerRadiusChange* cornerRadiusChange(change->mutable_corner_radius());
     cornerRadiusChange->set_corner_radius(cornerRadius);
 }
 
-void SurfaceInterceptor::addBackgroundBlurRadiusLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addBackgroundBlurRadius(Transaction* transaction, int32_t layerId,
                                                        int32_t backgroundBlurRadius) {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     BackgroundBlurRadiusChange* blurRadiusChange(change->mutable_background_blur_radius());
     blurRadiusChange->set_background_blur_radius(backgroundBlurRadius);
 }
 
-void SurfaceInterceptor::addDeferTransactionLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addDeferTransaction(Transaction* transaction, int32_t layerId,
         const sp<const Layer>& layer, uint64_t frameNumber)
 {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     if (layer == nullptr) {
         ALOGE("An existing layer could not be retrieved with the handle"
                 " for the deferred transaction");
@@ -344,51 +429,51 @@ void SurfaceInterceptor::addDeferTransactionLocked(Transaction* transaction, int
     deferTransaction->set_frame_number(frameNumber);
 }
 
-void SurfaceInterceptor::addOverrideScalingModeLocked(Transaction* transaction,
+void SurfaceInterceptor::addOverrideScalingMode(Transaction* transaction,
         int32_t layerId, int32_t overrideScalingMode)
 {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     OverrideScalingModeChange* overrideChange(change->mutable_override_scaling_mode());
     overrideChange->set_override_scaling_mode(overrideScalingMode);
 }
 
-void SurfaceInterceptor::addReparentLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addReparent(Transaction* transaction, int32_t layerId,
                                            int32_t parentId) {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     ReparentChange* overrideChange(change->mutable_reparent());
     overrideChange->set_parent_id(parentId);
 }
 
-void SurfaceInterceptor::addReparentChildrenLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addReparentChildren(Transaction* transaction, int32_t layerId,
                                                    int32_t parentId) {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     ReparentChildrenChange* overrideChange(change->mutable_reparent_children());
     overrideChange->set_parent_id(parentId);
 }
 
-void SurfaceInterceptor::addDetachChildrenLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addDetachChildren(Transaction* transaction, int32_t layerId,
                                                  bool detached) {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     DetachChildrenChange* overrideChange(change->mutable_detach_children());
     overrideChange->set_detach_children(detached);
 }
 
-void SurfaceInterceptor::addRelativeParentLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addRelativeParent(Transaction* transaction, int32_t layerId,
                                                  int32_t parentId, int z) {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     RelativeParentChange* overrideChange(change->mutable_relative_parent());
     overrideChange->set_relative_parent_id(parentId);
     overrideChange->set_z(z);
 }
 
-void SurfaceInterceptor::addShadowRadiusLocked(Transaction* transaction, int32_t layerId,
+void SurfaceInterceptor::addShadowRadius(Transaction* transaction, int32_t layerId,
                                                float shadowRadius) {
-    SurfaceChange* change(createSurfaceChangeLocked(transaction, layerId));
+    SurfaceChange* change(createSurfaceChange(transaction, layerId));
     ShadowRadiusChange* overrideChange(change->mutable_shadow_radius());
     overrideChange->set_radius(shadowRadius);
 }
 
-void SurfaceInterceptor::addSurfaceChangesLocked(Transaction* transaction,
+void SurfaceInterceptor::addSurfaceChanges(Transaction* transaction,
         const layer_state_t& state)
 {
     const sp<const Layer> layer(getLayer(state.surface));
@@ -401,37 +486,37 @@ void SurfaceInterceptor::addSurfaceChangesLocked(Transaction* transaction,
     const int32_t layerId(getLayerId(layer));
 
     if (state.what & layer_state_t::ePositionChanged) {
-        addPositionLocked(transaction, layerId, state.x, state.y);
+        addPosition(transaction, layerId, state.x, state.y);
     }
     if (state.what & layer_state_t::eLayerChanged) {
-        addDepthLocked(transaction, layerId, state.z);
+        addDepth(transaction, layerId, state.z);
     }
     if (state.what & layer_state_t::eSizeChanged) {
-        addSizeLocked(transaction, layerId, state.w, state.h);
+        addSize(transaction, layerId, state.w, state.h);
     }
     if (state.what & layer_state_t::eAlphaChanged) {
-        addAlphaLocked(transaction, layerId, state.alpha);
+        addAlpha(transaction, layerId, state.alpha);
     }
     if (state.what & layer_state_t::eMatrixChanged) {
-        addMatrixLocked(transaction, layerId, state.matrix);
+        addMatrix(transaction, layerId, state.matrix);
     }
     if (state.what & layer_state_t::eTransparentRegionChanged) {
-        addTransparentRegionLocked(transaction, layerId, state.transparentRegion);
+        addTransparentRegion(transaction, layerId, state.transparentRegion);
     }
     if (state.what & layer_state_t::eFlagsChanged) {
-        addFlagsLocked(transaction, layerId, state.flags, state.mask);
+        addFlags(transaction, layerId, state.flags, state.mask);
     }
     if (state.what & layer_state_t::eLayerStackChanged) {
-        addLayerStackLocked(transaction, layerId, state.layerStack);
+        addLayerStack(transaction, layerId, state.layerStack);
     }
     if (state.what & layer_state_t::eCropChanged_legacy) {
-        addCropLocked(transaction, layerId, state.crop_legacy);
+        addCrop(transaction, layerId, state.crop_legacy);
     }
     if (state.what & layer_state_t::eCornerRadiusChanged) {
-        addCornerRadiusLocked(transaction, layerId, state.cornerRadius);
+        addCornerRadius(transaction, layerId, state.cornerRadius);
     }
     if (state.what & layer_state_t::eBackgroundBlurRadiusChanged) {
-        addBackgroundBlurRadiusLocked(transaction, layerId, state.backgroundBlurRadius);
+        addBackgroundBlurRadius(transaction, layerId, state.backgroundBlurRadius);
     }
     if (state.what & layer_state_t::eDeferTransaction_legacy) {
         sp<Layer> otherLayer = nullptr;
@@ -446,48 +531,48 @@ void SurfaceInterceptor::addSurfaceChangesLocked(Transaction* transaction,
                 ALOGE("Attempt to defer transaction to to an unrecognized GraphicBufferProducer");
             }
         }
-        addDeferTransactionLocked(transaction, layerId, otherLayer, state.frameNumber_legacy);
+        addDeferTransaction(transaction, layerId, otherLayer, state.frameNumber_legacy);
     }
     if (state.what & layer_state_t::eOverrideScalingModeChanged) {
-        addOverrideScalingModeLocked(transaction, layerId, state.overrideScalingMode);
+        addOverrideScalingMode(transaction, layerId, state.overrideScalingMode);
     }
     if (state.what & layer_state_t::eReparent) {
-        addReparentLocked(transaction, layerId, getLayerIdFromHandle(state.parentHandleForChild));
+        addReparent(transaction, layerId, getLayerIdFromHandle(state.parentHandleForChild));
     }
     if (state.what & layer_state_t::eReparentChildren) {
-        addReparentChildrenLocked(transaction, layerId, getLayerIdFromHandle(state.reparentHandle));
+        addReparentChildren(transaction, layerId, getLayerIdFromHandle(state.reparentHandle));
     }
     if (state.what & layer_state_t::eDetachChildren) {
-        addDetachChildrenLocked(transaction, layerId, true);
+        addDetachChildren(transaction, layerId, true);
     }
     if (state.what & layer_state_t::eRelativeLayerChanged) {
-        addRelativeParentLocked(transaction, layerId,
+        addRelativeParent(transaction, layerId,
                                 getLayerIdFromHandle(state.relativeLayerHandle), state.z);
     }
     if (state.what & layer_state_t::eShadowRadiusChanged) {
-        addShadowRadiusLocked(transaction, layerId, state.shadowRadius);
+        addShadowRadius(transaction, layerId, state.shadowRadius);
     }
 }
 
-void SurfaceInterceptor::addDisplayChangesLocked(Transaction* transaction,
+void SurfaceInterceptor::addDisplayChanges(Transaction* transaction,
         const DisplayState& state, int32_t sequenceId)
 {
     if (state.what & DisplayState::eSurfaceChanged) {
-        addDisplaySurfaceLocked(transaction, sequenceId, state.surface);
+        addDisplaySurface(transaction, sequenceId, state.surface);
     }
     if (state.what & DisplayState::eLayerStackChanged) {
-        addDisplayLayerStackLocked(transaction, sequenceId, state.layerStack);
+        addDisplayLayerStack(transaction, sequenceId, state.layerStack);
     }
     if (state.what & DisplayState::eDisplaySizeChanged) {
-        addDisplaySizeLocked(transaction, sequenceId, state.width, state.height);
+        addDisplaySize(transaction, sequenceId, state.width, state.height);
     }
     if (state.what & DisplayState::eDisplayProjectionChanged) {
-        addDisplayProjectionLocked(transaction, sequenceId, toRotationInt(state.orientation),
+        addDisplayProjection(transaction, sequenceId, toRotationInt(state.orientation),
                                    state.viewport, state.frame);
     }
 }
 
-void SurfaceInterceptor::addTransactionLocked(Increment* increment,
+void SurfaceInterceptor::addTransaction(Increment* increment,
         const Vector<ComposerState>& stateUpdates,
         const DefaultKeyedVector< wp<IBinder>, DisplayDeviceState>& displays,
         const Vector<DisplayState>& changedDisplays, uint32_t transactionFlags)
@@ -496,18 +581,18 @@ void SurfaceInterceptor::addTransactionLocked(Increment* increment,
     transaction->set_synchronous(transactionFlags & BnSurfaceComposer::eSynchronous);
     transaction->set_animation(transactionFlags & BnSurfaceComposer::eAnimation);
     for (const auto& compState: stateUpdates) {
-        addSurfaceChangesLocked(transaction, compState.state);
+        addSurfaceChanges(transaction, compState.state);
     }
     for (const auto& disp: changedDisplays) {
         ssize_t dpyIdx = displays.indexOfKey(disp.token);
         if (dpyIdx >= 0) {
             const DisplayDeviceState& dispState(displays.valueAt(dpyIdx));
-            addDisplayChangesLocked(transaction, disp, dispState.sequenceId);
+            addDisplayChanges(transaction, disp, dispState.sequenceId);
         }
     }
 }
 
-void SurfaceInterceptor::addSurfaceCreationLocked(Increment* increment,
+void SurfaceInterceptor::addSurfaceCreation(Increment* increment,
         const sp<const Layer>& layer)
 {
     SurfaceCreation* creation(increment->mutable_surface_creation());
@@ -517,14 +602,14 @@ void SurfaceInterceptor::addSurfaceCreationLocked(Increment* increment,
     creation->set_h(layer->mCurrentState.active_legacy.h);
 }
 
-void SurfaceInterceptor::addSurfaceDeletionLocked(Increment* increment,
+void SurfaceInterceptor::addSurfaceDeletion(Increment* increment,
         const sp<const Layer>& layer)
 {
     SurfaceDeletion* deletion(increment->mutable_surface_deletion());
     deletion->set_id(getLayerId(layer));
 }
 
-void SurfaceInterceptor::addBufferUpdateLocked(Increment* increment, int32_t layerId,
+void SurfaceInterceptor::addBufferUpdate(Increment* increment, int32_t layerId,
         uint32_t width, uint32_t height, uint64_t frameNumber)
 {
     BufferUpdate* update(increment->mutable_buffer_update());
@@ -534,12 +619,12 @@ void SurfaceInterceptor::addBufferUpdateLocked(Increment* increment, int32_t lay
     update->set_frame_number(frameNumber);
 }
 
-void SurfaceInterceptor::addVSyncUpdateLocked(Increment* increment, nsecs_t timestamp) {
+void SurfaceInterceptor::addVSyncUpdate(Increment* increment, nsecs_t timestamp) {
     VSyncEvent* event(increment->mutable_vsync_event());
     event->set_when(timestamp);
 }
 
-void SurfaceInterceptor::addDisplaySurfaceLocked(Transaction* transaction, int32_t sequenceId,
+void SurfaceInterceptor::addDisplaySurface(Transaction* transaction, int32_t sequenceId,
         const sp<const IGraphicBufferProducer>& surface)
 {
     if (surface == nullptr) {
@@ -548,7 +633,7 @@ void SurfaceInterceptor::addDisplaySurfaceLocked(Transaction* transaction, int32
     uint64_t bufferQueueId = 0;
     status_t err(surface->getUniqueId(&bufferQueueId));
     if (err == NO_ERROR) {
-        DisplayChange* dispChange(createDisplayChangeLocked(transaction, sequenceId));
+        DisplayChange* dispChange(createDisplayChange(transaction, sequenceId));
         DispSurfaceChange* surfaceChange(dispChange->mutable_surface());
         surfaceChange->set_buffer_queue_id(bufferQueueId);
         surfaceChange->set_buffer_queue_name(surface->getConsumerName().string());
@@ -559,36 +644,36 @@ void SurfaceInterceptor::addDisplaySurfaceLocked(Transaction* transaction, int32
     }
 }
 
-void SurfaceInterceptor::addDisplayLayerStackLocked(Transaction* transaction,
+void SurfaceInterceptor::addDisplayLayerStack(Transaction* transaction,
         int32_t sequenceId, uint32_t layerStack)
 {
-    DisplayChange* dispChange(createDisplayChangeLocked(transaction, sequenceId));
+    DisplayChange* dispChange(createDisplayChange(transaction, sequenceId));
     LayerStackChange* layerStackChange(dispChange->mutable_layer_stack());
     layerStackChange->set_layer_stack(layerStack);
 }
 
-void SurfaceInterceptor::addDisplaySizeLocked(Transaction* transaction, int32_t sequenceId,
+void SurfaceInterceptor::addDisplaySize(Transaction* transaction, int32_t sequenceId,
         uint32_t w, uint32_t h)
 {
-    DisplayChange* dispChange(createDisplayChangeLocked(transaction, sequenceId));
+    DisplayChange* dispChange(createDisplayChange(transaction, sequenceId));
     SizeChange* sizeChange(dispChange->mutable_size());
     sizeChange->set_w(w);
     sizeChange->set_h(h);
 }
 
-void SurfaceInterceptor::addDisplayProjectionLocked(Transaction* transaction,
+void SurfaceInterceptor::addDisplayProjection(Transaction* transaction,
         int32_t sequenceId, int32_t orientation, const Rect& viewport, const Rect& frame)
 {
-    DisplayChange* dispChange(createDisplayChangeLocked(transaction, sequenceId));
+    DisplayChange* dispChange(createDisplayChange(transaction, sequenceId));
     ProjectionChange* projectionChange(dispChange->mutable_projection());
     projectionChange->set_orientation(orientation);
     Rectangle* viewportRect(projectionChange->mutable_viewport());
-    setProtoRectLocked(viewportRect, viewport);
+    setProtoRect(viewportRect, viewport);
     Rectangle* frameRect(projectionChange->mutable_frame());
-    setProtoRectLocked(frameRect, frame);
+    setProtoRect(frameRect, frame);
 }
 
-void SurfaceInterceptor::addDisplayCreationLocked(Increment* increment,
+void SurfaceInterceptor::addDisplayCreation(Increment* increment,
         const DisplayDeviceState& info)
 {
     DisplayCreation* creation(increment->mutable_display_creation());
@@ -600,12 +685,12 @@ void SurfaceInterceptor::addDisplayCreationLocked(Increment* increment,
     }
 }
 
-void SurfaceInterceptor::addDisplayDeletionLocked(Increment* increment, int32_t sequenceId) {
+void SurfaceInterceptor::addDisplayDeletion(Increment* increment, int32_t sequenceId) {
     DisplayDeletion* deletion(increment->mutable_display_deletion());
     deletion->set_id(sequenceId);
 }
 
-void SurfaceInterceptor::addPowerModeUpdateLocked(Increment* increment, int32_t sequenceId,
+void SurfaceInterceptor::addPowerModeUpdate(Increment* increment, int32_t sequenceId,
         int32_t mode)
 {
     PowerModeUpdate* powerModeUpdate(increment->mutable_power_mode_update());
@@ -621,9 +706,9 @@ void SurfaceInterceptor::saveTransaction(const Vector<ComposerState>& stateUpdat
         return;
     }
     ATRACE_CALL();
-    std::lock_guard<std::mutex> protoGuard(mTraceMutex);
-    addTransactionLocked(createTraceIncrementLocked(), stateUpdates, displays, changedDisplays,
-            flags);
+    Increment* increment = createIncrement();
+    addTransaction(increment, stateUpdates, displays, changedDisplays, flags);
+    enqueueIncrement(increment);
 }
 
 void SurfaceInterceptor::saveSurfaceCreation(const sp<const Layer>& layer) {
@@ -631,8 +716,9 @@ void SurfaceInterceptor::saveSurfaceCreation(const sp<const Layer>& layer) {
         return;
     }
     ATRACE_CALL();
-    std::lock_guard<std::mutex> protoGuard(mTraceMutex);
-    addSurfaceCreationLocked(createTraceIncrementLocked(), layer);
+    Increment* increment = createIncrement();
+    addSurfaceCreation(increment, layer);
+    enqueueIncrement(increment);
 }
 
 void SurfaceInterceptor::saveSurfaceDeletion(const sp<const Layer>& layer) {
@@ -640,8 +726,9 @@ void SurfaceInterceptor::saveSurfaceDeletion(const sp<const Layer>& layer) {
         return;
     }
     ATRACE_CALL();
-    std::lock_guard<std::mutex> protoGuard(mTraceMutex);
-    addSurfaceDeletionLocked(createTraceIncrementLocked(), layer);
+    Increment* increment = createIncrement();
+    addSurfaceDeletion(increment, layer);
+    enqueueIncrement(increment);
 }
 
 /**
@@ -658,16 +745,18 @@ void SurfaceInterceptor::saveBufferUpdate(int32_t layerId, uint32_t width,
         return;
     }
     ATRACE_CALL();
-    std::lock_guard<std::mutex> protoGuard(mTraceMutex);
-    addBufferUpdateLocked(createTraceIncrementLocked(), layerId, width, height, frameNumber);
+    Increment* increment = createIncrement();
+    addBufferUpdate(increment, layerId, width, height, frameNumber);
+    enqueueIncrement(increment);
 }
 
 void SurfaceInterceptor::saveVSyncEvent(nsecs_t timestamp) {
     if (!mEnabled) {
         return;
     }
-    std::lock_guard<std::mutex> protoGuard(mTraceMutex);
-    addVSyncUpdateLocked(createTraceIncrementLocked(), timestamp);
+    Increment* increment = createIncrement();
+    addVSyncUpdate(increment, timestamp);
+    enqueueIncrement(increment);
 }
 
 void SurfaceInterceptor::saveDisplayCreation(const DisplayDeviceState& info) {
@@ -675,8 +764,9 @@ void SurfaceInterceptor::saveDisplayCreation(const DisplayDeviceState& info) {
         return;
     }
     ATRACE_CALL();
-    std::lock_guard<std::mutex> protoGuard(mTraceMutex);
-    addDisplayCreationLocked(createTraceIncrementLocked(), info);
+    Increment* increment = createIncrement();
+    addDisplayCreation(increment, info);
+    enqueueIncrement(increment);
 }
 
 void SurfaceInterceptor::saveDisplayDeletion(int32_t sequenceId) {
@@ -684,8 +774,9 @@ void SurfaceInterceptor::saveDisplayDeletion(int32_t sequenceId) {
         return;
     }
     ATRACE_CALL();
-    std::lock_guard<std::mutex> protoGuard(mTraceMutex);
-    addDisplayDeletionLocked(createTraceIncrementLocked(), sequenceId);
+    Increment* increment = createIncrement();
+    addDisplayDeletion(increment, sequenceId);
+    enqueueIncrement(increment);
 }
 
 void SurfaceInterceptor::savePowerModeUpdate(int32_t sequenceId, int32_t mode) {
@@ -693,8 +784,9 @@ void SurfaceInterceptor::savePowerModeUpdate(int32_t sequenceId, int32_t mode) {
         return;
     }
     ATRACE_CALL();
-    std::lock_guard<std::mutex> protoGuard(mTraceMutex);
-    addPowerModeUpdateLocked(createTraceIncrementLocked(), sequenceId, mode);
+    Increment* increment = createIncrement();
+    addPowerModeUpdate(increment, sequenceId, mode);
+    enqueueIncrement(increment);
 }
 
 } // namespace impl
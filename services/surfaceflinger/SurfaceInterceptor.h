@@ -19,7 +19,10 @@
 
 #include <frameworks/native/cmds/surfacereplayer/proto/src/trace.pb.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
 
 #include <gui/LayerState.h>
 
@@ -82,11 +85,18 @@ namespace impl {
 /*
  * SurfaceInterceptor intercepts and stores incoming streams of window
  * properties on SurfaceFlinger.
+ *
+ * Each intercepted event is captured into a standalone Increment message on
+ * the calling thread (the layer/display state it snapshots is only safe to
+ * read there), pushed onto a lock-free queue and appended to the trace by a
+ * dedicated writer thread. The caller's overhead is therefore bounded to
+ * building its own increment plus one enqueue; callers never contend on a
+ * trace-wide lock with each other or with serialization.
  */
 class SurfaceInterceptor final : public android::SurfaceInterceptor {
 public:
     explicit SurfaceInterceptor(SurfaceFlinger* const flinger);
-    ~SurfaceInterceptor() override = default;
+    ~SurfaceInterceptor() override;
 
     // Both vectors are used to capture the current state of SF as the initial snapshot in the trace
     void enable(const SortedVector<sp<Layer>>& layers,
@@ -115,79 +125,106 @@ private:
     // The creation increments of Surfaces and Displays do not contain enough information to capture
     // the initial state of each object, so a transaction with all of the missing properties is
     // performed at the initial snapshot for each display and surface.
-    void saveExistingDisplaysLocked(
+    void saveExistingDisplays(
             const DefaultKeyedVector< wp<IBinder>, DisplayDeviceState>& displays);
-    void saveExistingSurfacesLocked(const SortedVector<sp<Layer>>& layers);
-    void addInitialSurfaceStateLocked(Increment* increment, const sp<const Layer>& layer);
-    void addInitialDisplayStateLocked(Increment* increment, const DisplayDeviceState& display);
+    void saveExistingSurfaces(const SortedVector<sp<Layer>>& layers);
+    void addInitialSurfaceState(Increment* increment, const sp<const Layer>& layer);
+    void addInitialDisplayState(Increment* increment, const DisplayDeviceState& display);
 
-    status_t writeProtoFileLocked();
+    status_t writeProtoFile();
     const sp<const Layer> getLayer(const wp<const IBinder>& weakHandle) const;
+
     int32_t getLayerId(const sp<const Layer>& layer) const;
     int32_t getLayerIdFromWeakRef(const wp<const Layer>& layer) const;
     int32_t getLayerIdFromHandle(const sp<const IBinder>& weakHandle) const;
 
-    Increment* createTraceIncrementLocked();
-    void addSurfaceCreationLocked(Increment* increment, const sp<const Layer>& layer);
-    void addSurfaceDeletionLocked(Increment* increment, const sp<const Layer>& layer);
-    void addBufferUpdateLocked(Increment* increment, int32_t layerId, uint32_t width,
+    // Returns a new heap-allocated increment stamped with the current time.
+    // Ownership passes to the trace via enqueueIncrement.
+    Increment* createIncrement();
+    void addSurfaceCreation(Increment* increment, const sp<const Layer>& layer);
+    void addSurfaceDeletion(Increment* increment, const sp<const Layer>& layer);
+    void addBufferUpdate(Increment* increment, int32_t layerId, uint32_t width,
             uint32_t height, uint64_t frameNumber);
-    void addVSyncUpdateLocked(Increment* increment, nsecs_t timestamp);
-    void addDisplayCreationLocked(Increment* increment, const DisplayDeviceState& info);
-    void addDisplayDeletionLocked(Increment* increment, int32_t sequenceId);
-    void addPowerModeUpdateLocked(Increment* increment, int32_t sequenceId, int32_t mode);
+    void addVSyncUpdate(Increment* increment, nsecs_t timestamp);
+    void addDisplayCreation(Increment* increment, const DisplayDeviceState& info);
+    void addDisplayDeletion(Increment* increment, int32_t sequenceId);
+    void addPowerModeUpdate(Increment* increment, int32_t sequenceId, int32_t mode);
 
     // Add surface transactions to the trace
-    SurfaceChange* createSurfaceChangeLocked(Transaction* transaction, int32_t layerId);
-    void setProtoRectLocked(Rectangle* protoRect, const Rect& rect);
-    void addPositionLocked(Transaction* transaction, int32_t layerId, float x, float y);
-    void addDepthLocked(Transaction* transaction, int32_t layerId, uint32_t z);
-    void addSizeLocked(Transaction* transaction, int32_t layerId, uint32_t w, uint32_t h);
-    void addAlphaLocked(Transaction* transaction, int32_t layerId, float alpha);
-    void addMatrixLocked(Transaction* transaction, int32_t layerId,
+    SurfaceChange* createSurfaceChange(Transaction* transaction, int32_t layerId);
+    void setProtoRect(Rectangle* protoRect, const Rect& rect);
+    void addPosition(Transaction* transaction, int32_t layerId, float x, float y);
+    void addDepth(Transaction* transaction, int32_t layerId, uint32_t z);
+    void addSize(Transaction* transaction, int32_t layerId, uint32_t w, uint32_t h);
+    void addAlpha(Transaction* transaction, int32_t layerId, float alpha);
+    void addMatrix(Transaction* transaction, int32_t layerId,
             const layer_state_t::matrix22_t& matrix);
-    void addTransparentRegionLocked(Transaction* transaction, int32_t layerId,
+    void addTransparentRegion(Transaction* transaction, int32_t layerId,
             const Region& transRegion);
-    void addFlagsLocked(Transaction* transaction, int32_t layerId, uint8_t flags, uint8_t mask);
-    void addLayerStackLocked(Transaction* transaction, int32_t layerId, uint32_t layerStack);
-    void addCropLocked(Transaction* transaction, int32_t layerId, const Rect& rect);
-    void addCornerRadiusLocked(Transaction* transaction, int32_t layerId, float cornerRadius);
-    void addBackgroundBlurRadiusLocked(Transaction* transaction, int32_t layerId,
+    void addFlags(Transaction* transaction, int32_t layerId, uint8_t flags, uint8_t mask);
+    void addLayerStack(Transaction* transaction, int32_t layerId, uint32_t layerStack);
+    void addCrop(Transaction* transaction, int32_t layerId, const Rect& rect);
+    void addCornerRadius(Transaction* transaction, int32_t layerId, float cornerRadius);
+    void addBackgroundBlurRadius(Transaction* transaction, int32_t layerId,
                                        int32_t backgroundBlurRadius);
-    void addDeferTransactionLocked(Transaction* transaction, int32_t layerId,
+    void addDeferTransaction(Transaction* transaction, int32_t layerId,
             const sp<const Layer>& layer, uint64_t frameNumber);
-    void addOverrideScalingModeLocked(Transaction* transaction, int32_t layerId,
+    void addOverrideScalingMode(Transaction* transaction, int32_t layerId,
             int32_t overrideScalingMode);
-    void addSurfaceChangesLocked(Transaction* transaction, const layer_state_t& state);
-    void addTransactionLocked(Increment* increment, const Vector<ComposerState>& stateUpdates,
+    void addSurfaceChanges(Transaction* transaction, const layer_state_t& state);
+    void addTransaction(Increment* increment, const Vector<ComposerState>& stateUpdates,
             const DefaultKeyedVector< wp<IBinder>, DisplayDeviceState>& displays,
             const Vector<DisplayState>& changedDisplays, uint32_t transactionFlags);
-    void addReparentLocked(Transaction* transaction, int32_t layerId, int32_t parentId);
-    void addReparentChildrenLocked(Transaction* transaction, int32_t layerId, int32_t parentId);
-    void addDetachChildrenLocked(Transaction* transaction, int32_t layerId, bool detached);
-    void addRelativeParentLocked(Transaction* transaction, int32_t layerId, int32_t parentId,
+    void addReparent(Transaction* transaction, int32_t layerId, int32_t parentId);
+    void addReparentChildren(Transaction* transaction, int32_t layerId, int32_t parentId);
+    void addDetachChildren(Transaction* transaction, int32_t layerId, bool detached);
+    void addRelativeParent(Transaction* transaction, int32_t layerId, int32_t parentId,
                                  int z);
-    void addShadowRadiusLocked(Transaction* transaction, int32_t layerId, float shadowRadius);
+    void addShadowRadius(Transaction* transaction, int32_t layerId, float shadowRadius);
 
     // Add display transactions to the trace
-    DisplayChange* createDisplayChangeLocked(Transaction* transaction, int32_t sequenceId);
-    void addDisplaySurfaceLocked(Transaction* transaction, int32_t sequenceId,
+    DisplayChange* createDisplayChange(Transaction* transaction, int32_t sequenceId);
+    void addDisplaySurface(Transaction* transaction, int32_t sequenceId,
             const sp<const IGraphicBufferProducer>& surface);
-    void addDisplayLayerStackLocked(Transaction* transaction, int32_t sequenceId,
+    void addDisplayLayerStack(Transaction* transaction, int32_t sequenceId,
             uint32_t layerStack);
-    void addDisplaySizeLocked(Transaction* transaction, int32_t sequenceId, uint32_t w,
+    void addDisplaySize(Transaction* transaction, int32_t sequenceId, uint32_t w,
             uint32_t h);
-    void addDisplayProjectionLocked(Transaction* transaction, int32_t sequenceId,
+    void addDisplayProjection(Transaction* transaction, int32_t sequenceId,
             int32_t orientation, const Rect& viewport, const Rect& frame);
-    void addDisplayChangesLocked(Transaction* transaction,
+    void addDisplayChanges(Transaction* transaction,
             const DisplayState& state, int32_t sequenceId);
 
+    // Multiple-producer single-consumer handoff of finished increments. Any
+    // thread may push; only the writer thread (and the teardown paths once
+    // the writer has been joined) pops.
+    void enqueueIncrement(Increment* increment);
+    // Appends everything currently queued to trace, preserving enqueue
+    // order. A null trace discards the drained increments instead.
+    void drainQueue(Trace* trace);
+    void startWriterThread();
+    void stopWriterThread();
+    void writerThread();
+
+    struct IncrementNode {
+        Increment* increment;
+        IncrementNode* next;
+    };
 
     bool mEnabled {false};
     std::string mOutputFileName {DEFAULT_FILENAME};
-    std::mutex mTraceMutex {};
+    // Owned by the writer thread while it runs; only touched on the
+    // enable/disable thread once the writer has been joined.
     Trace mTrace {};
     SurfaceFlinger* const mFlinger;
+
+    // Head of the lock-free enqueue stack; drainQueue reverses it into
+    // chronological order.
+    std::atomic<IncrementNode*> mQueueHead {nullptr};
+    std::thread mWriter;
+    std::atomic<bool> mWriterRunning {false};
+    std::mutex mWriterMutex;
+    std::condition_variable mWriterCondition;
 };
 
 } // namespace impl
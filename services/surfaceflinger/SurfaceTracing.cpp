@@ -44,23 +44,22 @@ void SurfaceTracing::mainLoop() {
 }
 
 bool SurfaceTracing::addFirstEntry() {
-    LayersTraceProto entry;
-    {
-        std::scoped_lock lock(mSfLock);
-        entry = traceLayersLocked("tracing.enable");
-    }
+    LayersTraceProto entry = traceLayers("tracing.enable", 0 /* missedEntries */);
     return addTraceToBuffer(entry);
 }
 
 LayersTraceProto SurfaceTracing::traceWhenNotified() {
-    std::unique_lock<std::mutex> lock(mSfLock);
-    mCanStartTrace.wait(lock);
-    android::base::ScopedLockAssertion assumeLock(mSfLock);
-    LayersTraceProto entry = traceLayersLocked(mWhere);
-    mTracingInProgress = false;
-    mMissedTraceEntries = 0;
-    lock.unlock();
-    return entry;
+    const char* where;
+    uint32_t missedEntries;
+    {
+        std::unique_lock<std::mutex> lock(mNotifyMutex);
+        mCanStartTrace.wait(lock);
+        where = mWhere;
+        missedEntries = mMissedTraceEntries;
+        mTracingInProgress = false;
+        mMissedTraceEntries = 0;
+    }
+    return traceLayers(where, missedEntries);
 }
 
 bool SurfaceTracing::addTraceToBuffer(LayersTraceProto& entry) {
@@ -74,11 +73,7 @@ bool SurfaceTracing::addTraceToBuffer(LayersTraceProto& entry) {
 }
 
 void SurfaceTracing::notify(const char* where) {
-    std::scoped_lock lock(mSfLock);
-    notifyLocked(where);
-}
-
-void SurfaceTracing::notifyLocked(const char* where) {
+    std::scoped_lock lock(mNotifyMutex);
     mWhere = where;
     if (mTracingInProgress) {
         mMissedTraceEntries++;
@@ -87,6 +82,10 @@ void SurfaceTracing::notifyLocked(const char* where) {
     mCanStartTrace.notify_one();
 }
 
+void SurfaceTracing::notifyLocked(const char* where) {
+    notify(where);
+}
+
 void SurfaceTracing::writeToFileAsync() {
     std::scoped_lock lock(mTraceLock);
     mWriteToFile = true;
@@ -176,28 +175,37 @@ void SurfaceTracing::setTraceFlags(uint32_t flags) {
     mTraceFlags = flags;
 }
 
-LayersTraceProto SurfaceTracing::traceLayersLocked(const char* where) {
+LayersTraceProto SurfaceTracing::traceLayers(const char* where, uint32_t missedEntries) {
     ATRACE_CALL();
 
     LayersTraceProto entry;
     entry.set_elapsed_realtime_nanos(elapsedRealtimeNano());
     entry.set_where(where);
-    LayersProto layers(mFlinger.dumpDrawingStateProto(mTraceFlags));
 
-    if (flagIsSetLocked(SurfaceTracing::TRACE_EXTRA)) {
-        mFlinger.dumpOffscreenLayersProto(layers);
+    // Only the layer snapshot itself needs the flinger tracing lock. The HWC
+    // dump below reads state that this lock never guarded, so assembling the
+    // rest of the entry outside keeps the main thread from stalling behind it.
+    uint32_t traceFlags;
+    {
+        std::scoped_lock lock(mSfLock);
+        traceFlags = mTraceFlags;
+        LayersProto layers(mFlinger.dumpDrawingStateProto(traceFlags));
+
+        if (flagIsSetLocked(SurfaceTracing::TRACE_EXTRA)) {
+            mFlinger.dumpOffscreenLayersProto(layers);
+        }
+        entry.mutable_layers()->Swap(&layers);
     }
-    entry.mutable_layers()->Swap(&layers);
 
-    if (mTraceFlags & SurfaceTracing::TRACE_HWC) {
+    if (traceFlags & SurfaceTracing::TRACE_HWC) {
         std::string hwcDump;
         mFlinger.dumpHwc(hwcDump);
         entry.set_hwc_blob(hwcDump);
     }
-    if (!flagIsSetLocked(SurfaceTracing::TRACE_COMPOSITION)) {
+    if ((traceFlags & SurfaceTracing::TRACE_COMPOSITION) != SurfaceTracing::TRACE_COMPOSITION) {
         entry.set_excludes_composition_state(true);
     }
-    entry.set_missed_entries(mMissedTraceEntries);
+    entry.set_missed_entries(missedEntries);
 
     return entry;
 }
@@ -47,7 +47,9 @@ public:
     status_t writeToFile();
     bool isEnabled() const;
     void notify(const char* where);
-    void notifyLocked(const char* where) NO_THREAD_SAFETY_ANALYSIS /* REQUIRES(mSfLock) */;
+    // Kept for callers that already hold the flinger tracing lock; the
+    // notification itself no longer needs it.
+    void notifyLocked(const char* where);
 
     void setBufferSize(size_t bufferSizeInByte);
     void writeToFileAsync();
@@ -90,7 +92,7 @@ private:
     void mainLoop();
     bool addFirstEntry();
     LayersTraceProto traceWhenNotified();
-    LayersTraceProto traceLayersLocked(const char* where) REQUIRES(mSfLock);
+    LayersTraceProto traceLayers(const char* where, uint32_t missedEntries);
 
     // Returns true if trace is enabled.
     bool addTraceToBuffer(LayersTraceProto& entry);
@@ -103,9 +105,14 @@ private:
 
     std::mutex& mSfLock;
     uint32_t mTraceFlags GUARDED_BY(mSfLock) = TRACE_CRITICAL | TRACE_INPUT;
-    const char* mWhere GUARDED_BY(mSfLock) = "";
-    uint32_t mMissedTraceEntries GUARDED_BY(mSfLock) = 0;
-    bool mTracingInProgress GUARDED_BY(mSfLock) = false;
+
+    // Only guards the notification handshake with the tracing thread. Never
+    // held while serializing, so notifying the tracing thread from the main
+    // thread cannot block behind an in-flight snapshot.
+    std::mutex mNotifyMutex;
+    const char* mWhere GUARDED_BY(mNotifyMutex) = "";
+    uint32_t mMissedTraceEntries GUARDED_BY(mNotifyMutex) = 0;
+    bool mTracingInProgress GUARDED_BY(mNotifyMutex) = false;
 
     mutable std::mutex mTraceLock;
     LayersTraceBuffer mBuffer GUARDED_BY(mTraceLock);
@@ -122,6 +122,8 @@ AStatsManager_PullAtomCallbackReturn TimeStats::populateGlobalAtom(AStatsEventLi
 }
 
 AStatsManager_PullAtomCallbackReturn TimeStats::populateLayerAtom(AStatsEventList* data) {
+    flushPendingLayerRecords();
+
     std::lock_guard<std::mutex> lock(mMutex);
 
     std::vector<TimeStatsHelper::TimeStatsLayer const*> dumpStats;
@@ -184,9 +186,18 @@ TimeStats::TimeStats(std::unique_ptr<StatsEventDelegate> statsDelegate,
     if (maxPulledHistogramBuckets) {
         mMaxPulledHistogramBuckets = *maxPulledHistogramBuckets;
     }
+
+    mFlushThread = std::thread(&TimeStats::flushThreadMain, this);
 }
 
 TimeStats::~TimeStats() {
+    {
+        std::lock_guard<std::mutex> lock(mFlushMutex);
+        mFlushRunning = false;
+    }
+    mFlushCondition.notify_all();
+    mFlushThread.join();
+
     std::lock_guard<std::mutex> lock(mMutex);
     mStatsDelegate->clearStatsPullAtomCallback(android::util::SURFACEFLINGER_STATS_GLOBAL_INFO);
     mStatsDelegate->clearStatsPullAtomCallback(android::util::SURFACEFLINGER_STATS_LAYER_INFO);
@@ -237,9 +248,14 @@ std::string TimeStats::miniDump() {
     ATRACE_CALL();
 
     std::string result = "TimeStats miniDump:\n";
+    size_t trackedLayers = 0;
+    for (Stripe& stripe : mStripes) {
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        trackedLayers += stripe.tracker.size();
+    }
     std::lock_guard<std::mutex> lock(mMutex);
     android::base::StringAppendF(&result, "Number of layers currently being tracked is %zu\n",
-                                 mTimeStatsTracker.size());
+                                 trackedLayers);
     android::base::StringAppendF(&result, "Number of layers in the stats pool is %zu\n",
                                  mTimeStats.stats.size());
     return result;
@@ -385,71 +401,147 @@ bool TimeStats::recordReadyLocked(int32_t layerId, TimeRecord* timeRecord) {
     return true;
 }
 
-void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId) {
+void TimeStats::scheduleLayerFlush(int32_t layerId) {
+    {
+        std::lock_guard<std::mutex> lock(mFlushMutex);
+        mPendingFlushLayers.push_back(layerId);
+    }
+    mFlushCondition.notify_all();
+}
+
+void TimeStats::flushLayerRecord(int32_t layerId) {
     ATRACE_CALL();
 
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    TimeRecord& prevTimeRecord = layerRecord.prevTimeRecord;
-    std::deque<TimeRecord>& timeRecords = layerRecord.timeRecords;
-    while (!timeRecords.empty()) {
-        if (!recordReadyLocked(layerId, &timeRecords[0])) break;
-        ALOGV("[%d]-[%" PRIu64 "]-presentFenceTime[%" PRId64 "]", layerId,
-              timeRecords[0].frameTime.frameNumber, timeRecords[0].frameTime.presentTime);
-
-        if (prevTimeRecord.ready) {
-            const std::string& layerName = layerRecord.layerName;
-            if (!mTimeStats.stats.count(layerName)) {
-                mTimeStats.stats[layerName].layerName = layerName;
-            }
-            TimeStatsHelper::TimeStatsLayer& timeStatsLayer = mTimeStats.stats[layerName];
-            timeStatsLayer.totalFrames++;
-            timeStatsLayer.droppedFrames += layerRecord.droppedFrames;
-            timeStatsLayer.lateAcquireFrames += layerRecord.lateAcquireFrames;
-            timeStatsLayer.badDesiredPresentFrames += layerRecord.badDesiredPresentFrames;
-
-            layerRecord.droppedFrames = 0;
-            layerRecord.lateAcquireFrames = 0;
-            layerRecord.badDesiredPresentFrames = 0;
-
-            const int32_t postToAcquireMs = msBetween(timeRecords[0].frameTime.postTime,
-                                                      timeRecords[0].frameTime.acquireTime);
-            ALOGV("[%d]-[%" PRIu64 "]-post2acquire[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, postToAcquireMs);
-            timeStatsLayer.deltas["post2acquire"].insert(postToAcquireMs);
-
-            const int32_t postToPresentMs = msBetween(timeRecords[0].frameTime.postTime,
+    LayerFlush flush;
+    const uint32_t clearGeneration = mClearGeneration.load();
+    Stripe& stripe = stripeForLayer(layerId);
+    {
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        auto it = stripe.tracker.find(layerId);
+        if (it == stripe.tracker.end()) return;
+        LayerRecord& layerRecord = it->second;
+        TimeRecord& prevTimeRecord = layerRecord.prevTimeRecord;
+        std::deque<TimeRecord>& timeRecords = layerRecord.timeRecords;
+        while (!timeRecords.empty()) {
+            if (!recordReadyLocked(layerId, &timeRecords[0])) break;
+            ALOGV("[%d]-[%" PRIu64 "]-presentFenceTime[%" PRId64 "]", layerId,
+                  timeRecords[0].frameTime.frameNumber, timeRecords[0].frameTime.presentTime);
+
+            if (prevTimeRecord.ready) {
+                flush.layerName = layerRecord.layerName;
+                flush.droppedFrames += layerRecord.droppedFrames;
+                flush.lateAcquireFrames += layerRecord.lateAcquireFrames;
+                flush.badDesiredPresentFrames += layerRecord.badDesiredPresentFrames;
+
+                layerRecord.droppedFrames = 0;
+                layerRecord.lateAcquireFrames = 0;
+                layerRecord.badDesiredPresentFrames = 0;
+
+                LayerFlush::FrameDeltas deltas;
+                deltas.postToAcquireMs = msBetween(timeRecords[0].frameTime.postTime,
+                                                   timeRecords[0].frameTime.acquireTime);
+                ALOGV("[%d]-[%" PRIu64 "]-post2acquire[%d]", layerId,
+                      timeRecords[0].frameTime.frameNumber, deltas.postToAcquireMs);
+
+                deltas.postToPresentMs = msBetween(timeRecords[0].frameTime.postTime,
+                                                   timeRecords[0].frameTime.presentTime);
+                ALOGV("[%d]-[%" PRIu64 "]-post2present[%d]", layerId,
+                      timeRecords[0].frameTime.frameNumber, deltas.postToPresentMs);
+
+                deltas.acquireToPresentMs = msBetween(timeRecords[0].frameTime.acquireTime,
                                                       timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-post2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, postToPresentMs);
-            timeStatsLayer.deltas["post2present"].insert(postToPresentMs);
-
-            const int32_t acquireToPresentMs = msBetween(timeRecords[0].frameTime.acquireTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-acquire2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, acquireToPresentMs);
-            timeStatsLayer.deltas["acquire2present"].insert(acquireToPresentMs);
-
-            const int32_t latchToPresentMs = msBetween(timeRecords[0].frameTime.latchTime,
-                                                       timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-latch2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, latchToPresentMs);
-            timeStatsLayer.deltas["latch2present"].insert(latchToPresentMs);
-
-            const int32_t desiredToPresentMs = msBetween(timeRecords[0].frameTime.desiredTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-desired2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, desiredToPresentMs);
-            timeStatsLayer.deltas["desired2present"].insert(desiredToPresentMs);
-
-            const int32_t presentToPresentMs = msBetween(prevTimeRecord.frameTime.presentTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-present2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, presentToPresentMs);
-            timeStatsLayer.deltas["present2present"].insert(presentToPresentMs);
+                ALOGV("[%d]-[%" PRIu64 "]-acquire2present[%d]", layerId,
+                      timeRecords[0].frameTime.frameNumber, deltas.acquireToPresentMs);
+
+                deltas.latchToPresentMs = msBetween(timeRecords[0].frameTime.latchTime,
+                                                    timeRecords[0].frameTime.presentTime);
+                ALOGV("[%d]-[%" PRIu64 "]-latch2present[%d]", layerId,
+                      timeRecords[0].frameTime.frameNumber, deltas.latchToPresentMs);
+
+                deltas.desiredToPresentMs = msBetween(timeRecords[0].frameTime.desiredTime,
+                                                      timeRecords[0].frameTime.presentTime);
+                ALOGV("[%d]-[%" PRIu64 "]-desired2present[%d]", layerId,
+                      timeRecords[0].frameTime.frameNumber, deltas.desiredToPresentMs);
+
+                deltas.presentToPresentMs = msBetween(prevTimeRecord.frameTime.presentTime,
+                                                      timeRecords[0].frameTime.presentTime);
+                ALOGV("[%d]-[%" PRIu64 "]-present2present[%d]", layerId,
+                      timeRecords[0].frameTime.frameNumber, deltas.presentToPresentMs);
+
+                flush.frames.push_back(deltas);
+            }
+            prevTimeRecord = timeRecords[0];
+            timeRecords.pop_front();
+            layerRecord.waitData--;
         }
-        prevTimeRecord = timeRecords[0];
-        timeRecords.pop_front();
-        layerRecord.waitData--;
+    }
+    if (flush.frames.empty()) return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (clearGeneration != mClearGeneration.load()) return;
+    flushLayerBatchToStatsLocked(flush);
+}
+
+void TimeStats::flushLayerBatchToStatsLocked(const LayerFlush& flush) {
+    if (!mTimeStats.stats.count(flush.layerName)) {
+        if (mTimeStats.stats.size() >= MAX_NUM_LAYER_STATS) return;
+        mTimeStats.stats[flush.layerName].layerName = flush.layerName;
+        mLayerStatsCount = mTimeStats.stats.size();
+    }
+    TimeStatsHelper::TimeStatsLayer& timeStatsLayer = mTimeStats.stats[flush.layerName];
+    timeStatsLayer.droppedFrames += flush.droppedFrames;
+    timeStatsLayer.lateAcquireFrames += flush.lateAcquireFrames;
+    timeStatsLayer.badDesiredPresentFrames += flush.badDesiredPresentFrames;
+    for (const LayerFlush::FrameDeltas& deltas : flush.frames) {
+        timeStatsLayer.totalFrames++;
+        timeStatsLayer.deltas["post2acquire"].insert(deltas.postToAcquireMs);
+        timeStatsLayer.deltas["post2present"].insert(deltas.postToPresentMs);
+        timeStatsLayer.deltas["acquire2present"].insert(deltas.acquireToPresentMs);
+        timeStatsLayer.deltas["latch2present"].insert(deltas.latchToPresentMs);
+        timeStatsLayer.deltas["desired2present"].insert(deltas.desiredToPresentMs);
+        timeStatsLayer.deltas["present2present"].insert(deltas.presentToPresentMs);
+    }
+}
+
+void TimeStats::flushPendingLayerRecords() {
+    ATRACE_CALL();
+
+    std::vector<int32_t> pending;
+    {
+        std::lock_guard<std::mutex> lock(mFlushMutex);
+        pending.swap(mPendingFlushLayers);
+    }
+    for (const int32_t layerId : pending) {
+        flushLayerRecord(layerId);
+    }
+    // The flush thread may have claimed a batch before the queue was drained
+    // above. Wait it out so readers observe everything recorded before this
+    // call.
+    std::unique_lock<std::mutex> lock(mFlushMutex);
+    mFlushCondition.wait(lock, [this] { return !mFlushInProgress; });
+}
+
+void TimeStats::flushThreadMain() {
+    std::vector<int32_t> pending;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mFlushMutex);
+            mFlushCondition.wait(lock, [this] {
+                return !mFlushRunning || !mPendingFlushLayers.empty();
+            });
+            if (!mFlushRunning && mPendingFlushLayers.empty()) break;
+            pending.swap(mPendingFlushLayers);
+            mFlushInProgress = true;
+        }
+        for (const int32_t layerId : pending) {
+            flushLayerRecord(layerId);
+        }
+        pending.clear();
+        {
+            std::lock_guard<std::mutex> lock(mFlushMutex);
+            mFlushInProgress = false;
+        }
+        mFlushCondition.notify_all();
     }
 }
 
@@ -470,20 +562,33 @@ void TimeStats::setPostTime(int32_t layerId, uint64_t frameNumber, const std::st
     ALOGV("[%d]-[%" PRIu64 "]-[%s]-PostTime[%" PRId64 "]", layerId, frameNumber, layerName.c_str(),
           postTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStats.stats.count(layerName) && mTimeStats.stats.size() >= MAX_NUM_LAYER_STATS) {
-        return;
+    // Layers already in the stats pool are still admitted when the pool is
+    // full. The membership check needs mMutex, so only take it on the rare
+    // at-capacity path.
+    if (mLayerStatsCount.load() >= MAX_NUM_LAYER_STATS) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mTimeStats.stats.count(layerName) &&
+            mTimeStats.stats.size() >= MAX_NUM_LAYER_STATS) {
+            return;
+        }
     }
-    if (!mTimeStatsTracker.count(layerId) && mTimeStatsTracker.size() < MAX_NUM_LAYER_RECORDS &&
-        layerNameIsValid(layerName)) {
-        mTimeStatsTracker[layerId].layerName = layerName;
+    Stripe& stripe = stripeForLayer(layerId);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto it = stripe.tracker.find(layerId);
+    if (it == stripe.tracker.end()) {
+        if (mTrackedLayerRecords.load() >= MAX_NUM_LAYER_RECORDS || !layerNameIsValid(layerName)) {
+            return;
+        }
+        it = stripe.tracker.emplace(layerId, LayerRecord()).first;
+        it->second.layerName = layerName;
+        mTrackedLayerRecords++;
     }
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.timeRecords.size() == MAX_NUM_TIME_RECORDS) {
         ALOGE("[%d]-[%s]-timeRecords is at its maximum size[%zu]. Ignore this when unittesting.",
               layerId, layerRecord.layerName.c_str(), MAX_NUM_TIME_RECORDS);
-        mTimeStatsTracker.erase(layerId);
+        stripe.tracker.erase(it);
+        mTrackedLayerRecords--;
         return;
     }
     // For most media content, the acquireFence is invalid because the buffer is
@@ -511,9 +616,11 @@ void TimeStats::setLatchTime(int32_t layerId, uint64_t frameNumber, nsecs_t latc
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-LatchTime[%" PRId64 "]", layerId, frameNumber, latchTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    Stripe& stripe = stripeForLayer(layerId);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto it = stripe.tracker.find(layerId);
+    if (it == stripe.tracker.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -530,9 +637,11 @@ void TimeStats::incrementLatchSkipped(int32_t layerId, LatchSkipReason reason) {
     ALOGV("[%d]-LatchSkipped-Reason[%d]", layerId,
           static_cast<std::underlying_type<LatchSkipReason>::type>(reason));
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    Stripe& stripe = stripeForLayer(layerId);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto it = stripe.tracker.find(layerId);
+    if (it == stripe.tracker.end()) return;
+    LayerRecord& layerRecord = it->second;
 
     switch (reason) {
         case LatchSkipReason::LateAcquire:
@@ -547,9 +656,11 @@ void TimeStats::incrementBadDesiredPresent(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-BadDesiredPresent", layerId);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    Stripe& stripe = stripeForLayer(layerId);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto it = stripe.tracker.find(layerId);
+    if (it == stripe.tracker.end()) return;
+    LayerRecord& layerRecord = it->second;
     layerRecord.badDesiredPresentFrames++;
 }
 
@@ -559,9 +670,11 @@ void TimeStats::setDesiredTime(int32_t layerId, uint64_t frameNumber, nsecs_t de
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-DesiredTime[%" PRId64 "]", layerId, frameNumber, desiredTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    Stripe& stripe = stripeForLayer(layerId);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto it = stripe.tracker.find(layerId);
+    if (it == stripe.tracker.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -577,9 +690,11 @@ void TimeStats::setAcquireTime(int32_t layerId, uint64_t frameNumber, nsecs_t ac
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-AcquireTime[%" PRId64 "]", layerId, frameNumber, acquireTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    Stripe& stripe = stripeForLayer(layerId);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto it = stripe.tracker.find(layerId);
+    if (it == stripe.tracker.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -597,9 +712,11 @@ void TimeStats::setAcquireFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-AcquireFenceTime[%" PRId64 "]", layerId, frameNumber,
           acquireFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    Stripe& stripe = stripeForLayer(layerId);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto it = stripe.tracker.find(layerId);
+    if (it == stripe.tracker.end()) return;
+    LayerRecord& layerRecord = it->second;
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -615,20 +732,24 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-PresentTime[%" PRId64 "]", layerId, frameNumber, presentTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.frameTime.presentTime = presentTime;
-        timeRecord.ready = true;
-        layerRecord.waitData++;
+    {
+        Stripe& stripe = stripeForLayer(layerId);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        auto it = stripe.tracker.find(layerId);
+        if (it == stripe.tracker.end()) return;
+        LayerRecord& layerRecord = it->second;
+        if (layerRecord.waitData < 0 ||
+            layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
+            return;
+        TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
+        if (timeRecord.frameTime.frameNumber == frameNumber) {
+            timeRecord.frameTime.presentTime = presentTime;
+            timeRecord.ready = true;
+            layerRecord.waitData++;
+        }
     }
 
-    flushAvailableRecordsToStatsLocked(layerId);
+    scheduleLayerFlush(layerId);
 }
 
 void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
@@ -639,27 +760,37 @@ void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-PresentFenceTime[%" PRId64 "]", layerId, frameNumber,
           presentFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
-    if (layerRecord.waitData < 0 ||
-        layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
-        return;
-    TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
-    if (timeRecord.frameTime.frameNumber == frameNumber) {
-        timeRecord.presentFence = presentFence;
-        timeRecord.ready = true;
-        layerRecord.waitData++;
+    {
+        Stripe& stripe = stripeForLayer(layerId);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        auto it = stripe.tracker.find(layerId);
+        if (it == stripe.tracker.end()) return;
+        LayerRecord& layerRecord = it->second;
+        if (layerRecord.waitData < 0 ||
+            layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
+            return;
+        TimeRecord& timeRecord = layerRecord.timeRecords[layerRecord.waitData];
+        if (timeRecord.frameTime.frameNumber == frameNumber) {
+            timeRecord.presentFence = presentFence;
+            timeRecord.ready = true;
+            layerRecord.waitData++;
+        }
     }
 
-    flushAvailableRecordsToStatsLocked(layerId);
+    scheduleLayerFlush(layerId);
 }
 
 void TimeStats::onDestroy(int32_t layerId) {
     ATRACE_CALL();
     ALOGV("[%d]-onDestroy", layerId);
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStatsTracker.erase(layerId);
+    // Flush whatever already completed so the layer's last frames are not
+    // dropped along with the record.
+    flushLayerRecord(layerId);
+    Stripe& stripe = stripeForLayer(layerId);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    if (stripe.tracker.erase(layerId)) {
+        mTrackedLayerRecords--;
+    }
 }
 
 void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
@@ -668,9 +799,11 @@ void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
     ATRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-removeTimeRecord", layerId, frameNumber);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    Stripe& stripe = stripeForLayer(layerId);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto it = stripe.tracker.find(layerId);
+    if (it == stripe.tracker.end()) return;
+    LayerRecord& layerRecord = it->second;
     size_t removeAt = 0;
     for (const TimeRecord& record : layerRecord.timeRecords) {
         if (record.frameTime.frameNumber == frameNumber) break;
@@ -870,8 +1003,14 @@ void TimeStats::clearGlobalLocked() {
 void TimeStats::clearLayersLocked() {
     ATRACE_CALL();
 
-    mTimeStatsTracker.clear();
+    for (Stripe& stripe : mStripes) {
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        mTrackedLayerRecords -= stripe.tracker.size();
+        stripe.tracker.clear();
+    }
     mTimeStats.stats.clear();
+    mLayerStatsCount = 0;
+    mClearGeneration++;
     ALOGD("Cleared layer stats");
 }
 
@@ -882,6 +1021,8 @@ bool TimeStats::isEnabled() {
 void TimeStats::dump(bool asProto, std::optional<uint32_t> maxLayers, std::string& result) {
     ATRACE_CALL();
 
+    flushPendingLayerRecords();
+
     std::lock_guard<std::mutex> lock(mMutex);
     if (mTimeStats.statsStart == 0) {
         return;
@@ -34,11 +34,16 @@
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <deque>
 #include <mutex>
 #include <optional>
+#include <thread>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 using namespace android::surfaceflinger;
 
@@ -154,6 +159,25 @@ class TimeStats : public android::TimeStats {
         std::deque<TimeRecord> timeRecords;
     };
 
+    // Per-layer deltas popped from a stripe, to be merged into mTimeStats
+    // under mMutex once the stripe lock has been dropped.
+    struct LayerFlush {
+        struct FrameDeltas {
+            int32_t postToAcquireMs = 0;
+            int32_t postToPresentMs = 0;
+            int32_t acquireToPresentMs = 0;
+            int32_t latchToPresentMs = 0;
+            int32_t desiredToPresentMs = 0;
+            int32_t presentToPresentMs = 0;
+        };
+
+        std::string layerName;
+        uint32_t droppedFrames = 0;
+        uint32_t lateAcquireFrames = 0;
+        uint32_t badDesiredPresentFrames = 0;
+        std::vector<FrameDeltas> frames;
+    };
+
     struct PowerTime {
         PowerMode powerMode = PowerMode::OFF;
         nsecs_t prevTime = 0;
@@ -273,7 +297,11 @@ private:
     AStatsManager_PullAtomCallbackReturn populateGlobalAtom(AStatsEventList* data);
     AStatsManager_PullAtomCallbackReturn populateLayerAtom(AStatsEventList* data);
     bool recordReadyLocked(int32_t layerId, TimeRecord* timeRecord);
-    void flushAvailableRecordsToStatsLocked(int32_t layerId);
+    void scheduleLayerFlush(int32_t layerId);
+    void flushLayerRecord(int32_t layerId);
+    void flushLayerBatchToStatsLocked(const LayerFlush& flush);
+    void flushPendingLayerRecords();
+    void flushThreadMain();
     void flushPowerTimeLocked();
     void flushAvailableGlobalRecordsToStatsLocked();
 
@@ -284,14 +312,43 @@ private:
     void clearLayersLocked();
     void dump(bool asProto, std::optional<uint32_t> maxLayers, std::string& result);
 
+    // Per-layer records are sharded into stripes keyed on layerId, each with
+    // its own lock. The present-path setters only touch the stripe owning the
+    // layer, so they never contend with dumpsys readers aggregating under
+    // mMutex.
+    struct Stripe {
+        std::mutex mutex;
+        // Hashmap for LayerRecord with layerId as the hash key
+        std::unordered_map<int32_t, LayerRecord> tracker;
+    };
+    static constexpr size_t kNumStripes = 8;
+    Stripe& stripeForLayer(int32_t layerId) {
+        return mStripes[static_cast<uint32_t>(layerId) % kNumStripes];
+    }
+
     std::atomic<bool> mEnabled = false;
     std::mutex mMutex;
     TimeStatsHelper::TimeStatsGlobal mTimeStats;
-    // Hashmap for LayerRecord with layerId as the hash key
-    std::unordered_map<int32_t, LayerRecord> mTimeStatsTracker;
+    std::array<Stripe, kNumStripes> mStripes;
+    // Shadows of sizes maintained under the locks above, so the caps can be
+    // checked in setPostTime without taking mMutex on the hot path.
+    std::atomic<size_t> mTrackedLayerRecords = 0;
+    std::atomic<size_t> mLayerStatsCount = 0;
+    // Bumped whenever the layer stats are cleared, so that an in-flight flush
+    // batch computed against the old stats is dropped instead of merged back.
+    std::atomic<uint32_t> mClearGeneration = 0;
     PowerTime mPowerTime;
     GlobalRecord mGlobalRecord;
 
+    // Completed records are aggregated into mTimeStats on this thread rather
+    // than in the present path. Readers drain the queue before dumping.
+    std::thread mFlushThread;
+    std::mutex mFlushMutex;
+    std::condition_variable mFlushCondition;
+    bool mFlushRunning = true;
+    bool mFlushInProgress = false;
+    std::vector<int32_t> mPendingFlushLayers;
+
     static const size_t MAX_NUM_LAYER_RECORDS = 200;
     static const size_t MAX_NUM_LAYER_STATS = 200;
     std::unique_ptr<StatsEventDelegate> mStatsDelegate = std::make_unique<StatsEventDelegate>();
@@ -25,7 +25,9 @@
 
 #include "TransactionCompletedThread.h"
 
+#include <chrono>
 #include <cinttypes>
+#include <limits>
 
 #include <binder/IInterface.h>
 #include <utils/RefBase.h>
@@ -45,6 +47,12 @@ static int compareCallbackIds(const std::vector<CallbackId>& c1,
     return c1.front() - c2.front();
 }
 
+// How long completed transaction stats may be held back so callbacks from
+// several frames can be combined into one binder call per listener, and the
+// batch size that forces a flush before the budget expires.
+static constexpr nsecs_t kBatchLatencyBudgetNs = ms2ns(4);
+static constexpr size_t kMaxBatchedTransactions = 16;
+
 TransactionCompletedThread::~TransactionCompletedThread() {
     std::lock_guard lockThread(mThreadMutex);
 
@@ -267,15 +275,25 @@ void TransactionCompletedThread::threadMain() {
     std::lock_guard lock(mMutex);
 
     while (mKeepRunning) {
-        mConditionVariable.wait(mMutex);
-        std::vector<ListenerStats> completedListenerStats;
+        if (mListenerBatches.empty()) {
+            mConditionVariable.wait(mMutex);
+        } else {
+            // Batches are waiting out their latency budget. Wake up in time
+            // to flush the oldest one even if no new frame arrives.
+            nsecs_t earliestAdded = std::numeric_limits<nsecs_t>::max();
+            for (const auto& [listener, batch] : mListenerBatches) {
+                earliestAdded = std::min(earliestAdded, batch.firstAddedTime);
+            }
+            const nsecs_t timeout = earliestAdded + kBatchLatencyBudgetNs - systemTime();
+            if (timeout > 0) {
+                mConditionVariable.wait_for(mMutex, std::chrono::nanoseconds(timeout));
+            }
+        }
 
         // For each listener
         auto completedTransactionsItr = mCompletedTransactions.begin();
         while (completedTransactionsItr != mCompletedTransactions.end()) {
             auto& [listener, transactionStatsDeque] = *completedTransactionsItr;
-            ListenerStats listenerStats;
-            listenerStats.listener = listener;
 
             // For each transaction
             auto transactionStatsItr = transactionStatsDeque.begin();
@@ -305,44 +323,59 @@ void TransactionCompletedThread::threadMain() {
                     transactionStats.presentFence = mPresentFence;
                 }
 
-                // Remove the transaction from completed to the callback
-                listenerStats.transactionStats.push_back(std::move(transactionStats));
-                transactionStatsItr = transactionStatsDeque.erase(transactionStatsItr);
-            }
-            // If the listener has completed transactions
-            if (!listenerStats.transactionStats.empty()) {
-                // If the listener is still alive
-                if (listener->isBinderAlive()) {
-                    // Send callback.  The listener stored in listenerStats
-                    // comes from the cross-process setTransactionState call to
-                    // SF.  This MUST be an ITransactionCompletedListener.  We
-                    // keep it as an IBinder due to consistency reasons: if we
-                    // interface_cast at the IPC boundary when reading a Parcel,
-                    // we get pointers that compare unequal in the SF process.
-                    interface_cast<ITransactionCompletedListener>(listenerStats.listener)
-                            ->onTransactionCompleted(listenerStats);
-                    if (transactionStatsDeque.empty()) {
-                        listener->unlinkToDeath(mDeathRecipient);
-                        completedTransactionsItr =
-                                mCompletedTransactions.erase(completedTransactionsItr);
-                    } else {
-                        completedTransactionsItr++;
-                    }
-                } else {
-                    completedTransactionsItr =
-                            mCompletedTransactions.erase(completedTransactionsItr);
+                // Move the transaction from completed to the listener's batch
+                ListenerBatch& batch = mListenerBatches[listener];
+                if (batch.stats.transactionStats.empty()) {
+                    batch.stats.listener = listener;
+                    batch.firstAddedTime = systemTime();
                 }
-            } else {
-                completedTransactionsItr++;
+                batch.stats.transactionStats.push_back(std::move(transactionStats));
+                transactionStatsItr = transactionStatsDeque.erase(transactionStatsItr);
             }
-
-            completedListenerStats.push_back(std::move(listenerStats));
+            completedTransactionsItr++;
         }
 
         if (mPresentFence) {
             mPresentFence.clear();
         }
 
+        // Flush the batches whose latency budget has expired or that have
+        // grown large enough, one binder call per listener regardless of how
+        // many frames contributed to the batch.
+        std::vector<ListenerStats> flushedListenerStats;
+        const nsecs_t now = systemTime();
+        auto batchItr = mListenerBatches.begin();
+        while (batchItr != mListenerBatches.end()) {
+            auto& [listener, batch] = *batchItr;
+            if (now - batch.firstAddedTime < kBatchLatencyBudgetNs &&
+                batch.stats.transactionStats.size() < kMaxBatchedTransactions) {
+                batchItr++;
+                continue;
+            }
+
+            // If the listener is still alive
+            if (listener->isBinderAlive()) {
+                // Send callback.  The listener stored in listenerStats
+                // comes from the cross-process setTransactionState call to
+                // SF.  This MUST be an ITransactionCompletedListener.  We
+                // keep it as an IBinder due to consistency reasons: if we
+                // interface_cast at the IPC boundary when reading a Parcel,
+                // we get pointers that compare unequal in the SF process.
+                interface_cast<ITransactionCompletedListener>(batch.stats.listener)
+                        ->onTransactionCompleted(batch.stats);
+                auto completedItr = mCompletedTransactions.find(listener);
+                if (completedItr != mCompletedTransactions.end() && completedItr->second.empty()) {
+                    listener->unlinkToDeath(mDeathRecipient);
+                    mCompletedTransactions.erase(completedItr);
+                }
+            } else {
+                mCompletedTransactions.erase(listener);
+            }
+
+            flushedListenerStats.push_back(std::move(batch.stats));
+            batchItr = mListenerBatches.erase(batchItr);
+        }
+
         // If everyone else has dropped their reference to a layer and its listener is dead,
         // we are about to cause the layer to be deleted. If this happens at the wrong time and
         // we are holding mMutex, we will cause a deadlock.
@@ -354,7 +387,7 @@ void TransactionCompletedThread::threadMain() {
         // To avoid this deadlock, we need to unlock mMutex when dropping our last reference to
         // to the layer.
         mMutex.unlock();
-        completedListenerStats.clear();
+        flushedListenerStats.clear();
         mMutex.lock();
     }
 }
@@ -126,6 +126,15 @@ private:
     std::unordered_map<sp<IBinder>, std::deque<TransactionStats>, IListenerHash>
             mCompletedTransactions GUARDED_BY(mMutex);
 
+    // Completed transaction stats held back briefly so the callbacks of
+    // several frames can be sent to a listener in a single binder call.
+    struct ListenerBatch {
+        ListenerStats stats;
+        nsecs_t firstAddedTime = -1;
+    };
+    std::unordered_map<sp<IBinder>, ListenerBatch, IListenerHash> mListenerBatches
+            GUARDED_BY(mMutex);
+
     bool mRunning GUARDED_BY(mMutex) = false;
     bool mKeepRunning GUARDED_BY(mMutex) = true;
 
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//#define LOG_NDEBUG 0
+#undef LOG_TAG
+#define LOG_TAG "TransactionFenceWatcher"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "TransactionFenceWatcher.h"
+
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <log/log.h>
+
+namespace android {
+
+TransactionFenceWatcher::TransactionFenceWatcher()
+      : mWakeEventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+    LOG_ALWAYS_FATAL_IF(!mWakeEventFd.ok(), "Failed to create wake eventfd: %s", strerror(errno));
+}
+
+TransactionFenceWatcher::~TransactionFenceWatcher() {
+    {
+        std::lock_guard lock(mMutex);
+        mShutdown = true;
+    }
+    wake();
+    std::lock_guard lockThread(mThreadMutex);
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+std::shared_ptr<const std::atomic<uint32_t>> TransactionFenceWatcher::watch(
+        const std::vector<sp<Fence>>& fences, std::function<void()> onAllSignaled) {
+    auto remaining = std::make_shared<std::atomic<uint32_t>>(0);
+    auto callback = std::make_shared<const std::function<void()>>(std::move(onAllSignaled));
+    std::vector<FenceWatch> watches;
+    for (const sp<Fence>& fence : fences) {
+        if (fence == nullptr || fence->get() < 0) {
+            continue;
+        }
+        if (fence->getStatus() != Fence::Status::Unsignaled) {
+            continue;
+        }
+        watches.push_back({fence, remaining, callback});
+    }
+    if (watches.empty()) {
+        return nullptr;
+    }
+    remaining->store(static_cast<uint32_t>(watches.size()));
+
+    {
+        std::lock_guard lock(mMutex);
+        mPendingWatches.insert(mPendingWatches.end(), std::make_move_iterator(watches.begin()),
+                               std::make_move_iterator(watches.end()));
+    }
+    {
+        std::lock_guard lockThread(mThreadMutex);
+        if (!mThread.joinable()) {
+            mThread = std::thread(&TransactionFenceWatcher::threadMain, this);
+        }
+    }
+    wake();
+    return remaining;
+}
+
+void TransactionFenceWatcher::wake() {
+    const uint64_t one = 1;
+    if (TEMP_FAILURE_RETRY(write(mWakeEventFd.get(), &one, sizeof(one))) < 0 && errno != EAGAIN) {
+        ALOGW("Failed to wake fence watcher: %s", strerror(errno));
+    }
+}
+
+void TransactionFenceWatcher::threadMain() {
+    pthread_setname_np(pthread_self(), "TxFenceWatcher");
+
+    std::vector<FenceWatch> active;
+    std::vector<struct pollfd> pollFds;
+    while (true) {
+        {
+            std::lock_guard lock(mMutex);
+            if (mShutdown) {
+                return;
+            }
+            active.insert(active.end(), std::make_move_iterator(mPendingWatches.begin()),
+                          std::make_move_iterator(mPendingWatches.end()));
+            mPendingWatches.clear();
+        }
+
+        pollFds.clear();
+        pollFds.push_back({mWakeEventFd.get(), POLLIN, 0});
+        for (const FenceWatch& watch : active) {
+            pollFds.push_back({watch.fence->get(), POLLIN, 0});
+        }
+        if (poll(pollFds.data(), pollFds.size(), -1) < 0) {
+            if (errno != EINTR) {
+                ALOGE("poll failed: %s", strerror(errno));
+            }
+            continue;
+        }
+
+        if (pollFds[0].revents != 0) {
+            uint64_t counter;
+            while (read(mWakeEventFd.get(), &counter, sizeof(counter)) > 0) {
+            }
+        }
+
+        // Treat any returned event (including poll errors) as "signaled", so that a
+        // fence stuck in the error state cannot leave its transaction unready forever.
+        // Iterate backwards so erasing does not disturb the fd <-> watch mapping.
+        for (size_t i = active.size(); i > 0; i--) {
+            if (pollFds[i].revents == 0) {
+                continue;
+            }
+            FenceWatch& watch = active[i - 1];
+            if (watch.remaining->fetch_sub(1) == 1) {
+                (*watch.onAllSignaled)();
+            }
+            active.erase(active.begin() + (i - 1));
+        }
+    }
+}
+
+} // namespace android
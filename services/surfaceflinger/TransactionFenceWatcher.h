@@ -0,0 +1,80 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+#include <ui/Fence.h>
+
+namespace android {
+
+/**
+ * Watches the acquire fences of queued transactions on a dedicated thread so that the
+ * main thread can test a transaction's fence readiness with one atomic load per frame
+ * instead of polling every fence of every pending transaction.
+ *
+ * A set of fences is registered with watch(), which returns a counter of the fences in
+ * the set that have not yet signaled.  The watcher polls the fence fds and decrements
+ * the counter as they signal; once it reaches zero the registered callback fires (on
+ * the watcher thread) so the caller can schedule another flush.
+ */
+class TransactionFenceWatcher {
+public:
+    TransactionFenceWatcher();
+    ~TransactionFenceWatcher();
+
+    // Registers the unsignaled fences among `fences`.  Returns nullptr when every
+    // fence has already signaled (or is invalid), meaning there is nothing to wait
+    // for; otherwise returns the counter described above.  The callback is invoked
+    // exactly once, from the watcher thread, after the last fence signals.
+    std::shared_ptr<const std::atomic<uint32_t>> watch(const std::vector<sp<Fence>>& fences,
+                                                       std::function<void()> onAllSignaled);
+
+private:
+    // One polled fence.  Entries registered by the same watch() call share the
+    // counter and the callback.
+    struct FenceWatch {
+        sp<Fence> fence; // keeps the fd alive while it is polled
+        std::shared_ptr<std::atomic<uint32_t>> remaining;
+        std::shared_ptr<const std::function<void()>> onAllSignaled;
+    };
+
+    void threadMain();
+    void wake();
+
+    // Protects the creation and destruction of mThread.  The thread is only spawned
+    // once the first unsignaled fence is registered.
+    std::mutex mThreadMutex;
+    std::thread mThread GUARDED_BY(mThreadMutex);
+
+    std::mutex mMutex;
+    // Watches registered since the thread last woke; drained by the thread.
+    std::vector<FenceWatch> mPendingWatches GUARDED_BY(mMutex);
+    bool mShutdown GUARDED_BY(mMutex) = false;
+
+    // Wakes the poll loop when watches are added or the watcher shuts down.
+    base::unique_fd mWakeEventFd;
+};
+
+} // namespace android
@@ -22,7 +22,9 @@
 #define LOG_TAG "LibSurfaceFlingerUnittests"
 
 #include <FrameTracer/FrameTracer.h>
+#include <android-base/stringprintf.h>
 #include <gmock/gmock.h>
+#include <inttypes.h>
 #include <gtest/gtest.h>
 #include <log/log.h>
 #include <perfetto/trace/trace.pb.h>
@@ -396,6 +398,84 @@ TEST_F(FrameTracerTest, traceFenceWithValidStartTime_ShouldHaveCorrectDuration)
     EXPECT_EQ(buffer_event2.duration_ns(), duration);
 }
 
+TEST_F(FrameTracerTest, ringBufferRecordsWithoutTracingSession) {
+    const int32_t layerId = 5;
+    const uint32_t bufferID = 4;
+    const uint64_t frameNumber = 3;
+    const nsecs_t timestamp = 1234;
+    const nsecs_t duration = 56;
+    const auto type = FrameTracer::FrameEvent::POST;
+
+    // No ring, no perfetto session: nothing is captured.
+    mFrameTracer->traceTimestamp(layerId, bufferID, frameNumber, timestamp, type, duration);
+    EXPECT_EQ(mFrameTracer->miniDump().find("Ring buffer"), std::string::npos);
+
+    mFrameTracer->setRingBufferEnabled(true);
+    EXPECT_TRUE(mFrameTracer->isRingBufferEnabled());
+
+    // With the ring enabled, events are retained even though no perfetto
+    // session is running.
+    mFrameTracer->traceTimestamp(layerId, bufferID, frameNumber, timestamp, type, duration);
+
+    const std::string dump = mFrameTracer->miniDump();
+    EXPECT_NE(dump.find("Ring buffer: 1 events recorded, 1 retained"), std::string::npos);
+    EXPECT_NE(dump.find(base::StringPrintf("layer=5 buffer=4 frame=3 type=%d timestamp=1234 "
+                                           "duration=56",
+                                           static_cast<int>(type))),
+              std::string::npos);
+
+    mFrameTracer->setRingBufferEnabled(false);
+    EXPECT_EQ(mFrameTracer->miniDump().find("Ring buffer"), std::string::npos);
+}
+
+TEST_F(FrameTracerTest, ringBufferResolvesFencesOnceSignalled) {
+    const int32_t layerId = 5;
+    const uint32_t bufferID = 4;
+    const uint64_t frameNumber = 3;
+    const auto type = FrameTracer::FrameEvent::ACQUIRE_FENCE;
+    const nsecs_t duration = 1234;
+
+    mFrameTracer->setRingBufferEnabled(true);
+
+    auto fence = fenceFactory.createFenceTimeForTest(Fence::NO_FENCE);
+    const nsecs_t signalTime = systemTime();
+    const nsecs_t startTime = signalTime - duration;
+    mFrameTracer->traceFence(layerId, bufferID, frameNumber, fence, type, startTime);
+
+    // Still pending, so nothing is recorded yet.
+    EXPECT_NE(mFrameTracer->miniDump().find("Ring buffer: 0 events recorded"), std::string::npos);
+
+    fenceFactory.signalAllForTest(Fence::NO_FENCE, signalTime);
+    // A later event on the same layer resolves the pending fence.
+    mFrameTracer->traceTimestamp(layerId, bufferID, 0, 0, FrameTracer::FrameEvent::UNSPECIFIED);
+
+    const std::string dump = mFrameTracer->miniDump();
+    EXPECT_NE(dump.find("Ring buffer: 2 events recorded, 2 retained"), std::string::npos);
+    EXPECT_NE(dump.find(base::StringPrintf("timestamp=%" PRId64 " duration=%" PRId64, startTime,
+                                           duration)),
+              std::string::npos);
+}
+
+TEST_F(FrameTracerTest, ringBufferOverwritesOldestRecords) {
+    const int32_t layerId = 5;
+    const auto type = FrameTracer::FrameEvent::POST;
+
+    mFrameTracer->setRingBufferEnabled(true);
+
+    const size_t eventCount = FrameTracer::kRingShardCapacity + 10;
+    for (size_t i = 0; i < eventCount; ++i) {
+        mFrameTracer->traceTimestamp(layerId, /*bufferID=*/1, /*frameNumber=*/i, nsecs_t(i), type);
+    }
+
+    const std::string dump = mFrameTracer->miniDump();
+    EXPECT_NE(dump.find(base::StringPrintf("Ring buffer: %zu events recorded, %zu retained",
+                                           eventCount, FrameTracer::kRingShardCapacity)),
+              std::string::npos);
+    // The oldest ten events were overwritten.
+    EXPECT_EQ(dump.find("frame=9 "), std::string::npos);
+    EXPECT_NE(dump.find("frame=10 "), std::string::npos);
+}
+
 } // namespace
 } // namespace android
 
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "SchedulerUnittests"
+
+#include <gmock/gmock.h>
+#include <log/log.h>
+
+#include "FakePhaseOffsets.h"
+#include "Scheduler/PhaseOffsetTuner.h"
+
+using namespace testing;
+
+namespace android {
+namespace scheduler {
+
+class TestablePhaseOffsetTuner : public PhaseOffsetTuner {
+public:
+    using PhaseOffsetTuner::kAdvanceStepNs;
+    using PhaseOffsetTuner::kBackoffStepNs;
+    using PhaseOffsetTuner::kCooldownWindows;
+    using PhaseOffsetTuner::kFramesPerWindow;
+    using PhaseOffsetTuner::maxAdvance;
+
+    explicit TestablePhaseOffsetTuner(const PhaseConfiguration& phaseConfiguration)
+          : PhaseOffsetTuner(phaseConfiguration) {}
+};
+
+class PhaseOffsetTunerTest : public testing::Test {
+protected:
+    static constexpr float kFps = 60.0f;
+    static constexpr nsecs_t kVsyncPeriod = 16'666'667;
+    static constexpr nsecs_t kBaseline = FakePhaseOffsets::FAKE_PHASE_OFFSET_NS;
+
+    // Feeds one window of on-time frames. Returns whether the last frame
+    // changed the tuned offsets.
+    bool runCleanWindow() {
+        bool changed = false;
+        for (size_t i = 0; i < TestablePhaseOffsetTuner::kFramesPerWindow; i++) {
+            changed = mTuner.onFrameCompleted(kFps, kVsyncPeriod, false);
+        }
+        return changed;
+    }
+
+    int64_t tunedOffset() { return mTuner.getTunedSfOffsets().at(kFps); }
+
+    FakePhaseOffsets mPhaseOffsets;
+    TestablePhaseOffsetTuner mTuner{mPhaseOffsets};
+};
+
+namespace {
+/* ------------------------------------------------------------------------
+ * Test cases
+ */
+TEST_F(PhaseOffsetTunerTest, advancesAfterCleanWindow) {
+    EXPECT_TRUE(runCleanWindow());
+    EXPECT_EQ(kBaseline + TestablePhaseOffsetTuner::kAdvanceStepNs, tunedOffset());
+
+    EXPECT_TRUE(runCleanWindow());
+    EXPECT_EQ(kBaseline + 2 * TestablePhaseOffsetTuner::kAdvanceStepNs, tunedOffset());
+}
+
+TEST_F(PhaseOffsetTunerTest, doesNotAdvanceMidWindow) {
+    for (size_t i = 0; i + 1 < TestablePhaseOffsetTuner::kFramesPerWindow; i++) {
+        EXPECT_FALSE(mTuner.onFrameCompleted(kFps, kVsyncPeriod, false));
+    }
+}
+
+TEST_F(PhaseOffsetTunerTest, missedFrameBacksOff) {
+    EXPECT_TRUE(runCleanWindow());
+    EXPECT_TRUE(runCleanWindow());
+    EXPECT_TRUE(runCleanWindow());
+    EXPECT_EQ(kBaseline + 3 * TestablePhaseOffsetTuner::kAdvanceStepNs, tunedOffset());
+
+    EXPECT_TRUE(mTuner.onFrameCompleted(kFps, kVsyncPeriod, true));
+    EXPECT_EQ(kBaseline + 3 * TestablePhaseOffsetTuner::kAdvanceStepNs -
+                      TestablePhaseOffsetTuner::kBackoffStepNs,
+              tunedOffset());
+}
+
+TEST_F(PhaseOffsetTunerTest, neverDropsBelowBaseline) {
+    EXPECT_TRUE(runCleanWindow());
+
+    // First miss removes the full advance, further misses are a no-op.
+    EXPECT_TRUE(mTuner.onFrameCompleted(kFps, kVsyncPeriod, true));
+    EXPECT_FALSE(mTuner.onFrameCompleted(kFps, kVsyncPeriod, true));
+    EXPECT_EQ(kBaseline, tunedOffset());
+}
+
+TEST_F(PhaseOffsetTunerTest, backoffStartsCooldown) {
+    EXPECT_TRUE(runCleanWindow());
+    EXPECT_TRUE(mTuner.onFrameCompleted(kFps, kVsyncPeriod, true));
+
+    for (size_t i = 0; i < TestablePhaseOffsetTuner::kCooldownWindows; i++) {
+        EXPECT_FALSE(runCleanWindow());
+    }
+    EXPECT_TRUE(runCleanWindow());
+    EXPECT_EQ(kBaseline + TestablePhaseOffsetTuner::kAdvanceStepNs, tunedOffset());
+}
+
+TEST_F(PhaseOffsetTunerTest, advanceIsCapped) {
+    const nsecs_t limit = TestablePhaseOffsetTuner::maxAdvance(kVsyncPeriod);
+    const size_t windows = limit / TestablePhaseOffsetTuner::kAdvanceStepNs + 2;
+    for (size_t i = 0; i < windows; i++) {
+        runCleanWindow();
+    }
+    EXPECT_EQ(kBaseline + limit, tunedOffset());
+    EXPECT_FALSE(runCleanWindow());
+}
+
+TEST_F(PhaseOffsetTunerTest, tracksRefreshRatesIndependently) {
+    EXPECT_TRUE(runCleanWindow());
+
+    // A miss at 90Hz must not disturb the 60Hz advance.
+    EXPECT_FALSE(mTuner.onFrameCompleted(90.0f, 11'111'111, true));
+    EXPECT_EQ(kBaseline + TestablePhaseOffsetTuner::kAdvanceStepNs, tunedOffset());
+    EXPECT_EQ(kBaseline, mTuner.getTunedSfOffsets().at(90.0f));
+}
+
+} // namespace
+} // namespace scheduler
+} // namespace android
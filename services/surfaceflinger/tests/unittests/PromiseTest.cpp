@@ -41,7 +41,25 @@ TEST(PromiseTest, yield) {
 
     auto ptr = std::make_unique<char>('!');
     auto future = promise::yield(std::move(ptr));
-    EXPECT_EQ('!', *future.get());
+    EXPECT_EQ('!', *std::move(future).get());
+}
+
+TEST(PromiseTest, thenResolvesInline) {
+    // Continuations on an already-resolved future run inline at the point of
+    // the then() call, on the calling thread.
+    const auto mainThreadId = std::this_thread::get_id();
+    std::thread::id continuationThreadId;
+
+    EXPECT_EQ("hello, world!",
+              promise::yield(std::string("hello"))
+                      .then([](std::string str) { return str + ", world"; })
+                      .then([&](std::string str) {
+                          continuationThreadId = std::this_thread::get_id();
+                          return promise::yield(str + "!");
+                      })
+                      .get());
+
+    EXPECT_EQ(mainThreadId, continuationThreadId);
 }
 
 TEST(PromiseTest, chain) {
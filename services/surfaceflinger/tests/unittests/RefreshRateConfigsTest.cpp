@@ -1378,6 +1378,55 @@ TEST_F(RefreshRateConfigsTest, idle) {
                       .getConfigId());
 }
 
+TEST_F(RefreshRateConfigsTest, thermalHeadroomBiasesScoring) {
+    auto refreshRateConfigs =
+            std::make_unique<RefreshRateConfigs>(m60_90Device,
+                                                 /*currentConfigId=*/HWC_CONFIG_ID_60);
+
+    auto layers = std::vector<LayerRequirement>{LayerRequirement{.weight = 1.0f}};
+    layers[0].name = "Test layer";
+    layers[0].vote = LayerVoteType::Max;
+
+    // With full headroom the Max vote wins the highest refresh rate.
+    EXPECT_EQ(HWC_CONFIG_ID_90, refreshRateConfigs->getBestRefreshRate(layers, {}).getConfigId());
+
+    // Moderate throttling biases the scores but still lets the Max vote win.
+    EXPECT_TRUE(refreshRateConfigs->setThermalHeadroom(0.7f));
+    EXPECT_EQ(HWC_CONFIG_ID_90, refreshRateConfigs->getBestRefreshRate(layers, {}).getConfigId());
+
+    // Once the headroom shrinks enough the bias flips the choice to the lower rate. The
+    // higher rate is still allowed by the policy, just penalized in scoring.
+    EXPECT_TRUE(refreshRateConfigs->setThermalHeadroom(0.3f));
+    EXPECT_EQ(HWC_CONFIG_ID_60, refreshRateConfigs->getBestRefreshRate(layers, {}).getConfigId());
+    EXPECT_TRUE(refreshRateConfigs->isConfigAllowed(HWC_CONFIG_ID_90));
+
+    // Recovering the headroom restores the higher rate.
+    EXPECT_TRUE(refreshRateConfigs->setThermalHeadroom(1.0f));
+    EXPECT_EQ(HWC_CONFIG_ID_90, refreshRateConfigs->getBestRefreshRate(layers, {}).getConfigId());
+}
+
+TEST_F(RefreshRateConfigsTest, thermalHeadroomHysteresis) {
+    auto refreshRateConfigs =
+            std::make_unique<RefreshRateConfigs>(m60_90Device,
+                                                 /*currentConfigId=*/HWC_CONFIG_ID_60);
+
+    // Updates within the hysteresis band around the applied headroom are ignored.
+    EXPECT_FALSE(refreshRateConfigs->setThermalHeadroom(0.97f));
+    EXPECT_FLOAT_EQ(1.0f, refreshRateConfigs->getThermalHeadroom());
+
+    EXPECT_TRUE(refreshRateConfigs->setThermalHeadroom(0.9f));
+    EXPECT_FALSE(refreshRateConfigs->setThermalHeadroom(0.88f));
+    EXPECT_FALSE(refreshRateConfigs->setThermalHeadroom(0.93f));
+    EXPECT_FLOAT_EQ(0.9f, refreshRateConfigs->getThermalHeadroom());
+
+    // The endpoints always apply, and out-of-range hints are clamped.
+    EXPECT_TRUE(refreshRateConfigs->setThermalHeadroom(-1.0f));
+    EXPECT_FLOAT_EQ(0.0f, refreshRateConfigs->getThermalHeadroom());
+    EXPECT_FALSE(refreshRateConfigs->setThermalHeadroom(0.03f));
+    EXPECT_TRUE(refreshRateConfigs->setThermalHeadroom(1.0f));
+    EXPECT_FLOAT_EQ(1.0f, refreshRateConfigs->getThermalHeadroom());
+}
+
 TEST_F(RefreshRateConfigsTest, findClosestKnownFrameRate) {
     auto refreshRateConfigs =
             std::make_unique<RefreshRateConfigs>(m60_90Device,
@@ -123,7 +123,7 @@ void RefreshRateSelectionTest::setParent(Layer* child, Layer* parent) {
 }
 
 void RefreshRateSelectionTest::commitTransaction(Layer* layer) {
-    layer->commitTransaction(layer->getCurrentState());
+    layer->commitTransaction(Layer::State(layer->getCurrentState()));
 }
 
 void RefreshRateSelectionTest::setupScheduler() {
@@ -158,7 +158,7 @@ void SetFrameRateTest::reparentChildren(sp<Layer> parent, sp<Layer> newParent) {
 
 void SetFrameRateTest::commitTransaction() {
     for (auto layer : mLayers) {
-        layer.get()->commitTransaction(layer.get()->getCurrentState());
+        layer.get()->commitTransaction(Layer::State(layer.get()->getCurrentState()));
     }
 }
 
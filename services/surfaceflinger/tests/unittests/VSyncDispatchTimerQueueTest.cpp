@@ -753,6 +753,29 @@ TEST_F(VSyncDispatchTimerQueueTest, rearmsWhenCancelledAndIsNextScheduled) {
     EXPECT_THAT(cb2.mCalls.size(), Eq(1));
 }
 
+TEST_F(VSyncDispatchTimerQueueTest, cancelReusesPendingAlarmWithinSlack) {
+    EXPECT_CALL(mStubTracker, nextAnticipatedVSyncTimeFrom(_))
+            .Times(2)
+            .WillOnce(Return(1000))
+            .WillOnce(Return(1002));
+    EXPECT_CALL(mMockClock, alarmAt(_, 900)).Times(1);
+
+    CountingCallback cb0(mDispatch);
+    CountingCallback cb1(mDispatch);
+
+    mDispatch.schedule(cb0, 100, 1000);
+    mDispatch.schedule(cb1, 100, 1000);
+
+    // cb1's wakeup of 902 groups into the slack window of the pending alarm at 900, so
+    // cancelling cb0 must not reprogram the timer.
+    EXPECT_EQ(mDispatch.cancel(cb0), CancelResult::Cancelled);
+
+    advanceToNextCallback();
+    EXPECT_THAT(cb0.mCalls.size(), Eq(0));
+    ASSERT_THAT(cb1.mCalls.size(), Eq(1));
+    EXPECT_THAT(cb1.mCalls[0], Eq(1002));
+}
+
 TEST_F(VSyncDispatchTimerQueueTest, laggedTimerGroupsCallbacksWithinLag) {
     CountingCallback cb1(mDispatch);
     CountingCallback cb2(mDispatch);
@@ -464,6 +464,45 @@ TEST_F(VSyncPredictorTest, InconsistentVsyncValueIsFlushedEventually) {
     EXPECT_FALSE(tracker.needsMoreSamples());
 }
 
+TEST_F(VSyncPredictorTest, reportsModelError) {
+    EXPECT_FALSE(tracker.getVSyncPredictionModelError().has_value());
+
+    for (auto i = 0u; i < kMinimumSamplesForPrediction; i++) {
+        tracker.addVsyncTimestamp(mNow += mPeriod);
+    }
+
+    auto const error = tracker.getVSyncPredictionModelError();
+    ASSERT_TRUE(error.has_value());
+    EXPECT_THAT(*error, Lt(kOutlierTolerancePercent));
+}
+
+TEST_F(VSyncPredictorTest, relearnsAConfidentRateFromFewerSamples) {
+    auto const relearnSamples = kMinimumSamplesForPrediction / 2;
+    for (auto i = 0u; i < kMinimumSamplesForPrediction; i++) {
+        tracker.addVsyncTimestamp(mNow += mPeriod);
+    }
+    EXPECT_FALSE(tracker.needsMoreSamples());
+
+    auto const changedPeriod = mPeriod * 2;
+    tracker.setPeriod(changedPeriod);
+    for (auto i = 0u; i < kMinimumSamplesForPrediction; i++) {
+        tracker.addVsyncTimestamp(mNow += changedPeriod);
+    }
+    EXPECT_FALSE(tracker.needsMoreSamples());
+
+    // Switching back to a rate whose model was confident needs fewer samples before
+    // hardware vsync can be turned off again.
+    tracker.setPeriod(mPeriod);
+    for (auto i = 0u; i < relearnSamples; i++) {
+        EXPECT_TRUE(tracker.needsMoreSamples());
+        tracker.addVsyncTimestamp(mNow += mPeriod);
+    }
+    EXPECT_FALSE(tracker.needsMoreSamples());
+
+    auto const [slope, intercept] = tracker.getVSyncPredictionModel();
+    EXPECT_THAT(slope, IsCloseTo(mPeriod, mMaxRoundingError));
+}
+
 } // namespace android::scheduler
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
@@ -31,6 +31,8 @@ public:
 
     MOCK_METHOD0(onBootFinished, void());
     MOCK_METHOD2(setExpensiveRenderingExpected, void(DisplayId displayId, bool expected));
+    MOCK_METHOD1(setGpuFrameMissed, void(bool missed));
+    MOCK_METHOD0(shouldReduceCompositionEffort, bool());
     MOCK_METHOD0(notifyDisplayUpdateImminent, void());
     MOCK_METHOD0(canNotifyDisplayUpdateImminent, bool());
 };
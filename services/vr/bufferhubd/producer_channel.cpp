@@ -539,7 +539,7 @@ Status<void> ProducerChannel::OnConsumerRelease(Message&,
   }
 
   if (IsBufferReleasedByAllActiveClientsExceptForOrphans()) {
-    buffer_state_->store(0U);
+    buffer_state_->store(0U, std::memory_order_release);
     SignalAvailable();
     if (orphaned_consumer_bit_mask_) {
       ALOGW(
@@ -564,7 +564,7 @@ void ProducerChannel::OnConsumerOrphaned(const uint32_t& consumer_state_mask) {
   orphaned_consumer_bit_mask_ |= consumer_state_mask;
 
   if (IsBufferReleasedByAllActiveClientsExceptForOrphans()) {
-    buffer_state_->store(0U);
+    buffer_state_->store(0U, std::memory_order_release);
     SignalAvailable();
   }
 
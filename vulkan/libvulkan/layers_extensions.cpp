@@ -23,12 +23,19 @@
 #include <dlfcn.h>
 #include <string.h>
 #include <sys/prctl.h>
+#include <sys/stat.h>
 
+#include <algorithm>
+#include <atomic>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include <android/dlext.h>
+#include <android-base/file.h>
 #include <android-base/strings.h>
 #include <cutils/properties.h>
 #include <graphicsenv/GraphicsEnv.h>
@@ -324,19 +331,246 @@ void* LayerLibrary::GetGPA(const Layer& layer, const std::string_view gpa_name)
 std::vector<LayerLibrary> g_layer_libraries;
 std::vector<Layer> g_instance_layers;
 
-void AddLayerLibrary(const std::string& path, const std::string& filename) {
-    LayerLibrary library(path + "/" + filename, filename);
-    if (!library.Open())
+// The maximum number of threads used to open and enumerate candidate layer
+// libraries in parallel.
+constexpr size_t kMaxScanThreads = 4;
+
+// A ScanResult holds one candidate layer library and the layers it exported,
+// filled in either from the manifest cache or by the parallel scan phase of
+// DiscoverLayersInPathList.
+struct ScanResult {
+    ScanResult(const std::string& path_, const std::string& filename)
+        : path(path_), library(path_, filename), enumerated(false), from_cache(false) {}
+    ScanResult(ScanResult&&) = default;
+
+    std::string path;
+    LayerLibrary library;
+    std::vector<Layer> layers;
+    bool enumerated;
+    bool from_cache;
+};
+
+// ----------------------------------------------------------------------------
+// Layer manifest cache
+//
+// Enumerating a library's layers requires dlopening it, which dominates
+// DiscoverLayers. The enumerated properties can only change when the library
+// file changes, so they are persisted in a small binary manifest keyed by
+// each library's mtime and size (plus the boot id, to bound staleness to one
+// boot). On a cache hit the library is not opened at all until one of its
+// layers is actually enabled through GetLayerRef.
+//
+// All cache state is only accessed with the layer discovery lock held by the
+// caller of DiscoverLayers.
+
+constexpr char kManifestCacheFile[] = "vulkan_layer_manifest.bin";
+constexpr uint32_t kManifestMagic = 0x564b4c4d;  // 'VKLM'
+constexpr uint32_t kManifestVersion = 1;
+// Upper bounds applied when parsing, so a corrupt file can't cause huge
+// allocations.
+constexpr uint32_t kManifestMaxEntries = 1024;
+
+struct LibraryKey {
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t size;
+
+    bool operator==(const LibraryKey& other) const {
+        return mtime_sec == other.mtime_sec && mtime_nsec == other.mtime_nsec &&
+               size == other.size;
+    }
+};
+
+struct CachedLibrary {
+    LibraryKey key;
+    std::vector<Layer> layers;
+};
+
+std::unordered_map<std::string, CachedLibrary> g_manifest_cache;
+bool g_manifest_cache_loaded = false;
+bool g_manifest_cache_dirty = false;
+
+bool GetLibraryKey(const std::string& path, LibraryKey* key) {
+    // A library inside an apk ("base.apk!/lib/...") is keyed on the apk
+    // itself, which is what carries the mtime.
+    size_t zip_pos = path.find("!/");
+    const std::string file =
+        (zip_pos == std::string::npos) ? path : path.substr(0, zip_pos);
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0)
+        return false;
+    key->mtime_sec = st.st_mtim.tv_sec;
+    key->mtime_nsec = st.st_mtim.tv_nsec;
+    key->size = st.st_size;
+    return true;
+}
+
+std::string GetManifestCachePath() {
+    const std::string& dir =
+        android::GraphicsEnv::getInstance().getLayerCacheDir();
+    if (dir.empty())
+        return "";
+    return dir + "/" + kManifestCacheFile;
+}
+
+std::string GetBootId() {
+    std::string boot_id;
+    if (!android::base::ReadFileToString("/proc/sys/kernel/random/boot_id",
+                                         &boot_id))
+        return "";
+    return android::base::Trim(boot_id);
+}
+
+template <typename T>
+void AppendPod(std::string* out, const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "");
+    out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendString(std::string* out, const std::string& str) {
+    AppendPod(out, static_cast<uint32_t>(str.size()));
+    out->append(str);
+}
+
+template <typename T>
+bool ReadPod(const std::string& in, size_t* pos, T* value) {
+    static_assert(std::is_trivially_copyable<T>::value, "");
+    if (in.size() - *pos < sizeof(T))
+        return false;
+    memcpy(value, in.data() + *pos, sizeof(T));
+    *pos += sizeof(T);
+    return true;
+}
+
+bool ReadCacheString(const std::string& in, size_t* pos, std::string* str) {
+    uint32_t size;
+    if (!ReadPod(in, pos, &size) || in.size() - *pos < size)
+        return false;
+    str->assign(in.data() + *pos, size);
+    *pos += size;
+    return true;
+}
+
+bool ReadExtensions(const std::string& in,
+                    size_t* pos,
+                    std::vector<VkExtensionProperties>* extensions) {
+    uint32_t count;
+    if (!ReadPod(in, pos, &count) || count > kManifestMaxEntries)
+        return false;
+    extensions->resize(count);
+    for (auto& ext : *extensions) {
+        if (!ReadPod(in, pos, &ext))
+            return false;
+        ext.extensionName[VK_MAX_EXTENSION_NAME_SIZE - 1] = '\0';
+    }
+    return true;
+}
+
+void LoadManifestCache() {
+    if (g_manifest_cache_loaded)
         return;
+    g_manifest_cache_loaded = true;
 
-    if (!library.EnumerateLayers(g_layer_libraries.size(), g_instance_layers)) {
-        library.Close();
+    const std::string cache_path = GetManifestCachePath();
+    if (cache_path.empty())
+        return;
+    std::string blob;
+    if (!android::base::ReadFileToString(cache_path, &blob))
+        return;
+
+    size_t pos = 0;
+    uint32_t magic, version, num_libraries;
+    std::string boot_id;
+    if (!ReadPod(blob, &pos, &magic) || magic != kManifestMagic ||
+        !ReadPod(blob, &pos, &version) || version != kManifestVersion ||
+        !ReadCacheString(blob, &pos, &boot_id) ||
+        !ReadPod(blob, &pos, &num_libraries) ||
+        num_libraries > kManifestMaxEntries) {
+        ALOGW("ignoring malformed layer manifest cache '%s'",
+              cache_path.c_str());
+        return;
+    }
+    if (boot_id != GetBootId()) {
+        ALOGV("layer manifest cache '%s' is from a previous boot",
+              cache_path.c_str());
         return;
     }
 
-    library.Close();
+    std::unordered_map<std::string, CachedLibrary> cache;
+    for (uint32_t i = 0; i < num_libraries; i++) {
+        std::string path;
+        CachedLibrary library;
+        uint32_t num_layers;
+        if (!ReadCacheString(blob, &pos, &path) ||
+            !ReadPod(blob, &pos, &library.key) ||
+            !ReadPod(blob, &pos, &num_layers) ||
+            num_layers > kManifestMaxEntries) {
+            ALOGW("ignoring malformed layer manifest cache '%s'",
+                  cache_path.c_str());
+            return;
+        }
+        library.layers.resize(num_layers);
+        for (Layer& layer : library.layers) {
+            uint8_t is_global;
+            if (!ReadPod(blob, &pos, &layer.properties) ||
+                !ReadPod(blob, &pos, &is_global) ||
+                !ReadExtensions(blob, &pos, &layer.instance_extensions) ||
+                !ReadExtensions(blob, &pos, &layer.device_extensions)) {
+                ALOGW("ignoring malformed layer manifest cache '%s'",
+                      cache_path.c_str());
+                return;
+            }
+            layer.properties.layerName[VK_MAX_EXTENSION_NAME_SIZE - 1] = '\0';
+            layer.properties.description[VK_MAX_DESCRIPTION_SIZE - 1] = '\0';
+            layer.library_idx = 0;
+            layer.is_global = (is_global != 0);
+        }
+        cache.emplace(std::move(path), std::move(library));
+    }
+    g_manifest_cache = std::move(cache);
+}
+
+void SaveManifestCache() {
+    if (!g_manifest_cache_dirty)
+        return;
+    g_manifest_cache_dirty = false;
+
+    const std::string cache_path = GetManifestCachePath();
+    if (cache_path.empty())
+        return;
 
-    g_layer_libraries.emplace_back(std::move(library));
+    std::string blob;
+    AppendPod(&blob, kManifestMagic);
+    AppendPod(&blob, kManifestVersion);
+    AppendString(&blob, GetBootId());
+    AppendPod(&blob, static_cast<uint32_t>(g_manifest_cache.size()));
+    for (const auto& [path, library] : g_manifest_cache) {
+        AppendString(&blob, path);
+        AppendPod(&blob, library.key);
+        AppendPod(&blob, static_cast<uint32_t>(library.layers.size()));
+        for (const Layer& layer : library.layers) {
+            AppendPod(&blob, layer.properties);
+            AppendPod(&blob, static_cast<uint8_t>(layer.is_global ? 1 : 0));
+            AppendPod(&blob,
+                      static_cast<uint32_t>(layer.instance_extensions.size()));
+            for (const auto& ext : layer.instance_extensions)
+                AppendPod(&blob, ext);
+            AppendPod(&blob,
+                      static_cast<uint32_t>(layer.device_extensions.size()));
+            for (const auto& ext : layer.device_extensions)
+                AppendPod(&blob, ext);
+        }
+    }
+
+    // Write through a temp file so a concurrent reader never sees a torn
+    // manifest.
+    const std::string temp_path = cache_path + ".tmp";
+    if (!android::base::WriteStringToFile(blob, temp_path) ||
+        rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+        ALOGW("failed to persist layer manifest cache '%s'",
+              cache_path.c_str());
+        unlink(temp_path.c_str());
+    }
 }
 
 template <typename Functor>
@@ -411,6 +645,9 @@ void ForEachFileInPath(const std::string& path, Functor functor) {
 void DiscoverLayersInPathList(const std::string& pathstr) {
     ATRACE_CALL();
 
+    // Gather the candidate libraries first so they can be opened and
+    // enumerated in parallel below.
+    std::vector<ScanResult> candidates;
     std::vector<std::string> paths = android::base::Split(pathstr, ":");
     for (const auto& path : paths) {
         ForEachFileInPath(path, [&](const std::string& filename) {
@@ -432,12 +669,91 @@ void DiscoverLayersInPathList(const std::string& pathstr) {
                         duplicate = true;
                     }
                 }
+                for (auto& candidate : candidates) {
+                    if (candidate.library.GetFilename() == filename) {
+                        ALOGV("Skipping duplicate layer %s in %s",
+                              filename.c_str(), path.c_str());
+                        duplicate = true;
+                    }
+                }
 
                 if (!duplicate)
-                    AddLayerLibrary(path, filename);
+                    candidates.emplace_back(path + "/" + filename, filename);
             }
         });
     }
+    if (candidates.empty())
+        return;
+
+    // Satisfy candidates from the manifest cache first; those libraries are
+    // not opened until one of their layers is enabled.
+    LoadManifestCache();
+    for (ScanResult& candidate : candidates) {
+        LibraryKey key;
+        if (!GetLibraryKey(candidate.path, &key))
+            continue;
+        auto it = g_manifest_cache.find(candidate.path);
+        if (it != g_manifest_cache.end() && it->second.key == key) {
+            candidate.layers = it->second.layers;
+            candidate.enumerated = true;
+            candidate.from_cache = true;
+            ALOGV("layer manifest cache hit for '%s'", candidate.path.c_str());
+        }
+    }
+
+    // Opening a library and enumerating its layers is dominated by dlopen
+    // and the enumeration entrypoints, neither of which touches our global
+    // state, so candidates can be scanned concurrently. Each candidate's
+    // layers go into its own ScanResult; library_idx is assigned during the
+    // merge below, once the final library order is known.
+    std::atomic<size_t> next_candidate(0);
+    auto scan = [&candidates, &next_candidate]() {
+        while (true) {
+            size_t i = next_candidate.fetch_add(1);
+            if (i >= candidates.size())
+                break;
+            ScanResult& candidate = candidates[i];
+            if (candidate.from_cache)
+                continue;
+            if (!candidate.library.Open())
+                continue;
+            candidate.enumerated =
+                candidate.library.EnumerateLayers(0, candidate.layers);
+            candidate.library.Close();
+        }
+    };
+    size_t num_threads = std::min(
+        candidates.size(),
+        std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+                 size_t(1)));
+    num_threads = std::min(num_threads, kMaxScanThreads);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < num_threads; i++)
+        workers.emplace_back(scan);
+    scan();
+    for (std::thread& worker : workers)
+        worker.join();
+
+    // Merge the results in candidate order so the layer priority rules above
+    // are preserved regardless of which thread scanned which library.
+    for (ScanResult& candidate : candidates) {
+        if (!candidate.enumerated)
+            continue;
+        if (!candidate.from_cache) {
+            LibraryKey key;
+            if (GetLibraryKey(candidate.path, &key)) {
+                g_manifest_cache[candidate.path] =
+                    CachedLibrary{key, candidate.layers};
+                g_manifest_cache_dirty = true;
+            }
+        }
+        size_t library_idx = g_layer_libraries.size();
+        for (Layer& layer : candidate.layers) {
+            layer.library_idx = library_idx;
+            g_instance_layers.emplace_back(std::move(layer));
+        }
+        g_layer_libraries.emplace_back(std::move(candidate.library));
+    }
 }
 
 const VkExtensionProperties* FindExtension(
@@ -466,6 +782,8 @@ void DiscoverLayers() {
     }
     if (!android::GraphicsEnv::getInstance().getLayerPaths().empty())
         DiscoverLayersInPathList(android::GraphicsEnv::getInstance().getLayerPaths());
+
+    SaveManifestCache();
 }
 
 uint32_t GetLayerCount() {
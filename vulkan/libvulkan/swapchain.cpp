@@ -28,6 +28,7 @@
 #include <utils/Trace.h>
 
 #include <algorithm>
+#include <limits>
 #include <unordered_set>
 #include <vector>
 
@@ -203,6 +204,23 @@ struct Surface {
     android::sp<ANativeWindow> window;
     VkSwapchainKHR swapchain_handle;
     uint64_t consumer_usage;
+
+    // Window state last applied through this surface. The window is
+    // exclusively connected for as long as the surface exists, and the
+    // BufferQueue preserves this state across the disconnect/reconnect cycle
+    // in vkCreateSwapchainKHR, so remembering it here lets swapchain
+    // recreation and vkAcquireNextImageKHR skip the binder calls that would
+    // just re-apply values the window already has. -1 means the state is
+    // not yet known and must be applied explicitly.
+    int shared_buffer_mode;
+    int auto_refresh;
+    nsecs_t dequeue_timeout;
+
+    // Sentinel for dequeue_timeout: no timeout has been applied yet. -1 is
+    // a valid timeout value (block forever), so a distinct sentinel is
+    // needed.
+    static constexpr nsecs_t kDequeueTimeoutUnknown =
+        std::numeric_limits<nsecs_t>::min();
 };
 
 VkSurfaceKHR HandleFromSurface(Surface* surface) {
@@ -229,7 +247,6 @@ struct Swapchain {
           mailbox_mode(present_mode == VK_PRESENT_MODE_MAILBOX_KHR),
           pre_transform(pre_transform_),
           frame_timestamps_enabled(false),
-          acquire_next_image_timeout(-1),
           shared(present_mode == VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR ||
                  present_mode ==
                      VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR) {
@@ -254,7 +271,6 @@ struct Swapchain {
     int pre_transform;
     bool frame_timestamps_enabled;
     int64_t refresh_duration;
-    nsecs_t acquire_next_image_timeout;
     bool shared;
 
     struct Image {
@@ -532,6 +548,9 @@ VkResult CreateAndroidSurfaceKHR(
 
     surface->window = pCreateInfo->window;
     surface->swapchain_handle = VK_NULL_HANDLE;
+    surface->shared_buffer_mode = -1;
+    surface->auto_refresh = -1;
+    surface->dequeue_timeout = Surface::kDequeueTimeoutUnknown;
     int err = native_window_get_consumer_usage(surface->window.get(),
                                                &surface->consumer_usage);
     if (err != android::OK) {
@@ -1062,11 +1081,19 @@ VkResult CreateSwapchainKHR(VkDevice device,
     ALOGW_IF(err != android::OK, "native_window_api_connect failed: %s (%d)",
              strerror(-err), err);
 
-    err = window->perform(window, NATIVE_WINDOW_SET_DEQUEUE_TIMEOUT, -1);
-    if (err != android::OK) {
-        ALOGE("window->perform(SET_DEQUEUE_TIMEOUT) failed: %s (%d)",
-              strerror(-err), err);
-        return VK_ERROR_SURFACE_LOST_KHR;
+    // Disconnecting frees the window's buffers, but it does not reset the
+    // dequeue timeout, shared buffer mode, or auto refresh state, all of
+    // which cost a binder round trip to change. The surface remembers what
+    // was last applied so that recreating a swapchain only touches the ones
+    // that actually need to change.
+    if (surface.dequeue_timeout != -1) {
+        err = window->perform(window, NATIVE_WINDOW_SET_DEQUEUE_TIMEOUT, -1);
+        if (err != android::OK) {
+            ALOGE("window->perform(SET_DEQUEUE_TIMEOUT) failed: %s (%d)",
+                  strerror(-err), err);
+            return VK_ERROR_SURFACE_LOST_KHR;
+        }
+        surface.dequeue_timeout = -1;
     }
 
     int swap_interval =
@@ -1078,18 +1105,24 @@ VkResult CreateSwapchainKHR(VkDevice device,
         return VK_ERROR_SURFACE_LOST_KHR;
     }
 
-    err = native_window_set_shared_buffer_mode(window, false);
-    if (err != android::OK) {
-        ALOGE("native_window_set_shared_buffer_mode(false) failed: %s (%d)",
-              strerror(-err), err);
-        return VK_ERROR_SURFACE_LOST_KHR;
+    if (surface.shared_buffer_mode != 0) {
+        err = native_window_set_shared_buffer_mode(window, false);
+        if (err != android::OK) {
+            ALOGE("native_window_set_shared_buffer_mode(false) failed: %s (%d)",
+                  strerror(-err), err);
+            return VK_ERROR_SURFACE_LOST_KHR;
+        }
+        surface.shared_buffer_mode = 0;
     }
 
-    err = native_window_set_auto_refresh(window, false);
-    if (err != android::OK) {
-        ALOGE("native_window_set_auto_refresh(false) failed: %s (%d)",
-              strerror(-err), err);
-        return VK_ERROR_SURFACE_LOST_KHR;
+    if (surface.auto_refresh != 0) {
+        err = native_window_set_auto_refresh(window, false);
+        if (err != android::OK) {
+            ALOGE("native_window_set_auto_refresh(false) failed: %s (%d)",
+                  strerror(-err), err);
+            return VK_ERROR_SURFACE_LOST_KHR;
+        }
+        surface.auto_refresh = 0;
     }
 
     // -- Configure the native window --
@@ -1148,18 +1181,25 @@ VkResult CreateSwapchainKHR(VkDevice device,
     if (create_info->presentMode == VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR ||
         create_info->presentMode == VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR) {
         swapchain_image_usage |= VK_SWAPCHAIN_IMAGE_USAGE_SHARED_BIT_ANDROID;
-        err = native_window_set_shared_buffer_mode(window, true);
-        if (err != android::OK) {
-            ALOGE("native_window_set_shared_buffer_mode failed: %s (%d)", strerror(-err), err);
-            return VK_ERROR_SURFACE_LOST_KHR;
+        if (surface.shared_buffer_mode != 1) {
+            err = native_window_set_shared_buffer_mode(window, true);
+            if (err != android::OK) {
+                ALOGE("native_window_set_shared_buffer_mode failed: %s (%d)", strerror(-err),
+                      err);
+                return VK_ERROR_SURFACE_LOST_KHR;
+            }
+            surface.shared_buffer_mode = 1;
         }
     }
 
     if (create_info->presentMode == VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR) {
-        err = native_window_set_auto_refresh(window, true);
-        if (err != android::OK) {
-            ALOGE("native_window_set_auto_refresh failed: %s (%d)", strerror(-err), err);
-            return VK_ERROR_SURFACE_LOST_KHR;
+        if (surface.auto_refresh != 1) {
+            err = native_window_set_auto_refresh(window, true);
+            if (err != android::OK) {
+                ALOGE("native_window_set_auto_refresh failed: %s (%d)", strerror(-err), err);
+                return VK_ERROR_SURFACE_LOST_KHR;
+            }
+            surface.auto_refresh = 1;
         }
     }
 
@@ -1421,8 +1461,10 @@ VkResult AcquireNextImageKHR(VkDevice device,
 
     const nsecs_t acquire_next_image_timeout =
         timeout > (uint64_t)std::numeric_limits<nsecs_t>::max() ? -1 : timeout;
-    if (acquire_next_image_timeout != swapchain.acquire_next_image_timeout) {
-        // Cache the timeout to avoid the duplicate binder cost.
+    if (acquire_next_image_timeout != swapchain.surface.dequeue_timeout) {
+        // Cache the timeout to avoid the duplicate binder cost. It lives on
+        // the surface rather than the swapchain so that it stays warm across
+        // swapchain recreation.
         err = window->perform(window, NATIVE_WINDOW_SET_DEQUEUE_TIMEOUT,
                               acquire_next_image_timeout);
         if (err != android::OK) {
@@ -1430,7 +1472,7 @@ VkResult AcquireNextImageKHR(VkDevice device,
                   strerror(-err), err);
             return VK_ERROR_SURFACE_LOST_KHR;
         }
-        swapchain.acquire_next_image_timeout = acquire_next_image_timeout;
+        swapchain.surface.dequeue_timeout = acquire_next_image_timeout;
     }
 
     ANativeWindowBuffer* buffer;